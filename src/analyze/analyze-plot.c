@@ -206,18 +206,6 @@ static int plot_unit_times(UnitTimes *u, double width, int y) {
         return 1;
 }
 
-static void limit_times_to_boot(const BootTimes *boot, UnitTimes *u) {
-        if (u->deactivated > u->activating && u->deactivated <= boot->finish_time && u->activated == 0
-            && u->deactivating == 0)
-                u->activated = u->deactivating = u->deactivated;
-        if (u->activated < u->activating || u->activated > boot->finish_time)
-                u->activated = boot->finish_time;
-        if (u->deactivating < u->activated || u->deactivating > boot->finish_time)
-                u->deactivating = boot->finish_time;
-        if (u->deactivated < u->deactivating || u->deactivated > boot->finish_time)
-                u->deactivated = boot->finish_time;
-}
-
 static int produce_plot_as_svg(
                 UnitTimes *times,
                 const HostInfo *host,
@@ -60,3 +60,4 @@ UnitTimes* unit_times_free_array(UnitTimes *t);
 DEFINE_TRIVIAL_CLEANUP_FUNC(UnitTimes*, unit_times_free_array);
 
 int acquire_time_data(sd_bus *bus, bool require_finished, UnitTimes **out);
+void limit_times_to_boot(const BootTimes *boot, UnitTimes *u);
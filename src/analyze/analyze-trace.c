@@ -0,0 +1,350 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-json.h"
+
+#include "analyze.h"
+#include "analyze-time-data.h"
+#include "analyze-trace.h"
+#include "bus-error.h"
+#include "bus-map-properties.h"
+#include "json-util.h"
+#include "sort-util.h"
+#include "strv.h"
+#include "unit-name.h"
+
+/* The number of GetAll() calls kept in flight when collecting the resource usage of units */
+#define TRACE_PIPELINE_MAX 64U
+
+/* Thread ID of the track the boot phases are shown on, units get their own tracks after it */
+#define TRACE_TID_BOOT 0U
+
+typedef struct UnitResources {
+        uint64_t cpu_usage_nsec;
+        uint64_t io_read_bytes;
+        uint64_t io_write_bytes;
+        uint64_t memory_peak;
+} UnitResources;
+
+static int compare_unit_start(const UnitTimes *a, const UnitTimes *b) {
+        return CMP(a->activating, b->activating);
+}
+
+static int trace_append_thread_name(sd_json_variant **events, uint64_t tid, const char *name) {
+        assert(events);
+        assert(name);
+
+        return sd_json_variant_append_arraybo(
+                        events,
+                        SD_JSON_BUILD_PAIR_STRING("name", "thread_name"),
+                        SD_JSON_BUILD_PAIR_STRING("ph", "M"),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("pid", 1),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("tid", tid),
+                        SD_JSON_BUILD_PAIR("args", SD_JSON_BUILD_OBJECT(SD_JSON_BUILD_PAIR_STRING("name", name))));
+}
+
+static int trace_append_event(
+                sd_json_variant **events,
+                const char *name,
+                const char *category,
+                uint64_t tid,
+                usec_t begin,
+                usec_t end,
+                sd_json_variant *args) {
+
+        assert(events);
+        assert(name);
+        assert(category);
+
+        /* Complete ("X") events of the Trace Event Format, timestamps and durations are in µs */
+
+        if (end < begin)
+                return 0;
+
+        return sd_json_variant_append_arraybo(
+                        events,
+                        SD_JSON_BUILD_PAIR_STRING("name", name),
+                        SD_JSON_BUILD_PAIR_STRING("cat", category),
+                        SD_JSON_BUILD_PAIR_STRING("ph", "X"),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ts", begin),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("dur", end - begin),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("pid", 1),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("tid", tid),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!args, "args", SD_JSON_BUILD_VARIANT(args)));
+}
+
+static int trace_append_boot_phases(sd_json_variant **events, const BootTimes *boot) {
+        /* Firmware and loader times are counted backwards from the kernel start, hence shift everything by
+         * the firmware time so that all timestamps in the trace are positive. */
+        usec_t offset = boot->firmware_time;
+        int r;
+
+        assert(events);
+        assert(boot);
+
+        r = trace_append_thread_name(events, TRACE_TID_BOOT, "boot");
+        if (r < 0)
+                return r;
+
+        if (timestamp_is_set(boot->firmware_time)) {
+                r = trace_append_event(events, "firmware", "boot", TRACE_TID_BOOT,
+                                       0, offset - boot->loader_time, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        if (timestamp_is_set(boot->loader_time)) {
+                r = trace_append_event(events, "loader", "boot", TRACE_TID_BOOT,
+                                       offset - boot->loader_time, offset, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        if (timestamp_is_set(boot->kernel_done_time)) {
+                r = trace_append_event(events, "kernel", "boot", TRACE_TID_BOOT,
+                                       offset, offset + boot->kernel_done_time, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        if (timestamp_is_set(boot->initrd_time)) {
+                r = trace_append_event(events, "initrd", "boot", TRACE_TID_BOOT,
+                                       offset + boot->initrd_time, offset + boot->userspace_time, NULL);
+                if (r < 0)
+                        return r;
+
+                if (boot->initrd_generators_start_time < boot->initrd_generators_finish_time) {
+                        r = trace_append_event(events, "generators", "boot", TRACE_TID_BOOT,
+                                               offset + boot->initrd_generators_start_time,
+                                               offset + boot->initrd_generators_finish_time, NULL);
+                        if (r < 0)
+                                return r;
+                }
+
+                if (boot->initrd_unitsload_start_time < boot->initrd_unitsload_finish_time) {
+                        r = trace_append_event(events, "unitsload", "boot", TRACE_TID_BOOT,
+                                               offset + boot->initrd_unitsload_start_time,
+                                               offset + boot->initrd_unitsload_finish_time, NULL);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        r = trace_append_event(events, "systemd", "boot", TRACE_TID_BOOT,
+                               offset + boot->userspace_time, offset + boot->finish_time, NULL);
+        if (r < 0)
+                return r;
+
+        if (boot->generators_start_time < boot->generators_finish_time) {
+                r = trace_append_event(events, "generators", "boot", TRACE_TID_BOOT,
+                                       offset + boot->generators_start_time,
+                                       offset + boot->generators_finish_time, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        if (boot->unitsload_start_time < boot->unitsload_finish_time) {
+                r = trace_append_event(events, "unitsload", "boot", TRACE_TID_BOOT,
+                                       offset + boot->unitsload_start_time,
+                                       offset + boot->unitsload_finish_time, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int acquire_unit_resources_one(
+                sd_bus_message *reply,
+                int error,
+                const sd_bus_error *bus_error,
+                size_t idx,
+                void *userdata) {
+
+        static const struct bus_properties_map property_map[] = {
+                { "CPUUsageNSec", "t", NULL, offsetof(UnitResources, cpu_usage_nsec) },
+                { "IOReadBytes",  "t", NULL, offsetof(UnitResources, io_read_bytes)  },
+                { "IOWriteBytes", "t", NULL, offsetof(UnitResources, io_write_bytes) },
+                { "MemoryPeak",   "t", NULL, offsetof(UnitResources, memory_peak)    },
+                {}
+        };
+        _cleanup_(sd_bus_error_free) sd_bus_error map_error = SD_BUS_ERROR_NULL;
+        UnitResources *resources = ASSERT_PTR(userdata);
+        int r;
+
+        /* The unit might have been unloaded in the meantime, or it has no control group. Either way, we
+         * simply don't show any resource usage for it. */
+        if (error < 0) {
+                log_debug_errno(error, "Failed to get properties of unit, ignoring: %s",
+                                bus_error_message(bus_error, error));
+                return 0;
+        }
+
+        r = bus_message_map_all_properties(reply, property_map, /* flags = */ 0, &map_error, resources + idx);
+        if (r < 0)
+                return log_error_errno(r, "Failed to parse unit properties: %s", bus_error_message(&map_error, r));
+
+        return 0;
+}
+
+static int acquire_unit_resources(sd_bus *bus, const UnitTimes *times, size_t n, UnitResources **ret) {
+        _cleanup_free_ UnitResources *resources = NULL;
+        _cleanup_strv_free_ char **paths = NULL;
+        int r;
+
+        assert(bus);
+        assert(times || n == 0);
+        assert(ret);
+
+        if (n == 0) {
+                *ret = NULL;
+                return 0;
+        }
+
+        resources = new(UnitResources, n);
+        if (!resources)
+                return log_oom();
+
+        for (size_t i = 0; i < n; i++) {
+                resources[i] = (UnitResources) {
+                        .cpu_usage_nsec = UINT64_MAX,
+                        .io_read_bytes = UINT64_MAX,
+                        .io_write_bytes = UINT64_MAX,
+                        .memory_peak = UINT64_MAX,
+                };
+
+                r = strv_consume(&paths, unit_dbus_path_from_name(times[i].name));
+                if (r < 0)
+                        return log_oom();
+        }
+
+        r = bus_get_all_properties_pipelined(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        paths,
+                        n,
+                        TRACE_PIPELINE_MAX,
+                        acquire_unit_resources_one,
+                        resources);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(resources);
+        return 0;
+}
+
+static int trace_append_unit(
+                sd_json_variant **events,
+                const BootTimes *boot,
+                const UnitTimes *u,
+                const UnitResources *res,
+                uint64_t tid) {
+
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *args = NULL;
+        usec_t offset = boot->firmware_time;
+        int r;
+
+        assert(events);
+        assert(boot);
+        assert(u);
+        assert(res);
+
+        r = trace_append_thread_name(events, tid, u->name);
+        if (r < 0)
+                return r;
+
+        /* Resource usage is accumulated over the unit's lifetime, hence attach it to the activation. Fields
+         * the unit does not have (no control group, accounting disabled) are left out. */
+        r = sd_json_buildo(
+                        &args,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("activationUSec", u->time),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("cpuUsageNSec", res->cpu_usage_nsec, UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("ioReadBytes", res->io_read_bytes, UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("ioWriteBytes", res->io_write_bytes, UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("memoryPeakBytes", res->memory_peak, UINT64_MAX));
+        if (r < 0)
+                return r;
+
+        r = trace_append_event(events, "activating", "unit", tid,
+                               offset + u->activating, offset + u->activated, args);
+        if (r < 0)
+                return r;
+
+        r = trace_append_event(events, "active", "unit", tid,
+                               offset + u->activated, offset + u->deactivating, NULL);
+        if (r < 0)
+                return r;
+
+        /* Units that are still active have been clamped to the end of the boot by limit_times_to_boot() */
+        if (u->deactivated <= u->deactivating)
+                return 0;
+
+        return trace_append_event(events, "deactivating", "unit", tid,
+                                  offset + u->deactivating, offset + u->deactivated, NULL);
+}
+
+int verb_trace(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *events = NULL, *v = NULL;
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(unit_times_free_arrayp) UnitTimes *times = NULL;
+        _cleanup_free_ UnitResources *resources = NULL;
+        bool use_full_bus = arg_runtime_scope == RUNTIME_SCOPE_SYSTEM;
+        BootTimes *boot;
+        size_t n;
+        int r;
+
+        r = acquire_bus(&bus, &use_full_bus);
+        if (r < 0)
+                return bus_log_connect_error(r, arg_transport, arg_runtime_scope);
+
+        r = acquire_boot_times(bus, /* require_finished = */ true, &boot);
+        if (r < 0)
+                return r;
+
+        r = acquire_time_data(bus, /* require_finished = */ true, &times);
+        if (r < 0)
+                return r;
+        n = r;
+
+        typesafe_qsort(times, n, compare_unit_start);
+
+        /* Units are sorted by activation time, so everything after the first unit that was started after
+         * the boot finished is not part of the boot. */
+        for (size_t i = 0; i < n; i++)
+                if (times[i].activating > boot->finish_time) {
+                        n = i;
+                        break;
+                }
+
+        r = acquire_unit_resources(bus, times, n, &resources);
+        if (r < 0)
+                return r;
+
+        r = trace_append_boot_phases(&events, boot);
+        if (r < 0)
+                return log_error_errno(r, "Failed to build trace events: %m");
+
+        for (size_t i = 0; i < n; i++) {
+                limit_times_to_boot(boot, times + i);
+
+                r = trace_append_unit(&events, boot, times + i, resources + i, TRACE_TID_BOOT + 1 + i);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to build trace events: %m");
+        }
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_VARIANT("traceEvents", events),
+                        SD_JSON_BUILD_PAIR_STRING("displayTimeUnit", "ms"));
+        if (r < 0)
+                return log_error_errno(r, "Failed to build trace JSON: %m");
+
+        r = sd_json_variant_dump(
+                        v,
+                        sd_json_format_enabled(arg_json_format_flags) ? arg_json_format_flags : SD_JSON_FORMAT_NEWLINE,
+                        stdout,
+                        /* prefix = */ NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to output trace: %m");
+
+        return EXIT_SUCCESS;
+}
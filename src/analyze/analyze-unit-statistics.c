@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-varlink.h"
+
+#include "analyze.h"
+#include "analyze-unit-statistics.h"
+#include "format-table.h"
+#include "json-util.h"
+#include "unit-name.h"
+#include "varlink-util.h"
+
+typedef struct UnitStatisticsReply {
+        const char *name;
+        uint64_t notify_messages;
+        uint64_t bus_lookups;
+        uint64_t change_signals;
+        uint64_t cgroup_realizations;
+        uint64_t loads;
+        uint64_t gc_checks;
+} UnitStatisticsReply;
+
+static int table_add_unit_statistics(Table *table, sd_json_variant *v) {
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "name",               SD_JSON_VARIANT_STRING,   sd_json_dispatch_const_string, offsetof(UnitStatisticsReply, name),                SD_JSON_MANDATORY },
+                { "notifyMessages",     _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitStatisticsReply, notify_messages),     0                 },
+                { "busLookups",         _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitStatisticsReply, bus_lookups),         0                 },
+                { "changeSignals",      _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitStatisticsReply, change_signals),      0                 },
+                { "cgroupRealizations", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitStatisticsReply, cgroup_realizations), 0                 },
+                { "loads",              _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitStatisticsReply, loads),               0                 },
+                { "gcChecks",           _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitStatisticsReply, gc_checks),           0                 },
+                {}
+        };
+
+        UnitStatisticsReply p = {};
+        int r;
+
+        assert(table);
+        assert(v);
+
+        r = sd_json_dispatch(v, dispatch_table, SD_JSON_LOG|SD_JSON_ALLOW_EXTENSIONS, &p);
+        if (r < 0)
+                return r;
+
+        r = table_add_many(table,
+                           TABLE_UINT64, p.notify_messages,
+                           TABLE_UINT64, p.bus_lookups,
+                           TABLE_UINT64, p.change_signals,
+                           TABLE_UINT64, p.cgroup_realizations,
+                           TABLE_UINT64, p.loads,
+                           TABLE_UINT64, p.gc_checks,
+                           TABLE_STRING, p.name);
+        if (r < 0)
+                return table_log_add_error(r);
+
+        return 0;
+}
+
+int verb_unit_statistics(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_varlink_flush_close_unrefp) sd_varlink *vl = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        int r;
+
+        if (arg_transport != BUS_TRANSPORT_LOCAL || arg_runtime_scope != RUNTIME_SCOPE_SYSTEM)
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                       "Unit statistics are only available for the local system manager.");
+
+        r = sd_varlink_connect_address(&vl, VARLINK_ADDR_PATH_MANAGER_SYSTEM);
+        if (r < 0)
+                return log_error_errno(r, "Failed to connect to %s: %m", VARLINK_ADDR_PATH_MANAGER_SYSTEM);
+
+        table = table_new("notify", "bus", "signals", "realize", "loads", "gc", "unit");
+        if (!table)
+                return log_oom();
+
+        for (size_t i = 0; i < 6; i++)
+                (void) table_set_align_percent(table, TABLE_HEADER_CELL(i), 100);
+
+        /* Show the busiest units first */
+        r = table_set_sort(table, (size_t) 0, (size_t) 1, (size_t) 2, (size_t) 6);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set sort order: %m");
+
+        (void) table_set_reverse(table, 0, true);
+        (void) table_set_reverse(table, 1, true);
+        (void) table_set_reverse(table, 2, true);
+
+        if (argc <= 1) {
+                sd_json_variant *reply = NULL;
+                const char *error_id = NULL;
+
+                r = sd_varlink_collect(vl, "io.systemd.Manager.ListUnitStatistics", /* parameters= */ NULL, &reply, &error_id);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to issue ListUnitStatistics() call: %m");
+                if (streq_ptr(error_id, "io.systemd.Manager.StatisticsDisabled"))
+                        return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                               "The service manager doesn't collect unit statistics, boot with SYSTEMD_UNIT_STATISTICS=1 on the kernel command line to enable them.");
+                if (error_id)
+                        return log_error_errno(sd_varlink_error_to_errno(error_id, reply),
+                                               "Failed to issue ListUnitStatistics() call: %s", error_id);
+
+                sd_json_variant *e;
+                JSON_VARIANT_ARRAY_FOREACH(e, reply) {
+                        r = table_add_unit_statistics(table, e);
+                        if (r < 0)
+                                return r;
+                }
+        } else
+                STRV_FOREACH(arg, strv_skip(argv, 1)) {
+                        _cleanup_free_ char *name = NULL;
+                        sd_json_variant *reply = NULL;
+
+                        r = unit_name_mangle(*arg, UNIT_NAME_MANGLE_WARN, &name);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to mangle unit name '%s': %m", *arg);
+
+                        r = varlink_callbo_and_log(
+                                        vl,
+                                        "io.systemd.Manager.ListUnitStatistics",
+                                        &reply,
+                                        SD_JSON_BUILD_PAIR_STRING("name", name));
+                        if (r < 0)
+                                return r;
+
+                        r = table_add_unit_statistics(table, reply);
+                        if (r < 0)
+                                return r;
+                }
+
+        r = table_print_with_pager(table, arg_json_format_flags, arg_pager_flags, /* show_header= */ true);
+        if (r < 0)
+                return r;
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdalign.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "memory-util.h"
+#include "strv.h"
+
+/* The first block is sized to fit a typical udev rules or unit file, every subsequent one is twice as
+ * large as the previous one, up to ARENA_BLOCK_SIZE_MAX. */
+#define ARENA_BLOCK_SIZE_MIN (16U * 1024U)
+#define ARENA_BLOCK_SIZE_MAX (1024U * 1024U)
+
+#define ARENA_ALIGN(l) ALIGN_TO((l), alignof(max_align_t))
+
+struct ArenaBlock {
+        ArenaBlock *next;
+        size_t size;
+        size_t used;
+};
+
+static void* arena_block_data(ArenaBlock *b) {
+        return (uint8_t*) ASSERT_PTR(b) + ARENA_ALIGN(sizeof(ArenaBlock));
+}
+
+static ArenaBlock* arena_block_new(size_t size) {
+        ArenaBlock *b;
+
+        b = malloc(ARENA_ALIGN(sizeof(ArenaBlock)) + size);
+        if (!b)
+                return NULL;
+
+        *b = (ArenaBlock) {
+                .size = size,
+        };
+
+        return b;
+}
+
+void* arena_alloc(Arena *a, size_t size) {
+        ArenaBlock *b;
+        size_t l;
+
+        assert(a);
+
+        l = ARENA_ALIGN(MAX(size, 1U));
+        if (l == SIZE_MAX || l < size)
+                return NULL;
+
+        b = a->blocks;
+        if (_likely_(b && b->size - b->used >= l)) {
+                void *p = (uint8_t*) arena_block_data(b) + b->used;
+                b->used += l;
+                return p;
+        }
+
+        if (l > ARENA_BLOCK_SIZE_MAX / 4) {
+                /* Large objects get a block of their own, which is queued behind the current one, so that
+                 * we can continue to allocate from what is left in that. */
+                if (l > SIZE_MAX - ARENA_ALIGN(sizeof(ArenaBlock)))
+                        return NULL;
+
+                b = arena_block_new(l);
+                if (!b)
+                        return NULL;
+
+                b->used = l;
+
+                if (a->blocks) {
+                        b->next = a->blocks->next;
+                        a->blocks->next = b;
+                } else
+                        a->blocks = b;
+
+                a->n_blocks++;
+                return arena_block_data(b);
+        }
+
+        b = arena_block_new(MIN(a->blocks ? a->blocks->size * 2 : ARENA_BLOCK_SIZE_MIN, ARENA_BLOCK_SIZE_MAX));
+        if (!b)
+                return NULL;
+
+        b->next = a->blocks;
+        b->used = l;
+        a->blocks = b;
+        a->n_blocks++;
+
+        return arena_block_data(b);
+}
+
+void* arena_alloc0(Arena *a, size_t size) {
+        void *p;
+
+        p = arena_alloc(a, size);
+        if (!p)
+                return NULL;
+
+        return memzero(p, size);
+}
+
+void* arena_memdup(Arena *a, const void *p, size_t l) {
+        void *q;
+
+        assert(a);
+        assert(p || l == 0);
+
+        q = arena_alloc(a, l);
+        if (!q)
+                return NULL;
+
+        return memcpy_safe(q, p, l);
+}
+
+char* arena_strndup(Arena *a, const char *s, size_t n) {
+        char *p;
+
+        assert(a);
+        assert(s);
+
+        n = strnlen(s, n);
+
+        p = arena_alloc(a, n + 1);
+        if (!p)
+                return NULL;
+
+        *((char*) mempcpy(p, s, n)) = 0;
+        return p;
+}
+
+char** arena_strv_copy(Arena *a, char * const *l) {
+        char **k;
+        size_t n = 0;
+
+        assert(a);
+
+        STRV_FOREACH(i, l)
+                n++;
+
+        k = arena_new(a, char*, n + 1);
+        if (!k)
+                return NULL;
+
+        for (size_t i = 0; i < n; i++) {
+                k[i] = arena_strdup(a, l[i]);
+                if (!k[i])
+                        return NULL;
+        }
+
+        k[n] = NULL;
+        return k;
+}
+
+void arena_done(Arena *a) {
+        assert(a);
+
+        while (a->blocks) {
+                ArenaBlock *b = a->blocks;
+
+                a->blocks = b->next;
+                free(b);
+        }
+
+        a->n_blocks = 0;
+}
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#include "alloc-util.h"
+#include "macro.h"
+
+/* A bump pointer allocator for objects that share a common lifetime: allocations are carved out of large
+ * blocks, are never freed individually, and all go away at once in arena_done(). Zero initialize an Arena
+ * before use, it does not allocate anything before the first allocation. */
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct Arena {
+        ArenaBlock *blocks; /* the block we currently allocate from is the first one */
+        size_t n_blocks;
+} Arena;
+
+void* arena_alloc(Arena *a, size_t size) _alloc_(2);
+void* arena_alloc0(Arena *a, size_t size) _alloc_(2);
+
+static inline void* arena_alloc_multiply(Arena *a, size_t need, size_t size) {
+        if (size_multiply_overflow(size, need))
+                return NULL;
+
+        return arena_alloc(a, size * need);
+}
+
+static inline void* arena_alloc0_multiply(Arena *a, size_t need, size_t size) {
+        if (size_multiply_overflow(size, need))
+                return NULL;
+
+        return arena_alloc0(a, size * need);
+}
+
+#define arena_new(a, t, n) ((t*) arena_alloc_multiply(a, n, sizeof(t)))
+#define arena_new0(a, t, n) ((t*) arena_alloc0_multiply(a, n, sizeof(t)))
+
+void* arena_memdup(Arena *a, const void *p, size_t l) _alloc_(3);
+char* arena_strndup(Arena *a, const char *s, size_t n);
+static inline char* arena_strdup(Arena *a, const char *s) {
+        return arena_strndup(a, s, SIZE_MAX);
+}
+
+char** arena_strv_copy(Arena *a, char * const *l);
+
+/* Releases all memory allocated from the arena, leaving it empty and ready for reuse */
+void arena_done(Arena *a);
@@ -1724,13 +1724,28 @@ int cg_get_attribute(const char *controller, const char *path, const char *attri
 }
 
 int cg_get_attribute_as_uint64(const char *controller, const char *path, const char *attribute, uint64_t *ret) {
+        _cleanup_free_ char *p = NULL;
+        int r;
+
+        assert(ret);
+
+        r = cg_get_path(controller, path, attribute, &p);
+        if (r < 0)
+                return r;
+
+        return cg_get_attribute_as_uint64_at(AT_FDCWD, p, ret);
+}
+
+int cg_get_attribute_as_uint64_at(int dfd, const char *attribute, uint64_t *ret) {
         _cleanup_free_ char *value = NULL;
         uint64_t v;
         int r;
 
+        assert(dfd >= 0 || dfd == AT_FDCWD);
+        assert(attribute);
         assert(ret);
 
-        r = cg_get_attribute(controller, path, attribute, &value);
+        r = read_one_line_file_at(dfd, attribute, &value);
         if (r == -ENOENT)
                 return -ENODATA;
         if (r < 0)
@@ -1799,10 +1814,7 @@ int cg_get_keyed_attribute_full(
                 char **ret_values,
                 CGroupKeyMode mode) {
 
-        _cleanup_free_ char *filename = NULL, *contents = NULL;
-        const char *p;
-        size_t n, i, n_done = 0;
-        char **v;
+        _cleanup_free_ char *filename = NULL;
         int r;
 
         /* Reads one or more fields of a cgroup v2 keyed attribute file. The 'keys' parameter should be an strv with
@@ -1816,7 +1828,26 @@ int cg_get_keyed_attribute_full(
         if (r < 0)
                 return r;
 
-        r = read_full_file(filename, &contents, NULL);
+        return cg_get_keyed_attribute_full_at(AT_FDCWD, filename, keys, ret_values, mode);
+}
+
+int cg_get_keyed_attribute_full_at(
+                int dfd,
+                const char *attribute,
+                char **keys,
+                char **ret_values,
+                CGroupKeyMode mode) {
+
+        _cleanup_free_ char *contents = NULL;
+        const char *p;
+        size_t n, i, n_done = 0;
+        char **v;
+        int r;
+
+        assert(dfd >= 0 || dfd == AT_FDCWD);
+        assert(attribute);
+
+        r = read_full_file_full(dfd, attribute, UINT64_MAX, SIZE_MAX, 0, NULL, &contents, NULL);
         if (r < 0)
                 return r;
 
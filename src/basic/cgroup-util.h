@@ -236,6 +236,10 @@ int cg_set_attribute(const char *controller, const char *path, const char *attri
 int cg_get_attribute(const char *controller, const char *path, const char *attribute, char **ret);
 int cg_get_keyed_attribute_full(const char *controller, const char *path, const char *attribute, char **keys, char **values, CGroupKeyMode mode);
 
+/* Reads 'attribute' relative to an already opened cgroup directory, which is cheaper when reading several
+ * attributes of the same cgroup. The same goes for cg_get_attribute_as_uint64_at(). */
+int cg_get_keyed_attribute_full_at(int dfd, const char *attribute, char **keys, char **values, CGroupKeyMode mode);
+
 static inline int cg_get_keyed_attribute(
                 const char *controller,
                 const char *path,
@@ -255,6 +259,7 @@ static inline int cg_get_keyed_attribute_graceful(
 }
 
 int cg_get_attribute_as_uint64(const char *controller, const char *path, const char *attribute, uint64_t *ret);
+int cg_get_attribute_as_uint64_at(int dfd, const char *attribute, uint64_t *ret);
 
 /* Does a parse_boolean() on the attribute contents and sets ret accordingly */
 int cg_get_attribute_as_bool(const char *controller, const char *path, const char *attribute, bool *ret);
@@ -9,6 +9,7 @@
 #include "fs-util.h"
 #include "glyph-util.h"
 #include "log.h"
+#include "missing_syscall.h"
 #include "path-util.h"
 #include "string-util.h"
 #include "user-util.h"
@@ -79,6 +80,113 @@ static int chaseat_needs_absolute(int dir_fd, const char *path) {
         return dir_fd_is_root(dir_fd);
 }
 
+static bool have_openat2 = true; /* Assume we live in the future */
+
+static int chaseat_openat2(int dir_fd, const char *path, ChaseFlags flags, char **ret_path, int *ret_fd) {
+        _cleanup_free_ char *done = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        bool no_symlinks, append_trail_slash;
+        const char *todo;
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(path);
+        assert(FLAGS_SET(flags, CHASE_AT_RESOLVE_IN_ROOT));
+
+        /* Resolves the path with a single openat2() call, in the cases where RESOLVE_IN_ROOT implements
+         * exactly the semantics of the component-wise walk in chaseat(). Returns > 0 on success, 0 if the
+         * caller shall fall back to the walk, and negative errno on failure.
+         *
+         * Magic links are refused, as the walk resolves them as plain symlinks via readlinkat(). If the
+         * caller asks for the resolved path, symlinks are refused too: then no symlink was traversed if
+         * openat2() succeeded, and the resolved path is just the normalized input path. */
+
+        if (!have_openat2)
+                return 0;
+
+        if (flags & ~(CHASE_AT_RESOLVE_IN_ROOT|CHASE_NOFOLLOW|CHASE_PROHIBIT_SYMLINKS|CHASE_TRAIL_SLASH|
+                      CHASE_EXTRACT_FILENAME|CHASE_WARN))
+                return 0;
+
+        /* The walk ignores trailing slashes when looking up the last component, the kernel follows it
+         * instead, even with O_NOFOLLOW. */
+        if (FLAGS_SET(flags, CHASE_NOFOLLOW) && ENDSWITH_SET(path, "/", "/."))
+                return 0;
+
+        no_symlinks = ret_path || FLAGS_SET(flags, CHASE_PROHIBIT_SYMLINKS);
+        append_trail_slash = FLAGS_SET(flags, CHASE_TRAIL_SLASH) && ENDSWITH_SET(path, "/", "/.");
+
+        for (todo = path;;) {
+                const char *e;
+
+                r = path_find_first_component(&todo, /* accept_dot_dot= */ true, &e);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                /* ".." is handled by the walk, which takes care of refusing to go above the root. */
+                if (r == 2 && strneq(e, "..", 2))
+                        return 0;
+
+                if (ret_path) {
+                        if (done && !strextend(&done, "/"))
+                                return -ENOMEM;
+                        if (!strextendn(&done, e, r))
+                                return -ENOMEM;
+                }
+        }
+
+        fd = openat2(dir_fd, path,
+                     &(struct open_how) {
+                             .flags = O_PATH|O_CLOEXEC|(FLAGS_SET(flags, CHASE_NOFOLLOW) ? O_NOFOLLOW : 0),
+                             .resolve = RESOLVE_IN_ROOT|(no_symlinks ? RESOLVE_NO_SYMLINKS : RESOLVE_NO_MAGICLINKS),
+                     },
+                     sizeof(struct open_how));
+        if (fd < 0) {
+                if (ERRNO_IS_NOT_SUPPORTED(errno) || errno == EPERM) {
+                        have_openat2 = false;
+                        return 0;
+                }
+
+                if (errno == ENOENT)
+                        return -ENOENT;
+
+                /* Everything else (ELOOP for refused symlinks, ENOTDIR for trailing slashes after
+                 * non-directories, …) is left to the walk, which knows how to handle and report it. */
+                return 0;
+        }
+
+        if (ret_path) {
+                if (append_trail_slash)
+                        if (!strextend(&done, "/"))
+                                return -ENOMEM;
+
+                if (FLAGS_SET(flags, CHASE_EXTRACT_FILENAME) && done) {
+                        _cleanup_free_ char *f = NULL;
+
+                        r = path_extract_filename(done, &f);
+                        if (r < 0 && r != -EADDRNOTAVAIL)
+                                return r;
+
+                        free_and_replace(done, f);
+                }
+
+                if (!done) {
+                        done = strdup(append_trail_slash ? "./" : ".");
+                        if (!done)
+                                return -ENOMEM;
+                }
+
+                *ret_path = TAKE_PTR(done);
+        }
+
+        if (ret_fd)
+                *ret_fd = TAKE_FD(fd);
+
+        return 1;
+}
+
 int chaseat(int dir_fd, const char *path, ChaseFlags flags, char **ret_path, int *ret_fd) {
         _cleanup_free_ char *buffer = NULL, *done = NULL;
         _cleanup_close_ int fd = -EBADF, root_fd = -EBADF;
@@ -205,6 +313,12 @@ int chaseat(int dir_fd, const char *path, ChaseFlags flags, char **ret_path, int
                 return 0;
         }
 
+        if (dir_fd >= 0 && FLAGS_SET(flags, CHASE_AT_RESOLVE_IN_ROOT)) {
+                r = chaseat_openat2(dir_fd, path, flags, ret_path, ret_fd);
+                if (r != 0)
+                        return r;
+        }
+
         buffer = strdup(path);
         if (!buffer)
                 return -ENOMEM;
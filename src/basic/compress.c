@@ -2,6 +2,7 @@
 
 #include <inttypes.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -55,11 +56,13 @@ static void *zstd_dl = NULL;
 
 static DLSYM_PROTOTYPE(ZSTD_CCtx_setParameter) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_compress) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_compressCCtx) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_compressStream2) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_createCCtx) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_createDCtx) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_CStreamInSize) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_CStreamOutSize) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_DCtx_reset) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_decompressStream) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_DStreamInSize) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_DStreamOutSize) = NULL;
@@ -73,6 +76,81 @@ static DLSYM_PROTOTYPE(ZSTD_isError) = NULL;
 DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(ZSTD_CCtx*, sym_ZSTD_freeCCtx, NULL);
 DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(ZSTD_DCtx*, sym_ZSTD_freeDCtx, NULL);
 
+/* Journal DATA objects are compressed and decompressed one small blob at a time, and setting up a zstd
+ * context (and its workspace) for each of them dominates the cost for short payloads. Hence keep one
+ * context of each kind around per thread and reuse it. */
+static thread_local ZSTD_CCtx *zstd_cctx = NULL;
+static thread_local ZSTD_DCtx *zstd_dctx = NULL;
+
+/* Only used for its destructor, which releases the contexts of a thread when it exits */
+static pthread_key_t zstd_ctx_key;
+static pthread_once_t zstd_ctx_key_once = PTHREAD_ONCE_INIT;
+static bool zstd_ctx_key_initialized = false;
+
+static void zstd_release_contexts(void *userdata) {
+        if (zstd_cctx) {
+                sym_ZSTD_freeCCtx(zstd_cctx);
+                zstd_cctx = NULL;
+        }
+
+        if (zstd_dctx) {
+                sym_ZSTD_freeDCtx(zstd_dctx);
+                zstd_dctx = NULL;
+        }
+}
+
+static void zstd_ctx_key_init(void) {
+        zstd_ctx_key_initialized = pthread_key_create(&zstd_ctx_key, zstd_release_contexts) == 0;
+}
+
+static void zstd_ctx_track_thread(void) {
+        /* Key destructors are only called for non-NULL values, hence set one for every thread that got
+         * contexts. If the key can't be set up, we don't bother, it's just memory released when the process exits. */
+        (void) pthread_once(&zstd_ctx_key_once, zstd_ctx_key_init);
+        if (zstd_ctx_key_initialized)
+                (void) pthread_setspecific(zstd_ctx_key, INT_TO_PTR(1));
+}
+
+_destructor_ static void zstd_release_contexts_at_exit(void) {
+        /* Key destructors are not called for the thread that calls exit(), usually the main thread */
+        zstd_release_contexts(NULL);
+
+        /* We might be linked into a module that is unloaded with dlclose() while other threads keep
+         * running. Make sure they won't call into our destructor once the code is gone. Their contexts are
+         * leaked in that case, but that's better than crashing. */
+        if (zstd_ctx_key_initialized) {
+                (void) pthread_key_delete(zstd_ctx_key);
+                zstd_ctx_key_initialized = false;
+        }
+}
+
+static ZSTD_CCtx* zstd_get_cctx(void) {
+        if (!zstd_cctx) {
+                zstd_cctx = sym_ZSTD_createCCtx();
+                if (zstd_cctx)
+                        zstd_ctx_track_thread();
+        }
+
+        return zstd_cctx;
+}
+
+static ZSTD_DCtx* zstd_get_dctx(void) {
+        if (zstd_dctx) {
+                /* A previous call might have bailed out in the middle of a frame, start afresh. */
+                size_t k = sym_ZSTD_DCtx_reset(zstd_dctx, ZSTD_reset_session_only);
+                if (!sym_ZSTD_isError(k))
+                        return zstd_dctx;
+
+                sym_ZSTD_freeDCtx(zstd_dctx);
+        }
+
+        zstd_dctx = sym_ZSTD_createDCtx();
+        if (zstd_dctx)
+                zstd_ctx_track_thread();
+
+        return zstd_dctx;
+}
+
 static int zstd_ret_to_errno(size_t ret) {
         switch (sym_ZSTD_getErrorCode(ret)) {
         case ZSTD_error_dstSize_tooSmall:
@@ -262,12 +340,14 @@ int dlopen_zstd(void) {
                         "libzstd.so.1", LOG_DEBUG,
                         DLSYM_ARG(ZSTD_getErrorCode),
                         DLSYM_ARG(ZSTD_compress),
+                        DLSYM_ARG(ZSTD_compressCCtx),
                         DLSYM_ARG(ZSTD_getFrameContentSize),
                         DLSYM_ARG(ZSTD_decompressStream),
                         DLSYM_ARG(ZSTD_getErrorName),
                         DLSYM_ARG(ZSTD_DStreamOutSize),
                         DLSYM_ARG(ZSTD_CStreamInSize),
                         DLSYM_ARG(ZSTD_CStreamOutSize),
+                        DLSYM_ARG(ZSTD_DCtx_reset),
                         DLSYM_ARG(ZSTD_CCtx_setParameter),
                         DLSYM_ARG(ZSTD_compressStream2),
                         DLSYM_ARG(ZSTD_DStreamInSize),
@@ -290,6 +370,7 @@ int compress_blob_zstd(
         assert(dst_size);
 
 #if HAVE_ZSTD
+        ZSTD_CCtx *cctx;
         size_t k;
         int r;
 
@@ -297,7 +378,11 @@ int compress_blob_zstd(
         if (r < 0)
                 return r;
 
-        k = sym_ZSTD_compress(dst, dst_alloc_size, src, src_size, 0);
+        cctx = zstd_get_cctx();
+        if (!cctx)
+                return -ENOMEM;
+
+        k = sym_ZSTD_compressCCtx(cctx, dst, dst_alloc_size, src, src_size, 0);
         if (sym_ZSTD_isError(k))
                 return zstd_ret_to_errno(k);
 
@@ -448,7 +533,7 @@ int decompress_blob_zstd(
         if (!(greedy_realloc(dst, MAX(sym_ZSTD_DStreamOutSize(), size), 1)))
                 return -ENOMEM;
 
-        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = sym_ZSTD_createDCtx();
+        ZSTD_DCtx *dctx = zstd_get_dctx();
         if (!dctx)
                 return -ENOMEM;
 
@@ -667,7 +752,7 @@ int decompress_startswith_zstd(
         if (size < prefix_len + 1)
                 return 0; /* Decompressed text too short to match the prefix and extra */
 
-        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = sym_ZSTD_createDCtx();
+        ZSTD_DCtx *dctx = zstd_get_dctx();
         if (!dctx)
                 return -ENOMEM;
 
@@ -1052,7 +1137,7 @@ int decompress_stream_lz4(int in, int out, uint64_t max_bytes) {
 #endif
 }
 
-int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+int compress_stream_zstd_full(int fdf, int fdt, uint64_t max_bytes, unsigned n_threads, uint64_t *ret_uncompressed_size) {
         assert(fdf >= 0);
         assert(fdt >= 0);
 
@@ -1081,6 +1166,15 @@ int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_unc
         if (sym_ZSTD_isError(z))
                 log_debug("Failed to enable ZSTD checksum, ignoring: %s", sym_ZSTD_getErrorName(z));
 
+        if (n_threads > 1) {
+                /* This only works if libzstd was built with multi-threading support, otherwise we just stay
+                 * single-threaded. */
+                z = sym_ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, (int) MIN(n_threads, (unsigned) INT_MAX));
+                if (sym_ZSTD_isError(z))
+                        log_debug("Failed to set number of ZSTD worker threads to %u, ignoring: %s",
+                                  n_threads, sym_ZSTD_getErrorName(z));
+        }
+
         /* This loop read from the input file, compresses that entire chunk,
          * and writes all output produced to the output file.
          */
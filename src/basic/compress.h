@@ -64,7 +64,10 @@ int decompress_startswith(Compression compression,
 
 int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
 int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
-int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
+int compress_stream_zstd_full(int fdf, int fdt, uint64_t max_bytes, unsigned n_threads, uint64_t *ret_uncompressed_size);
+static inline int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+        return compress_stream_zstd_full(fdf, fdt, max_bytes, 0, ret_uncompressed_size);
+}
 
 int decompress_stream_xz(int fdf, int fdt, uint64_t max_size);
 int decompress_stream_lz4(int fdf, int fdt, uint64_t max_size);
@@ -104,10 +107,11 @@ static inline int compress_blob(
         }
 }
 
-static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+/* n_threads is currently only honoured for zstd, the other algorithms always compress on the calling thread */
+static inline int compress_stream_full(int fdf, int fdt, uint64_t max_bytes, unsigned n_threads, uint64_t *ret_uncompressed_size) {
         switch (DEFAULT_COMPRESSION) {
         case COMPRESSION_ZSTD:
-                return compress_stream_zstd(fdf, fdt, max_bytes, ret_uncompressed_size);
+                return compress_stream_zstd_full(fdf, fdt, max_bytes, n_threads, ret_uncompressed_size);
         case COMPRESSION_LZ4:
                 return compress_stream_lz4(fdf, fdt, max_bytes, ret_uncompressed_size);
         case COMPRESSION_XZ:
@@ -117,6 +121,10 @@ static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t
         }
 }
 
+static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+        return compress_stream_full(fdf, fdt, max_bytes, 0, ret_uncompressed_size);
+}
+
 static inline const char* default_compression_extension(void) {
         switch (DEFAULT_COMPRESSION) {
         case COMPRESSION_ZSTD:
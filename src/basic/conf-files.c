@@ -1,9 +1,11 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "chase.h"
 #include "conf-files.h"
@@ -14,10 +16,14 @@
 #include "fileio.h"
 #include "glyph-util.h"
 #include "hashmap.h"
+#include "inotify-util.h"
+#include "list.h"
 #include "log.h"
 #include "macro.h"
+#include "missing_threads.h"
 #include "nulstr-util.h"
 #include "path-util.h"
+#include "process-util.h"
 #include "set.h"
 #include "sort-util.h"
 #include "stat-util.h"
@@ -25,6 +31,108 @@
 #include "strv.h"
 #include "terminal-util.h"
 
+#define CONF_FILES_NEED_STAT                                            \
+        (CONF_FILES_FILTER_MASKED|CONF_FILES_REGULAR|CONF_FILES_DIRECTORY|CONF_FILES_EXECUTABLE)
+
+static int files_add_one(
+                Hashmap **files,
+                Set **masked,
+                const char *dirpath,
+                int dfd,
+                const char *name,
+                const struct stat *cached_st,
+                const char *suffix,
+                unsigned flags) {
+
+        _cleanup_free_ char *n = NULL, *p = NULL;
+        struct stat st;
+        int r;
+
+        assert(files);
+        assert(masked);
+        assert(dirpath);
+        assert(name);
+
+        /* Does this match the suffix? */
+        if (suffix && !endswith(name, suffix))
+                return 0;
+
+        /* Has this file already been found in an earlier directory? */
+        if (hashmap_contains(*files, name)) {
+                log_debug("Skipping overridden file '%s/%s'.", dirpath, name);
+                return 0;
+        }
+
+        /* Has this been masked in an earlier directory? */
+        if ((flags & CONF_FILES_FILTER_MASKED) && set_contains(*masked, name)) {
+                log_debug("File '%s/%s' is masked by previous entry.", dirpath, name);
+                return 0;
+        }
+
+        /* Read file metadata if we shall validate the check for file masks, for node types or whether the node is marked executable. */
+        if (flags & CONF_FILES_NEED_STAT) {
+                if (cached_st)
+                        st = *cached_st;
+                else if (fstatat(dfd, name, &st, 0) < 0) {
+                        log_debug_errno(errno, "Failed to stat '%s/%s', ignoring: %m", dirpath, name);
+                        return 0;
+                }
+        }
+
+        /* Is this a masking entry? */
+        if ((flags & CONF_FILES_FILTER_MASKED))
+                if (null_or_empty(&st)) {
+                        /* Mark this one as masked */
+                        r = set_put_strdup(masked, name);
+                        if (r < 0)
+                                return r;
+
+                        log_debug("File '%s/%s' is a mask.", dirpath, name);
+                        return 0;
+                }
+
+        /* Does this node have the right type? */
+        if (flags & (CONF_FILES_REGULAR|CONF_FILES_DIRECTORY))
+                if (!((flags & CONF_FILES_DIRECTORY) && S_ISDIR(st.st_mode)) &&
+                    !((flags & CONF_FILES_REGULAR) && S_ISREG(st.st_mode))) {
+                        log_debug("Ignoring '%s/%s', as it does not have the right type.", dirpath, name);
+                        return 0;
+                }
+
+        /* Does this node have the executable bit set? */
+        if (flags & CONF_FILES_EXECUTABLE)
+                /* As requested: check if the file is marked executable. Note that we don't check access(X_OK)
+                 * here, as we care about whether the file is marked executable at all, and not whether it is
+                 * executable for us, because if so, such errors are stuff we should log about. */
+
+                if ((st.st_mode & 0111) == 0) { /* not executable */
+                        log_debug("Ignoring '%s/%s', as it is not marked executable.", dirpath, name);
+                        return 0;
+                }
+
+        n = strdup(name);
+        if (!n)
+                return -ENOMEM;
+
+        if ((flags & CONF_FILES_BASENAME))
+                r = hashmap_ensure_put(files, &string_hash_ops_free, n, n);
+        else {
+                p = path_join(dirpath, name);
+                if (!p)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(files, &string_hash_ops_free_free, n, p);
+        }
+        if (r < 0)
+                return r;
+        assert(r > 0);
+
+        TAKE_PTR(n);
+        TAKE_PTR(p);
+
+        return 0;
+}
+
 static int files_add(
                 DIR *dir,
                 const char *dirpath,
@@ -41,84 +149,417 @@ static int files_add(
         assert(masked);
 
         FOREACH_DIRENT(de, dir, return -errno) {
-                _cleanup_free_ char *n = NULL, *p = NULL;
-                struct stat st;
+                r = files_add_one(files, masked, dirpath, dirfd(dir), de->d_name, /* cached_st= */ NULL, suffix, flags);
+                if (r < 0)
+                        return r;
+        }
 
-                /* Does this match the suffix? */
-                if (suffix && !endswith(de->d_name, suffix))
-                        continue;
+        return 0;
+}
 
-                /* Has this file already been found in an earlier directory? */
-                if (hashmap_contains(*files, de->d_name)) {
-                        log_debug("Skipping overridden file '%s/%s'.", dirpath, de->d_name);
-                        continue;
-                }
+/* An optional, per-thread cache of directory listings, for long-running daemons that look up the same
+ * configuration directories over and over again, e.g. PID1 for unit drop-ins. Every cached directory is
+ * watched through inotify, and so is its parent, in order to also notice the directory being created,
+ * removed or replaced. Pending inotify events are processed before every lookup, and since the kernel
+ * queues them before the modifying system call returns, a lookup always sees all changes that happened
+ * before it. Not noticed are changes to the targets of symlinks to directories, and mounts on top of
+ * cached directories, hence users should flush the cache with conf_files_cache_flush() whenever
+ * something like that might have happened, e.g. on reload. Entries that are symlinks themselves are
+ * stat()ed again on every lookup, so that changes to their targets are picked up. */
+
+#define CONF_FILES_CACHE_WATCH_MASK                                     \
+        (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF| \
+         IN_ATTRIB|IN_MODIFY|IN_ONLYDIR)
+
+typedef struct ConfFilesCacheEntry {
+        char *name;
+        struct stat st;
+        bool uncached_st;       /* symlink or stat() failed: stat() again on every lookup */
+} ConfFilesCacheEntry;
+
+typedef struct ConfFilesCacheWatch ConfFilesCacheWatch;
+
+typedef struct ConfFilesCacheDir {
+        char *key;              /* The root and directory as passed by the caller */
+        char *name;             /* The last component of the directory */
+        char *path;             /* The resolved directory, NULL if it does not exist */
+
+        ConfFilesCacheEntry *entries;
+        size_t n_entries;
+
+        ConfFilesCacheWatch *watch, *parent_watch;
+        LIST_FIELDS(struct ConfFilesCacheDir, dirs);
+        LIST_FIELDS(struct ConfFilesCacheDir, children);
+} ConfFilesCacheDir;
+
+struct ConfFilesCacheWatch {
+        int wd;
+        LIST_HEAD(ConfFilesCacheDir, dirs);     /* Listings of the watched directory itself */
+        LIST_HEAD(ConfFilesCacheDir, children); /* Listings of subdirectories, or their absence */
+};
+
+static thread_local Hashmap *conf_files_cache = NULL;
+static thread_local Hashmap *conf_files_cache_watches = NULL;
+static thread_local int conf_files_cache_fd = -EBADF;
+static thread_local pid_t conf_files_cache_pid = 0;
+
+static void conf_files_cache_watch_unref(ConfFilesCacheWatch *w) {
+        if (!w || w->dirs || w->children)
+                return;
+
+        assert_se(hashmap_remove(conf_files_cache_watches, INT_TO_PTR(w->wd)) == w);
+        free(w);
+}
 
-                /* Has this been masked in an earlier directory? */
-                if ((flags & CONF_FILES_FILTER_MASKED) && set_contains(*masked, de->d_name)) {
-                        log_debug("File '%s/%s' is masked by previous entry.", dirpath, de->d_name);
-                        continue;
-                }
+static ConfFilesCacheDir* conf_files_cache_dir_free(ConfFilesCacheDir *d) {
+        if (!d)
+                return NULL;
 
-                /* Read file metadata if we shall validate the check for file masks, for node types or whether the node is marked executable. */
-                if (flags & (CONF_FILES_FILTER_MASKED|CONF_FILES_REGULAR|CONF_FILES_DIRECTORY|CONF_FILES_EXECUTABLE))
-                        if (fstatat(dirfd(dir), de->d_name, &st, 0) < 0) {
-                                log_debug_errno(errno, "Failed to stat '%s/%s', ignoring: %m", dirpath, de->d_name);
-                                continue;
-                        }
+        if (d->watch) {
+                LIST_REMOVE(dirs, d->watch->dirs, d);
+                conf_files_cache_watch_unref(d->watch);
+        }
+        if (d->parent_watch) {
+                LIST_REMOVE(children, d->parent_watch->children, d);
+                conf_files_cache_watch_unref(d->parent_watch);
+        }
 
-                /* Is this a masking entry? */
-                if ((flags & CONF_FILES_FILTER_MASKED))
-                        if (null_or_empty(&st)) {
-                                /* Mark this one as masked */
-                                r = set_put_strdup(masked, de->d_name);
-                                if (r < 0)
-                                        return r;
+        FOREACH_ARRAY(e, d->entries, d->n_entries)
+                free(e->name);
+        free(d->entries);
 
-                                log_debug("File '%s/%s' is a mask.", dirpath, de->d_name);
-                                continue;
-                        }
+        free(d->key);
+        free(d->name);
+        free(d->path);
+        return mfree(d);
+}
 
-                /* Does this node have the right type? */
-                if (flags & (CONF_FILES_REGULAR|CONF_FILES_DIRECTORY))
-                        if (!((flags & CONF_FILES_DIRECTORY) && S_ISDIR(st.st_mode)) &&
-                            !((flags & CONF_FILES_REGULAR) && S_ISREG(st.st_mode))) {
-                                log_debug("Ignoring '%s/%s', as it does not have the right type.", dirpath, de->d_name);
-                                continue;
-                        }
+DEFINE_TRIVIAL_CLEANUP_FUNC(ConfFilesCacheDir*, conf_files_cache_dir_free);
 
-                /* Does this node have the executable bit set? */
-                if (flags & CONF_FILES_EXECUTABLE)
-                        /* As requested: check if the file is marked executable. Note that we don't check access(X_OK)
-                         * here, as we care about whether the file is marked executable at all, and not whether it is
-                         * executable for us, because if so, such errors are stuff we should log about. */
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                conf_files_cache_hash_ops,
+                char, string_hash_func, string_compare_func,
+                ConfFilesCacheDir, conf_files_cache_dir_free);
 
-                        if ((st.st_mode & 0111) == 0) { /* not executable */
-                                log_debug("Ignoring '%s/%s', as it is not marked executable.", dirpath, de->d_name);
-                                continue;
-                        }
+static int conf_files_cache_watch(const char *path, ConfFilesCacheWatch **ret) {
+        _cleanup_free_ ConfFilesCacheWatch *w = NULL;
+        int wd, r;
+
+        assert(path);
+        assert(ret);
+
+        /* Watching the same inode again returns the same watch descriptor */
+        wd = inotify_add_watch(conf_files_cache_fd, path, CONF_FILES_CACHE_WATCH_MASK);
+        if (wd < 0)
+                return -errno;
+
+        *ret = hashmap_get(conf_files_cache_watches, INT_TO_PTR(wd));
+        if (*ret)
+                return 0;
+
+        w = new(ConfFilesCacheWatch, 1);
+        if (!w)
+                return -ENOMEM;
+
+        *w = (ConfFilesCacheWatch) {
+                .wd = wd,
+        };
+
+        r = hashmap_ensure_put(&conf_files_cache_watches, &trivial_hash_ops, INT_TO_PTR(wd), w);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(w);
+        return 0;
+}
+
+static int conf_files_cache_read_dir(ConfFilesCacheDir *d, DIR *dir) {
+        assert(d);
+        assert(dir);
+
+        FOREACH_DIRENT(de, dir, return -errno) {
+                ConfFilesCacheEntry *e;
 
-                n = strdup(de->d_name);
-                if (!n)
+                if (!GREEDY_REALLOC(d->entries, d->n_entries + 1))
                         return -ENOMEM;
 
-                if ((flags & CONF_FILES_BASENAME))
-                        r = hashmap_ensure_put(files, &string_hash_ops_free, n, n);
-                else {
-                        p = path_join(dirpath, de->d_name);
-                        if (!p)
-                                return -ENOMEM;
+                e = d->entries + d->n_entries;
+                *e = (ConfFilesCacheEntry) {};
+
+                e->name = strdup(de->d_name);
+                if (!e->name)
+                        return -ENOMEM;
+
+                d->n_entries++;
+
+                if (fstatat(dirfd(dir), de->d_name, &e->st, AT_SYMLINK_NOFOLLOW) < 0 || S_ISLNK(e->st.st_mode))
+                        e->uncached_st = true;
+        }
+
+        return 0;
+}
+
+static int conf_files_cache_add(const char *key, const char *dir, const char *root, ConfFilesCacheDir **ret) {
+        _cleanup_(conf_files_cache_dir_freep) ConfFilesCacheDir *d = NULL;
+        _cleanup_free_ char *parent = NULL, *resolved_parent = NULL;
+        _cleanup_closedir_ DIR *dirp = NULL;
+        ConfFilesCacheWatch *w;
+        int r;
+
+        assert(key);
+        assert(dir);
+        assert(ret);
+
+        /* Returns 0 if the directory cannot be cached, in which case the caller should look at it directly.
+         * Relative paths are not cached, as the working directory might change. */
+
+        if (!path_is_absolute(dir))
+                return 0;
+
+        d = new0(ConfFilesCacheDir, 1);
+        if (!d)
+                return -ENOMEM;
+
+        d->key = strdup(key);
+        if (!d->key)
+                return -ENOMEM;
+
+        r = path_extract_filename(dir, &d->name);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                return 0;
+
+        r = path_extract_directory(dir, &parent);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                return 0;
+
+        /* Watch the parent first, and the directory itself before reading it, so that we never miss a
+         * change that happens while we are looking. */
+        r = chase(parent, root, CHASE_PREFIX_ROOT, &resolved_parent, /* ret_fd= */ NULL);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                return 0;
+
+        r = conf_files_cache_watch(resolved_parent, &w);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                return 0;
+
+        d->parent_watch = w;
+        LIST_PREPEND(children, w->children, d);
+
+        r = chase_and_opendir(dir, root, CHASE_PREFIX_ROOT, &d->path, &dirp);
+        if (r == -ENOENT)
+                d->path = mfree(d->path);
+        else if (r < 0)
+                return r == -ENOMEM ? r : 0;
+        else {
+                r = conf_files_cache_watch(d->path, &w);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0)
+                        return 0;
+
+                d->watch = w;
+                LIST_PREPEND(dirs, w->dirs, d);
+
+                r = conf_files_cache_read_dir(d, dirp);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0)
+                        return 0;
+        }
+
+        r = hashmap_ensure_put(&conf_files_cache, &conf_files_cache_hash_ops, d->key, d);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(d);
+        return 1;
+}
+
+static void conf_files_cache_invalidate(int wd, const char *name) {
+        for (;;) {
+                ConfFilesCacheWatch *w;
+                ConfFilesCacheDir *d;
+
+                /* Dropping the last listing referencing the watch frees it, hence look it up every time */
+                w = hashmap_get(conf_files_cache_watches, INT_TO_PTR(wd));
+                if (!w)
+                        return;
+
+                /* Any change in a directory invalidates its listing, but only changes of the entry for a
+                 * subdirectory, or of the directory itself (name == NULL), invalidate the subdirectory. */
+                d = w->dirs;
+                if (!d)
+                        LIST_FOREACH(children, c, w->children)
+                                if (!name || streq(c->name, name)) {
+                                        d = c;
+                                        break;
+                                }
+                if (!d)
+                        return;
+
+                conf_files_cache_dir_free(hashmap_remove(conf_files_cache, d->key));
+        }
+}
+
+static bool conf_files_cache_enabled(void) {
+        /* Forked off children share the inotify fd with us, hence must not consume its events */
+        return conf_files_cache_fd >= 0 && conf_files_cache_pid == getpid_cached();
+}
+
+static void conf_files_cache_clear(void) {
+        conf_files_cache = hashmap_free(conf_files_cache);
+        assert(hashmap_isempty(conf_files_cache_watches));
+        conf_files_cache_watches = hashmap_free(conf_files_cache_watches);
+
+        /* Dropping all watches at once is much cheaper than removing them one by one */
+        conf_files_cache_fd = safe_close(conf_files_cache_fd);
+}
+
+void conf_files_cache_flush(void) {
+        if (!conf_files_cache_enabled())
+                return;
+
+        conf_files_cache_clear();
+
+        conf_files_cache_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if (conf_files_cache_fd < 0)
+                log_debug_errno(errno, "Failed to allocate inotify fd, disabling configuration file cache: %m");
+}
+
+int conf_files_cache_set_enabled(bool b) {
+        if (conf_files_cache_enabled() == b)
+                return 0;
+
+        conf_files_cache_clear();
+        conf_files_cache_pid = 0;
+
+        if (!b)
+                return 0;
 
-                        r = hashmap_ensure_put(files, &string_hash_ops_free_free, n, p);
+        conf_files_cache_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if (conf_files_cache_fd < 0)
+                return -errno;
+
+        conf_files_cache_pid = getpid_cached();
+        return 1;
+}
+
+static void conf_files_cache_process_events(void) {
+        for (;;) {
+                union inotify_event_buffer buffer;
+                ssize_t l;
+
+                l = read(conf_files_cache_fd, &buffer, sizeof(buffer));
+                if (l < 0) {
+                        if (ERRNO_IS_TRANSIENT(errno))
+                                return;
+
+                        log_debug_errno(errno, "Failed to read inotify fd, flushing configuration file cache: %m");
+                        conf_files_cache_flush();
+                        return;
                 }
+
+                FOREACH_INOTIFY_EVENT(e, buffer, l) {
+                        if (FLAGS_SET(e->mask, IN_Q_OVERFLOW)) {
+                                conf_files_cache_flush();
+                                return;
+                        }
+
+                        conf_files_cache_invalidate(e->wd, e->len > 0 ? e->name : NULL);
+                }
+        }
+}
+
+static int files_add_cached(
+                ConfFilesCacheDir *d,
+                Hashmap **files,
+                Set **masked,
+                const char *suffix,
+                unsigned flags) {
+
+        _cleanup_close_ int dfd = -EBADF;
+        int r;
+
+        assert(d);
+
+        if (!d->path) /* The directory does not exist */
+                return 0;
+
+        FOREACH_ARRAY(e, d->entries, d->n_entries) {
+                if ((flags & CONF_FILES_NEED_STAT) && e->uncached_st && dfd < 0) {
+                        dfd = open(d->path, O_DIRECTORY|O_CLOEXEC|O_PATH);
+                        if (dfd < 0)
+                                return -errno;
+                }
+
+                r = files_add_one(files, masked, d->path, dfd, e->name, e->uncached_st ? NULL : &e->st, suffix, flags);
                 if (r < 0)
                         return r;
-                assert(r > 0);
+        }
+
+        return 0;
+}
+
+static int files_add_dir(
+                const char *dir,
+                const char *root,
+                Hashmap **files,
+                Set **masked,
+                const char *suffix,
+                unsigned flags) {
+
+        _cleanup_closedir_ DIR *dirp = NULL;
+        _cleanup_free_ char *path = NULL;
+        int r;
+
+        assert(dir);
+
+        if (conf_files_cache_enabled()) {
+                _cleanup_free_ char *key = NULL;
+                ConfFilesCacheDir *d;
 
-                TAKE_PTR(n);
-                TAKE_PTR(p);
+                key = path_join(empty_to_root(root), dir);
+                if (!key)
+                        return -ENOMEM;
+
+                d = hashmap_get(conf_files_cache, key);
+                if (!d) {
+                        r = conf_files_cache_add(key, dir, root, &d);
+                        if (r < 0)
+                                return r;
+                }
+
+                if (d) {
+                        r = files_add_cached(d, files, masked, suffix, flags);
+                        if (r == -ENOMEM)
+                                return r;
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to search for files in '%s', ignoring: %m", d->path);
+                        return 0;
+                }
+        }
+
+        r = chase_and_opendir(dir, root, CHASE_PREFIX_ROOT, &path, &dirp);
+        if (r < 0) {
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Failed to chase and open directory '%s', ignoring: %m", dir);
+                return 0;
         }
 
+        r = files_add(dirp, path, files, masked, suffix, flags);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                log_debug_errno(r, "Failed to search for files in '%s', ignoring: %m", path);
+
         return 0;
 }
 
@@ -162,22 +603,13 @@ int conf_files_list_strv(
 
         assert(ret);
 
-        STRV_FOREACH(p, dirs) {
-                _cleanup_closedir_ DIR *dir = NULL;
-                _cleanup_free_ char *path = NULL;
+        if (conf_files_cache_enabled())
+                conf_files_cache_process_events();
 
-                r = chase_and_opendir(*p, root, CHASE_PREFIX_ROOT, &path, &dir);
-                if (r < 0) {
-                        if (r != -ENOENT)
-                                log_debug_errno(r, "Failed to chase and open directory '%s', ignoring: %m", *p);
-                        continue;
-                }
-
-                r = files_add(dir, path, &fh, &masked, suffix, flags);
-                if (r == -ENOMEM)
-                        return r;
+        STRV_FOREACH(p, dirs) {
+                r = files_add_dir(*p, root, &fh, &masked, suffix, flags);
                 if (r < 0)
-                        log_debug_errno(r, "Failed to search for files in '%s', ignoring: %m", path);
+                        return r;
         }
 
         return copy_and_sort_files_from_hashmap(fh, ret);
@@ -13,6 +13,11 @@ enum {
         CONF_FILES_FILTER_MASKED = 1 << 4,
 };
 
+/* Opt-in, per-thread cache of directory listings for long-running programs, see conf-files.c. Only used by
+ * the path based lookups, not by the *_at() variants. */
+int conf_files_cache_set_enabled(bool b);
+void conf_files_cache_flush(void);
+
 int conf_files_list(char ***ret, const char *suffix, const char *root, unsigned flags, const char *dir);
 int conf_files_list_at(char ***ret, const char *suffix, int rfd, unsigned flags, const char *dir);
 int conf_files_list_strv(char ***ret, const char *suffix, const char *root, unsigned flags, const char* const* dirs);
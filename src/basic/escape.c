@@ -319,8 +319,14 @@ ssize_t cunescape_length_with_prefix(const char *s, size_t length, const char *p
                 assert(remaining > 0);
 
                 if (*f != '\\') {
-                        /* A literal, copy verbatim */
-                        *(t++) = *f;
+                        const char *e;
+                        size_t n;
+
+                        /* A run of literals, copy verbatim up to the next backslash */
+                        e = memchr(f, '\\', remaining);
+                        n = e ? (size_t) (e - f) : remaining;
+                        t = mempcpy(t, f, n);
+                        f += n - 1;
                         continue;
                 }
 
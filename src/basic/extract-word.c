@@ -17,6 +17,25 @@
 #include "strv.h"
 #include "utf8.h"
 
+static int append_run(char **s, size_t *sz, const char **p, const char *reject) {
+        size_t n;
+
+        /* Appends the run of characters at *p up to the first one in reject (or NUL) to the buffer */
+
+        n = strcspn(*p, reject);
+        if (n == 0)
+                return 0;
+
+        if (!GREEDY_REALLOC(*s, *sz + n + 1))
+                return -ENOMEM;
+
+        memcpy(*s + *sz, *p, n);
+        *sz += n;
+        *p += n;
+
+        return 0;
+}
+
 int extract_first_word(const char **p, char **ret, const char *separators, ExtractFlags flags) {
         _cleanup_free_ char *s = NULL;
         size_t sz = 0;
@@ -42,9 +61,19 @@ int extract_first_word(const char **p, char **ret, const char *separators, Extra
          * (because of an uneven number of quotes or similar), leaves
          * the pointer *p at the first invalid character. */
 
-        if (flags & EXTRACT_DONT_COALESCE_SEPARATORS)
+        /* The characters that end a run of ordinary characters outside of quotes. Such runs are found with
+         * strcspn(), which libc vectorizes, and copied in one go. */
+        const char *special = strjoina(separators,
+                                       flags & (EXTRACT_KEEP_QUOTE | EXTRACT_UNQUOTE) ? "'\"" : "",
+                                       flags & EXTRACT_RETAIN_ESCAPE ? "" : "\\");
+
+        if (flags & EXTRACT_DONT_COALESCE_SEPARATORS) {
                 if (!GREEDY_REALLOC(s, sz+1))
                         return -ENOMEM;
+        } else {
+                *p += strspn(*p, separators);
+                c = **p;
+        }
 
         for (;; (*p)++, c = **p) {
                 if (c == 0)
@@ -119,6 +148,11 @@ int extract_first_word(const char **p, char **ret, const char *separators, Extra
 
                 } else if (quote != 0) {     /* inside either single or double quotes */
                         for (;; (*p)++, c = **p) {
+                                r = append_run(&s, &sz, p, quote == '"' ? "\"\\" : "'\\");
+                                if (r < 0)
+                                        return r;
+                                c = **p;
+
                                 if (c == 0) {
                                         if (flags & EXTRACT_RELAX)
                                                 goto finish_force_terminate;
@@ -143,6 +177,11 @@ int extract_first_word(const char **p, char **ret, const char *separators, Extra
 
                 } else {
                         for (;; (*p)++, c = **p) {
+                                r = append_run(&s, &sz, p, special);
+                                if (r < 0)
+                                        return r;
+                                c = **p;
+
                                 if (c == 0)
                                         goto finish_force_terminate;
                                 else if (IN_SET(c, '\'', '"') && (flags & (EXTRACT_KEEP_QUOTE | EXTRACT_UNQUOTE))) {
@@ -158,14 +197,12 @@ int extract_first_word(const char **p, char **ret, const char *separators, Extra
                                                         (*p)++;
                                                 goto finish_force_next;
                                         }
-                                        if (!(flags & EXTRACT_RETAIN_SEPARATORS))
+                                        if (!(flags & EXTRACT_RETAIN_SEPARATORS)) {
                                                 /* Skip additional coalesced separators. */
-                                                for (;; (*p)++, c = **p) {
-                                                        if (c == 0)
-                                                                goto finish_force_terminate;
-                                                        if (!strchr(separators, c))
-                                                                break;
-                                                }
+                                                *p += strspn(*p, separators);
+                                                if (**p == 0)
+                                                        goto finish_force_terminate;
+                                        }
                                         goto finish;
 
                                 }
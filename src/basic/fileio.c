@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <stdio_ext.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -22,6 +23,8 @@
 #include "label.h"
 #include "log.h"
 #include "macro.h"
+#include "memory-util.h"
+#include "missing_threads.h"
 #include "mkdir.h"
 #include "nulstr-util.h"
 #include "parse-util.h"
@@ -49,6 +52,46 @@
  * can detect EOFs. */
 #define READ_VIRTUAL_BYTES_MAX (4U * U64_MB - UINT64_C(2))
 
+/* Regular files at least this large are mmap()ed by read_full_file_view() rather than copied */
+#define FILE_VIEW_MMAP_MIN (64U * U64_KB)
+
+/* Virtual files that report a zero size are read with a buffer sized after the last read of the same inode,
+ * to avoid a second, maximum size attempt for files that don't fit in a page. This is a small direct mapped
+ * table, collisions just evict each other. */
+#define VIRTUAL_FILE_SIZE_HINTS 16U
+
+typedef struct VirtualFileSizeHint {
+        dev_t dev;
+        ino_t ino;
+        size_t size;
+} VirtualFileSizeHint;
+
+static thread_local VirtualFileSizeHint virtual_file_size_hints[VIRTUAL_FILE_SIZE_HINTS] = {};
+
+static VirtualFileSizeHint* virtual_file_size_hint(const struct stat *st) {
+        assert(st);
+
+        return virtual_file_size_hints + (((uint64_t) st->st_dev * 31 + (uint64_t) st->st_ino) % VIRTUAL_FILE_SIZE_HINTS);
+}
+
+static size_t virtual_file_size_hint_get(const struct stat *st) {
+        VirtualFileSizeHint *h = virtual_file_size_hint(st);
+
+        if (h->dev != st->st_dev || h->ino != st->st_ino)
+                return 0;
+
+        /* Leave some room for growth, files such as /proc/self/mountinfo change size all the time */
+        return h->size + h->size / 4;
+}
+
+static void virtual_file_size_hint_set(const struct stat *st, size_t size) {
+        *virtual_file_size_hint(st) = (VirtualFileSizeHint) {
+                .dev = st->st_dev,
+                .ino = st->st_ino,
+                .size = size,
+        };
+}
+
 int fdopen_unlocked(int fd, const char *options, FILE **ret) {
         assert(ret);
 
@@ -478,7 +521,8 @@ int read_virtual_file_fd(int fd, size_t max_size, char **ret_contents, size_t *r
         _cleanup_free_ char *buf = NULL;
         size_t n, size;
         int n_retries;
-        bool truncated = false;
+        bool truncated = false, hinted = false;
+        struct stat st;
 
         /* Virtual filesystems such as sysfs or procfs use kernfs, and kernfs can work with two sorts of
          * virtual files. One sort uses "seq_file", and the results of the first read are buffered for the
@@ -500,8 +544,6 @@ int read_virtual_file_fd(int fd, size_t max_size, char **ret_contents, size_t *r
         n_retries = 3;
 
         for (;;) {
-                struct stat st;
-
                 if (fstat(fd, &st) < 0)
                         return -errno;
 
@@ -530,8 +572,10 @@ int read_virtual_file_fd(int fd, size_t max_size, char **ret_contents, size_t *r
                         n_retries--;
                 } else if (n_retries > 1) {
                         /* Files in /proc are generally smaller than the page size so let's start with
-                         * a page size buffer from malloc and only use the max buffer on the final try. */
-                        size = MIN3(page_size() - 1, READ_VIRTUAL_BYTES_MAX, max_size);
+                         * a page size buffer from malloc and only use the max buffer on the final try.
+                         * If we read the file before, start with what we needed last time. */
+                        size = MIN3(MAX(page_size() - 1, virtual_file_size_hint_get(&st)), READ_VIRTUAL_BYTES_MAX, max_size);
+                        hinted = true;
                         n_retries = 1;
                 } else {
                         size = MIN(READ_VIRTUAL_BYTES_MAX, max_size);
@@ -591,6 +635,9 @@ int read_virtual_file_fd(int fd, size_t max_size, char **ret_contents, size_t *r
                 buf = mfree(buf);
         }
 
+        if (hinted && !truncated)
+                virtual_file_size_hint_set(&st, n);
+
         if (ret_contents) {
 
                 /* Safety check: if the caller doesn't want to know the size of what we just read it will
@@ -857,6 +904,96 @@ int read_full_file_full(
         return read_full_stream_full(f, filename, offset, size, flags, ret_contents, ret_size);
 }
 
+void file_view_done(FileView *v) {
+        assert(v);
+
+        if (v->mapped > 0)
+                (void) munmap((void*) v->data, v->mapped);
+        else
+                free((char*) v->data);
+
+        *v = (FileView) {};
+}
+
+int read_full_file_view_at(int dir_fd, const char *filename, FileView *ret) {
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        char *buf;
+        struct stat st;
+        size_t size;
+        int r;
+
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+        assert(filename);
+        assert(ret);
+
+        /* Like read_full_file(), but returns a read-only view of the file contents: large regular files are
+         * mapped into memory instead of copied, everything else that fstat() reports a size for, or that
+         * we read before, is read with a single read() of the right size (see read_virtual_file_fd()). Note
+         * that mapped contents reflect later modifications of the file, and that its truncation results in
+         * SIGBUS when accessing the view, hence only use this for files that are replaced atomically or
+         * never change at all. */
+
+        fd = openat(dir_fd, filename, O_RDONLY|O_NOCTTY|O_CLOEXEC);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        /* Only map files that don't end on a page boundary, so that the zero filled remainder of the last
+         * page provides the trailing NUL byte */
+        if (S_ISREG(st.st_mode) &&
+            st.st_size >= (off_t) FILE_VIEW_MMAP_MIN &&
+            (uint64_t) st.st_size <= READ_FULL_BYTES_MAX &&
+            st.st_size % page_size() != 0) {
+                void *p;
+
+                p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                        *ret = (FileView) {
+                                .data = p,
+                                .size = st.st_size,
+                                .mapped = st.st_size,
+                        };
+                        return 0;
+                }
+
+                /* Not all file systems support mmap(), let's just read the file then */
+        }
+
+        if (S_ISREG(st.st_mode)) {
+                r = read_virtual_file_fd(fd, SIZE_MAX, &buf, &size);
+                if (r >= 0) {
+                        *ret = (FileView) {
+                                .data = buf,
+                                .size = size,
+                        };
+                        return 0;
+                }
+                if (r != -EFBIG)
+                        return r;
+
+                /* Too large to read in one go, use the usual growing buffer logic. */
+                if (lseek(fd, 0, SEEK_SET) < 0)
+                        return -errno;
+        }
+
+        r = take_fdopen_unlocked(&fd, "re", &f);
+        if (r < 0)
+                return r;
+
+        r = read_full_stream_full(f, filename, UINT64_MAX, SIZE_MAX, 0, &buf, &size);
+        if (r < 0)
+                return r;
+
+        *ret = (FileView) {
+                .data = buf,
+                .size = size,
+        };
+        return 0;
+}
+
 int script_get_shebang_interpreter(const char *path, char **ret) {
         _cleanup_fclose_ FILE *f = NULL;
         int r;
@@ -1486,8 +1623,7 @@ DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(FILE*, funlockfile, NULL);
 
 int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
         _cleanup_free_ char *buffer = NULL;
-        size_t n = 0, count = 0;
-        int r;
+        size_t n = 0, count = 0, allocated = 0;
 
         assert(f);
 
@@ -1518,6 +1654,8 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
         if (ret) {
                 if (!GREEDY_REALLOC(buffer, 1))
                         return -ENOMEM;
+
+                allocated = MALLOC_ELEMENTSOF(buffer);
         }
 
         {
@@ -1528,6 +1666,7 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
                 for (;;) {
                         EndOfLineMarker eol;
                         char c;
+                        int k;
 
                         if (n >= limit)
                                 return -ENOBUFS;
@@ -1535,11 +1674,17 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
                         if (count >= INT_MAX) /* We couldn't return the counter anymore as "int", hence refuse this */
                                 return -ENOBUFS;
 
-                        r = safe_fgetc(f, &c);
-                        if (r < 0)
-                                return r;
-                        if (r == 0) /* EOF is definitely EOL */
-                                break;
+                        /* We hold the stream lock anyway, hence skip the locking fgetc() would do for each
+                         * character. Otherwise the same as safe_fgetc(). */
+                        errno = 0;
+                        k = getc_unlocked(f);
+                        if (k == EOF) {
+                                if (ferror_unlocked(f))
+                                        return errno_or_else(EIO);
+
+                                break; /* EOF is definitely EOL */
+                        }
+                        c = k;
 
                         eol = categorize_eol(c, flags);
 
@@ -1588,8 +1733,13 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
                         }
 
                         if (ret) {
-                                if (!GREEDY_REALLOC(buffer, n + 2))
-                                        return -ENOMEM;
+                                /* Only go through the allocator when the buffer is actually full */
+                                if (n + 2 > allocated) {
+                                        if (!GREEDY_REALLOC(buffer, n + 2))
+                                                return -ENOMEM;
+
+                                        allocated = MALLOC_ELEMENTSOF(buffer);
+                                }
 
                                 buffer[n] = c;
                         }
@@ -1607,13 +1757,13 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
         return (int) count;
 }
 
-int read_stripped_line(FILE *f, size_t limit, char **ret) {
+int read_stripped_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
         _cleanup_free_ char *s = NULL;
         int r, k;
 
         assert(f);
 
-        r = read_line(f, limit, ret ? &s : NULL);
+        r = read_line_full(f, limit, flags, ret ? &s : NULL);
         if (r < 0)
                 return r;
 
@@ -75,6 +75,21 @@ static inline int read_full_file(const char *filename, char **ret_contents, size
         return read_full_file_full(AT_FDCWD, filename, UINT64_MAX, SIZE_MAX, 0, NULL, ret_contents, ret_size);
 }
 
+/* A read-only view of the contents of a file, as returned by read_full_file_view(). The data is always
+ * followed by a NUL byte, that is not included in the size. */
+typedef struct FileView {
+        const char *data;
+        size_t size;
+        size_t mapped; /* if non-zero, the data is mmap()ed, and this is the size of the mapping */
+} FileView;
+
+void file_view_done(FileView *v);
+
+int read_full_file_view_at(int dir_fd, const char *filename, FileView *ret);
+static inline int read_full_file_view(const char *filename, FileView *ret) {
+        return read_full_file_view_at(AT_FDCWD, filename, ret);
+}
+
 int read_virtual_file_fd(int fd, size_t max_size, char **ret_contents, size_t *ret_size);
 int read_virtual_file_at(int dir_fd, const char *filename, size_t max_size, char **ret_contents, size_t *ret_size);
 static inline int read_virtual_file(const char *filename, size_t max_size, char **ret_contents, size_t *ret_size) {
@@ -155,7 +170,10 @@ static inline int read_nul_string(FILE *f, size_t limit, char **ret) {
         return read_line_full(f, limit, READ_LINE_ONLY_NUL, ret);
 }
 
-int read_stripped_line(FILE *f, size_t limit, char **ret);
+int read_stripped_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret);
+static inline int read_stripped_line(FILE *f, size_t limit, char **ret) {
+        return read_stripped_line_full(f, limit, 0, ret);
+}
 
 static inline bool file_offset_beyond_memory_size(off_t x) {
         if (x < 0) /* off_t is signed, filter that out */
@@ -5,6 +5,7 @@
 #include "hash-funcs.h"
 #include "path-util.h"
 #include "strv.h"
+#include "wyhash.h"
 
 void string_hash_func(const char *p, struct siphash *state) {
         siphash24_compress(p, strlen(p) + 1, state);
@@ -20,6 +21,24 @@ DEFINE_HASH_OPS_FULL(string_hash_ops_free_strv_free,
                      char, string_hash_func, string_compare_func, free,
                      char*, strv_free);
 
+uint64_t trusted_string_hash_func(const char *p, uint64_t seed) {
+        return wyhash_string(p, seed);
+}
+
+const struct hash_ops trusted_string_hash_ops = {
+        .hash = (hash_func_t) string_hash_func,
+        .trusted_hash = (trusted_hash_func_t) trusted_string_hash_func,
+        .compare = (compare_func_t) string_compare_func,
+};
+
+const struct hash_ops trusted_string_hash_ops_free_free = {
+        .hash = (hash_func_t) string_hash_func,
+        .trusted_hash = (trusted_hash_func_t) trusted_string_hash_func,
+        .compare = (compare_func_t) string_compare_func,
+        .free_key = free,
+        .free_value = free,
+};
+
 void path_hash_func(const char *q, struct siphash *state) {
         bool add_slash = false;
 
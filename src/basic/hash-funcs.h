@@ -6,10 +6,14 @@
 #include "siphash24.h"
 
 typedef void (*hash_func_t)(const void *p, struct siphash *state);
+typedef uint64_t (*trusted_hash_func_t)(const void *p, uint64_t seed);
 typedef int (*compare_func_t)(const void *a, const void *b);
 
 struct hash_ops {
         hash_func_t hash;
+        /* If set, used instead of .hash. Meant for a fast, non-cryptographic hash function, which makes
+         * hash flooding trivial. Hence only for tables whose keys never come from untrusted sources. */
+        trusted_hash_func_t trusted_hash;
         compare_func_t compare;
         free_func_t free_key;
         free_func_t free_value;
@@ -80,6 +84,12 @@ extern const struct hash_ops string_hash_ops_free;
 extern const struct hash_ops string_hash_ops_free_free;
 extern const struct hash_ops string_hash_ops_free_strv_free;
 
+/* Same as string_hash_ops, but hashes with wyhash() instead of siphash24(). Only use these for tables whose
+ * keys never come from untrusted sources, e.g. unit file names found on disk. */
+uint64_t trusted_string_hash_func(const char *p, uint64_t seed);
+extern const struct hash_ops trusted_string_hash_ops;
+extern const struct hash_ops trusted_string_hash_ops_free_free;
+
 void path_hash_func(const char *p, struct siphash *state);
 extern const struct hash_ops path_hash_ops;
 extern const struct hash_ops path_hash_ops_free;
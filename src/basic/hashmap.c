@@ -24,6 +24,7 @@
 #include "sort-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "unaligned.h"
 
 #if ENABLE_DEBUG_HASHMAP
 #include "list.h"
@@ -345,6 +346,12 @@ static unsigned base_bucket_hash(HashmapBase *h, const void *p) {
         struct siphash state;
         uint64_t hash;
 
+        if (h->hash_ops->trusted_hash) {
+                /* The hash key still changes on every resize, so that clusters don't survive it */
+                hash = h->hash_ops->trusted_hash(p, unaligned_read_ne64(hash_key(h)));
+                return (unsigned) (hash % n_buckets(h));
+        }
+
         siphash24_init(&state, hash_key(h));
 
         h->hash_ops->hash(p, &state);
@@ -1224,6 +1231,79 @@ static int resize_buckets(HashmapBase *h, unsigned entries_add) {
         return 1;
 }
 
+/* Long probe runs are scanned in groups of this many buckets, packed into one 64-bit word. Most lookups end
+ * within the first couple of buckets though, and for those the plain loop is faster, hence only switch over
+ * once the run turned out to be longer than DIB_GROUP_SCAN_MIN. */
+#define DIB_GROUP_SIZE 8U
+#define DIB_GROUP_SCAN_MIN 3U
+
+#define DIB_GROUP_LANES(c) (UINT64_C(0x0101010101010101) * (uint8_t) (c))
+#define DIB_GROUP_HIGH     DIB_GROUP_LANES(0x80)
+#define DIB_GROUP_LOW      DIB_GROUP_LANES(0x7f)
+
+/* Returns a word with the high bit set in every lane where a < b (unsigned). Exact, i.e. no borrows between
+ * lanes: the lower seven bits are compared with the high bit of a forced on, and the high bits are
+ * combined separately. */
+static uint64_t dib_group_less(uint64_t a, uint64_t b) {
+        uint64_t d = (a | DIB_GROUP_HIGH) - (b & DIB_GROUP_LOW);
+
+        return ((~a & b) | (~(a ^ b) & ~d)) & DIB_GROUP_HIGH;
+}
+
+/* Returns a word with the high bit set in every lane that is zero */
+static uint64_t dib_group_zero(uint64_t a) {
+        return ~(((a & DIB_GROUP_LOW) + DIB_GROUP_LOW) | a | DIB_GROUP_LOW);
+}
+
+/*
+ * Scans the group of DIB_GROUP_SIZE buckets starting at idx, all at once. Since the probe distance grows by
+ * one per bucket, lane i is expected to hold distance + i for an entry with the same optimal bucket as the
+ * key, and a smaller value (or a free bucket) ends the scan, exactly as in the bucket by bucket loop below.
+ * Overflowed DIBs are left to that loop, they need the hash to be recomputed.
+ * Returns: index of the found entry, or IDX_NIL if not found, and sets *ret_n to the number of buckets
+ *          covered: DIB_GROUP_SIZE if the scan has to continue after the group, less than that if the scan
+ *          has to continue one bucket at a time from some lane in it, or UINT_MAX if the key is not there.
+ */
+static unsigned base_bucket_scan_group(HashmapBase *h, unsigned idx, unsigned distance, const void *key,
+                                       unsigned *ret_n) {
+        uint64_t dibs, expected, match, stop;
+        unsigned n = DIB_GROUP_SIZE;
+
+        assert(idx + DIB_GROUP_SIZE <= n_buckets(h));
+        assert(distance + DIB_GROUP_SIZE <= DIB_RAW_OVERFLOW);
+
+        /* Lane i is the byte at idx + i, i.e. lane 0 is the least significant one */
+        dibs = unaligned_read_le64(dib_raw_ptr(h) + idx);
+        expected = DIB_GROUP_LANES(distance) + UINT64_C(0x0706050403020100);
+
+        match = dib_group_zero(dibs ^ expected);
+        stop = dib_group_less(dibs, expected) |
+                dib_group_less(DIB_GROUP_LANES(DIB_RAW_OVERFLOW - 1), dibs);
+
+        if (stop != 0) {
+                unsigned s = __builtin_ctzll(stop) / 8;
+
+                /* Candidates beyond the first lane that ends the scan are other entries' */
+                match &= (UINT64_C(1) << (s * 8)) - 1;
+
+                /* A free bucket or a wealthier entry means the key isn't stored anywhere after this, an
+                 * overflowed DIB needs to be looked at more closely */
+                n = IN_SET(dib_raw_ptr(h)[idx + s], DIB_RAW_OVERFLOW, DIB_RAW_REHASH) ? s : UINT_MAX;
+        }
+
+        for (; match != 0; match &= match - 1) {
+                unsigned i = idx + __builtin_ctzll(match) / 8;
+
+                if (h->hash_ops->compare(bucket_at(h, i)->key, key) == 0) {
+                        *ret_n = 0;
+                        return i;
+                }
+        }
+
+        *ret_n = n;
+        return IDX_NIL;
+}
+
 /*
  * Finds an entry with a matching key
  * Returns: index of the found entry, or IDX_NIL if not found.
@@ -1236,6 +1316,24 @@ static unsigned base_bucket_scan(HashmapBase *h, unsigned idx, const void *key)
         assert(idx < n_buckets(h));
 
         for (distance = 0; ; distance++) {
+                /* Scan in groups while they don't wrap around and can't hit an overflowed DIB */
+                while (distance >= DIB_GROUP_SCAN_MIN &&
+                       idx + DIB_GROUP_SIZE <= n_buckets(h) &&
+                       distance + DIB_GROUP_SIZE <= DIB_RAW_OVERFLOW) {
+                        unsigned found, n;
+
+                        found = base_bucket_scan_group(h, idx, distance, key, &n);
+                        if (found != IDX_NIL || n == UINT_MAX)
+                                return found;
+
+                        idx += n;
+                        distance += n;
+                        if (n < DIB_GROUP_SIZE)
+                                break;
+                }
+
+                idx %= n_buckets(h);
+
                 if (dibs[idx] == DIB_RAW_FREE)
                         return IDX_NIL;
 
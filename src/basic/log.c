@@ -4,8 +4,10 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <sys/eventfd.h>
 #include <sys/signalfd.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -30,6 +32,7 @@
 #include "parse-util.h"
 #include "proc-cmdline.h"
 #include "process-util.h"
+#include "pthread-util.h"
 #include "ratelimit.h"
 #include "signal-util.h"
 #include "socket-util.h"
@@ -283,6 +286,438 @@ bool stderr_is_journal(void) {
         return st.st_dev == dev && st.st_ino == ino;
 }
 
+/* Asynchronous logging. If enabled via log_set_async(), messages for the journal and kmsg are not written by
+ * the logging thread itself. Instead the fully formatted datagram is copied into a ring buffer private to
+ * the logging thread, and a background thread drains all rings, batching datagrams to the journal with
+ * sendmmsg(). Every ring has exactly one producer (the thread owning it) and one consumer (the flusher,
+ * which holds log_async_mutex while draining), hence logging threads never take a lock and never block
+ * on the log sink. If a ring is full the message is dropped, and the flusher reports the number of lost
+ * messages. The console is always written to synchronously, and so are messages of LOG_CRIT and higher.
+ * Those are written with log_async_mutex held, after the rings have been drained, so that they are neither
+ * reordered with earlier messages nor interleaved with a concurrent pass of the flusher. */
+
+#define LOG_RING_SIZE (128U * 1024U)
+#define LOG_RECORD_MAX (LOG_RING_SIZE / 4U)
+#define LOG_ASYNC_FLUSH_USEC (10 * USEC_PER_MSEC)
+#define LOG_ASYNC_BATCH_MAX 64U
+
+typedef enum LogAsyncType {
+        LOG_ASYNC_JOURNAL,
+        LOG_ASYNC_KMSG,
+} LogAsyncType;
+
+typedef struct LogRecordHeader {
+        uint32_t size;
+        uint32_t type;
+} LogRecordHeader;
+
+typedef struct LogRing {
+        /* Free-running byte counters, the offset into data[] is the counter modulo LOG_RING_SIZE */
+        uint64_t head;          /* Only written by the owning thread */
+        uint64_t tail;          /* Only written by the flusher */
+        uint64_t n_dropped;
+        bool orphaned;          /* The owning thread exited, the ring is freed once drained */
+        LIST_FIELDS(struct LogRing, rings);
+        uint8_t data[LOG_RING_SIZE];
+} LogRing;
+
+static pthread_mutex_t log_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(LogRing, log_rings) = NULL;
+static pthread_key_t log_ring_key;
+static bool log_ring_key_initialized = false;
+static thread_local LogRing *log_ring = NULL;
+static thread_local bool log_async_is_flusher = false;
+static thread_local bool log_async_locked = false;
+static bool log_async = false;
+static bool log_async_idle = false;
+static pid_t log_async_pid = 0;
+static pthread_t log_async_thread;
+static int log_async_fd = -EBADF;
+static uint64_t log_async_n_dropped = 0, log_async_n_reported = 0;
+
+static void log_async_wake(void) {
+        (void) eventfd_write(log_async_fd, 1);
+}
+
+static bool log_async_drain(void);
+
+static void log_ring_release(void *p) {
+        LogRing *r = p;
+
+        /* Called on thread exit. Other TLS destructors might still log after us, they'll get a new ring. */
+        log_ring = NULL;
+        __atomic_store_n(&r->orphaned, true, __ATOMIC_SEQ_CST);
+
+        /* In a forked off child that didn't call log_set_async() yet the mutex might be taken by the
+         * parent's flusher, and the ring isn't ours to free. Otherwise write out what is left and free the
+         * ring right away, instead of relying on the flusher, which isn't running if async logging has been
+         * turned off in the meantime. */
+        if (log_async_locked || (log_async_pid != 0 && log_async_pid != getpid_cached())) {
+                log_async_wake();
+                return;
+        }
+
+        (void) pthread_mutex_lock(&log_async_mutex);
+        (void) log_async_drain();
+        (void) pthread_mutex_unlock(&log_async_mutex);
+}
+
+static LogRing* log_ring_get(void) {
+        LogRing *r;
+
+        if (log_ring)
+                return log_ring;
+
+        r = new0(LogRing, 1);
+        if (!r)
+                return NULL;
+
+        if (pthread_setspecific(log_ring_key, r) != 0)
+                return mfree(r);
+
+        /* Only taken once per thread, when it logs for the first time */
+        (void) pthread_mutex_lock(&log_async_mutex);
+        LIST_PREPEND(rings, log_rings, r);
+        (void) pthread_mutex_unlock(&log_async_mutex);
+
+        return (log_ring = r);
+}
+
+static void log_ring_write(LogRing *r, uint64_t pos, const void *p, size_t n) {
+        size_t o = pos % LOG_RING_SIZE, k = MIN(n, LOG_RING_SIZE - o);
+
+        memcpy(r->data + o, p, k);
+        memcpy(r->data, (const uint8_t*) p + k, n - k);
+}
+
+static void log_ring_read(const LogRing *r, uint64_t pos, void *p, size_t n) {
+        size_t o = pos % LOG_RING_SIZE, k = MIN(n, LOG_RING_SIZE - o);
+
+        memcpy(p, r->data + o, k);
+        memcpy((uint8_t*) p + k, r->data, n - k);
+}
+
+static size_t log_ring_iovec(LogRing *r, uint64_t pos, size_t n, struct iovec iovec[static 2]) {
+        size_t o = pos % LOG_RING_SIZE, k = MIN(n, LOG_RING_SIZE - o);
+
+        /* A record that wraps around the end of the ring is described by two iovecs */
+        iovec[0] = IOVEC_MAKE(r->data + o, k);
+        if (k == n)
+                return 1;
+
+        iovec[1] = IOVEC_MAKE(r->data, n - k);
+        return 2;
+}
+
+static void log_async_send_journal(struct mmsghdr *msgs, size_t *n_msgs) {
+        for (size_t i = 0; i < *n_msgs;) {
+                int k;
+
+                if (journal_fd < 0) {
+                        log_async_n_dropped += *n_msgs - i;
+                        break;
+                }
+
+                k = sendmmsg(journal_fd, msgs + i, *n_msgs - i, MSG_NOSIGNAL);
+                if (k <= 0) {
+                        /* Skip over the datagram that failed, and continue with the rest */
+                        log_async_n_dropped++;
+                        i++;
+                } else
+                        i += k;
+        }
+
+        *n_msgs = 0;
+}
+
+static bool log_async_drain(void) {
+        struct mmsghdr msgs[LOG_ASYNC_BATCH_MAX];
+        struct iovec iovecs[LOG_ASYNC_BATCH_MAX * 2];
+        size_t n_msgs = 0;
+        bool drained = false;
+
+        /* Writes out everything queued in all rings. Must be called with log_async_mutex held. This runs in
+         * the middle of logging, hence must not log or assert itself. */
+
+        LIST_FOREACH(rings, r, log_rings) {
+                uint64_t head, tail = r->tail;
+                bool orphaned;
+
+                /* Read the flag first, so that if it is set we know we see everything the thread queued */
+                orphaned = __atomic_load_n(&r->orphaned, __ATOMIC_SEQ_CST);
+                head = __atomic_load_n(&r->head, __ATOMIC_SEQ_CST);
+
+                log_async_n_dropped += __atomic_exchange_n(&r->n_dropped, 0, __ATOMIC_RELAXED);
+
+                while (tail < head) {
+                        LogRecordHeader h;
+
+                        log_ring_read(r, tail, &h, sizeof(h));
+                        tail += sizeof(h);
+
+                        if (h.type == LOG_ASYNC_JOURNAL) {
+                                struct iovec *iovec = iovecs + n_msgs * 2;
+
+                                msgs[n_msgs++] = (struct mmsghdr) {
+                                        .msg_hdr.msg_iov = iovec,
+                                        .msg_hdr.msg_iovlen = log_ring_iovec(r, tail, h.size, iovec),
+                                };
+
+                                if (n_msgs >= LOG_ASYNC_BATCH_MAX)
+                                        log_async_send_journal(msgs, &n_msgs);
+                        } else {
+                                struct iovec iovec[2];
+                                size_t n;
+
+                                /* kmsg takes one record per write(), but keep the order */
+                                log_async_send_journal(msgs, &n_msgs);
+
+                                n = log_ring_iovec(r, tail, h.size, iovec);
+                                if (kmsg_fd < 0 || writev(kmsg_fd, iovec, n) < 0)
+                                        log_async_n_dropped++;
+                        }
+
+                        tail += h.size;
+                        drained = true;
+                }
+
+                /* The producer may only reuse the space once the datagrams referencing it went out */
+                log_async_send_journal(msgs, &n_msgs);
+                __atomic_store_n(&r->tail, tail, __ATOMIC_SEQ_CST);
+
+                if (orphaned) {
+                        LIST_REMOVE(rings, log_rings, r);
+                        free(r);
+                }
+        }
+
+        return drained;
+}
+
+static bool log_async_pending(void) {
+        /* Must be called with log_async_mutex held */
+
+        LIST_FOREACH(rings, r, log_rings)
+                if (__atomic_load_n(&r->head, __ATOMIC_SEQ_CST) != r->tail ||
+                    __atomic_load_n(&r->orphaned, __ATOMIC_SEQ_CST))
+                        return true;
+
+        return false;
+}
+
+static bool log_async_drain_and_report(void) {
+        uint64_t n;
+        bool drained;
+
+        (void) pthread_mutex_lock(&log_async_mutex);
+        drained = log_async_drain();
+        n = log_async_n_dropped - log_async_n_reported;
+        log_async_n_reported = log_async_n_dropped;
+        (void) pthread_mutex_unlock(&log_async_mutex);
+
+        /* Never called by a thread queueing messages itself, hence this is written out synchronously */
+        if (n > 0)
+                log_warning("Dropped %" PRIu64 " log messages, as the logging buffers were full or writing them out failed.", n);
+
+        return drained;
+}
+
+static void* log_async_thread_main(void *p) {
+        struct pollfd pollfd = {
+                .fd = log_async_fd,
+                .events = POLLIN,
+        };
+
+        log_async_is_flusher = true;
+
+        while (__atomic_load_n(&log_async, __ATOMIC_SEQ_CST)) {
+                bool pending;
+
+                if (log_async_drain_and_report()) {
+                        /* Give the logging threads some time to fill up their rings, so that we can batch */
+                        (void) poll(&pollfd, 1, LOG_ASYNC_FLUSH_USEC / USEC_PER_MSEC);
+                        (void) eventfd_read(log_async_fd, &(eventfd_t) { 0 });
+                        continue;
+                }
+
+                /* Nothing to do. Sleep until the next thread queues something into an empty ring. Check once
+                 * more after announcing that, so that we don't miss a message queued in between. */
+                __atomic_store_n(&log_async_idle, true, __ATOMIC_SEQ_CST);
+
+                (void) pthread_mutex_lock(&log_async_mutex);
+                pending = log_async_pending();
+                (void) pthread_mutex_unlock(&log_async_mutex);
+
+                if (!pending)
+                        (void) poll(&pollfd, 1, -1);
+
+                __atomic_store_n(&log_async_idle, false, __ATOMIC_SEQ_CST);
+                (void) eventfd_read(log_async_fd, &(eventfd_t) { 0 });
+        }
+
+        return NULL;
+}
+
+static void log_async_forget(void) {
+        /* We got forked off: the flusher does not exist here, and the rings belong to the parent's threads.
+         * The mutex might have been taken by the flusher at the time of the fork, hence reinitialize it. */
+        log_async = false;
+        log_async_pid = 0;
+        log_async_mutex = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+        log_rings = NULL;
+        log_ring = NULL;
+        log_async_fd = safe_close(log_async_fd);
+}
+
+static pthread_mutex_t* log_async_lock(void) {
+        /* Serializes changes to the log fds and synchronous writes to them with the flusher, which writes to
+         * them too. Also writes out everything queued so far, as it was meant for the fds open right now.
+         * Returns NULL if async logging is off, or if the calling thread holds the lock already, because it
+         * logs while changing the fds. */
+
+        if (!__atomic_load_n(&log_async, __ATOMIC_SEQ_CST) || log_async_is_flusher || log_async_locked ||
+            log_async_pid != getpid_cached())
+                return NULL;
+
+        pthread_mutex_t *m = pthread_mutex_lock_assert(&log_async_mutex);
+        log_async_locked = true;
+        (void) log_async_drain();
+        return m;
+}
+
+static void log_async_unlockp(pthread_mutex_t **m) {
+        if (!*m)
+                return;
+
+        log_async_locked = false;
+        pthread_mutex_unlock_assertp(m);
+}
+
+static int log_async_queue(
+                int level,
+                LogAsyncType type,
+                const struct iovec *iovec,
+                size_t n,
+                pthread_mutex_t **ret_lock) {
+
+        uint64_t head, used;
+        LogRing *r;
+        size_t size;
+
+        /* Returns 0 if the message should be written synchronously, 1 if it has been taken care of. In the
+         * former case *ret_lock is set to log_async_mutex if async logging is on, and the caller has to
+         * keep it locked until the message has been written and release it with log_async_unlockp(). */
+
+        *ret_lock = NULL;
+
+        /* If we hold the lock already, we are logging while changing the fds: write out synchronously */
+        if (!__atomic_load_n(&log_async, __ATOMIC_SEQ_CST) || log_async_is_flusher || log_async_locked ||
+            open_when_needed)
+                return 0;
+        if (log_async_pid != getpid_cached())
+                return 0;
+
+        size = iovec_total_size(iovec, n);
+
+        if (LOG_PRI(level) <= LOG_CRIT || size > LOG_RECORD_MAX) {
+                *ret_lock = log_async_lock();
+                return 0;
+        }
+
+        r = log_ring_get();
+        if (!r) {
+                *ret_lock = log_async_lock();
+                return 0;
+        }
+
+        head = r->head;
+        used = head - __atomic_load_n(&r->tail, __ATOMIC_SEQ_CST);
+        if (LOG_RING_SIZE - used < sizeof(LogRecordHeader) + size) {
+                __atomic_fetch_add(&r->n_dropped, 1, __ATOMIC_RELAXED);
+                log_async_wake();
+                return 1;
+        }
+
+        log_ring_write(r, head, &(LogRecordHeader) { .size = size, .type = type }, sizeof(LogRecordHeader));
+        head += sizeof(LogRecordHeader);
+
+        FOREACH_ARRAY(i, iovec, n) {
+                log_ring_write(r, head, i->iov_base, i->iov_len);
+                head += i->iov_len;
+        }
+
+        __atomic_store_n(&r->head, head, __ATOMIC_SEQ_CST);
+
+        /* Wake the flusher if it is sleeping, or if the ring is filling up faster than it is drained */
+        if (__atomic_exchange_n(&log_async_idle, false, __ATOMIC_SEQ_CST) ||
+            used + sizeof(LogRecordHeader) + size > LOG_RING_SIZE / 2)
+                log_async_wake();
+
+        return 1;
+}
+
+int log_set_async(bool b) {
+        sigset_t ss, saved_ss;
+        int r;
+
+        /* Do not call from library code. */
+
+        if (log_async_pid != 0 && log_async_pid != getpid_cached())
+                log_async_forget();
+
+        if (b == (log_async_pid != 0))
+                return 0;
+
+        if (!b) {
+                __atomic_store_n(&log_async, false, __ATOMIC_SEQ_CST);
+                log_async_wake();
+                (void) pthread_join(log_async_thread, NULL);
+
+                log_async_fd = safe_close(log_async_fd);
+                log_async_pid = 0;
+
+                /* Write out whatever got queued after the last pass of the flusher */
+                (void) log_async_drain_and_report();
+                return 0;
+        }
+
+        if (!log_ring_key_initialized) {
+                r = pthread_key_create(&log_ring_key, log_ring_release);
+                if (r != 0)
+                        return -r;
+
+                log_ring_key_initialized = true;
+        }
+
+        log_async_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if (log_async_fd < 0)
+                return -errno;
+
+        log_async_pid = getpid_cached();
+        __atomic_store_n(&log_async, true, __ATOMIC_SEQ_CST);
+
+        /* The flusher should never get any signals, leave them to the threads that expect them */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_SETMASK, &ss, &saved_ss);
+        if (r == 0) {
+                r = pthread_create(&log_async_thread, NULL, log_async_thread_main, NULL);
+                (void) pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        }
+        if (r != 0) {
+                __atomic_store_n(&log_async, false, __ATOMIC_SEQ_CST);
+                log_async_pid = 0;
+                log_async_fd = safe_close(log_async_fd);
+                (void) log_async_drain_and_report();
+                return -r;
+        }
+
+        return 1;
+}
+
+_destructor_ static void log_async_shutdown(void) {
+        (void) log_set_async(false);
+}
+
 int log_open(void) {
         int r;
 
@@ -293,6 +728,8 @@ int log_open(void) {
          * reference an error that happened immediately before the log_open() call. */
         PROTECT_ERRNO;
 
+        _cleanup_(log_async_unlockp) pthread_mutex_t *_l = log_async_lock();
+
         /* If we don't use the console, we close it here to not get killed by SAK. If we don't use syslog, we
          * close it here too, so that we are not confused by somebody deleting the socket in the fs, and to
          * make sure we don't use it if prohibit_ipc is set. If we don't use /dev/kmsg we still keep it open,
@@ -383,6 +820,8 @@ void log_set_target_and_open(LogTarget target) {
 void log_close(void) {
         /* Do not call from library code. */
 
+        _cleanup_(log_async_unlockp) pthread_mutex_t *_l = log_async_lock();
+
         log_close_journal();
         log_close_syslog();
         log_close_kmsg();
@@ -637,6 +1076,10 @@ static int write_to_kmsg(
                 IOVEC_MAKE_STRING("\n"),
         };
 
+        _cleanup_(log_async_unlockp) pthread_mutex_t *_l = NULL;
+        if (log_async_queue(level, LOG_ASYNC_KMSG, iovec, ELEMENTSOF(iovec), &_l) > 0)
+                return 1;
+
         if (writev(kmsg_fd, iovec, ELEMENTSOF(iovec)) < 0)
                 return -errno;
 
@@ -768,6 +1211,10 @@ static int write_to_journal(
                 .msg_iovlen = n,
         };
 
+        _cleanup_(log_async_unlockp) pthread_mutex_t *_l = NULL;
+        if (log_async_queue(level, LOG_ASYNC_JOURNAL, iovec, n, &_l) > 0)
+                return 1;
+
         if (sendmsg(journal_fd, &msghdr, MSG_NOSIGNAL) < 0)
                 return -errno;
 
@@ -1449,6 +1896,14 @@ void log_parse_environment_variables(void) {
         e = getenv("SYSTEMD_LOG_RATELIMIT_KMSG");
         if (e && log_set_ratelimit_kmsg_from_string(e) < 0)
                 log_warning("Failed to parse log ratelimit kmsg boolean '%s', ignoring.", e);
+
+        r = getenv_bool("SYSTEMD_LOG_ASYNC");
+        if (r >= 0) {
+                r = log_set_async(r);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to enable asynchronous logging, ignoring: %m");
+        } else if (r != -ENXIO)
+                log_warning_errno(r, "Failed to parse $SYSTEMD_LOG_ASYNC value, ignoring: %m");
 }
 
 void log_parse_environment(void) {
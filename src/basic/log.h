@@ -334,6 +334,12 @@ void log_set_open_when_needed(bool b);
  * stderr, the console or kmsg */
 void log_set_prohibit_ipc(bool b);
 
+/* If turned on, messages to the journal and kmsg are queued in per-thread buffers and written out in
+ * batches by a background thread, instead of by the logging thread itself. Messages are dropped (and
+ * the number of dropped messages logged) if a thread's buffer is full. Messages of LOG_CRIT and higher
+ * and messages to the console are still written synchronously. */
+int log_set_async(bool b);
+
 void log_set_assert_return_is_critical(bool b);
 bool log_get_assert_return_is_critical(void) _pure_;
 
@@ -518,6 +518,29 @@ static inline int missing_mount_setattr(
 
 /* ======================================================================= */
 
+#if !HAVE_OPENAT2
+
+#include <linux/openat2.h>
+
+static inline int missing_openat2(
+                int dfd,
+                const char *filename,
+                struct open_how *how,
+                size_t size) {
+
+#  if defined __NR_openat2 && __NR_openat2 >= 0
+        return syscall(__NR_openat2, dfd, filename, how, size);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+#  define openat2 missing_openat2
+#endif
+
+/* ======================================================================= */
+
 #if !HAVE_OPEN_TREE
 
 #ifndef OPEN_TREE_CLONE
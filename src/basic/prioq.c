@@ -7,7 +7,9 @@
  * priority. Insertion and removal are Θ(log n). Optionally, the caller can
  * provide a pointer to an index which will be kept up-to-date by the prioq.
  *
- * The underlying algorithm used in this implementation is a Heap.
+ * The underlying algorithm used in this implementation is a 4-ary Heap: compared
+ * to a binary one it is only half as deep, and the children of each node are
+ * adjacent in memory, which makes it friendlier to the cache for large queues.
  */
 
 #include <errno.h>
@@ -15,8 +17,11 @@
 
 #include "alloc-util.h"
 #include "hashmap.h"
+#include "logarithm.h"
 #include "prioq.h"
 
+#define PRIOQ_ARITY 4U
+
 struct prioq_item {
         void *data;
         unsigned *idx;
@@ -63,83 +68,101 @@ int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func) {
         return 0;
 }
 
-static void swap(Prioq *q, unsigned j, unsigned k) {
+static void set_item(Prioq *q, unsigned k, struct prioq_item item) {
         assert(q);
-        assert(j < q->n_items);
         assert(k < q->n_items);
 
-        assert(!q->items[j].idx || *(q->items[j].idx) == j);
-        assert(!q->items[k].idx || *(q->items[k].idx) == k);
-
-        SWAP_TWO(q->items[j].data, q->items[k].data);
-        SWAP_TWO(q->items[j].idx, q->items[k].idx);
-
-        if (q->items[j].idx)
-                *q->items[j].idx = j;
-
-        if (q->items[k].idx)
-                *q->items[k].idx = k;
+        q->items[k] = item;
+        if (item.idx)
+                *item.idx = k;
 }
 
+/* Both shuffle functions take the item out of the heap and move the others into the hole it left, until the
+ * place where it belongs is found. That's one write per level instead of the two of a swap. */
+
 static unsigned shuffle_up(Prioq *q, unsigned idx) {
+        struct prioq_item item;
+
         assert(q);
         assert(idx < q->n_items);
 
+        item = q->items[idx];
+        assert(!item.idx || *item.idx == idx);
+
         while (idx > 0) {
                 unsigned k;
 
-                k = (idx-1)/2;
+                k = (idx - 1) / PRIOQ_ARITY;
 
-                if (q->compare_func(q->items[k].data, q->items[idx].data) <= 0)
+                if (q->compare_func(q->items[k].data, item.data) <= 0)
                         break;
 
-                swap(q, idx, k);
+                set_item(q, idx, q->items[k]);
                 idx = k;
         }
 
+        set_item(q, idx, item);
         return idx;
 }
 
 static unsigned shuffle_down(Prioq *q, unsigned idx) {
+        struct prioq_item item;
+
         assert(q);
+        assert(idx < q->n_items);
 
-        for (;;) {
-                unsigned j, k, s;
+        item = q->items[idx];
+        assert(!item.idx || *item.idx == idx);
 
-                k = (idx+1)*2; /* right child */
-                j = k-1;       /* left child */
+        for (;;) {
+                unsigned first, last, s;
 
-                if (j >= q->n_items)
+                first = idx * PRIOQ_ARITY + 1;
+                if (first >= q->n_items)
                         break;
 
-                if (q->compare_func(q->items[j].data, q->items[idx].data) < 0)
-
-                        /* So our left child is smaller than we are, let's
-                         * remember this fact */
-                        s = j;
-                else
-                        s = idx;
-
-                if (k < q->n_items &&
-                    q->compare_func(q->items[k].data, q->items[s].data) < 0)
+                last = MIN(first + PRIOQ_ARITY, q->n_items);
 
-                        /* So our right child is smaller than we are, let's
-                         * remember this fact */
-                        s = k;
+                /* Find the smallest of the children… */
+                s = first;
+                for (unsigned k = first + 1; k < last; k++)
+                        if (q->compare_func(q->items[k].data, q->items[s].data) < 0)
+                                s = k;
 
-                /* s now points to the smallest of the three items */
-
-                if (s == idx)
-                        /* No swap necessary, we're done */
+                /* …and if it isn't smaller than we are, we're done */
+                if (q->compare_func(q->items[s].data, item.data) >= 0)
                         break;
 
-                swap(q, idx, s);
+                set_item(q, idx, q->items[s]);
                 idx = s;
         }
 
+        set_item(q, idx, item);
         return idx;
 }
 
+/* Restores the heap property for the whole queue in Θ(n), bottom up */
+static void heapify(Prioq *q) {
+        assert(q);
+
+        if (q->n_items <= 1)
+                return;
+
+        for (unsigned k = (q->n_items - 2) / PRIOQ_ARITY + 1; k > 0; k--)
+                shuffle_down(q, k - 1);
+}
+
+/* Whether restoring the heap property for n changed or added items is cheaper by rebuilding the heap as a
+ * whole, than by fixing up the items one by one, i.e. n · depth > size */
+static bool batch_wants_heapify(Prioq *q, size_t n) {
+        unsigned depth;
+
+        assert(q);
+
+        depth = log2u(MAX(q->n_items, 1u)) / 2 + 1;
+        return n > q->n_items / depth;
+}
+
 int prioq_put(Prioq *q, void *data, unsigned *idx) {
         unsigned k;
 
@@ -162,6 +185,43 @@ int prioq_put(Prioq *q, void *data, unsigned *idx) {
         return 0;
 }
 
+int prioq_put_many(Prioq *q, void * const *data, unsigned * const *idx, size_t n) {
+        unsigned k;
+        bool h;
+
+        assert(q);
+        assert(data || n == 0);
+
+        if (n == 0)
+                return 0;
+
+        if (n > UINT_MAX - 1 - q->n_items)
+                return -ENOMEM;
+
+        if (!GREEDY_REALLOC(q->items, MAX(q->n_items + n, 16u)))
+                return -ENOMEM;
+
+        /* Decide before the items are added, what matters is how much of the heap already is in order */
+        h = batch_wants_heapify(q, n);
+
+        k = q->n_items;
+        q->n_items += n;
+
+        for (size_t i = 0; i < n; i++)
+                set_item(q, k + i, (struct prioq_item) {
+                                .data = data[i],
+                                .idx = idx ? idx[i] : NULL,
+                        });
+
+        if (h)
+                heapify(q);
+        else
+                for (size_t i = 0; i < n; i++)
+                        shuffle_up(q, k + i);
+
+        return 0;
+}
+
 int prioq_ensure_put(Prioq **q, compare_func_t compare_func, void *data, unsigned *idx) {
         int r;
 
@@ -191,10 +251,7 @@ static void remove_item(Prioq *q, struct prioq_item *i) {
 
                 k = i - q->items;
 
-                i->data = l->data;
-                i->idx = l->idx;
-                if (i->idx)
-                        *i->idx = k;
+                set_item(q, k, *l);
                 q->n_items--;
 
                 k = shuffle_down(q, k);
@@ -257,6 +314,19 @@ void prioq_reshuffle(Prioq *q, void *data, unsigned *idx) {
         shuffle_up(q, k);
 }
 
+void prioq_reshuffle_batch(Prioq *q, void * const *data, unsigned * const *idx, size_t n) {
+        assert(q);
+        assert(data || n == 0);
+
+        if (batch_wants_heapify(q, n)) {
+                heapify(q);
+                return;
+        }
+
+        for (size_t i = 0; i < n; i++)
+                prioq_reshuffle(q, data[i], idx ? idx[i] : NULL);
+}
+
 void *prioq_peek_by_index(Prioq *q, unsigned idx) {
         if (!q)
                 return NULL;
@@ -16,9 +16,14 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(Prioq*, prioq_free);
 int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func);
 
 int prioq_put(Prioq *q, void *data, unsigned *idx);
+/* Adds n items at once, rebuilding the heap in one go if that's cheaper. idx may be NULL, or an array of n
+ * index pointers (each of which may be NULL too). */
+int prioq_put_many(Prioq *q, void * const *data, unsigned * const *idx, size_t n);
 int prioq_ensure_put(Prioq **q, compare_func_t compare_func, void *data, unsigned *idx);
 int prioq_remove(Prioq *q, void *data, unsigned *idx);
 void prioq_reshuffle(Prioq *q, void *data, unsigned *idx);
+/* Like prioq_reshuffle(), for n items whose priority changed */
+void prioq_reshuffle_batch(Prioq *q, void * const *data, unsigned * const *idx, size_t n);
 
 void *prioq_peek_by_index(Prioq *q, unsigned idx) _pure_;
 static inline void *prioq_peek(Prioq *q) {
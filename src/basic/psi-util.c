@@ -15,7 +15,7 @@
 #include "stat-util.h"
 #include "strv.h"
 
-int read_resource_pressure(const char *path, PressureType type, ResourcePressure *ret) {
+int read_resource_pressure_at(int dir_fd, const char *path, PressureType type, ResourcePressure *ret) {
         _cleanup_free_ char *line = NULL;
         _cleanup_fclose_ FILE *f = NULL;
         unsigned field_filled = 0;
@@ -24,6 +24,7 @@ int read_resource_pressure(const char *path, PressureType type, ResourcePressure
         char *word;
         int r;
 
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
         assert(path);
         assert(IN_SET(type, PRESSURE_TYPE_SOME, PRESSURE_TYPE_FULL));
         assert(ret);
@@ -35,7 +36,7 @@ int read_resource_pressure(const char *path, PressureType type, ResourcePressure
         else
                 return -EINVAL;
 
-        r = fopen_unlocked(path, "re", &f);
+        r = fopen_unlocked_at(dir_fd, path, "re", 0, &f);
         if (r < 0)
                 return r;
 
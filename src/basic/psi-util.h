@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 #pragma once
 
+#include <fcntl.h>
 #include <stdbool.h>
 
 #include "parse-util.h"
@@ -24,7 +25,10 @@ typedef struct ResourcePressure {
  *  some avg10=0.22 avg60=0.17 avg300=1.11 total=58761459
  *  full avg10=0.23 avg60=0.16 avg300=1.08 total=58464525
  */
-int read_resource_pressure(const char *path, PressureType type, ResourcePressure *ret);
+int read_resource_pressure_at(int dir_fd, const char *path, PressureType type, ResourcePressure *ret);
+static inline int read_resource_pressure(const char *path, PressureType type, ResourcePressure *ret) {
+        return read_resource_pressure_at(AT_FDCWD, path, type, ret);
+}
 
 /* Was the kernel compiled with CONFIG_PSI=y? 1 if yes, 0 if not, negative on error. */
 int is_pressure_supported(void);
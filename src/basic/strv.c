@@ -138,16 +138,33 @@ char* strv_find_first_field(char * const *needles, char * const *haystack) {
         return NULL;
 }
 
+static bool strv_is_packed(char * const *l) {
+        /* A packed strv keeps its strings in the same allocation as the pointer array, right after the
+         * terminating NULL (see strv_copy_packed() below). The strings of a regular strv are separate
+         * allocations, hence can never be located within the usable size of the array itself. */
+
+        if (!l || !l[0])
+                return false;
+
+        return (uintptr_t) l[0] > (uintptr_t) l &&
+                (uintptr_t) l[0] < (uintptr_t) l + MALLOC_SIZEOF_SAFE(l);
+}
+
 char** strv_free(char **l) {
-        STRV_FOREACH(k, l)
-                free(*k);
+        if (!strv_is_packed(l))
+                STRV_FOREACH(k, l)
+                        free(*k);
 
         return mfree(l);
 }
 
 char** strv_free_erase(char **l) {
-        STRV_FOREACH(i, l)
-                erase_and_freep(i);
+        if (strv_is_packed(l))
+                STRV_FOREACH(i, l)
+                        explicit_bzero_safe(*i, strlen(*i));
+        else
+                STRV_FOREACH(i, l)
+                        erase_and_freep(i);
 
         return mfree(l);
 }
@@ -187,6 +204,57 @@ char** strv_copy_n(char * const *l, size_t m) {
         return TAKE_PTR(result);
 }
 
+char** strv_copy_packed(char * const *l) {
+        size_t n = 0, sz = 0;
+        char **result, *p;
+
+        /* Copies the list into a single allocation: the pointer array, followed by all strings. This saves
+         * one allocation (and its malloc overhead) per element, which matters for the many small lists that
+         * are kept around for a long time, e.g. per unit. The result must not be modified in place (anything
+         * that adds, removes or replaces elements), but can be released with strv_free() like any other
+         * strv. */
+
+        STRV_FOREACH(i, l) {
+                n++;
+                sz = size_add(sz, strlen(*i) + 1);
+        }
+
+        sz = size_add(sz, (n + 1) * sizeof(char*));
+        if (sz == SIZE_MAX)
+                return NULL;
+
+        result = malloc(sz);
+        if (!result)
+                return NULL;
+
+        p = (char*) (result + n + 1);
+        for (size_t k = 0; k < n; k++) {
+                result[k] = p;
+                p = stpcpy(p, l[k]) + 1;
+        }
+        result[n] = NULL;
+
+        return result;
+}
+
+int strv_pack(char ***l) {
+        char **packed;
+
+        assert(l);
+
+        /* Replaces the list by a packed copy of itself, see strv_copy_packed(). */
+
+        if (strv_isempty(*l) || strv_is_packed(*l))
+                return 0;
+
+        packed = strv_copy_packed(*l);
+        if (!packed)
+                return -ENOMEM;
+
+        strv_free_and_replace(*l, packed);
+        return 1;
+}
+
 int strv_copy_unless_empty(char * const *l, char ***ret) {
         assert(ret);
 
@@ -41,6 +41,10 @@ static inline char** strv_copy(char * const *l) {
 }
 int strv_copy_unless_empty(char * const *l, char ***ret);
 
+/* Packed lists live in one allocation, and must not be modified in place */
+char** strv_copy_packed(char * const *l);
+int strv_pack(char ***l);
+
 size_t strv_length(char * const *l) _pure_;
 
 int strv_extend_strv(char ***a, char * const *b, bool filter_duplicates);
@@ -16,6 +16,7 @@
 #include "hexdecoct.h"
 #include "macro.h"
 #include "string-util.h"
+#include "unaligned.h"
 #include "utf8.h"
 
 bool unichar_is_valid(char32_t ch) {
@@ -130,20 +131,37 @@ bool utf8_is_printable_newline(const char* str, size_t length, bool allow_newlin
         return true;
 }
 
+/* Returns true if none of the eight bytes in w is NUL or has the high bit set, i.e. if they are all plain
+ * ASCII characters. Once no high bit is set, subtracting one from each byte can only borrow from a lane
+ * that was zero. */
+static bool word_is_ascii_nonzero(uint64_t w) {
+        return ((w | (w - UINT64_C(0x0101010101010101))) & UINT64_C(0x8080808080808080)) == 0;
+}
+
 char* utf8_is_valid_n(const char *str, size_t len_bytes) {
         /* Check if the string is composed of valid utf8 characters. If length len_bytes is given, stop after
          * len_bytes. Otherwise, stop at NUL. */
 
         assert(str);
 
-        for (size_t i = 0; len_bytes != SIZE_MAX ? i < len_bytes : str[i] != '\0'; ) {
+        /* strlen() is vectorized by libc, and with the length known we may skip over plain ASCII eight
+         * bytes at a time below, without reading past the end of the string. */
+        if (len_bytes == SIZE_MAX)
+                len_bytes = strlen(str);
+
+        for (size_t i = 0; i < len_bytes; ) {
                 int len;
 
+                if (len_bytes - i >= sizeof(uint64_t) &&
+                    word_is_ascii_nonzero(unaligned_read_ne64(str + i))) {
+                        i += sizeof(uint64_t);
+                        continue;
+                }
+
                 if (_unlikely_(str[i] == '\0'))
                         return NULL; /* embedded NUL */
 
-                len = utf8_encoded_valid_unichar(str + i,
-                                                 len_bytes != SIZE_MAX ? len_bytes - i : SIZE_MAX);
+                len = utf8_encoded_valid_unichar(str + i, len_bytes - i);
                 if (_unlikely_(len < 0))
                         return NULL; /* invalid character */
 
@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "macro.h"
+#include "unaligned.h"
+#include "wyhash.h"
+
+static const uint64_t wyhash_secret[4] = {
+        UINT64_C(0xa0761d6478bd642f),
+        UINT64_C(0xe7037ed1a0b428db),
+        UINT64_C(0x8ebc6af09c88c6e3),
+        UINT64_C(0x589965cc75374cc3),
+};
+
+/* Multiplies a and b to a 128-bit result, and returns the lower and the upper half in a and b */
+static void wyhash_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+        __uint128_t r = (__uint128_t) *a * *b;
+
+        *a = (uint64_t) r;
+        *b = (uint64_t) (r >> 64);
+#else
+        uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+        uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t, c, lo;
+
+        t = rl + (rm0 << 32);
+        c = t < rl;
+        lo = t + (rm1 << 32);
+        c += lo < t;
+
+        *a = lo;
+        *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static uint64_t wyhash_mix(uint64_t a, uint64_t b) {
+        wyhash_mum(&a, &b);
+        return a ^ b;
+}
+
+/* Reads 1…3 bytes, such that every byte contributes */
+static uint64_t wyhash_read3(const uint8_t *p, size_t n) {
+        return ((uint64_t) p[0] << 16) | ((uint64_t) p[n >> 1] << 8) | p[n - 1];
+}
+
+uint64_t wyhash(const void *p, size_t n, uint64_t seed) {
+        const uint8_t *q = p;
+        uint64_t a, b;
+
+        assert(p || n == 0);
+
+        seed ^= wyhash_mix(seed ^ wyhash_secret[0], wyhash_secret[1]);
+
+        if (n <= 16) {
+                if (n >= 4) {
+                        /* Two possibly overlapping pairs of 32-bit words cover all bytes */
+                        size_t o = (n >> 3) << 2;
+
+                        a = ((uint64_t) unaligned_read_le32(q) << 32) | unaligned_read_le32(q + o);
+                        b = ((uint64_t) unaligned_read_le32(q + n - 4) << 32) | unaligned_read_le32(q + n - 4 - o);
+                } else if (n > 0) {
+                        a = wyhash_read3(q, n);
+                        b = 0;
+                } else
+                        a = b = 0;
+        } else {
+                size_t i = n;
+
+                if (i > 48) {
+                        uint64_t see1 = seed, see2 = seed;
+
+                        do {
+                                seed = wyhash_mix(unaligned_read_le64(q) ^ wyhash_secret[1],
+                                                  unaligned_read_le64(q + 8) ^ seed);
+                                see1 = wyhash_mix(unaligned_read_le64(q + 16) ^ wyhash_secret[2],
+                                                  unaligned_read_le64(q + 24) ^ see1);
+                                see2 = wyhash_mix(unaligned_read_le64(q + 32) ^ wyhash_secret[3],
+                                                  unaligned_read_le64(q + 40) ^ see2);
+                                q += 48;
+                                i -= 48;
+                        } while (i > 48);
+
+                        seed ^= see1 ^ see2;
+                }
+
+                for (; i > 16; i -= 16, q += 16)
+                        seed = wyhash_mix(unaligned_read_le64(q) ^ wyhash_secret[1],
+                                          unaligned_read_le64(q + 8) ^ seed);
+
+                /* The last 16 bytes, possibly overlapping with what was consumed above */
+                a = unaligned_read_le64(q + i - 16);
+                b = unaligned_read_le64(q + i - 8);
+        }
+
+        a ^= wyhash_secret[1];
+        b ^= seed;
+        wyhash_mum(&a, &b);
+
+        return wyhash_mix(a ^ wyhash_secret[0] ^ n, b ^ wyhash_secret[1]);
+}
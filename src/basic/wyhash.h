@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "string-util.h"
+
+/* A fast, non-cryptographic 64-bit hash function following the construction of wyhash (final version 4) by
+ * Wang Yi. Unlike siphash24() it is trivially possible to construct colliding inputs for it, even without
+ * knowing the seed. Only use this for data that is never controlled by an untrusted party. */
+
+uint64_t wyhash(const void *p, size_t n, uint64_t seed);
+
+static inline uint64_t wyhash_string(const char *s, uint64_t seed) {
+        return wyhash(s, strlen_ptr(s), seed);
+}
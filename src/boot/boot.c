@@ -2136,6 +2136,40 @@ static void config_add_entry_windows(Config *config, EFI_HANDLE *device, EFI_FIL
 #endif
 }
 
+static EFI_STATUS file_handle_read_section_cached(
+                EFI_FILE *handle,
+                const PeSectionVector *section,
+                PeSectionVector *cached_section,
+                char **cached,
+                size_t *cached_size) {
+
+        EFI_STATUS err;
+
+        assert(handle);
+        assert(section);
+        assert(cached_section);
+        assert(cached);
+        assert(cached_size);
+
+        /* Profiles of a UKI normally share the base .osrel and .cmdline sections. Hence remember what we
+         * read last, and don't go through the (often slow) firmware file protocol for the same bytes again
+         * for every profile. */
+        if (*cached &&
+            cached_section->file_offset == section->file_offset &&
+            cached_section->file_size == section->file_size)
+                return EFI_SUCCESS;
+
+        *cached = mfree(*cached);
+        *cached_section = (PeSectionVector) {};
+
+        err = file_handle_read(handle, section->file_offset, section->file_size, cached, cached_size);
+        if (err != EFI_SUCCESS)
+                return err;
+
+        *cached_section = *section;
+        return EFI_SUCCESS;
+}
+
 static void boot_entry_add_type2(
                 Config *config,
                 EFI_HANDLE *device,
@@ -2186,6 +2220,10 @@ static void boot_entry_add_type2(
                         /* validate_base= */ 0,
                         base_sections);
 
+        _cleanup_free_ char *osrel = NULL, *cmdline = NULL;
+        PeSectionVector osrel_section = {}, cmdline_section = {};
+        size_t osrel_size = 0, cmdline_size = 0;
+
         /* and now iterate through possible profiles, and create a menu item for each profile we find */
         for (unsigned profile = 0; profile < UNIFIED_PROFILES_MAX; profile ++) {
                 PeSectionVector sections[_SECTION_MAX];
@@ -2207,16 +2245,18 @@ static void boot_entry_add_type2(
                 if (!PE_SECTION_VECTOR_IS_SET(sections + SECTION_OSREL))
                         continue;
 
-                _cleanup_free_ char *content = NULL;
-                err = file_handle_read(
+                err = file_handle_read_section_cached(
                                 handle,
-                                sections[SECTION_OSREL].file_offset,
-                                sections[SECTION_OSREL].file_size,
-                                &content,
-                                /* ret_size= */ NULL);
+                                sections + SECTION_OSREL,
+                                &osrel_section,
+                                &osrel,
+                                &osrel_size);
                 if (err != EFI_SUCCESS)
                         continue;
 
+                /* Parsing modifies the buffer, hence work on a copy (including the trailing NUL) */
+                _cleanup_free_ char *content = xmemdup(osrel, osrel_size + 1);
+
                 _cleanup_free_ char16_t *os_pretty_name = NULL, *os_image_id = NULL, *os_name = NULL, *os_id = NULL,
                         *os_image_version = NULL, *os_version = NULL, *os_version_id = NULL, *os_build_id = NULL;
                 char *line, *key, *value;
@@ -2342,18 +2382,15 @@ static void boot_entry_add_type2(
                 if (!PE_SECTION_VECTOR_IS_SET(sections + SECTION_CMDLINE))
                         return;
 
-                content = mfree(content);
-
                 /* Read the embedded cmdline file for display purposes */
-                size_t cmdline_len;
-                err = file_handle_read(
+                err = file_handle_read_section_cached(
                                 handle,
-                                sections[SECTION_CMDLINE].file_offset,
-                                sections[SECTION_CMDLINE].file_size,
-                                &content,
-                                &cmdline_len);
+                                sections + SECTION_CMDLINE,
+                                &cmdline_section,
+                                &cmdline,
+                                &cmdline_size);
                 if (err == EFI_SUCCESS) {
-                        entry->options = mangle_stub_cmdline(xstrn8_to_16(content, cmdline_len));
+                        entry->options = mangle_stub_cmdline(xstrn8_to_16(cmdline, cmdline_size));
                         entry->options_implied = true;
                 }
         }
@@ -514,9 +514,18 @@ static int refresh_one(
 }
 
 static int refresh(const char *root, Hashmap *a, Hashmap *b, unsigned iteration) {
-        int r;
+        int r, all_unified;
+
+        all_unified = cg_all_unified();
+        if (all_unified < 0)
+                return all_unified;
 
         FOREACH_STRING(c, SYSTEMD_CGROUP_CONTROLLER, "cpu", "cpuacct", "memory", "io", "blkio", "pids") {
+                /* process() ignores the controllers of the other hierarchy anyway, hence don't walk the whole
+                 * tree once more for each of them. */
+                if (all_unified ? STR_IN_SET(c, "cpuacct", "blkio") : STR_IN_SET(c, "cpu", "io"))
+                        continue;
+
                 r = refresh_one(c, root, a, b, iteration, 0, NULL);
                 if (r < 0)
                         return r;
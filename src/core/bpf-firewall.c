@@ -19,10 +19,13 @@
 #include "bpf-firewall.h"
 #include "bpf-program.h"
 #include "fd-util.h"
+#include "hashmap.h"
 #include "in-addr-prefix-util.h"
+#include "manager.h"
 #include "memory-util.h"
 #include "missing_syscall.h"
 #include "unit.h"
+#include "string-util.h"
 #include "strv.h"
 #include "virt.h"
 
@@ -36,6 +39,17 @@ enum {
         ACCESS_DENIED  = 2,
 };
 
+/* Loaded ingress and egress programs for a specific set of IP access rules, without accounting. Units with
+ * the same rules (think instances of the same template) attach the very same programs, instead of loading
+ * yet another copy of them, and of the LPM maps they reference, into the kernel. */
+struct BPFFirewallPolicy {
+        unsigned n_ref;
+        Manager *manager;
+        char *key;
+        int ingress_fd;
+        int egress_fd;
+};
+
 /* Compile instructions for one list of addresses, one direction and one specific verdict on matches. */
 
 static int add_lookup_instructions(
@@ -412,6 +426,29 @@ static int bpf_firewall_add_access_items(
         return 0;
 }
 
+static int bpf_firewall_reduce_access_items(CGroupContext *cc, int verdict, Set **ret) {
+        Set *prefixes;
+        bool *reduced;
+        int r;
+
+        assert(cc);
+        assert(ret);
+
+        prefixes = verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny;
+        reduced = verdict == ACCESS_ALLOWED ? &cc->ip_address_allow_reduced : &cc->ip_address_deny_reduced;
+
+        if (!*reduced) {
+                r = in_addr_prefixes_reduce(prefixes);
+                if (r < 0)
+                        return r;
+
+                *reduced = true;
+        }
+
+        *ret = prefixes;
+        return 0;
+}
+
 static int bpf_firewall_prepare_access_maps(
                 Unit *u,
                 int verdict,
@@ -430,22 +467,14 @@ static int bpf_firewall_prepare_access_maps(
         for (Unit *p = u; p; p = UNIT_GET_SLICE(p)) {
                 CGroupContext *cc;
                 Set *prefixes;
-                bool *reduced;
 
                 cc = unit_get_cgroup_context(p);
                 if (!cc)
                         continue;
 
-                prefixes = verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny;
-                reduced = verdict == ACCESS_ALLOWED ? &cc->ip_address_allow_reduced : &cc->ip_address_deny_reduced;
-
-                if (!*reduced) {
-                        r = in_addr_prefixes_reduce(prefixes);
-                        if (r < 0)
-                                return r;
-
-                        *reduced = true;
-                }
+                r = bpf_firewall_reduce_access_items(cc, verdict, &prefixes);
+                if (r < 0)
+                        return r;
 
                 bpf_firewall_count_access_items(prefixes, &n_ipv4, &n_ipv6);
 
@@ -537,9 +566,212 @@ static int bpf_firewall_prepare_accounting_maps(Unit *u, bool enabled, CGroupRun
         return 0;
 }
 
+static BPFFirewallPolicy* bpf_firewall_policy_free(BPFFirewallPolicy *p) {
+        if (!p)
+                return NULL;
+
+        if (p->manager)
+                hashmap_remove_value(p->manager->bpf_firewall_policies, p->key, p);
+
+        free(p->key);
+        safe_close(p->ingress_fd);
+        safe_close(p->egress_fd);
+
+        return mfree(p);
+}
+
+DEFINE_PRIVATE_TRIVIAL_REF_UNREF_FUNC(BPFFirewallPolicy, bpf_firewall_policy, bpf_firewall_policy_free);
+DEFINE_TRIVIAL_CLEANUP_FUNC(BPFFirewallPolicy*, bpf_firewall_policy_unref);
+
+static int bpf_firewall_policy_key_append(char **key, const char *field, CGroupContext *cc, int verdict) {
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_free_ char *joined = NULL;
+        struct in_addr_prefix *a;
+        Set *prefixes;
+        int r;
+
+        assert(key);
+        assert(field);
+        assert(cc);
+
+        /* Reduce first, so that the key matches what ends up in the access maps, and equivalent rules
+         * written differently get the same key */
+        r = bpf_firewall_reduce_access_items(cc, verdict, &prefixes);
+        if (r < 0)
+                return r;
+
+        SET_FOREACH(a, prefixes) {
+                r = strv_extend(&l, IN_ADDR_PREFIX_TO_STRING(a->family, &a->address, a->prefixlen));
+                if (r < 0)
+                        return r;
+        }
+
+        /* Sets with the same contents may enumerate in different order, hence sort */
+        strv_sort(l);
+
+        joined = strv_join(l, ",");
+        if (!joined)
+                return -ENOMEM;
+
+        if (!strextend(key, field, "=", joined, ";"))
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int bpf_firewall_policy_key(Unit *u, char **ret) {
+        _cleanup_free_ char *key = NULL;
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        /* The access rules of a leaf unit are made up from its own and those of all its slices, see
+         * bpf_firewall_prepare_access_maps(). Hence the key covers all of them, level by level. */
+
+        for (Unit *p = u; p; p = UNIT_GET_SLICE(p)) {
+                CGroupContext *cc;
+
+                cc = unit_get_cgroup_context(p);
+                if (!cc)
+                        continue;
+
+                r = bpf_firewall_policy_key_append(&key, "allow", cc, ACCESS_ALLOWED);
+                if (r < 0)
+                        return r;
+
+                r = bpf_firewall_policy_key_append(&key, "deny", cc, ACCESS_DENIED);
+                if (r < 0)
+                        return r;
+
+                if (!strextend(&key, "/"))
+                        return -ENOMEM;
+        }
+
+        if (!key) {
+                key = strdup("");
+                if (!key)
+                        return -ENOMEM;
+        }
+
+        *ret = TAKE_PTR(key);
+        return 0;
+}
+
+static int bpf_firewall_program_from_fd(const char *prog_name, int fd, BPFProgram **ret) {
+        _cleanup_(bpf_program_freep) BPFProgram *p = NULL;
+        int r;
+
+        assert(ret);
+
+        if (fd < 0) {
+                *ret = NULL;
+                return 0;
+        }
+
+        r = bpf_program_new(BPF_PROG_TYPE_CGROUP_SKB, prog_name, &p);
+        if (r < 0)
+                return r;
+
+        p->kernel_fd = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+        if (p->kernel_fd < 0)
+                return -errno;
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+static int bpf_firewall_policy_acquire(Unit *u, CGroupRuntime *crt, const char *key, const char *ingress_name, const char *egress_name) {
+        BPFFirewallPolicy *p;
+        int r;
+
+        assert(u);
+        assert(crt);
+        assert(key);
+
+        /* Returns > 0 if we found loaded programs for this policy, and made them the unit's ones. */
+
+        p = hashmap_get(u->manager->bpf_firewall_policies, key);
+        if (!p)
+                return 0;
+
+        r = bpf_firewall_program_from_fd(ingress_name, p->ingress_fd, &crt->ip_bpf_ingress);
+        if (r < 0)
+                return r;
+
+        r = bpf_firewall_program_from_fd(egress_name, p->egress_fd, &crt->ip_bpf_egress);
+        if (r < 0) {
+                crt->ip_bpf_ingress = bpf_program_free(crt->ip_bpf_ingress);
+                return r;
+        }
+
+        crt->ip_bpf_policy = bpf_firewall_policy_ref(p);
+        return 1;
+}
+
+static int bpf_firewall_policy_register(Unit *u, CGroupRuntime *crt, char **key) {
+        _cleanup_(bpf_firewall_policy_unrefp) BPFFirewallPolicy *p = NULL;
+        int r;
+
+        assert(u);
+        assert(crt);
+        assert(key);
+
+        if (!crt->ip_bpf_ingress && !crt->ip_bpf_egress)
+                return 0;
+
+        /* Programs are normally loaded when they are attached, do it right away here, so that other units
+         * can pick up the loaded programs */
+        if (crt->ip_bpf_ingress) {
+                r = bpf_program_load_kernel(crt->ip_bpf_ingress, NULL, 0);
+                if (r < 0)
+                        return r;
+        }
+
+        if (crt->ip_bpf_egress) {
+                r = bpf_program_load_kernel(crt->ip_bpf_egress, NULL, 0);
+                if (r < 0)
+                        return r;
+        }
+
+        p = new(BPFFirewallPolicy, 1);
+        if (!p)
+                return -ENOMEM;
+
+        *p = (BPFFirewallPolicy) {
+                .n_ref = 1,
+                .ingress_fd = -EBADF,
+                .egress_fd = -EBADF,
+        };
+
+        if (crt->ip_bpf_ingress) {
+                p->ingress_fd = fcntl(crt->ip_bpf_ingress->kernel_fd, F_DUPFD_CLOEXEC, 3);
+                if (p->ingress_fd < 0)
+                        return -errno;
+        }
+
+        if (crt->ip_bpf_egress) {
+                p->egress_fd = fcntl(crt->ip_bpf_egress->kernel_fd, F_DUPFD_CLOEXEC, 3);
+                if (p->egress_fd < 0)
+                        return -errno;
+        }
+
+        r = hashmap_ensure_put(&u->manager->bpf_firewall_policies, &string_hash_ops, *key, p);
+        if (r < 0)
+                return r;
+
+        p->key = TAKE_PTR(*key);
+        p->manager = u->manager;
+
+        crt->ip_bpf_policy = TAKE_PTR(p);
+        return 0;
+}
+
 int bpf_firewall_compile(Unit *u) {
+        _cleanup_(bpf_firewall_policy_unrefp) BPFFirewallPolicy *old_policy = NULL;
         const char *ingress_name = NULL, *egress_name = NULL;
         bool ip_allow_any = false, ip_deny_any = false;
+        _cleanup_free_ char *key = NULL;
         CGroupContext *cc;
         CGroupRuntime *crt;
         int r, supported;
@@ -589,6 +821,29 @@ int bpf_firewall_compile(Unit *u) {
         crt->ipv6_allow_map_fd = safe_close(crt->ipv6_allow_map_fd);
         crt->ipv6_deny_map_fd = safe_close(crt->ipv6_deny_map_fd);
 
+        /* Only drop our reference to the old shared programs once we are done, so that we can pick them up
+         * again if nothing changed */
+        old_policy = TAKE_PTR(crt->ip_bpf_policy);
+
+        /* The accounting maps are per unit and referenced by the programs, hence we can only share programs
+         * between units that do no accounting. */
+        if (u->type != UNIT_SLICE && !cc->ip_accounting) {
+                r = bpf_firewall_policy_key(u, &key);
+                if (r < 0)
+                        return log_unit_error_errno(u, r, "bpf-firewall: Failed to determine access rules: %m");
+
+                r = bpf_firewall_policy_acquire(u, crt, key, ingress_name, egress_name);
+                if (r < 0)
+                        return log_unit_error_errno(u, r, "bpf-firewall: Failed to reuse loaded BPF programs: %m");
+                if (r > 0) {
+                        r = bpf_firewall_prepare_accounting_maps(u, /* enabled = */ false, crt);
+                        if (r < 0)
+                                return log_unit_error_errno(u, r, "bpf-firewall: Preparation of BPF accounting maps failed: %m");
+
+                        return 0;
+                }
+        }
+
         if (u->type != UNIT_SLICE) {
                 /* In inner nodes we only do accounting, we do not actually bother with access control. However, leaf
                  * nodes will incorporate all IP access rules set on all their parent nodes. This has the benefit that
@@ -617,6 +872,12 @@ int bpf_firewall_compile(Unit *u) {
         if (r < 0)
                 return log_unit_error_errno(u, r, "bpf-firewall: Compilation of egress BPF program failed: %m");
 
+        if (key) {
+                r = bpf_firewall_policy_register(u, crt, &key);
+                if (r < 0)
+                        log_unit_debug_errno(u, r, "bpf-firewall: Failed to make BPF programs available to other units, ignoring: %m");
+        }
+
         return 0;
 }
 
@@ -985,6 +1246,7 @@ void bpf_firewall_close(CGroupRuntime *crt) {
         crt->ip_bpf_ingress_installed = bpf_program_free(crt->ip_bpf_ingress_installed);
         crt->ip_bpf_egress = bpf_program_free(crt->ip_bpf_egress);
         crt->ip_bpf_egress_installed = bpf_program_free(crt->ip_bpf_egress_installed);
+        crt->ip_bpf_policy = bpf_firewall_policy_unref(crt->ip_bpf_policy);
 
         crt->ip_bpf_custom_ingress = set_free(crt->ip_bpf_custom_ingress);
         crt->ip_bpf_custom_egress = set_free(crt->ip_bpf_custom_egress);
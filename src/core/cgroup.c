@@ -49,6 +49,9 @@
 
 #define CGROUP_CPU_QUOTA_DEFAULT_PERIOD_USEC ((usec_t) 100 * USEC_PER_MSEC)
 
+/* How many units to process from the cgroup empty and OOM queues in one event loop iteration */
+#define CGROUP_QUEUE_DISPATCH_MAX 16U
+
 /* Returns the log level to use when cgroup attribute writes fail. When an attribute is missing or we have access
  * problems we downgrade to LOG_DEBUG. This is supposed to be nice to container managers and kernels which want to mask
  * out specific attributes from us. */
@@ -115,6 +118,51 @@ bool unit_has_host_root_cgroup(const Unit *u) {
         return unit_has_name(u, SPECIAL_ROOT_SLICE);
 }
 
+static void cgroup_runtime_flush_attribute_cache(CGroupRuntime *crt) {
+        assert(crt);
+
+        crt->cgroup_attribute_cache = hashmap_free(crt->cgroup_attribute_cache);
+}
+
+static int set_attribute(CGroupRuntime *crt, const char *controller, const char *attribute, const char *value) {
+        _cleanup_free_ char *old = NULL, *e = NULL;
+        size_t a, v;
+        int r;
+
+        assert(crt);
+        assert(crt->cgroup_path);
+        assert(attribute);
+        assert(value);
+
+        /* Each attribute write is an open()/write()/close() cycle, and whenever a unit or one of its slices
+         * is invalidated all of its attributes are applied again, most of them unchanged. Hence remember
+         * what we wrote, and don't write the same value twice in a row. */
+
+        if (streq_ptr(hashmap_get(crt->cgroup_attribute_cache, attribute), value))
+                return 0;
+
+        /* Whatever happens below, what we remember about the attribute is outdated now */
+        (void) hashmap_remove2(crt->cgroup_attribute_cache, attribute, (void**) &old);
+
+        r = cg_set_attribute(controller, crt->cgroup_path, attribute, value);
+        if (r < 0)
+                return r;
+
+        a = strlen(attribute) + 1;
+        v = strlen(value) + 1;
+
+        e = malloc(a + v);
+        if (!e)
+                return 0; /* It's just a cache */
+
+        memcpy(mempcpy(e, attribute, a), value, v);
+
+        if (hashmap_ensure_put(&crt->cgroup_attribute_cache, &string_hash_ops_free, e, e + a) >= 0)
+                TAKE_PTR(e);
+
+        return 0;
+}
+
 static int set_attribute_and_warn(Unit *u, const char *controller, const char *attribute, const char *value) {
         int r;
 
@@ -124,7 +172,7 @@ static int set_attribute_and_warn(Unit *u, const char *controller, const char *a
         if (!crt || !crt->cgroup_path)
                 return -EOWNERDEAD;
 
-        r = cg_set_attribute(controller, crt->cgroup_path, attribute, value);
+        r = set_attribute(crt, controller, attribute, value);
         if (r < 0)
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%.*s': %m",
                                     strna(attribute), empty_to_root(crt->cgroup_path), (int) strcspn(value, NEWLINE), value);
@@ -1551,7 +1599,7 @@ static void cgroup_apply_unified_cpu_idle(Unit *u, uint64_t weight) {
 
         is_idle = weight == CGROUP_WEIGHT_IDLE;
         idle_val = one_zero(is_idle);
-        r = cg_set_attribute("cpu", crt->cgroup_path, "cpu.idle", idle_val);
+        r = set_attribute(crt, "cpu", "cpu.idle", idle_val);
         if (r < 0 && (r != -ENOENT || is_idle))
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%s': %m",
                                     "cpu.idle", empty_to_root(crt->cgroup_path), idle_val);
@@ -1695,7 +1743,7 @@ static int set_bfq_weight(Unit *u, const char *controller, dev_t dev, uint64_t i
         else
                 xsprintf(buf, "%" PRIu64 "\n", bfq_weight);
 
-        r = cg_set_attribute(controller, crt->cgroup_path, p, buf);
+        r = set_attribute(crt, controller, p, buf);
 
         /* FIXME: drop this when kernels prior
          * 795fe54c2a82 ("bfq: Add per-device weight") v5.4
@@ -1731,7 +1779,7 @@ static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_
         r1 = set_bfq_weight(u, "io", dev, io_weight);
 
         xsprintf(buf, DEVNUM_FORMAT_STR " %" PRIu64 "\n", DEVNUM_FORMAT_VAL(dev), io_weight);
-        r2 = cg_set_attribute("io", crt->cgroup_path, "io.weight", buf);
+        r2 = set_attribute(crt, "io", "io.weight", buf);
 
         /* Look at the configured device, when both fail, prefer io.weight errno. */
         r = r2 == -EOPNOTSUPP ? r1 : r2;
@@ -2925,6 +2973,10 @@ static int unit_update_cgroup(
                 migrate_mask = crt->cgroup_realized_mask ^ target_mask;
         }
 
+        /* A new cgroup, or controllers that came or went, come with attributes at their defaults */
+        if (created || !crt->cgroup_realized || crt->cgroup_realized_mask != target_mask)
+                cgroup_runtime_flush_attribute_cache(crt);
+
         /* Keep track that this is now realized */
         crt->cgroup_realized = true;
         crt->cgroup_realized_mask = target_mask;
@@ -3371,6 +3423,8 @@ static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
                         return r;
         }
 
+        unit_statistics_inc(u, n_cgroup_realizations);
+
         /* Now actually deal with the cgroup we were trying to realise and set attributes */
         r = unit_update_cgroup(u, target_mask, enable_mask, state);
         if (r < 0)
@@ -3506,6 +3560,8 @@ void unit_release_cgroup(Unit *u, bool drop_cgroup_runtime) {
                 crt->cgroup_path = mfree(crt->cgroup_path);
         }
 
+        cgroup_runtime_flush_attribute_cache(crt);
+
         if (crt->cgroup_control_inotify_wd >= 0) {
                 if (inotify_rm_watch(u->manager->cgroup_inotify_fd, crt->cgroup_control_inotify_wd) < 0)
                         log_unit_debug_errno(u, errno, "Failed to remove cgroup control inotify watch %i for %s, ignoring: %m", crt->cgroup_control_inotify_wd, u->id);
@@ -3618,6 +3674,7 @@ void unit_prune_cgroup(Unit *u) {
         crt->cgroup_realized = false;
         crt->cgroup_realized_mask = 0;
         crt->cgroup_enabled_mask = 0;
+        cgroup_runtime_flush_attribute_cache(crt);
 
         crt->bpf_device_control_installed = bpf_program_free(crt->bpf_device_control_installed);
 }
@@ -3774,18 +3831,36 @@ int unit_watch_all_pids(Unit *u) {
 
 static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
-        Unit *u;
         int r;
 
         assert(s);
 
-        u = m->cgroup_empty_queue;
-        if (!u)
-                return 0;
+        /* When many units stop at once, taking one unit off the queue per event loop iteration means going
+         * through the whole event loop machinery once per unit. Hence, process a couple of them in one go,
+         * but not all, so that other event sources still get their turn in between. */
 
-        assert(u->in_cgroup_empty_queue);
-        u->in_cgroup_empty_queue = false;
-        LIST_REMOVE(cgroup_empty_queue, m->cgroup_empty_queue, u);
+        for (unsigned n = 0; n < CGROUP_QUEUE_DISPATCH_MAX; n++) {
+                Unit *u;
+
+                u = m->cgroup_empty_queue;
+                if (!u)
+                        return 0;
+
+                assert(u->in_cgroup_empty_queue);
+                u->in_cgroup_empty_queue = false;
+                LIST_REMOVE(cgroup_empty_queue, m->cgroup_empty_queue, u);
+
+                /* Update state based on OOM kills before we notify about cgroup empty event */
+                (void) unit_check_oom(u);
+                (void) unit_check_oomd_kill(u);
+
+                unit_add_to_gc_queue(u);
+
+                if (UNIT_IS_INACTIVE_OR_FAILED(unit_active_state(u)))
+                        unit_prune_cgroup(u);
+                else if (UNIT_VTABLE(u)->notify_cgroup_empty)
+                        UNIT_VTABLE(u)->notify_cgroup_empty(u);
+        }
 
         if (m->cgroup_empty_queue) {
                 /* More stuff queued, let's make sure we remain enabled */
@@ -3794,17 +3869,6 @@ static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
                         log_debug_errno(r, "Failed to reenable cgroup empty event source, ignoring: %m");
         }
 
-        /* Update state based on OOM kills before we notify about cgroup empty event */
-        (void) unit_check_oom(u);
-        (void) unit_check_oomd_kill(u);
-
-        unit_add_to_gc_queue(u);
-
-        if (UNIT_IS_INACTIVE_OR_FAILED(unit_active_state(u)))
-                unit_prune_cgroup(u);
-        else if (UNIT_VTABLE(u)->notify_cgroup_empty)
-                UNIT_VTABLE(u)->notify_cgroup_empty(u);
-
         return 0;
 }
 
@@ -3958,18 +4022,24 @@ int unit_check_oom(Unit *u) {
 
 static int on_cgroup_oom_event(sd_event_source *s, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
-        Unit *u;
         int r;
 
         assert(s);
 
-        u = m->cgroup_oom_queue;
-        if (!u)
-                return 0;
+        for (unsigned n = 0; n < CGROUP_QUEUE_DISPATCH_MAX; n++) {
+                Unit *u;
 
-        assert(u->in_cgroup_oom_queue);
-        u->in_cgroup_oom_queue = false;
-        LIST_REMOVE(cgroup_oom_queue, m->cgroup_oom_queue, u);
+                u = m->cgroup_oom_queue;
+                if (!u)
+                        return 0;
+
+                assert(u->in_cgroup_oom_queue);
+                u->in_cgroup_oom_queue = false;
+                LIST_REMOVE(cgroup_oom_queue, m->cgroup_oom_queue, u);
+
+                (void) unit_check_oom(u);
+                unit_add_to_gc_queue(u);
+        }
 
         if (m->cgroup_oom_queue) {
                 /* More stuff queued, let's make sure we remain enabled */
@@ -3978,9 +4048,6 @@ static int on_cgroup_oom_event(sd_event_source *s, void *userdata) {
                         log_debug_errno(r, "Failed to reenable cgroup oom event source, ignoring: %m");
         }
 
-        (void) unit_check_oom(u);
-        unit_add_to_gc_queue(u);
-
         return 0;
 }
 
@@ -4067,10 +4134,18 @@ static int unit_check_cgroup_events(Unit *u) {
 
 static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
+        _cleanup_set_free_ Set *changed = NULL;
+        Unit *u;
+        int r;
 
         assert(s);
         assert(fd >= 0);
 
+        /* A cgroup.events file is usually modified more than once while a unit goes down (processes
+         * exiting, the freezer, …), and the kernel only merges identical events that are queued back to
+         * back. Hence, first drain the inotify queue and collect the affected units, and then read each
+         * unit's cgroup.events only once. The file reflects the current state anyway. */
+
         for (;;) {
                 union inotify_event_buffer buffer;
                 ssize_t l;
@@ -4078,14 +4153,13 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                 l = read(fd, &buffer, sizeof(buffer));
                 if (l < 0) {
                         if (ERRNO_IS_TRANSIENT(errno))
-                                return 0;
+                                break;
 
-                        return log_error_errno(errno, "Failed to read control group inotify events: %m");
+                        r = log_error_errno(errno, "Failed to read control group inotify events: %m");
+                        goto finish;
                 }
 
                 FOREACH_INOTIFY_EVENT_WARN(e, buffer, l) {
-                        Unit *u;
-
                         if (e->wd < 0)
                                 /* Queue overflow has no watch descriptor */
                                 continue;
@@ -4098,14 +4172,23 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                          * because it was queued before the removal. Let's ignore this here safely. */
 
                         u = hashmap_get(m->cgroup_control_inotify_wd_unit, INT_TO_PTR(e->wd));
-                        if (u)
-                                unit_check_cgroup_events(u);
+                        if (u && set_ensure_put(&changed, NULL, u) < 0)
+                                /* Can't remember it for later? Then check right away. */
+                                (void) unit_check_cgroup_events(u);
 
                         u = hashmap_get(m->cgroup_memory_inotify_wd_unit, INT_TO_PTR(e->wd));
                         if (u)
                                 unit_add_to_cgroup_oom_queue(u);
                 }
         }
+
+        r = 0;
+
+finish:
+        SET_FOREACH(u, changed)
+                (void) unit_check_cgroup_events(u);
+
+        return r;
 }
 
 static int cg_bpf_mask_supported(CGroupMask *ret) {
@@ -5248,6 +5331,7 @@ CGroupRuntime* cgroup_runtime_free(CGroupRuntime *crt) {
         bpf_link_free(crt->ipv6_socket_bind_link);
 #endif
         hashmap_free(crt->bpf_foreign_by_key);
+        hashmap_free(crt->cgroup_attribute_cache);
 
         bpf_program_free(crt->bpf_device_control_installed);
 
@@ -39,6 +39,7 @@ typedef struct CGroupBlockIODeviceBandwidth CGroupBlockIODeviceBandwidth;
 typedef struct CGroupBPFForeignProgram CGroupBPFForeignProgram;
 typedef struct CGroupSocketBindItem CGroupSocketBindItem;
 typedef struct CGroupRuntime CGroupRuntime;
+typedef struct BPFFirewallPolicy BPFFirewallPolicy;
 
 typedef enum CGroupDevicePolicy {
         /* When devices listed, will allow those, plus built-in ones, if none are listed will allow
@@ -323,6 +324,11 @@ typedef struct CGroupRuntime {
         CGroupMask cgroup_invalidated_mask;        /* A mask specifying controllers which shall be considered invalidated, and require re-realization */
         CGroupMask cgroup_members_mask;            /* A cache for the controllers required by all children of this cgroup (only relevant for slice units) */
 
+        /* The values we last successfully wrote to the attributes of this cgroup, attribute name → value,
+         * both in the same allocation, owned by the key. Only valid as long as neither the cgroup nor the
+         * controllers enabled for it change. */
+        Hashmap *cgroup_attribute_cache;
+
         /* Inotify watch descriptors for watching cgroup.events and memory.events on cgroupv2 */
         int cgroup_control_inotify_wd;
         int cgroup_memory_inotify_wd;
@@ -341,6 +347,7 @@ typedef struct CGroupRuntime {
         int ipv6_deny_map_fd;
         BPFProgram *ip_bpf_ingress, *ip_bpf_ingress_installed;
         BPFProgram *ip_bpf_egress, *ip_bpf_egress_installed;
+        BPFFirewallPolicy *ip_bpf_policy; /* The loaded programs shared with other units, if any */
 
         Set *ip_bpf_custom_ingress;
         Set *ip_bpf_custom_ingress_installed;
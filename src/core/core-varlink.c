@@ -10,6 +10,7 @@
 #include "varlink-internal.h"
 #include "varlink-io.systemd.UserDatabase.h"
 #include "varlink-io.systemd.ManagedOOM.h"
+#include "varlink-io.systemd.Manager.h"
 #include "varlink-util.h"
 
 typedef struct LookupParameters {
@@ -560,6 +561,95 @@ static int vl_method_get_memberships(sd_varlink *link, sd_json_variant *paramete
         return sd_varlink_error(link, "io.systemd.UserDatabase.NoRecordFound", NULL);
 }
 
+static int list_unit_statistics_one(sd_varlink *link, Unit *u, bool more) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        const UnitStatistics *s;
+        int r;
+
+        assert(link);
+        assert(u);
+
+        /* Not allocated if nothing was counted for the unit yet */
+        s = u->statistics ?: &(const UnitStatistics) {};
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_STRING("name", u->id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("notifyMessages", s->n_notify_messages),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("busLookups", s->n_bus_lookups),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("changeSignals", s->n_change_signals),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("cgroupRealizations", s->n_cgroup_realizations),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("loads", s->n_loads),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("gcChecks", s->n_gc_checks));
+        if (r < 0)
+                return r;
+
+        if (more)
+                return sd_varlink_notify(link, v);
+
+        return sd_varlink_reply(link, v);
+}
+
+static int vl_method_list_unit_statistics(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata) {
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "name", SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, 0, 0 },
+                {}
+        };
+
+        Manager *m = ASSERT_PTR(userdata);
+        const char *name = NULL, *k;
+        Unit *u, *previous = NULL;
+        uid_t uid;
+        int r;
+
+        assert(link);
+        assert(parameters);
+
+        r = sd_varlink_dispatch(link, parameters, dispatch_table, &name);
+        if (r != 0)
+                return r;
+
+        /* The counters tell which units are busy, and how much, hence don't reveal them to everybody */
+        r = sd_varlink_get_peer_uid(link, &uid);
+        if (r < 0)
+                return r;
+        if (uid != 0 && uid != getuid())
+                return sd_varlink_error(link, SD_VARLINK_ERROR_PERMISSION_DENIED, NULL);
+
+        if (!m->unit_statistics)
+                return sd_varlink_error(link, "io.systemd.Manager.StatisticsDisabled", NULL);
+
+        if (name) {
+                u = manager_get_unit(m, name);
+                if (!u)
+                        return sd_varlink_error(link, "io.systemd.Manager.NoSuchUnit", NULL);
+
+                return list_unit_statistics_one(link, u, /* more= */ false);
+        }
+
+        if (!FLAGS_SET(flags, SD_VARLINK_METHOD_MORE))
+                return sd_varlink_error(link, SD_VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                /* Skip aliases */
+                if (!streq(k, u->id))
+                        continue;
+
+                if (previous) {
+                        r = list_unit_statistics_one(link, previous, /* more= */ true);
+                        if (r < 0)
+                                return r;
+                }
+
+                previous = u;
+        }
+
+        if (previous)
+                return list_unit_statistics_one(link, previous, /* more= */ false);
+
+        return sd_varlink_error(link, "io.systemd.Manager.NoSuchUnit", NULL);
+}
+
 static void vl_disconnect(sd_varlink_server *s, sd_varlink *link, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
 
@@ -589,7 +679,8 @@ int manager_setup_varlink_server(Manager *m) {
         r = sd_varlink_server_add_interface_many(
                         s,
                         &vl_interface_io_systemd_UserDatabase,
-                        &vl_interface_io_systemd_ManagedOOM);
+                        &vl_interface_io_systemd_ManagedOOM,
+                        &vl_interface_io_systemd_Manager);
         if (r < 0)
                 return log_debug_errno(r, "Failed to add interfaces to varlink server: %m");
 
@@ -598,7 +689,8 @@ int manager_setup_varlink_server(Manager *m) {
                         "io.systemd.UserDatabase.GetUserRecord",  vl_method_get_user_record,
                         "io.systemd.UserDatabase.GetGroupRecord", vl_method_get_group_record,
                         "io.systemd.UserDatabase.GetMemberships", vl_method_get_memberships,
-                        "io.systemd.ManagedOOM.SubscribeManagedOOMCGroups", vl_method_subscribe_managed_oom_cgroups);
+                        "io.systemd.ManagedOOM.SubscribeManagedOOMCGroups", vl_method_subscribe_managed_oom_cgroups,
+                        "io.systemd.Manager.ListUnitStatistics", vl_method_list_unit_statistics);
         if (r < 0)
                 return log_debug_errno(r, "Failed to register varlink methods: %m");
 
@@ -630,7 +722,10 @@ static int manager_varlink_init_system(Manager *m) {
         if (!MANAGER_IS_TEST_RUN(m)) {
                 (void) mkdir_p_label("/run/systemd/userdb", 0755);
 
-                FOREACH_STRING(address, "/run/systemd/userdb/io.systemd.DynamicUser", VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM) {
+                FOREACH_STRING(address,
+                               "/run/systemd/userdb/io.systemd.DynamicUser",
+                               VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM,
+                               VARLINK_ADDR_PATH_MANAGER_SYSTEM) {
                         if (!fresh) {
                                 /* We might have got sockets through deserialization. Do not bind to them twice. */
 
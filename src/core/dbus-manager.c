@@ -32,7 +32,6 @@
 #include "locale-util.h"
 #include "log.h"
 #include "manager-dump.h"
-#include "memfd-util.h"
 #include "os-util.h"
 #include "parse-util.h"
 #include "path-util.h"
@@ -64,6 +63,7 @@ static BUS_DEFINE_PROPERTY_GET_GLOBAL(property_get_timer_slack_nsec, "t", (uint6
 static BUS_DEFINE_PROPERTY_GET_REF(property_get_hashmap_size, "u", Hashmap *, hashmap_size);
 static BUS_DEFINE_PROPERTY_GET_REF(property_get_set_size, "u", Set *, set_size);
 static BUS_DEFINE_PROPERTY_GET(property_get_default_timeout_abort_usec, "t", Manager, manager_default_timeout_abort_usec);
+static BUS_DEFINE_PROPERTY_GET(property_get_need_daemon_reload, "b", Manager, manager_need_daemon_reload);
 static BUS_DEFINE_PROPERTY_GET_GLOBAL(property_get_watchdog_device, "s", watchdog_get_device());
 static BUS_DEFINE_PROPERTY_GET_GLOBAL(property_get_watchdog_last_ping_realtime, "t", watchdog_get_last_ping(CLOCK_REALTIME));
 static BUS_DEFINE_PROPERTY_GET_GLOBAL(property_get_watchdog_last_ping_monotonic, "t", watchdog_get_last_ping(CLOCK_MONOTONIC));
@@ -959,11 +959,10 @@ static int method_attach_processes_to_unit(sd_bus_message *message, void *userda
         return method_generic_unit_operation(message, userdata, error, bus_unit_method_attach_processes, GENERIC_UNIT_VALIDATE_LOADED);
 }
 
-static int transient_unit_from_message(
+static int transient_unit_acquire(
                 Manager *m,
-                sd_bus_message *message,
                 const char *name,
-                Unit **unit,
+                Unit **ret,
                 sd_bus_error *error) {
 
         UnitType t;
@@ -971,8 +970,8 @@ static int transient_unit_from_message(
         int r;
 
         assert(m);
-        assert(message);
         assert(name);
+        assert(ret);
 
         t = unit_name_to_type(name);
         if (t < 0)
@@ -992,6 +991,20 @@ static int transient_unit_from_message(
                 return sd_bus_error_setf(error, BUS_ERROR_UNIT_EXISTS,
                                          "Unit %s was already loaded or has a fragment file.", name);
 
+        *ret = u;
+        return 0;
+}
+
+static int transient_unit_fill(
+                sd_bus_message *message,
+                Unit *u,
+                sd_bus_error *error) {
+
+        int r;
+
+        assert(message);
+        assert(u);
+
         /* OK, the unit failed to load and is unreferenced, now let's
          * fill in the transient data instead */
         r = unit_make_transient(u);
@@ -1010,8 +1023,35 @@ static int transient_unit_from_message(
                         return log_error_errno(r, "Failed to watch sender: %m");
         }
 
-        /* Now load the missing bits of the unit we just created */
+        /* The missing bits of the unit are loaded by the caller */
         unit_add_to_load_queue(u);
+
+        return 0;
+}
+
+static int transient_unit_from_message(
+                Manager *m,
+                sd_bus_message *message,
+                const char *name,
+                Unit **unit,
+                sd_bus_error *error) {
+
+        Unit *u;
+        int r;
+
+        assert(m);
+        assert(message);
+        assert(name);
+
+        r = transient_unit_acquire(m, name, &u, error);
+        if (r < 0)
+                return r;
+
+        r = transient_unit_fill(message, u, error);
+        if (r < 0)
+                return r;
+
+        /* Now load the missing bits of the unit we just created */
         manager_dispatch_load_queue(m);
 
         *unit = u;
@@ -1104,6 +1144,176 @@ static int method_start_transient_unit(sd_bus_message *message, void *userdata,
         return bus_unit_queue_job(message, u, JOB_START, mode, 0, error);
 }
 
+typedef struct TransientUnitsEntry {
+        const char *name;
+        Unit *unit;
+        sd_bus_error error;
+} TransientUnitsEntry;
+
+static void transient_units_entry_free_many(TransientUnitsEntry *entries, size_t n) {
+        assert(entries || n == 0);
+
+        FOREACH_ARRAY(e, entries, n)
+                sd_bus_error_free(&e->error);
+
+        free(entries);
+}
+
+static int transient_units_entry_start(sd_bus_message *message, TransientUnitsEntry *e, JobMode mode, char **ret_job_path) {
+        Job *j;
+        int r;
+
+        assert(message);
+        assert(e);
+        assert(e->unit);
+        assert(ret_job_path);
+
+        r = mac_selinux_unit_access_check(e->unit, message, "start", &e->error);
+        if (r < 0)
+                return r;
+
+        r = bus_unit_check_job_allowed(e->unit, JOB_START, &e->error);
+        if (r < 0)
+                return r;
+
+        r = manager_add_job(e->unit->manager, JOB_START, e->unit, mode, &e->error, &j);
+        if (r < 0)
+                return r;
+
+        r = bus_job_track_sender(j, message);
+        if (r < 0)
+                return r;
+
+        /* Before we send the method reply, force out the announcement JobNew for this job */
+        bus_job_send_pending_change_signal(j, true);
+
+        *ret_job_path = job_dbus_path(j);
+        if (!*ret_job_path)
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int method_start_transient_units(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        TransientUnitsEntry *entries = NULL;
+        size_t n_entries = 0;
+        const char *smode;
+        JobMode mode;
+        int r;
+
+        assert(message);
+
+        CLEANUP_ARRAY(entries, n_entries, transient_units_entry_free_many);
+
+        /* Like StartTransientUnit(), but for many units at once, so that job schedulers don't have to pay
+         * for a bus roundtrip and a load queue run per unit. Problems with individual units, like
+         * name clashes or job enqueuing failures, are reported per unit in the reply. Invalid properties
+         * fail the whole call though, since they are a bug in the caller. */
+
+        r = mac_selinux_access_check(message, "start", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read(message, "s", &smode);
+        if (r < 0)
+                return r;
+
+        mode = job_mode_from_string(smode);
+        if (mode < 0)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Job mode %s is invalid.", smode);
+
+        r = bus_verify_manage_units_async(m, message, error);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return 1; /* No authorization for now, but the async polkit stuff will call us again when it has it */
+
+        r = sd_bus_message_enter_container(message, 'a', "(sa(sv))");
+        if (r < 0)
+                return r;
+
+        while ((r = sd_bus_message_enter_container(message, 'r', "sa(sv)")) > 0) {
+                TransientUnitsEntry *e;
+                Unit *u;
+
+                if (!GREEDY_REALLOC(entries, n_entries + 1))
+                        return -ENOMEM;
+
+                e = entries + n_entries++;
+                *e = (TransientUnitsEntry) {
+                        .error = SD_BUS_ERROR_NULL,
+                };
+
+                r = sd_bus_message_read(message, "s", &e->name);
+                if (r < 0)
+                        return r;
+
+                r = transient_unit_acquire(m, e->name, &u, &e->error);
+                if (r < 0) {
+                        if (!sd_bus_error_is_set(&e->error))
+                                return r;
+
+                        /* Report this one in the reply, and go on with the next one */
+                        r = sd_bus_message_skip(message, "a(sv)");
+                        if (r < 0)
+                                return r;
+                } else {
+                        r = transient_unit_fill(message, u, error);
+                        if (r < 0)
+                                return r;
+
+                        e->unit = u;
+                }
+
+                r = sd_bus_message_exit_container(message);
+                if (r < 0)
+                        return r;
+        }
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_exit_container(message);
+        if (r < 0)
+                return r;
+
+        /* Now load the missing bits of all the units we just created in one go */
+        manager_dispatch_load_queue(m);
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(soss)");
+        if (r < 0)
+                return r;
+
+        FOREACH_ARRAY(e, entries, n_entries) {
+                _cleanup_free_ char *job_path = NULL;
+
+                if (e->unit) {
+                        r = transient_units_entry_start(message, e, mode, &job_path);
+                        if (r < 0 && !sd_bus_error_is_set(&e->error))
+                                sd_bus_error_set_errno(&e->error, r);
+                }
+
+                r = sd_bus_message_append(reply, "(soss)",
+                                          e->name,
+                                          job_path ?: "/",
+                                          strempty(e->error.name),
+                                          strempty(e->error.message));
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_message_send(reply);
+}
+
 static int method_get_job(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_free_ char *path = NULL;
         Manager *m = ASSERT_PTR(userdata);
@@ -1381,9 +1591,8 @@ static int dump_impl(
                 void *userdata,
                 sd_bus_error *error,
                 char **patterns,
-                int (*reply)(sd_bus_message *, char *)) {
+                int (*reply)(sd_bus_message *, Manager *, char **)) {
 
-        _cleanup_free_ char *dump = NULL;
         Manager *m = ASSERT_PTR(userdata);
         int r;
 
@@ -1417,11 +1626,7 @@ static int dump_impl(
                         return 1;
         }
 
-        r = manager_get_dump_string(m, patterns, &dump);
-        if (r < 0)
-                return r;
-
-        return reply(message, dump);
+        return reply(message, m, patterns);
 
 ratelimited:
         log_warning("Dump request rejected due to rate limit on unprivileged callers, blocked for %s.",
@@ -1432,7 +1637,14 @@ ratelimited:
                                  FORMAT_TIMESPAN(ratelimit_left(&m->dump_ratelimit), USEC_PER_SEC));
 }
 
-static int reply_dump(sd_bus_message *message, char *dump) {
+static int reply_dump(sd_bus_message *message, Manager *m, char **patterns) {
+        _cleanup_free_ char *dump = NULL;
+        int r;
+
+        r = manager_get_dump_string(m, patterns, &dump);
+        if (r < 0)
+                return r;
+
         return sd_bus_reply_method_return(message, "s", dump);
 }
 
@@ -1440,10 +1652,10 @@ static int method_dump(sd_bus_message *message, void *userdata, sd_bus_error *er
         return dump_impl(message, userdata, error, NULL, reply_dump);
 }
 
-static int reply_dump_by_fd(sd_bus_message *message, char *dump) {
+static int reply_dump_by_fd(sd_bus_message *message, Manager *m, char **patterns) {
         _cleanup_close_ int fd = -EBADF;
 
-        fd = memfd_new_and_seal_string("dump", dump);
+        fd = manager_get_dump_fd(m, patterns);
         if (fd < 0)
                 return fd;
 
@@ -1458,7 +1670,7 @@ static int dump_units_matching_patterns(
                 sd_bus_message *message,
                 void *userdata,
                 sd_bus_error *error,
-                int (*reply)(sd_bus_message *, char *)) {
+                int (*reply)(sd_bus_message *, Manager *, char **)) {
         _cleanup_strv_free_ char **patterns = NULL;
         int r;
 
@@ -3094,6 +3306,7 @@ const sd_bus_vtable bus_manager_vtable[] = {
         SD_BUS_PROPERTY("DefaultOOMScoreAdjust", "i", property_get_oom_score_adjust, 0, SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("CtrlAltDelBurstAction", "s", bus_property_get_emergency_action, offsetof(Manager, cad_burst_action), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("SoftRebootsCount", "u", bus_property_get_unsigned, offsetof(Manager, soft_reboots_count), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("NeedDaemonReload", "b", property_get_need_daemon_reload, 0, SD_BUS_VTABLE_PROPERTY_EXPLICIT),
 
         SD_BUS_METHOD_WITH_ARGS("GetUnit",
                                 SD_BUS_ARGS("s", name),
@@ -3235,6 +3448,11 @@ const sd_bus_vtable bus_manager_vtable[] = {
                                 SD_BUS_RESULT("o", job),
                                 method_start_transient_unit,
                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_ARGS("StartTransientUnits",
+                                SD_BUS_ARGS("s", mode, "a(sa(sv))", units),
+                                SD_BUS_RESULT("a(soss)", results),
+                                method_start_transient_units,
+                                SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_ARGS("GetUnitProcesses",
                                 SD_BUS_ARGS("s", name),
                                 SD_BUS_RESULT("a(sus)", processes),
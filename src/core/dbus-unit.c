@@ -1705,6 +1705,8 @@ void bus_unit_send_change_signal(Unit *u) {
         if (!u->id)
                 return;
 
+        unit_statistics_inc(u, n_change_signals);
+
         r = bus_foreach_bus(u->manager, u->bus_track, u->sent_dbus_new_signal ? send_changed_signal : send_new_signal, u);
         if (r < 0)
                 log_unit_debug_errno(u, r, "Failed to send unit change signal for %s: %m", u->id);
@@ -1805,26 +1807,11 @@ void bus_unit_send_removed_signal(Unit *u) {
                 log_unit_debug_errno(u, r, "Failed to send unit remove signal for %s: %m", u->id);
 }
 
-int bus_unit_queue_job_one(
-                sd_bus_message *message,
-                Unit *u,
-                JobType type,
-                JobMode mode,
-                BusUnitQueueFlags flags,
-                sd_bus_message *reply,
-                sd_bus_error *error) {
-
-        _cleanup_set_free_ Set *affected = NULL;
-        _cleanup_free_ char *job_path = NULL, *unit_path = NULL;
-        Job *j, *a;
-        int r;
+int bus_unit_check_job_allowed(Unit *u, JobType type, sd_bus_error *error) {
+        assert(u);
 
-        if (FLAGS_SET(flags, BUS_UNIT_QUEUE_RELOAD_IF_POSSIBLE) && unit_can_reload(u)) {
-                if (type == JOB_RESTART)
-                        type = JOB_RELOAD_OR_START;
-                else if (type == JOB_TRY_RESTART)
-                        type = JOB_TRY_RELOAD;
-        }
+        /* Checks whether a job of the specified type may be enqueued for the unit on behalf of a bus
+         * client, i.e. not as a dependency of some other job. */
 
         if (type == JOB_STOP && UNIT_IS_LOAD_ERROR(u->load_state) && unit_active_state(u) == UNIT_INACTIVE)
                 return sd_bus_error_setf(error, BUS_ERROR_NO_SUCH_UNIT, "Unit %s not loaded.", u->id);
@@ -1858,6 +1845,34 @@ int bus_unit_queue_job_one(
                                                          u->id);
                 }
 
+        return 0;
+}
+
+int bus_unit_queue_job_one(
+                sd_bus_message *message,
+                Unit *u,
+                JobType type,
+                JobMode mode,
+                BusUnitQueueFlags flags,
+                sd_bus_message *reply,
+                sd_bus_error *error) {
+
+        _cleanup_set_free_ Set *affected = NULL;
+        _cleanup_free_ char *job_path = NULL, *unit_path = NULL;
+        Job *j, *a;
+        int r;
+
+        if (FLAGS_SET(flags, BUS_UNIT_QUEUE_RELOAD_IF_POSSIBLE) && unit_can_reload(u)) {
+                if (type == JOB_RESTART)
+                        type = JOB_RELOAD_OR_START;
+                else if (type == JOB_TRY_RESTART)
+                        type = JOB_TRY_RELOAD;
+        }
+
+        r = bus_unit_check_job_allowed(u, type, error);
+        if (r < 0)
+                return r;
+
         if (FLAGS_SET(flags, BUS_UNIT_QUEUE_VERBOSE_REPLY)) {
                 affected = set_new(NULL);
                 if (!affected)
@@ -33,6 +33,7 @@ typedef enum BusUnitQueueFlags {
         BUS_UNIT_QUEUE_VERBOSE_REPLY                 = 1 << 1,
 } BusUnitQueueFlags;
 
+int bus_unit_check_job_allowed(Unit *u, JobType type, sd_bus_error *error);
 int bus_unit_queue_job_one(
                 sd_bus_message *message,
                 Unit *u,
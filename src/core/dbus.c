@@ -47,6 +47,9 @@
 
 #define CONNECTIONS_MAX 4096
 
+/* How long a direct connection may leave its queued messages unread before we give up on it */
+#define PRIVATE_BUS_STALL_TIMEOUT_USEC (30 * USEC_PER_SEC)
+
 static void destroy_bus(Manager *m, sd_bus **bus);
 
 void bus_send_pending_reload_message(Manager *m) {
@@ -305,6 +308,10 @@ static int find_unit(Manager *m, sd_bus *bus, const char *path, Unit **unit, sd_
                 assert(u);
         }
 
+        /* Note that this is called once for each matching interface of the object, hence this is a measure
+         * of activity rather than an exact count of messages */
+        unit_statistics_inc(u, n_bus_lookups);
+
         *unit = u;
         return 1;
 }
@@ -985,7 +992,7 @@ int bus_init_private(Manager *m) {
         return 0;
 }
 
-static void destroy_bus(Manager *m, sd_bus **bus) {
+static void destroy_bus_full(Manager *m, sd_bus **bus, bool flush) {
         Unit *u;
         Job *j;
 
@@ -1026,13 +1033,49 @@ static void destroy_bus(Manager *m, sd_bus **bus) {
 
         /* Possibly flush unwritten data, but only if we are
          * unprivileged, since we don't want to sync here */
-        if (!MANAGER_IS_SYSTEM(m))
+        if (flush && !MANAGER_IS_SYSTEM(m))
                 sd_bus_flush(*bus);
 
-        /* And destroy the object */
+        /* And destroy the object. This drops whatever is still queued for writing. */
         *bus = sd_bus_close_unref(*bus);
 }
 
+static void destroy_bus(Manager *m, sd_bus **bus) {
+        destroy_bus_full(m, bus, /* flush = */ true);
+}
+
+unsigned bus_done_stalled_private(Manager *m) {
+        unsigned n = 0;
+        usec_t ts;
+        sd_bus *b;
+
+        assert(m);
+
+        /* We stop generating signals while too many messages are queued for writing, see
+         * manager_dispatch_dbus_queue(). Hence a single direct client that stopped reading its messages
+         * would block all others. Disconnect clients that haven't read anything for a long time. */
+
+        ts = now(CLOCK_MONOTONIC);
+
+        SET_FOREACH(b, m->private_buses) {
+                usec_t since;
+
+                since = bus_get_write_stalled_since(b);
+                if (since == USEC_INFINITY || usec_add(since, PRIVATE_BUS_STALL_TIMEOUT_USEC) > ts)
+                        continue;
+
+                log_warning("Direct bus connection did not read its queued messages for %s, disconnecting.",
+                            FORMAT_TIMESPAN(ts - since, USEC_PER_SEC));
+
+                /* Never flush here: the peer stopped reading, hence that would block us indefinitely */
+                assert_se(set_remove(m->private_buses, b) == b);
+                destroy_bus_full(m, &b, /* flush = */ false);
+                n++;
+        }
+
+        return n;
+}
+
 void bus_done_api(Manager *m) {
         destroy_bus(m, &m->api_bus);
 }
@@ -12,6 +12,7 @@ int bus_init_api(Manager *m);
 int bus_init_system(Manager *m);
 
 void bus_done_private(Manager *m);
+unsigned bus_done_stalled_private(Manager *m);
 void bus_done_api(Manager *m);
 void bus_done_system(Manager *m);
 void bus_done(Manager *m);
@@ -445,8 +445,15 @@ struct load_cred_args {
         gid_t gid;
         bool ownership_ok;
         uint64_t left;
+        Tpm2Context *tpm2_context;
 };
 
+static void load_cred_args_done(struct load_cred_args *args) {
+        assert(args);
+
+        args->tpm2_context = tpm2_context_unref(args->tpm2_context);
+}
+
 static int maybe_decrypt_and_write_credential(
                 struct load_cred_args *args,
                 const char *id,
@@ -467,11 +474,12 @@ static int maybe_decrypt_and_write_credential(
 
                 case RUNTIME_SCOPE_SYSTEM:
                         /* In system mode talk directly to the TPM */
-                        r = decrypt_credential_and_warn(
+                        r = decrypt_credential_and_warn_full(
                                         id,
                                         now(CLOCK_REALTIME),
                                         /* tpm2_device= */ NULL,
                                         /* tpm2_signature_path= */ NULL,
+                                        &args->tpm2_context,
                                         getuid(),
                                         &IOVEC_MAKE(data, size),
                                         CREDENTIAL_ANY_SCOPE,
@@ -783,7 +791,7 @@ static int acquire_credentials(
         if (r < 0)
                 return r;
 
-        struct load_cred_args args = {
+        _cleanup_(load_cred_args_done) struct load_cred_args args = {
                 .context = context,
                 .params = params,
                 .unit = unit,
@@ -150,9 +150,9 @@ static int parse_argv(int argc, char *argv[]) {
                                                        "Failed to set serialization fd %d to close-on-exec: %m",
                                                        fd);
 
-                        f = take_fdopen(&fd, "r");
-                        if (!f)
-                                return log_error_errno(errno, "Failed to open serialization fd %d: %m", fd);
+                        r = take_fdopen_unlocked(&fd, "r", &f);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to open serialization fd %d: %m", fd);
 
                         safe_fclose(arg_serialization);
                         arg_serialization = f;
@@ -132,6 +132,16 @@ Job* job_free(Job *j) {
         return mfree(j);
 }
 
+static bool job_is_limited_start(Job *j) {
+        assert(j);
+
+        /* Which jobs StartJobsMax= applies to. Only services do substantial work while starting up, start
+         * jobs of other unit types either complete right away or wait for some external event (think
+         * devices showing up), and shouldn't take away slots from services. */
+
+        return j->type == JOB_START && j->unit->type == UNIT_SERVICE;
+}
+
 static void job_set_state(Job *j, JobState state) {
         assert(j);
         assert(j->manager);
@@ -146,9 +156,14 @@ static void job_set_state(Job *j, JobState state) {
         if (!j->installed)
                 return;
 
-        if (j->state == JOB_RUNNING)
+        if (j->state == JOB_RUNNING) {
                 j->manager->n_running_jobs++;
-        else {
+
+                if (job_is_limited_start(j)) {
+                        j->manager->n_running_start_jobs++;
+                        j->counted_as_start = true;
+                }
+        } else {
                 assert(j->state == JOB_WAITING);
                 assert(j->manager->n_running_jobs > 0);
 
@@ -156,9 +171,29 @@ static void job_set_state(Job *j, JobState state) {
 
                 if (j->manager->n_running_jobs <= 0)
                         j->manager->jobs_in_progress_event_source = sd_event_source_disable_unref(j->manager->jobs_in_progress_event_source);
+
+                if (j->counted_as_start) {
+                        assert(j->manager->n_running_start_jobs > 0);
+
+                        j->manager->n_running_start_jobs--;
+                        j->counted_as_start = false;
+
+                        /* A slot became free, give the start jobs we held back another chance */
+                        manager_requeue_held_back_start_jobs(j->manager);
+                }
         }
 }
 
+static void job_remove_from_held_back_queue(Job *j) {
+        assert(j);
+
+        if (!j->in_held_back_queue)
+                return;
+
+        LIST_REMOVE(held_back_queue, j->manager->held_back_queue, j);
+        j->in_held_back_queue = false;
+}
+
 void job_uninstall(Job *j) {
         Job **pj;
 
@@ -166,6 +201,7 @@ void job_uninstall(Job *j) {
         assert(j->installed);
 
         job_set_state(j, JOB_WAITING);
+        job_remove_from_held_back_queue(j);
 
         pj = j->type == JOB_NOP ? &j->unit->nop_job : &j->unit->job;
         assert(*pj == j);
@@ -322,9 +358,15 @@ int job_install_deserialized(Job *j) {
         *pj = j;
         j->installed = true;
 
-        if (j->state == JOB_RUNNING)
+        if (j->state == JOB_RUNNING) {
                 j->manager->n_running_jobs++;
 
+                if (job_is_limited_start(j)) {
+                        j->manager->n_running_start_jobs++;
+                        j->counted_as_start = true;
+                }
+        }
+
         log_unit_debug(j->unit,
                        "Reinstalled deserialized job %s/%s as %u",
                        j->unit->id, job_type_to_string(j->type), (unsigned) j->id);
@@ -918,12 +960,25 @@ int job_run_and_invalidate(Job *j) {
         prioq_remove(j->manager->run_queue, j, &j->run_queue_idx);
         j->in_run_queue = false;
 
+        job_remove_from_held_back_queue(j);
+
         if (j->state != JOB_WAITING)
                 return 0;
 
         if (!job_is_runnable(j))
                 return -EAGAIN;
 
+        if (job_is_limited_start(j) &&
+            j->manager->start_jobs_max > 0 &&
+            j->manager->n_running_start_jobs >= j->manager->start_jobs_max) {
+                log_unit_debug(j->unit, "starting held back, %u start jobs running already.", j->manager->n_running_start_jobs);
+
+                /* We'll be requeued once one of the running start jobs is done */
+                LIST_PREPEND(held_back_queue, j->manager->held_back_queue, j);
+                j->in_held_back_queue = true;
+                return -EAGAIN;
+        }
+
         job_start_timer(j, true);
         job_set_state(j, JOB_RUNNING);
         job_add_to_dbus_queue(j);
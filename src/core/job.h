@@ -122,6 +122,7 @@ struct Job {
         LIST_FIELDS(Job, transaction);
         LIST_FIELDS(Job, dbus_queue);
         LIST_FIELDS(Job, gc_queue);
+        LIST_FIELDS(Job, held_back_queue);
 
         LIST_HEAD(JobDependency, subject_list);
         LIST_HEAD(JobDependency, object_list);
@@ -170,6 +171,9 @@ struct Job {
         bool ref_by_private_bus:1;
 
         bool in_gc_queue:1;
+
+        bool counted_as_start:1; /* Included in Manager.n_running_start_jobs */
+        bool in_held_back_queue:1; /* Held back due to StartJobsMax= */
 };
 
 Job* job_new(Unit *unit, JobType type);
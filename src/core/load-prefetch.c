@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "alloc-util.h"
+#include "cpu-set-util.h"
+#include "fd-util.h"
+#include "load-prefetch.h"
+#include "log.h"
+#include "manager.h"
+#include "set.h"
+#include "unit-file.h"
+#include "unit.h"
+
+/* Below this many queued units it's not worth spawning threads */
+#define PREFETCH_UNITS_MIN 64U
+#define PREFETCH_THREADS_MAX 8U
+
+typedef struct PrefetchQueue {
+        char **paths;
+        size_t n_paths;
+        size_t next; /* Index of the next path to pick, shared between the threads */
+} PrefetchQueue;
+
+static void* prefetch_thread(void *userdata) {
+        PrefetchQueue *q = ASSERT_PTR(userdata);
+
+        /* This runs on a separate thread of PID1, hence only plain system calls here: no memory allocation
+         * (our mempool is not thread-safe), no logging. */
+
+        for (;;) {
+                size_t i;
+                int fd;
+
+                i = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+                if (i >= q->n_paths)
+                        break;
+
+                fd = open(q->paths[i], O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NONBLOCK);
+                if (fd < 0)
+                        continue;
+
+                (void) posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+                safe_close(fd);
+        }
+
+        return NULL;
+}
+
+unsigned manager_prefetch_load_queue(Manager *m) {
+        _cleanup_set_free_ Set *paths = NULL;
+        _cleanup_free_ char **l = NULL;
+        pthread_t threads[PREFETCH_THREADS_MAX];
+        unsigned n_queued = 0, n_threads = 0;
+        sigset_t ss, saved_ss;
+        int r;
+
+        assert(m);
+
+        /* Parsing unit files mutates unit and manager state all over the place, and hence has to stay on the
+         * main thread. The I/O doesn't: with thousands of unit files and a cold cache, the loader otherwise
+         * waits for each open() and read() in turn. Hence, open the unit files of everything that is
+         * currently queued from a couple of threads, and let the kernel read them ahead, so that the loader
+         * finds them in the page cache afterwards. Returns the number of queued units looked at. */
+
+        LIST_FOREACH(load_queue, u, m->load_queue)
+                n_queued++;
+
+        if (n_queued < PREFETCH_UNITS_MIN)
+                return n_queued;
+
+        r = unit_file_build_name_map(&m->lookup_paths,
+                                     &m->unit_cache_timestamp_hash,
+                                     &m->unit_id_map,
+                                     &m->unit_name_map,
+                                     &m->unit_path_cache);
+        if (r < 0)
+                return n_queued; /* The loader will complain about it */
+
+        LIST_FOREACH(load_queue, u, m->load_queue) {
+                const char *fragment = NULL;
+
+                if (u->transient || u->load_state != UNIT_STUB)
+                        continue;
+
+                if (unit_file_find_fragment(m->unit_id_map, m->unit_name_map, u->id, &fragment, /* ret_names= */ NULL) < 0 ||
+                    !fragment)
+                        continue;
+
+                /* Instances share the fragment of their template, no need to read it more than once */
+                if (set_ensure_put(&paths, &path_hash_ops, fragment) < 0)
+                        return n_queued;
+        }
+
+        if (set_size(paths) < PREFETCH_UNITS_MIN)
+                return n_queued;
+
+        l = set_get_strv(paths);
+        if (!l)
+                return n_queued;
+
+        PrefetchQueue q = {
+                .paths = l,
+                .n_paths = set_size(paths),
+        };
+
+        r = cpus_in_affinity_mask();
+        unsigned n_threads_max = r > 0 ? MIN((unsigned) r, PREFETCH_THREADS_MAX) : 1;
+
+        /* Make sure no signal is ever delivered to the helper threads */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return n_queued;
+
+        for (; n_threads < n_threads_max; n_threads++)
+                if (pthread_create(threads + n_threads, NULL, prefetch_thread, &q) != 0)
+                        break;
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        /* If no thread could be created, do the work ourselves, that still gets the reads queued in parallel */
+        if (n_threads == 0)
+                (void) prefetch_thread(&q);
+
+        for (unsigned i = 0; i < n_threads; i++)
+                assert_se(pthread_join(threads[i], NULL) == 0);
+
+        log_debug("Prefetched %zu unit files of %u queued units using %u threads.", q.n_paths, n_queued, n_threads);
+
+        return n_queued;
+}
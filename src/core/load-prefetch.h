@@ -0,0 +1,7 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+typedef struct Manager Manager;
+
+/* Reads the unit files of the units currently in the load queue into the page cache, in parallel */
+unsigned manager_prefetch_load_queue(Manager *m);
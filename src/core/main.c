@@ -161,6 +161,7 @@ static void *arg_random_seed;
 static size_t arg_random_seed_size;
 static usec_t arg_reload_limit_interval_sec;
 static unsigned arg_reload_limit_burst;
+static unsigned arg_start_jobs_max;
 
 /* A copy of the original environment block */
 static char **saved_env = NULL;
@@ -820,6 +821,7 @@ static int parse_config_file(void) {
                 { "Manager", "DefaultOOMScoreAdjust",        config_parse_oom_score_adjust,      0,                        NULL                              },
                 { "Manager", "ReloadLimitIntervalSec",       config_parse_sec,                   0,                        &arg_reload_limit_interval_sec    },
                 { "Manager", "ReloadLimitBurst",             config_parse_unsigned,              0,                        &arg_reload_limit_burst           },
+                { "Manager", "StartJobsMax",                 config_parse_unsigned,              0,                        &arg_start_jobs_max               },
 #if ENABLE_SMACK
                 { "Manager", "DefaultSmackProcessLabel",     config_parse_string,                0,                        &arg_defaults.smack_process_label },
 #else
@@ -905,6 +907,7 @@ static void set_manager_settings(Manager *m) {
          * counter on every daemon-reload. */
         m->reload_reexec_ratelimit.interval = arg_reload_limit_interval_sec;
         m->reload_reexec_ratelimit.burst = arg_reload_limit_burst;
+        manager_set_start_jobs_max(m, arg_start_jobs_max);
 
         manager_set_watchdog(m, WATCHDOG_RUNTIME, arg_runtime_watchdog);
         manager_set_watchdog(m, WATCHDOG_REBOOT, arg_reboot_watchdog);
@@ -1117,9 +1120,9 @@ static int parse_argv(int argc, char *argv[]) {
 
                         (void) fd_cloexec(fd, true);
 
-                        f = fdopen(fd, "r");
-                        if (!f)
-                                return log_error_errno(errno, "Failed to open serialization fd %d: %m", fd);
+                        r = fdopen_unlocked(fd, "r", &f);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to open serialization fd %d: %m", fd);
 
                         safe_fclose(arg_serialization);
                         arg_serialization = f;
@@ -2764,6 +2767,7 @@ static void reset_arguments(void) {
 
         arg_reload_limit_interval_sec = 0;
         arg_reload_limit_burst = 0;
+        arg_start_jobs_max = 0;
 }
 
 static void determine_default_oom_score_adjust(void) {
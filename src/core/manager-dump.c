@@ -1,11 +1,16 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "build.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "hashmap.h"
 #include "manager-dump.h"
+#include "memfd-util.h"
 #include "memstream-util.h"
+#include "missing_mman.h"
 #include "unit-serialize.h"
 #include "version.h"
 
@@ -111,6 +116,48 @@ int manager_get_dump_string(Manager *m, char **patterns, char **ret) {
         return memstream_finalize(&ms, ret, NULL);
 }
 
+int manager_get_dump_fd(Manager *m, char **patterns) {
+        _cleanup_close_ int fd = -EBADF, copy = -EBADF;
+        _cleanup_fclose_ FILE *f = NULL;
+        int r;
+
+        assert(m);
+
+        /* Like manager_get_dump_string(), but writes the dump directly into a sealed memfd, instead of
+         * building it up on the heap first and then copying it over. The dump can be several MB on
+         * systems with many units. */
+
+        fd = memfd_new_full("dump", MFD_ALLOW_SEALING);
+        if (fd < 0)
+                return fd;
+
+        copy = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+        if (copy < 0)
+                return -errno;
+
+        r = take_fdopen_unlocked(&copy, "w", &f);
+        if (r < 0)
+                return r;
+
+        manager_dump(m, f, patterns, NULL);
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        f = safe_fclose(f);
+
+        /* The file offset is shared with the receiver, hence rewind */
+        if (lseek(fd, 0, SEEK_SET) < 0)
+                return -errno;
+
+        r = memfd_set_sealed(fd);
+        if (r < 0)
+                return r;
+
+        return TAKE_FD(fd);
+}
+
 void manager_test_summary(Manager *m) {
         assert(m);
 
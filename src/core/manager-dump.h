@@ -10,4 +10,5 @@ int manager_get_dump_jobs_string(Manager *m, char **patterns, const char *prefix
 void manager_dump_units(Manager *s, FILE *f, char **patterns, const char *prefix);
 void manager_dump(Manager *s, FILE *f, char **patterns, const char *prefix);
 int manager_get_dump_string(Manager *m, char **patterns, char **ret);
+int manager_get_dump_fd(Manager *m, char **patterns);
 void manager_test_summary(Manager *m);
@@ -32,6 +32,7 @@
 #include "clean-ipc.h"
 #include "clock-util.h"
 #include "common-signal.h"
+#include "conf-files.h"
 #include "confidential-virt.h"
 #include "constants.h"
 #include "core-varlink.h"
@@ -59,6 +60,7 @@
 #include "iovec-util.h"
 #include "label-util.h"
 #include "load-fragment.h"
+#include "load-prefetch.h"
 #include "locale-setup.h"
 #include "log.h"
 #include "macro.h"
@@ -118,6 +120,9 @@
 /* How many units and jobs to process of the bus queue before returning to the event loop. */
 #define MANAGER_BUS_MESSAGE_BUDGET 100U
 
+/* How many notification messages to process per event loop iteration at most. */
+#define NOTIFY_MESSAGES_PER_DISPATCH_MAX 16U
+
 #define DEFAULT_TASKS_MAX ((CGroupTasksMax) { 15U, 100U }) /* 15% */
 
 static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
@@ -927,6 +932,7 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
 
                 .have_ask_password = -EINVAL, /* we don't know */
                 .first_boot = -1,
+                .need_daemon_reload = -1,
                 .test_run_flags = test_run_flags,
 
                 .dump_ratelimit = (const RateLimit) { .interval = 10 * USEC_PER_MINUTE, .burst = 10 },
@@ -958,6 +964,11 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
                 m->invocation_log_format_string = "USER_INVOCATION_ID=%s";
         }
 
+        r = secure_getenv_bool("SYSTEMD_UNIT_STATISTICS");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_UNIT_STATISTICS, ignoring: %m");
+        m->unit_statistics = r > 0;
+
         /* Reboot immediately if the user hits C-A-D more often than 7x per 2s */
         m->ctrl_alt_del_ratelimit = (const RateLimit) { .interval = 2 * USEC_PER_SEC, .burst = 7 };
 
@@ -1050,6 +1061,11 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
                 }
                 if (r < 0 && r != -EEXIST)
                         return r;
+
+                /* We look up the same drop-in directories for every unit we load, hence cache them */
+                r = conf_files_cache_set_enabled(true);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to enable configuration directory cache, ignoring: %m");
         }
 
         if (!FLAGS_SET(test_run_flags, MANAGER_TEST_DONT_OPEN_EXECUTOR)) {
@@ -1057,12 +1073,12 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
                 if (m->executor_fd < 0)
                         return log_debug_errno(m->executor_fd, "Failed to pin executor binary: %m");
 
-                if (DEBUG_LOGGING) {
-                        _cleanup_free_ char *executor_path = NULL;
+                /* Resolve the path once, rather than for every process we spawn */
+                r = fd_get_path(m->executor_fd, &m->executor_path);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to get path of executor binary: %m");
 
-                        (void) fd_get_path(m->executor_fd, &executor_path);
-                        log_debug("Using systemd-executor binary from '%s'.", strna(executor_path));
-                }
+                log_debug("Using systemd-executor binary from '%s'.", m->executor_path);
         }
 
         /* Note that we do not set up the notify fd here. We do that after deserialization,
@@ -1491,6 +1507,7 @@ static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
         while ((u = LIST_POP(gc_queue, m->gc_unit_queue))) {
                 assert(u->in_gc_queue);
 
+                unit_statistics_inc(u, n_gc_checks);
                 unit_gc_sweep(u, gc_marker);
 
                 u->in_gc_queue = false;
@@ -1726,6 +1743,7 @@ static void manager_clear_jobs_and_units(Manager *m) {
 
         m->n_on_console = 0;
         m->n_running_jobs = 0;
+        m->n_running_start_jobs = 0;
         m->n_installed_jobs = 0;
         m->n_failed_jobs = 0;
 }
@@ -1824,11 +1842,15 @@ Manager* manager_free(Manager *m) {
 
         m->fw_ctx = fw_ctx_free(m->fw_ctx);
 
+        assert(hashmap_isempty(m->bpf_firewall_policies));
+        hashmap_free(m->bpf_firewall_policies);
+
 #if BPF_FRAMEWORK
         bpf_restrict_fs_destroy(m->restrict_fs);
 #endif
 
         safe_close(m->executor_fd);
+        free(m->executor_path);
 
         return mfree(m);
 }
@@ -2360,7 +2382,7 @@ static int manager_dispatch_target_deps_queue(Manager *m) {
 
 unsigned manager_dispatch_load_queue(Manager *m) {
         Unit *u;
-        unsigned n = 0;
+        unsigned n = 0, n_prefetched = 0;
 
         assert(m);
 
@@ -2376,6 +2398,11 @@ unsigned manager_dispatch_load_queue(Manager *m) {
         while ((u = m->load_queue)) {
                 assert(u->in_load_queue);
 
+                /* Loading units queues their dependencies, hence whenever we are through with the units
+                 * we prefetched for, do so again for whatever accumulated in the meantime. */
+                if (n >= n_prefetched)
+                        n_prefetched = n + MAX(manager_prefetch_load_queue(m), 1u);
+
                 unit_load(u);
                 n++;
         }
@@ -2407,6 +2434,58 @@ bool manager_unit_cache_should_retry_load(Unit *u) {
         return !lookup_paths_timestamp_hash_same(&u->manager->lookup_paths, u->manager->unit_cache_timestamp_hash, NULL);
 }
 
+static bool manager_need_daemon_reload_uncached(Manager *m) {
+        Unit *u;
+        char *k;
+
+        assert(m);
+
+        /* Returns true if a daemon-reload would pick up any changed unit configuration: any unit whose
+         * fragment, source file or drop-ins changed, or the unit directories themselves. Note that inputs of
+         * generators (e.g. /etc/fstab) are not covered, but those are not unit configuration as such. */
+
+        if (m->unit_file_state_outdated)
+                return true;
+
+        if (m->unit_cache_timestamp_hash != 0 &&
+            !lookup_paths_timestamp_hash_same(&m->lookup_paths, m->unit_cache_timestamp_hash, NULL))
+                return true;
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                /* ignore aliases */
+                if (u->id != k)
+                        continue;
+
+                if (unit_need_daemon_reload(u))
+                        return true;
+        }
+
+        return false;
+}
+
+bool manager_need_daemon_reload(Manager *m) {
+        uint64_t iteration;
+
+        assert(m);
+
+        /* The above stat()s the files of every loaded unit. Clients tend to get the property through
+         * GetAll(), often many of them in response to the same signal, hence remember the result for the
+         * current event loop iteration. */
+
+        if (m->unit_file_state_outdated)
+                return true;
+
+        if (!m->event || sd_event_get_iteration(m->event, &iteration) < 0)
+                return manager_need_daemon_reload_uncached(m);
+
+        if (m->need_daemon_reload < 0 || m->need_daemon_reload_iteration != iteration) {
+                m->need_daemon_reload = manager_need_daemon_reload_uncached(m);
+                m->need_daemon_reload_iteration = iteration;
+        }
+
+        return m->need_daemon_reload;
+}
+
 int manager_load_unit_prepare(
                 Manager *m,
                 const char *name,
@@ -2596,6 +2675,33 @@ void manager_trigger_run_queue(Manager *m) {
                 log_warning_errno(r, "Failed to enable job run queue event source, ignoring: %m");
 }
 
+void manager_requeue_held_back_start_jobs(Manager *m) {
+        Job *j;
+
+        assert(m);
+
+        /* Let's simply put all start jobs we held back into the run queue again, the run queue is ordered by
+         * unit priority and job_run_and_invalidate() will hold back whatever doesn't fit in again. */
+        while ((j = m->held_back_queue)) {
+                LIST_REMOVE(held_back_queue, m->held_back_queue, j);
+                j->in_held_back_queue = false;
+
+                job_add_to_run_queue(j);
+        }
+}
+
+void manager_set_start_jobs_max(Manager *m, unsigned n) {
+        assert(m);
+
+        if (m->start_jobs_max == n)
+                return;
+
+        m->start_jobs_max = n;
+
+        /* The limit might have been raised or lifted */
+        manager_requeue_held_back_start_jobs(m);
+}
+
 static unsigned manager_dispatch_dbus_queue(Manager *m) {
         unsigned n = 0, budget;
         Unit *u;
@@ -2613,8 +2719,11 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                         return 0;
 
                 /* Do we have overly many messages queued at the moment? If so, let's not enqueue more on top, let's
-                 * sit this cycle out, and process things in a later cycle when the queues got a bit emptier. */
-                if (manager_bus_n_queued_write(m) > MANAGER_BUS_BUSY_THRESHOLD)
+                 * sit this cycle out, and process things in a later cycle when the queues got a bit emptier. But
+                 * first get rid of direct clients that stopped reading altogether, so that they cannot hold
+                 * up everybody else. */
+                if (manager_bus_n_queued_write(m) > MANAGER_BUS_BUSY_THRESHOLD &&
+                    (bus_done_stalled_private(m) == 0 || manager_bus_n_queued_write(m) > MANAGER_BUS_BUSY_THRESHOLD))
                         return 0;
 
                 /* Only process a certain number of units/jobs per event loop iteration. Even if the bus queue wasn't
@@ -2730,6 +2839,8 @@ static void manager_invoke_notify_message(
                 return;
         u->notifygen = m->notifygen;
 
+        unit_statistics_inc(u, n_notify_messages);
+
         if (UNIT_VTABLE(u)->notify_message)
                 UNIT_VTABLE(u)->notify_message(u, pidref, ucred, tags, fds);
 
@@ -2795,8 +2906,7 @@ static int manager_get_units_for_pidref(Manager *m, const PidRef *pidref, Unit *
         return (int) n;
 }
 
-static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
+static int manager_receive_notify_message(Manager *m) {
         char buf[NOTIFY_BUFFER_MAX+1];
         struct iovec iovec = {
                 .iov_base = buf,
@@ -2813,23 +2923,21 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         ssize_t n;
         int r;
 
-        assert(m->notify_fd == fd);
+        assert(m);
 
-        if (revents != EPOLLIN) {
-                log_warning("Got unexpected poll event for notify fd.");
-                return 0;
-        }
+        /* Returns 0 if there's nothing to read, 1 if a message was read (and either processed or ignored),
+         * and negative on a real error on the socket. */
 
         n = recvmsg_safe(m->notify_fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
         if (ERRNO_IS_NEG_TRANSIENT(n))
                 return 0; /* Spurious wakeup, try again */
         if (n == -ECHRNG) {
                 log_warning_errno(n, "Got message with truncated control data (too many fds sent?), ignoring.");
-                return 0;
+                return 1;
         }
         if (n == -EXFULL) {
                 log_warning_errno(n, "Got message with truncated payload data, ignoring.");
-                return 0;
+                return 1;
         }
         if (n < 0)
                 /* If this is any other, real error, then stop processing this socket. This of course means
@@ -2872,13 +2980,13 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
                 if (r < 0) {
                         close_many(fd_array, n_fds);
                         log_oom_warning();
-                        return 0;
+                        return 1;
                 }
         }
 
         if (!ucred || !pid_is_valid(ucred->pid)) {
                 log_warning("Received notify message without valid credentials. Ignoring.");
-                return 0;
+                return 1;
         }
 
         _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
@@ -2892,7 +3000,7 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
                         log_debug_errno(r, "Notify sender died before message is processed. Ignoring.");
                 else
                         log_warning_errno(r, "Failed to pin notify sender, ignoring message: %m");
-                return 0;
+                return 1;
         }
 
         if (pidref.pid != ucred->pid) {
@@ -2900,14 +3008,14 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
 
                 log_warning("Got SCM_PIDFD for process " PID_FMT " but SCM_CREDENTIALS for process " PID_FMT ". Ignoring.",
                             pidref.pid, ucred->pid);
-                return 0;
+                return 1;
         }
 
         /* As extra safety check, let's make sure the string we get doesn't contain embedded NUL bytes.
          * We permit one trailing NUL byte in the message, but don't expect it. */
         if (n > 1 && memchr(buf, 0, n-1)) {
                 log_warning("Received notify message with embedded NUL bytes. Ignoring.");
-                return 0;
+                return 1;
         }
 
         /* Make sure it's NUL-terminated, then parse it to obtain the tags list. */
@@ -2916,13 +3024,13 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         _cleanup_strv_free_ char **tags = strv_split_newlines(buf);
         if (!tags) {
                 log_oom_warning();
-                return 0;
+                return 1;
         }
 
         /* Possibly a barrier fd, let's see. */
         if (manager_process_barrier_fd(tags, fds)) {
                 log_debug("Received barrier notification message from PID " PID_FMT ".", ucred->pid);
-                return 0;
+                return 1;
         }
 
         /* Increase the generation counter used for filtering out duplicate unit invocations. */
@@ -2934,7 +3042,7 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         int n_array = manager_get_units_for_pidref(m, &pidref, &array);
         if (n_array < 0) {
                 log_warning_errno(n_array, "Failed to determine units for PID " PID_FMT ", ignoring: %m", ucred->pid);
-                return 0;
+                return 1;
         }
         if (n_array == 0)
                 log_debug("Cannot find unit for notify message of PID "PID_FMT", ignoring.", ucred->pid);
@@ -2947,6 +3055,32 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         if (!fdset_isempty(fds))
                 log_warning("Got extra auxiliary fds with notification message, closing them.");
 
+        return 1;
+}
+
+static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(m->notify_fd == fd);
+
+        if (revents != EPOLLIN) {
+                log_warning("Got unexpected poll event for notify fd.");
+                return 0;
+        }
+
+        /* Services sending frequent STATUS= or WATCHDOG=1 updates would otherwise cost us a full event loop
+         * iteration per datagram. Hence process a couple of queued messages in one go. This also means that
+         * repeated property changes of the same unit are coalesced into a single PropertiesChanged signal,
+         * since the D-Bus queue is only dispatched once we get back to the event loop. Don't drain the
+         * socket entirely though, so that event sources with a higher priority which became pending in the
+         * meantime still get their turn quickly. */
+        for (unsigned i = 0; i < NOTIFY_MESSAGES_PER_DISPATCH_MAX; i++) {
+                r = manager_receive_notify_message(m);
+                if (r <= 0)
+                        return r;
+        }
+
         return 0;
 }
 
@@ -3783,6 +3917,11 @@ int manager_reload(Manager *m) {
         /* We flushed out generated files, for which we don't watch mtime, so we should flush the old map. */
         manager_free_unit_name_maps(m);
         m->unit_file_state_outdated = false;
+        m->need_daemon_reload = -1;
+
+        /* Directories might have been mounted over (e.g. by systemd-sysext), which inotify does not tell us
+         * about, hence start from scratch. */
+        conf_files_cache_flush();
 
         /* First, enumerate what we can from kernel and suchlike */
         manager_enumerate_perpetual(m);
@@ -306,6 +306,11 @@ struct Manager {
          * unit's NeedDaemonReload property. */
         bool unit_file_state_outdated;
 
+        /* Cached result of manager_need_daemon_reload(), valid in the event loop iteration it was
+         * determined in */
+        int need_daemon_reload;
+        uint64_t need_daemon_reload_iteration;
+
         char **transient_environment;  /* The environment, as determined from config files, kernel cmdline and environment generators */
         char **client_environment;     /* Environment variables created by clients through the bus API */
 
@@ -323,6 +328,7 @@ struct Manager {
         /* Data specific to the mount subsystem */
         struct libmnt_monitor *mount_monitor;
         sd_event_source *mount_event_source;
+        Hashmap *mount_unit_names_by_id; /* Mount ID + 1 → name of the mount unit, as of the last scan */
 
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
@@ -403,6 +409,9 @@ struct Manager {
         /* Have we ever changed the "kernel.pid_max" sysctl? */
         bool sysctl_pid_max_changed;
 
+        /* Shall we count the work done on behalf of each unit? See UnitStatistics. */
+        bool unit_statistics;
+
         ManagerTestRunFlags test_run_flags;
 
         /* If non-zero, exit with the following value when the systemd
@@ -432,6 +441,9 @@ struct Manager {
 
         /* Jobs in progress watching */
         unsigned n_running_jobs;
+        unsigned n_running_start_jobs; /* Running start jobs of services */
+        unsigned start_jobs_max; /* StartJobsMax=, 0 if unlimited */
+        LIST_HEAD(Job, held_back_queue); /* Start jobs we held back due to start_jobs_max */
         unsigned n_on_console;
         unsigned jobs_in_progress_iteration;
 
@@ -498,6 +510,10 @@ struct Manager {
         /* Reference to RestrictFileSystems= BPF program */
         struct restrict_fs_bpf *restrict_fs;
 
+        /* IP firewall programs shared by units with the same access policy and no IP accounting, keyed
+         * by the policy */
+        Hashmap *bpf_firewall_policies;
+
         /* Allow users to configure a rate limit for Reload()/Reexecute() operations */
         RateLimit reload_reexec_ratelimit;
         /* Dump*() are slow, so always rate limit them to 10 per 10 minutes */
@@ -511,6 +527,7 @@ struct Manager {
         /* Pin the systemd-executor binary, so that it never changes until re-exec, ensuring we don't have
          * serialization/deserialization compatibility issues during upgrades. */
         int executor_fd;
+        char *executor_path; /* The path the pinned binary was found at, passed as argv[0] on each spawn */
 
         unsigned soft_reboots_count;
 
@@ -553,6 +570,7 @@ Unit *manager_get_unit(Manager *m, const char *name);
 int manager_get_job_from_dbus_path(Manager *m, const char *s, Job **_j);
 
 bool manager_unit_cache_should_retry_load(Unit *u);
+bool manager_need_daemon_reload(Manager *m);
 int manager_load_unit_prepare(Manager *m, const char *name, const char *path, sd_bus_error *e, Unit **ret);
 int manager_load_unit(Manager *m, const char *name, const char *path, sd_bus_error *e, Unit **ret);
 int manager_load_startable_unit_or_warn(Manager *m, const char *name, const char *path, Unit **ret);
@@ -596,6 +614,8 @@ int manager_get_effective_environment(Manager *m, char ***ret);
 int manager_set_unit_defaults(Manager *m, const UnitDefaults *defaults);
 
 void manager_trigger_run_queue(Manager *m);
+void manager_requeue_held_back_start_jobs(Manager *m);
+void manager_set_start_jobs_max(Manager *m, unsigned n);
 
 int manager_loop(Manager *m);
 
@@ -1819,11 +1819,12 @@ static int mount_setup_unit(
                 const char *where,
                 const char *options,
                 const char *fstype,
-                bool set_flags) {
+                bool set_flags,
+                char **unit_name) {
 
         _cleanup_free_ char *e = NULL;
         MountProcFlags flags;
-        Unit *u;
+        Unit *u = NULL;
         int r;
 
         assert(m);
@@ -1831,31 +1832,49 @@ static int mount_setup_unit(
         assert(where);
         assert(options);
         assert(fstype);
+        assert(unit_name);
+
+        /* If *unit_name is set on input, it is the unit the same mount belonged to when we looked last
+         * time. In that case we can skip the checks below and the escaping of the path, which otherwise
+         * add up with thousands of mounts. Mount IDs are recycled though, hence check that it actually is
+         * the same mount point still. Returns the name of the unit in *unit_name, if any. */
+        if (*unit_name) {
+                Mount *mount = MOUNT(manager_get_unit(m, *unit_name));
+
+                if (mount && streq_ptr(mount->where, where) && !streq(fstype, "autofs")) {
+                        u = UNIT(mount);
+                        e = TAKE_PTR(*unit_name);
+                } else
+                        *unit_name = mfree(*unit_name);
+        }
 
-        /* Ignore API and credential mount points. They should never be referenced in dependencies ever.
-         * Furthermore, the lifetime of credential mounts is strictly bound to the owning services,
-         * so mount units make little sense for them. */
-        if (mount_point_is_api(where) || mount_point_ignore(where) ||
-            mount_point_is_credentials(m->prefix[EXEC_DIRECTORY_RUNTIME], where))
-                return 0;
+        if (!u) {
+                /* Ignore API and credential mount points. They should never be referenced in dependencies
+                 * ever. Furthermore, the lifetime of credential mounts is strictly bound to the owning
+                 * services, so mount units make little sense for them. */
+                if (mount_point_is_api(where) || mount_point_ignore(where) ||
+                    mount_point_is_credentials(m->prefix[EXEC_DIRECTORY_RUNTIME], where))
+                        return 0;
 
-        if (streq(fstype, "autofs"))
-                return 0;
+                if (streq(fstype, "autofs"))
+                        return 0;
 
-        /* probably some kind of swap, ignore */
-        if (!is_path(where))
-                return 0;
+                /* probably some kind of swap, ignore */
+                if (!is_path(where))
+                        return 0;
+
+                r = unit_name_from_path(where, ".mount", &e);
+                if (r < 0)
+                        return log_struct_errno(
+                                        LOG_WARNING, r,
+                                        "MESSAGE_ID=" SD_MESSAGE_MOUNT_POINT_PATH_NOT_SUITABLE_STR,
+                                        "MOUNT_POINT=%s", where,
+                                        LOG_MESSAGE("Failed to generate valid unit name from mount point path '%s', ignoring mount point: %m",
+                                                    where));
+
+                u = manager_get_unit(m, e);
+        }
 
-        r = unit_name_from_path(where, ".mount", &e);
-        if (r < 0)
-                return log_struct_errno(
-                                LOG_WARNING, r,
-                                "MESSAGE_ID=" SD_MESSAGE_MOUNT_POINT_PATH_NOT_SUITABLE_STR,
-                                "MOUNT_POINT=%s", where,
-                                LOG_MESSAGE("Failed to generate valid unit name from mount point path '%s', ignoring mount point: %m",
-                                            where));
-
-        u = manager_get_unit(m, e);
         if (u)
                 r = mount_setup_existing_unit(u, what, where, options, fstype, &flags);
         else
@@ -1872,12 +1891,19 @@ static int mount_setup_unit(
         if (set_flags)
                 MOUNT(u)->proc_flags = flags;
 
+        *unit_name = TAKE_PTR(e);
         return 0;
 }
 
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+        mount_unit_name_hash_ops,
+        void, trivial_hash_func, trivial_compare_func,
+        char, free);
+
 static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
         _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
         _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
+        _cleanup_hashmap_free_ Hashmap *unit_names = NULL;
         _cleanup_set_free_ Set *devices = NULL;
         int r;
 
@@ -1888,8 +1914,10 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
                 return log_error_errno(r, "Failed to parse /proc/self/mountinfo: %m");
 
         for (;;) {
+                _cleanup_free_ char *unit_name = NULL;
                 struct libmnt_fs *fs;
                 const char *device, *path, *options, *fstype;
+                int id;
 
                 r = mnt_table_next_fs(table, iter, &fs);
                 if (r == 1)
@@ -1911,9 +1939,23 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
                 if (set_put_strdup_full(&devices, &path_hash_ops_free, device) != 0)
                         device_found_node(m, device, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
 
-                (void) mount_setup_unit(m, device, path, options, fstype, set_flags);
+                /* Pick up the unit this mount was found to belong to last time, see mount_setup_unit() */
+                id = mnt_fs_get_id(fs);
+                if (id >= 0)
+                        unit_name = hashmap_remove(m->mount_unit_names_by_id, INT_TO_PTR(id + 1));
+
+                (void) mount_setup_unit(m, device, path, options, fstype, set_flags, &unit_name);
+
+                /* This is merely an optimization, hence ignore OOM and duplicate IDs. */
+                if (id >= 0 && unit_name &&
+                    hashmap_ensure_put(&unit_names, &mount_unit_name_hash_ops, INT_TO_PTR(id + 1), unit_name) >= 0)
+                        TAKE_PTR(unit_name);
         }
 
+        /* Whatever is left over are mounts that are gone now */
+        hashmap_free(m->mount_unit_names_by_id);
+        m->mount_unit_names_by_id = TAKE_PTR(unit_names);
+
         return 0;
 }
 
@@ -1924,6 +1966,8 @@ static void mount_shutdown(Manager *m) {
 
         mnt_unref_monitor(m->mount_monitor);
         m->mount_monitor = NULL;
+
+        m->mount_unit_names_by_id = hashmap_free(m->mount_unit_names_by_id);
 }
 
 static void mount_handoff_timestamp(
@@ -2373,15 +2373,21 @@ int setup_namespace(const NamespaceParameters *p, char **reterr_path) {
                 SET_FLAG(dissect_image_flags, DISSECT_IMAGE_NO_PARTITION_TABLE, p->verity && p->verity->data_path);
 
                 if (p->runtime_scope == RUNTIME_SCOPE_SYSTEM) {
-                        /* In system mode we mount directly */
+                        uint32_t loop_flags = FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_NO_PARTITION_TABLE) ? 0 : LO_FLAGS_PARTSCAN;
 
-                        r = loop_device_make_by_path(
-                                        p->root_image,
-                                        FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_DEVICE_READ_ONLY) ? O_RDONLY : -1 /* < 0 means writable if possible, read-only as fallback */,
-                                        /* sector_size= */ UINT32_MAX,
-                                        FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_NO_PARTITION_TABLE) ? 0 : LO_FLAGS_PARTSCAN,
-                                        LOCK_SH,
-                                        &loop_device);
+                        /* In system mode we mount directly. If other services run off the same image
+                         * read-only already, share their loopback device (and thus the page cache). */
+
+                        r = FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_DEVICE_READ_ONLY) ?
+                                loop_device_open_shared(p->root_image, /* sector_size= */ UINT32_MAX, loop_flags, LOCK_SH, &loop_device) : -ENOENT;
+                        if (r < 0)
+                                r = loop_device_make_by_path(
+                                                p->root_image,
+                                                FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_DEVICE_READ_ONLY) ? O_RDONLY : -1 /* < 0 means writable if possible, read-only as fallback */,
+                                                /* sector_size= */ UINT32_MAX,
+                                                loop_flags,
+                                                LOCK_SH,
+                                                &loop_device);
                         if (r < 0)
                                 return log_debug_errno(r, "Failed to create loop device for root image: %m");
 
@@ -616,6 +616,46 @@ static void path_enter_waiting(Path *p, bool initial, bool from_trigger_notify)
         path_set_state(p, PATH_WAITING);
 }
 
+static void path_enter_waiting_spec(Path *p, PathSpec *s) {
+        _cleanup_free_ char *trigger_path = NULL;
+        Unit *trigger;
+        int r;
+
+        assert(p);
+        assert(s);
+
+        /* Only the watch of this spec fired. The watches of all other specs are still in place, and would
+         * have fired too if anything changed for them, hence only recheck and rewatch this spec instead of
+         * redoing all of them via path_enter_waiting(). That matters if a unit watches many paths. */
+
+        trigger = UNIT_TRIGGER(UNIT(p));
+        if (p->state != PATH_WAITING ||
+            (trigger && !UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(trigger)))) {
+                path_enter_waiting(p, /* initial = */ false, /* from_trigger_notify = */ false);
+                return;
+        }
+
+        if (path_spec_check_good(s, /* initial = */ false, /* from_trigger_notify = */ false, &trigger_path)) {
+                log_unit_debug(UNIT(p), "Got triggered.");
+                path_enter_running(p, trigger_path);
+                return;
+        }
+
+        r = path_spec_watch(s, path_dispatch_io);
+        if (r < 0) {
+                log_unit_warning_errno(UNIT(p), r, "Failed to enter waiting state: %m");
+                path_enter_dead(p, PATH_FAILURE_RESOURCES);
+                return;
+        }
+
+        /* Same as in path_enter_waiting(): the path might have changed while we were setting up the
+         * watch. */
+        if (path_spec_check_good(s, /* initial = */ false, /* from_trigger_notify = */ false, &trigger_path)) {
+                log_unit_debug(UNIT(p), "Got triggered.");
+                path_enter_running(p, trigger_path);
+        }
+}
+
 static void path_mkdir(Path *p) {
         assert(p);
 
@@ -792,7 +832,7 @@ static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, v
         if (changed)
                 path_enter_running(p, found->path);
         else
-                path_enter_waiting(p, false, false);
+                path_enter_waiting_spec(p, found);
 
         return 0;
 
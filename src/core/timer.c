@@ -412,9 +412,19 @@ static void timer_enter_waiting(Timer *t, bool time_change) {
                         else
                                 b = ts.realtime;
 
-                        r = calendar_spec_next_usec(v->calendar_spec, b, &v->next_elapse);
-                        if (r < 0)
-                                continue;
+                        /* The result only depends on the base time (and the timezone, see
+                         * timer_timezone_change()), hence on clock changes, or when we are re-entering the
+                         * waiting state without having triggered, we usually can skip the calculation. */
+                        if (v->calendar_next > 0 && v->calendar_base == b)
+                                v->next_elapse = v->calendar_next;
+                        else {
+                                r = calendar_spec_next_usec(v->calendar_spec, b, &v->next_elapse);
+                                if (r < 0)
+                                        continue;
+
+                                v->calendar_base = b;
+                                v->calendar_next = v->next_elapse;
+                        }
 
                         /* To make the delay due to RandomizedDelaySec= work even at boot, if the scheduled
                          * time has already passed, set the time when systemd first started as the scheduled
@@ -846,6 +856,11 @@ static void timer_time_change(Unit *u) {
 static void timer_timezone_change(Unit *u) {
         Timer *t = ASSERT_PTR(TIMER(u));
 
+        /* Calendar specs are evaluated in local time, hence the cached next elapse times are stale now,
+         * regardless of our state */
+        LIST_FOREACH(value, v, t->values)
+                v->calendar_next = 0;
+
         if (t->state != TIMER_WAITING)
                 return;
 
@@ -26,6 +26,11 @@ typedef struct TimerValue {
         CalendarSpec *calendar_spec; /* only for calendar events */
         usec_t next_elapse;
 
+        /* Calculating the next elapse of a calendar spec is relatively expensive, hence remember the last
+         * result, and the base time it was calculated from. Only for calendar events, 0 if not set. */
+        usec_t calendar_base;
+        usec_t calendar_next;
+
         LIST_FIELDS(struct TimerValue, value);
 } TimerValue;
 
@@ -348,7 +348,13 @@ static char* merge_unit_ids(const char* unit_log_field, char * const* pairs) {
         return TAKE_PTR(ans);
 }
 
-static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, sd_bus_error *e) {
+static int transaction_verify_order_one(
+                Transaction *tr,
+                Job *j,
+                Job *from,
+                unsigned generation,
+                unsigned first_generation,
+                sd_bus_error *e) {
 
         static const UnitDependencyAtom directions[] = {
                 UNIT_ATOM_BEFORE,
@@ -436,6 +442,12 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
                                          "Transaction order is cyclic. See system logs for details.");
         }
 
+        /* Found loop-free by an earlier pass, after which only jobs were removed? Then that still holds. If
+         * the marker is not NULL the job was on the path of the pass that found a cycle, and was never
+         * completely checked, hence check it again. */
+        if (j->generation >= first_generation && !j->marker)
+                return 0;
+
         /* Make the marker point to where we come from, so that we can
          * find our way backwards if we want to break a cycle. We use
          * a special marker for the beginning: we point to
@@ -467,7 +479,7 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
                         if (job_compare(j, o, *d) >= 0)
                                 continue;
 
-                        r = transaction_verify_order_one(tr, o, j, generation, e);
+                        r = transaction_verify_order_one(tr, o, j, generation, first_generation, e);
                         if (r < 0)
                                 return r;
                 }
@@ -480,21 +492,36 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
         return 0;
 }
 
-static int transaction_verify_order(Transaction *tr, unsigned *generation, sd_bus_error *e) {
+static int transaction_verify_order(
+                Transaction *tr,
+                unsigned *generation,
+                unsigned *first_generation,
+                sd_bus_error *e) {
+
         Job *j;
         int r;
         unsigned g;
 
         assert(tr);
         assert(generation);
+        assert(first_generation);
 
         /* Check if the ordering graph is cyclic. If it is, try to fix
          * that up by dropping one of the jobs. */
 
         g = (*generation)++;
 
+        /* After a cycle was broken we are called again, to look for further cycles. All that happened in
+         * between is that jobs were removed, hence whatever an earlier pass found to be loop-free still is,
+         * and needs not be traversed again. With many cycles in a large transaction this would otherwise
+         * take quadratic time. This does not hold anymore if ordering dependencies on a unit now lead to a
+         * different job though, in that case start from scratch. */
+        if (*first_generation == 0 || tr->ordering_redirected)
+                *first_generation = g;
+        tr->ordering_redirected = false;
+
         HASHMAP_FOREACH(j, tr->jobs) {
-                r = transaction_verify_order_one(tr, j, NULL, g, e);
+                r = transaction_verify_order_one(tr, j, NULL, g, *first_generation, e);
                 if (r < 0)
                         return r;
         }
@@ -701,7 +728,7 @@ int transaction_activate(
 
         Job *j;
         int r;
-        unsigned generation = 1;
+        unsigned generation = 1, first_order_generation = 0;
 
         /* This applies the changes recorded in tr->jobs to the actual list of jobs, if possible. */
 
@@ -734,7 +761,7 @@ int transaction_activate(
 
                 /* Fifth step: verify order makes sense and correct
                  * cycles if necessary and possible */
-                r = transaction_verify_order(tr, &generation, e);
+                r = transaction_verify_order(tr, &generation, &first_order_generation, e);
                 if (r >= 0)
                         break;
                 if (r != -EAGAIN)
@@ -835,6 +862,12 @@ static void transaction_unlink_job(Transaction *tr, Job *j, bool delete_dependen
         assert(tr);
         assert(j);
 
+        /* Ordering dependencies on the unit are followed to the first job of the unit in the transaction,
+         * and to the installed one if there is none. Hence if we remove the first one, they are redirected
+         * to whatever is left, if anything. */
+        if (!j->transaction_prev && (j->transaction_next || j->unit->job))
+                tr->ordering_redirected = true;
+
         if (j->transaction_prev)
                 j->transaction_prev->transaction_next = j->transaction_next;
         else if (j->transaction_next)
@@ -14,6 +14,10 @@ struct Transaction {
         Hashmap *jobs;        /* Unit object => Job object list 1:1 */
         Job *anchor_job;      /* The job the user asked for */
         bool irreversible;
+
+        /* Set when a job is removed while ordering dependencies on its unit will now resolve to another job
+         * of the same unit, see transaction_verify_order() */
+        bool ordering_redirected;
 };
 
 Transaction* transaction_new(bool irreversible);
@@ -858,9 +858,26 @@ Unit* unit_free(Unit *u) {
 
         activation_details_unref(u->activation_details);
 
+        free(u->statistics);
+
         return mfree(u);
 }
 
+UnitStatistics* unit_statistics(Unit *u) {
+        assert(u);
+
+        /* Returns the statistics to update for the unit, or NULL if they aren't collected. Most units never
+         * see any of the counted events, hence only allocate them when needed. */
+
+        if (!u->manager->unit_statistics)
+                return NULL;
+
+        if (!u->statistics)
+                u->statistics = new0(UnitStatistics, 1); /* On OOM we just don't count */
+
+        return u->statistics;
+}
+
 UnitActiveState unit_active_state(Unit *u) {
         assert(u);
 
@@ -1091,7 +1108,10 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
                         assert_se(hashmap_put(u->dependencies, dt, TAKE_PTR(other_deps)) >= 0);
         }
 
+        u->dependency_atoms |= other->dependency_atoms;
+
         other->dependencies = hashmap_free(other->dependencies);
+        other->dependency_atoms = 0;
 }
 
 int unit_merge(Unit *u, Unit *other) {
@@ -1636,6 +1656,8 @@ int unit_load(Unit *u) {
         if (u->load_state != UNIT_STUB)
                 return 0;
 
+        unit_statistics_inc(u, n_loads);
+
         if (u->transient_file) {
                 /* Finalize transient file: if this is a transient unit file, as soon as we reach unit_load() the setup
                  * is complete, hence let's synchronize the unit file we just wrote to disk. */
@@ -1680,6 +1702,10 @@ int unit_load(Unit *u) {
                 if (u->job_running_timeout != USEC_INFINITY && u->job_running_timeout > u->job_timeout)
                         log_unit_warning(u, "JobRunningTimeoutSec= is greater than JobTimeoutSec=, it has no effect.");
 
+                /* The documentation list is not changed anymore once the unit is loaded, hence pack it
+                 * into a single allocation. If that fails we just keep it as is. */
+                (void) strv_pack(&u->documentation);
+
                 /* We finished loading, let's ensure our parents recalculate the members mask */
                 unit_invalidate_cgroup_members_masks(u);
         }
@@ -3027,6 +3053,7 @@ static Hashmap *unit_get_dependency_hashmap_per_type(Unit *u, UnitDependency d)
                         return NULL;
 
                 deps = TAKE_PTR(h);
+                u->dependency_atoms |= unit_dependency_to_atom(d);
         }
 
         return deps;
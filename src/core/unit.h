@@ -210,7 +210,31 @@ struct UnitRef {
         LIST_FIELDS(UnitRef, refs_by_target);
 };
 
-/* The generic, dynamic definition of the unit */
+/* Counts how much work the manager did on behalf of a unit, to find units that keep it busy. Only collected
+ * if $SYSTEMD_UNIT_STATISTICS=1 is set for the manager, and allocated for a unit on its first event. These
+ * are not serialized, i.e. they count since the last daemon-reload/reexec. */
+typedef struct UnitStatistics {
+        uint64_t n_notify_messages;     /* sd_notify() messages received */
+        uint64_t n_bus_lookups;         /* D-Bus object lookups for method calls and property reads */
+        uint64_t n_change_signals;      /* D-Bus UnitNew/PropertiesChanged signals emitted */
+        uint64_t n_cgroup_realizations; /* Times the cgroup was (re)configured */
+        uint64_t n_loads;               /* Times the unit was loaded */
+        uint64_t n_gc_checks;           /* Times the unit was checked by the GC */
+} UnitStatistics;
+
+#define unit_statistics_inc(u, field)                                   \
+        do {                                                            \
+                UnitStatistics *_s = unit_statistics(u);                \
+                if (_s)                                                 \
+                        _s->field++;                                    \
+        } while (false)
+
+/* The generic, dynamic definition of the unit
+ *
+ * There's one of these for each device and mount the manager knows about, most of which are never started,
+ * hence keep this lean: anything that is only needed once a setting is used (hashmaps, sets, lists, strings)
+ * should be a pointer that is left NULL until first needed, rather than something initialized in
+ * unit_new(). The same applies to the per-type contexts (see exec_context_init(), cgroup_context_init()). */
 typedef struct Unit {
         Manager *manager;
 
@@ -228,6 +252,11 @@ typedef struct Unit {
          * Hashmap(UnitDependency → Hashmap(Unit* → UnitDependencyInfo)) */
         Hashmap *dependencies;
 
+        /* The atoms of all dependency types there ever was a per-type Hashmap for in the above. May contain
+         * more atoms than are currently in use, but never less. Allows UNIT_FOREACH_DEPENDENCY() to skip
+         * searching through the dependencies for atoms the unit has none of. */
+        UnitDependencyAtom dependency_atoms;
+
         /* Similar, for RequiresMountsFor= and WantsMountsFor= path dependencies. The key is the path, the
          * value the UnitDependencyInfo type */
         Hashmap *mounts_for[_UNIT_MOUNT_DEPENDENCY_TYPE_MAX];
@@ -391,6 +420,8 @@ typedef struct Unit {
         sd_id128_t invocation_id;
         char invocation_id_string[SD_ID128_STRING_MAX]; /* useful when logging */
 
+        UnitStatistics *statistics;
+
         /* Garbage collect us we nobody wants or requires us anymore */
         bool stop_when_unneeded;
 
@@ -799,6 +830,7 @@ static inline Unit* UNIT_GET_SLICE(const Unit *u) {
 
 Unit* unit_new(Manager *m, size_t size);
 Unit* unit_free(Unit *u);
+UnitStatistics* unit_statistics(Unit *u);
 DEFINE_TRIVIAL_CLEANUP_FUNC(Unit *, unit_free);
 
 int unit_new_for_name(Manager *m, size_t size, const char *name, Unit **ret);
@@ -1161,13 +1193,18 @@ typedef struct UnitForEachDependencyData {
         Unit **current_unit;
 } UnitForEachDependencyData;
 
+static inline Hashmap* unit_get_dependencies_with_atom(const Unit *u, UnitDependencyAtom atom) {
+        return (u->dependency_atoms & atom) != 0 ? u->dependencies : NULL;
+}
+
 /* Iterates through all dependencies that have a specific atom in the dependency type set. This tries to be
- * smart: if the atom is unique, we'll directly go to right entry. Otherwise we'll iterate through the
- * per-dependency type hashmap and match all dep that have the right atom set. */
+ * smart: if the unit has no dependencies with the atom at all, we'll stop right-away. If the atom is unique,
+ * we'll directly go to right entry. Otherwise we'll iterate through the per-dependency type hashmap and
+ * match all dep that have the right atom set. */
 #define _UNIT_FOREACH_DEPENDENCY(other, u, ma, data)                    \
         for (UnitForEachDependencyData data = {                         \
                         .match_atom = (ma),                             \
-                        .by_type = (u)->dependencies,                   \
+                        .by_type = unit_get_dependencies_with_atom((u), (ma)), \
                         .by_type_iterator = ITERATOR_FIRST,             \
                         .current_unit = &(other),                       \
                 };                                                      \
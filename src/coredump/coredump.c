@@ -181,6 +181,7 @@ static DEFINE_CONFIG_PARSE_ENUM(config_parse_coredump_storage, coredump_storage,
 
 static CoredumpStorage arg_storage = COREDUMP_STORAGE_EXTERNAL;
 static bool arg_compress = true;
+static unsigned arg_compress_threads = 0;
 static uint64_t arg_process_size_max = PROCESS_SIZE_MAX;
 static uint64_t arg_external_size_max = EXTERNAL_SIZE_MAX;
 static uint64_t arg_journal_size_max = JOURNAL_SIZE_MAX;
@@ -201,6 +202,7 @@ static int parse_config(void) {
         static const ConfigTableItem items[] = {
                 { "Coredump", "Storage",         config_parse_coredump_storage,    0,                      &arg_storage           },
                 { "Coredump", "Compress",        config_parse_bool,                0,                      &arg_compress          },
+                { "Coredump", "CompressThreads", config_parse_unsigned,            0,                      &arg_compress_threads  },
                 { "Coredump", "ProcessSizeMax",  config_parse_iec_uint64,          0,                      &arg_process_size_max  },
                 { "Coredump", "ExternalSizeMax", config_parse_iec_uint64_infinity, 0,                      &arg_external_size_max },
                 { "Coredump", "JournalSizeMax",  config_parse_iec_size,            0,                      &arg_journal_size_max  },
@@ -554,7 +556,9 @@ static int save_external_coredump(
                 log_debug("Limiting core file size to %" PRIu64 " bytes due to cgroup and/or filesystem limits.", max_size);
         }
 
-        r = copy_bytes(input_fd, fd, max_size, 0);
+        /* Cores usually contain large zero-filled ranges (the kernel writes out unpopulated pages as zeroes),
+         * hence turn those into holes instead of writing them out block by block. */
+        r = copy_bytes(input_fd, fd, max_size, COPY_SPARSE);
         if (r < 0)
                 return log_error_errno(r, "Cannot store coredump of %s (%s): %m",
                                 context->meta[META_ARGV_PID], context->meta[META_COMM]);
@@ -580,7 +584,7 @@ static int save_external_coredump(
                 if (fd_compressed < 0)
                         return log_error_errno(fd_compressed, "Failed to create temporary file for coredump %s: %m", fn_compressed);
 
-                r = compress_stream(fd, fd_compressed, max_size, &uncompressed_size);
+                r = compress_stream_full(fd, fd_compressed, max_size, arg_compress_threads, &uncompressed_size);
                 if (r < 0)
                         return log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
 
@@ -593,7 +597,7 @@ static int save_external_coredump(
                         tmp = unlink_and_free(tmp);
                         fd = safe_close(fd);
 
-                        r = compress_stream(input_fd, fd_compressed, max_size, &partial_uncompressed_size);
+                        r = compress_stream_full(input_fd, fd_compressed, max_size, arg_compress_threads, &partial_uncompressed_size);
                         if (r < 0)
                                 return log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
                         uncompressed_size += partial_uncompressed_size;
@@ -181,6 +181,7 @@ int load_volume_key_tpm2(
         assert_se(ret_vk);
         assert_se(ret_vks);
 
+        _cleanup_(tpm2_context_unrefp) Tpm2Context *tpm2_context = NULL;
         bool found_some = false;
         int token = 0; /* first token to look at */
 
@@ -232,6 +233,7 @@ int load_volume_key_tpm2(
                 r = acquire_tpm2_key(
                                 cd_node,
                                 device,
+                                &tpm2_context,
                                 hash_pcr_mask,
                                 pcr_bank,
                                 &pubkey,
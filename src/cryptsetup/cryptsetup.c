@@ -1855,6 +1855,7 @@ static int attach_luks_or_plain_or_bitlk_by_tpm2(
                         r = acquire_tpm2_key(
                                         name,
                                         arg_tpm2_device,
+                                        /* tpm2_context= */ NULL,
                                         arg_tpm2_pcr_mask == UINT32_MAX ? TPM2_PCR_MASK_DEFAULT : arg_tpm2_pcr_mask,
                                         UINT16_MAX,
                                         /* pubkey= */ NULL,
@@ -1904,6 +1905,7 @@ static int attach_luks_or_plain_or_bitlk_by_tpm2(
                 }
 
                 if (r == -EOPNOTSUPP) { /* Plugin not available, let's process TPM2 stuff right here instead */
+                        _cleanup_(tpm2_context_unrefp) Tpm2Context *tpm2_context = NULL;
                         bool found_some = false;
                         int token = 0; /* first token to look at */
 
@@ -1960,6 +1962,7 @@ static int attach_luks_or_plain_or_bitlk_by_tpm2(
                                 r = acquire_tpm2_key(
                                                 name,
                                                 arg_tpm2_device,
+                                                &tpm2_context,
                                                 hash_pcr_mask,
                                                 pcr_bank,
                                                 &pubkey,
@@ -1362,6 +1362,7 @@ int home_setup_luks(
                 }
         } else {
                 _cleanup_free_ char *fstype = NULL, *subdir = NULL;
+                usec_t t_start, t_loop, t_luks, t_fsck, t_mount;
                 const char *ip;
 
                 /* When we aren't reopening the home directory we are allocating it fresh, hence the relevant
@@ -1385,6 +1386,8 @@ int home_setup_luks(
                 if (run_mark_dirty(setup->image_fd, true) > 0)
                         setup->do_mark_clean = true;
 
+                t_start = now(CLOCK_MONOTONIC);
+
                 if (!user_record_luks_discard(h)) {
                         r = run_fallocate(setup->image_fd, &st);
                         if (r < 0)
@@ -1409,6 +1412,8 @@ int home_setup_luks(
 
                 log_info("Setting up loopback device %s completed.", setup->loop->node ?: ip);
 
+                t_loop = now(CLOCK_MONOTONIC);
+
                 r = luks_setup(h,
                                setup->loop->node ?: ip,
                                setup->dm_name,
@@ -1434,6 +1439,8 @@ int home_setup_luks(
                                 return r;
                 }
 
+                t_luks = now(CLOCK_MONOTONIC);
+
                 r = fs_validate(setup->dm_node, h->file_system_uuid, &fstype, &found_fs_uuid);
                 if (r < 0)
                         return r;
@@ -1442,6 +1449,8 @@ int home_setup_luks(
                 if (r < 0)
                         return r;
 
+                t_fsck = now(CLOCK_MONOTONIC);
+
                 r = home_unshare_and_mount(setup->dm_node, fstype, user_record_luks_discard(h), user_record_mount_flags(h), h->luks_extra_mount_options);
                 if (r < 0)
                         return r;
@@ -1452,9 +1461,22 @@ int home_setup_luks(
                 if (setup->root_fd < 0)
                         return log_error_errno(errno, "Failed to open home directory: %m");
 
+                t_mount = now(CLOCK_MONOTONIC);
+
                 if (user_record_luks_discard(h))
                         (void) run_fitrim(setup->root_fd);
 
+                /* Activation is on the login path, hence tell where the time went, so that slow key
+                 * derivation, a long file system check or a long trim can be told apart. */
+                usec_t t_end = now(CLOCK_MONOTONIC);
+                log_info("Setting up LUKS home took %s (loopback %s, unlocking %s, file system check %s, mounting %s, trimming %s).",
+                         FORMAT_TIMESPAN(t_end - t_start, USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(t_loop - t_start, USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(t_luks - t_loop, USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(t_fsck - t_luks, USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(t_mount - t_fsck, USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(t_end - t_mount, USEC_PER_MSEC));
+
                 setup->do_offline_fallocate = !(setup->do_offline_fitrim = user_record_luks_offline_discard(h));
         }
 
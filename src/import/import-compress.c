@@ -1,8 +1,12 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include "import-compress.h"
+#include "log.h"
 #include "string-table.h"
 
+/* Each xz encoder thread needs roughly 100 MiB with the default preset */
+#define IMPORT_COMPRESS_XZ_THREADS_MAX 4U
+
 void import_compress_free(ImportCompress *c) {
         assert(c);
 
@@ -204,6 +208,30 @@ int import_compress_init(ImportCompress *c, ImportCompressType t) {
 
         case IMPORT_COMPRESS_XZ: {
                 lzma_ret xzr;
+                uint32_t n_threads;
+
+                /* Compression is by far the most expensive part of an export, hence spread it over all CPUs.
+                 * The multi-threaded encoder splits the stream into independently compressed blocks, which
+                 * any xz decoder can read, at the price of a slightly worse ratio and more memory. Hence
+                 * cap the number of threads, and stick to the single-threaded encoder on single-CPU
+                 * systems. */
+                n_threads = MIN(lzma_cputhreads(), IMPORT_COMPRESS_XZ_THREADS_MAX);
+                if (n_threads > 1) {
+                        lzma_mt mt = {
+                                .threads = n_threads,
+                                .preset = LZMA_PRESET_DEFAULT,
+                                .check = LZMA_CHECK_CRC64,
+                        };
+
+                        xzr = lzma_stream_encoder_mt(&c->xz, &mt);
+                        if (xzr == LZMA_OK) {
+                                c->type = IMPORT_COMPRESS_XZ;
+                                break;
+                        }
+
+                        /* liblzma might have been built without threading support */
+                        log_debug("Failed to set up multi-threaded xz encoder (%i), falling back to single-threaded one.", (int) xzr);
+                }
 
                 xzr = lzma_easy_encoder(&c->xz, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
                 if (xzr != LZMA_OK)
@@ -38,6 +38,7 @@ PullJob* pull_job_unref(PullJob *j) {
 
         curl_glue_remove_and_free(j->glue, j->curl);
         curl_slist_free_all(j->request_header);
+        curl_slist_free_all(j->resume_header);
 
         import_compress_free(&j->compress);
 
@@ -97,6 +98,7 @@ static int pull_job_restart(PullJob *j, const char *new_url) {
         j->etag_exists = false;
         j->mtime = 0;
         j->checksum = mfree(j->checksum);
+        j->n_resumes = 0;
 
         curl_glue_remove_and_free(j->glue, j->curl);
         j->curl = NULL;
@@ -104,6 +106,9 @@ static int pull_job_restart(PullJob *j, const char *new_url) {
         curl_slist_free_all(j->request_header);
         j->request_header = NULL;
 
+        curl_slist_free_all(j->resume_header);
+        j->resume_header = NULL;
+
         import_compress_free(&j->compress);
 
         if (j->checksum_ctx) {
@@ -122,6 +127,78 @@ static int pull_job_restart(PullJob *j, const char *new_url) {
         return 0;
 }
 
+static bool pull_job_may_resume(PullJob *j, CURL *curl, CURLcode result) {
+        char *scheme = NULL;
+
+        assert(j);
+        assert(curl);
+
+        /* Only the kind of errors a flaky connection causes, not those where the server told us no */
+        if (!IN_SET(result,
+                    CURLE_PARTIAL_FILE,
+                    CURLE_RECV_ERROR,
+                    CURLE_SEND_ERROR,
+                    CURLE_OPERATION_TIMEDOUT,
+                    CURLE_GOT_NOTHING,
+                    CURLE_HTTP2,
+                    CURLE_HTTP2_STREAM))
+                return false;
+
+        /* Nothing to save if we didn't get past the beginning */
+        if (j->state != PULL_JOB_RUNNING || j->written_compressed == 0)
+                return false;
+
+        if (j->n_resumes >= PULL_JOB_RESUME_MAX)
+                return false;
+
+        /* The rest must come from the very same resource, since the decompressor and the checksum simply
+         * continue where they stopped. Only a strong ETag lets the server guarantee that via If-Range. */
+        if (!j->etag || startswith(j->etag, "W/"))
+                return false;
+
+        if (curl_easy_getinfo(curl, CURLINFO_SCHEME, &scheme) != CURLE_OK || !scheme)
+                return false;
+
+        return STRCASE_IN_SET(scheme, "HTTP", "HTTPS");
+}
+
+static int pull_job_setup_curl(PullJob *j, struct curl_slist *request_header);
+
+static int pull_job_resume(PullJob *j) {
+        _cleanup_free_ char *hdr = NULL;
+        int r;
+
+        assert(j);
+        assert(j->state == PULL_JOB_RUNNING);
+        assert(j->etag);
+
+        curl_glue_remove_and_free(j->glue, j->curl);
+        j->curl = NULL;
+
+        hdr = strjoin("If-Range: ", j->etag);
+        if (!hdr)
+                return -ENOMEM;
+
+        curl_slist_free_all(j->resume_header);
+        j->resume_header = curl_slist_new(hdr, NULL);
+        if (!j->resume_header)
+                return -ENOMEM;
+
+        r = pull_job_setup_curl(j, j->resume_header);
+        if (r < 0)
+                return r;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) j->written_compressed) != CURLE_OK)
+                return -EIO;
+
+        r = curl_glue_add(j->glue, j->curl);
+        if (r < 0)
+                return r;
+
+        j->n_resumes++;
+        return 0;
+}
+
 void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
         PullJob *j = NULL;
         char *scheme = NULL;
@@ -135,6 +212,17 @@ void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
                 return;
 
         if (result != CURLE_OK) {
+                if (pull_job_may_resume(j, curl, result)) {
+                        log_info("Transfer of %s interrupted after %s (%s), resuming.",
+                                 j->url, FORMAT_BYTES(j->written_compressed), curl_easy_strerror(result));
+
+                        r = pull_job_resume(j);
+                        if (r >= 0)
+                                return;
+
+                        log_warning_errno(r, "Failed to resume transfer, giving up: %m");
+                }
+
                 r = log_error_errno(SYNTHETIC_ERRNO(EIO), "Transfer failed: %s", curl_easy_strerror(result));
                 goto finish;
         }
@@ -555,7 +643,7 @@ static size_t pull_job_header_callback(void *contents, size_t size, size_t nmemb
                 goto fail;
         }
 
-        assert(j->state == PULL_JOB_ANALYZING);
+        assert(IN_SET(j->state, PULL_JOB_ANALYZING, PULL_JOB_RUNNING));
 
         code = curl_easy_getinfo(j->curl, CURLINFO_RESPONSE_CODE, &status);
         if (code != CURLE_OK) {
@@ -563,6 +651,26 @@ static size_t pull_job_header_callback(void *contents, size_t size, size_t nmemb
                 goto fail;
         }
 
+        if (j->state == PULL_JOB_RUNNING) {
+                /* This is a resumed transfer, we processed the headers of the original response already. Just
+                 * make sure we continue with the same resource. If the server ignores the range, curl refuses
+                 * the full response on its own. */
+                if (status != 206)
+                        return sz;
+
+                r = curl_header_strdup(contents, sz, "ETag:", &etag);
+                if (r < 0) {
+                        log_oom();
+                        goto fail;
+                }
+                if (r > 0 && !streq_ptr(etag, j->etag)) {
+                        r = log_error_errno(SYNTHETIC_ERRNO(EIO), "%s changed while resuming the transfer, refusing.", j->url);
+                        goto fail;
+                }
+
+                return sz;
+        }
+
         if (http_status_ok(status) || http_status_etag_exists(status)) {
                 /* Check Etag on OK and etag exists responses. */
 
@@ -712,18 +820,52 @@ int pull_job_new(
         return 0;
 }
 
-int pull_job_begin(PullJob *j) {
+static int pull_job_setup_curl(PullJob *j, struct curl_slist *request_header) {
         int r;
 
         assert(j);
 
-        if (j->state != PULL_JOB_INIT)
-                return -EBUSY;
-
         r = curl_glue_make(&j->curl, j->url, j);
         if (r < 0)
                 return r;
 
+        if (request_header) {
+                if (curl_easy_setopt(j->curl, CURLOPT_HTTPHEADER, request_header) != CURLE_OK)
+                        return -EIO;
+        }
+
+        if (curl_easy_setopt(j->curl, CURLOPT_WRITEFUNCTION, pull_job_write_callback) != CURLE_OK)
+                return -EIO;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_WRITEDATA, j) != CURLE_OK)
+                return -EIO;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_HEADERFUNCTION, pull_job_header_callback) != CURLE_OK)
+                return -EIO;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_HEADERDATA, j) != CURLE_OK)
+                return -EIO;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_XFERINFOFUNCTION, pull_job_progress_callback) != CURLE_OK)
+                return -EIO;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_XFERINFODATA, j) != CURLE_OK)
+                return -EIO;
+
+        if (curl_easy_setopt(j->curl, CURLOPT_NOPROGRESS, 0) != CURLE_OK)
+                return -EIO;
+
+        return 0;
+}
+
+int pull_job_begin(PullJob *j) {
+        int r;
+
+        assert(j);
+
+        if (j->state != PULL_JOB_INIT)
+                return -EBUSY;
+
         if (!strv_isempty(j->old_etags)) {
                 _cleanup_free_ char *cc = NULL, *hdr = NULL;
 
@@ -750,31 +892,9 @@ int pull_job_begin(PullJob *j) {
                 }
         }
 
-        if (j->request_header) {
-                if (curl_easy_setopt(j->curl, CURLOPT_HTTPHEADER, j->request_header) != CURLE_OK)
-                        return -EIO;
-        }
-
-        if (curl_easy_setopt(j->curl, CURLOPT_WRITEFUNCTION, pull_job_write_callback) != CURLE_OK)
-                return -EIO;
-
-        if (curl_easy_setopt(j->curl, CURLOPT_WRITEDATA, j) != CURLE_OK)
-                return -EIO;
-
-        if (curl_easy_setopt(j->curl, CURLOPT_HEADERFUNCTION, pull_job_header_callback) != CURLE_OK)
-                return -EIO;
-
-        if (curl_easy_setopt(j->curl, CURLOPT_HEADERDATA, j) != CURLE_OK)
-                return -EIO;
-
-        if (curl_easy_setopt(j->curl, CURLOPT_XFERINFOFUNCTION, pull_job_progress_callback) != CURLE_OK)
-                return -EIO;
-
-        if (curl_easy_setopt(j->curl, CURLOPT_XFERINFODATA, j) != CURLE_OK)
-                return -EIO;
-
-        if (curl_easy_setopt(j->curl, CURLOPT_NOPROGRESS, 0) != CURLE_OK)
-                return -EIO;
+        r = pull_job_setup_curl(j, j->request_header);
+        if (r < 0)
+                return r;
 
         r = curl_glue_add(j->glue, j->curl);
         if (r < 0)
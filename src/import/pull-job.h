@@ -9,6 +9,9 @@
 #include "openssl-util.h"
 #include "pull-common.h"
 
+/* How often to resume a transfer that was interrupted half-way, before giving up */
+#define PULL_JOB_RESUME_MAX 5U
+
 typedef struct PullJob PullJob;
 
 typedef void (*PullJobFinished)(PullJob *job);
@@ -45,6 +48,8 @@ struct PullJob {
         CurlGlue *glue;
         CURL *curl;
         struct curl_slist *request_header;
+        struct curl_slist *resume_header;
+        unsigned n_resumes;
 
         char *etag;
         char **old_etags;
@@ -4,6 +4,7 @@
 
 #include "alloc-util.h"
 #include "btrfs-util.h"
+#include "memory-util.h"
 #include "qcow2-util.h"
 #include "sparse-endian.h"
 
@@ -60,30 +61,109 @@ static uint32_t HEADER_HEADER_LENGTH(const Header *h) {
         return be32toh(h->header_length);
 }
 
+/* Data clusters that are contiguous both in the image and on the virtual disk are copied in one go, up to
+ * this many bytes. Images written sequentially are mostly made of such runs. */
+#define COPY_BATCH_MAX (4U*1024U*1024U)
+
+typedef struct CopyBatch {
+        uint64_t soffset;
+        uint64_t doffset;
+        uint64_t size;
+} CopyBatch;
+
+static int write_nonzero_clusters(
+                int dfd, uint64_t doffset,
+                const void *buffer,
+                uint64_t size,
+                uint64_t cluster_size) {
+
+        uint64_t begin = 0;
+        ssize_t l;
+
+        /* Clusters that are all zeroes are not written, so that they remain holes in the output file,
+         * which is truncated to zero bits first. Runs of non-zero clusters are written at once. */
+
+        for (uint64_t o = 0; o <= size; o += cluster_size) {
+                if (o < size && !memeqzero((const uint8_t*) buffer + o, cluster_size))
+                        continue;
+
+                if (o > begin) {
+                        l = pwrite(dfd, (const uint8_t*) buffer + begin, o - begin, doffset + begin);
+                        if (l < 0)
+                                return -errno;
+                        if ((uint64_t) l != o - begin)
+                                return -EIO;
+                }
+
+                begin = o + cluster_size;
+        }
+
+        return 0;
+}
+
+static int copy_batch(
+                int sfd,
+                int dfd,
+                CopyBatch *batch,
+                uint64_t cluster_size,
+                void *buffer) {
+
+        ssize_t l;
+        int r;
+
+        assert(batch);
+
+        if (batch->size == 0)
+                return 0;
+
+        r = reflink_range(sfd, batch->soffset, dfd, batch->doffset, batch->size);
+        if (r < 0) {
+                l = pread(sfd, buffer, batch->size, batch->soffset);
+                if (l < 0)
+                        return -errno;
+                if ((uint64_t) l != batch->size)
+                        return -EIO;
+
+                r = write_nonzero_clusters(dfd, batch->doffset, buffer, batch->size, cluster_size);
+                if (r < 0)
+                        return r;
+        }
+
+        *batch = (CopyBatch) {};
+        return 0;
+}
+
 static int copy_cluster(
                 int sfd, uint64_t soffset,
                 int dfd, uint64_t doffset,
                 uint64_t cluster_size,
+                CopyBatch *batch,
                 void *buffer) {
 
-        ssize_t l;
         int r;
 
-        r = reflink_range(sfd, soffset, dfd, doffset, cluster_size);
-        if (r >= 0)
-                return r;
+        assert(batch);
 
-        l = pread(sfd, buffer, cluster_size, soffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
+        /* Extend the current batch if this cluster directly follows it, otherwise copy the batch and start
+         * a new one. */
 
-        l = pwrite(dfd, buffer, cluster_size, doffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
+        if (batch->size > 0 &&
+            batch->soffset + batch->size == soffset &&
+            batch->doffset + batch->size == doffset &&
+            batch->size + cluster_size <= COPY_BATCH_MAX) {
+                batch->size += cluster_size;
+                return 0;
+        }
+
+        r = copy_batch(sfd, dfd, batch, cluster_size, buffer);
+        if (r < 0)
+                return r;
+
+        *batch = (CopyBatch) {
+                .soffset = soffset,
+                .doffset = doffset,
+                .size = cluster_size,
+        };
 
         return 0;
 }
@@ -134,13 +214,7 @@ static int decompress_cluster(
         if (r != Z_STREAM_END || sz != cluster_size)
                 return -EIO;
 
-        l = pwrite(dfd, buffer2, cluster_size, doffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
-
-        return 0;
+        return write_nonzero_clusters(dfd, doffset, buffer2, cluster_size, cluster_size);
 }
 
 static int normalize_offset(
@@ -228,6 +302,7 @@ static int verify_header(const Header *header) {
 int qcow2_convert(int qcow2_fd, int raw_fd) {
         _cleanup_free_ void *buffer1 = NULL, *buffer2 = NULL;
         _cleanup_free_ be64_t *l1_table = NULL, *l2_table = NULL;
+        CopyBatch batch = {};
         uint64_t sz, i;
         Header header;
         ssize_t l;
@@ -251,7 +326,8 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
         if (!l2_table)
                 return -ENOMEM;
 
-        buffer1 = malloc(HEADER_CLUSTER_SIZE(&header));
+        /* Used for batches of clusters as well as for compressed clusters */
+        buffer1 = malloc(MAX((uint64_t) COPY_BATCH_MAX, HEADER_CLUSTER_SIZE(&header)));
         if (!buffer1)
                 return -ENOMEM;
 
@@ -310,13 +386,14 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
                                 r = copy_cluster(
                                                 qcow2_fd, data_begin,
                                                 raw_fd, p,
-                                                HEADER_CLUSTER_SIZE(&header), buffer1);
+                                                HEADER_CLUSTER_SIZE(&header),
+                                                &batch, buffer1);
                         if (r < 0)
                                 return r;
                 }
         }
 
-        return 0;
+        return copy_batch(qcow2_fd, raw_fd, &batch, HEADER_CLUSTER_SIZE(&header), buffer1);
 }
 
 int qcow2_detect(int fd) {
@@ -69,6 +69,7 @@ typedef struct RequestMeta {
 
         bool follow;
         bool discrete;
+        ssize_t pending_end; /* MHD_CONTENT_READER_END_* to return once the data read before is handed out */
 } RequestMeta;
 
 static const char* const mime_types[_OUTPUT_MODE_MAX] = {
@@ -147,18 +148,19 @@ static int request_meta_ensure_tmp(RequestMeta *m) {
         return 0;
 }
 
-static ssize_t request_reader_entries(
-                void *cls,
+static ssize_t request_reader_entry(
+                RequestMeta *m,
                 uint64_t pos,
                 char *buf,
-                size_t max) {
+                size_t max,
+                bool wait) {
 
-        RequestMeta *m = ASSERT_PTR(cls);
         dual_timestamp previous_ts = DUAL_TIMESTAMP_NULL;
         sd_id128_t previous_boot_id = SD_ID128_NULL;
         int r;
         size_t n, k;
 
+        assert(m);
         assert(buf);
         assert(max > 0);
         assert(pos >= m->delta);
@@ -188,6 +190,9 @@ static ssize_t request_reader_entries(
                 } else if (r == 0) {
 
                         if (m->follow) {
+                                if (!wait)
+                                        break;
+
                                 r = sd_journal_wait(m->journal, (uint64_t) JOURNAL_WAIT_TIMEOUT);
                                 if (r < 0) {
                                         log_error_errno(r, "Couldn't wait for journal event: %m");
@@ -280,6 +285,45 @@ static ssize_t request_reader_entries(
         return (ssize_t) k;
 }
 
+static ssize_t request_reader_entries(
+                void *cls,
+                uint64_t pos,
+                char *buf,
+                size_t max) {
+
+        RequestMeta *m = ASSERT_PTR(cls);
+        size_t filled = 0;
+
+        assert(buf);
+        assert(max > 0);
+
+        if (m->pending_end < 0)
+                return m->pending_end;
+
+        /* Fill the buffer with as many entries as fit, so that we don't hand out a separate chunk for each
+         * one. Only wait for new entries in follow mode if we have nothing to return yet. */
+        while (filled < max) {
+                ssize_t k;
+
+                k = request_reader_entry(m, pos + filled, buf + filled, max - filled, /* wait= */ filled == 0);
+                if (k < 0) {
+                        if (filled == 0)
+                                return k;
+
+                        /* Return what we have first, and report the end of the stream or the error on the
+                         * next call */
+                        m->pending_end = k;
+                        break;
+                }
+                if (k == 0)
+                        break;
+
+                filled += k;
+        }
+
+        return (ssize_t) filled;
+}
+
 static int request_parse_accept(
                 RequestMeta *m,
                 struct MHD_Connection *connection) {
@@ -592,7 +636,7 @@ static int request_handler_entries(
         if (r < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to seek in journal.");
 
-        response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, request_reader_entries, m, NULL);
+        response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 64*1024, request_reader_entries, m, NULL);
         if (!response)
                 return respond_oom(connection);
 
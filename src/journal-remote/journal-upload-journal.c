@@ -27,7 +27,8 @@ static ssize_t write_entry(char *buf, size_t size, Uploader *u) {
                 case ENTRY_CURSOR: {
                         u->current_cursor = mfree(u->current_cursor);
 
-                        r = sd_journal_get_cursor(u->journal, &u->current_cursor);
+                        /* Look up the cursor and everything we need for the header fields below in one go */
+                        r = journal_get_entry_metadata(u->journal, &u->current_cursor, &u->entry_metadata);
                         if (r < 0)
                                 return log_error_errno(r, "Failed to get cursor: %m");
 
@@ -50,14 +51,8 @@ static ssize_t write_entry(char *buf, size_t size, Uploader *u) {
                 }
                         _fallthrough_;
                 case ENTRY_REALTIME: {
-                        usec_t realtime;
-
-                        r = sd_journal_get_realtime_usec(u->journal, &realtime);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to get realtime timestamp: %m");
-
                         r = snprintf(buf + pos, size - pos,
-                                     "__REALTIME_TIMESTAMP="USEC_FMT"\n", realtime);
+                                     "__REALTIME_TIMESTAMP="USEC_FMT"\n", u->entry_metadata.realtime);
                         assert(r >= 0);
                         if ((size_t) r > size - pos)
                                 /* not enough space */
@@ -75,15 +70,8 @@ static ssize_t write_entry(char *buf, size_t size, Uploader *u) {
                 }
                         _fallthrough_;
                 case ENTRY_MONOTONIC: {
-                        usec_t monotonic;
-                        sd_id128_t boot_id;
-
-                        r = sd_journal_get_monotonic_usec(u->journal, &monotonic, &boot_id);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
-
                         r = snprintf(buf + pos, size - pos,
-                                     "__MONOTONIC_TIMESTAMP="USEC_FMT"\n", monotonic);
+                                     "__MONOTONIC_TIMESTAMP="USEC_FMT"\n", u->entry_metadata.monotonic);
                         assert(r >= 0);
                         if ((size_t) r > size - pos)
                                 /* not enough space */
@@ -101,14 +89,8 @@ static ssize_t write_entry(char *buf, size_t size, Uploader *u) {
                 }
                         _fallthrough_;
                 case ENTRY_BOOT_ID: {
-                        sd_id128_t boot_id;
-
-                        r = sd_journal_get_monotonic_usec(u->journal, NULL, &boot_id);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
-
                         r = snprintf(buf + pos, size - pos,
-                                     "_BOOT_ID=%s\n", SD_ID128_TO_STRING(boot_id));
+                                     "_BOOT_ID=%s\n", SD_ID128_TO_STRING(u->entry_metadata.boot_id));
                         assert(r >= 0);
                         if ((size_t) r > size - pos)
                                 /* not enough space */
@@ -65,6 +65,10 @@ static void close_fd_input(Uploader *u);
 
 #define SERVER_ANSWER_KEEP 2048
 
+/* libcurl's default of 64K makes us go back and forth between curl and the read callback a lot, and
+ * limits how much is in flight on high latency links. */
+#define UPLOAD_BUFFER_SIZE (512U*1024U)
+
 #define STATE_FILE "/var/lib/systemd/journal-upload/state"
 
 #define easy_setopt(curl, opt, value, level, cmd)                       \
@@ -241,6 +245,11 @@ int start_upload(Uploader *u,
                 easy_setopt(curl, CURLOPT_READDATA, data,
                             LOG_ERR, return -EXFULL);
 
+#if LIBCURL_VERSION_NUM >= 0x073e00 /* libcurl 7.62.0 */
+                easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, (long) UPLOAD_BUFFER_SIZE,
+                            LOG_WARNING, );
+#endif
+
                 /* use our special own mime type and chunked transfer */
                 easy_setopt(curl, CURLOPT_HTTPHEADER, u->header,
                             LOG_ERR, return -EXFULL);
@@ -7,6 +7,7 @@
 #include "sd-event.h"
 #include "sd-journal.h"
 
+#include "journal-internal.h"
 #include "time-util.h"
 
 typedef enum {
@@ -43,6 +44,7 @@ typedef struct Uploader {
         sd_journal* journal;
 
         entry_state entry_state;
+        JournalEntryMetadata entry_metadata; /* timestamps and boot ID of the entry being written */
         const void *field_data;
         size_t field_pos, field_length;
 
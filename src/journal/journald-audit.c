@@ -349,6 +349,12 @@ void process_audit_string(Server *s, int type, const char *data, size_t size) {
         if (!data)
                 return;
 
+        server_account_message(s, SERVER_SOURCE_AUDIT, size);
+
+        /* Audit messages are always dispatched with LOG_NOTICE, skip the parsing if they'd be dropped */
+        if (LOG_NOTICE > s->max_level_store || s->storage == STORAGE_NONE)
+                return;
+
         /* Note that the input buffer is NUL terminated, but let's
          * check whether there is a spurious NUL byte */
         if (memchr(data, 0, size))
@@ -68,6 +68,21 @@
 #define CACHE_MAX_MAX (16*1024U)
 #define CACHE_MAX_MIN 64U
 
+typedef struct UnitProperties {
+        char *unit;
+        usec_t timestamp;
+
+        bool has_invocation_id;
+        bool has_log_level_max;
+        bool has_log_ratelimit_interval;
+        bool has_log_ratelimit_burst;
+
+        sd_id128_t invocation_id;
+        int log_level_max;
+        usec_t log_ratelimit_interval;
+        unsigned log_ratelimit_burst;
+} UnitProperties;
+
 static size_t cache_max(void) {
         static size_t cached = -1;
 
@@ -154,7 +169,7 @@ static void client_context_reset(Server *s, ClientContext *c) {
 
         c->comm = mfree(c->comm);
         c->exe = mfree(c->exe);
-        c->cmdline = mfree(c->cmdline);
+        c->cmdline_field = mfree(c->cmdline_field);
 
         c->auditid = AUDIT_SESSION_INVALID;
         c->loginuid = UID_INVALID;
@@ -232,8 +247,14 @@ static void client_context_read_basic(ClientContext *c) {
         if (get_process_exe(c->pid, &t) >= 0)
                 free_and_replace(c->exe, t);
 
-        if (pid_get_cmdline(c->pid, SIZE_MAX, PROCESS_CMDLINE_QUOTE, &t) >= 0)
-                free_and_replace(c->cmdline, t);
+        if (pid_get_cmdline(c->pid, SIZE_MAX, PROCESS_CMDLINE_QUOTE, &t) >= 0) {
+                /* The command line may be up to _SC_ARG_MAX long, hence keep it around as ready-made journal
+                 * field, so that we don't have to copy it for every single message of the client. */
+                char *f = strjoin("_CMDLINE=", t);
+                free(t);
+                if (f)
+                        free_and_replace(c->cmdline_field, f);
+        }
 
         (void) pidref_get_capability(&PIDREF_MAKE_FROM_PID(c->pid), &c->capability_quintet);
 }
@@ -358,18 +379,15 @@ static int client_context_read_invocation_id(
         return sd_id128_from_string(value, &c->invocation_id);
 }
 
-static int client_context_read_log_level_max(
-                Server *s,
-                ClientContext *c) {
-
+static int read_unit_log_level_max(const char *unit, int *ret) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r, ll;
 
-        if (!c->unit)
-                return 0;
+        assert(unit);
+        assert(ret);
 
-        p = strjoina("/run/systemd/units/log-level-max:", c->unit);
+        p = strjoina("/run/systemd/units/log-level-max:", unit);
         r = readlink_malloc(p, &value);
         if (r < 0)
                 return r;
@@ -378,7 +396,7 @@ static int client_context_read_log_level_max(
         if (ll < 0)
                 return ll;
 
-        c->log_level_max = ll;
+        *ret = ll;
         return 0;
 }
 
@@ -472,40 +490,157 @@ static int client_context_read_extra_fields(
         return 0;
 }
 
-static int client_context_read_log_ratelimit_interval(ClientContext *c) {
+static int read_unit_log_ratelimit_interval(const char *unit, usec_t *ret) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r;
 
-        assert(c);
-
-        if (!c->unit)
-                return 0;
+        assert(unit);
+        assert(ret);
 
-        p = strjoina("/run/systemd/units/log-rate-limit-interval:", c->unit);
+        p = strjoina("/run/systemd/units/log-rate-limit-interval:", unit);
         r = readlink_malloc(p, &value);
         if (r < 0)
                 return r;
 
-        return safe_atou64(value, &c->log_ratelimit_interval);
+        return safe_atou64(value, ret);
 }
 
-static int client_context_read_log_ratelimit_burst(ClientContext *c) {
+static int read_unit_log_ratelimit_burst(const char *unit, unsigned *ret) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r;
 
-        assert(c);
-
-        if (!c->unit)
-                return 0;
+        assert(unit);
+        assert(ret);
 
-        p = strjoina("/run/systemd/units/log-rate-limit-burst:", c->unit);
+        p = strjoina("/run/systemd/units/log-rate-limit-burst:", unit);
         r = readlink_malloc(p, &value);
         if (r < 0)
                 return r;
 
-        return safe_atou(value, &c->log_ratelimit_burst);
+        return safe_atou(value, ret);
+}
+
+static UnitProperties* unit_properties_free(UnitProperties *u) {
+        if (!u)
+                return NULL;
+
+        free(u->unit);
+        return mfree(u);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(UnitProperties*, unit_properties_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(unit_properties_hash_ops,
+                                              char, string_hash_func, string_compare_func,
+                                              UnitProperties, unit_properties_free);
+
+static bool unit_properties_read_invocation_id(const char *unit, sd_id128_t *ret) {
+        _cleanup_free_ char *p = NULL, *value = NULL;
+
+        assert(unit);
+        assert(ret);
+
+        p = strjoin("/run/systemd/units/invocation:", unit);
+        return p &&
+                readlink_malloc(p, &value) >= 0 &&
+                sd_id128_from_string(value, ret) >= 0;
+}
+
+static void unit_properties_read(UnitProperties *u) {
+        assert(u);
+
+        u->has_invocation_id = unit_properties_read_invocation_id(u->unit, &u->invocation_id);
+
+        u->has_log_level_max = read_unit_log_level_max(u->unit, &u->log_level_max) >= 0;
+        u->has_log_ratelimit_interval = read_unit_log_ratelimit_interval(u->unit, &u->log_ratelimit_interval) >= 0;
+        u->has_log_ratelimit_burst = read_unit_log_ratelimit_burst(u->unit, &u->log_ratelimit_burst) >= 0;
+}
+
+static UnitProperties* unit_properties_get(Server *s, const char *unit, usec_t timestamp) {
+        _cleanup_(unit_properties_freep) UnitProperties *n = NULL;
+        UnitProperties *u;
+
+        assert(s);
+        assert(unit);
+
+        u = hashmap_get(s->unit_properties, unit);
+        if (u) {
+                if (u->timestamp + REFRESH_USEC >= timestamp) {
+                        sd_id128_t id;
+                        bool has_id;
+
+                        /* If the unit got restarted in the meantime, its processes must not be logged with
+                         * the previous invocation's ID, and its other properties might have changed, too. */
+                        has_id = unit_properties_read_invocation_id(u->unit, &id);
+                        if (has_id == u->has_invocation_id && (!has_id || sd_id128_equal(id, u->invocation_id)))
+                                return u;
+                }
+
+                unit_properties_read(u);
+                u->timestamp = timestamp;
+                return u;
+        }
+
+        /* Don't bother with an LRU here, the entries are small and quickly recreated. */
+        if (hashmap_size(s->unit_properties) >= cache_max())
+                hashmap_clear(s->unit_properties);
+
+        n = new(UnitProperties, 1);
+        if (!n)
+                return NULL;
+
+        *n = (UnitProperties) {
+                .unit = strdup(unit),
+                .timestamp = timestamp,
+        };
+        if (!n->unit)
+                return NULL;
+
+        if (hashmap_ensure_put(&s->unit_properties, &unit_properties_hash_ops, n->unit, n) < 0)
+                return NULL;
+
+        unit_properties_read(n);
+        return TAKE_PTR(n);
+}
+
+static void client_context_read_unit_properties(Server *s, ClientContext *c, usec_t timestamp) {
+        UnitProperties *u;
+
+        assert(s);
+        assert(c);
+
+        if (!c->unit)
+                return;
+
+        /* The invocation ID of user units is published by the user manager, so it is not covered by the
+         * per-unit cache below. */
+        if (c->user_unit)
+                (void) client_context_read_invocation_id(s, c);
+
+        /* Many clients typically belong to the same unit. Hence don't read the properties PID 1 publishes
+         * for it anew for each of them, but share what we read within the refresh interval, as long as the
+         * unit's invocation ID stays the same. As before, a property we failed to read leaves the previously
+         * known value in place. */
+        u = unit_properties_get(s, c->unit, timestamp);
+        if (!u) {
+                if (!c->user_unit)
+                        (void) client_context_read_invocation_id(s, c);
+                (void) read_unit_log_level_max(c->unit, &c->log_level_max);
+                (void) read_unit_log_ratelimit_interval(c->unit, &c->log_ratelimit_interval);
+                (void) read_unit_log_ratelimit_burst(c->unit, &c->log_ratelimit_burst);
+                return;
+        }
+
+        if (u->has_invocation_id && !c->user_unit)
+                c->invocation_id = u->invocation_id;
+        if (u->has_log_level_max)
+                c->log_level_max = u->log_level_max;
+        if (u->has_log_ratelimit_interval)
+                c->log_ratelimit_interval = u->log_ratelimit_interval;
+        if (u->has_log_ratelimit_burst)
+                c->log_ratelimit_burst = u->log_ratelimit_burst;
 }
 
 static void client_context_really_refresh(
@@ -531,11 +666,8 @@ static void client_context_really_refresh(
         (void) audit_loginuid_from_pid(&PIDREF_MAKE_FROM_PID(c->pid), &c->loginuid);
 
         (void) client_context_read_cgroup(s, c, unit_id);
-        (void) client_context_read_invocation_id(s, c);
-        (void) client_context_read_log_level_max(s, c);
+        client_context_read_unit_properties(s, c, timestamp);
         (void) client_context_read_extra_fields(s, c);
-        (void) client_context_read_log_ratelimit_interval(c);
-        (void) client_context_read_log_ratelimit_burst(c);
 
         c->timestamp = timestamp;
 
@@ -656,6 +788,7 @@ void client_context_flush_all(Server *s) {
 
         s->client_contexts_lru = prioq_free(s->client_contexts_lru);
         s->client_contexts = hashmap_free(s->client_contexts);
+        s->unit_properties = hashmap_free(s->unit_properties);
 }
 
 static int client_context_get_internal(
@@ -678,6 +811,7 @@ static int client_context_get_internal(
 
         c = hashmap_get(s->client_contexts, PID_TO_PTR(pid));
         if (c) {
+                s->n_client_context_hit++;
 
                 if (add_ref) {
                         if (c->in_lru) {
@@ -696,6 +830,8 @@ static int client_context_get_internal(
                 return 0;
         }
 
+        s->n_client_context_missed++;
+
         client_context_try_shrink_to(s, cache_max()-1);
 
         r = client_context_new(s, pid, &c);
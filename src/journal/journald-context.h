@@ -27,7 +27,7 @@ struct ClientContext {
 
         char *comm;
         char *exe;
-        char *cmdline;
+        char *cmdline_field; /* "_CMDLINE=" followed by the quoted command line */
         CapabilityQuintet capability_quintet;
 
         uint32_t auditid;
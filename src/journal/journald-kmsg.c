@@ -116,6 +116,8 @@ void dev_kmsg_record(Server *s, char *p, size_t l) {
         if (l <= 0)
                 return;
 
+        server_account_message(s, SERVER_SOURCE_KERNEL, l);
+
         e = memchr(p, ',', l);
         if (!e)
                 return;
@@ -159,6 +161,12 @@ void dev_kmsg_record(Server *s, char *p, size_t l) {
                 *s->kernel_seqnum = serial + 1;
         }
 
+        /* server_dispatch_message() would drop this record anyway, hence don't bother with parsing the
+         * rest of it and looking up the udev device. Note that this is done only after the serial has been
+         * accounted for, so that we don't report the skipped records as missed. */
+        if (LOG_PRI(priority) > s->max_level_store || s->storage == STORAGE_NONE)
+                return;
+
         l -= (e - p) + 1;
         p = e + 1;
         f = memchr(p, ';', l);
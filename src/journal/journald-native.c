@@ -311,6 +311,8 @@ void server_process_native_message(
         assert(s);
         assert(buffer || buffer_size == 0);
 
+        server_account_message(s, SERVER_SOURCE_NATIVE, buffer_size);
+
         if (ucred && pid_is_valid(ucred->pid)) {
                 r = client_context_get(s, ucred->pid, ucred, label, label_len, NULL, &context);
                 if (r < 0)
@@ -196,15 +196,16 @@ int journal_ratelimit_test(
          * < 0   → error
          */
 
+        /* Rate limiting is turned off for this group? Then don't bother allocating and tracking it. */
+        if (rl_interval == 0 || rl_burst == 0)
+                return 1;
+
         ts = now(CLOCK_MONOTONIC);
 
         r = journal_ratelimit_group_acquire(groups_by_id, id, rl_interval, ts, &g);
         if (r < 0)
                 return r;
 
-        if (rl_interval == 0 || rl_burst == 0)
-                return 1;
-
         burst = burst_modulate(rl_burst, available);
 
         p = &g->pools[priority_map[priority]];
@@ -45,6 +45,7 @@
 #include "journald-stream.h"
 #include "journald-syslog.h"
 #include "log.h"
+#include "logarithm.h"
 #include "memory-util.h"
 #include "missing_audit.h"
 #include "mkdir.h"
@@ -91,6 +92,9 @@
 
 #define IDLE_TIMEOUT_USEC (30*USEC_PER_SEC)
 
+/* The maximum number of datagrams to read from a socket in one event loop iteration */
+#define DATAGRAM_BATCH_MAX 64U
+
 #define FAILED_TO_WRITE_ENTRY_RATELIMIT ((const RateLimit) { .interval = 1 * USEC_PER_SEC, .burst = 1 })
 
 static int server_schedule_sync(Server *s, int priority);
@@ -100,7 +104,9 @@ static int server_determine_path_usage(
                 Server *s,
                 const char *path,
                 uint64_t *ret_used,
-                uint64_t *ret_free) {
+                uint64_t *ret_free,
+                uint64_t *ret_n_files,
+                usec_t *ret_oldest_usec) {
 
         _cleanup_closedir_ DIR *d = NULL;
         struct statvfs ss;
@@ -109,6 +115,8 @@ static int server_determine_path_usage(
         assert(path);
         assert(ret_used);
         assert(ret_free);
+        assert(ret_n_files);
+        assert(ret_oldest_usec);
 
         d = opendir(path);
         if (!d)
@@ -121,8 +129,13 @@ static int server_determine_path_usage(
 
         *ret_free = ss.f_bsize * ss.f_bavail;
         *ret_used = 0;
+        *ret_n_files = 0;
+        *ret_oldest_usec = 0;
         FOREACH_DIRENT_ALL(de, d, break) {
+                unsigned long long realtime, tmp;
                 struct stat st;
+                usec_t x;
+                size_t q;
 
                 if (!endswith(de->d_name, ".journal") &&
                     !endswith(de->d_name, ".journal~"))
@@ -137,6 +150,31 @@ static int server_determine_path_usage(
                         continue;
 
                 *ret_used += (uint64_t) st.st_blocks * 512UL;
+                (*ret_n_files)++;
+
+                /* Archived and corrupted files carry their head timestamp in the name, see
+                 * journal_directory_vacuum(). Remember the oldest one, so that we can tell if the retention
+                 * limit might be hit without opening any of them. */
+                q = strlen(de->d_name);
+                if (endswith(de->d_name, ".journal")) {
+                        if (q < 1 + 32 + 1 + 16 + 1 + 16 + 8 ||
+                            de->d_name[q-8-16-1-16-1-32-1] != '@' ||
+                            sscanf(de->d_name + q-8-16-1-16, "%16llx-%16llx.journal", &tmp, &realtime) != 2)
+                                continue;
+                } else {
+                        if (q < 1 + 16 + 1 + 16 + 8 + 1 ||
+                            de->d_name[q-1-8-16-1-16-1] != '@' ||
+                            sscanf(de->d_name + q-1-8-16-1-16, "%16llx-%16llx.journal~", &realtime, &tmp) != 2)
+                                continue;
+                }
+
+                /* Like journal_directory_vacuum(), don't trust the name if the inode suggests it is older */
+                FOREACH_ARGUMENT(x, timespec_load(&st.st_ctim), timespec_load(&st.st_atim), timespec_load(&st.st_mtim))
+                        if (timestamp_is_set(x) && x < realtime)
+                                realtime = x;
+
+                if (*ret_oldest_usec == 0 || realtime < *ret_oldest_usec)
+                        *ret_oldest_usec = realtime;
         }
 
         return 0;
@@ -149,8 +187,8 @@ static void cache_space_invalidate(JournalStorageSpace *space) {
 static int cache_space_refresh(Server *s, JournalStorage *storage) {
         JournalStorageSpace *space;
         JournalMetrics *metrics;
-        uint64_t vfs_used, vfs_avail, avail;
-        usec_t ts;
+        uint64_t vfs_used, vfs_avail, avail, n_files;
+        usec_t ts, oldest_usec;
         int r;
 
         assert(s);
@@ -163,12 +201,14 @@ static int cache_space_refresh(Server *s, JournalStorage *storage) {
         if (space->timestamp != 0 && usec_add(space->timestamp, RECHECK_SPACE_USEC) > ts)
                 return 0;
 
-        r = server_determine_path_usage(s, storage->path, &vfs_used, &vfs_avail);
+        r = server_determine_path_usage(s, storage->path, &vfs_used, &vfs_avail, &n_files, &oldest_usec);
         if (r < 0)
                 return r;
 
         space->vfs_used = vfs_used;
         space->vfs_available = vfs_avail;
+        space->n_files = n_files;
+        space->oldest_usec = oldest_usec;
 
         avail = LESS_BY(vfs_avail, metrics->keep_free);
 
@@ -544,6 +584,23 @@ static JournalFile* server_find_journal(Server *s, uid_t uid) {
         return s->system_journal;
 }
 
+static void server_note_archived_file(Server *s, JournalFile *f) {
+        JournalStorage *storage;
+
+        assert(s);
+        assert(f);
+
+        /* Called right before a file of ours is archived. Vacuuming always deletes archived files without
+         * entries, hence make sure the next run doesn't skip that. */
+
+        if (le64toh(f->header->n_entries) > 0)
+                return;
+
+        FOREACH_ARGUMENT(storage, &s->system_storage, &s->runtime_storage)
+                if (storage->path && path_startswith(f->path, storage->path))
+                        storage->no_empty_files = false;
+}
+
 static int server_do_rotate(
                 Server *s,
                 JournalFile **f,
@@ -564,6 +621,8 @@ static int server_do_rotate(
                 (seal ? JOURNAL_SEAL : 0) |
                 JOURNAL_STRICT_ORDER;
 
+        server_note_archived_file(s, *f);
+
         r = journal_file_rotate(f, s->mmap, file_flags, s->compress.threshold_bytes, s->deferred_closes);
         if (r < 0) {
                 if (*f)
@@ -701,6 +760,7 @@ static int server_archive_offline_user_journals(Server *s) {
                 TAKE_FD(fd); /* Donated to journal_file_open() */
 
                 journal_file_write_final_tag(f);
+                server_note_archived_file(s, f);
                 r = journal_file_archive(f, NULL);
                 if (r < 0)
                         log_debug_errno(r, "Failed to archive journal file '%s', ignoring: %m", full);
@@ -793,7 +853,36 @@ static void server_sync(Server *s, bool wait) {
         s->sync_scheduled = false;
 }
 
-static void server_do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
+static bool server_vacuum_needed(Server *s, JournalStorage *storage, usec_t oldest_usec) {
+        assert(s);
+        assert(storage);
+
+        /* journal_directory_vacuum() opens every archived file to look at its header and creation time,
+         * which adds up on every rotation if there are many of them. The stat-only scan of our space cache
+         * already tells us how much space the files take, how many there are and, from their names, how
+         * old the oldest archived one is. Together with knowing whether we archived an empty file since the
+         * last full run, that's enough to tell if there is anything to delete at all. */
+
+        if (!storage->no_empty_files)
+                return true;
+
+        if (storage->space.timestamp == 0) /* Refreshing failed, don't know */
+                return true;
+
+        if (storage->space.vfs_used > storage->space.limit)
+                return true;
+
+        if (storage->metrics.n_max_files > 0 && storage->space.n_files > storage->metrics.n_max_files)
+                return true;
+
+        if (s->max_retention_usec > 0 && oldest_usec > 0 &&
+            usec_add(oldest_usec, s->max_retention_usec) <= now(CLOCK_REALTIME))
+                return true;
+
+        return false;
+}
+
+static void server_do_vacuum(Server *s, JournalStorage *storage, usec_t oldest_usec, bool verbose) {
 
         int r;
 
@@ -802,8 +891,21 @@ static void server_do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
 
         (void) cache_space_refresh(s, storage);
 
+        /* The previous vacuum run might have looked at the creation time of the files too, hence take
+         * whatever is older */
+        if (storage->space.oldest_usec > 0 && (oldest_usec == 0 || storage->space.oldest_usec < oldest_usec))
+                oldest_usec = storage->space.oldest_usec;
+
         if (verbose)
                 server_space_usage_message(s, storage);
+        else if (!server_vacuum_needed(s, storage, oldest_usec)) {
+                log_debug("%s is within configured limits, not vacuuming.", storage->path);
+
+                /* Keep the retention timer going */
+                if (oldest_usec > 0 && (s->oldest_file_usec == 0 || oldest_usec < s->oldest_file_usec))
+                        s->oldest_file_usec = oldest_usec;
+                return;
+        }
 
         r = journal_directory_vacuum(storage->path, storage->space.limit,
                                      storage->metrics.n_max_files, s->max_retention_usec,
@@ -811,21 +913,63 @@ static void server_do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
         if (r < 0 && r != -ENOENT)
                 log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
                                             "Failed to vacuum %s, ignoring: %m", storage->path);
+        else
+                storage->no_empty_files = true;
 
         cache_space_invalidate(&storage->space);
 }
 
 void server_vacuum(Server *s, bool verbose) {
+        usec_t oldest_usec;
+
         assert(s);
 
         log_debug("Vacuuming...");
 
+        /* We are doing it now, no need to do it again later */
+        if (s->vacuum_event_source)
+                (void) sd_event_source_set_enabled(s->vacuum_event_source, SD_EVENT_OFF);
+
+        oldest_usec = s->oldest_file_usec;
         s->oldest_file_usec = 0;
 
         if (s->system_journal)
-                server_do_vacuum(s, &s->system_storage, verbose);
+                server_do_vacuum(s, &s->system_storage, oldest_usec, verbose);
         if (s->runtime_journal)
-                server_do_vacuum(s, &s->runtime_storage, verbose);
+                server_do_vacuum(s, &s->runtime_storage, oldest_usec, verbose);
+}
+
+static int server_dispatch_vacuum(sd_event_source *es, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+
+        server_vacuum(s, /* verbose = */ false);
+        return 0;
+}
+
+static void server_schedule_vacuum(Server *s) {
+        int r;
+
+        assert(s);
+
+        /* Vacuuming looks at every archived file in the journal directories, which can take a while. After
+         * a rotation in the write path, let's hence not do it in line, but from a separate event source with
+         * the same priority as the log sources, so that the messages already waiting for us are processed
+         * first. If we can't do that, vacuum right away. */
+
+        if (s->event && sd_event_get_state(s->event) != SD_EVENT_FINISHED) {
+                if (!s->vacuum_event_source) {
+                        r = sd_event_add_defer(s->event, &s->vacuum_event_source, server_dispatch_vacuum, s);
+                        if (r >= 0)
+                                r = sd_event_source_set_priority(s->vacuum_event_source, SD_EVENT_PRIORITY_NORMAL+5);
+                } else
+                        r = sd_event_source_set_enabled(s->vacuum_event_source, SD_EVENT_ONESHOT);
+                if (r >= 0)
+                        return;
+
+                log_debug_errno(r, "Failed to schedule vacuuming, doing it right away: %m");
+        }
+
+        server_vacuum(s, /* verbose = */ false);
 }
 
 static void server_cache_machine_id(Server *s) {
@@ -942,6 +1086,18 @@ static bool shall_try_append_again(JournalFile *f, int r) {
         }
 }
 
+static void server_account_append_latency(Server *s, const dual_timestamp *ts) {
+        usec_t n;
+
+        assert(s);
+        assert(ts);
+
+        /* The timestamp was taken when the event loop woke up for the message, hence this covers both the
+         * time the message spent queued behind others and the time it took to append it. */
+        n = now(CLOCK_MONOTONIC);
+        s->append_latency[MIN(log2u64(usec_sub_unsigned(n, ts->monotonic)), SERVER_LATENCY_BUCKETS - 1)]++;
+}
+
 static void server_write_to_journal(
                 Server *s,
                 uid_t uid,
@@ -950,7 +1106,7 @@ static void server_write_to_journal(
                 const dual_timestamp *ts,
                 int priority) {
 
-        bool vacuumed = false;
+        bool rotated = false;
         JournalFile *f;
         int r;
 
@@ -967,8 +1123,8 @@ static void server_write_to_journal(
 
                 log_ratelimit_info(JOURNAL_LOG_RATELIMIT, "Time jumped backwards, rotating.");
                 server_rotate(s);
-                server_vacuum(s, /* verbose = */ false);
-                vacuumed = true;
+                server_schedule_vacuum(s);
+                rotated = true;
         }
 
         f = server_find_journal(s, uid);
@@ -976,7 +1132,7 @@ static void server_write_to_journal(
                 return;
 
         if (journal_file_rotate_suggested(f, s->max_file_usec, LOG_DEBUG)) {
-                if (vacuumed) {
+                if (rotated) {
                         log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
                                               "Suppressing rotation, as we already rotated immediately before write attempt. Giving up.");
                         return;
@@ -985,8 +1141,8 @@ static void server_write_to_journal(
                 log_debug("%s: Journal header limits reached or header out-of-date, rotating.", f->path);
 
                 server_rotate_journal(s, TAKE_PTR(f), uid);
-                server_vacuum(s, /* verbose = */ false);
-                vacuumed = true;
+                server_schedule_vacuum(s);
+                rotated = true;
 
                 f = server_find_journal(s, uid);
                 if (!f)
@@ -1005,21 +1161,32 @@ static void server_write_to_journal(
                         /* ret_object= */ NULL,
                         /* ret_offset= */ NULL);
         if (r >= 0) {
+                server_account_append_latency(s, ts);
                 server_schedule_sync(s, priority);
                 return;
         }
 
         log_debug_errno(r, "Failed to write entry to %s (%zu items, %zu bytes): %m", f->path, n, iovec_total_size(iovec, n));
 
-        if (!shall_try_append_again(f, r))
-                return;
-        if (vacuumed) {
-                log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
-                                            "Suppressing rotation, as we already rotated immediately before write attempt. Giving up.");
+        if (!shall_try_append_again(f, r)) {
+                s->n_write_failed++;
                 return;
         }
+        if (rotated) {
+                /* We only scheduled the vacuuming after the rotation above. If the disk is full, that's
+                 * exactly what would make room for this entry, hence do it right away and try once more
+                 * with the journal we just opened, instead of dropping the entry. */
+                if (!IN_SET(r, -ENOSPC, -EDQUOT)) {
+                        s->n_write_failed++;
+                        log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
+                                                    "Suppressing rotation, as we already rotated immediately before write attempt. Giving up.");
+                        return;
+                }
+
+                log_debug_errno(r, "Already rotated immediately before write attempt, vacuuming right away.");
+        } else
+                server_rotate_journal(s, TAKE_PTR(f), uid);
 
-        server_rotate_journal(s, TAKE_PTR(f), uid);
         server_vacuum(s, /* verbose = */ false);
 
         f = server_find_journal(s, uid);
@@ -1036,12 +1203,15 @@ static void server_write_to_journal(
                         &s->seqnum->id,
                         /* ret_object= */ NULL,
                         /* ret_offset= */ NULL);
-        if (r < 0)
+        if (r < 0) {
+                s->n_write_failed++;
                 log_ratelimit_error_errno(r, FAILED_TO_WRITE_ENTRY_RATELIMIT,
                                           "Failed to write entry to %s (%zu items, %zu bytes) despite vacuuming, ignoring: %m",
                                           f->path, n, iovec_total_size(iovec, n));
-        else
+        } else {
+                server_account_append_latency(s, ts);
                 server_schedule_sync(s, priority);
+        }
 }
 
 #define IOVEC_ADD_NUMERIC_FIELD(iovec, n, value, type, isset, format, field)  \
@@ -1084,7 +1254,7 @@ static void server_dispatch_message_real(
                 pid_t object_pid) {
 
         char source_time[STRLEN("_SOURCE_REALTIME_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t)];
-        _unused_ _cleanup_free_ char *cmdline1 = NULL, *cmdline2 = NULL;
+        _unused_ _cleanup_free_ char *cmdline = NULL;
         uid_t journal_uid;
         ClientContext *o;
 
@@ -1104,10 +1274,10 @@ static void server_dispatch_message_real(
                 IOVEC_ADD_STRING_FIELD(iovec, n, c->comm, "_COMM"); /* At most TASK_COMM_LENGTH (16 bytes) */
                 IOVEC_ADD_STRING_FIELD(iovec, n, c->exe, "_EXE"); /* A path, so at most PATH_MAX (4096 bytes) */
 
-                if (c->cmdline)
-                        /* At most _SC_ARG_MAX (2MB usually), which is too much to put on stack.
-                         * Let's use a heap allocation for this one. */
-                        cmdline1 = set_iovec_string_field(iovec, &n, "_CMDLINE=", c->cmdline);
+                if (c->cmdline_field)
+                        /* At most _SC_ARG_MAX (2MB usually), hence the context keeps the ready-made field
+                         * around for us, instead of copying it for each message. */
+                        iovec[n++] = IOVEC_MAKE_STRING(c->cmdline_field);
 
                 IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->capability_quintet.effective, uint64_t, capability_is_set, "%" PRIx64, "_CAP_EFFECTIVE");
                 IOVEC_ADD_SIZED_FIELD(iovec, n, c->label, c->label_size, "_SELINUX_CONTEXT");
@@ -1138,11 +1308,11 @@ static void server_dispatch_message_real(
                 IOVEC_ADD_NUMERIC_FIELD(iovec, n, o->uid, uid_t, uid_is_valid, UID_FMT, "OBJECT_UID");
                 IOVEC_ADD_NUMERIC_FIELD(iovec, n, o->gid, gid_t, gid_is_valid, GID_FMT, "OBJECT_GID");
 
-                /* See above for size limits, only ->cmdline may be large, so use a heap allocation for it. */
+                /* See above for size limits, only the command line may be large, so use a heap allocation for it. */
                 IOVEC_ADD_STRING_FIELD(iovec, n, o->comm, "OBJECT_COMM");
                 IOVEC_ADD_STRING_FIELD(iovec, n, o->exe, "OBJECT_EXE");
-                if (o->cmdline)
-                        cmdline2 = set_iovec_string_field(iovec, &n, "OBJECT_CMDLINE=", o->cmdline);
+                if (o->cmdline_field)
+                        cmdline = set_iovec_string_field(iovec, &n, "OBJECT_CMDLINE=", o->cmdline_field + STRLEN("_CMDLINE="));
 
                 IOVEC_ADD_NUMERIC_FIELD(iovec, n, o->capability_quintet.effective, uint64_t, capability_is_set, "%" PRIx64, "OBJECT_CAP_EFFECTIVE");
                 IOVEC_ADD_SIZED_FIELD(iovec, n, o->label, o->label_size, "OBJECT_SELINUX_CONTEXT");
@@ -1294,8 +1464,10 @@ void server_dispatch_message(
                                 c->log_ratelimit_burst,
                                 LOG_PRI(priority),
                                 available);
-                if (rl == 0)
+                if (rl == 0) {
+                        s->n_suppressed++;
                         return;
+                }
 
                 /* Write a suppression message if we suppressed something */
                 if (rl > 1)
@@ -1488,14 +1660,8 @@ static int server_relinquish_var(Server *s) {
         return 0;
 }
 
-int server_process_datagram(
-                sd_event_source *es,
-                int fd,
-                uint32_t revents,
-                void *userdata) {
-
+static int server_process_one_datagram(Server *s, int fd) {
         size_t label_len = 0, m;
-        Server *s = ASSERT_PTR(userdata);
         struct ucred *ucred = NULL;
         struct timeval tv_buf, *tv = NULL;
         struct cmsghdr *cmsg;
@@ -1528,13 +1694,9 @@ int server_process_datagram(
                 .msg_namelen = sizeof(sa),
         };
 
+        assert(s);
         assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
 
-        if (revents != EPOLLIN)
-                return log_error_errno(SYNTHETIC_ERRNO(EIO),
-                                       "Got invalid event from epoll for datagram fd: %" PRIx32,
-                                       revents);
-
         /* Try to get the right size, if we can. (Not all sockets support SIOCINQ, hence we just try, but don't rely on
          * it.) */
         (void) ioctl(fd, SIOCINQ, &v);
@@ -1555,11 +1717,11 @@ int server_process_datagram(
         if (n == -ECHRNG) {
                 log_ratelimit_warning_errno(n, JOURNAL_LOG_RATELIMIT,
                                             "Got message with truncated control data (too many fds sent?), ignoring.");
-                return 0;
+                return 1;
         }
         if (n == -EXFULL) {
                 log_ratelimit_warning_errno(n, JOURNAL_LOG_RATELIMIT, "Got message with truncated payload data, ignoring.");
-                return 0;
+                return 1;
         }
         if (n < 0)
                 return log_ratelimit_error_errno(n, JOURNAL_LOG_RATELIMIT, "Failed to receive message: %m");
@@ -1618,8 +1780,36 @@ int server_process_datagram(
 
         close_many(fds, n_fds);
 
+        return 1;
+}
+
+int server_process_datagram(
+                sd_event_source *es,
+                int fd,
+                uint32_t revents,
+                void *userdata) {
+
+        Server *s = ASSERT_PTR(userdata);
+        int r = 0;
+
+        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
+
+        if (revents != EPOLLIN)
+                return log_error_errno(SYNTHETIC_ERRNO(EIO),
+                                       "Got invalid event from epoll for datagram fd: %" PRIx32,
+                                       revents);
+
+        /* Under a flood of messages, going through the event loop for every single datagram is costly.
+         * Hence, drain a bounded number of datagrams per wakeup. The bound ensures we still get around to
+         * serve the other sockets and streams in a timely fashion. */
+        for (unsigned i = 0; i < DATAGRAM_BATCH_MAX; i++) {
+                r = server_process_one_datagram(s, fd);
+                if (r <= 0)
+                        break;
+        }
+
         server_refresh_idle_timer(s);
-        return 0;
+        return MIN(r, 0);
 }
 
 static void server_full_flush(Server *s) {
@@ -2302,6 +2492,47 @@ static int vl_method_relinquish_var(sd_varlink *link, sd_json_variant *parameter
         return sd_varlink_reply(link, NULL);
 }
 
+static int vl_method_get_statistics(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *sources = NULL, *latency = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        unsigned mmap_hit, mmap_missed;
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return sd_varlink_error_invalid_parameter(link, parameters);
+
+        for (ServerSource i = 0; i < _SERVER_SOURCE_MAX; i++) {
+                r = sd_json_variant_append_arraybo(
+                                &sources,
+                                SD_JSON_BUILD_PAIR_STRING("source", server_source_to_string(i)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("messages", s->source_statistics[i].n_messages),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("bytes", s->source_statistics[i].n_bytes));
+                if (r < 0)
+                        return r;
+        }
+
+        FOREACH_ELEMENT(b, s->append_latency) {
+                r = sd_json_variant_append_arrayb(&latency, SD_JSON_BUILD_UNSIGNED(*b));
+                if (r < 0)
+                        return r;
+        }
+
+        mmap_cache_stats(s->mmap, &mmap_hit, &mmap_missed);
+
+        return sd_varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_VARIANT("sources", sources),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("suppressed", s->n_suppressed),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("writeFailed", s->n_write_failed),
+                        SD_JSON_BUILD_PAIR_VARIANT("appendLatencyHistogramUSec", latency),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("clientContextCacheHits", s->n_client_context_hit),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("clientContextCacheMisses", s->n_client_context_missed),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("mmapCacheHits", mmap_hit),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("mmapCacheMisses", mmap_missed));
+}
+
 static int vl_connect(sd_varlink_server *server, sd_varlink *link, void *userdata) {
         Server *s = ASSERT_PTR(userdata);
 
@@ -2343,7 +2574,8 @@ static int server_open_varlink(Server *s, const char *socket, int fd) {
                         "io.systemd.Journal.Synchronize",   vl_method_synchronize,
                         "io.systemd.Journal.Rotate",        vl_method_rotate,
                         "io.systemd.Journal.FlushToVar",    vl_method_flush_to_var,
-                        "io.systemd.Journal.RelinquishVar", vl_method_relinquish_var);
+                        "io.systemd.Journal.RelinquishVar", vl_method_relinquish_var,
+                        "io.systemd.Journal.GetStatistics", vl_method_get_statistics);
         if (r < 0)
                 return r;
 
@@ -2919,6 +3151,7 @@ Server* server_free(Server *s) {
         sd_event_source_unref(s->notify_event_source);
         sd_event_source_unref(s->watchdog_event_source);
         sd_event_source_unref(s->idle_event_source);
+        sd_event_source_unref(s->vacuum_event_source);
         sd_event_unref(s->event);
 
         safe_close(s->syslog_fd);
@@ -2967,6 +3200,16 @@ static const char* const split_mode_table[_SPLIT_MAX] = {
 DEFINE_STRING_TABLE_LOOKUP(split_mode, SplitMode);
 DEFINE_CONFIG_PARSE_ENUM(config_parse_split_mode, split_mode, SplitMode);
 
+static const char* const server_source_table[_SERVER_SOURCE_MAX] = {
+        [SERVER_SOURCE_NATIVE] = "native",
+        [SERVER_SOURCE_SYSLOG] = "syslog",
+        [SERVER_SOURCE_STDOUT] = "stdout",
+        [SERVER_SOURCE_KERNEL] = "kernel",
+        [SERVER_SOURCE_AUDIT]  = "audit",
+};
+
+DEFINE_STRING_TABLE_LOOKUP_TO_STRING(server_source, ServerSource);
+
 int config_parse_line_max(
                 const char* unit,
                 const char *filename,
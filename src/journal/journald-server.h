@@ -38,6 +38,25 @@ typedef enum SplitMode {
         _SPLIT_INVALID = -EINVAL,
 } SplitMode;
 
+typedef enum ServerSource {
+        SERVER_SOURCE_NATIVE,
+        SERVER_SOURCE_SYSLOG,
+        SERVER_SOURCE_STDOUT,
+        SERVER_SOURCE_KERNEL,
+        SERVER_SOURCE_AUDIT,
+        _SERVER_SOURCE_MAX,
+        _SERVER_SOURCE_INVALID = -EINVAL,
+} ServerSource;
+
+typedef struct ServerSourceStatistics {
+        uint64_t n_messages;
+        uint64_t n_bytes;
+} ServerSourceStatistics;
+
+/* Bucket i of the latency histograms counts latencies in the range [2^i, 2^(i+1)) µs, the first bucket also
+ * covers 0, the last one everything that doesn't fit anywhere else. */
+#define SERVER_LATENCY_BUCKETS 24U
+
 typedef struct JournalCompressOptions {
         bool enabled;
         uint64_t threshold_bytes;
@@ -51,6 +70,9 @@ typedef struct JournalStorageSpace {
 
         uint64_t vfs_used; /* space used by journal files */
         uint64_t vfs_available;
+
+        uint64_t n_files; /* number of journal files, active and archived */
+        usec_t oldest_usec; /* head timestamp of the oldest archived file, from its name */
 } JournalStorageSpace;
 
 typedef struct JournalStorage {
@@ -59,6 +81,10 @@ typedef struct JournalStorage {
 
         JournalMetrics metrics;
         JournalStorageSpace space;
+
+        /* Set once a full vacuum went through the directory, and cleared again whenever we archive a file
+         * without entries there, which the next vacuum would then have to delete. */
+        bool no_empty_files;
 } JournalStorage;
 
 /* This structure will be kept in $RUNTIME_DIRECTORY/seqnum and is mapped by journald, and is used to
@@ -97,6 +123,7 @@ struct Server {
         sd_event_source *notify_event_source;
         sd_event_source *watchdog_event_source;
         sd_event_source *idle_event_source;
+        sd_event_source *vacuum_event_source;
         struct sigrtmin18_info sigrtmin18_info;
 
         JournalFile *runtime_journal;
@@ -179,6 +206,7 @@ struct Server {
         /* Caching of client metadata */
         Hashmap *client_contexts;
         Prioq *client_contexts_lru;
+        Hashmap *unit_properties; /* unit name → properties PID 1 published for it */
 
         usec_t last_cache_pid_flush;
 
@@ -186,6 +214,14 @@ struct Server {
         ClientContext *pid1_context; /* the context of PID 1 */
 
         sd_varlink_server *varlink_server;
+
+        /* Counters exposed via io.systemd.Journal.GetStatistics */
+        ServerSourceStatistics source_statistics[_SERVER_SOURCE_MAX];
+        uint64_t n_suppressed;
+        uint64_t n_write_failed;
+        uint64_t n_client_context_hit;
+        uint64_t n_client_context_missed;
+        uint64_t append_latency[SERVER_LATENCY_BUCKETS]; /* entry received → entry appended */
 };
 
 #define SERVER_MACHINE_ID(s) ((s)->machine_id_field + STRLEN("_MACHINE_ID="))
@@ -208,6 +244,14 @@ struct Server {
 /* audit: Maximum number of extra fields we'll import from audit messages */
 #define N_IOVEC_AUDIT_FIELDS 64
 
+static inline void server_account_message(Server *s, ServerSource source, size_t size) {
+        assert(s);
+        assert(source >= 0 && source < _SERVER_SOURCE_MAX);
+
+        s->source_statistics[source].n_messages++;
+        s->source_statistics[source].n_bytes += size;
+}
+
 void server_dispatch_message(Server *s, struct iovec *iovec, size_t n, size_t m, ClientContext *c, const struct timeval *tv, int priority, pid_t object_pid);
 void server_driver_message(Server *s, pid_t object_pid, const char *message_id, const char *format, ...) _sentinel_ _printf_(4,0);
 
@@ -227,6 +271,8 @@ CONFIG_PARSER_PROTOTYPE(config_parse_split_mode);
 const char* split_mode_to_string(SplitMode s) _const_;
 SplitMode split_mode_from_string(const char *s) _pure_;
 
+const char* server_source_to_string(ServerSource s) _const_;
+
 int server_new(Server **ret);
 int server_init(Server *s, const char *namespace);
 Server* server_free(Server *s);
@@ -265,6 +265,8 @@ static int stdout_stream_log(
         assert(line_break >= 0);
         assert(line_break < _LINE_BREAK_MAX);
 
+        server_account_message(s->server, SERVER_SOURCE_STDOUT, strlen(p));
+
         if (s->context)
                 (void) client_context_maybe_refresh(s->server, s->context, NULL, NULL, 0, NULL, USEC_INFINITY);
         else if (pid_is_valid(s->ucred.pid)) {
@@ -499,6 +501,7 @@ static int stdout_stream_scan(
                 StdoutStream *s,
                 char *p,
                 size_t remaining,
+                size_t clean,
                 LineBreak force_flush,
                 size_t *ret_consumed) {
 
@@ -508,17 +511,24 @@ static int stdout_stream_scan(
         assert(s);
         assert(p);
 
+        /* 'clean' is the number of bytes at the beginning of 'p' which are already known to contain neither
+         * a newline nor a NUL byte, i.e. the partial line left over from the previous read. There's no point
+         * in looking at them again, which matters if long lines trickle in in small pieces. */
+
         for (;;) {
                 LineBreak line_break;
                 size_t skip, found;
                 char *end1, *end2;
-                size_t tmp_remaining, line_max;
+                size_t tmp_remaining, line_max, k;
 
                 line_max = stdout_stream_line_max(s);
                 tmp_remaining = MIN(remaining, line_max);
 
-                end1 = memchr(p, '\n', tmp_remaining);
-                end2 = memchr(p, 0, end1 ? (size_t) (end1 - p) : tmp_remaining);
+                k = MIN(clean, tmp_remaining);
+                clean = 0;
+
+                end1 = memchr(p + k, '\n', tmp_remaining - k);
+                end2 = memchr(p + k, 0, end1 ? (size_t) (end1 - p) - k : tmp_remaining - k);
 
                 if (end2) {
                         /* We found a NUL terminator */
@@ -562,7 +572,7 @@ static int stdout_stream_scan(
 
 static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
         CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred))) control;
-        size_t limit, consumed, allocated;
+        size_t limit, consumed, allocated, clean;
         StdoutStream *s = ASSERT_PTR(userdata);
         struct ucred *ucred;
         struct iovec iovec;
@@ -610,7 +620,7 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         cmsg_close_all(&msghdr);
 
         if (l == 0) {
-                (void) stdout_stream_scan(s, s->buffer, s->length, /* force_flush = */ LINE_BREAK_EOF, NULL);
+                (void) stdout_stream_scan(s, s->buffer, s->length, s->length, /* force_flush = */ LINE_BREAK_EOF, NULL);
                 goto terminate;
         }
 
@@ -621,15 +631,17 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         if (ucred && ucred->pid != s->ucred.pid) {
                 /* Force out any previously half-written lines from a different process, before we switch to
                  * the new ucred structure for everything we just added */
-                r = stdout_stream_scan(s, s->buffer, s->length, /* force_flush = */ LINE_BREAK_PID_CHANGE, NULL);
+                r = stdout_stream_scan(s, s->buffer, s->length, s->length, /* force_flush = */ LINE_BREAK_PID_CHANGE, NULL);
                 if (r < 0)
                         goto terminate;
 
                 s->context = client_context_release(s->server, s->context);
 
                 p = s->buffer + s->length;
+                clean = 0;
         } else {
                 p = s->buffer;
+                clean = s->length;
                 l += s->length;
         }
 
@@ -637,7 +649,7 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         if (ucred)
                 s->ucred = *ucred;
 
-        r = stdout_stream_scan(s, p, l, _LINE_BREAK_INVALID, &consumed);
+        r = stdout_stream_scan(s, p, l, clean, _LINE_BREAK_INVALID, &consumed);
         if (r < 0)
                 goto terminate;
 
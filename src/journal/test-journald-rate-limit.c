@@ -35,6 +35,13 @@ TEST(journal_ratelimit_test) {
         assert_se(journal_ratelimit_test(&rl, "hoge", USEC_PER_SEC, 10, LOG_INFO, 0) == 1);
         assert_se(journal_ratelimit_test(&rl, "foo", 10 * USEC_PER_SEC, 10, LOG_INFO, 0) == 1);
         assert_se(journal_ratelimit_test(&rl, "quux", USEC_PER_SEC, 10, LOG_DEBUG, 0) == 1);
+
+        /* Disabled ratelimits are never hit, and don't need any tracking. */
+        for (unsigned i = 0; i < 20; i++) {
+                assert_se(journal_ratelimit_test(&rl, "bar", 0, 10, LOG_DEBUG, 0) == 1);
+                assert_se(journal_ratelimit_test(&rl, "bar", USEC_PER_SEC, 0, LOG_DEBUG, 0) == 1);
+        }
+        assert_se(!ordered_hashmap_contains(rl, "bar"));
 }
 
 DEFINE_TEST_MAIN(LOG_INFO);
@@ -44,6 +44,7 @@ struct sd_dhcp_server {
         be32_t subnet;
         uint32_t pool_offset;
         uint32_t pool_size;
+        uint64_t *pool_bitmap; /* One bit per address in the pool, set when the address is not available */
 
         char *timezone;
 
@@ -78,6 +79,7 @@ struct sd_dhcp_server {
 
         int lease_dir_fd;
         char *lease_file;
+        sd_event_source *save_leases_event_source;
 };
 
 typedef struct DHCPRequest {
@@ -98,6 +100,8 @@ typedef struct DHCPRequest {
         triple_timestamp timestamp;
 } DHCPRequest;
 
+void dhcp_server_pool_update_address(sd_dhcp_server *server, be32_t address);
+
 int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                                size_t length, const triple_timestamp *timestamp);
 int dhcp_server_send_packet(sd_dhcp_server *server,
@@ -165,6 +165,53 @@ static int parse_string(sd_lldp_rx *lldp_rx, char **s, const void *q, size_t n)
         return 1;
 }
 
+int lldp_neighbor_id_from_raw(const void *raw, size_t raw_size, LLDPNeighborID *ret) {
+        LLDPNeighborID id = {};
+        const uint8_t *p;
+        size_t left;
+
+        assert(raw || raw_size == 0);
+        assert(ret);
+
+        /* Finds the MSAP identifier of a datagram without parsing or copying anything else. The returned
+         * object points into the datagram. Note that this does not validate the datagram. */
+
+        if (raw_size < sizeof(struct ether_header))
+                return -EBADMSG;
+
+        p = (const uint8_t*) raw + sizeof(struct ether_header);
+        left = raw_size - sizeof(struct ether_header);
+
+        while (left >= 2) {
+                uint8_t type;
+                uint16_t length;
+
+                type = p[0] >> 1;
+                length = p[1] + (((uint16_t) (p[0] & 1)) << 8);
+                p += 2, left -= 2;
+
+                if (left < length || type == SD_LLDP_TYPE_END)
+                        break;
+
+                if (type == SD_LLDP_TYPE_CHASSIS_ID && !id.chassis_id) {
+                        id.chassis_id = (void*) p;
+                        id.chassis_id_size = length;
+                } else if (type == SD_LLDP_TYPE_PORT_ID && !id.port_id) {
+                        id.port_id = (void*) p;
+                        id.port_id_size = length;
+                }
+
+                if (id.chassis_id && id.port_id) {
+                        *ret = id;
+                        return 0;
+                }
+
+                p += length, left -= length;
+        }
+
+        return -EBADMSG;
+}
+
 int lldp_neighbor_parse(sd_lldp_neighbor *n) {
         struct ether_header h;
         const uint8_t *p;
@@ -24,6 +24,8 @@ struct sd_lldp_rx {
         Prioq *neighbor_by_expiry;
         Hashmap *neighbor_by_id;
 
+        uint8_t *receive_buffer;
+
         uint64_t neighbors_max;
 
         sd_lldp_rx_callback_t callback;
@@ -17,6 +17,7 @@ static sd_dhcp_server_lease* dhcp_server_lease_free(sd_dhcp_server_lease *lease)
                 hashmap_remove_value(lease->server->bound_leases_by_client_id, &lease->client_id, lease);
                 hashmap_remove_value(lease->server->static_leases_by_address, UINT32_TO_PTR(lease->address), lease);
                 hashmap_remove_value(lease->server->static_leases_by_client_id, &lease->client_id, lease);
+                dhcp_server_pool_update_address(lease->server, lease->address);
         }
 
         free(lease->hostname);
@@ -51,6 +52,7 @@ int dhcp_server_put_lease(sd_dhcp_server *server, sd_dhcp_server_lease *lease, b
         if (r < 0)
                 return r;
 
+        dhcp_server_pool_update_address(server, lease->address);
         return 0;
 }
 
@@ -68,11 +70,14 @@ int dhcp_server_set_lease(sd_dhcp_server *server, be32_t address, DHCPRequest *r
         if (lease) {
                 if (lease->address != address) {
                         hashmap_remove_value(server->bound_leases_by_address, UINT32_TO_PTR(lease->address), lease);
+                        dhcp_server_pool_update_address(server, lease->address);
                         lease->address = address;
 
                         r = hashmap_ensure_put(&server->bound_leases_by_address, NULL, UINT32_TO_PTR(lease->address), lease);
                         if (r < 0)
                                 return r;
+
+                        dhcp_server_pool_update_address(server, lease->address);
                 }
 
                 lease->expiration = expiration;
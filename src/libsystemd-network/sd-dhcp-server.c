@@ -16,6 +16,7 @@
 #include "dhcp-server-internal.h"
 #include "dhcp-server-lease-internal.h"
 #include "dns-domain.h"
+#include "event-util.h"
 #include "fd-util.h"
 #include "in-addr-util.h"
 #include "iovec-util.h"
@@ -30,15 +31,54 @@
 
 #define DHCP_DEFAULT_LEASE_TIME_USEC USEC_PER_HOUR
 #define DHCP_MAX_LEASE_TIME_USEC (USEC_PER_HOUR*12)
+#define DHCP_SERVER_SAVE_LEASES_DELAY_USEC (1 * USEC_PER_SEC)
 
-static void server_on_lease_change(sd_dhcp_server *server) {
+static void server_save_leases(sd_dhcp_server *server) {
         int r;
 
         assert(server);
 
+        (void) event_source_disable(server->save_leases_event_source);
+
         r = dhcp_server_save_leases(server);
         if (r < 0)
                 log_dhcp_server_errno(server, r, "Failed to save leases, ignoring: %m");
+}
+
+static void server_flush_leases(sd_dhcp_server *server) {
+        assert(server);
+
+        if (sd_event_source_get_enabled(server->save_leases_event_source, NULL) > 0)
+                server_save_leases(server);
+}
+
+static int on_save_leases(sd_event_source *s, uint64_t usec, void *userdata) {
+        server_save_leases(ASSERT_PTR(userdata));
+        return 0;
+}
+
+static void server_on_lease_change(sd_dhcp_server *server) {
+        int r;
+
+        assert(server);
+
+        /* Rewriting the whole lease file on every change is costly when many clients come and go, hence
+         * coalesce the changes within a short time window. The timer is not pushed further when it is
+         * already armed, so that the file never lags behind for longer than that. Pending changes are
+         * written out when the server is stopped. */
+        if (!server->event)
+                server_save_leases(server);
+        else if (server->lease_file) {
+                r = event_reset_time_relative(server->event, &server->save_leases_event_source,
+                                              CLOCK_BOOTTIME, DHCP_SERVER_SAVE_LEASES_DELAY_USEC, 0,
+                                              on_save_leases, server,
+                                              server->event_priority, "dhcp-server-save-leases",
+                                              /* force_reset = */ false);
+                if (r < 0) {
+                        log_dhcp_server_errno(server, r, "Failed to schedule saving leases, saving now: %m");
+                        server_save_leases(server);
+                }
+        }
 
         if (server->callback)
                 server->callback(server, SD_DHCP_SERVER_EVENT_LEASE_CHANGED, server->callback_userdata);
@@ -97,6 +137,7 @@ int sd_dhcp_server_configure_pool(
 
                 server->pool_offset = offset;
                 server->pool_size = size;
+                server->pool_bitmap = mfree(server->pool_bitmap);
 
                 server->address = address->s_addr;
                 server->netmask = netmask;
@@ -124,6 +165,7 @@ static sd_dhcp_server *dhcp_server_free(sd_dhcp_server *server) {
 
         sd_dhcp_server_stop(server);
 
+        sd_event_source_unref(server->save_leases_event_source);
         sd_event_unref(server->event);
 
         free(server->boot_server_name);
@@ -133,6 +175,7 @@ static sd_dhcp_server *dhcp_server_free(sd_dhcp_server *server) {
         for (sd_dhcp_lease_server_type_t i = 0; i < _SD_DHCP_LEASE_SERVER_TYPE_MAX; i++)
                 free(server->servers[i].addr);
 
+        server->pool_bitmap = mfree(server->pool_bitmap);
         server->bound_leases_by_address = hashmap_free(server->bound_leases_by_address);
         server->bound_leases_by_client_id = hashmap_free(server->bound_leases_by_client_id);
         server->static_leases_by_address = hashmap_free(server->static_leases_by_address);
@@ -230,6 +273,8 @@ int sd_dhcp_server_attach_event(sd_dhcp_server *server, sd_event *event, int64_t
 int sd_dhcp_server_detach_event(sd_dhcp_server *server) {
         assert_return(server, -EINVAL);
 
+        server_flush_leases(server);
+        server->save_leases_event_source = sd_event_source_disable_unref(server->save_leases_event_source);
         server->event = sd_event_unref(server->event);
 
         return 0;
@@ -292,6 +337,8 @@ int sd_dhcp_server_stop(sd_dhcp_server *server) {
         server->fd = safe_close(server->fd);
         server->fd_broadcast = safe_close(server->fd_broadcast);
 
+        server_flush_leases(server);
+
         if (running)
                 log_dhcp_server(server, "STOPPED");
 
@@ -1015,6 +1062,104 @@ static bool address_available(sd_dhcp_server *server, be32_t address) {
         return true;
 }
 
+static bool address_to_pool_index(sd_dhcp_server *server, be32_t address, uint32_t *ret) {
+        uint32_t offset;
+
+        assert(server);
+        assert(ret);
+
+        if (server->pool_size == 0)
+                return false;
+
+        if ((address & server->netmask) != server->subnet)
+                return false;
+
+        offset = be32toh(address & ~server->netmask);
+        if (offset < server->pool_offset || offset - server->pool_offset >= server->pool_size)
+                return false;
+
+        *ret = offset - server->pool_offset;
+        return true;
+}
+
+void dhcp_server_pool_update_address(sd_dhcp_server *server, be32_t address) {
+        uint32_t i;
+
+        assert(server);
+
+        /* Called whenever an address was added to or removed from the lease tables. */
+
+        if (!server->pool_bitmap)
+                return;
+
+        if (!address_to_pool_index(server, address, &i))
+                return;
+
+        if (address_available(server, address))
+                server->pool_bitmap[i / 64] &= ~(UINT64_C(1) << (i % 64));
+        else
+                server->pool_bitmap[i / 64] |= UINT64_C(1) << (i % 64);
+}
+
+static int server_ensure_pool_bitmap(sd_dhcp_server *server) {
+        sd_dhcp_server_lease *lease;
+        size_t n;
+
+        assert(server);
+        assert(server->pool_size > 0);
+
+        if (server->pool_bitmap)
+                return 0;
+
+        n = DIV_ROUND_UP(server->pool_size, 64);
+
+        server->pool_bitmap = new0(uint64_t, n);
+        if (!server->pool_bitmap)
+                return -ENOMEM;
+
+        /* The bits beyond the end of the pool are never available. */
+        if (server->pool_size % 64 != 0)
+                server->pool_bitmap[n - 1] = UINT64_MAX << (server->pool_size % 64);
+
+        dhcp_server_pool_update_address(server, server->address);
+
+        HASHMAP_FOREACH(lease, server->bound_leases_by_address)
+                dhcp_server_pool_update_address(server, lease->address);
+        HASHMAP_FOREACH(lease, server->static_leases_by_address)
+                dhcp_server_pool_update_address(server, lease->address);
+
+        return 0;
+}
+
+static be32_t server_find_free_address(sd_dhcp_server *server, uint32_t start) {
+        size_t n, i;
+        uint64_t mask;
+
+        assert(server);
+        assert(server->pool_bitmap);
+        assert(start < server->pool_size);
+
+        /* Finds the first available address at or after the given index into the pool, wrapping around at
+         * the end of the pool. The first word is visited twice, as its bits before the start index are
+         * only considered after wrapping around. */
+
+        n = DIV_ROUND_UP(server->pool_size, 64);
+        i = start / 64;
+        mask = UINT64_MAX << (start % 64);
+
+        for (size_t k = 0; k <= n; k++) {
+                uint64_t free_bits = ~server->pool_bitmap[i] & mask;
+
+                if (free_bits != 0)
+                        return server->subnet | htobe32(server->pool_offset + i * 64 + __builtin_ctzll(free_bits));
+
+                mask = UINT64_MAX;
+                i = (i + 1) % n;
+        }
+
+        return INADDR_ANY;
+}
+
 #define HASH_KEY SD_ID128_MAKE(0d,1d,fe,bd,f1,24,bd,b3,47,f1,dd,6e,73,21,93,30)
 
 int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message, size_t length, const triple_timestamp *timestamp) {
@@ -1087,15 +1232,11 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message, siz
                         client_id_hash_func(&req->client_id, &state);
                         hash = htole64(siphash24_finalize(&state));
 
-                        for (unsigned i = 0; i < server->pool_size; i++) {
-                                be32_t tmp_address;
+                        r = server_ensure_pool_bitmap(server);
+                        if (r < 0)
+                                return r;
 
-                                tmp_address = server->subnet | htobe32(server->pool_offset + (hash + i) % server->pool_size);
-                                if (address_available(server, tmp_address)) {
-                                        address = tmp_address;
-                                        break;
-                                }
-                        }
+                        address = server_find_free_address(server, hash % server->pool_size);
                 }
 
                 if (address == INADDR_ANY)
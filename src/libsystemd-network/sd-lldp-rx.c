@@ -172,6 +172,39 @@ finish:
         return r;
 }
 
+static bool lldp_rx_refresh_neighbor(sd_lldp_rx *lldp_rx, const void *raw, size_t raw_size, const triple_timestamp *timestamp) {
+        _cleanup_(sd_lldp_neighbor_unrefp) sd_lldp_neighbor *old = NULL;
+        LLDPNeighborID id;
+
+        assert(lldp_rx);
+        assert(timestamp);
+
+        /* Neighbors send the same datagram again and again, merely to refresh its TTL. Recognize these
+         * repetitions by looking up the MSAP identifier and comparing the raw data, before allocating and
+         * parsing a new neighbor object. Returns true if the datagram was handled that way. */
+
+        if (lldp_neighbor_id_from_raw(raw, raw_size, &id) < 0)
+                return false;
+
+        old = sd_lldp_neighbor_ref(hashmap_get(lldp_rx->neighbor_by_id, &id));
+        if (!old)
+                return false;
+
+        if (old->raw_size != raw_size || memcmp(LLDP_NEIGHBOR_RAW(old), raw, raw_size) != 0)
+                return false;
+
+        /* The settings might have changed since the neighbor was added. */
+        if (!lldp_rx_keep_neighbor(lldp_rx, old))
+                return false;
+
+        old->timestamp = *timestamp;
+        lldp_rx_start_timer(lldp_rx, old);
+        lldp_rx_callback(lldp_rx, SD_LLDP_RX_EVENT_REFRESHED, old);
+
+        log_lldp_rx(lldp_rx, "Successfully processed LLDP datagram.");
+        return true;
+}
+
 static int lldp_rx_handle_datagram(sd_lldp_rx *lldp_rx, sd_lldp_neighbor *n) {
         int r;
 
@@ -194,6 +227,7 @@ static int lldp_rx_receive_datagram(sd_event_source *s, int fd, uint32_t revents
         _cleanup_(sd_lldp_neighbor_unrefp) sd_lldp_neighbor *n = NULL;
         ssize_t space, length;
         sd_lldp_rx *lldp_rx = ASSERT_PTR(userdata);
+        triple_timestamp timestamp;
         struct timespec ts;
 
         assert(fd >= 0);
@@ -206,13 +240,14 @@ static int lldp_rx_receive_datagram(sd_event_source *s, int fd, uint32_t revents
                 return 0;
         }
 
-        n = lldp_neighbor_new(space);
-        if (!n) {
+        /* Receive into a buffer that is reused for all datagrams, so that refreshes of known neighbors do not
+         * need any allocation. */
+        if (!GREEDY_REALLOC(lldp_rx->receive_buffer, MAX(space, 1))) {
                 log_oom_debug();
                 return 0;
         }
 
-        length = recv(fd, LLDP_NEIGHBOR_RAW(n), n->raw_size, MSG_DONTWAIT);
+        length = recv(fd, lldp_rx->receive_buffer, space, MSG_DONTWAIT);
         if (length < 0) {
                 if (ERRNO_IS_TRANSIENT(errno) || ERRNO_IS_DISCONNECT(errno))
                         return 0;
@@ -221,16 +256,28 @@ static int lldp_rx_receive_datagram(sd_event_source *s, int fd, uint32_t revents
                 return 0;
         }
 
-        if ((size_t) length != n->raw_size) {
+        if (length != space) {
                 log_lldp_rx(lldp_rx, "Packet size mismatch, ignoring");
                 return 0;
         }
 
         /* Try to get the timestamp of this packet if it is known */
         if (ioctl(fd, SIOCGSTAMPNS, &ts) >= 0)
-                triple_timestamp_from_realtime(&n->timestamp, timespec_load(&ts));
+                triple_timestamp_from_realtime(&timestamp, timespec_load(&ts));
         else
-                triple_timestamp_now(&n->timestamp);
+                triple_timestamp_now(&timestamp);
+
+        if (lldp_rx_refresh_neighbor(lldp_rx, lldp_rx->receive_buffer, length, &timestamp))
+                return 0;
+
+        n = lldp_neighbor_new(length);
+        if (!n) {
+                log_oom_debug();
+                return 0;
+        }
+
+        memcpy(LLDP_NEIGHBOR_RAW(n), lldp_rx->receive_buffer, length);
+        n->timestamp = timestamp;
 
         (void) lldp_rx_handle_datagram(lldp_rx, n);
         return 0;
@@ -388,6 +435,7 @@ static sd_lldp_rx *lldp_rx_free(sd_lldp_rx *lldp_rx) {
 
         hashmap_free(lldp_rx->neighbor_by_id);
         prioq_free(lldp_rx->neighbor_by_expiry);
+        free(lldp_rx->receive_buffer);
         free(lldp_rx->ifname);
         return mfree(lldp_rx);
 }
@@ -446,9 +494,11 @@ static int lldp_rx_start_timer(sd_lldp_rx *lldp_rx, sd_lldp_neighbor *neighbor)
         if (!n)
                 return event_source_disable(lldp_rx->timer_event_source);
 
+        /* TTLs are in seconds anyway, hence allow the expiry of neighbors to be delayed by up to a second,
+         * so that the timers of many interfaces can be coalesced into a single wakeup. */
         return event_reset_time(lldp_rx->event, &lldp_rx->timer_event_source,
                                 CLOCK_BOOTTIME,
-                                n->until, 0,
+                                n->until, USEC_PER_SEC,
                                 on_timer_event, lldp_rx,
                                 lldp_rx->event_priority, "lldp-rx-timer", true);
 }
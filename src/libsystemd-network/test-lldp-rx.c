@@ -22,6 +22,7 @@
 
 static int test_fd[2] = EBADF_PAIR;
 static int lldp_rx_handler_calls;
+static sd_lldp_rx_event_t lldp_rx_handler_last_event = _SD_LLDP_RX_EVENT_INVALID;
 
 int lldp_network_bind_raw_socket(int ifindex) {
         if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0, test_fd) < 0)
@@ -32,6 +33,7 @@ int lldp_network_bind_raw_socket(int ifindex) {
 
 static void lldp_rx_handler(sd_lldp_rx *lldp_rx, sd_lldp_rx_event_t event, sd_lldp_neighbor *n, void *userdata) {
         lldp_rx_handler_calls++;
+        lldp_rx_handler_last_event = event;
 }
 
 static int start_lldp_rx(sd_lldp_rx **lldp_rx, sd_event *e, sd_lldp_rx_callback_t cb, void *cb_data) {
@@ -362,6 +364,64 @@ static void test_multiple_neighbors_sorted(sd_event *e) {
         assert_se(stop_lldp_rx(lldp_rx) == 0);
 }
 
+static void test_receive_refresh(sd_event *e) {
+
+        uint8_t frame[] = {
+                /* Ethernet header */
+                0x01, 0x80, 0xc2, 0x00, 0x00, 0x03,     /* Destination MAC */
+                0x01, 0x02, 0x03, 0x04, 0x05, 0x06,     /* Source MAC */
+                0x88, 0xcc,                             /* Ethertype */
+                /* LLDP mandatory TLVs */
+                0x02, 0x07, 0x04, 0x00, 0x01, 0x02,     /* Chassis: MAC, 00:01:02:03:04:05 */
+                0x03, 0x04, 0x05,
+                0x04, 0x04, 0x05, 0x31, 0x2f, 0x33,     /* Port: interface name, "1/3" */
+                0x06, 0x02, 0x00, 0x78,                 /* TTL: 120 seconds */
+                /* LLDP optional TLVs */
+                0x0a, 0x03, 0x53, 0x59, 0x53,           /* System Name: "SYS" */
+                0x00, 0x00                              /* End Of LLDPDU */
+        };
+
+        sd_lldp_rx *lldp_rx;
+        sd_lldp_neighbor **neighbors, *first;
+        const char *str;
+
+        lldp_rx_handler_calls = 0;
+        assert_se(start_lldp_rx(&lldp_rx, e, lldp_rx_handler, NULL) == 0);
+
+        assert_se(write(test_fd[1], frame, sizeof(frame)) == sizeof(frame));
+        sd_event_run(e, 0);
+        assert_se(lldp_rx_handler_calls == 1);
+        assert_se(lldp_rx_handler_last_event == SD_LLDP_RX_EVENT_ADDED);
+        assert_se(sd_lldp_rx_get_neighbors(lldp_rx, &neighbors) == 1);
+        first = neighbors[0];
+        sd_lldp_neighbor_unref(neighbors[0]);
+        free(neighbors);
+
+        /* The same datagram again only refreshes the known neighbor. */
+        assert_se(write(test_fd[1], frame, sizeof(frame)) == sizeof(frame));
+        sd_event_run(e, 0);
+        assert_se(lldp_rx_handler_calls == 2);
+        assert_se(lldp_rx_handler_last_event == SD_LLDP_RX_EVENT_REFRESHED);
+        assert_se(sd_lldp_rx_get_neighbors(lldp_rx, &neighbors) == 1);
+        assert_se(neighbors[0] == first);
+        sd_lldp_neighbor_unref(neighbors[0]);
+        free(neighbors);
+
+        /* Changed data from the same MSAP replaces the neighbor. */
+        frame[sizeof(frame) - 3] = 'X';
+        assert_se(write(test_fd[1], frame, sizeof(frame)) == sizeof(frame));
+        sd_event_run(e, 0);
+        assert_se(lldp_rx_handler_calls == 3);
+        assert_se(lldp_rx_handler_last_event == SD_LLDP_RX_EVENT_UPDATED);
+        assert_se(sd_lldp_rx_get_neighbors(lldp_rx, &neighbors) == 1);
+        assert_se(sd_lldp_neighbor_get_system_name(neighbors[0], &str) == 0);
+        assert_se(streq(str, "SYX"));
+        sd_lldp_neighbor_unref(neighbors[0]);
+        free(neighbors);
+
+        assert_se(stop_lldp_rx(lldp_rx) == 0);
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_(sd_event_unrefp) sd_event *e = NULL;
 
@@ -370,6 +430,7 @@ int main(int argc, char *argv[]) {
         /* LLDP reception tests */
         assert_se(sd_event_new(&e) == 0);
         test_receive_basic_packet(e);
+        test_receive_refresh(e);
         test_receive_incomplete_packet(e);
         test_receive_oui_packet(e);
         test_multiple_neighbors_sorted(e);
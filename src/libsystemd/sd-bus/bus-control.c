@@ -15,6 +15,8 @@
 #include "bus-message.h"
 #include "capability-util.h"
 #include "fd-util.h"
+#include "hashmap.h"
+#include "pidref.h"
 #include "process-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
@@ -422,6 +424,264 @@ _public_ int sd_bus_list_names(sd_bus *bus, char ***acquired, char ***activatabl
         return 0;
 }
 
+/* Credentials reported by the bus driver for a unique name never change, since unique names are never
+ * reused. Hence cache what GetConnectionCredentials() told us, but only for peers that came with a pidfd
+ * with a unique inode number: on each use we open a new pidfd for the PID and compare its inode number, so
+ * that we notice if the peer is gone and never augment the credentials from /proc of a recycled PID. The
+ * pidfds themselves aren't kept, so that a busy service doesn't pin one fd per peer. */
+#define BUS_CREDS_CACHE_MAX 64U
+
+typedef struct BusCredsCacheEntry {
+        uint64_t mask;          /* Which of the fields below the bus driver reported */
+        pid_t pid;
+        uint64_t pidfd_id;
+        uid_t euid;
+        gid_t *supplementary_gids;
+        size_t n_supplementary_gids;
+        char *label;
+} BusCredsCacheEntry;
+
+static void bus_creds_cache_entry_done(BusCredsCacheEntry *e) {
+        assert(e);
+
+        e->supplementary_gids = mfree(e->supplementary_gids);
+        e->label = mfree(e->label);
+}
+
+static BusCredsCacheEntry* bus_creds_cache_entry_free(BusCredsCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        bus_creds_cache_entry_done(e);
+        return mfree(e);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(BusCredsCacheEntry*, bus_creds_cache_entry_free);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(bus_creds_cache_hash_ops,
+                             char, string_hash_func, string_compare_func, free,
+                             BusCredsCacheEntry, bus_creds_cache_entry_free);
+
+static int bus_creds_cache_put(sd_bus *bus, const char *unique, const BusCredsCacheEntry *e) {
+        _cleanup_(bus_creds_cache_entry_freep) BusCredsCacheEntry *copy = NULL;
+        _cleanup_free_ char *k = NULL;
+        int r;
+
+        assert(bus);
+        assert(unique);
+        assert(e);
+        assert(e->pidfd_id > 0);
+
+        /* Drop the oldest entries first */
+        while (ordered_hashmap_size(bus->creds_cache) >= BUS_CREDS_CACHE_MAX) {
+                _cleanup_free_ char *old = NULL;
+
+                bus_creds_cache_entry_free(ordered_hashmap_steal_first_key_and_value(bus->creds_cache, (void**) &old));
+        }
+
+        k = strdup(unique);
+        if (!k)
+                return -ENOMEM;
+
+        copy = new(BusCredsCacheEntry, 1);
+        if (!copy)
+                return -ENOMEM;
+
+        *copy = (BusCredsCacheEntry) {
+                .mask = e->mask,
+                .pid = e->pid,
+                .pidfd_id = e->pidfd_id,
+                .euid = e->euid,
+                .n_supplementary_gids = e->n_supplementary_gids,
+        };
+
+        if (e->n_supplementary_gids > 0) {
+                copy->supplementary_gids = newdup(gid_t, e->supplementary_gids, e->n_supplementary_gids);
+                if (!copy->supplementary_gids)
+                        return -ENOMEM;
+        }
+
+        r = strdup_to(&copy->label, e->label);
+        if (r < 0)
+                return r;
+
+        r = ordered_hashmap_ensure_put(&bus->creds_cache, &bus_creds_cache_hash_ops, k, copy);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(k);
+        TAKE_PTR(copy);
+        return 0;
+}
+
+static const BusCredsCacheEntry* bus_creds_cache_get(sd_bus *bus, const char *unique, PidRef *ret_pidref) {
+        _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
+        BusCredsCacheEntry *e;
+
+        assert(bus);
+        assert(unique);
+        assert(ret_pidref);
+
+        e = ordered_hashmap_get(bus->creds_cache, unique);
+        if (!e)
+                return NULL;
+
+        if (pidref_set_pid(&pidref, e->pid) < 0 ||
+            pidref_acquire_pidfd_id(&pidref) < 0 ||
+            pidref.fd_id != e->pidfd_id) {
+                _cleanup_free_ char *k = NULL;
+
+                /* The peer is gone, so will be its name soon */
+                bus_creds_cache_entry_free(ordered_hashmap_remove2(bus->creds_cache, unique, (void**) &k));
+                return NULL;
+        }
+
+        pidref_done(ret_pidref);
+        *ret_pidref = TAKE_PIDREF(pidref);
+        return e;
+}
+
+static int bus_parse_connection_credentials(sd_bus_message *reply, BusCredsCacheEntry *e, PidRef *pidref) {
+        int r;
+
+        assert(reply);
+        assert(e);
+        assert(pidref);
+
+        /* Parses a GetConnectionCredentials() reply. The PID respectively pidfd is stored in pidref, all
+         * the rest in e. */
+
+        r = sd_bus_message_enter_container(reply, 'a', "{sv}");
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                const char *m;
+
+                r = sd_bus_message_enter_container(reply, 'e', "sv");
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                r = sd_bus_message_read(reply, "s", &m);
+                if (r < 0)
+                        return r;
+
+                if (streq(m, "UnixUserID")) {
+                        uint32_t u;
+
+                        r = sd_bus_message_read(reply, "v", "u", &u);
+                        if (r < 0)
+                                return r;
+
+                        e->euid = u;
+                        e->mask |= SD_BUS_CREDS_EUID;
+
+                } else if (streq(m, "ProcessID")) {
+                        uint32_t p;
+
+                        r = sd_bus_message_read(reply, "v", "u", &p);
+                        if (r < 0)
+                                return r;
+
+                        if (!pidref_is_set(pidref))
+                                *pidref = PIDREF_MAKE_FROM_PID(p);
+
+                        e->pid = p;
+                        e->mask |= SD_BUS_CREDS_PID;
+
+                } else if (streq(m, "LinuxSecurityLabel")) {
+                        const void *p = NULL;
+                        size_t sz = 0;
+
+                        r = sd_bus_message_enter_container(reply, 'v', "ay");
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_read_array(reply, 'y', &p, &sz);
+                        if (r < 0)
+                                return r;
+
+                        r = free_and_strndup(&e->label, p, sz);
+                        if (r < 0)
+                                return r;
+
+                        e->mask |= SD_BUS_CREDS_SELINUX_CONTEXT;
+
+                        r = sd_bus_message_exit_container(reply);
+                        if (r < 0)
+                                return r;
+
+                } else if (streq(m, "ProcessFD")) {
+                        int fd;
+
+                        r = sd_bus_message_read(reply, "v", "h", &fd);
+                        if (r < 0)
+                                return r;
+
+                        pidref_done(pidref);
+                        r = pidref_set_pidfd(pidref, fd);
+                        if (r < 0)
+                                return r;
+
+                        e->mask |= SD_BUS_CREDS_PIDFD;
+
+                } else if (streq(m, "UnixGroupIDs")) {
+
+                        /* Note that D-Bus actually only gives us a combined list of primary gid and
+                         * supplementary gids. And we don't know which one the primary one is. We'll take the
+                         * whole shebang hence and use it as the supplementary group list, and not initialize
+                         * the primary gid field. This is slightly incorrect of course, but only slightly, as
+                         * in effect if the primary gid is also listed in the supplementary gid it has zero
+                         * effect. */
+
+                        r = sd_bus_message_enter_container(reply, 'v', "au");
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_enter_container(reply, 'a', "u");
+                        if (r < 0)
+                                return r;
+
+                        for (;;) {
+                                uint32_t u;
+
+                                r = sd_bus_message_read(reply, "u", &u);
+                                if (r < 0)
+                                        return r;
+                                if (r == 0)
+                                        break;
+
+                                if (!GREEDY_REALLOC(e->supplementary_gids, e->n_supplementary_gids+1))
+                                        return -ENOMEM;
+
+                                e->supplementary_gids[e->n_supplementary_gids++] = (gid_t) u;
+                        }
+
+                        r = sd_bus_message_exit_container(reply);
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_exit_container(reply);
+                        if (r < 0)
+                                return r;
+
+                        e->mask |= SD_BUS_CREDS_SUPPLEMENTARY_GIDS;
+                } else {
+                        r = sd_bus_message_skip(reply, "v");
+                        if (r < 0)
+                                return r;
+                }
+
+                r = sd_bus_message_exit_container(reply);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_message_exit_container(reply);
+}
+
 _public_ int sd_bus_get_name_creds(
                 sd_bus *bus,
                 const char *name,
@@ -518,175 +778,93 @@ _public_ int sd_bus_get_name_creds(
                 need_pidfd = (mask & SD_BUS_CREDS_PIDFD) || need_augment;
 
                 if (need_pid + need_uid + need_selinux + need_pidfd + need_gids > 1) {
+                        _cleanup_(bus_creds_cache_entry_done) BusCredsCacheEntry fresh = {};
+                        const BusCredsCacheEntry *e = NULL;
 
                         /* If we need more than one of the credentials, then use GetConnectionCredentials() */
 
-                        r = sd_bus_call_method(
-                                        bus,
-                                        "org.freedesktop.DBus",
-                                        "/org/freedesktop/DBus",
-                                        "org.freedesktop.DBus",
-                                        "GetConnectionCredentials",
-                                        &error,
-                                        &reply,
-                                        "s",
-                                        unique ?: name);
-
-                        if (r < 0) {
-
-                                if (!sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD))
-                                        return r;
-
-                                /* If we got an unknown method error, fall back to the individual calls... */
-                                need_separate_calls = true;
-                                sd_bus_error_free(&error);
-
-                        } else {
-                                need_separate_calls = false;
+                        if (unique)
+                                e = bus_creds_cache_get(bus, unique, &pidref);
 
-                                r = sd_bus_message_enter_container(reply, 'a', "{sv}");
-                                if (r < 0)
-                                        return r;
-
-                                for (;;) {
-                                        const char *m;
-
-                                        r = sd_bus_message_enter_container(reply, 'e', "sv");
-                                        if (r < 0)
+                        if (!e) {
+                                r = sd_bus_call_method(
+                                                bus,
+                                                "org.freedesktop.DBus",
+                                                "/org/freedesktop/DBus",
+                                                "org.freedesktop.DBus",
+                                                "GetConnectionCredentials",
+                                                &error,
+                                                &reply,
+                                                "s",
+                                                unique ?: name);
+                                if (r < 0) {
+                                        if (!sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD))
                                                 return r;
-                                        if (r == 0)
-                                                break;
 
-                                        r = sd_bus_message_read(reply, "s", &m);
+                                        /* If we got an unknown method error, fall back to the individual calls... */
+                                        sd_bus_error_free(&error);
+                                } else {
+                                        r = bus_parse_connection_credentials(reply, &fresh, &pidref);
                                         if (r < 0)
                                                 return r;
 
-                                        if (need_uid && streq(m, "UnixUserID")) {
-                                                uint32_t u;
-
-                                                r = sd_bus_message_read(reply, "v", "u", &u);
-                                                if (r < 0)
-                                                        return r;
-
-                                                c->euid = u;
-                                                c->mask |= SD_BUS_CREDS_EUID;
-
-                                        } else if (need_pid && streq(m, "ProcessID")) {
-                                                uint32_t p;
-
-                                                r = sd_bus_message_read(reply, "v", "u", &p);
-                                                if (r < 0)
-                                                        return r;
-
-                                                if (!pidref_is_set(&pidref))
-                                                        pidref = PIDREF_MAKE_FROM_PID(p);
+                                        if (unique && FLAGS_SET(fresh.mask, SD_BUS_CREDS_PID|SD_BUS_CREDS_PIDFD) &&
+                                            pidref_acquire_pidfd_id(&pidref) >= 0) {
+                                                fresh.pidfd_id = pidref.fd_id;
 
-                                                if (mask & SD_BUS_CREDS_PID) {
-                                                        c->pid = p;
-                                                        c->mask |= SD_BUS_CREDS_PID;
-                                                }
-
-                                        } else if (need_selinux && streq(m, "LinuxSecurityLabel")) {
-                                                const void *p = NULL;
-                                                size_t sz = 0;
-
-                                                r = sd_bus_message_enter_container(reply, 'v', "ay");
-                                                if (r < 0)
-                                                        return r;
-
-                                                r = sd_bus_message_read_array(reply, 'y', &p, &sz);
-                                                if (r < 0)
-                                                        return r;
-
-                                                r = free_and_strndup(&c->label, p, sz);
-                                                if (r < 0)
-                                                        return r;
-
-                                                c->mask |= SD_BUS_CREDS_SELINUX_CONTEXT;
-
-                                                r = sd_bus_message_exit_container(reply);
-                                                if (r < 0)
-                                                        return r;
-                                        } else if (need_pidfd && streq(m, "ProcessFD")) {
-                                                int fd;
-
-                                                r = sd_bus_message_read(reply, "v", "h", &fd);
-                                                if (r < 0)
-                                                        return r;
-
-                                                pidref_done(&pidref);
-                                                r = pidref_set_pidfd(&pidref, fd);
-                                                if (r < 0)
-                                                        return r;
-
-                                                if (mask & SD_BUS_CREDS_PIDFD) {
-                                                        fd = fcntl(fd, F_DUPFD_CLOEXEC, 3);
-                                                        if (fd < 0)
-                                                                return -errno;
-
-                                                        close_and_replace(c->pidfd, fd);
-                                                        c->mask |= SD_BUS_CREDS_PIDFD;
-                                                }
-                                        } else if (need_gids && streq(m, "UnixGroupIDs")) {
-
-                                                /* Note that D-Bus actually only gives us a combined list of
-                                                 * primary gid and supplementary gids. And we don't know
-                                                 * which one the primary one is. We'll take the whole shebang
-                                                 * hence and use it as the supplementary group list, and not
-                                                 * initialize the primary gid field. This is slightly
-                                                 * incorrect of course, but only slightly, as in effect if
-                                                 * the primary gid is also listed in the supplementary gid
-                                                 * it has zero effect. */
-
-                                                r = sd_bus_message_enter_container(reply, 'v', "au");
-                                                if (r < 0)
-                                                        return r;
-
-                                                r = sd_bus_message_enter_container(reply, 'a', "u");
+                                                r = bus_creds_cache_put(bus, unique, &fresh);
                                                 if (r < 0)
                                                         return r;
+                                        }
 
-                                                for (;;) {
-                                                        uint32_t u;
+                                        e = &fresh;
+                                }
+                        }
 
-                                                        r = sd_bus_message_read(reply, "u", &u);
-                                                        if (r < 0)
-                                                                return r;
-                                                        if (r == 0)
-                                                                break;
+                        need_separate_calls = !e;
+                        if (e) {
+                                if (need_pid && !pidref_is_set(&pidref))
+                                        return -EPROTO;
 
-                                                        if (!GREEDY_REALLOC(c->supplementary_gids, c->n_supplementary_gids+1))
-                                                                return -ENOMEM;
+                                if ((mask & SD_BUS_CREDS_PID) && FLAGS_SET(e->mask, SD_BUS_CREDS_PID)) {
+                                        c->pid = e->pid;
+                                        c->mask |= SD_BUS_CREDS_PID;
+                                }
 
-                                                        c->supplementary_gids[c->n_supplementary_gids++] = (gid_t) u;
-                                                }
+                                if (need_uid && FLAGS_SET(e->mask, SD_BUS_CREDS_EUID)) {
+                                        c->euid = e->euid;
+                                        c->mask |= SD_BUS_CREDS_EUID;
+                                }
 
-                                                r = sd_bus_message_exit_container(reply);
-                                                if (r < 0)
-                                                        return r;
+                                if (need_selinux && FLAGS_SET(e->mask, SD_BUS_CREDS_SELINUX_CONTEXT)) {
+                                        r = strdup_to(&c->label, e->label);
+                                        if (r < 0)
+                                                return r;
 
-                                                r = sd_bus_message_exit_container(reply);
-                                                if (r < 0)
-                                                        return r;
+                                        c->mask |= SD_BUS_CREDS_SELINUX_CONTEXT;
+                                }
 
-                                                c->mask |= SD_BUS_CREDS_SUPPLEMENTARY_GIDS;
-                                        } else {
-                                                r = sd_bus_message_skip(reply, "v");
-                                                if (r < 0)
-                                                        return r;
+                                if (need_gids && FLAGS_SET(e->mask, SD_BUS_CREDS_SUPPLEMENTARY_GIDS)) {
+                                        if (e->n_supplementary_gids > 0) {
+                                                c->supplementary_gids = newdup(gid_t, e->supplementary_gids, e->n_supplementary_gids);
+                                                if (!c->supplementary_gids)
+                                                        return -ENOMEM;
                                         }
 
-                                        r = sd_bus_message_exit_container(reply);
-                                        if (r < 0)
-                                                return r;
+                                        c->n_supplementary_gids = e->n_supplementary_gids;
+                                        c->mask |= SD_BUS_CREDS_SUPPLEMENTARY_GIDS;
                                 }
 
-                                r = sd_bus_message_exit_container(reply);
-                                if (r < 0)
-                                        return r;
+                                if ((mask & SD_BUS_CREDS_PIDFD) && pidref.fd >= 0) {
+                                        int fd;
 
-                                if (need_pid && !pidref_is_set(&pidref))
-                                        return -EPROTO;
+                                        fd = fcntl(pidref.fd, F_DUPFD_CLOEXEC, 3);
+                                        if (fd < 0)
+                                                return -errno;
+
+                                        close_and_replace(c->pidfd, fd);
+                                        c->mask |= SD_BUS_CREDS_PIDFD;
+                                }
                         }
 
                 } else /* When we only need a single field, then let's use separate calls */
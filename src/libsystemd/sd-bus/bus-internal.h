@@ -103,6 +103,14 @@ struct node_vtable {
         const sd_bus_vtable *vtable;
         sd_bus_object_find_t find;
 
+        /* The properties included in generic property dumps (GetAll(), InterfacesAdded, …), in vtable
+         * order, resolved once when the vtable is registered. */
+        const sd_bus_vtable **all_properties;
+        size_t n_all_properties;
+
+        /* The introspection XML of the vtable's members, generated on first use */
+        char *introspection;
+
         LIST_FIELDS(struct node_vtable, vtables);
 };
 
@@ -227,6 +235,7 @@ struct sd_bus {
         sd_bus_message **wqueue;
         size_t wqueue_size;
         size_t windex;
+        usec_t wqueue_progress_usec; /* When the write queue last became non-empty or made progress */
 
         uint64_t cookie;
         uint64_t read_counter; /* A counter for each incoming msg */
@@ -243,6 +252,9 @@ struct sd_bus {
         Hashmap *vtable_methods;
         Hashmap *vtable_properties;
 
+        /* Unique name → BusCredsCacheEntry, in the order the entries were added */
+        OrderedHashmap *creds_cache;
+
         union sockaddr_union sockaddr;
         socklen_t sockaddr_size;
 
@@ -385,6 +397,8 @@ int bus_rqueue_make_room(sd_bus *bus);
 
 bool bus_origin_changed(sd_bus *bus);
 
+usec_t bus_get_write_stalled_since(sd_bus *bus);
+
 char* bus_address_escape(const char *v);
 
 int bus_attach_io_events(sd_bus *b);
@@ -201,22 +201,12 @@ static int introspect_write_arguments(struct introspect *i, const char *signatur
         }
 }
 
-int introspect_write_interface(
-                struct introspect *i,
-                const char *interface_name,
-                const sd_bus_vtable *v) {
-
+static void introspect_write_vtable(struct introspect *i, const sd_bus_vtable *v) {
         const sd_bus_vtable *vtable = ASSERT_PTR(v);
         const char *names = "";
-        int r;
 
         assert(i);
         assert(i->m.f);
-        assert(interface_name);
-
-        r = set_interface_name(i, interface_name);
-        if (r < 0)
-                return r;
 
         for (; v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(vtable, v)) {
 
@@ -265,7 +255,67 @@ int introspect_write_interface(
                 }
 
         }
+}
+
+int introspect_write_interface(
+                struct introspect *i,
+                const char *interface_name,
+                const sd_bus_vtable *v) {
+
+        int r;
+
+        assert(i);
+        assert(i->m.f);
+        assert(interface_name);
+        assert(v);
+
+        r = set_interface_name(i, interface_name);
+        if (r < 0)
+                return r;
+
+        introspect_write_vtable(i, v);
+        return 0;
+}
+
+int introspect_write_interface_cached(
+                struct introspect *i,
+                const char *interface_name,
+                const sd_bus_vtable *v,
+                char **cache) {
+
+        int r;
+
+        assert(i);
+        assert(i->m.f);
+        assert(interface_name);
+        assert(v);
+        assert(cache);
+
+        /* Like introspect_write_interface(), but the XML for the vtable's members is generated only once
+         * and kept in *cache. This is fine since vtables cannot change once registered, and the output
+         * only depends on the vtable and the trusted flag, which the caller has to keep identical for all
+         * uses of the same cache. */
+
+        r = set_interface_name(i, interface_name);
+        if (r < 0)
+                return r;
+
+        if (!*cache) {
+                _cleanup_(introspect_done) struct introspect c = {
+                        .trusted = i->trusted,
+                };
+
+                if (!memstream_init(&c.m))
+                        return -ENOMEM;
+
+                introspect_write_vtable(&c, v);
+
+                r = memstream_finalize(&c.m, cache, NULL);
+                if (r < 0)
+                        return r;
+        }
 
+        fputs(*cache, i->m.f);
         return 0;
 }
 
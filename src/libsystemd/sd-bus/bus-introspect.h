@@ -21,5 +21,10 @@ int introspect_write_interface(
                 struct introspect *i,
                 const char *interface_name,
                 const sd_bus_vtable *v);
+int introspect_write_interface_cached(
+                struct introspect *i,
+                const char *interface_name,
+                const sd_bus_vtable *v,
+                char **cache);
 int introspect_finish(struct introspect *i, char **ret);
 void introspect_done(struct introspect *i);
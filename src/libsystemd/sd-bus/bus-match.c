@@ -53,11 +53,22 @@ static bool BUS_MATCH_IS_COMPARE(enum bus_match_node_type t) {
 }
 
 static bool BUS_MATCH_CAN_HASH(enum bus_match_node_type t) {
-        return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH) ||
+        return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH_NAMESPACE) ||
                 (t >= BUS_MATCH_ARG && t <= BUS_MATCH_ARG_LAST) ||
+                (t >= BUS_MATCH_ARG_NAMESPACE && t <= BUS_MATCH_ARG_NAMESPACE_LAST) ||
                 (t >= BUS_MATCH_ARG_HAS && t <= BUS_MATCH_ARG_HAS_LAST);
 }
 
+static char BUS_MATCH_PREFIX_SEPARATOR(enum bus_match_node_type t) {
+        /* Returns the label separator for compare nodes that match on prefixes, or 0 if the node type
+         * matches on equality */
+        if (t == BUS_MATCH_PATH_NAMESPACE)
+                return '/';
+        if (t >= BUS_MATCH_ARG_NAMESPACE && t <= BUS_MATCH_ARG_NAMESPACE_LAST)
+                return '.';
+        return 0;
+}
+
 static void bus_match_node_free(struct bus_match_node *node) {
         assert(node);
         assert(node->parent);
@@ -235,6 +246,72 @@ static bool value_node_same(
         }
 }
 
+static int bus_match_run_prefixes(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                const char *value,
+                sd_bus_message *m) {
+
+        _cleanup_free_ char *copy = NULL;
+        size_t l, last = SIZE_MAX;
+        char separator;
+        int r;
+
+        assert(node);
+        assert(value);
+        assert(m);
+
+        separator = BUS_MATCH_PREFIX_SEPARATOR(node->type);
+        assert(separator != 0);
+
+        /* A path or namespace pattern matches if it is equal to the value, or a prefix of it that ends
+         * right before or right after a separator, see simple_pattern_check(). Instead of testing each
+         * pattern against the value, look up all prefixes of the value that qualify in the hash table.
+         * That's linear in the length of the value, and independent of the number of patterns. */
+
+        copy = strdup(value);
+        if (!copy)
+                return -ENOMEM;
+
+        l = strlen(copy);
+        for (size_t i = 0; i <= l; i++) {
+                size_t candidates[2];
+                size_t n = 0;
+
+                if (i == l)
+                        candidates[n++] = l;
+                else if (value[i] == separator) {
+                        candidates[n++] = i;
+                        candidates[n++] = i + 1;
+                }
+
+                FOREACH_ARRAY(c, candidates, n) {
+                        struct bus_match_node *found;
+
+                        /* Don't look up the same prefix twice on consecutive separators */
+                        if (*c == last)
+                                continue;
+                        last = *c;
+
+                        copy[*c] = 0;
+                        found = hashmap_get(node->compare.children, copy);
+                        copy[*c] = value[*c];
+
+                        if (!found)
+                                continue;
+
+                        r = bus_match_run(bus, found, m);
+                        if (r != 0)
+                                return r;
+
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
+        }
+
+        return 0;
+}
+
 int bus_match_run(
                 sd_bus *bus,
                 struct bus_match_node *node,
@@ -380,7 +457,13 @@ int bus_match_run(
 
                 /* Lookup via hash table, nice! So let's jump directly. */
 
-                if (test_str)
+                if (test_str && BUS_MATCH_PREFIX_SEPARATOR(node->type) != 0) {
+                        r = bus_match_run_prefixes(bus, node, test_str, m);
+                        if (r != 0)
+                                return r;
+
+                        found = NULL;
+                } else if (test_str)
                         found = hashmap_get(node->compare.children, test_str);
                 else if (test_strv) {
                         STRV_FOREACH(i, test_strv) {
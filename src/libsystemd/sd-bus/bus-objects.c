@@ -744,6 +744,24 @@ static int vtable_append_one_property(
         return 0;
 }
 
+static bool vtable_is_dumped_property(const sd_bus_vtable *vtable, const sd_bus_vtable *v) {
+        assert(vtable);
+        assert(v);
+
+        if (vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
+                return false;
+
+        if (v->flags & SD_BUS_VTABLE_HIDDEN)
+                return false;
+
+        /* Let's not include properties marked as "explicit" in any message that contains a generic dump of
+         * properties, but only in those generated as a response to an explicit request. */
+        if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
+                return false;
+
+        return true;
+}
+
 static int vtable_append_all_properties(
                 sd_bus *bus,
                 sd_bus_message *reply,
@@ -752,7 +770,6 @@ static int vtable_append_all_properties(
                 void *userdata,
                 sd_bus_error *error) {
 
-        const sd_bus_vtable *v;
         int r;
 
         assert(bus);
@@ -760,21 +777,10 @@ static int vtable_append_all_properties(
         assert(path);
         assert(c);
 
-        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
-                return 1;
-
-        v = c->vtable;
-        for (v = bus_vtable_next(c->vtable, v); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
-                if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
-                        continue;
-
-                if (v->flags & SD_BUS_VTABLE_HIDDEN)
-                        continue;
-
-                /* Let's not include properties marked as "explicit" in any message that contains a generic
-                 * dump of properties, but only in those generated as a response to an explicit request. */
-                if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
-                        continue;
+        /* Hidden and "explicit" properties have already been filtered out when the vtable was added, see
+         * vtable_is_dumped_property(). */
+        FOREACH_ARRAY(i, c->all_properties, c->n_all_properties) {
+                const sd_bus_vtable *v = *i;
 
                 /* Let's not include properties marked only for invalidation on change (i.e. in contrast to
                  * those whose new values are included in PropertiesChanges message) in any signals. This is
@@ -829,6 +835,11 @@ static int property_get_all_callbacks_run(
                 if (require_fallback && !c->is_fallback)
                         continue;
 
+                /* Once we know the object exists, there's no point in resolving the userdata of interfaces
+                 * that weren't asked for. */
+                if (iface && *found_object && !streq(c->interface, iface))
+                        continue;
+
                 r = node_vtable_get_userdata(bus, m->path, c, &u, &error);
                 if (r < 0)
                         return bus_maybe_reply_error(m, r, &error);
@@ -970,7 +981,7 @@ int introspect_path(
                 if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
                         continue;
 
-                r = introspect_write_interface(&intro, c->interface, c->vtable);
+                r = introspect_write_interface_cached(&intro, c->interface, c->vtable, &c->introspection);
                 if (r < 0)
                         return r;
         }
@@ -1946,6 +1957,15 @@ static int add_object_vtable_internal(
                                 goto fail;
                         }
 
+                        if (vtable_is_dumped_property(vtable, v)) {
+                                if (!GREEDY_REALLOC(s->node_vtable.all_properties, s->node_vtable.n_all_properties + 1)) {
+                                        r = -ENOMEM;
+                                        goto fail;
+                                }
+
+                                s->node_vtable.all_properties[s->node_vtable.n_all_properties++] = v;
+                        }
+
                         break;
                 }
 
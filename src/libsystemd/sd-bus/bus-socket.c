@@ -27,11 +27,15 @@
 #include "signal-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "utf8.h"
 
 #define SNDBUF_SIZE (8*1024*1024)
 
+/* How much to read at once from connections that do not pass fds */
+#define BUS_READ_AHEAD_SIZE (64U*1024U)
+
 static void iovec_advance(struct iovec iov[], unsigned *idx, size_t size) {
 
         while (size > 0) {
@@ -1214,10 +1218,49 @@ int bus_socket_take_fd(sd_bus *b) {
         return bus_socket_start_auth(b);
 }
 
+static ssize_t bus_socket_send_iovec(sd_bus *bus, struct iovec *iov, size_t n_iov, const int *fds, size_t n_fds) {
+        ssize_t k;
+
+        assert(bus);
+        assert(iov || n_iov == 0);
+        assert(fds || n_fds == 0);
+
+        if (bus->prefer_writev)
+                k = writev(bus->output_fd, iov, n_iov);
+        else {
+                struct msghdr mh = {
+                        .msg_iov = iov,
+                        .msg_iovlen = n_iov,
+                };
+
+                if (n_fds > 0) {
+                        struct cmsghdr *control;
+
+                        mh.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+                        mh.msg_control = alloca0(mh.msg_controllen);
+                        control = CMSG_FIRSTHDR(&mh);
+                        control->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+                        control->cmsg_level = SOL_SOCKET;
+                        control->cmsg_type = SCM_RIGHTS;
+                        memcpy(CMSG_DATA(control), fds, sizeof(int) * n_fds);
+                }
+
+                k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
+                if (k < 0 && errno == ENOTSOCK) {
+                        bus->prefer_writev = true;
+                        k = writev(bus->output_fd, iov, n_iov);
+                }
+        }
+
+        if (k < 0)
+                return ERRNO_IS_TRANSIENT(errno) ? 0 : -errno;
+
+        return k;
+}
+
 int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         struct iovec *iov;
         ssize_t k;
-        size_t n;
         unsigned j;
         int r;
 
@@ -1233,57 +1276,92 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         if (r < 0)
                 return r;
 
-        n = m->n_iovec * sizeof(struct iovec);
-        iov = newa(struct iovec, n);
-        memcpy_safe(iov, m->iovec, n);
+        iov = newa(struct iovec, m->n_iovec);
+        memcpy_safe(iov, m->iovec, m->n_iovec * sizeof(struct iovec));
 
         j = 0;
         iovec_advance(iov, &j, *idx);
 
-        if (bus->prefer_writev)
-                k = writev(bus->output_fd, iov, m->n_iovec);
-        else {
-                struct msghdr mh = {
-                        .msg_iov = iov,
-                        .msg_iovlen = m->n_iovec,
-                };
+        k = bus_socket_send_iovec(bus, iov, m->n_iovec, m->fds, *idx == 0 ? m->n_fds : 0);
+        if (k <= 0)
+                return (int) k;
 
-                if (m->n_fds > 0 && *idx == 0) {
-                        struct cmsghdr *control;
+        *idx += (size_t) k;
+        return 1;
+}
 
-                        mh.msg_controllen = CMSG_SPACE(sizeof(int) * m->n_fds);
-                        mh.msg_control = alloca0(mh.msg_controllen);
-                        control = CMSG_FIRSTHDR(&mh);
-                        control->cmsg_len = CMSG_LEN(sizeof(int) * m->n_fds);
-                        control->cmsg_level = SOL_SOCKET;
-                        control->cmsg_type = SCM_RIGHTS;
-                        memcpy(CMSG_DATA(control), m->fds, sizeof(int) * m->n_fds);
-                }
+int bus_socket_write_messages(sd_bus *bus, sd_bus_message **messages, size_t n_messages, size_t idx, size_t *ret_written) {
+        struct iovec *iov;
+        size_t n = 0, n_iov = 0;
+        ssize_t k;
+        unsigned j;
+        int r;
 
-                k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
-                if (k < 0 && errno == ENOTSOCK) {
-                        bus->prefer_writev = true;
-                        k = writev(bus->output_fd, iov, m->n_iovec);
+        assert(bus);
+        assert(messages);
+        assert(n_messages > 0);
+        assert(ret_written);
+        assert(idx < BUS_MESSAGE_SIZE(messages[0]));
+        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
+
+        /* Writes the given messages, starting at offset 'idx' into the first one, with as few syscalls as
+         * possible, by submitting the iovecs of as many messages as fit into a single sendmsg(). File
+         * descriptors are attached to the data of the sendmsg() they are passed with, hence a message
+         * carrying fds is always sent on its own. On success, returns the number of bytes written, which
+         * may end anywhere in any of the messages. */
+
+        for (; n < n_messages; n++) {
+                sd_bus_message *m = messages[n];
+                bool with_fds = m->n_fds > 0 && (n > 0 || idx == 0);
+
+                if (n > 0 && with_fds)
+                        break;
+
+                r = bus_message_setup_iovec(m);
+                if (r < 0)
+                        return r;
+
+                if (n > 0 && n_iov + m->n_iovec > IOV_MAX)
+                        break;
+
+                n_iov += m->n_iovec;
+
+                if (with_fds) {
+                        n++;
+                        break;
                 }
         }
 
-        if (k < 0)
-                return ERRNO_IS_TRANSIENT(errno) ? 0 : -errno;
+        iov = newa(struct iovec, n_iov);
+        n_iov = 0;
+        for (size_t i = 0; i < n; i++) {
+                memcpy_safe(iov + n_iov, messages[i]->iovec, messages[i]->n_iovec * sizeof(struct iovec));
+                n_iov += messages[i]->n_iovec;
+        }
 
-        *idx += (size_t) k;
+        j = 0;
+        iovec_advance(iov, &j, idx);
+
+        k = bus_socket_send_iovec(bus, iov + j, n_iov - j, messages[0]->fds, idx == 0 ? messages[0]->n_fds : 0);
+        if (k <= 0)
+                return (int) k;
+
+        *ret_written = (size_t) k;
         return 1;
 }
 
-static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
+static int bus_socket_read_message_need(sd_bus *bus, size_t offset, size_t *need) {
+        const uint8_t *p;
         uint32_t a, b;
         uint8_t e;
         uint64_t sum;
 
         assert(bus);
+        assert(offset <= bus->rbuffer_size);
         assert(need);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        if (bus->rbuffer_size < sizeof(struct bus_header)) {
+        if (bus->rbuffer_size - offset < sizeof(struct bus_header)) {
                 *need = sizeof(struct bus_header) + 8;
 
                 /* Minimum message size:
@@ -1305,10 +1383,12 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
                 return 0;
         }
 
-        a = ((const uint32_t*) bus->rbuffer)[1];
-        b = ((const uint32_t*) bus->rbuffer)[3];
+        /* The message might start at an unaligned offset, hence don't access the header fields directly */
+        p = (const uint8_t*) bus->rbuffer + offset;
+        a = unaligned_read_ne32(p + 4);
+        b = unaligned_read_ne32(p + 12);
 
-        e = ((const uint8_t*) bus->rbuffer)[0];
+        e = p[0];
         if (e == BUS_LITTLE_ENDIAN) {
                 a = le32toh(a);
                 b = le32toh(b);
@@ -1376,11 +1456,91 @@ static int bus_socket_make_message(sd_bus *bus, size_t size) {
         return 1;
 }
 
+static int bus_socket_make_messages(sd_bus *bus) {
+        size_t offset = 0, need;
+        int r = 0, ret = 0;
+
+        assert(bus);
+        assert(!bus->can_fds);
+        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
+
+        /* Used if we read ahead, i.e. the read buffer might contain any number of complete messages. They
+         * are copied out of the buffer one by one, and whatever remains of the next, incomplete message is
+         * moved to the front of the buffer once at the end. No fds can be passed on such connections,
+         * hence we don't have to figure out which message they belong to. */
+
+        for (;;) {
+                sd_bus_message *t = NULL;
+                void *b;
+
+                r = bus_socket_read_message_need(bus, offset, &need);
+                if (r < 0)
+                        break;
+
+                if (bus->rbuffer_size - offset < need)
+                        break;
+
+                if (offset == 0 && need == bus->rbuffer_size && need >= BUS_READ_AHEAD_SIZE) {
+                        /* A large message filling the buffer exactly, hand over the buffer itself */
+                        r = bus_socket_make_message(bus, need);
+                        return r < 0 ? r : 1;
+                }
+
+                r = bus_rqueue_make_room(bus);
+                if (r < 0)
+                        break;
+
+                b = memdup((const uint8_t*) bus->rbuffer + offset, need);
+                if (!b) {
+                        r = -ENOMEM;
+                        break;
+                }
+
+                offset += need;
+                ret = 1;
+
+                r = bus_message_from_malloc(bus, b, need, NULL, 0, NULL, &t);
+                if (r == -EBADMSG) {
+                        log_debug_errno(r, "Received invalid message from connection %s, dropping.", strna(bus->description));
+                        free(b);
+                        continue;
+                }
+                if (r < 0) {
+                        free(b);
+                        break;
+                }
+
+                t->read_counter = ++bus->read_counter;
+                bus->rqueue[bus->rqueue_size++] = bus_message_ref_queued(t, bus);
+                sd_bus_message_unref(t);
+        }
+
+        if (offset > 0) {
+                bus->rbuffer_size -= offset;
+                memmove(bus->rbuffer, (uint8_t*) bus->rbuffer + offset, bus->rbuffer_size);
+        }
+
+        if (r < 0)
+                return r;
+
+        return ret;
+}
+
+static void bus_socket_trim_read_buffer(sd_bus *bus) {
+        assert(bus);
+
+        /* The read-ahead buffer is only needed while reading. Release it once everything in it has been
+         * turned into messages, so that idle connections don't keep it around. */
+
+        if (!bus->can_fds && bus->rbuffer_size == 0)
+                bus->rbuffer = mfree(bus->rbuffer);
+}
+
 int bus_socket_read_message(sd_bus *bus) {
         struct msghdr mh;
         struct iovec iov = {};
         ssize_t k;
-        size_t need;
+        size_t need, size;
         int r;
         void *b;
         CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(int) * BUS_FDS_MAX)) control;
@@ -1389,20 +1549,32 @@ int bus_socket_read_message(sd_bus *bus) {
         assert(bus);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        r = bus_socket_read_message_need(bus, &need);
+        r = bus_socket_read_message_need(bus, 0, &need);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
+        if (bus->rbuffer_size >= need) {
+                if (bus->can_fds)
+                        return bus_socket_make_message(bus, need);
 
-        b = realloc(bus->rbuffer, need);
+                r = bus_socket_make_messages(bus);
+                bus_socket_trim_read_buffer(bus);
+                return r;
+        }
+
+        /* If fds may be passed, we must read exactly one message at a time, since fds are attached to the
+         * data of the sendmsg() they were sent with, and we'd otherwise be unable to tell which message
+         * they belong to. Without fds we read ahead, and slice off as many messages as we got in one go,
+         * which saves lots of syscalls on busy connections with many small messages. */
+        size = bus->can_fds ? need : MAX(need, BUS_READ_AHEAD_SIZE);
+
+        b = realloc(bus->rbuffer, size);
         if (!b)
                 return -ENOMEM;
 
         bus->rbuffer = b;
 
-        iov = IOVEC_MAKE((uint8_t *)bus->rbuffer + bus->rbuffer_size, need - bus->rbuffer_size);
+        iov = IOVEC_MAKE((uint8_t *)bus->rbuffer + bus->rbuffer_size, size - bus->rbuffer_size);
 
         if (bus->prefer_readv) {
                 k = readv(bus->input_fd, &iov, 1);
@@ -1425,8 +1597,10 @@ int bus_socket_read_message(sd_bus *bus) {
                 } else
                         handle_cmsg = true;
         }
-        if (ERRNO_IS_NEG_TRANSIENT(k))
+        if (ERRNO_IS_NEG_TRANSIENT(k)) {
+                bus_socket_trim_read_buffer(bus);
                 return 0;
+        }
         if (k < 0)
                 return (int) k;
         if (k == 0) {
@@ -1443,7 +1617,13 @@ int bus_socket_read_message(sd_bus *bus) {
                         return r;
         }
 
-        r = bus_socket_read_message_need(bus, &need);
+        if (!bus->can_fds) {
+                r = bus_socket_make_messages(bus);
+                bus_socket_trim_read_buffer(bus);
+                return r < 0 ? r : 1;
+        }
+
+        r = bus_socket_read_message_need(bus, 0, &need);
         if (r < 0)
                 return r;
 
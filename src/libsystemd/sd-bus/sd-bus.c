@@ -229,6 +229,8 @@ static sd_bus* bus_free(sd_bus *b) {
         hashmap_free_free(b->vtable_methods);
         hashmap_free_free(b->vtable_properties);
 
+        ordered_hashmap_free(b->creds_cache);
+
         assert(hashmap_isempty(b->nodes));
         hashmap_free(b->nodes);
 
@@ -2042,6 +2044,25 @@ int bus_seal_synthetic_message(sd_bus *b, sd_bus_message *m) {
         return sd_bus_message_seal(m, UINT32_MAX, 0);
 }
 
+static void bus_log_sent_message(sd_bus_message *m) {
+        assert(m);
+
+        log_debug("Sent message type=%s sender=%s destination=%s path=%s interface=%s member=%s"
+                  " cookie=%" PRIu64 " reply_cookie=%" PRIu64
+                  " signature=%s error-name=%s error-message=%s",
+                  bus_message_type_to_string(m->header->type),
+                  strna(sd_bus_message_get_sender(m)),
+                  strna(sd_bus_message_get_destination(m)),
+                  strna(sd_bus_message_get_path(m)),
+                  strna(sd_bus_message_get_interface(m)),
+                  strna(sd_bus_message_get_member(m)),
+                  BUS_MESSAGE_COOKIE(m),
+                  m->reply_cookie,
+                  strna(m->root_container.signature),
+                  strna(m->error.name),
+                  strna(m->error.message));
+}
+
 static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         int r;
 
@@ -2053,20 +2074,7 @@ static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
                 return r;
 
         if (*idx >= BUS_MESSAGE_SIZE(m))
-                log_debug("Sent message type=%s sender=%s destination=%s path=%s interface=%s member=%s"
-                          " cookie=%" PRIu64 " reply_cookie=%" PRIu64
-                          " signature=%s error-name=%s error-message=%s",
-                          bus_message_type_to_string(m->header->type),
-                          strna(sd_bus_message_get_sender(m)),
-                          strna(sd_bus_message_get_destination(m)),
-                          strna(sd_bus_message_get_path(m)),
-                          strna(sd_bus_message_get_interface(m)),
-                          strna(sd_bus_message_get_member(m)),
-                          BUS_MESSAGE_COOKIE(m),
-                          m->reply_cookie,
-                          strna(m->root_container.signature),
-                          strna(m->error.name),
-                          strna(m->error.message));
+                bus_log_sent_message(m);
 
         return r;
 }
@@ -2078,29 +2086,34 @@ static int dispatch_wqueue(sd_bus *bus) {
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
         while (bus->wqueue_size > 0) {
+                size_t written, n = 0;
 
-                r = bus_write_message(bus, bus->wqueue[0], &bus->windex);
+                /* Write as many queued messages as we can with a single syscall. During boot PID 1 queues
+                 * up lots of small signals, and writing them one by one is needlessly expensive. */
+                r = bus_socket_write_messages(bus, bus->wqueue, bus->wqueue_size, bus->windex, &written);
                 if (r < 0)
                         return r;
-                else if (r == 0)
+                if (r == 0)
                         /* Didn't do anything this time */
                         return ret;
-                else if (bus->windex >= BUS_MESSAGE_SIZE(bus->wqueue[0])) {
-                        /* Fully written. Let's drop the entry from
-                         * the queue.
-                         *
-                         * This isn't particularly optimized, but
-                         * well, this is supposed to be our worst-case
-                         * buffer only, and the socket buffer is
-                         * supposed to be our primary buffer, and if
-                         * it got full, then all bets are off
-                         * anyway. */
-
-                        bus->wqueue_size--;
-                        bus_message_unref_queued(bus->wqueue[0], bus);
-                        memmove(bus->wqueue, bus->wqueue + 1, sizeof(sd_bus_message*) * bus->wqueue_size);
-                        bus->windex = 0;
 
+                bus->wqueue_progress_usec = now(CLOCK_MONOTONIC);
+
+                /* Drop all fully written entries from the queue, and remember how far we got into the
+                 * first one that is left. */
+                written += bus->windex;
+                while (n < bus->wqueue_size && written >= BUS_MESSAGE_SIZE(bus->wqueue[n])) {
+                        written -= BUS_MESSAGE_SIZE(bus->wqueue[n]);
+                        bus_log_sent_message(bus->wqueue[n]);
+                        bus_message_unref_queued(bus->wqueue[n], bus);
+                        n++;
+                }
+
+                bus->windex = written;
+
+                if (n > 0) {
+                        bus->wqueue_size -= n;
+                        memmove(bus->wqueue, bus->wqueue + n, sizeof(sd_bus_message*) * bus->wqueue_size);
                         ret = 1;
                 }
         }
@@ -2225,6 +2238,7 @@ _public_ int sd_bus_send(sd_bus *bus, sd_bus_message *_m, uint64_t *cookie) {
                         bus->wqueue[0] = bus_message_ref_queued(m, bus);
                         bus->wqueue_size = 1;
                         bus->windex = idx;
+                        bus->wqueue_progress_usec = now(CLOCK_MONOTONIC);
                 }
 
         } else {
@@ -2236,6 +2250,9 @@ _public_ int sd_bus_send(sd_bus *bus, sd_bus_message *_m, uint64_t *cookie) {
                 if (!GREEDY_REALLOC(bus->wqueue, bus->wqueue_size + 1))
                         return -ENOMEM;
 
+                if (bus->wqueue_size == 0)
+                        bus->wqueue_progress_usec = now(CLOCK_MONOTONIC);
+
                 bus->wqueue[bus->wqueue_size++] = bus_message_ref_queued(m, bus);
         }
 
@@ -4390,6 +4407,18 @@ _public_ int sd_bus_get_n_queued_read(sd_bus *bus, uint64_t *ret) {
         return 0;
 }
 
+usec_t bus_get_write_stalled_since(sd_bus *bus) {
+        assert(bus);
+
+        /* Returns since when messages have been queued for writing on this connection without any of them
+         * being written out, or USEC_INFINITY if nothing is queued. */
+
+        if (bus->wqueue_size == 0)
+                return USEC_INFINITY;
+
+        return bus->wqueue_progress_usec;
+}
+
 _public_ int sd_bus_get_n_queued_write(sd_bus *bus, uint64_t *ret) {
         assert_return(bus, -EINVAL);
         assert_return(bus = bus_resolve(bus), -ENOPKG);
@@ -0,0 +1,482 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+#include "sd-id128.h"
+
+#include "alloc-util.h"
+#include "bus-internal.h"
+#include "bus-match.h"
+#include "bus-message.h"
+#include "bus-slot.h"
+#include "hash-funcs.h"
+#include "parse-util.h"
+#include "sort-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* A set of sd-bus micro-benchmarks meant to be compared between builds. Output is one tab-separated line
+ * per benchmark and parameter:
+ *
+ *     <benchmark> <parameter> <operations per second> <p50 latency µs> <p99 latency µs>
+ *
+ * Latencies are only measured for method calls, and printed as "-" otherwise. The "call-bus" and
+ * "properties-changed-bus" benchmarks go through the user bus (i.e. dbus-broker or dbus-daemon) and are
+ * skipped if there is none, the others run over a direct connection or without any connection at all.
+ *
+ * With $SYSTEMD_BENCHMARK_JSON=1 the results are printed as JSON instead, see benchmark_report_json().
+ *
+ * Usage: test-bus-benchmark-suite [DURATION]
+ */
+
+#define IFACE "org.freedesktop.systemd.test.Benchmark"
+
+static usec_t arg_loop_usec = 100 * USEC_PER_MSEC;
+static bool arg_json = false;
+
+typedef struct Bench {
+        uint64_t n_ops;
+        usec_t *latencies;
+        size_t n_latencies;
+} Bench;
+
+static void bench_done(Bench *b) {
+        b->latencies = mfree(b->latencies);
+}
+
+static void bench_report(const char *name, unsigned parameter, Bench *b, usec_t duration) {
+        char p50[DECIMAL_STR_MAX(usec_t)] = "-", p99[DECIMAL_STR_MAX(usec_t)] = "-";
+
+        typesafe_qsort(b->latencies, b->n_latencies, uint64_compare_func);
+
+        if (arg_json) {
+                char s[DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(s, "%u", parameter);
+                assert_se(benchmark_report_json(name, s, b->n_ops, duration,
+                                                b->latencies, b->n_latencies, /* extra = */ NULL) >= 0);
+                return;
+        }
+
+        if (b->n_latencies > 0) {
+                xsprintf(p50, USEC_FMT, b->latencies[b->n_latencies / 2]);
+                xsprintf(p99, USEC_FMT, b->latencies[b->n_latencies * 99 / 100]);
+        }
+
+        printf("%s\t%u\t%" PRIu64 "\t%s\t%s\n",
+               name, parameter, b->n_ops * USEC_PER_SEC / MAX(duration, 1u), p50, p99);
+}
+
+typedef struct Peer {
+        sd_bus *bus;
+        uint32_t counter;
+        bool quit;
+} Peer;
+
+static int method_ping(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        return sd_bus_reply_method_return(m, NULL);
+}
+
+static int method_storm(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        Peer *p = ASSERT_PTR(userdata);
+        uint32_t n;
+        int r;
+
+        r = sd_bus_message_read(m, "u", &n);
+        if (r < 0)
+                return r;
+
+        for (uint32_t i = 0; i < n; i++) {
+                p->counter++;
+
+                r = sd_bus_emit_properties_changed(sd_bus_message_get_bus(m), "/", IFACE, "Counter", NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_reply_method_return(m, NULL);
+}
+
+static int method_quit(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        Peer *p = ASSERT_PTR(userdata);
+
+        p->quit = true;
+        return sd_bus_reply_method_return(m, NULL);
+}
+
+static const sd_bus_vtable peer_vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_METHOD("Ping", NULL, NULL, method_ping, 0),
+        SD_BUS_METHOD("Storm", "u", NULL, method_storm, 0),
+        SD_BUS_METHOD("Quit", NULL, NULL, method_quit, 0),
+        SD_BUS_PROPERTY("Counter", "u", NULL, offsetof(Peer, counter), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_VTABLE_END
+};
+
+static void* peer_thread(void *userdata) {
+        Peer *p = ASSERT_PTR(userdata);
+        int r;
+
+        while (!p->quit) {
+                r = sd_bus_process(p->bus, NULL);
+                assert_se(r >= 0);
+                if (r > 0)
+                        continue;
+
+                assert_se(sd_bus_wait(p->bus, USEC_INFINITY) >= 0);
+        }
+
+        assert_se(sd_bus_flush(p->bus) >= 0);
+        return NULL;
+}
+
+static void connect_direct(sd_bus **ret_server, sd_bus **ret_client) {
+        _cleanup_(sd_bus_unrefp) sd_bus *server = NULL, *client = NULL;
+        int pair[2];
+        sd_id128_t id;
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair) >= 0);
+        assert_se(sd_id128_randomize(&id) >= 0);
+
+        assert_se(sd_bus_new(&server) >= 0);
+        assert_se(sd_bus_set_fd(server, pair[0], pair[0]) >= 0);
+        assert_se(sd_bus_set_server(server, true, id) >= 0);
+        assert_se(sd_bus_start(server) >= 0);
+
+        assert_se(sd_bus_new(&client) >= 0);
+        assert_se(sd_bus_set_fd(client, pair[1], pair[1]) >= 0);
+        assert_se(sd_bus_start(client) >= 0);
+
+        *ret_server = TAKE_PTR(server);
+        *ret_client = TAKE_PTR(client);
+}
+
+static int connect_bus(sd_bus **ret_server, sd_bus **ret_client) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+        int r;
+
+        r = sd_bus_open_user(&server);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_open_user(&client);
+        if (r < 0)
+                return r;
+
+        *ret_server = TAKE_PTR(server);
+        *ret_client = TAKE_PTR(client);
+        return 0;
+}
+
+static void peer_start(Peer *p, sd_bus *server, pthread_t *ret) {
+        assert_se(sd_bus_add_object_vtable(server, NULL, "/", IFACE, peer_vtable, p) >= 0);
+
+        p->bus = server;
+        assert_se(pthread_create(ret, NULL, peer_thread, p) == 0);
+}
+
+static void peer_stop(sd_bus *client, const char *destination, pthread_t t) {
+        assert_se(sd_bus_call_method(client, destination, "/", IFACE, "Quit", NULL, NULL, NULL) >= 0);
+        assert_se(pthread_join(t, NULL) == 0);
+}
+
+static void fill_message(sd_bus_message *m, unsigned n) {
+        assert_se(sd_bus_message_open_container(m, 'a', "{sv}") >= 0);
+        for (unsigned i = 0; i < n; i++) {
+                char key[STRLEN("key") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(key, "key%u", i);
+
+                switch (i % 3) {
+                case 0:
+                        assert_se(sd_bus_message_append(m, "{sv}", key, "s", "some string value") >= 0);
+                        break;
+                case 1:
+                        assert_se(sd_bus_message_append(m, "{sv}", key, "t", (uint64_t) i) >= 0);
+                        break;
+                case 2:
+                        assert_se(sd_bus_message_append(m, "{sv}", key, "as", 3, "a", "bb", "ccc") >= 0);
+                        break;
+                }
+        }
+        assert_se(sd_bus_message_close_container(m) >= 0);
+
+        assert_se(sd_bus_message_open_container(m, 'a', "a(su)") >= 0);
+        for (unsigned i = 0; i < n; i++)
+                assert_se(sd_bus_message_append(m, "a(su)", 2, "first", i, "second", i + 1) >= 0);
+        assert_se(sd_bus_message_close_container(m) >= 0);
+}
+
+static void read_message(sd_bus_message *m) {
+        assert_se(sd_bus_message_rewind(m, true) >= 0);
+
+        assert_se(sd_bus_message_enter_container(m, 'a', "{sv}") >= 0);
+        for (;;) {
+                const char *key, *contents;
+                char type;
+                int r;
+
+                r = sd_bus_message_enter_container(m, 'e', "sv");
+                assert_se(r >= 0);
+                if (r == 0)
+                        break;
+
+                assert_se(sd_bus_message_read(m, "s", &key) >= 0);
+                assert_se(sd_bus_message_peek_type(m, &type, &contents) > 0);
+
+                if (streq(contents, "s")) {
+                        const char *s;
+
+                        assert_se(sd_bus_message_read(m, "v", "s", &s) >= 0);
+                } else if (streq(contents, "t")) {
+                        uint64_t t;
+
+                        assert_se(sd_bus_message_read(m, "v", "t", &t) >= 0);
+                } else {
+                        _cleanup_strv_free_ char **l = NULL;
+
+                        assert_se(sd_bus_message_enter_container(m, 'v', "as") >= 0);
+                        assert_se(sd_bus_message_read_strv(m, &l) >= 0);
+                        assert_se(sd_bus_message_exit_container(m) >= 0);
+                }
+
+                assert_se(sd_bus_message_exit_container(m) >= 0);
+        }
+        assert_se(sd_bus_message_exit_container(m) >= 0);
+
+        assert_se(sd_bus_message_enter_container(m, 'a', "a(su)") >= 0);
+        while (sd_bus_message_enter_container(m, 'a', "(su)") > 0) {
+                const char *s;
+                uint32_t u;
+
+                while (sd_bus_message_read(m, "(su)", &s, &u) > 0)
+                        ;
+
+                assert_se(sd_bus_message_exit_container(m) >= 0);
+        }
+        assert_se(sd_bus_message_exit_container(m) >= 0);
+}
+
+static void bench_marshal(unsigned n) {
+        _cleanup_(sd_bus_unrefp) sd_bus *server = NULL, *client = NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *sealed = NULL;
+        Bench b_append = {}, b_read = {};
+        usec_t start, t;
+
+        connect_direct(&server, &client);
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                assert_se(sd_bus_message_new_method_call(client, &m, NULL, "/", IFACE, "Marshal") >= 0);
+                fill_message(m, n);
+                assert_se(sd_bus_message_seal(m, b_append.n_ops + 1, 0) >= 0);
+
+                b_append.n_ops++;
+                t = now(CLOCK_MONOTONIC);
+        } while (t < start + arg_loop_usec);
+        bench_report("marshal-append", n, &b_append, t - start);
+
+        assert_se(sd_bus_message_new_method_call(client, &sealed, NULL, "/", IFACE, "Marshal") >= 0);
+        fill_message(sealed, n);
+        assert_se(sd_bus_message_seal(sealed, 1, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                read_message(sealed);
+
+                b_read.n_ops++;
+                t = now(CLOCK_MONOTONIC);
+        } while (t < start + arg_loop_usec);
+        bench_report("marshal-read", n, &b_read, t - start);
+}
+
+static int count_match(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        (*n)++;
+        return 0;
+}
+
+static void bench_match(unsigned n) {
+        _cleanup_(sd_bus_unrefp) sd_bus *server = NULL, *client = NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_free_ sd_bus_slot *slots = NULL;
+        struct bus_match_node root = {
+                .type = BUS_MATCH_ROOT,
+        };
+        unsigned n_matched = 0;
+        Bench b = {};
+        usec_t start, t;
+
+        connect_direct(&server, &client);
+
+        /* Resembles what a busy client installs: many matches that only differ in the watched object, with
+         * a mix of the most common match types */
+        assert_se(slots = new0(sd_bus_slot, n));
+        for (unsigned i = 0; i < n; i++) {
+                _cleanup_free_ char *match = NULL;
+                struct bus_match_component *components;
+                size_t n_components;
+
+                switch (i % 3) {
+                case 0:
+                        assert_se(asprintf(&match, "type='signal',interface='org.freedesktop.DBus.Properties',member='PropertiesChanged',path='/object/%u'", i) >= 0);
+                        break;
+                case 1:
+                        assert_se(asprintf(&match, "type='signal',sender='org.freedesktop.DBus',member='NameOwnerChanged',arg0='org.example.Name%u'", i) >= 0);
+                        break;
+                case 2:
+                        assert_se(asprintf(&match, "type='signal',path_namespace='/object/%u'", i) >= 0);
+                        break;
+                }
+
+                assert_se(bus_match_parse(match, &components, &n_components) >= 0);
+                CLEANUP_ARRAY(components, n_components, bus_match_parse_free);
+
+                slots[i].userdata = &n_matched;
+                slots[i].match_callback.callback = count_match;
+                assert_se(bus_match_add(&root, components, n_components, &slots[i].match_callback) >= 0);
+        }
+
+        assert_se(sd_bus_message_new_signal(client, &m, "/object/0", "org.freedesktop.DBus.Properties", "PropertiesChanged") >= 0);
+        assert_se(sd_bus_message_append(m, "sa{sv}as", IFACE, 0, 0) >= 0);
+        assert_se(sd_bus_message_seal(m, 1, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                assert_se(bus_match_run(NULL, &root, m) == 0);
+
+                b.n_ops++;
+                t = now(CLOCK_MONOTONIC);
+        } while (t < start + arg_loop_usec);
+
+        /* Only the path match of object 0 applies */
+        assert_se(n_matched == b.n_ops);
+        bench_report("match-dispatch", n, &b, t - start);
+
+        bus_match_free(&root);
+}
+
+static void bench_call(const char *name, sd_bus *server, sd_bus *client) {
+        _cleanup_(bench_done) Bench b = {};
+        const char *destination = NULL;
+        Peer p = {};
+        pthread_t t;
+        usec_t start, n;
+
+        if (server->bus_client)
+                assert_se(sd_bus_get_unique_name(server, &destination) >= 0);
+
+        peer_start(&p, server, &t);
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                usec_t c = now(CLOCK_MONOTONIC);
+
+                assert_se(sd_bus_call_method(client, destination, "/", IFACE, "Ping", NULL, NULL, NULL) >= 0);
+                n = now(CLOCK_MONOTONIC);
+
+                b.n_ops++;
+                if (GREEDY_REALLOC(b.latencies, b.n_latencies + 1))
+                        b.latencies[b.n_latencies++] = n - c;
+        } while (n < start + arg_loop_usec);
+
+        bench_report(name, 1, &b, n - start);
+
+        peer_stop(client, destination, t);
+}
+
+static void bench_properties_changed(const char *name, unsigned n, sd_bus *server, sd_bus *client) {
+        const char *destination = NULL;
+        unsigned n_received = 0;
+        Peer p = {};
+        Bench b = {};
+        pthread_t t;
+        usec_t start;
+
+        if (server->bus_client)
+                assert_se(sd_bus_get_unique_name(server, &destination) >= 0);
+
+        assert_se(sd_bus_match_signal(client, NULL, destination, "/", "org.freedesktop.DBus.Properties", "PropertiesChanged", count_match, &n_received) >= 0);
+
+        peer_start(&p, server, &t);
+
+        /* Measures how long it takes until a burst of signals has been received and dispatched */
+        start = now(CLOCK_MONOTONIC);
+        assert_se(sd_bus_call_method(client, destination, "/", IFACE, "Storm", NULL, NULL, "u", n) >= 0);
+        while (n_received < n) {
+                int r;
+
+                r = sd_bus_process(client, NULL);
+                assert_se(r >= 0);
+                if (r == 0)
+                        assert_se(sd_bus_wait(client, USEC_INFINITY) >= 0);
+        }
+
+        b.n_ops = n_received;
+        bench_report(name, n, &b, now(CLOCK_MONOTONIC) - start);
+
+        peer_stop(client, destination, t);
+}
+
+int main(int argc, char *argv[]) {
+        unsigned n;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                assert_se(parse_sec(argv[1], &arg_loop_usec) >= 0);
+        assert_se(arg_loop_usec > 0);
+
+        arg_json = benchmark_json_enabled();
+        if (!arg_json)
+                printf("benchmark\tparameter\tops/s\tp50_usec\tp99_usec\n");
+
+        FOREACH_ARGUMENT(n, 1, 16, 256)
+                bench_marshal(n);
+
+        FOREACH_ARGUMENT(n, 1000, 10000, 100000)
+                bench_match(n);
+
+        {
+                _cleanup_(sd_bus_unrefp) sd_bus *server = NULL, *client = NULL;
+
+                connect_direct(&server, &client);
+                bench_call("call-direct", server, client);
+        }
+
+        FOREACH_ARGUMENT(n, 100, 10000) {
+                _cleanup_(sd_bus_unrefp) sd_bus *server = NULL, *client = NULL;
+
+                connect_direct(&server, &client);
+                bench_properties_changed("properties-changed-direct", n, server, client);
+        }
+
+        {
+                _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+
+                r = connect_bus(&server, &client);
+                if (r < 0)
+                        log_notice_errno(r, "Failed to connect to user bus, skipping benchmarks through the bus: %m");
+                else
+                        bench_call("call-bus", server, client);
+        }
+
+        FOREACH_ARGUMENT(n, 100, 10000) {
+                _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+
+                if (connect_bus(&server, &client) < 0)
+                        break;
+
+                bench_properties_changed("properties-changed-bus", n, server, client);
+        }
+
+        return 0;
+}
@@ -23,6 +23,34 @@ static void test_manual_introspection_one(const sd_bus_vtable vtable[]) {
         fputs("\n", stdout);
 }
 
+static void test_cached_introspection_one(const sd_bus_vtable vtable[]) {
+        _cleanup_free_ char *s = NULL, *t = NULL, *cache = NULL;
+        struct introspect intro = {};
+
+        log_info("/* %s */", __func__);
+
+        assert_se(introspect_begin(&intro, false) >= 0);
+        assert_se(introspect_write_interface(&intro, "org.foo", vtable) >= 0);
+        assert_se(introspect_write_interface(&intro, "org.foo.bar", vtable) >= 0);
+        assert_se(introspect_finish(&intro, &s) == 0);
+
+        /* The first call fills the cache, the second one uses it, both must match the uncached output */
+        assert_se(introspect_begin(&intro, false) >= 0);
+        assert_se(introspect_write_interface_cached(&intro, "org.foo", vtable, &cache) >= 0);
+        assert_se(cache);
+        assert_se(introspect_write_interface_cached(&intro, "org.foo.bar", vtable, &cache) >= 0);
+        assert_se(introspect_finish(&intro, &t) == 0);
+
+        ASSERT_STREQ(s, t);
+}
+
+TEST(cached_introspection) {
+        test_cached_introspection_one(test_vtable_1);
+        test_cached_introspection_one(test_vtable_2);
+        test_cached_introspection_one(test_vtable_deprecated);
+        test_cached_introspection_one((const sd_bus_vtable *) vtable_format_221);
+}
+
 TEST(manual_introspection) {
         test_manual_introspection_one(test_vtable_1);
         test_manual_introspection_one(test_vtable_2);
@@ -494,6 +494,18 @@ int device_enumerator_add_device(sd_device_enumerator *enumerator, sd_device *de
         return 1;
 }
 
+static bool enumerator_has_device(sd_device_enumerator *enumerator, sd_device *device) {
+        const char *syspath;
+
+        assert(enumerator);
+        assert(device);
+
+        if (sd_device_get_syspath(device, &syspath) < 0)
+                return false;
+
+        return hashmap_contains(enumerator->devices_by_syspath, syspath);
+}
+
 static bool match_property(Hashmap *properties, sd_device *device, bool match_all) {
         const char *property_pattern;
         char * const *value_patterns;
@@ -666,6 +678,11 @@ static int enumerator_add_parent_devices(
                 if (r < 0)
                         return r;
 
+                /* Already added, and so are the matching devices further up. Avoid testing the matches
+                 * again, as that may need to read the uevent file, the database and sysattrs. */
+                if (enumerator_has_device(enumerator, device))
+                        return 0;
+
                 r = test_matches(enumerator, device, flags);
                 if (r < 0)
                         return r;
@@ -744,6 +761,11 @@ static int enumerator_scan_dir_and_add_devices(
                         continue;
                 }
 
+                /* Many devices are found as the parent of another one before we get to their own entry in
+                 * /sys/bus/ or /sys/class/. Then, the device and its parents are already taken care of. */
+                if (enumerator_has_device(enumerator, device))
+                        continue;
+
                 k = test_matches(enumerator, device, MATCH_ALL & (~MATCH_SYSNAME)); /* sysname is already tested. */
                 if (k <= 0) {
                         if (k < 0)
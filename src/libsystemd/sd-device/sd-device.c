@@ -2362,6 +2362,7 @@ int device_get_cached_sysattr_value(sd_device *device, const char *key, const ch
  * with a NULL value in the cache, otherwise the returned string is stored */
 _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr, const char **ret_value) {
         _cleanup_free_ char *value = NULL, *path = NULL;
+        _cleanup_close_ int fd = -EBADF;
         const char *syspath;
         struct stat statbuf;
         int r;
@@ -2382,11 +2383,34 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
         if (!path)
                 return -ENOMEM;
 
-        if (lstat(path, &statbuf) < 0) {
+        /* Open the attribute right away rather than doing lstat() first, so that the path is only resolved
+         * once. O_NOFOLLOW makes us notice symlinks, like lstat() would. */
+        fd = open(path, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
+        if (fd < 0) {
                 int k;
 
                 r = -errno;
 
+                if (r == -ELOOP) {
+                        /* Some core links return only the last element of the target path,
+                         * these are just values, the paths should not be exposed. */
+                        if (!STR_IN_SET(sysattr, "driver", "subsystem", "module"))
+                                return -EINVAL;
+
+                        r = readlink_value(path, &value);
+                        if (r < 0)
+                                return r;
+
+                        goto cache;
+                }
+
+                if (r == -EACCES)
+                        /* skip non-readable files */
+                        return -EPERM;
+
+                if (!IN_SET(r, -ENOENT, -ENOTDIR))
+                        return r;
+
                 /* remember that we could not access the sysattr */
                 k = device_cache_sysattr_value(device, sysattr, NULL);
                 if (k < 0)
@@ -2395,16 +2419,12 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
                                                sysattr);
 
                 return r;
-        } else if (S_ISLNK(statbuf.st_mode)) {
-                /* Some core links return only the last element of the target path,
-                 * these are just values, the paths should not be exposed. */
-                if (STR_IN_SET(sysattr, "driver", "subsystem", "module")) {
-                        r = readlink_value(path, &value);
-                        if (r < 0)
-                                return r;
-                } else
-                        return -EINVAL;
-        } else if (S_ISDIR(statbuf.st_mode))
+        }
+
+        if (fstat(fd, &statbuf) < 0)
+                return -errno;
+
+        if (S_ISDIR(statbuf.st_mode))
                 /* skip directories */
                 return -EISDIR;
         else if (!(statbuf.st_mode & S_IRUSR))
@@ -2415,7 +2435,7 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
 
                 /* Read attribute value, Some attributes contain embedded '\0'. So, it is necessary to
                  * also get the size of the result. See issue #20025. */
-                r = read_full_virtual_file(path, &value, &size);
+                r = read_virtual_file_fd(fd, SIZE_MAX, &value, &size);
                 if (r < 0)
                         return r;
 
@@ -2424,6 +2444,7 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
                         value[size] = '\0';
         }
 
+cache:
         /* Unfortunately, we need to return 'const char*' instead of 'char*'. Hence, failure in caching
          * sysattr value is critical unlike the other places. */
         r = device_cache_sysattr_value(device, sysattr, value);
@@ -64,6 +64,7 @@ struct sd_event_source {
         bool floating:1;
         bool exit_on_failure:1;
         bool ratelimited:1;
+        bool from_pool:1;
 
         int64_t priority;
         unsigned pending_index;
@@ -91,6 +92,8 @@ struct sd_event_source {
                         uint32_t revents;
                         bool registered:1;
                         bool owned:1;
+                        bool oneshot:1;  /* registered with EPOLLONESHOT */
+                        bool disarmed:1; /* fired with EPOLLONESHOT, hence still in the epoll set, but disarmed by the kernel */
                 } io;
                 struct {
                         sd_event_time_handler_t callback;
@@ -113,6 +116,8 @@ struct sd_event_source {
                         bool process_owned:1; /* kill+reap process when event source is freed */
                         bool exited:1; /* true if process exited (i.e. if there's value in SIGKILLing it if we want to get rid of it) */
                         bool waited:1; /* true if process was waited for (i.e. if there's value in waitid(P_PID)'ing it if we want to get rid of it) */
+                        bool in_waitid_list:1; /* true if the process is not watched via its pidfd but via waitid() */
+                        LIST_FIELDS(sd_event_source, waitid_list);
                 } child;
                 struct {
                         sd_event_handler_t callback;
@@ -25,6 +25,7 @@
 #include "macro.h"
 #include "mallinfo-util.h"
 #include "memory-util.h"
+#include "mempool.h"
 #include "missing_magic.h"
 #include "missing_syscall.h"
 #include "missing_threads.h"
@@ -44,6 +45,9 @@
 
 #define DEFAULT_ACCURACY_USEC (250 * USEC_PER_MSEC)
 
+/* With $SD_EVENT_PROFILE_DELAYS set, log dispatches of event sources that take longer than this */
+#define PROFILE_SLOW_DISPATCH_USEC (50 * USEC_PER_MSEC)
+
 static bool EVENT_SOURCE_WATCH_PIDFD(sd_event_source *s) {
         /* Returns true if this is a PID event source and can be implemented by watching EPOLLIN */
         return s &&
@@ -133,6 +137,10 @@ struct sd_event {
         Hashmap *child_sources;
         unsigned n_online_child_sources;
 
+        /* A list of child event sources that cannot be watched via a pidfd and are checked via waitid()
+         * whenever SIGCHLD is seen */
+        LIST_HEAD(sd_event_source, child_waitid_list);
+
         Set *post_sources;
 
         Prioq *exit;
@@ -158,6 +166,7 @@ struct sd_event {
         bool need_process_child:1;
         bool watchdog:1;
         bool profile_delays:1;
+        bool batch_dispatch:1;
 
         int exit_code;
 
@@ -432,8 +441,9 @@ _public_ int sd_event_new(sd_event** ret) {
         e->epoll_fd = fd_move_above_stdio(e->epoll_fd);
 
         if (secure_getenv("SD_EVENT_PROFILE_DELAYS")) {
-                log_debug("Event loop profiling enabled. Logarithmic histogram of event loop iterations in the range 2^0 %s 2^63 us will be logged every 5s.",
-                          special_glyph(SPECIAL_GLYPH_ELLIPSIS));
+                log_debug("Event loop profiling enabled. Logarithmic histogram of event loop iterations in the range 2^0 %s 2^63 us will be logged every 5s, "
+                          "as well as event sources that take longer than %s to dispatch.",
+                          special_glyph(SPECIAL_GLYPH_ELLIPSIS), FORMAT_TIMESPAN(PROFILE_SLOW_DISPATCH_USEC, 0));
                 e->profile_delays = true;
         }
 
@@ -491,14 +501,30 @@ static void source_io_unregister(sd_event_source *s) {
         if (event_origin_changed(s->event))
                 return;
 
-        if (!s->io.registered)
+        if (!s->io.registered && !s->io.disarmed)
                 return;
 
         if (epoll_ctl(s->event->epoll_fd, EPOLL_CTL_DEL, s->io.fd, NULL) < 0)
                 log_debug_errno(errno, "Failed to remove source %s (type %s) from epoll, ignoring: %m",
                                 strna(s->description), event_source_type_to_string(s->type));
 
-        s->io.registered = false;
+        s->io.registered = s->io.oneshot = s->io.disarmed = false;
+}
+
+static void source_io_park(sd_event_source *s) {
+        assert(s);
+        assert(s->type == SOURCE_IO);
+
+        /* A oneshot source that fired is already disarmed by the kernel and won't report anything anymore,
+         * hence leave it in the epoll set when it is disabled, so that re-enabling it later only needs an
+         * EPOLL_CTL_MOD instead of an EPOLL_CTL_DEL + EPOLL_CTL_ADD pair. */
+
+        if (s->io.registered && s->io.disarmed) {
+                s->io.registered = false;
+                return;
+        }
+
+        source_io_unregister(s);
 }
 
 static int source_io_register(
@@ -516,11 +542,20 @@ static int source_io_register(
         };
 
         if (epoll_ctl(s->event->epoll_fd,
-                      s->io.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
-                      s->io.fd, &ev) < 0)
-                return -errno;
+                      s->io.registered || s->io.disarmed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                      s->io.fd, &ev) < 0) {
+                /* If the fd got closed while we left it parked in the epoll set, the kernel dropped it from
+                 * there, hence add it anew */
+                if (errno != ENOENT || s->io.registered || !s->io.disarmed)
+                        return -errno;
+
+                if (epoll_ctl(s->event->epoll_fd, EPOLL_CTL_ADD, s->io.fd, &ev) < 0)
+                        return -errno;
+        }
 
         s->io.registered = true;
+        s->io.oneshot = enabled == SD_EVENT_ONESHOT;
+        s->io.disarmed = false;
 
         return 0;
 }
@@ -601,6 +636,28 @@ static int source_memory_pressure_register(sd_event_source *s, int enabled) {
         return 0;
 }
 
+static void source_child_add_to_waitid_list(sd_event_source *s) {
+        assert(s);
+        assert(s->type == SOURCE_CHILD);
+
+        if (s->child.in_waitid_list)
+                return;
+
+        LIST_PREPEND(child.waitid_list, s->event->child_waitid_list, s);
+        s->child.in_waitid_list = true;
+}
+
+static void source_child_remove_from_waitid_list(sd_event_source *s) {
+        assert(s);
+        assert(s->type == SOURCE_CHILD);
+
+        if (!s->child.in_waitid_list)
+                return;
+
+        LIST_REMOVE(child.waitid_list, s->event->child_waitid_list, s);
+        s->child.in_waitid_list = false;
+}
+
 static void source_memory_pressure_add_to_write_list(sd_event_source *s) {
         assert(s);
         assert(s->type == SOURCE_MEMORY_PRESSURE);
@@ -994,8 +1051,10 @@ static void source_disconnect(sd_event_source *s) {
 
                 if (EVENT_SOURCE_WATCH_PIDFD(s))
                         source_child_pidfd_unregister(s);
-                else
+                else {
+                        source_child_remove_from_waitid_list(s);
                         event_gc_signal_data(s->event, &s->priority, SIGCHLD);
+                }
 
                 break;
 
@@ -1075,6 +1134,22 @@ static void source_disconnect(sd_event_source *s) {
                 sd_event_unref(event);
 }
 
+/* Timer and static (defer/post/exit) event sources are the ones that are created and destroyed at the
+ * highest rate by far, hence allocate them from a memory pool with tiles just large enough for them, if the
+ * memory pool is enabled. */
+static struct mempool event_source_pool = {
+        .tile_size = CONST_ALIGN_TO(CONST_MAX(CONST_MAX(endoffsetof_field(sd_event_source, time),
+                                                        endoffsetof_field(sd_event_source, defer)),
+                                              CONST_MAX(endoffsetof_field(sd_event_source, post),
+                                                        endoffsetof_field(sd_event_source, exit))),
+                                    alignof(sd_event_source)),
+        .at_least = 16,
+};
+
+static bool event_source_type_uses_pool(EventSourceType t) {
+        return EVENT_SOURCE_IS_TIME(t) || IN_SET(t, SOURCE_DEFER, SOURCE_POST, SOURCE_EXIT);
+}
+
 static sd_event_source* source_free(sd_event_source *s) {
         assert(s);
 
@@ -1130,6 +1205,10 @@ static sd_event_source* source_free(sd_event_source *s) {
                 s->destroy_callback(s->userdata);
 
         free(s->description);
+
+        if (s->from_pool)
+                return mempool_free_tile(&event_source_pool, s);
+
         return mfree(s);
 }
 DEFINE_TRIVIAL_CLEANUP_FUNC(sd_event_source*, source_free);
@@ -1205,13 +1284,17 @@ static sd_event_source* source_new(sd_event *e, bool floating, EventSourceType t
         };
 
         sd_event_source *s;
+        bool use_pool;
 
         assert(e);
         assert(type >= 0);
         assert(type < _SOURCE_EVENT_SOURCE_TYPE_MAX);
         assert(size_table[type] > 0);
 
-        s = malloc0(size_table[type]);
+        use_pool = event_source_type_uses_pool(type) && mempool_enabled && mempool_enabled(); /* mempool_enabled is a weak symbol */
+        assert(!use_pool || size_table[type] <= event_source_pool.tile_size);
+
+        s = use_pool ? mempool_alloc0_tile(&event_source_pool) : malloc0(size_table[type]);
         if (!s)
                 return NULL;
         /* We use expand_to_usable() here to tell gcc that it should consider this an object of the full
@@ -1224,6 +1307,7 @@ static sd_event_source* source_new(sd_event *e, bool floating, EventSourceType t
         s->event = e;
         s->floating = floating;
         s->type = type;
+        s->from_pool = use_pool;
         s->pending_index = PRIOQ_IDX_NULL;
         s->prepare_index = PRIOQ_IDX_NULL;
 
@@ -1297,6 +1381,21 @@ static void initialize_perturb(sd_event *e) {
         if (_likely_(e->perturb != USEC_INFINITY))
                 return;
 
+        /* The offset may also be configured explicitly, so that it can be set to the same value for all
+         * processes, e.g. via DefaultEnvironment= of the service manager. Setting it to 0 aligns our timers
+         * to full seconds, where the kernel also likes to place its own rounded timers. */
+        const char *v = secure_getenv("SD_EVENT_PERTURB_USEC");
+        if (v) {
+                usec_t u;
+
+                if (parse_time(v, &u, 1) >= 0 && u != USEC_INFINITY) {
+                        e->perturb = u % USEC_PER_MINUTE;
+                        return;
+                }
+
+                log_debug("Failed to parse $SD_EVENT_PERTURB_USEC, ignoring: %s", v);
+        }
+
         if (sd_id128_get_boot(&id) >= 0 || sd_id128_get_machine(&id) >= 0)
                 e->perturb = (id.qwords[0] ^ id.qwords[1]) % USEC_PER_MINUTE;
         else
@@ -1664,6 +1763,7 @@ _public_ int sd_event_add_child(
                 if (r < 0)
                         return r;
 
+                source_child_add_to_waitid_list(s);
                 e->need_process_child = true;
         }
 
@@ -1751,6 +1851,7 @@ _public_ int sd_event_add_child_pidfd(
                 if (r < 0)
                         return r;
 
+                source_child_add_to_waitid_list(s);
                 e->need_process_child = true;
         }
 
@@ -2670,16 +2771,22 @@ _public_ int sd_event_source_set_io_fd(sd_event_source *s, int fd) {
         assert(event_source_is_offline(s) == !s->io.registered);
 
         if (s->io.registered) {
-                s->io.registered = false;
+                bool disarmed = s->io.disarmed;
+
+                s->io.registered = s->io.disarmed = false;
 
                 r = source_io_register(s, s->enabled, s->io.events);
                 if (r < 0) {
                         s->io.fd = saved_fd;
                         s->io.registered = true;
+                        s->io.disarmed = disarmed;
                         return r;
                 }
 
                 (void) epoll_ctl(s->event->epoll_fd, EPOLL_CTL_DEL, saved_fd, NULL);
+        } else if (s->io.disarmed) {
+                (void) epoll_ctl(s->event->epoll_fd, EPOLL_CTL_DEL, saved_fd, NULL);
+                s->io.disarmed = false;
         }
 
         if (s->io.owned)
@@ -2921,7 +3028,7 @@ static int event_source_offline(
         switch (s->type) {
 
         case SOURCE_IO:
-                source_io_unregister(s);
+                source_io_park(s);
                 break;
 
         case SOURCE_SIGNAL:
@@ -3130,6 +3237,11 @@ _public_ int sd_event_source_set_time(sd_event_source *s, uint64_t usec) {
         if (r < 0)
                 return r;
 
+        /* Timers are frequently re-armed to the time they are already set to, in which case their position
+         * in the prioqs doesn't change (source_set_pending() took care of reordering if it was pending) */
+        if (s->time.next == usec)
+                return 0;
+
         s->time.next = usec;
 
         event_source_time_prioq_reshuffle(s);
@@ -3184,6 +3296,9 @@ _public_ int sd_event_source_set_time_accuracy(sd_event_source *s, uint64_t usec
         if (usec == 0)
                 usec = DEFAULT_ACCURACY_USEC;
 
+        if (s->time.accuracy == usec)
+                return 0;
+
         s->time.accuracy = usec;
 
         event_source_time_prioq_reshuffle(s);
@@ -3651,6 +3766,12 @@ static int process_io(sd_event *e, sd_event_source *s, uint32_t revents) {
         else
                 s->io.revents = revents;
 
+        /* Only trust the kernel to have disarmed the fd if we actually registered it with EPOLLONESHOT.
+         * Switching an enabled source from SD_EVENT_ON to SD_EVENT_ONESHOT doesn't re-register it, and such
+         * a source would keep reporting events while parked. */
+        if (s->io.oneshot)
+                s->io.disarmed = true;
+
         return source_set_pending(s, true);
 }
 
@@ -3729,7 +3850,6 @@ static int process_timer(
 static int process_child(sd_event *e, int64_t threshold, int64_t *ret_min_priority) {
         int64_t min_priority = threshold;
         bool something_new = false;
-        sd_event_source *s;
         int r;
 
         assert(e);
@@ -3750,11 +3870,16 @@ static int process_child(sd_event *e, int64_t threshold, int64_t *ret_min_priori
          * about. Since this is O(n) this means that if you have a lot of processes you probably want
          * to handle SIGCHLD yourself.
          *
+         * Child sources that are watched via their pidfd are not on the waitid list at all, they are only
+         * looked at when epoll reports their pidfd, see process_pidfd(). Hence, if pidfds are available
+         * this loop only covers sources that watch for something else than WEXITED.
+         *
          * We do not reap the children here (by using WNOWAIT), this is only done after the event
          * source is dispatched so that the callback still sees the process as a zombie. */
 
-        HASHMAP_FOREACH(s, e->child_sources) {
+        LIST_FOREACH(child.waitid_list, s, e->child_waitid_list) {
                 assert(s->type == SOURCE_CHILD);
+                assert(!EVENT_SOURCE_WATCH_PIDFD(s));
 
                 if (s->priority > threshold)
                         continue;
@@ -3768,11 +3893,6 @@ static int process_child(sd_event *e, int64_t threshold, int64_t *ret_min_priori
                 if (s->child.exited)
                         continue;
 
-                if (EVENT_SOURCE_WATCH_PIDFD(s))
-                        /* There's a usable pidfd known for this event source? Then don't waitid() for
-                         * it here */
-                        continue;
-
                 zero(s->child.siginfo);
                 if (waitid(P_PID, s->child.pid, &s->child.siginfo,
                            WNOHANG | (s->child.options & WEXITED ? WNOWAIT : 0) | s->child.options) < 0)
@@ -4157,6 +4277,7 @@ static int source_memory_pressure_initiate_dispatch(sd_event_source *s) {
 }
 
 static int source_dispatch(sd_event_source *s) {
+        usec_t dispatch_start = USEC_INFINITY;
         EventSourceType saved_type;
         sd_event *saved_event;
         int r = 0;
@@ -4220,6 +4341,9 @@ static int source_dispatch(sd_event_source *s) {
                         return r;
         }
 
+        if (saved_event->profile_delays)
+                dispatch_start = now(CLOCK_MONOTONIC);
+
         s->dispatching = true;
 
         switch (s->type) {
@@ -4312,6 +4436,17 @@ static int source_dispatch(sd_event_source *s) {
 
         s->dispatching = false;
 
+        if (dispatch_start != USEC_INFINITY) {
+                usec_t d = usec_sub_unsigned(now(CLOCK_MONOTONIC), dispatch_start);
+
+                /* Tell who is blocking the event loop */
+                if (d >= PROFILE_SLOW_DISPATCH_USEC)
+                        log_debug("Dispatching event source %s (type %s) took %s.",
+                                  strna(s->description),
+                                  event_source_type_to_string(saved_type),
+                                  FORMAT_TIMESPAN(d, USEC_PER_MSEC));
+        }
+
 finish:
         if (r < 0) {
                 log_debug_errno(r, "Event source %s (type %s) returned error, %s: %m",
@@ -4843,10 +4978,26 @@ _public_ int sd_event_dispatch(sd_event *e) {
 
         p = event_next_pending(e);
         if (p) {
+                EventSourceType type = p->type;
+                int64_t priority = p->priority;
+
                 PROTECT_EVENT(e);
 
                 e->state = SD_EVENT_RUNNING;
                 r = source_dispatch(p);
+
+                /* In batch mode, also dispatch all other I/O or child sources that are already pending at
+                 * the same priority, without polling the kernel in between. Such sources only become
+                 * pending again in sd_event_wait(), hence this terminates. */
+                if (e->batch_dispatch && IN_SET(type, SOURCE_IO, SOURCE_CHILD))
+                        while (r >= 0 && !e->exit_requested) {
+                                p = event_next_pending(e);
+                                if (!p || p->type != type || p->priority != priority)
+                                        break;
+
+                                r = source_dispatch(p);
+                        }
+
                 e->state = SD_EVENT_INITIAL;
                 return r;
         }
@@ -5093,6 +5244,27 @@ _public_ int sd_event_get_watchdog(sd_event *e) {
         return e->watchdog;
 }
 
+_public_ int sd_event_set_batch_dispatch(sd_event *e, int b) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        if (e->batch_dispatch == !!b)
+                return 0;
+
+        e->batch_dispatch = b;
+        return 1;
+}
+
+_public_ int sd_event_get_batch_dispatch(sd_event *e) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        return e->batch_dispatch;
+}
+
 _public_ int sd_event_get_iteration(sd_event *e, uint64_t *ret) {
         assert_return(e, -EINVAL);
         assert_return(e = event_resolve(e), -ENOPKG);
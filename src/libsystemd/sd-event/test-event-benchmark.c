@@ -0,0 +1,297 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "hash-funcs.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "process-util.h"
+#include "rlimit-util.h"
+#include "rm-rf.h"
+#include "signal-util.h"
+#include "sort-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+
+/* Measures how many event sources of each type the event loop dispatches per second, for a configurable
+ * number of sources. Output is one tab-separated line per source type and count:
+ *
+ *     <type> <n_sources> <dispatches per second> <p50 latency µs> <p99 latency µs>
+ *
+ * Latencies are only measured for timers (how late they are dispatched), and printed as "-" otherwise.
+ *
+ * With $SYSTEMD_BENCHMARK_JSON=1 the results are printed as JSON instead, see benchmark_report_json().
+ *
+ * Usage: test-event-benchmark [DURATION] [N_SOURCES…]
+ */
+
+static usec_t arg_loop_usec = 100 * USEC_PER_MSEC;
+static bool arg_json = false;
+
+typedef struct Bench {
+        uint64_t n_dispatched;
+        usec_t *latencies;
+        size_t n_latencies;
+} Bench;
+
+static void bench_done(Bench *b) {
+        b->latencies = mfree(b->latencies);
+}
+
+static void bench_report(const char *type, unsigned n, Bench *b, usec_t duration) {
+        char p50[DECIMAL_STR_MAX(usec_t)] = "-", p99[DECIMAL_STR_MAX(usec_t)] = "-";
+
+        typesafe_qsort(b->latencies, b->n_latencies, uint64_compare_func);
+
+        if (arg_json) {
+                char parameter[DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(parameter, "%u", n);
+                assert_se(benchmark_report_json(type, parameter, b->n_dispatched, duration,
+                                                b->latencies, b->n_latencies, /* extra = */ NULL) >= 0);
+                return;
+        }
+
+        if (b->n_latencies > 0) {
+                xsprintf(p50, USEC_FMT, b->latencies[b->n_latencies / 2]);
+                xsprintf(p99, USEC_FMT, b->latencies[b->n_latencies * 99 / 100]);
+        }
+
+        printf("%s\t%u\t%" PRIu64 "\t%s\t%s\n",
+               type, n, b->n_dispatched * USEC_PER_SEC / MAX(duration, 1u), p50, p99);
+}
+
+static usec_t run_for(sd_event *e, usec_t duration, int (*step)(void *userdata), void *userdata) {
+        usec_t start, n;
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                if (step)
+                        assert_se(step(userdata) >= 0);
+
+                assert_se(sd_event_run(e, 0) >= 0);
+                n = now(CLOCK_MONOTONIC);
+        } while (n < start + duration);
+
+        return n - start;
+}
+
+static int count_io(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        Bench *b = ASSERT_PTR(userdata);
+
+        b->n_dispatched++;
+        return 0;
+}
+
+static void bench_io(unsigned n) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        Bench b = {};
+        usec_t d;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        /* An eventfd with a non-zero counter that is never read stays readable, i.e. every source is
+         * always ready */
+        for (unsigned i = 0; i < n; i++) {
+                _cleanup_close_ int fd = -EBADF;
+                sd_event_source *s;
+
+                fd = eventfd(1, EFD_CLOEXEC|EFD_NONBLOCK);
+                assert_se(fd >= 0);
+
+                assert_se(sd_event_add_io(e, &s, fd, EPOLLIN, count_io, &b) >= 0);
+                assert_se(sd_event_source_set_io_fd_own(s, true) >= 0);
+                assert_se(sd_event_source_set_floating(s, true) >= 0);
+                sd_event_source_unref(s);
+                TAKE_FD(fd);
+        }
+
+        d = run_for(e, arg_loop_usec, NULL, NULL);
+        bench_report("io", n, &b, d);
+}
+
+static int count_defer(sd_event_source *s, void *userdata) {
+        Bench *b = ASSERT_PTR(userdata);
+
+        b->n_dispatched++;
+        return 0;
+}
+
+static void bench_defer(unsigned n) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        Bench b = {};
+        usec_t d;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        for (unsigned i = 0; i < n; i++)
+                assert_se(sd_event_add_defer(e, NULL, count_defer, &b) >= 0);
+
+        d = run_for(e, arg_loop_usec, NULL, NULL);
+        bench_report("defer", n, &b, d);
+}
+
+static int count_timer(sd_event_source *s, uint64_t usec, void *userdata) {
+        Bench *b = ASSERT_PTR(userdata);
+        usec_t n;
+
+        n = now(CLOCK_MONOTONIC);
+        b->n_dispatched++;
+
+        if (GREEDY_REALLOC(b->latencies, b->n_latencies + 1))
+                b->latencies[b->n_latencies++] = usec_sub_unsigned(n, usec);
+
+        /* Re-arm within the next millisecond, spread out a bit */
+        assert_se(sd_event_source_set_time(s, n + b->n_dispatched % USEC_PER_MSEC) >= 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        return 0;
+}
+
+static void bench_timer(unsigned n) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_(bench_done) Bench b = {};
+        usec_t d, start;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        for (unsigned i = 0; i < n; i++)
+                assert_se(sd_event_add_time(e, NULL, CLOCK_MONOTONIC, start + i % USEC_PER_MSEC, 1, count_timer, &b) >= 0);
+
+        d = run_for(e, arg_loop_usec, NULL, NULL);
+        bench_report("timer", n, &b, d);
+}
+
+static int count_inotify(sd_event_source *s, const struct inotify_event *event, void *userdata) {
+        Bench *b = ASSERT_PTR(userdata);
+
+        b->n_dispatched++;
+        return 0;
+}
+
+static int touch_step(void *userdata) {
+        int *fd = ASSERT_PTR(userdata);
+
+        return RET_NERRNO(futimens(*fd, NULL));
+}
+
+static void bench_inotify(unsigned n) {
+        _cleanup_(rm_rf_physical_and_freep) char *p = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        _cleanup_free_ char *f = NULL;
+        Bench b = {};
+        usec_t d;
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(mkdtemp_malloc(NULL, &p) >= 0);
+
+        /* All sources watch the same file, hence share one inotify watch, and each touch of the file is
+         * dispatched to every one of them */
+        assert_se(f = path_join(p, "file"));
+        fd = open(f, O_CREAT|O_RDWR|O_CLOEXEC, 0600);
+        assert_se(fd >= 0);
+
+        for (unsigned i = 0; i < n; i++)
+                assert_se(sd_event_add_inotify(e, NULL, f, IN_ATTRIB, count_inotify, &b) >= 0);
+
+        d = run_for(e, arg_loop_usec, touch_step, &fd);
+        bench_report("inotify", n, &b, d);
+}
+
+static int count_child(sd_event_source *s, const siginfo_t *si, void *userdata) {
+        Bench *b = ASSERT_PTR(userdata);
+
+        b->n_dispatched++;
+        return 0;
+}
+
+static void bench_child(unsigned n, bool with_pidfd) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        Bench b = {};
+        usec_t start, d;
+
+        assert_se(setenv("SYSTEMD_PIDFD", yes_no(with_pidfd), 1) >= 0);
+        assert_se(sd_event_new(&e) >= 0);
+
+        /* Children are expensive, hence fork exactly the requested number and measure how long it takes to
+         * get all of them dispatched */
+        start = now(CLOCK_MONOTONIC);
+        for (unsigned i = 0; i < n; i++) {
+                sd_event_source *s;
+                pid_t pid;
+
+                pid = fork();
+                assert_se(pid >= 0);
+                if (pid == 0)
+                        _exit(EXIT_SUCCESS);
+
+                assert_se(sd_event_add_child(e, &s, pid, WEXITED, count_child, &b) >= 0);
+                assert_se(sd_event_source_set_child_process_own(s, true) >= 0);
+                assert_se(sd_event_source_set_floating(s, true) >= 0);
+                sd_event_source_unref(s);
+        }
+
+        while (b.n_dispatched < n)
+                assert_se(sd_event_run(e, USEC_INFINITY) >= 0);
+
+        d = now(CLOCK_MONOTONIC) - start;
+        bench_report(with_pidfd ? "child-pidfd" : "child-sigchld", n, &b, d);
+
+        assert_se(unsetenv("SYSTEMD_PIDFD") >= 0);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_free_ unsigned *counts = NULL;
+        size_t n_counts = 0;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                assert_se(parse_sec(argv[1], &arg_loop_usec) >= 0);
+        assert_se(arg_loop_usec > 0);
+
+        for (int i = 2; i < argc; i++) {
+                unsigned u;
+
+                assert_se(safe_atou(argv[i], &u) >= 0);
+                assert_se(u > 0);
+                assert_se(GREEDY_REALLOC(counts, n_counts + 1));
+                counts[n_counts++] = u;
+        }
+
+        if (n_counts == 0) {
+                assert_se(counts = newdup(unsigned, ((const unsigned[]) { 1, 10, 100, 1000 }), 4));
+                n_counts = 4;
+        }
+
+        (void) rlimit_nofile_bump(-1);
+
+        /* Needed for the non-pidfd child sources */
+        assert_se(sigprocmask_many(SIG_BLOCK, NULL, SIGCHLD) >= 0);
+
+        arg_json = benchmark_json_enabled();
+        if (!arg_json)
+                printf("type\tsources\tdispatches/s\tp50_usec\tp99_usec\n");
+
+        FOREACH_ARRAY(n, counts, n_counts) {
+                bench_io(*n);
+                bench_defer(*n);
+                bench_timer(*n);
+                bench_inotify(*n);
+                bench_child(*n, /* with_pidfd= */ true);
+                bench_child(*n, /* with_pidfd= */ false);
+        }
+
+        return 0;
+}
@@ -864,6 +864,160 @@ TEST(sd_event_source_set_io_fd) {
         TAKE_FD(pfd_b[0]);
 }
 
+static int read_byte_callback(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        unsigned *c = ASSERT_PTR(userdata);
+        char x;
+
+        assert_se(revents == EPOLLIN);
+        assert_se(read(fd, &x, 1) == 1);
+
+        (*c)++;
+        return 0;
+}
+
+TEST(io_oneshot_rearm) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_pair_ int pfd_a[2] = EBADF_PAIR, pfd_b[2] = EBADF_PAIR;
+        unsigned c = 0;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        assert_se(pipe2(pfd_a, O_CLOEXEC|O_NONBLOCK) >= 0);
+        assert_se(pipe2(pfd_b, O_CLOEXEC|O_NONBLOCK) >= 0);
+        assert_se(write(pfd_a[1], "aaaa", 4) == 4);
+        assert_se(write(pfd_b[1], "b", 1) == 1);
+
+        assert_se(sd_event_add_io(e, &s, pfd_a[0], EPOLLIN, read_byte_callback, &c) >= 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+
+        /* Each dispatch disables the source, and re-enabling it has to arm it again even though it was
+         * left in the epoll set */
+        for (unsigned i = 1; i <= 3; i++) {
+                assert_se(sd_event_run(e, 0) > 0);
+                assert_se(c == i);
+                assert_se(sd_event_source_get_enabled(s, NULL) == SD_EVENT_OFF);
+                assert_se(sd_event_run(e, 0) == 0);
+                assert_se(c == i);
+                assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        }
+
+        /* Switch to a different fd while the source is disabled after firing */
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(c == 4);
+        assert_se(sd_event_source_set_io_fd(s, pfd_b[0]) >= 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(c == 5);
+
+        /* A source switched from on to oneshot while enabled was registered without EPOLLONESHOT, hence
+         * must not be parked, or it would keep reporting the fd while disabled */
+        s = sd_event_source_unref(s);
+        assert_se(write(pfd_b[1], "bb", 2) == 2);
+        assert_se(sd_event_add_io(e, &s, pfd_b[0], EPOLLIN, read_byte_callback, &c) >= 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(c == 6);
+        assert_se(sd_event_source_get_enabled(s, NULL) == SD_EVENT_OFF);
+        assert_se(sd_event_run(e, 0) == 0);
+        assert_se(c == 6);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(c == 7);
+
+        /* Once freed, the fd must not linger in the epoll set, so that it can be added again */
+        s = sd_event_source_unref(s);
+        assert_se(write(pfd_b[1], "b", 1) == 1);
+        assert_se(sd_event_add_io(e, &s, pfd_b[0], EPOLLIN, read_byte_callback, &c) >= 0);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(c == 8);
+}
+
+TEST(batch_dispatch) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *a = NULL, *b = NULL, *c = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_pair_ int pfd_a[2] = EBADF_PAIR, pfd_b[2] = EBADF_PAIR, pfd_c[2] = EBADF_PAIR;
+        unsigned n = 0;
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_get_batch_dispatch(e) == 0);
+
+        assert_se(pipe2(pfd_a, O_CLOEXEC|O_NONBLOCK) >= 0);
+        assert_se(pipe2(pfd_b, O_CLOEXEC|O_NONBLOCK) >= 0);
+        assert_se(pipe2(pfd_c, O_CLOEXEC|O_NONBLOCK) >= 0);
+
+        assert_se(sd_event_add_io(e, &a, pfd_a[0], EPOLLIN, read_byte_callback, &n) >= 0);
+        assert_se(sd_event_add_io(e, &b, pfd_b[0], EPOLLIN, read_byte_callback, &n) >= 0);
+        assert_se(sd_event_add_io(e, &c, pfd_c[0], EPOLLIN, read_byte_callback, &n) >= 0);
+        assert_se(sd_event_source_set_priority(c, SD_EVENT_PRIORITY_IDLE) >= 0);
+
+        /* By default only a single source is dispatched per iteration */
+        assert_se(write(pfd_a[1], "a", 1) == 1);
+        assert_se(write(pfd_b[1], "b", 1) == 1);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(n == 1);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(n == 2);
+        assert_se(sd_event_run(e, 0) == 0);
+
+        /* In batch mode, all pending sources of the same priority are dispatched at once, but not the
+         * ones with a different priority */
+        assert_se(sd_event_set_batch_dispatch(e, true) > 0);
+        assert_se(sd_event_set_batch_dispatch(e, true) == 0);
+        assert_se(sd_event_get_batch_dispatch(e) > 0);
+
+        assert_se(write(pfd_a[1], "a", 1) == 1);
+        assert_se(write(pfd_b[1], "b", 1) == 1);
+        assert_se(write(pfd_c[1], "c", 1) == 1);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(n == 4);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(n == 5);
+        assert_se(sd_event_run(e, 0) == 0);
+
+        assert_se(sd_event_set_batch_dispatch(e, false) > 0);
+        assert_se(sd_event_get_batch_dispatch(e) == 0);
+}
+
+static int count_child_handler(sd_event_source *s, const siginfo_t *si, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        assert_se(si->si_code == CLD_EXITED);
+
+        (*n)++;
+        return 0;
+}
+
+TEST(batch_dispatch_child) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        unsigned n = 0;
+
+        assert_se(sigprocmask_many(SIG_BLOCK, NULL, SIGCHLD) >= 0);
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_set_batch_dispatch(e, true) > 0);
+
+        for (unsigned i = 0; i < 3; i++) {
+                siginfo_t si = {};
+                pid_t pid;
+
+                pid = fork();
+                assert_se(pid >= 0);
+                if (pid == 0)
+                        _exit(EXIT_SUCCESS);
+
+                /* Make sure the child is a zombie already, so that all of them are seen at once */
+                assert_se(waitid(P_PID, pid, &si, WEXITED|WNOWAIT) >= 0);
+
+                assert_se(sd_event_add_child(e, NULL, pid, WEXITED, count_child_handler, &n) >= 0);
+        }
+
+        /* All exited children are dispatched in a single iteration */
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(n == 3);
+        assert_se(sd_event_run(e, 0) == 0);
+}
+
 static int hup_callback(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
         unsigned *c = userdata;
 
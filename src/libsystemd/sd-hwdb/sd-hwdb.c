@@ -18,6 +18,7 @@
 #include "fileio.h"
 #include "hashmap.h"
 #include "hwdb-internal.h"
+#include "memory-util.h"
 #include "nulstr-util.h"
 #include "string-util.h"
 #include "time-util.h"
@@ -175,6 +176,40 @@ static int hwdb_add_property(sd_hwdb *hwdb, const struct trie_value_entry_f *ent
         return 0;
 }
 
+static bool linebuf_may_match(const struct linebuf *buf, const char *search) {
+        const char *star, *tail;
+        size_t n;
+
+        /* Checks whether any pattern starting with the contents of the buffer may match the search
+         * string. This is used to skip subtrees of glob nodes early, instead of visiting every node below
+         * and calling fnmatch() on it. For simplicity, brackets and escapes are not handled, any pattern
+         * containing them is assumed to possibly match. */
+
+        if (memchr(buf->bytes, '[', buf->len) || memchr(buf->bytes, '\\', buf->len))
+                return true;
+
+        star = memrchr(buf->bytes, '*', buf->len);
+        if (!star) {
+                /* Only literal characters and '?', hence each of them matches exactly one character */
+                for (size_t i = 0; i < buf->len; i++) {
+                        if (search[i] == '\0')
+                                return false;
+                        if (buf->bytes[i] != '?' && buf->bytes[i] != search[i])
+                                return false;
+                }
+
+                return true;
+        }
+
+        /* Whatever follows the last '*' has to show up somewhere in the search string */
+        tail = star + 1;
+        n = buf->bytes + buf->len - tail;
+        if (n == 0 || memchr(tail, '?', n))
+                return true;
+
+        return memmem_safe(search, strlen(search), tail, n);
+}
+
 static int trie_fnmatch_f(sd_hwdb *hwdb, const struct trie_node_f *node, size_t p,
                           struct linebuf *buf, const char *search) {
         size_t len;
@@ -186,6 +221,11 @@ static int trie_fnmatch_f(sd_hwdb *hwdb, const struct trie_node_f *node, size_t
         len = strlen(prefix + p);
         linebuf_add(buf, prefix + p, len);
 
+        if (!linebuf_may_match(buf, search)) {
+                linebuf_rem(buf, len);
+                return 0;
+        }
+
         for (i = 0; i < node->children_count; i++) {
                 const struct trie_child_entry_f *child = trie_node_child(hwdb, node, i);
 
@@ -76,8 +76,10 @@
 /* n_data was the first entry we added after the initial file format design */
 #define HEADER_SIZE_MIN ALIGN64(offsetof(Header, n_data))
 
-/* How many entries to keep in the entry array chain cache at max */
-#define CHAIN_CACHE_MAX 20
+/* How many entries to keep in the entry array chain cache at max. When appending, every field of an entry
+ * is an independent chain, and an entry carries around 25 of them, most of which have long chains only if
+ * their values are shared among many entries. Let's keep enough to cover a handful of interleaved writers. */
+#define CHAIN_CACHE_MAX 128
 
 /* How much to increase the journal file size at once each time we allocate something new. */
 #define FILE_SIZE_INCREASE (8 * U64_MB)                  /* 8MB */
@@ -292,6 +294,7 @@ JournalFile* journal_file_close(JournalFile *f) {
         free(f->path);
 
         ordered_hashmap_free_free(f->chain_cache);
+        hashmap_free_free(f->match_data_cache);
 
 #if HAVE_COMPRESSION
         free(f->compress_buffer);
@@ -2068,6 +2071,77 @@ static void write_entry_array_item(JournalFile *f, Object *o, uint64_t i, uint64
                 o->entry_array.items.regular[i] = htole64(p);
 }
 
+typedef struct ChainCacheItem {
+        uint64_t first; /* The offset of the entry array object at the beginning of the chain,
+                         * i.e., le64toh(f->header->entry_array_offset), or le64toh(o->data.entry_offset). */
+        uint64_t array; /* The offset of the cached entry array object. */
+        uint64_t begin; /* The offset of the first item in the cached array. */
+        uint64_t total; /* The total number of items in all arrays before the cached one in the chain. */
+        uint64_t last_index; /* The last index we looked at in the cached array, to optimize locality when bisecting. */
+} ChainCacheItem;
+
+static ChainCacheItem* chain_cache_get(OrderedHashmap *h, uint64_t first) {
+        ChainCacheItem *ci;
+
+        assert(h);
+
+        /* Looks up the cache item for the specified chain, and marks it as most recently used by moving it
+         * to the end, so that chain_cache_put() evicts the least recently used items first. */
+
+        ci = ordered_hashmap_remove(h, &first);
+        if (!ci)
+                return NULL;
+
+        if (ordered_hashmap_put(h, &ci->first, ci) < 0) {
+                free(ci);
+                return NULL;
+        }
+
+        return ci;
+}
+
+static void chain_cache_put(
+                OrderedHashmap *h,
+                ChainCacheItem *ci,
+                uint64_t first,
+                uint64_t array,
+                uint64_t begin,
+                uint64_t total,
+                uint64_t last_index) {
+
+        assert(h);
+
+        if (!ci) {
+                /* If the chain item to cache for this chain is the
+                 * first one it's not worth caching anything */
+                if (array == first)
+                        return;
+
+                if (ordered_hashmap_size(h) >= CHAIN_CACHE_MAX) {
+                        /* Recycle the least recently used item */
+                        ci = ordered_hashmap_steal_first(h);
+                        assert(ci);
+                } else {
+                        ci = new(ChainCacheItem, 1);
+                        if (!ci)
+                                return;
+                }
+
+                ci->first = first;
+
+                if (ordered_hashmap_put(h, &ci->first, ci) < 0) {
+                        free(ci);
+                        return;
+                }
+        } else
+                assert(ci->first == first);
+
+        ci->array = array;
+        ci->begin = begin;
+        ci->total = total;
+        ci->last_index = last_index;
+}
+
 static int link_entry_into_array(
                 JournalFile *f,
                 le64_t *first,
@@ -2076,7 +2150,8 @@ static int link_entry_into_array(
                 le32_t *tidx,
                 uint64_t p) {
 
-        uint64_t n = 0, ap = 0, q, i, a, hidx;
+        uint64_t n = 0, ap = 0, q, i, a, hidx, t = 0;
+        ChainCacheItem *ci = NULL;
         Object *o;
         int r;
 
@@ -2090,6 +2165,18 @@ static int link_entry_into_array(
         hidx = le64toh(READ_NOW(*idx));
         i = tidx ? le32toh(READ_NOW(*tidx)) : hidx;
 
+        if (!tail && a > 0) {
+                /* Without a tail pointer (i.e. in non-compact mode) we'd have to walk the whole chain for
+                 * each appended item to find its last array. Let's skip ahead using the chain cache, which
+                 * we keep pointing to the last array below. */
+                ci = chain_cache_get(f->chain_cache, a);
+                if (ci && i >= ci->total) {
+                        a = ci->array;
+                        i -= ci->total;
+                        t = ci->total;
+                }
+        }
+
         while (a > 0) {
                 r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &o);
                 if (r < 0)
@@ -2101,10 +2188,14 @@ static int link_entry_into_array(
                         *idx = htole64(hidx + 1);
                         if (tidx)
                                 *tidx = htole32(le32toh(*tidx) + 1);
+                        if (!tail)
+                                chain_cache_put(f->chain_cache, ci, le64toh(*first), a,
+                                                journal_file_entry_array_item(f, o, 0), t, i);
                         return 0;
                 }
 
                 i -= n;
+                t += n;
                 ap = a;
                 a = le64toh(o->entry_array.next_entry_array_offset);
         }
@@ -2143,6 +2234,8 @@ static int link_entry_into_array(
 
         if (tail)
                 *tail = htole32(q);
+        else if (ap != 0 && i == 0)
+                chain_cache_put(f->chain_cache, ci, le64toh(*first), q, p, t, i);
 
         if (JOURNAL_HEADER_CONTAINS(f->header, n_entry_arrays))
                 f->header->n_entry_arrays = htole64(le64toh(f->header->n_entry_arrays) + 1);
@@ -2516,7 +2609,7 @@ int journal_file_append_entry(
         EntryItem *items;
         uint64_t xor_hash = 0;
         struct dual_timestamp _ts;
-        sd_id128_t _boot_id, _machine_id, *machine_id;
+        sd_id128_t _boot_id, _machine_id, *machine_id = NULL;
         int r;
 
         assert(f);
@@ -2549,14 +2642,21 @@ int journal_file_append_entry(
                 boot_id = &_boot_id;
         }
 
-        r = sd_id128_get_machine(&_machine_id);
-        if (ERRNO_IS_NEG_MACHINE_ID_UNSET(r))
-                /* Gracefully handle the machine ID not being initialized yet */
-                machine_id = NULL;
-        else if (r < 0)
-                return r;
-        else
-                machine_id = &_machine_id;
+        /* The machine ID is only used to initialize the header field, hence don't bother once it is set.
+         * While the machine ID is not initialized yet (i.e. early during boot, when we log to /run/), each
+         * attempt means trying to read /etc/machine-id, hence retry at most once per second. */
+        if (sd_id128_is_null(f->header->machine_id) &&
+            (f->machine_id_checked_usec == 0 || now(CLOCK_MONOTONIC) >= usec_add(f->machine_id_checked_usec, USEC_PER_SEC))) {
+
+                r = sd_id128_get_machine(&_machine_id);
+                if (ERRNO_IS_NEG_MACHINE_ID_UNSET(r))
+                        /* Gracefully handle the machine ID not being initialized yet */
+                        f->machine_id_checked_usec = now(CLOCK_MONOTONIC);
+                else if (r < 0)
+                        return r;
+                else
+                        machine_id = &_machine_id;
+        }
 
 #if HAVE_GCRYPT
         r = journal_file_maybe_append_tag(f, ts->realtime);
@@ -2636,56 +2736,6 @@ int journal_file_append_entry(
         return r;
 }
 
-typedef struct ChainCacheItem {
-        uint64_t first; /* The offset of the entry array object at the beginning of the chain,
-                         * i.e., le64toh(f->header->entry_array_offset), or le64toh(o->data.entry_offset). */
-        uint64_t array; /* The offset of the cached entry array object. */
-        uint64_t begin; /* The offset of the first item in the cached array. */
-        uint64_t total; /* The total number of items in all arrays before the cached one in the chain. */
-        uint64_t last_index; /* The last index we looked at in the cached array, to optimize locality when bisecting. */
-} ChainCacheItem;
-
-static void chain_cache_put(
-                OrderedHashmap *h,
-                ChainCacheItem *ci,
-                uint64_t first,
-                uint64_t array,
-                uint64_t begin,
-                uint64_t total,
-                uint64_t last_index) {
-
-        assert(h);
-
-        if (!ci) {
-                /* If the chain item to cache for this chain is the
-                 * first one it's not worth caching anything */
-                if (array == first)
-                        return;
-
-                if (ordered_hashmap_size(h) >= CHAIN_CACHE_MAX) {
-                        ci = ordered_hashmap_steal_first(h);
-                        assert(ci);
-                } else {
-                        ci = new(ChainCacheItem, 1);
-                        if (!ci)
-                                return;
-                }
-
-                ci->first = first;
-
-                if (ordered_hashmap_put(h, &ci->first, ci) < 0) {
-                        free(ci);
-                        return;
-                }
-        } else
-                assert(ci->first == first);
-
-        ci->array = array;
-        ci->begin = begin;
-        ci->total = total;
-        ci->last_index = last_index;
-}
-
 static int bump_array_index(uint64_t *i, direction_t direction, uint64_t n) {
         assert(i);
 
@@ -2772,8 +2822,8 @@ static int generic_array_get(
         a = first;
 
         /* Try the chain cache first */
-        ci = ordered_hashmap_get(f->chain_cache, &first);
-        if (ci && i > ci->total) {
+        ci = chain_cache_get(f->chain_cache, first);
+        if (ci && i >= ci->total) {
                 a = ci->array;
                 i -= ci->total;
                 t = ci->total;
@@ -3013,7 +3063,7 @@ static int generic_array_bisect(
         /* Start with the first array in the chain */
         a = first;
 
-        ci = ordered_hashmap_get(f->chain_cache, &first);
+        ci = chain_cache_get(f->chain_cache, first);
         if (ci && n > ci->total && ci->begin != 0) {
                 /* Ah, we have iterated this bisection array chain previously! Let's see if we can skip ahead
                  * in the chain, as far as the last time. But we can't jump backwards in the chain, so let's
@@ -3344,6 +3394,20 @@ static int test_object_seqnum(JournalFile *f, uint64_t p, uint64_t needle) {
                 return TEST_RIGHT;
 }
 
+static bool seqnum_beyond_entries(uint64_t needle, uint64_t head, uint64_t tail, direction_t direction) {
+        /* Entries are strictly ordered by seqnum. Hence, if the needle lies after the last entry when
+         * looking downwards, or before the first entry when looking upwards, bisection cannot find anything.
+         * Checking this against the header avoids walking the whole entry array chain, which otherwise
+         * touches one entry array and one entry object per array in the chain. This matters when iterating
+         * through many files sharing the same seqnum ID, as is the case for journald's archived files:
+         * after the first step each file is positioned by seqnum, and most of them are out of range. */
+
+        if (head == 0 || tail == 0) /* No entries or old file, let's bisect. */
+                return false;
+
+        return direction == DIRECTION_DOWN ? needle > tail : needle < head;
+}
+
 int journal_file_move_to_entry_by_seqnum(
                 JournalFile *f,
                 uint64_t seqnum,
@@ -3354,6 +3418,12 @@ int journal_file_move_to_entry_by_seqnum(
         assert(f);
         assert(f->header);
 
+        if (seqnum_beyond_entries(seqnum,
+                                  le64toh(READ_NOW(f->header->head_entry_seqnum)),
+                                  le64toh(READ_NOW(f->header->tail_entry_seqnum)),
+                                  direction))
+                return 0;
+
         return generic_array_bisect(
                         f,
                         le64toh(f->header->entry_array_offset),
@@ -3507,6 +3577,44 @@ static bool check_properly_ordered(uint64_t new_offset, uint64_t old_offset, dir
                 new_offset < old_offset;
 }
 
+static void chain_cache_seed_tail(
+                JournalFile *f,
+                uint64_t first,   /* The offset of the first entry array object in the chain. */
+                uint64_t n,       /* The total number of items in the chain. */
+                uint32_t tail,    /* The offset of the last entry array object in the chain. */
+                uint32_t tail_n) { /* The number of items used in the last entry array object. */
+
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        /* Compact journal files record where the last array of each chain is and how many items it holds.
+         * If nothing is cached for the chain yet, let's use that to prime the chain cache, so that looking
+         * up the last entries of a chain does not require walking it from the beginning. Writers update the
+         * tail pointers and the item counters separately, hence only trust them for archived files, which
+         * are not modified anymore. */
+
+        if (f->header->state != STATE_ARCHIVED)
+                return;
+
+        if (first == 0 || tail == 0 || tail_n == 0 || tail_n > n)
+                return;
+
+        if (ordered_hashmap_contains(f->chain_cache, &first))
+                return;
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, tail, &o);
+        if (r < 0)
+                return;
+
+        if (journal_file_entry_array_n_items(f, o) < tail_n)
+                return;
+
+        chain_cache_put(f->chain_cache, NULL, first, tail, journal_file_entry_array_item(f, o, 0), n - tail_n, tail_n - 1);
+}
+
 int journal_file_next_entry(
                 JournalFile *f,
                 uint64_t p,
@@ -3528,12 +3636,19 @@ int journal_file_next_entry(
                 return 0;
 
         /* When the input offset 'p' is zero, return the first (or last on DIRECTION_UP) entry. */
-        if (p == 0)
+        if (p == 0) {
+                if (direction == DIRECTION_UP && JOURNAL_HEADER_CONTAINS(f->header, tail_entry_array_n_entries))
+                        chain_cache_seed_tail(f,
+                                              le64toh(f->header->entry_array_offset), n,
+                                              le32toh(f->header->tail_entry_array_offset),
+                                              le32toh(f->header->tail_entry_array_n_entries));
+
                 return generic_array_get(f,
                                          le64toh(f->header->entry_array_offset),
                                          direction == DIRECTION_DOWN ? 0 : n - 1,
                                          direction,
                                          ret_object, ret_offset);
+        }
 
         /* Otherwise, first find the nearest entry object. */
         r = generic_array_bisect(f,
@@ -3616,6 +3731,11 @@ int journal_file_move_to_entry_for_data(
         }
 
         if (n > 0) {
+                if (direction == DIRECTION_UP && JOURNAL_HEADER_COMPACT(f->header))
+                        chain_cache_seed_tail(f, first, n,
+                                              le32toh(d->data.compact.tail_entry_array_offset),
+                                              le32toh(d->data.compact.tail_entry_array_n_entries));
+
                 /* DIRECTION_DOWN : The extra entry is broken, falling back to the entries in the array.
                  * DIRECTION_UP   : Try to find a valid entry in the array from the tail. */
                 r = generic_array_get(f,
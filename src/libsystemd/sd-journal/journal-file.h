@@ -89,6 +89,9 @@ typedef struct JournalFile {
         sd_id128_t current_boot_id;
         uint64_t current_xor_hash;
 
+        /* When we last tried to read the machine ID for a file that doesn't have one in its header yet */
+        usec_t machine_id_checked_usec;
+
         JournalMetrics metrics;
 
         sd_event_source *post_change_timer;
@@ -96,6 +99,9 @@ typedef struct JournalFile {
 
         OrderedHashmap *chain_cache;
 
+        /* Used by sd-journal to remember which DATA objects its matches resolved to in this file */
+        Hashmap *match_data_cache;
+
         pthread_t offline_thread;
         volatile OfflineState offline_state;
 
@@ -143,9 +143,24 @@ int journal_get_directories(sd_journal *j, char ***ret);
 int journal_add_match_pair(sd_journal *j, const char *field, const char *value);
 int journal_add_matchf(sd_journal *j, const char *format, ...) _printf_(2, 3);
 
+typedef struct JournalEntryMetadata {
+        sd_id128_t seqnum_id;
+        uint64_t seqnum;
+        sd_id128_t boot_id;
+        usec_t realtime;
+        usec_t monotonic;
+} JournalEntryMetadata;
+
+int journal_get_entry_metadata(sd_journal *j, char **ret_cursor, JournalEntryMetadata *ret);
+
+int journal_enumerate_data_in_set(sd_journal *j, const Set *fields, const void **ret_data, size_t *ret_size);
+
 #define JOURNAL_FOREACH_DATA_RETVAL(j, data, l, retval)                     \
         for (sd_journal_restart_data(j); ((retval) = sd_journal_enumerate_data((j), &(data), &(l))) > 0; )
 
+#define JOURNAL_FOREACH_DATA_IN_SET_RETVAL(j, fields, data, l, retval)      \
+        for (sd_journal_restart_data(j); ((retval) = journal_enumerate_data_in_set((j), (fields), &(data), &(l))) > 0; )
+
 /* All errors that we might encounter while extracting a field that are not real errors,
  * but only mean that the field is too large or we don't support the compression. */
 static inline bool JOURNAL_ERRNO_IS_UNAVAILABLE_FIELD(int r) {
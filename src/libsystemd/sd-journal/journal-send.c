@@ -43,13 +43,24 @@
                 memcpy(*_f + 10, _func, _fl);     \
         } while (false)
 
+static const union sockaddr_union journal_socket_address = {
+        .un.sun_family = AF_UNIX,
+        .un.sun_path = "/run/systemd/journal/socket",
+};
+
 /* We open a single fd, and we'll share it with the current process,
  * all its threads, and all its subprocesses. This means we need to
  * initialize it atomically, and need to operate on it atomically
  * never assuming we are the only user */
 static int fd_plus_one = 0;
 
+/* Set if the fd is connected to the journal socket. In that case we don't need to pass the socket address
+ * with each message, which saves the kernel a path lookup per message. This is an optimization only: when
+ * not set (or not seen set yet by some thread), we simply pass the address along as before. */
+static bool fd_connected = false;
+
 static int journal_fd(void) {
+        bool connected;
         int fd;
 
 retry:
@@ -62,12 +73,18 @@ retry:
 
         fd_inc_sndbuf(fd, SNDBUF_SIZE);
 
+        /* If the journal is not around yet, this fails, and we stay unconnected. */
+        connected = connect(fd, &journal_socket_address.sa, SOCKADDR_UN_LEN(journal_socket_address.un)) >= 0;
+
         if (!__atomic_compare_exchange_n(&fd_plus_one, &(int){0}, fd+1,
                 false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
                 safe_close(fd);
                 goto retry;
         }
 
+        if (connected)
+                __atomic_store_n(&fd_connected, true, __ATOMIC_SEQ_CST);
+
         return fd;
 }
 
@@ -96,6 +113,7 @@ void close_journal_fd(void) {
 
         safe_close(fd_plus_one - 1);
         fd_plus_one = 0;
+        fd_connected = false;
 #endif
 }
 
@@ -224,13 +242,9 @@ _public_ int sd_journal_sendv(const struct iovec *iov, int n) {
         struct iovec *w;
         uint64_t *l;
         int i, j = 0;
-        static const union sockaddr_union sa = {
-                .un.sun_family = AF_UNIX,
-                .un.sun_path = "/run/systemd/journal/socket",
-        };
         struct msghdr mh = {
-                .msg_name = (struct sockaddr*) &sa.sa,
-                .msg_namelen = SOCKADDR_UN_LEN(sa.un),
+                .msg_name = (struct sockaddr*) &journal_socket_address.sa,
+                .msg_namelen = SOCKADDR_UN_LEN(journal_socket_address.un),
         };
         ssize_t k;
         bool have_syslog_identifier = false;
@@ -301,7 +315,24 @@ _public_ int sd_journal_sendv(const struct iovec *iov, int n) {
         mh.msg_iov = w;
         mh.msg_iovlen = j;
 
-        k = sendmsg(fd, &mh, MSG_NOSIGNAL);
+        if (__atomic_load_n(&fd_connected, __ATOMIC_SEQ_CST)) {
+                struct msghdr cmh = mh;
+
+                cmh.msg_name = NULL;
+                cmh.msg_namelen = 0;
+
+                k = sendmsg(fd, &cmh, MSG_NOSIGNAL);
+                if (k >= 0)
+                        return 0;
+
+                /* The journal socket we are connected to went away, e.g. because the socket unit got
+                 * restarted. Let's not bother reconnecting, and pass the address explicitly from now on. */
+                if (IN_SET(errno, ECONNREFUSED, ENOTCONN)) {
+                        __atomic_store_n(&fd_connected, false, __ATOMIC_SEQ_CST);
+                        k = sendmsg(fd, &mh, MSG_NOSIGNAL);
+                }
+        } else
+                k = sendmsg(fd, &mh, MSG_NOSIGNAL);
         if (k >= 0)
                 return 0;
 
@@ -453,20 +453,18 @@ static int verify_data(
         /* We already checked that earlier */
         assert(o->data.entry_offset);
 
+        /* Note that we do not need to look up the referenced entries in the main entry array here:
+         * verify_entry_array() ran before us and made sure the main entry array consists of exactly the
+         * (sorted, unique) entry objects we found during the linear scan, i.e. the ones the cache_entry_fd
+         * bisection below checks against. Bisecting the (much larger) main entry array chain again for
+         * every single reference used to dominate the runtime on big files. */
+
         last = q = le64toh(o->data.entry_offset);
         if (!contains_uint64(cache_entry_fd, n_entries, q)) {
                 error(p, "Data object references invalid entry at "OFSfmt, q);
                 return -EBADMSG;
         }
 
-        r = journal_file_move_to_entry_by_offset(f, q, DIRECTION_DOWN, NULL, NULL);
-        if (r < 0)
-                return r;
-        if (r == 0) {
-                error(q, "Entry object doesn't exist in the main entry array");
-                return -EBADMSG;
-        }
-
         i = 1;
         while (i < n) {
                 uint64_t next, m, j;
@@ -505,19 +503,6 @@ static int verify_data(
                                 error(p, "Data object references invalid entry at "OFSfmt, q);
                                 return -EBADMSG;
                         }
-
-                        r = journal_file_move_to_entry_by_offset(f, q, DIRECTION_DOWN, NULL, NULL);
-                        if (r < 0)
-                                return r;
-                        if (r == 0) {
-                                error(q, "Entry object doesn't exist in the main entry array");
-                                return -EBADMSG;
-                        }
-
-                        /* Pointer might have moved, reposition */
-                        r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &o);
-                        if (r < 0)
-                                return r;
                 }
 
                 a = next;
@@ -49,6 +49,12 @@ struct MMapFileDescriptor {
         int prot;
         bool sigbus;
 
+        /* The range of the most recently created window, and how many windows in a row were created each
+         * right after the previous one, to detect sequential scans. */
+        uint64_t last_window_offset;
+        uint64_t last_window_end;
+        unsigned n_sequential;
+
         LIST_HEAD(Window, windows);
 };
 
@@ -72,6 +78,9 @@ struct MMapCache {
 #define WINDOWS_MIN 64
 #define UNUSED_MIN 4
 
+/* After how many consecutive sequential windows we start asking the kernel to read ahead */
+#define SEQUENTIAL_MIN 2
+
 #if ENABLE_DEBUG_MMAP_CACHE
 /* Tiny windows increase mmap activity and the chance of exposing unsafe use. */
 # define WINDOW_SIZE (page_size())
@@ -331,6 +340,21 @@ static int add_mmap(
                 return -ENOMEM;
         }
 
+        /* Windows are centered around the requested offset, hence when a file is scanned sequentially the
+         * next window starts within, or right after, the previous one, while bisection jumps around. If we
+         * detect a sequential scan, ask the kernel to read in the whole window asynchronously, instead of
+         * faulting it in piecemeal while we walk through it. */
+        if (offset > f->last_window_offset && offset <= f->last_window_end)
+                f->n_sequential++;
+        else
+                f->n_sequential = 0;
+
+        f->last_window_offset = offset;
+        f->last_window_end = offset + size;
+
+        if (f->n_sequential >= SEQUENTIAL_MIN)
+                (void) madvise(d, size, MADV_WILLNEED);
+
         *ret = w;
         return 0;
 }
@@ -439,6 +463,15 @@ void mmap_cache_stats_log_debug(MMapCache *m) {
                   m->n_category_cache_hit, m->n_window_list_hit, m->n_missed, hashmap_size(m->fds), m->n_windows, m->n_unused);
 }
 
+void mmap_cache_stats(MMapCache *m, unsigned *ret_hit, unsigned *ret_missed) {
+        assert(m);
+
+        if (ret_hit)
+                *ret_hit = m->n_category_cache_hit + m->n_window_list_hit;
+        if (ret_missed)
+                *ret_missed = m->n_missed;
+}
+
 static void mmap_cache_process_sigbus(MMapCache *m) {
         bool found = false;
         MMapFileDescriptor *f;
@@ -56,5 +56,6 @@ MMapCache* mmap_cache_fd_cache(MMapFileDescriptor *f);
 MMapFileDescriptor* mmap_cache_fd_free(MMapFileDescriptor *f);
 
 void mmap_cache_stats_log_debug(MMapCache *m);
+void mmap_cache_stats(MMapCache *m, unsigned *ret_hit, unsigned *ret_missed);
 
 bool mmap_cache_fd_got_sigbus(MMapFileDescriptor *f);
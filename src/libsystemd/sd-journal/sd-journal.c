@@ -54,6 +54,9 @@
 
 #define DEFAULT_DATA_THRESHOLD (64*1024)
 
+/* How many resolved matches to remember per journal file */
+#define MATCH_DATA_CACHE_MAX 64U
+
 DEFINE_PRIVATE_ORIGIN_ID_HELPERS(sd_journal, journal);
 
 static void remove_file_real(sd_journal *j, JournalFile *f);
@@ -665,6 +668,99 @@ static int compare_with_location(
         return 0;
 }
 
+typedef struct MatchDataCacheItem {
+        uint64_t hash;   /* The jenkins hash of the payload, i.e. Match.hash, used as key */
+        uint64_t offset; /* The offset of the DATA object, or 0 if the file is known not to contain it */
+        size_t size;
+        uint8_t data[];
+} MatchDataCacheItem;
+
+static void match_data_cache_put(JournalFile *f, Match *m, uint64_t offset) {
+        _cleanup_free_ MatchDataCacheItem *ci = NULL;
+
+        assert(f);
+        assert(m);
+
+        if (hashmap_size(f->match_data_cache) >= MATCH_DATA_CACHE_MAX)
+                return;
+
+        ci = malloc(offsetof(MatchDataCacheItem, data) + m->size);
+        if (!ci)
+                return;
+
+        ci->hash = m->hash;
+        ci->offset = offset;
+        ci->size = m->size;
+        memcpy_safe(ci->data, m->data, m->size);
+
+        if (hashmap_ensure_put(&f->match_data_cache, &uint64_hash_ops, &ci->hash, ci) < 0)
+                return;
+
+        TAKE_PTR(ci);
+}
+
+static int find_data_object_for_match(
+                JournalFile *f,
+                Match *m,
+                Object **ret_object,
+                uint64_t *ret_offset) {
+
+        MatchDataCacheItem *ci;
+        uint64_t hash, dp;
+        Object *d;
+        int r;
+
+        assert(f);
+        assert(m);
+        assert(m->type == MATCH_DISCRETE);
+
+        /* Resolving a match requires hashing the payload, walking the hash chain of the data hash table and
+         * possibly decompressing candidate payloads, and we do so for every file on each step of the
+         * iteration. Hence remember the result per file: once written, DATA objects never move, so a found
+         * offset stays valid for the lifetime of the file. That the file does not contain the data at all
+         * can only be remembered for archived files however, since those are never written to again. */
+
+        ci = hashmap_get(f->match_data_cache, &m->hash);
+        if (ci && memcmp_nn(ci->data, ci->size, m->data, m->size) == 0) {
+                if (ci->offset == 0)
+                        return 0;
+
+                r = journal_file_move_to_object(f, OBJECT_DATA, ci->offset, ret_object);
+                if (r < 0)
+                        return r;
+
+                if (ret_offset)
+                        *ret_offset = ci->offset;
+
+                return 1;
+        }
+
+        /* If the keyed hash logic is used, we need to calculate the hash fresh per file. Otherwise
+         * we can use what we pre-calculated. */
+        if (JOURNAL_HEADER_KEYED_HASH(f->header))
+                hash = journal_file_hash_data(f, m->data, m->size);
+        else
+                hash = m->hash;
+
+        r = journal_file_find_data_object_with_hash(f, m->data, m->size, hash, &d, &dp);
+        if (r < 0)
+                return r;
+
+        /* On a hash collision with another cached match, simply don't cache this one. */
+        if (!ci && (r > 0 || f->header->state == STATE_ARCHIVED))
+                match_data_cache_put(f, m, r > 0 ? dp : 0);
+
+        if (r == 0)
+                return 0;
+
+        if (ret_object)
+                *ret_object = d;
+        if (ret_offset)
+                *ret_offset = dp;
+
+        return 1;
+}
+
 static int next_for_match(
                 sd_journal *j,
                 Match *m,
@@ -683,16 +779,8 @@ static int next_for_match(
 
         if (m->type == MATCH_DISCRETE) {
                 Object *d;
-                uint64_t hash;
 
-                /* If the keyed hash logic is used, we need to calculate the hash fresh per file. Otherwise
-                 * we can use what we pre-calculated. */
-                if (JOURNAL_HEADER_KEYED_HASH(f->header))
-                        hash = journal_file_hash_data(f, m->data, m->size);
-                else
-                        hash = m->hash;
-
-                r = journal_file_find_data_object_with_hash(f, m->data, m->size, hash, &d, NULL);
+                r = find_data_object_for_match(f, m, &d, NULL);
                 if (r <= 0)
                         return r;
 
@@ -828,14 +916,9 @@ static int find_location_for_match(
 
         if (m->type == MATCH_DISCRETE) {
                 Object *d;
-                uint64_t dp, hash;
+                uint64_t dp;
 
-                if (JOURNAL_HEADER_KEYED_HASH(f->header))
-                        hash = journal_file_hash_data(f, m->data, m->size);
-                else
-                        hash = m->hash;
-
-                r = journal_file_find_data_object_with_hash(f, m->data, m->size, hash, &d, &dp);
+                r = find_data_object_for_match(f, m, &d, &dp);
                 if (r <= 0)
                         return r;
 
@@ -1234,6 +1317,22 @@ _public_ int sd_journal_previous_skip(sd_journal *j, uint64_t skip) {
         return real_journal_next_skip(j, DIRECTION_UP, skip);
 }
 
+static int format_cursor(JournalFile *f, Object *o, char **ret) {
+        assert(f);
+        assert(o);
+        assert(ret);
+
+        if (asprintf(ret,
+                     "s=%s;i=%"PRIx64";b=%s;m=%"PRIx64";t=%"PRIx64";x=%"PRIx64,
+                     SD_ID128_TO_STRING(f->header->seqnum_id), le64toh(o->entry.seqnum),
+                     SD_ID128_TO_STRING(o->entry.boot_id), le64toh(o->entry.monotonic),
+                     le64toh(o->entry.realtime),
+                     le64toh(o->entry.xor_hash)) < 0)
+                return -ENOMEM;
+
+        return 0;
+}
+
 _public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
         Object *o;
         int r;
@@ -1249,13 +1348,50 @@ _public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
         if (r < 0)
                 return r;
 
-        if (asprintf(cursor,
-                     "s=%s;i=%"PRIx64";b=%s;m=%"PRIx64";t=%"PRIx64";x=%"PRIx64,
-                     SD_ID128_TO_STRING(j->current_file->header->seqnum_id), le64toh(o->entry.seqnum),
-                     SD_ID128_TO_STRING(o->entry.boot_id), le64toh(o->entry.monotonic),
-                     le64toh(o->entry.realtime),
-                     le64toh(o->entry.xor_hash)) < 0)
-                return -ENOMEM;
+        return format_cursor(j->current_file, o, cursor);
+}
+
+int journal_get_entry_metadata(sd_journal *j, char **ret_cursor, JournalEntryMetadata *ret) {
+        JournalFile *f;
+        Object *o;
+        int r;
+
+        assert(j);
+        assert(ret);
+
+        /* Returns the cursor, timestamps and sequence number of the current entry in one go. This is
+         * equivalent to calling sd_journal_get_cursor(), sd_journal_get_realtime_usec(),
+         * sd_journal_get_monotonic_usec() and sd_journal_get_seqnum() in a row, but looks up the entry
+         * object only once, which matters for the export and JSON output modes that want all of them for
+         * every single entry. */
+
+        f = j->current_file;
+        if (!f)
+                return -EADDRNOTAVAIL;
+        if (f->current_offset <= 0)
+                return -EADDRNOTAVAIL;
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+        if (r < 0)
+                return r;
+
+        uint64_t realtime = le64toh(o->entry.realtime), monotonic = le64toh(o->entry.monotonic);
+        if (!VALID_REALTIME(realtime) || !VALID_MONOTONIC(monotonic))
+                return -EBADMSG;
+
+        if (ret_cursor) {
+                r = format_cursor(f, o, ret_cursor);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = (JournalEntryMetadata) {
+                .seqnum_id = f->header->seqnum_id,
+                .seqnum = le64toh(o->entry.seqnum),
+                .boot_id = o->entry.boot_id,
+                .realtime = realtime,
+                .monotonic = monotonic,
+        };
 
         return 0;
 }
@@ -2605,15 +2741,23 @@ static int journal_file_read_tail_timestamp(sd_journal *j, JournalFile *f) {
         if (offset == f->newest_entry_offset)
                 return 0; /* No new entry is added after we read last time. */
 
-        /* Move to the last object in the journal file, in the hope it is an entry (which it usually will
-         * be). If we lack the "tail_entry_offset" field in the header, we specify the type as OBJECT_UNUSED
-         * here, since we cannot be sure what the last object will be, and want no noisy logging if it isn't
-         * an entry. We instead check after figuring out the pointer. */
-        r = journal_file_move_to_object(f, type, offset, &o);
-        if (r < 0) {
-                log_debug_errno(r, "Failed to move to last object in journal file, ignoring: %m");
+        if (JOURNAL_HEADER_TAIL_ENTRY_BOOT_ID(f->header) && f->header->state == STATE_ARCHIVED)
+                /* The header of archived files is final, and with the flag set the tail timestamps in it
+                 * match the tail boot ID, see below. Hence don't bother with looking at the last entry at
+                 * all, which saves us a page fault for each archived file, i.e. for the vast majority of
+                 * the files we typically open. */
                 o = NULL;
-                offset = 0;
+        else {
+                /* Move to the last object in the journal file, in the hope it is an entry (which it usually
+                 * will be). If we lack the "tail_entry_offset" field in the header, we specify the type as
+                 * OBJECT_UNUSED here, since we cannot be sure what the last object will be, and want no
+                 * noisy logging if it isn't an entry. We instead check after figuring out the pointer. */
+                r = journal_file_move_to_object(f, type, offset, &o);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to move to last object in journal file, ignoring: %m");
+                        o = NULL;
+                        offset = 0;
+                }
         }
         if (o && o->object.type == OBJECT_ENTRY) {
                 /* Yay, last object is an entry, let's use the data. */
@@ -2903,6 +3047,83 @@ _public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t
         return 0;
 }
 
+int journal_enumerate_data_in_set(sd_journal *j, const Set *fields, const void **ret_data, size_t *ret_size) {
+        JournalFile *f;
+        Object *o;
+        int r;
+
+        assert(j);
+        assert(ret_data);
+        assert(ret_size);
+
+        /* Like sd_journal_enumerate_data(), but only returns the fields whose names are contained in the
+         * specified set. The field name is checked before the payload is decompressed, so that large
+         * compressed blobs of other fields (think COREDUMP=) are never decompressed in full. */
+
+        if (!fields)
+                return sd_journal_enumerate_data(j, ret_data, ret_size);
+
+        f = j->current_file;
+        if (!f)
+                return -EADDRNOTAVAIL;
+
+        if (f->current_offset <= 0)
+                return -EADDRNOTAVAIL;
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+        if (r < 0)
+                return r;
+
+        for (uint64_t n = journal_file_entry_n_items(f, o); j->current_field < n; j->current_field++) {
+                const char *field;
+                Object *d;
+                uint64_t p;
+                void *data;
+                size_t l;
+
+                p = journal_file_entry_item_object_offset(f, o, j->current_field);
+                r = journal_file_move_to_object(f, OBJECT_DATA, p, &d);
+                if (r >= 0) {
+                        if (COMPRESSION_FROM_OBJECT(d) == COMPRESSION_NONE) {
+                                const char *eq;
+
+                                r = journal_file_data_payload(f, d, p, NULL, 0, j->data_threshold, &data, &l);
+                                if (r > 0) {
+                                        eq = memchr(data, '=', l);
+                                        if (!eq ||
+                                            !journal_field_valid(data, eq - (const char*) data, true) ||
+                                            !set_contains(fields, strndupa_safe(data, eq - (const char*) data)))
+                                                r = 0;
+                                }
+                        } else {
+                                r = 0;
+                                SET_FOREACH(field, fields) {
+                                        r = journal_file_data_payload(f, d, p, field, strlen(field), j->data_threshold, &data, &l);
+                                        if (r != 0)
+                                                break;
+                                }
+                        }
+                }
+                if (r == 0)
+                        continue;
+                if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG)) {
+                        log_debug_errno(r, "Entry item %"PRIu64" data object is bad, skipping over it: %m", j->current_field);
+                        continue;
+                }
+                if (r < 0)
+                        return r;
+
+                *ret_data = data;
+                *ret_size = l;
+
+                j->current_field++;
+
+                return 1;
+        }
+
+        return 0;
+}
+
 _public_ int sd_journal_enumerate_available_data(sd_journal *j, const void **data, size_t *size) {
         for (;;) {
                 int r;
@@ -1320,6 +1320,45 @@ TEST(seek_time) {
         }
 }
 
+TEST(tail_with_matches_archived) {
+        _cleanup_(test_donep) char *t = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        JournalFile *f;
+        sd_id128_t id;
+
+        mkdtemp_chdir_chattr("/var/tmp/journal-tail-XXXXXX", &t);
+
+        /* Enough entries for the chains of the main entry array and of LESS_THAN_FIVE=no to span several
+         * entry array objects. Archive the file, so that looking for the last entries may start from the
+         * tail pointers stored in the header and in the data objects. */
+        f = test_open("one.journal");
+        ASSERT_OK(sd_id128_randomize(&id));
+        for (unsigned i = 1; i <= 1000; i++)
+                append_number(f, i, &id, NULL, NULL);
+        ASSERT_OK(journal_file_archive(f, NULL));
+        journal_file_offline_close(f);
+
+        ASSERT_OK(sd_journal_open_directory(&j, t, SD_JOURNAL_ASSUME_IMMUTABLE));
+
+        ASSERT_OK(sd_journal_seek_tail(j));
+        ASSERT_OK_POSITIVE(sd_journal_previous(j));
+        test_check_numbers_up(j, 1000);
+
+        ASSERT_OK(sd_journal_add_match(j, "LESS_THAN_FIVE=no", SIZE_MAX));
+        ASSERT_OK(sd_journal_seek_tail(j));
+        for (unsigned i = 1000; i >= 5; i--) {
+                ASSERT_OK_POSITIVE(sd_journal_previous(j));
+                test_check_number(j, i);
+        }
+        ASSERT_OK_ZERO(sd_journal_previous(j));
+
+        sd_journal_flush_matches(j);
+        ASSERT_OK(sd_journal_add_match(j, "LESS_THAN_FIVE=yes", SIZE_MAX));
+        ASSERT_OK(sd_journal_seek_tail(j));
+        ASSERT_OK_POSITIVE(sd_journal_previous(j));
+        test_check_numbers_up(j, 4);
+}
+
 static int intro(void) {
         /* journal_file_open() requires a valid machine id */
         if (access("/etc/machine-id", F_OK) != 0)
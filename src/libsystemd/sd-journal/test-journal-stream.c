@@ -14,6 +14,8 @@
 #include "macro.h"
 #include "parse-util.h"
 #include "rm-rf.h"
+#include "set.h"
+#include "string-util.h"
 #include "tests.h"
 
 #define N_ENTRIES 200
@@ -64,6 +66,7 @@ static void run_test(void) {
         char t[] = "/var/tmp/journal-stream-XXXXXX";
         unsigned i;
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_set_free_ Set *fields = NULL;
         char *z;
         const void *data;
         size_t l;
@@ -172,6 +175,43 @@ static void run_test(void) {
         SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
                 printf("%.*s\n", (int) l, (const char*) data);
 
+        printf("NEXT TEST\n");
+        sd_journal_flush_matches(j);
+        assert_se(set_put_strdup(&fields, "MAGIC") >= 0);
+
+        SD_JOURNAL_FOREACH(j) {
+                unsigned n = 0;
+                int r;
+
+                JOURNAL_FOREACH_DATA_IN_SET_RETVAL(j, fields, data, l, r) {
+                        assert_se(memory_startswith(data, l, "MAGIC="));
+                        n++;
+                }
+                assert_se(r >= 0);
+                assert_se(n == 1);
+        }
+
+        printf("NEXT TEST\n");
+        SD_JOURNAL_FOREACH(j) {
+                _cleanup_free_ char *c1 = NULL, *c2 = NULL;
+                JournalEntryMetadata md;
+                sd_id128_t boot_id, seqnum_id;
+                uint64_t realtime, monotonic, seqnum;
+
+                assert_se(journal_get_entry_metadata(j, &c1, &md) >= 0);
+                assert_se(sd_journal_get_cursor(j, &c2) >= 0);
+                assert_se(sd_journal_get_realtime_usec(j, &realtime) >= 0);
+                assert_se(sd_journal_get_monotonic_usec(j, &monotonic, &boot_id) >= 0);
+                assert_se(sd_journal_get_seqnum(j, &seqnum, &seqnum_id) >= 0);
+
+                assert_se(streq(c1, c2));
+                assert_se(md.realtime == realtime);
+                assert_se(md.monotonic == monotonic);
+                assert_se(md.seqnum == seqnum);
+                assert_se(sd_id128_equal(md.boot_id, boot_id));
+                assert_se(sd_id128_equal(md.seqnum_id, seqnum_id));
+        }
+
         assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
 }
 
@@ -0,0 +1,354 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <string.h>
+
+#include "sd-json.h"
+
+#include "alloc-util.h"
+#include "json-cbor.h"
+#include "macro.h"
+#include "memory-util.h"
+#include "unaligned.h"
+
+/* Same nesting limit the JSON text parser enforces */
+#define CBOR_DEPTH_MAX (2U*1024U)
+
+enum {
+        CBOR_MAJOR_UNSIGNED = 0,
+        CBOR_MAJOR_NEGATIVE = 1,
+        CBOR_MAJOR_TEXT     = 3,
+        CBOR_MAJOR_ARRAY    = 4,
+        CBOR_MAJOR_MAP      = 5,
+        CBOR_MAJOR_SIMPLE   = 7,
+};
+
+enum {
+        CBOR_SIMPLE_FALSE  = 20,
+        CBOR_SIMPLE_TRUE   = 21,
+        CBOR_SIMPLE_NULL   = 22,
+        CBOR_SIMPLE_FLOAT  = 26,
+        CBOR_SIMPLE_DOUBLE = 27,
+};
+
+static size_t cbor_head_size(uint64_t arg) {
+        return arg < 24 ? 1 :
+               arg <= UINT8_MAX ? 2 :
+               arg <= UINT16_MAX ? 3 :
+               arg <= UINT32_MAX ? 5 : 9;
+}
+
+static uint8_t* cbor_write_head(uint8_t *p, unsigned major, uint64_t arg) {
+        assert(p);
+        assert(major < 8);
+
+        major <<= 5;
+
+        if (arg < 24)
+                *(p++) = major | arg;
+        else if (arg <= UINT8_MAX) {
+                *(p++) = major | 24;
+                *(p++) = arg;
+        } else if (arg <= UINT16_MAX) {
+                *(p++) = major | 25;
+                unaligned_write_be16(p, arg);
+                p += 2;
+        } else if (arg <= UINT32_MAX) {
+                *(p++) = major | 26;
+                unaligned_write_be32(p, arg);
+                p += 4;
+        } else {
+                *(p++) = major | 27;
+                unaligned_write_be64(p, arg);
+                p += 8;
+        }
+
+        return p;
+}
+
+size_t json_variant_cbor_size(sd_json_variant *v) {
+        size_t n, sz;
+
+        switch (sd_json_variant_type(v)) {
+
+        case SD_JSON_VARIANT_STRING:
+                n = strlen(sd_json_variant_string(v));
+                return cbor_head_size(n) + n;
+
+        case SD_JSON_VARIANT_INTEGER: {
+                int64_t i = sd_json_variant_integer(v);
+
+                return cbor_head_size(i >= 0 ? (uint64_t) i : (uint64_t) -(i + 1));
+        }
+
+        case SD_JSON_VARIANT_UNSIGNED:
+                return cbor_head_size(sd_json_variant_unsigned(v));
+
+        case SD_JSON_VARIANT_REAL:
+                return 1 + sizeof(uint64_t);
+
+        case SD_JSON_VARIANT_BOOLEAN:
+        case SD_JSON_VARIANT_NULL:
+                return 1;
+
+        case SD_JSON_VARIANT_ARRAY:
+        case SD_JSON_VARIANT_OBJECT:
+                n = sd_json_variant_elements(v);
+                sz = cbor_head_size(sd_json_variant_is_object(v) ? n / 2 : n);
+
+                for (size_t i = 0; i < n; i++)
+                        sz += json_variant_cbor_size(sd_json_variant_by_index(v, i));
+
+                return sz;
+
+        default:
+                assert_not_reached();
+        }
+}
+
+void* json_variant_write_cbor(sd_json_variant *v, void *buf) {
+        uint8_t *p = ASSERT_PTR(buf);
+        size_t n;
+
+        /* Serializes the variant into the specified buffer, which must be at least json_variant_cbor_size()
+         * bytes long. Returns a pointer right behind the written data. */
+
+        switch (sd_json_variant_type(v)) {
+
+        case SD_JSON_VARIANT_STRING: {
+                const char *s = sd_json_variant_string(v);
+
+                n = strlen(s);
+                p = cbor_write_head(p, CBOR_MAJOR_TEXT, n);
+                return mempcpy(p, s, n);
+        }
+
+        case SD_JSON_VARIANT_INTEGER: {
+                int64_t i = sd_json_variant_integer(v);
+
+                if (i >= 0)
+                        return cbor_write_head(p, CBOR_MAJOR_UNSIGNED, i);
+
+                return cbor_write_head(p, CBOR_MAJOR_NEGATIVE, (uint64_t) -(i + 1));
+        }
+
+        case SD_JSON_VARIANT_UNSIGNED:
+                return cbor_write_head(p, CBOR_MAJOR_UNSIGNED, sd_json_variant_unsigned(v));
+
+        case SD_JSON_VARIANT_REAL: {
+                double d = sd_json_variant_real(v);
+                uint64_t u;
+
+                memcpy(&u, &d, sizeof(u));
+
+                *(p++) = CBOR_MAJOR_SIMPLE << 5 | CBOR_SIMPLE_DOUBLE;
+                unaligned_write_be64(p, u);
+                return p + sizeof(u);
+        }
+
+        case SD_JSON_VARIANT_BOOLEAN:
+                *(p++) = CBOR_MAJOR_SIMPLE << 5 | (sd_json_variant_boolean(v) ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+                return p;
+
+        case SD_JSON_VARIANT_NULL:
+                *(p++) = CBOR_MAJOR_SIMPLE << 5 | CBOR_SIMPLE_NULL;
+                return p;
+
+        case SD_JSON_VARIANT_ARRAY:
+        case SD_JSON_VARIANT_OBJECT:
+                n = sd_json_variant_elements(v);
+
+                if (sd_json_variant_is_object(v))
+                        p = cbor_write_head(p, CBOR_MAJOR_MAP, n / 2);
+                else
+                        p = cbor_write_head(p, CBOR_MAJOR_ARRAY, n);
+
+                for (size_t i = 0; i < n; i++)
+                        p = json_variant_write_cbor(sd_json_variant_by_index(v, i), p);
+
+                return p;
+
+        default:
+                assert_not_reached();
+        }
+}
+
+static int cbor_read_head(const uint8_t **p, const uint8_t *end, unsigned *ret_major, unsigned *ret_info, uint64_t *ret_arg) {
+        unsigned major, info;
+        uint64_t arg;
+        size_t n;
+
+        assert(p && *p);
+        assert(end);
+        assert(ret_major);
+        assert(ret_info);
+        assert(ret_arg);
+
+        if (*p >= end)
+                return -EBADMSG;
+
+        major = **p >> 5;
+        info = **p & 31;
+        (*p)++;
+
+        if (info < 24) {
+                arg = info;
+                n = 0;
+        } else if (info <= 27)
+                n = 1U << (info - 24);
+        else /* Indefinite lengths and reserved values are not supported */
+                return -EBADMSG;
+
+        if ((size_t) (end - *p) < n)
+                return -EBADMSG;
+
+        switch (n) {
+        case 1:
+                arg = **p;
+                break;
+        case 2:
+                arg = unaligned_read_be16(*p);
+                break;
+        case 4:
+                arg = unaligned_read_be32(*p);
+                break;
+        case 8:
+                arg = unaligned_read_be64(*p);
+                break;
+        }
+
+        *ret_major = major;
+        *ret_info = info;
+        *ret_arg = arg;
+        *p += n;
+        return 0;
+}
+
+static int cbor_parse(const uint8_t **p, const uint8_t *end, unsigned depth, sd_json_variant **ret) {
+        unsigned major, info;
+        uint64_t arg;
+        int r;
+
+        assert(p);
+        assert(end);
+        assert(ret);
+
+        if (depth >= CBOR_DEPTH_MAX)
+                return -ELNRNG;
+
+        r = cbor_read_head(p, end, &major, &info, &arg);
+        if (r < 0)
+                return r;
+
+        switch (major) {
+
+        case CBOR_MAJOR_UNSIGNED: /* Like the JSON text parser, turn non-negative numbers into unsigned variants */
+                return sd_json_variant_new_unsigned(ret, arg);
+
+        case CBOR_MAJOR_NEGATIVE:
+                if (arg > INT64_MAX)
+                        return -ERANGE;
+
+                return sd_json_variant_new_integer(ret, -(int64_t) arg - 1);
+
+        case CBOR_MAJOR_TEXT:
+                if (arg > (uint64_t) (end - *p))
+                        return -EBADMSG;
+
+                r = sd_json_variant_new_stringn(ret, (const char*) *p, arg);
+                if (r < 0)
+                        return r;
+
+                *p += arg;
+                return 0;
+
+        case CBOR_MAJOR_ARRAY:
+        case CBOR_MAJOR_MAP: {
+                sd_json_variant **elements = NULL;
+                size_t n_elements = 0, n;
+
+                CLEANUP_ARRAY(elements, n_elements, sd_json_variant_unref_many);
+
+                /* Every element takes up at least one byte, refuse lengths that cannot possibly fit */
+                if (arg > (uint64_t) (end - *p) || (major == CBOR_MAJOR_MAP && arg * 2 > (uint64_t) (end - *p)))
+                        return -EBADMSG;
+
+                n = major == CBOR_MAJOR_MAP ? arg * 2 : arg;
+
+                if (n > 0) {
+                        elements = new(sd_json_variant*, n);
+                        if (!elements)
+                                return -ENOMEM;
+                }
+
+                while (n_elements < n) {
+                        r = cbor_parse(p, end, depth + 1, elements + n_elements);
+                        if (r < 0)
+                                return r;
+
+                        n_elements++;
+
+                        if (major == CBOR_MAJOR_MAP && n_elements % 2 == 1 && !sd_json_variant_is_string(elements[n_elements - 1]))
+                                return -EBADMSG; /* Object keys must be strings */
+                }
+
+                if (major == CBOR_MAJOR_MAP)
+                        return sd_json_variant_new_object(ret, elements, n_elements);
+
+                return sd_json_variant_new_array(ret, elements, n_elements);
+        }
+
+        case CBOR_MAJOR_SIMPLE:
+                /* For this major type the additional information field selects the value, and for floats
+                 * cbor_read_head() already read the payload for us as big-endian number */
+                switch (info) {
+
+                case CBOR_SIMPLE_FALSE:
+                case CBOR_SIMPLE_TRUE:
+                        return sd_json_variant_new_boolean(ret, info == CBOR_SIMPLE_TRUE);
+
+                case CBOR_SIMPLE_NULL:
+                        return sd_json_variant_new_null(ret);
+
+                case CBOR_SIMPLE_FLOAT: {
+                        uint32_t u = arg;
+                        float f;
+
+                        memcpy(&f, &u, sizeof(f));
+                        return sd_json_variant_new_real(ret, f);
+                }
+
+                case CBOR_SIMPLE_DOUBLE: {
+                        double d;
+
+                        memcpy(&d, &arg, sizeof(d));
+                        return sd_json_variant_new_real(ret, d);
+                }
+
+                default:
+                        return -EBADMSG;
+                }
+
+        default: /* Byte strings and tags have no JSON equivalent */
+                return -EBADMSG;
+        }
+}
+
+int json_variant_from_cbor(const void *data, size_t size, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        const uint8_t *p = data;
+        int r;
+
+        assert(data || size == 0);
+        assert(ret);
+
+        /* Parses exactly one data item that must take up the whole buffer */
+
+        r = cbor_parse(&p, p + size, 0, &v);
+        if (r < 0)
+                return r;
+        if (p != (const uint8_t*) data + size)
+                return -EBADMSG;
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
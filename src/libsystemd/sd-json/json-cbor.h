@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stddef.h>
+
+#include "sd-json.h"
+
+/* A compact binary serialization of sd_json_variant objects, using the subset of CBOR (RFC 8949) that maps
+ * 1:1 onto JSON: unsigned and negative integers, UTF-8 text strings, definite-length arrays and maps with
+ * text string keys, false/true/null and double precision floats. */
+
+size_t json_variant_cbor_size(sd_json_variant *v);
+void* json_variant_write_cbor(sd_json_variant *v, void *buf);
+int json_variant_from_cbor(const void *data, size_t size, sd_json_variant **ret);
@@ -74,3 +74,5 @@ enum { /* JSON tokens */
 };
 
 int json_tokenize(const char **p, char **ret_string, JsonValue *ret_value, unsigned *ret_line, unsigned *ret_column, void **state, unsigned *line, unsigned *column);
+
+int json_variant_format_append(sd_json_variant *v, sd_json_format_flags_t flags, char **buf, size_t *size, size_t max_size);
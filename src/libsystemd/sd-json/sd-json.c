@@ -33,6 +33,7 @@
 #include "process-util.h"
 #include "set.h"
 #include "signal-util.h"
+#include "siphash24.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -111,6 +112,12 @@ struct sd_json_variant {
         /* If in addition to this object all objects referenced by it are also ordered strictly by name */
         bool normalized:1;
 
+        /* If this is an object, a JsonObjectIndex follows the elements */
+        bool has_index:1;
+
+        /* An object key interned by the parser, and hence shared among unrelated objects */
+        bool is_shared_key:1;
+
         union {
                 /* For simple types we store the value in-line. */
                 JsonValue value;
@@ -142,6 +149,22 @@ assert_cc(sizeof(sd_json_variant) == 40U);
 assert_cc(INLINE_STRING_MAX == 7U);
 #endif
 
+/* Unsorted objects with at least this many fields get a hash table of their keys appended, which is filled
+ * in when the object is created. Objects are immutable, hence it never needs to be invalidated, and lookups
+ * may happen from multiple threads at once without locking. */
+#define JSON_OBJECT_INDEX_MIN 16U
+
+typedef struct JsonObjectIndex {
+        uint32_t n_slots; /* A power of two */
+        uint32_t slots[]; /* Field number + 1, or 0 if unused */
+} JsonObjectIndex;
+
+static size_t json_object_index_size(size_t n_fields) {
+        /* In units of sd_json_variant, as it is allocated as part of the object's element array */
+        return DIV_ROUND_UP(offsetof(JsonObjectIndex, slots) + ALIGN_POWER2(n_fields * 2) * sizeof(uint32_t),
+                            sizeof(sd_json_variant));
+}
+
 static JsonSource* json_source_new(const char *name) {
         JsonSource *s;
 
@@ -721,10 +744,48 @@ _public_ int sd_json_variant_new_array_strv(sd_json_variant **ret, char **l) {
         return 0;
 }
 
+static uint32_t json_object_index_hash(const char *key) {
+        /* The index only speeds up lookups, colliding keys just degrade it to the linear search we'd do
+         * otherwise. Hence there's no need for a secret hash key. */
+        static const uint8_t hash_key[16] = {};
+
+        return (uint32_t) siphash24_string(key, hash_key);
+}
+
+static JsonObjectIndex* json_object_index(sd_json_variant *v) {
+        assert(v);
+        assert(v->type == SD_JSON_VARIANT_OBJECT);
+        assert(v->has_index);
+
+        return (JsonObjectIndex*) (v + 1 + v->n_elements);
+}
+
+static void json_object_index_build(sd_json_variant *v) {
+        JsonObjectIndex *idx = json_object_index(v);
+
+        for (size_t i = 0; i < v->n_elements / 2; i++) {
+                const char *k;
+                uint32_t s;
+
+                k = sd_json_variant_string(json_variant_dereference(v + 1 + i*2));
+
+                /* Linear probing. If a key is duplicated, the first occurrence wins, like in the linear
+                 * search. */
+                for (s = json_object_index_hash(k) & (idx->n_slots - 1);
+                     idx->slots[s] != 0;
+                     s = (s + 1) & (idx->n_slots - 1))
+                        if (streq(k, sd_json_variant_string(json_variant_dereference(v + 1 + (idx->slots[s] - 1)*2))))
+                                break;
+
+                if (idx->slots[s] == 0)
+                        idx->slots[s] = i + 1;
+        }
+}
+
 _public_ int sd_json_variant_new_object(sd_json_variant **ret, sd_json_variant **array, size_t n) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
         const char *prev = NULL;
-        bool sorted = true, normalized = true;
+        bool sorted = true, normalized = true, index = false;
 
         assert_return(ret, -EINVAL);
         if (n == 0) {
@@ -734,15 +795,32 @@ _public_ int sd_json_variant_new_object(sd_json_variant **ret, sd_json_variant *
         assert_return(array, -EINVAL);
         assert_return(n % 2 == 0, -EINVAL);
 
-        v = new(sd_json_variant, n + 1);
+        /* Sorted objects are looked up by bisection, only reserve room for an index if this one isn't */
+        if (n / 2 >= JSON_OBJECT_INDEX_MIN && n / 2 <= UINT32_MAX / 2)
+                for (size_t i = 2; i < n; i += 2)
+                        if (strcmp_ptr(sd_json_variant_string(array[i - 2]), sd_json_variant_string(array[i])) >= 0) {
+                                index = true;
+                                break;
+                        }
+
+        v = new(sd_json_variant, n + 1 + (index ? json_object_index_size(n / 2) : 0));
         if (!v)
                 return -ENOMEM;
 
         *v = (sd_json_variant) {
                 .n_ref = 1,
                 .type = SD_JSON_VARIANT_OBJECT,
+                .has_index = index,
         };
 
+        if (index) {
+                JsonObjectIndex *idx = (JsonObjectIndex*) (v + 1 + n);
+
+                /* Slots read as unused until the index is built below */
+                memzero(idx, json_object_index_size(n / 2) * sizeof(sd_json_variant));
+                idx->n_slots = ALIGN_POWER2(n);
+        }
+
         for (v->n_elements = 0; v->n_elements < n; v->n_elements++) {
                 sd_json_variant *w = v + 1 + v->n_elements,
                             *c = array[v->n_elements];
@@ -781,6 +859,9 @@ _public_ int sd_json_variant_new_object(sd_json_variant **ret, sd_json_variant *
         v->normalized = normalized;
         v->sorted = sorted;
 
+        if (index)
+                json_object_index_build(v);
+
         *ret = TAKE_PTR(v);
         return 0;
 }
@@ -1351,6 +1432,25 @@ _public_ sd_json_variant *sd_json_variant_by_key_full(sd_json_variant *v, const
                 goto not_found;
         }
 
+        if (v->has_index) {
+                JsonObjectIndex *idx = json_object_index(v);
+
+                for (uint32_t s = json_object_index_hash(key) & (idx->n_slots - 1);
+                     idx->slots[s] != 0;
+                     s = (s + 1) & (idx->n_slots - 1)) {
+                        size_t i = (idx->slots[s] - 1) * 2;
+
+                        if (streq(sd_json_variant_string(json_variant_dereference(v + 1 + i)), key)) {
+                                if (ret_key)
+                                        *ret_key = json_variant_conservative_formalize(v + 1 + i);
+
+                                return json_variant_conservative_formalize(v + 1 + i + 1);
+                        }
+                }
+
+                goto not_found;
+        }
+
         /* The variant is not sorted, hence search for the field linearly */
         for (size_t i = 0; i < v->n_elements; i += 2) {
                 sd_json_variant *p;
@@ -1489,14 +1589,16 @@ _public_ void sd_json_variant_sensitive(sd_json_variant *v) {
          * one-way operation: as soon as it is marked this way it remains marked this way until it's
          * destroyed. A magic variant is never sensitive though, even when asked, since it's too
          * basic. Similar, const string variant are never sensitive either, after all they are included in
-         * the source code as they are, which is not suitable for inclusion of secrets.
+         * the source code as they are, which is not suitable for inclusion of secrets. Neither are object
+         * keys shared among the objects of a parsed document: the flag belongs to the value of the object
+         * it is set on, and must not leak into unrelated objects that happen to use the same key.
          *
          * Note that this flag has a recursive effect: when we destroy an object or array we'll propagate the
          * flag to all contained variants. And if those are then destroyed this is propagated further down,
          * and so on. */
 
         v = json_variant_formalize(v);
-        if (!json_variant_is_regular(v))
+        if (!json_variant_is_regular(v) || v->is_shared_key)
                 return;
 
         v->sensitive = true;
@@ -1896,6 +1998,72 @@ _public_ int sd_json_variant_format(sd_json_variant *v, sd_json_format_flags_t f
         return sz;
 }
 
+typedef struct JsonAppendBuffer {
+        char **buf;
+        size_t *size;
+        size_t max_size;
+} JsonAppendBuffer;
+
+static ssize_t json_append_write(void *cookie, const char *data, size_t n) {
+        JsonAppendBuffer *b = ASSERT_PTR(cookie);
+
+        if (n > b->max_size - *b->size) {
+                errno = ENOBUFS;
+                return -1;
+        }
+
+        if (!GREEDY_REALLOC(*b->buf, *b->size + n)) {
+                errno = ENOMEM;
+                return -1;
+        }
+
+        memcpy(*b->buf + *b->size, data, n);
+        *b->size += n;
+        return n;
+}
+
+int json_variant_format_append(sd_json_variant *v, sd_json_format_flags_t flags, char **buf, size_t *size, size_t max_size) {
+        JsonAppendBuffer b = {
+                .buf = ASSERT_PTR(buf),
+                .size = ASSERT_PTR(size),
+                .max_size = max_size,
+        };
+        size_t saved_size = *size;
+        FILE *f;
+        int r;
+
+        /* Like sd_json_variant_format(), but appends the formatted text plus a trailing NUL byte directly to
+         * the specified buffer, growing it as needed, instead of allocating a new string for it. Fails with
+         * -ENOBUFS if the buffer would grow beyond max_size. On failure the buffer is restored to its
+         * original size. Returns the length of the appended text (without the trailing NUL). */
+
+        assert(v);
+        assert(*size <= max_size);
+
+        if (!sd_json_format_enabled(flags))
+                return -ENOEXEC;
+
+        f = fopencookie(&b, "w", (cookie_io_functions_t) { .write = json_append_write });
+        if (!f)
+                return -errno_or_else(ENOMEM);
+
+        r = sd_json_variant_dump(v, flags & ~SD_JSON_FORMAT_FLUSH, f, NULL);
+        if (r >= 0)
+                r = fflush_and_check(f);
+
+        /* Close before rolling back, so that nothing is written to the buffer afterwards */
+        f = safe_fclose(f);
+
+        if (r >= 0 && json_append_write(&b, "", 1) < 0)
+                r = -errno;
+        if (r < 0) {
+                *size = saved_size;
+                return r;
+        }
+
+        return *size - saved_size - 1;
+}
+
 _public_ int sd_json_variant_dump(sd_json_variant *v, sd_json_format_flags_t flags, FILE *f, const char *prefix) {
         if (!v) {
                 if (flags & SD_JSON_FORMAT_EMPTY_ARRAY)
@@ -2593,7 +2761,7 @@ static int unhex_ucs2(const char *c, uint16_t *ret) {
 static int json_parse_string(const char **p, char **ret) {
         _cleanup_free_ char *s = NULL;
         size_t n = 0;
-        const char *c;
+        const char *c, *e;
 
         assert(p);
         assert(*p);
@@ -2606,9 +2774,30 @@ static int json_parse_string(const char **p, char **ret) {
 
         c++;
 
+        /* Unescaping never makes a string longer, hence size the buffer for the raw length right away,
+         * instead of growing it piecemeal below. */
+        e = c;
+        while (*e != 0 && *e != '"')
+                e += (*e == '\\' && e[1] != 0) ? 2 : 1;
+        if (!GREEDY_REALLOC(s, e - c + 1))
+                return -ENOMEM;
+
         for (;;) {
                 int len;
 
+                /* Fast path: most strings are mostly made of printable ASCII, which needs neither unescaping
+                 * nor UTF-8 validation. Find the end of such a run, and copy it in one go. */
+                for (e = c; *e >= ' ' && *e < 0x7f && !IN_SET(*e, '"', '\\'); e++)
+                        ;
+                if (e > c) {
+                        if (!GREEDY_REALLOC(s, n + (e - c) + 1))
+                                return -ENOMEM;
+
+                        memcpy(s + n, c, e - c);
+                        n += e - c;
+                        c = e;
+                }
+
                 /* Check for EOF */
                 if (*c == 0)
                         return -EINVAL;
@@ -3030,6 +3219,74 @@ static void json_stack_release(JsonStack *s) {
         CLEANUP_ARRAY(s->elements, s->n_elements, sd_json_variant_unref_many);
 }
 
+static void json_stack_reset(JsonStack *s) {
+        assert(s);
+
+        /* Like json_stack_release(), but keeps the element array allocated, so that the next object or
+         * array at the same nesting depth can reuse it */
+
+        for (size_t i = 0; i < s->n_elements; i++)
+                sd_json_variant_unref(s->elements[i]);
+
+        s->n_elements = 0;
+}
+
+static void json_stack_push(JsonStack *stack, size_t *n_stack, JsonExpect expect, unsigned line, unsigned column) {
+        JsonStack *s;
+
+        assert(stack);
+        assert(n_stack);
+
+        s = stack + (*n_stack)++;
+
+        /* The parser allocates the stack with GREEDY_REALLOC0(), hence unused entries are zeroed, or were
+         * reset with json_stack_reset() */
+        assert(s->n_elements == 0);
+
+        *s = (JsonStack) {
+                .expect = expect,
+                .elements = s->elements,
+                .line_before = line,
+                .column_before = column,
+        };
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                json_key_hash_ops,
+                char, string_hash_func, string_compare_func,
+                sd_json_variant, sd_json_variant_unref);
+
+static int json_parse_intern_key(Hashmap **keys, const char *s, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(keys);
+        assert(s);
+        assert(ret);
+
+        /* Object keys too long to be stored inline in the object are otherwise allocated separately for
+         * every single object. Share them among all objects of the same document instead, which adds up
+         * for large arrays of records that all use the same field names. */
+
+        v = sd_json_variant_ref(hashmap_get(*keys, s));
+        if (!v) {
+                r = sd_json_variant_new_string(&v, s);
+                if (r < 0)
+                        return r;
+
+                v->is_shared_key = true;
+
+                r = hashmap_ensure_put(keys, &json_key_hash_ops, sd_json_variant_string(v), v);
+                if (r < 0)
+                        return r;
+
+                sd_json_variant_ref(v);
+        }
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
+
 static int json_parse_internal(
                 const char **input,
                 JsonSource *source,
@@ -3042,6 +3299,7 @@ static int json_parse_internal(
         size_t n_stack = 1;
         unsigned line_buffer = 0, column_buffer = 0;
         void *tokenizer_state = NULL;
+        _cleanup_hashmap_free_ Hashmap *keys = NULL;
         JsonStack *stack = NULL;
         const char *p;
         int r;
@@ -3051,7 +3309,7 @@ static int json_parse_internal(
 
         p = *input;
 
-        if (!GREEDY_REALLOC(stack, n_stack))
+        if (!GREEDY_REALLOC0(stack, n_stack))
                 return -ENOMEM;
 
         stack[0] = (JsonStack) {
@@ -3067,6 +3325,7 @@ static int json_parse_internal(
                 _cleanup_(sd_json_variant_unrefp) sd_json_variant *add = NULL;
                 _cleanup_free_ char *string = NULL;
                 unsigned line_token, column_token;
+                bool interned = false;
                 JsonStack *current;
                 JsonValue value;
                 int token;
@@ -3125,7 +3384,7 @@ static int json_parse_internal(
                                 goto finish;
                         }
 
-                        if (!GREEDY_REALLOC(stack, n_stack+1)) {
+                        if (!GREEDY_REALLOC0(stack, n_stack+1)) {
                                 r = -ENOMEM;
                                 goto finish;
                         }
@@ -3141,11 +3400,7 @@ static int json_parse_internal(
                                 current->expect = EXPECT_ARRAY_COMMA;
                         }
 
-                        stack[n_stack++] = (JsonStack) {
-                                .expect = EXPECT_OBJECT_FIRST_KEY,
-                                .line_before = line_token,
-                                .column_before = column_token,
-                        };
+                        json_stack_push(stack, &n_stack, EXPECT_OBJECT_FIRST_KEY, line_token, column_token);
 
                         current = stack + n_stack - 1;
                         break;
@@ -3165,7 +3420,7 @@ static int json_parse_internal(
                         line_token = current->line_before;
                         column_token = current->column_before;
 
-                        json_stack_release(current);
+                        json_stack_reset(current);
                         n_stack--, current--;
 
                         break;
@@ -3176,7 +3431,7 @@ static int json_parse_internal(
                                 goto finish;
                         }
 
-                        if (!GREEDY_REALLOC(stack, n_stack+1)) {
+                        if (!GREEDY_REALLOC0(stack, n_stack+1)) {
                                 r = -ENOMEM;
                                 goto finish;
                         }
@@ -3192,11 +3447,7 @@ static int json_parse_internal(
                                 current->expect = EXPECT_ARRAY_COMMA;
                         }
 
-                        stack[n_stack++] = (JsonStack) {
-                                .expect = EXPECT_ARRAY_FIRST_ELEMENT,
-                                .line_before = line_token,
-                                .column_before = column_token,
-                        };
+                        json_stack_push(stack, &n_stack, EXPECT_ARRAY_FIRST_ELEMENT, line_token, column_token);
 
                         break;
 
@@ -3215,7 +3466,7 @@ static int json_parse_internal(
                         line_token = current->line_before;
                         column_token = current->column_before;
 
-                        json_stack_release(current);
+                        json_stack_reset(current);
                         n_stack--, current--;
                         break;
 
@@ -3225,7 +3476,17 @@ static int json_parse_internal(
                                 goto finish;
                         }
 
-                        r = sd_json_variant_new_string(&add, string);
+                        /* Interned keys are shared, hence cannot carry their own source location. Don't
+                         * bother when parsing from a named source (i.e. a file, where the location
+                         * matters for error messages), nor for sensitive data. */
+                        interned = IN_SET(current->expect, EXPECT_OBJECT_FIRST_KEY, EXPECT_OBJECT_NEXT_KEY) &&
+                                !source &&
+                                !FLAGS_SET(flags, SD_JSON_PARSE_SENSITIVE) &&
+                                strlen(string) > INLINE_STRING_MAX;
+                        if (interned)
+                                r = json_parse_intern_key(&keys, string, &add);
+                        else
+                                r = sd_json_variant_new_string(&add, string);
                         if (r < 0)
                                 goto finish;
 
@@ -3358,7 +3619,8 @@ static int json_parse_internal(
                         if (FLAGS_SET(flags, SD_JSON_PARSE_SENSITIVE))
                                 sd_json_variant_sensitive(add);
 
-                        (void) json_variant_set_source(&add, source, line_token, column_token);
+                        if (!interned)
+                                (void) json_variant_set_source(&add, source, line_token, column_token);
 
                         if (!GREEDY_REALLOC(current->elements, current->n_elements + 1)) {
                                 r = -ENOMEM;
@@ -3378,7 +3640,8 @@ done:
         r = 0;
 
 finish:
-        for (size_t i = 0; i < n_stack; i++)
+        /* Also release the element arrays kept around for reuse above the current depth */
+        for (size_t i = 0; i < MALLOC_ELEMENTSOF(stack); i++)
                 json_stack_release(stack + i);
 
         free(stack);
@@ -5082,6 +5345,27 @@ static void *dispatch_userdata(const sd_json_dispatch_field *p, void *userdata)
         return SIZE_TO_PTR(p->offset);
 }
 
+static const sd_json_dispatch_field* json_dispatch_find_field(
+                const sd_json_dispatch_field table[],
+                size_t n,
+                size_t start,
+                const char *key) {
+
+        /* Looks for the table entry for the specified key, starting at index 'start' and wrapping
+         * around. Objects are commonly generated from the same tables that are used to dispatch them,
+         * hence if we start right after the previous match, the next key is usually the first one we
+         * check. */
+
+        for (size_t i = 0; i < n; i++) {
+                const sd_json_dispatch_field *p = table + (start + i) % n;
+
+                if (p->name == POINTER_MAX || streq_ptr(key, p->name))
+                        return p;
+        }
+
+        return NULL;
+}
+
 _public_ int sd_json_dispatch_full(
                 sd_json_variant *v,
                 const sd_json_dispatch_field table[],
@@ -5089,9 +5373,9 @@ _public_ int sd_json_dispatch_full(
                 sd_json_dispatch_flags_t flags,
                 void *userdata,
                 const char **reterr_bad_field) {
-        size_t m;
+        bool *found, has_wildcard = false;
+        size_t m, next = 0;
         int r, done = 0;
-        bool *found;
 
         if (!sd_json_variant_is_object(v)) {
                 json_log(v, flags, 0, "JSON variant is not an object.");
@@ -5106,8 +5390,11 @@ _public_ int sd_json_dispatch_full(
         }
 
         m = 0;
-        for (const sd_json_dispatch_field *p = table; p->name; p++)
+        for (const sd_json_dispatch_field *p = table; p->name; p++) {
+                if (p->name == POINTER_MAX)
+                        has_wildcard = true;
                 m++;
+        }
 
         found = newa0(bool, m);
 
@@ -5119,14 +5406,13 @@ _public_ int sd_json_dispatch_full(
                 assert_se(key = sd_json_variant_by_index(v, i));
                 assert_se(value = sd_json_variant_by_index(v, i+1));
 
-                for (p = table; p->name; p++)
-                        if (p->name == POINTER_MAX ||
-                            streq_ptr(sd_json_variant_string(key), p->name))
-                                break;
-
-                if (p->name) { /* Found a matching entry! 🙂 */
+                /* A catch-all entry must only match keys that no earlier entry matches, hence always search
+                 * such tables from the start */
+                p = json_dispatch_find_field(table, m, has_wildcard ? 0 : next, sd_json_variant_string(key));
+                if (p) { /* Found a matching entry! 🙂 */
                         sd_json_dispatch_flags_t merged_flags;
 
+                        next = (p - table + 1) % m;
                         merged_flags = flags | p->flags;
 
                         /* If an explicit type is specified, verify it matches */
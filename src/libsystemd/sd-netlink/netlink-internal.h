@@ -17,11 +17,31 @@
 
 #define NETLINK_CONTAINER_DEPTH 32
 
+/* Limits for the number and the total size of messages written at once while batching. The kernel refuses
+ * writes larger than the socket send buffer. */
+#define NETLINK_BATCH_MESSAGES_MAX 64U
+#define NETLINK_BATCH_SIZE_MAX (32U * 1024U)
+
+/* Dumps are split by the kernel into datagrams of up to the size of the largest buffer we passed to
+ * recvmsg() so far, capped at 32K. Hence, always read into buffers of at least that size. */
+#define NETLINK_RBUFFER_SIZE_MIN (32U * 1024U)
+
+/* Received messages are views into the buffer they were read into, which is hence reference counted. */
+typedef struct NetlinkReadBuffer {
+        unsigned n_ref;
+        size_t size;
+        uint8_t data[];
+} NetlinkReadBuffer;
+
+NetlinkReadBuffer* netlink_read_buffer_ref(NetlinkReadBuffer *b);
+NetlinkReadBuffer* netlink_read_buffer_unref(NetlinkReadBuffer *b);
+
 struct reply_callback {
         sd_netlink_message_handler_t callback;
         usec_t timeout;
         uint32_t serial;
         unsigned prioq_idx;
+        int error; /* If negative, the message could not be sent, and the callback is called with this. */
 };
 
 struct match_callback {
@@ -77,9 +97,14 @@ struct sd_netlink {
         Hashmap *rqueue_by_serial;
         Hashmap *rqueue_partial_by_serial;
 
-        struct nlmsghdr *rbuffer;
+        NetlinkReadBuffer *rbuffer;
 
         bool processing:1;
+        bool batching:1;
+
+        /* Messages to be written at once, see netlink_begin_batch() */
+        sd_netlink_message **wqueue;
+        size_t n_wqueue;
 
         uint32_t serial;
 
@@ -125,7 +150,10 @@ struct sd_netlink_message {
         uint32_t multicast_group;
         bool sealed:1;
 
+        NetlinkReadBuffer *rbuffer; /* if set, hdr points into this buffer */
+
         sd_netlink_message *next; /* next in a chain of multi-part messages */
+        sd_netlink_message *last; /* last in the chain, only set for the first one while receiving it */
 };
 
 int message_new_empty(sd_netlink *nl, sd_netlink_message **ret);
@@ -152,6 +180,8 @@ int socket_bind(sd_netlink *nl);
 int socket_broadcast_group_ref(sd_netlink *nl, unsigned group);
 int socket_broadcast_group_unref(sd_netlink *nl, unsigned group);
 int socket_write_message(sd_netlink *nl, sd_netlink_message *m);
+int socket_writev_message(sd_netlink *nl, sd_netlink_message * const *m, size_t msgcount);
+void netlink_flush_wqueue(sd_netlink *nl);
 int socket_read_message(sd_netlink *nl);
 
 int netlink_add_match_internal(
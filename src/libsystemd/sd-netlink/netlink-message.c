@@ -130,7 +130,10 @@ sd_netlink_message* sd_netlink_message_unref(sd_netlink_message *m) {
         while (m && --m->n_ref == 0) {
                 unsigned i;
 
-                free(m->hdr);
+                if (m->rbuffer)
+                        netlink_read_buffer_unref(m->rbuffer);
+                else
+                        free(m->hdr);
 
                 for (i = 0; i <= m->n_containers; i++)
                         free(m->containers[i].attributes);
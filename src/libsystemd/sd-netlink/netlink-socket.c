@@ -1,6 +1,5 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
-#include <malloc.h>
 #include <netinet/in.h>
 #include <stdbool.h>
 #include <unistd.h>
@@ -159,6 +158,32 @@ int socket_write_message(sd_netlink *nl, sd_netlink_message *m) {
         return k;
 }
 
+int socket_writev_message(sd_netlink *nl, sd_netlink_message * const *m, size_t msgcount) {
+        _cleanup_free_ struct iovec *iovs = NULL;
+        ssize_t k;
+
+        assert(nl);
+        assert(m);
+        assert(msgcount > 0);
+
+        iovs = new(struct iovec, msgcount);
+        if (!iovs)
+                return -ENOMEM;
+
+        for (size_t i = 0; i < msgcount; i++) {
+                assert(m[i]->hdr);
+                assert(m[i]->hdr->nlmsg_len > 0);
+
+                iovs[i] = IOVEC_MAKE(m[i]->hdr, m[i]->hdr->nlmsg_len);
+        }
+
+        k = writev(nl->fd, iovs, msgcount);
+        if (k < 0)
+                return -errno;
+
+        return k;
+}
+
 static int socket_recv_message(int fd, void *buf, size_t buf_size, uint32_t *ret_mcast_group, bool peek) {
         struct iovec iov = IOVEC_MAKE(buf, buf_size);
         union sockaddr_union sender;
@@ -295,7 +320,32 @@ static int netlink_queue_partially_received_message(sd_netlink *nl, sd_netlink_m
         return 0;
 }
 
-static int parse_message_one(sd_netlink *nl, uint32_t group, const struct nlmsghdr *hdr, sd_netlink_message **ret) {
+DEFINE_TRIVIAL_REF_UNREF_FUNC(NetlinkReadBuffer, netlink_read_buffer, mfree);
+
+static int netlink_prepare_read_buffer(sd_netlink *nl, size_t size) {
+        NetlinkReadBuffer *b;
+
+        assert(nl);
+
+        size = MAX(size, NETLINK_RBUFFER_SIZE_MIN);
+
+        /* The buffer can only be reused when no received message refers to it anymore. */
+        if (nl->rbuffer && nl->rbuffer->n_ref == 1 && nl->rbuffer->size >= size)
+                return 0;
+
+        b = malloc(offsetof(NetlinkReadBuffer, data) + size);
+        if (!b)
+                return -ENOMEM;
+
+        b->n_ref = 1;
+        b->size = size;
+
+        netlink_read_buffer_unref(nl->rbuffer);
+        nl->rbuffer = b;
+        return 0;
+}
+
+static int parse_message_one(sd_netlink *nl, uint32_t group, struct nlmsghdr *hdr, sd_netlink_message **ret) {
         _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
         size_t size;
         int r;
@@ -332,9 +382,8 @@ static int parse_message_one(sd_netlink *nl, uint32_t group, const struct nlmsgh
                 return r;
 
         m->multicast_group = group;
-        m->hdr = memdup(hdr, hdr->nlmsg_len);
-        if (!m->hdr)
-                return -ENOMEM;
+        m->hdr = hdr;
+        m->rbuffer = netlink_read_buffer_ref(nl->rbuffer);
 
         /* seal and parse the top-level message */
         r = sd_netlink_message_rewind(m, nl);
@@ -369,21 +418,22 @@ int socket_read_message(sd_netlink *nl) {
         len = (size_t) r;
 
         /* make room for the pending message */
-        if (!greedy_realloc((void**) &nl->rbuffer, len, sizeof(uint8_t)))
-                return -ENOMEM;
+        r = netlink_prepare_read_buffer(nl, len);
+        if (r < 0)
+                return r;
 
         /* read the pending message */
-        r = socket_recv_message(nl->fd, nl->rbuffer, MALLOC_SIZEOF_SAFE(nl->rbuffer), &group, false);
+        r = socket_recv_message(nl->fd, nl->rbuffer->data, nl->rbuffer->size, &group, false);
         if (r <= 0)
                 return r;
         len = (size_t) r;
 
-        if (!NLMSG_OK(nl->rbuffer, len)) {
+        if (!NLMSG_OK((struct nlmsghdr*) nl->rbuffer->data, len)) {
                 log_debug("sd-netlink: received invalid message, discarding %zu bytes of incoming message", len);
                 return 0;
         }
 
-        for (struct nlmsghdr *hdr = nl->rbuffer; NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+        for (struct nlmsghdr *hdr = (struct nlmsghdr*) nl->rbuffer->data; NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
                 _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
 
                 r = parse_message_one(nl, group, hdr, &m);
@@ -411,10 +461,12 @@ int socket_read_message(sd_netlink *nl) {
                                 existing = hashmap_get(nl->rqueue_partial_by_serial, UINT32_TO_PTR(hdr->nlmsg_seq));
                                 if (existing) {
                                         /* This is the continuation of the previously read messages.
-                                         * Let's append this message at the end. */
-                                        while (existing->next)
-                                                existing = existing->next;
-                                        existing->next = TAKE_PTR(m);
+                                         * Let's append this message at the end. Dumps may consist of
+                                         * millions of messages, hence do not walk the chain. */
+                                        sd_netlink_message *last = existing->last ?: existing;
+
+                                        last->next = TAKE_PTR(m);
+                                        existing->last = last->next;
                                 } else {
                                         /* This is the first message. Put it into the queue for partially
                                          * received messages. */
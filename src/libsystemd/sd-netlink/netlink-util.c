@@ -3,7 +3,6 @@
 #include "sd-netlink.h"
 
 #include "fd-util.h"
-#include "iovec-util.h"
 #include "memory-util.h"
 #include "netlink-internal.h"
 #include "netlink-util.h"
@@ -706,30 +705,33 @@ void netlink_seal_message(sd_netlink *nl, sd_netlink_message *m) {
         message_seal(m);
 }
 
-static int socket_writev_message(sd_netlink *nl, sd_netlink_message **m, size_t msgcount) {
-        _cleanup_free_ struct iovec *iovs = NULL;
-        ssize_t k;
+int netlink_attach_filter(sd_netlink *nl, const struct sock_filter *filter, size_t n_filter) {
+        assert_return(nl, -EINVAL);
+        assert_return(!netlink_pid_changed(nl), -ECHILD);
+        assert_return(filter || n_filter == 0, -EINVAL);
+        assert_return(n_filter <= BPF_MAXINSNS, -E2BIG);
 
-        assert(nl);
-        assert(m);
-        assert(msgcount > 0);
+        /* Attaches a classic BPF program to the socket, which is run on each received datagram before it is
+         * queued. Use this to drop notifications the consumer is not interested in as early as possible.
+         * Note that a datagram may carry multiple messages, e.g. parts of a dump, while the program can only
+         * check the first one. When called with an empty program, the filter is detached. */
 
-        iovs = new(struct iovec, msgcount);
-        if (!iovs)
-                return -ENOMEM;
+        if (n_filter == 0) {
+                if (setsockopt(nl->fd, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0) < 0 && errno != ENOENT)
+                        return -errno;
 
-        for (size_t i = 0; i < msgcount; i++) {
-                assert(m[i]->hdr);
-                assert(m[i]->hdr->nlmsg_len > 0);
-
-                iovs[i] = IOVEC_MAKE(m[i]->hdr, m[i]->hdr->nlmsg_len);
+                return 0;
         }
 
-        k = writev(nl->fd, iovs, msgcount);
-        if (k < 0)
+        struct sock_fprog fprog = {
+                .len = n_filter,
+                .filter = (struct sock_filter*) filter,
+        };
+
+        if (setsockopt(nl->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0)
                 return -errno;
 
-        return k;
+        return 0;
 }
 
 int sd_netlink_sendv(
@@ -760,6 +762,9 @@ int sd_netlink_sendv(
                         serials[i] = message_get_serial(messages[i]);
         }
 
+        /* Keep the order of messages */
+        netlink_flush_wqueue(nl);
+
         r = socket_writev_message(nl, messages, msgcount);
         if (r < 0)
                 return r;
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 #pragma once
 
+#include <linux/filter.h>
 #include <linux/rtnetlink.h>
 
 #include "sd-netlink.h"
@@ -132,6 +133,10 @@ int rtattr_append_attribute(struct rtattr **rta, unsigned short type, const void
 void netlink_seal_message(sd_netlink *nl, sd_netlink_message *m);
 
 size_t netlink_get_reply_callback_count(sd_netlink *nl);
+void netlink_begin_batch(sd_netlink *nl);
+void netlink_end_batch(sd_netlink *nl);
+
+int netlink_attach_filter(sd_netlink *nl, const struct sock_filter *filter, size_t n_filter);
 
 /* TODO: to be exported later */
 int sd_netlink_sendv(sd_netlink *nl, sd_netlink_message **messages, size_t msgcnt, uint32_t **ret_serial);
@@ -119,10 +119,15 @@ static sd_netlink *netlink_free(sd_netlink *nl) {
 
         assert(nl);
 
+        /* Messages not written yet are dropped, their reply callbacks go away with the slots below. */
+        FOREACH_ARRAY(m, nl->wqueue, nl->n_wqueue)
+                sd_netlink_message_unref(*m);
+        free(nl->wqueue);
+
         ordered_set_free(nl->rqueue);
         hashmap_free(nl->rqueue_by_serial);
         hashmap_free(nl->rqueue_partial_by_serial);
-        free(nl->rbuffer);
+        netlink_read_buffer_unref(nl->rbuffer);
 
         while ((s = nl->slots)) {
                 assert(s->floating);
@@ -159,6 +164,9 @@ int sd_netlink_send(
 
         netlink_seal_message(nl, message);
 
+        /* Keep the order of messages */
+        netlink_flush_wqueue(nl);
+
         r = socket_write_message(nl, message);
         if (r < 0)
                 return r;
@@ -169,6 +177,120 @@ int sd_netlink_send(
         return 1;
 }
 
+static int timeout_compare(const void *a, const void *b) {
+        const struct reply_callback *x = a, *y = b;
+
+        return CMP(x->timeout, y->timeout);
+}
+
+static void netlink_fail_reply_callback(sd_netlink *nl, uint32_t serial, int error) {
+        struct reply_callback *c;
+        int r;
+
+        assert(nl);
+        assert(error < 0);
+
+        c = hashmap_get(nl->reply_callbacks, UINT32_TO_PTR(serial));
+        if (!c)
+                return;
+
+        /* Make the callback time out right away, process_timeout() will then call it with the error. */
+        c->error = error;
+
+        if (c->timeout != USEC_INFINITY) {
+                c->timeout = 0;
+                prioq_reshuffle(nl->reply_callbacks_prioq, c, &c->prioq_idx);
+                return;
+        }
+
+        c->timeout = 0;
+        r = prioq_ensure_put(&nl->reply_callbacks_prioq, timeout_compare, c, &c->prioq_idx);
+        if (r < 0) {
+                c->timeout = USEC_INFINITY;
+                log_debug_errno(r, "sd-netlink: failed to fail reply callback for serial %" PRIu32 ", ignoring: %m", serial);
+        }
+}
+
+static void netlink_write_messages(sd_netlink *nl, sd_netlink_message * const *m, size_t n) {
+        int r;
+
+        assert(nl);
+        assert(m);
+        assert(n > 0);
+
+        if (n > 1 && socket_writev_message(nl, m, n) >= 0)
+                return;
+
+        /* If the batch could not be written, e.g. the kernel refused a message, then write the messages one
+         * by one, so that only those that cannot be written fail. */
+        for (size_t i = 0; i < n; i++) {
+                r = socket_write_message(nl, m[i]);
+                if (r < 0)
+                        netlink_fail_reply_callback(nl, message_get_serial(m[i]), r);
+        }
+}
+
+void netlink_flush_wqueue(sd_netlink *nl) {
+        size_t i = 0;
+
+        assert(nl);
+
+        while (i < nl->n_wqueue) {
+                size_t n = 0, size = 0;
+
+                while (i + n < nl->n_wqueue && n < NETLINK_BATCH_MESSAGES_MAX &&
+                       (n == 0 || size + nl->wqueue[i + n]->hdr->nlmsg_len <= NETLINK_BATCH_SIZE_MAX))
+                        size += nl->wqueue[i + n++]->hdr->nlmsg_len;
+
+                netlink_write_messages(nl, nl->wqueue + i, n);
+                i += n;
+        }
+
+        FOREACH_ARRAY(m, nl->wqueue, nl->n_wqueue)
+                sd_netlink_message_unref(*m);
+        nl->n_wqueue = 0;
+}
+
+static int netlink_queue_message(sd_netlink *nl, sd_netlink_message *m, uint32_t *ret_serial) {
+        assert(nl);
+        assert(m);
+        assert(ret_serial);
+        assert(!m->sealed);
+
+        if (!GREEDY_REALLOC(nl->wqueue, nl->n_wqueue + 1))
+                return -ENOMEM;
+
+        netlink_seal_message(nl, m);
+        nl->wqueue[nl->n_wqueue++] = sd_netlink_message_ref(m);
+
+        *ret_serial = message_get_serial(m);
+        return 1;
+}
+
+static void netlink_unqueue_message(sd_netlink *nl, sd_netlink_message *m) {
+        assert(nl);
+        assert(m);
+
+        if (nl->n_wqueue > 0 && nl->wqueue[nl->n_wqueue - 1] == m)
+                sd_netlink_message_unref(nl->wqueue[--nl->n_wqueue]);
+}
+
+void netlink_begin_batch(sd_netlink *nl) {
+        assert(nl);
+
+        /* From now on, sd_netlink_call_async() only queues messages, they are written together by
+         * netlink_end_batch(), or earlier when many are queued or a message is sent otherwise. All messages
+         * are still replied to separately, each matched by its own serial. */
+        nl->batching = true;
+}
+
+void netlink_end_batch(sd_netlink *nl) {
+        assert(nl);
+
+        nl->batching = false;
+        netlink_flush_wqueue(nl);
+}
+
 static int dispatch_rqueue(sd_netlink *nl, sd_netlink_message **ret) {
         sd_netlink_message *m;
         int r;
@@ -210,7 +332,7 @@ static int process_timeout(sd_netlink *nl) {
         if (c->timeout > n)
                 return 0;
 
-        r = message_new_synthetic_error(nl, -ETIMEDOUT, c->serial, &m);
+        r = message_new_synthetic_error(nl, c->error < 0 ? c->error : -ETIMEDOUT, c->serial, &m);
         if (r < 0)
                 return r;
 
@@ -452,12 +574,6 @@ int sd_netlink_wait(sd_netlink *nl, uint64_t timeout_usec) {
         return r;
 }
 
-static int timeout_compare(const void *a, const void *b) {
-        const struct reply_callback *x = a, *y = b;
-
-        return CMP(x->timeout, y->timeout);
-}
-
 size_t netlink_get_reply_callback_count(sd_netlink *nl) {
         assert(nl);
 
@@ -502,18 +618,24 @@ int sd_netlink_call_async(
         slot->reply_callback.callback = callback;
         slot->reply_callback.timeout = timespan_to_timestamp(usec);
 
-        k = sd_netlink_send(nl, m, &slot->reply_callback.serial);
+        if (nl->batching)
+                k = netlink_queue_message(nl, m, &slot->reply_callback.serial);
+        else
+                k = sd_netlink_send(nl, m, &slot->reply_callback.serial);
         if (k < 0)
                 return k;
 
         r = hashmap_put(nl->reply_callbacks, UINT32_TO_PTR(slot->reply_callback.serial), &slot->reply_callback);
-        if (r < 0)
+        if (r < 0) {
+                netlink_unqueue_message(nl, m);
                 return r;
+        }
 
         if (slot->reply_callback.timeout != USEC_INFINITY) {
                 r = prioq_put(nl->reply_callbacks_prioq, &slot->reply_callback, &slot->reply_callback.prioq_idx);
                 if (r < 0) {
                         (void) hashmap_remove(nl->reply_callbacks, UINT32_TO_PTR(slot->reply_callback.serial));
+                        netlink_unqueue_message(nl, m);
                         return r;
                 }
         }
@@ -521,6 +643,9 @@ int sd_netlink_call_async(
         /* Set this at last. Otherwise, some failures in above would call destroy_callback but some would not. */
         slot->destroy_callback = destroy_callback;
 
+        if (nl->n_wqueue >= NETLINK_BATCH_MESSAGES_MAX)
+                netlink_flush_wqueue(nl);
+
         if (ret_slot)
                 *ret_slot = slot;
 
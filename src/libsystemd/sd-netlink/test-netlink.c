@@ -365,6 +365,37 @@ TEST(pipe) {
         assert_se((rtnl = sd_netlink_unref(rtnl)) == NULL);
 }
 
+TEST(batch) {
+        _cleanup_(sd_netlink_unrefp) sd_netlink *rtnl = NULL;
+        int ifindex, counter = 0;
+
+        assert_se(sd_netlink_open(&rtnl) >= 0);
+        ifindex = (int) if_nametoindex("lo");
+
+        netlink_begin_batch(rtnl);
+
+        for (unsigned i = 0; i < NETLINK_BATCH_MESSAGES_MAX + 3; i++) {
+                _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
+
+                assert_se(sd_rtnl_message_new_link(rtnl, &m, RTM_GETLINK, ifindex) >= 0);
+
+                counter++;
+                assert_se(sd_netlink_call_async(rtnl, NULL, m, pipe_handler, NULL, &counter, 0, NULL) >= 0);
+        }
+
+        /* A full batch is written right away, the rest when the batch ends. */
+        assert_se(rtnl->n_wqueue == 3);
+        netlink_end_batch(rtnl);
+        assert_se(rtnl->n_wqueue == 0);
+
+        while (counter > 0) {
+                assert_se(sd_netlink_wait(rtnl, 0) >= 0);
+                assert_se(sd_netlink_process(rtnl, NULL) >= 0);
+        }
+
+        assert_se((rtnl = sd_netlink_unref(rtnl)) == NULL);
+}
+
 TEST(message_container) {
         _cleanup_(sd_netlink_unrefp) sd_netlink *rtnl = NULL;
         _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
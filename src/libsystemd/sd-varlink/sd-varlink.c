@@ -15,6 +15,8 @@
 #include "hashmap.h"
 #include "io-util.h"
 #include "iovec-util.h"
+#include "json-cbor.h"
+#include "json-internal.h"
 #include "json-util.h"
 #include "list.h"
 #include "path-util.h"
@@ -26,6 +28,7 @@
 #include "strv.h"
 #include "time-util.h"
 #include "umask-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "varlink-idl-util.h"
 #include "varlink-internal.h"
@@ -38,6 +41,13 @@
 #define VARLINK_DEFAULT_TIMEOUT_USEC (45U*USEC_PER_SEC)
 #define VARLINK_BUFFER_MAX (16U*1024U*1024U)
 #define VARLINK_READ_SIZE (64U*1024U)
+
+/* How many bytes of replies to pipelined method calls to accumulate before writing them out */
+#define VARLINK_WRITE_BATCH_MAX (64U*1024U)
+
+/* Once CBOR encoding is negotiated each message is preceded by its size as 32-bit big-endian integer, in
+ * place of the NUL byte terminating JSON messages, as CBOR data may contain NUL bytes itself */
+#define VARLINK_FRAME_HEADER_SIZE sizeof(uint32_t)
 #define VARLINK_COLLECT_MAX 1024U
 
 static const char* const varlink_state_table[_VARLINK_STATE_MAX] = {
@@ -702,6 +712,23 @@ disconnect:
         return 1;
 }
 
+static bool varlink_write_deferrable(sd_varlink *v) {
+        assert(v);
+
+        /* If the client pipelined further method calls that are already buffered, let's process those
+         * first, so that the replies to all of them go out in a single write. Bounded, so that neither the
+         * output buffer grows without limit nor the first reply is delayed for too long. */
+
+        if (v->state != VARLINK_IDLE_SERVER)
+                return false;
+        if (!v->current && v->input_buffer_size == 0)
+                return false;
+        if (v->n_output_fds > 0 || v->output_queue)
+                return false;
+
+        return v->output_buffer_size < VARLINK_WRITE_BATCH_MAX;
+}
+
 static int varlink_write(sd_varlink *v) {
         ssize_t n;
         int r;
@@ -934,7 +961,6 @@ static int varlink_read(sd_varlink *v) {
 }
 
 static int varlink_parse_message(sd_varlink *v) {
-        const char *e;
         char *begin;
         size_t sz;
         int r;
@@ -951,22 +977,47 @@ static int varlink_parse_message(sd_varlink *v) {
 
         begin = v->input_buffer + v->input_buffer_index;
 
-        e = memchr(begin + v->input_buffer_size - v->input_buffer_unscanned, 0, v->input_buffer_unscanned);
-        if (!e) {
-                v->input_buffer_unscanned = 0;
-                return 0;
-        }
+        if (v->binary_encoding) {
+                uint32_t n;
+
+                if (v->input_buffer_size < VARLINK_FRAME_HEADER_SIZE) {
+                        v->input_buffer_unscanned = 0;
+                        return 0;
+                }
+
+                n = unaligned_read_be32(begin);
+                if (n > VARLINK_BUFFER_MAX - VARLINK_FRAME_HEADER_SIZE) {
+                        v->input_buffer_index = v->input_buffer_size = v->input_buffer_unscanned = 0;
+                        return varlink_log_errno(v, SYNTHETIC_ERRNO(EBADMSG), "Announced message size too large, refusing.");
+                }
+
+                sz = VARLINK_FRAME_HEADER_SIZE + n;
+                if (v->input_buffer_size < sz) {
+                        v->input_buffer_unscanned = 0;
+                        return 0;
+                }
+
+                r = json_variant_from_cbor(begin + VARLINK_FRAME_HEADER_SIZE, n, &v->current);
+        } else {
+                const char *e;
+
+                e = memchr(begin + v->input_buffer_size - v->input_buffer_unscanned, 0, v->input_buffer_unscanned);
+                if (!e) {
+                        v->input_buffer_unscanned = 0;
+                        return 0;
+                }
 
-        sz = e - begin + 1;
+                sz = e - begin + 1;
 
-        r = sd_json_parse(begin, 0, &v->current, NULL, NULL);
+                r = sd_json_parse(begin, 0, &v->current, NULL, NULL);
+        }
         if (v->input_sensitive)
                 explicit_bzero_safe(begin, sz);
         if (r < 0) {
                 /* If we encounter a parse failure flush all data. We cannot possibly recover from this,
                  * hence drop all buffered data now. */
                 v->input_buffer_index = v->input_buffer_size = v->input_buffer_unscanned = 0;
-                return varlink_log_errno(v, r, "Failed to parse JSON: %m");
+                return varlink_log_errno(v, r, "Failed to parse %s message: %m", v->binary_encoding ? "CBOR" : "JSON");
         }
 
         if (v->input_sensitive) {
@@ -1255,6 +1306,46 @@ static int generic_method_get_interface_description(
                         SD_JSON_BUILD_PAIR_STRING("description", text));
 }
 
+static int generic_method_set_encoding(
+                sd_varlink *link,
+                sd_json_variant *parameters,
+                sd_varlink_method_flags_t flags,
+                void *userdata) {
+
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "encoding", SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, 0, SD_JSON_MANDATORY },
+                {}
+        };
+        const char *encoding = NULL;
+        int r;
+
+        assert(link);
+
+        r = sd_varlink_dispatch(link, parameters, dispatch_table, &encoding);
+        if (r != 0)
+                return r;
+
+        if (!streq(encoding, "cbor"))
+                return sd_varlink_error_invalid_parameter_name(link, "encoding");
+
+        /* Without a reply the client cannot know when to switch */
+        if (FLAGS_SET(flags, SD_VARLINK_METHOD_ONEWAY))
+                return 0;
+
+        /* The reply itself must still go out as JSON, hence refuse if it would be queued behind other
+         * messages and only formatted later */
+        if (link->binary_encoding || link->output_queue || link->n_pushed_fds > 0)
+                return sd_varlink_error_errno(link, -EBUSY);
+
+        r = sd_varlink_reply(link, NULL);
+        if (r < 0)
+                return r;
+
+        link->binary_encoding = true;
+        varlink_log(link, "Switched to CBOR encoding.");
+        return 0;
+}
+
 static int varlink_dispatch_method(sd_varlink *v) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *parameters = NULL;
         sd_varlink_method_flags_t flags = 0;
@@ -1338,6 +1429,8 @@ static int varlink_dispatch_method(sd_varlink *v) {
                         callback = generic_method_get_info;
                 else if (streq(method, "org.varlink.service.GetInterfaceDescription"))
                         callback = generic_method_get_interface_description;
+                else if (streq(method, "io.systemd.SetEncoding"))
+                        callback = generic_method_set_encoding;
         }
 
         if (callback) {
@@ -1445,11 +1538,13 @@ _public_ int sd_varlink_process(sd_varlink *v) {
 
         sd_varlink_ref(v);
 
-        r = varlink_write(v);
-        if (r < 0)
-                varlink_log_errno(v, r, "Write failed: %m");
-        if (r != 0)
-                goto finish;
+        if (!varlink_write_deferrable(v)) {
+                r = varlink_write(v);
+                if (r < 0)
+                        varlink_log_errno(v, r, "Write failed: %m");
+                if (r != 0)
+                        goto finish;
+        }
 
         r = varlink_dispatch_reply(v);
         if (r < 0)
@@ -1469,6 +1564,13 @@ _public_ int sd_varlink_process(sd_varlink *v) {
         if (r != 0)
                 goto finish;
 
+        /* Nothing complete left to process, hence flush whatever replies we held back above */
+        r = varlink_write(v);
+        if (r < 0)
+                varlink_log_errno(v, r, "Write failed: %m");
+        if (r != 0)
+                goto finish;
+
         r = varlink_read(v);
         if (r < 0)
                 varlink_log_errno(v, r, "Read failed: %m");
@@ -1825,21 +1927,68 @@ _public_ sd_varlink* sd_varlink_flush_close_unref(sd_varlink *v) {
         return sd_varlink_close_unref(v);
 }
 
-static int varlink_format_json(sd_varlink *v, sd_json_variant *m) {
-        _cleanup_(erase_and_freep) char *text = NULL;
-        int sz, r;
+static int varlink_format_cbor(sd_varlink *v, sd_json_variant *m) {
+        bool sensitive;
+        size_t n;
+        char *p;
 
         assert(v);
         assert(m);
 
-        sz = sd_json_variant_format(m, /* flags= */ 0, &text);
-        if (sz < 0)
-                return sz;
-        assert(text[sz] == '\0');
+        /* The encoded size is known up front, hence the output buffer is grown at most once and the message
+         * is serialized straight into it. */
 
-        if (v->output_buffer_size + sz + 1 > VARLINK_BUFFER_MAX)
+        n = json_variant_cbor_size(m);
+        if (n > VARLINK_BUFFER_MAX - VARLINK_FRAME_HEADER_SIZE ||
+            v->output_buffer_size + VARLINK_FRAME_HEADER_SIZE + n > VARLINK_BUFFER_MAX)
                 return -ENOBUFS;
 
+        sensitive = v->output_buffer_sensitive || sd_json_variant_is_sensitive_recursive(m);
+        if (sensitive) {
+                char *b;
+
+                /* Don't let realloc() leave copies of sensitive data behind: move what's pending into a new
+                 * buffer of the final size, and erase the old one. */
+                b = new(char, v->output_buffer_size + VARLINK_FRAME_HEADER_SIZE + n);
+                if (!b)
+                        return -ENOMEM;
+
+                memcpy_safe(b, v->output_buffer + v->output_buffer_index, v->output_buffer_size);
+                erase_and_free(v->output_buffer);
+                v->output_buffer = b;
+                v->output_buffer_index = 0;
+
+        } else {
+                if (v->output_buffer_size == 0)
+                        v->output_buffer_index = 0;
+                else if (v->output_buffer_index > 0) {
+                        memmove(v->output_buffer, v->output_buffer + v->output_buffer_index, v->output_buffer_size);
+                        v->output_buffer_index = 0;
+                }
+
+                if (!GREEDY_REALLOC(v->output_buffer, v->output_buffer_size + VARLINK_FRAME_HEADER_SIZE + n))
+                        return -ENOMEM;
+        }
+
+        p = v->output_buffer + v->output_buffer_size;
+        unaligned_write_be32(p, n);
+        assert_se(json_variant_write_cbor(m, p + VARLINK_FRAME_HEADER_SIZE) == p + VARLINK_FRAME_HEADER_SIZE + n);
+
+        v->output_buffer_size += VARLINK_FRAME_HEADER_SIZE + n;
+
+        if (sensitive)
+                v->output_buffer_sensitive = true; /* Propagate sensitive flag */
+
+        return 0;
+}
+
+static int varlink_format_json(sd_varlink *v, sd_json_variant *m) {
+        _cleanup_(erase_and_freep) char *text = NULL;
+        int sz, r;
+
+        assert(v);
+        assert(m);
+
         if (DEBUG_LOGGING) {
                 _cleanup_(erase_and_freep) char *censored_text = NULL;
 
@@ -1851,6 +2000,40 @@ static int varlink_format_json(sd_varlink *v, sd_json_variant *m) {
                 varlink_log(v, "Sending message: %s", censored_text);
         }
 
+        if (v->binary_encoding)
+                return varlink_format_cbor(v, m);
+
+        if (!v->output_buffer_sensitive && !sd_json_variant_is_sensitive_recursive(m)) {
+                size_t size;
+
+                /* The common case: format the message directly into the output buffer, reusing its
+                 * allocation. Sensitive data takes the slow path below, so that no partial copies of it are
+                 * left behind in memory when the buffer is reallocated while formatting. */
+
+                if (v->output_buffer_size == 0)
+                        v->output_buffer_index = 0;
+                else if (v->output_buffer_index > 0) {
+                        memmove(v->output_buffer, v->output_buffer + v->output_buffer_index, v->output_buffer_size);
+                        v->output_buffer_index = 0;
+                }
+
+                size = v->output_buffer_size;
+                r = json_variant_format_append(m, /* flags= */ 0, &v->output_buffer, &size, VARLINK_BUFFER_MAX);
+                if (r < 0)
+                        return r;
+
+                v->output_buffer_size = size;
+                return 0;
+        }
+
+        sz = sd_json_variant_format(m, /* flags= */ 0, &text);
+        if (sz < 0)
+                return sz;
+        assert(text[sz] == '\0');
+
+        if (v->output_buffer_size + sz + 1 > VARLINK_BUFFER_MAX)
+                return -ENOBUFS;
+
         if (v->output_buffer_size == 0) {
 
                 free_and_replace(v->output_buffer, text);
@@ -1880,11 +2063,7 @@ static int varlink_format_json(sd_varlink *v, sd_json_variant *m) {
                 v->output_buffer_index = 0;
         }
 
-        if (sd_json_variant_is_sensitive_recursive(m))
-                v->output_buffer_sensitive = true; /* Propagate sensitive flag */
-        else
-                text = mfree(text); /* No point in the erase_and_free() destructor declared above */
-
+        v->output_buffer_sensitive = true; /* Propagate sensitive flag */
         return 0;
 }
 
@@ -3210,6 +3389,38 @@ _public_ int sd_varlink_set_input_sensitive(sd_varlink *v) {
         return 0;
 }
 
+int varlink_negotiate_binary_encoding(sd_varlink *v) {
+        const char *error_id = NULL;
+        int r;
+
+        assert(v);
+        assert(!v->server);
+
+        /* Asks the server to switch this connection from JSON text to CBOR. Returns > 0 if the encoding was
+         * switched, 0 if the server doesn't support it, in which case JSON continues to be used. */
+
+        if (v->binary_encoding)
+                return 1;
+
+        r = sd_varlink_callbo(
+                        v,
+                        "io.systemd.SetEncoding",
+                        /* ret_parameters= */ NULL,
+                        &error_id,
+                        SD_JSON_BUILD_PAIR_STRING("encoding", "cbor"));
+        if (r < 0)
+                return r;
+        if (error_id) {
+                varlink_log(v, "Server refused CBOR encoding (%s), continuing with JSON.", error_id);
+                return 0;
+        }
+
+        /* Neither side sends anything unprompted, hence nothing is pending that is still in JSON */
+        v->binary_encoding = true;
+        varlink_log(v, "Switched to CBOR encoding.");
+        return 1;
+}
+
 _public_ int sd_varlink_server_new(sd_varlink_server **ret, sd_varlink_server_flags_t flags) {
         _cleanup_(sd_varlink_server_unrefp) sd_varlink_server *s = NULL;
         int r;
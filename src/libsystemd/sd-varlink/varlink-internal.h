@@ -172,6 +172,8 @@ struct sd_varlink {
         bool output_buffer_sensitive:1; /* whether to erase the output buffer after writing it to the socket */
         bool input_sensitive:1; /* Whether incoming messages might be sensitive */
 
+        bool binary_encoding:1; /* Whether the peers agreed to exchange CBOR instead of JSON text */
+
         int af; /* address family if socket; AF_UNSPEC if not socket; negative if not known */
 
         usec_t timestamp;
@@ -258,4 +260,7 @@ static inline const char* varlink_server_description(sd_varlink_server *s) {
 VarlinkServerSocket* varlink_server_socket_free(VarlinkServerSocket *ss);
 DEFINE_TRIVIAL_CLEANUP_FUNC(VarlinkServerSocket *, varlink_server_socket_free);
 
+/* Switches the connection to a compact binary encoding, if the server supports it */
+int varlink_negotiate_binary_encoding(sd_varlink *v);
+
 int varlink_server_add_socket_event_source(sd_varlink_server *s, VarlinkServerSocket *ss, int64_t priority);
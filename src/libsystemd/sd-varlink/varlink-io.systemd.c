@@ -2,6 +2,11 @@
 
 #include "varlink-io.systemd.h"
 
+static SD_VARLINK_DEFINE_METHOD(
+                SetEncoding,
+                SD_VARLINK_FIELD_COMMENT("The encoding to use for all further messages on this connection in both directions, once this call was replied to. Only 'cbor' is currently supported. Messages are then framed by a 32-bit big-endian length prefix instead of a trailing NUL byte."),
+                SD_VARLINK_DEFINE_INPUT(encoding, SD_VARLINK_STRING, 0));
+
 /* These are local errors that never cross the wire, and are our own invention */
 static SD_VARLINK_DEFINE_ERROR(Disconnected);
 static SD_VARLINK_DEFINE_ERROR(TimedOut);
@@ -15,6 +20,8 @@ static SD_VARLINK_DEFINE_ERROR(
 SD_VARLINK_DEFINE_INTERFACE(
                 io_systemd,
                 "io.systemd",
+                SD_VARLINK_SYMBOL_COMMENT("Switches the connection from JSON text to an equivalent binary encoding"),
+                &vl_method_SetEncoding,
                 &vl_error_Disconnected,
                 &vl_error_TimedOut,
                 &vl_error_Protocol,
@@ -1,7 +1,13 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "sd-event.h"
+
 #include "alloc-util.h"
 #include "errno-util.h"
+#include "fd-util.h"
 #include "string-util.h"
 #include "varlink-internal.h"
 #include "varlink-util.h"
@@ -173,3 +179,177 @@ int varlink_server_new(
         *ret = TAKE_PTR(s);
         return 0;
 }
+
+typedef struct VarlinkThread {
+        pthread_t thread;
+        bool running;
+
+        sd_event *event;
+        sd_varlink_server *server;
+        int exit_fd;
+} VarlinkThread;
+
+struct VarlinkThreadPool {
+        VarlinkThread *threads;
+        size_t n_threads;
+};
+
+static int on_thread_exit_request(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        return sd_event_exit(sd_event_source_get_event(s), 0);
+}
+
+static void* varlink_thread_run(void *userdata) {
+        VarlinkThread *t = ASSERT_PTR(userdata);
+        int r;
+
+        r = sd_event_loop(t->event);
+        if (r < 0)
+                log_debug_errno(r, "Varlink server thread event loop failed: %m");
+
+        return NULL;
+}
+
+static int varlink_thread_setup(
+                VarlinkThread *t,
+                int listen_fd,
+                sd_varlink_server_flags_t flags,
+                varlink_server_setup_t setup,
+                void *userdata) {
+
+        _cleanup_close_ int fd = -EBADF;
+        int r;
+
+        assert(t);
+        assert(listen_fd >= 0);
+        assert(setup);
+
+        r = sd_event_new(&t->event);
+        if (r < 0)
+                return r;
+
+        t->exit_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if (t->exit_fd < 0)
+                return -errno;
+
+        r = sd_event_add_io(t->event, NULL, t->exit_fd, EPOLLIN, on_thread_exit_request, NULL);
+        if (r < 0)
+                return r;
+
+        r = varlink_server_new(&t->server, flags, userdata);
+        if (r < 0)
+                return r;
+
+        r = setup(t->server, userdata);
+        if (r < 0)
+                return r;
+
+        /* Every thread gets its own copy of the listening socket, the kernel hands each incoming connection
+         * to whichever thread accept()s it first */
+        fd = fcntl(listen_fd, F_DUPFD_CLOEXEC, 3);
+        if (fd < 0)
+                return -errno;
+
+        r = sd_varlink_server_listen_fd(t->server, fd);
+        if (r < 0)
+                return r;
+        TAKE_FD(fd);
+
+        return sd_varlink_server_attach_event(t->server, t->event, SD_EVENT_PRIORITY_NORMAL);
+}
+
+int varlink_thread_pool_start(
+                VarlinkThreadPool **ret,
+                int listen_fd,
+                unsigned n_threads,
+                sd_varlink_server_flags_t flags,
+                varlink_server_setup_t setup,
+                void *userdata) {
+
+        _cleanup_(varlink_thread_pool_stopp) VarlinkThreadPool *p = NULL;
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(ret);
+        assert(listen_fd >= 0);
+        assert(n_threads > 0);
+        assert(setup);
+
+        p = new(VarlinkThreadPool, 1);
+        if (!p)
+                return -ENOMEM;
+
+        *p = (VarlinkThreadPool) {};
+
+        p->threads = new(VarlinkThread, n_threads);
+        if (!p->threads)
+                return -ENOMEM;
+
+        /* All objects are created here, and destroyed again in varlink_thread_pool_stop(), from the calling
+         * thread. The threads themselves only run the event loops. */
+        for (; p->n_threads < n_threads; p->n_threads++) {
+                VarlinkThread *t = p->threads + p->n_threads;
+
+                *t = (VarlinkThread) {
+                        .exit_fd = -EBADF,
+                };
+
+                r = varlink_thread_setup(t, listen_fd, flags, setup, userdata);
+                if (r < 0) {
+                        p->n_threads++; /* so that the partially initialized entry is released too */
+                        return log_debug_errno(r, "Failed to set up varlink server thread: %m");
+                }
+        }
+
+        /* No signals in the worker threads please, they are left to the main thread */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        FOREACH_ARRAY(t, p->threads, p->n_threads) {
+                r = pthread_create(&t->thread, NULL, varlink_thread_run, t);
+                if (r > 0) {
+                        r = log_debug_errno(r, "Failed to start varlink server thread: %m");
+                        break;
+                }
+
+                t->running = true;
+                r = 0;
+        }
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r < 0)
+                return r;
+        if (k > 0)
+                return -k;
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+VarlinkThreadPool* varlink_thread_pool_stop(VarlinkThreadPool *p) {
+        if (!p)
+                return NULL;
+
+        /* First ask all threads to exit, so that they wind down in parallel, then wait for them */
+        FOREACH_ARRAY(t, p->threads, p->n_threads)
+                if (t->running && eventfd_write(t->exit_fd, 1) < 0)
+                        log_debug_errno(errno, "Failed to ask varlink server thread to exit: %m");
+
+        FOREACH_ARRAY(t, p->threads, p->n_threads) {
+                if (t->running) {
+                        int r;
+
+                        r = pthread_join(t->thread, NULL);
+                        if (r > 0)
+                                log_debug_errno(r, "Failed to join varlink server thread: %m");
+                }
+
+                sd_varlink_server_unref(t->server);
+                sd_event_unref(t->event);
+                safe_close(t->exit_fd);
+        }
+
+        free(p->threads);
+        return mfree(p);
+}
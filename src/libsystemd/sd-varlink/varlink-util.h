@@ -25,3 +25,20 @@ int varlink_server_new(
                 sd_varlink_server **ret,
                 sd_varlink_server_flags_t flags,
                 void *userdata);
+
+/* Serves a listening socket from a fixed number of threads, each running its own server object and event
+ * loop. The setup callback is invoked once per thread to bind methods and interfaces, and the method
+ * handlers must be thread-safe. */
+typedef int (*varlink_server_setup_t)(sd_varlink_server *server, void *userdata);
+
+typedef struct VarlinkThreadPool VarlinkThreadPool;
+
+int varlink_thread_pool_start(
+                VarlinkThreadPool **ret,
+                int listen_fd,
+                unsigned n_threads,
+                sd_varlink_server_flags_t flags,
+                varlink_server_setup_t setup,
+                void *userdata);
+VarlinkThreadPool* varlink_thread_pool_stop(VarlinkThreadPool *p);
+DEFINE_TRIVIAL_CLEANUP_FUNC(VarlinkThreadPool*, varlink_thread_pool_stop);
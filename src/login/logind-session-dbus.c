@@ -938,8 +938,9 @@ int session_send_create_reply(Session *s, sd_bus_error *error) {
         if (fifo_fd < 0)
                 return fifo_fd;
 
-        /* Update the session state file before we notify the client about the result. */
+        /* Update the session and user state files before we notify the client about the result. */
         session_save(s);
+        (void) user_save_now(s->user);
 
         p = session_bus_path(s);
         if (!p)
@@ -984,6 +985,7 @@ int session_send_upgrade_reply(Session *s, sd_bus_error *error) {
                 return sd_bus_reply_method_error(c, error);
 
         session_save(s);
+        (void) user_save_now(s->user);
 
         return sd_bus_reply_method_return(c, NULL);
 }
@@ -102,6 +102,16 @@ int user_new(Manager *m, UserRecord *ur, User **ret) {
         return 0;
 }
 
+static void user_drop_from_save_queue(User *u) {
+        assert(u);
+
+        if (!u->in_save_queue)
+                return;
+
+        LIST_REMOVE(save_queue, u->manager->user_save_queue, u);
+        u->in_save_queue = false;
+}
+
 User *user_free(User *u) {
         if (!u)
                 return NULL;
@@ -109,6 +119,8 @@ User *user_free(User *u) {
         if (u->in_gc_queue)
                 LIST_REMOVE(gc_queue, u->manager->user_gc_queue, u);
 
+        user_drop_from_save_queue(u);
+
         while (u->sessions)
                 session_free(u->sessions);
 
@@ -149,6 +161,9 @@ static int user_save_internal(User *u) {
         assert(u);
         assert(u->state_file);
 
+        /* Whatever was queued is written now */
+        user_drop_from_save_queue(u);
+
         r = mkdir_safe_label("/run/systemd/users", 0755, 0, 0, MKDIR_WARN_MODE);
         if (r < 0)
                 goto fail;
@@ -304,9 +319,46 @@ int user_save(User *u) {
         if (!u->started)
                 return 0;
 
+        /* The state file lists all sessions of the user, which makes it expensive to write for users with
+         * thousands of sessions. A single session change usually saves the user several times in a row,
+         * hence only queue it here, and write it once per event loop iteration. */
+        if (!u->in_save_queue) {
+                LIST_PREPEND(save_queue, u->manager->user_save_queue, u);
+                u->in_save_queue = true;
+        }
+
+        return 0;
+}
+
+int user_save_now(User *u) {
+        assert(u);
+
+        /* Writes out the state file right away if a write is queued, for when clients are about to be told
+         * about a change and might look at the state file afterwards. */
+
+        if (!u->in_save_queue)
+                return 0;
+
+        if (!u->started) {
+                user_drop_from_save_queue(u);
+                return 0;
+        }
+
+        /* Dequeues the user */
         return user_save_internal(u);
 }
 
+void manager_flush_user_save_queue(Manager *m) {
+        User *u;
+
+        assert(m);
+
+        while ((u = m->user_save_queue)) {
+                (void) user_save_now(u);
+                assert(!u->in_save_queue);
+        }
+}
+
 int user_load(User *u) {
         _cleanup_free_ char *realtime = NULL, *monotonic = NULL, *stopping = NULL, *last_session_timestamp = NULL, *gc_mode = NULL;
         int r;
@@ -623,6 +675,8 @@ int user_finalize(User *u) {
         if (u->manager->remove_ipc && !uid_is_system(u->user_record->uid))
                 RET_GATHER(r, clean_ipc_by_uid(u->user_record->uid));
 
+        /* Don't let a pending save resurrect the state file */
+        user_drop_from_save_queue(u);
         (void) unlink(u->state_file);
         user_add_to_gc_queue(u);
 
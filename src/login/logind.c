@@ -1197,10 +1197,13 @@ static int manager_run(Manager *m) {
                 r = sd_event_get_state(m->event);
                 if (r < 0)
                         return r;
-                if (r == SD_EVENT_FINISHED)
+                if (r == SD_EVENT_FINISHED) {
+                        manager_flush_user_save_queue(m);
                         return 0;
+                }
 
                 manager_gc(m, true);
+                manager_flush_user_save_queue(m);
 
                 r = manager_dispatch_delayed(m, false);
                 if (r < 0)
@@ -5,10 +5,13 @@
 #include "env-file.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "image-policy.h"
 #include "iovec-util.h"
 #include "machined.h"
+#include "path-util.h"
 #include "process-util.h"
 #include "socket-util.h"
+#include "stat-util.h"
 #include "strv.h"
 #include "user-util.h"
 
@@ -482,3 +485,151 @@ int rename_image_and_update_cache(Manager *m, Image *image, const char* new_name
 
         return 0;
 }
+
+/* Don't let the cache grow without bounds if images come and go */
+#define IMAGE_METADATA_CACHE_MAX 1024U
+
+typedef struct ImageMetadataCacheEntry {
+        char *path;
+        struct stat st;
+        Image *image;
+} ImageMetadataCacheEntry;
+
+static ImageMetadataCacheEntry* image_metadata_cache_entry_free(ImageMetadataCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->path);
+        image_unref(e->image);
+        return mfree(e);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ImageMetadataCacheEntry*, image_metadata_cache_entry_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                image_metadata_cache_hash_ops,
+                char, path_hash_func, path_compare,
+                ImageMetadataCacheEntry, image_metadata_cache_entry_free);
+
+static bool image_metadata_cache_entry_matches(const ImageMetadataCacheEntry *e, const struct stat *st) {
+        assert(e);
+        assert(st);
+
+        return stat_inode_same(&e->st, st) &&
+                e->st.st_size == st->st_size &&
+                timespec_load_nsec(&e->st.st_mtim) == timespec_load_nsec(&st->st_mtim) &&
+                timespec_load_nsec(&e->st.st_ctim) == timespec_load_nsec(&st->st_ctim);
+}
+
+static int strv_copy_or_null(char **l, char ***ret) {
+        assert(ret);
+
+        if (!l) {
+                *ret = NULL;
+                return 0;
+        }
+
+        *ret = strv_copy(l);
+        return *ret ? 0 : -ENOMEM;
+}
+
+static int image_copy_metadata(Image *dest, const Image *src) {
+        _cleanup_strv_free_ char **machine_info = NULL, **os_release = NULL, **sysext_release = NULL, **confext_release = NULL;
+        _cleanup_free_ char *hostname = NULL;
+        int r;
+
+        assert(dest);
+        assert(src);
+        assert(src->metadata_valid);
+
+        if (src->hostname) {
+                hostname = strdup(src->hostname);
+                if (!hostname)
+                        return -ENOMEM;
+        }
+
+        r = strv_copy_or_null(src->machine_info, &machine_info);
+        if (r < 0)
+                return r;
+
+        r = strv_copy_or_null(src->os_release, &os_release);
+        if (r < 0)
+                return r;
+
+        r = strv_copy_or_null(src->sysext_release, &sysext_release);
+        if (r < 0)
+                return r;
+
+        r = strv_copy_or_null(src->confext_release, &confext_release);
+        if (r < 0)
+                return r;
+
+        free_and_replace(dest->hostname, hostname);
+        dest->machine_id = src->machine_id;
+        strv_free_and_replace(dest->machine_info, machine_info);
+        strv_free_and_replace(dest->os_release, os_release);
+        strv_free_and_replace(dest->sysext_release, sysext_release);
+        strv_free_and_replace(dest->confext_release, confext_release);
+        dest->metadata_valid = true;
+
+        return 0;
+}
+
+int manager_image_read_metadata(Manager *m, Image *image) {
+        _cleanup_(image_metadata_cache_entry_freep) ImageMetadataCacheEntry *e = NULL;
+        ImageMetadataCacheEntry *existing;
+        struct stat st;
+        int r;
+
+        assert(m);
+        assert(image);
+
+        if (image->metadata_valid)
+                return 0;
+
+        /* Reading the metadata of raw images means setting up a loopback device, dissecting it and forking
+         * off a child to mount it, which is slow when listing many of them. Hence remember it, for as long
+         * as the file is not replaced or modified. Directory trees are cheap to inspect (and may change
+         * without the top-level directory noticing), and block devices may change under our feet, hence
+         * don't bother with them. */
+
+        if (image->type != IMAGE_RAW || stat(image->path, &st) < 0 || !S_ISREG(st.st_mode))
+                return image_read_metadata(image, &image_policy_container);
+
+        existing = hashmap_get(m->image_metadata_cache, image->path);
+        if (existing) {
+                if (image_metadata_cache_entry_matches(existing, &st))
+                        return image_copy_metadata(image, existing->image);
+
+                image_metadata_cache_entry_free(hashmap_remove(m->image_metadata_cache, image->path));
+        }
+
+        r = image_read_metadata(image, &image_policy_container);
+        if (r < 0)
+                return r;
+
+        e = new(ImageMetadataCacheEntry, 1);
+        if (!e)
+                return log_oom_debug();
+
+        *e = (ImageMetadataCacheEntry) {
+                .st = st,
+                .image = image_ref(image),
+        };
+
+        /* Not keyed by the path of the image object, since that changes when the image is renamed */
+        e->path = strdup(image->path);
+        if (!e->path)
+                return log_oom_debug();
+
+        if (hashmap_size(m->image_metadata_cache) >= IMAGE_METADATA_CACHE_MAX)
+                hashmap_clear(m->image_metadata_cache);
+
+        r = hashmap_ensure_put(&m->image_metadata_cache, &image_metadata_cache_hash_ops, e->path, e);
+        if (r < 0)
+                log_debug_errno(r, "Failed to cache metadata of image '%s', ignoring: %m", image->path);
+        else
+                TAKE_PTR(e);
+
+        return 0;
+}
@@ -92,6 +92,7 @@ static Manager* manager_unref(Manager *m) {
         hashmap_free(m->machines_by_leader);
 
         hashmap_free(m->image_cache);
+        hashmap_free(m->image_metadata_cache);
 
         sd_event_source_unref(m->image_cache_defer_event);
 
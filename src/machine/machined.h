@@ -33,6 +33,9 @@ struct Manager {
         Hashmap *image_cache;
         sd_event_source *image_cache_defer_event;
 
+        /* Metadata read from raw images, keyed by path, valid as long as the file isn't replaced or modified */
+        Hashmap *image_metadata_cache;
+
         LIST_HEAD(Machine, machine_gc_queue);
 
         Machine *host_machine;
@@ -72,3 +75,4 @@ int machine_get_addresses(Machine* machine, struct local_address **ret_addresses
 int machine_get_os_release(Machine *machine, char ***ret_os_release);
 int manager_acquire_image(Manager *m, const char *name, Image **ret);
 int rename_image_and_update_cache(Manager *m, Image *image, const char* new_name);
+int manager_image_read_metadata(Manager *m, Image *image);
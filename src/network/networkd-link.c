@@ -63,6 +63,7 @@
 #include "networkd-wifi.h"
 #include "set.h"
 #include "socket-util.h"
+#include "sort-util.h"
 #include "stdio-util.h"
 #include "string-table.h"
 #include "strv.h"
@@ -276,6 +277,7 @@ static Link *link_free(Link *link) {
 
         unlink_and_free(link->lease_file);
         unlink_and_free(link->state_file);
+        free(link->state_file_contents);
 
         sd_device_unref(link->dev);
         netdev_unref(link->netdev);
@@ -1071,6 +1073,7 @@ static Link *link_drop(Link *link) {
 
         if (link->state_file)
                 (void) unlink(link->state_file);
+        link->state_file_contents = mfree(link->state_file_contents);
 
         link_clean(link);
 
@@ -1276,17 +1279,104 @@ static int link_configure(Link *link) {
         return link_acquire_dynamic_conf(link);
 }
 
-static int link_get_network(Link *link, Network **ret) {
+static int network_compare_order(Network * const *a, Network * const *b) {
+        return CMP((*a)->order, (*b)->order);
+}
+
+static int network_candidates_add_by_ifname(Manager *m, const char *ifname, Network ***networks, size_t *n) {
         Network *network;
+        OrderedSet *s;
+
+        assert(m);
+        assert(ifname);
+        assert(networks);
+        assert(n);
+
+        s = hashmap_get(m->networks_by_ifname, ifname);
+        ORDERED_SET_FOREACH(network, s) {
+                if (!GREEDY_REALLOC(*networks, *n + 1))
+                        return -ENOMEM;
+
+                (*networks)[(*n)++] = network;
+        }
+
+        return 0;
+}
+
+static int link_get_network_candidates(Link *link, Network ***ret, size_t *ret_n) {
+        _cleanup_free_ Network **networks = NULL;
+        size_t n = 0;
+        Network *network;
+        Manager *m;
+        int r;
+
+        assert(link);
+        assert(ret);
+        assert(ret_n);
+
+        /* Returns the .network files which may match the link, in the order they need to be tested. */
+
+        m = ASSERT_PTR(link->manager);
+
+        if (!m->networks_indexed) {
+                ORDERED_HASHMAP_FOREACH(network, m->networks) {
+                        if (!GREEDY_REALLOC(networks, n + 1))
+                                return -ENOMEM;
+
+                        networks[n++] = network;
+                }
+
+                *ret = TAKE_PTR(networks);
+                *ret_n = n;
+                return 0;
+        }
+
+        if (m->n_networks_unindexed > 0) {
+                networks = newdup(Network*, m->networks_unindexed, m->n_networks_unindexed);
+                if (!networks)
+                        return -ENOMEM;
+
+                n = m->n_networks_unindexed;
+        }
+
+        r = network_candidates_add_by_ifname(m, link->ifname, &networks, &n);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(p, link->alternative_names) {
+                r = network_candidates_add_by_ifname(m, *p, &networks, &n);
+                if (r < 0)
+                        return r;
+        }
+
+        typesafe_qsort(networks, n, network_compare_order);
+
+        *ret = TAKE_PTR(networks);
+        *ret_n = n;
+        return 0;
+}
+
+static int link_get_network(Link *link, Network **ret) {
+        _cleanup_free_ Network **networks = NULL;
+        size_t n_networks;
         int r;
 
         assert(link);
         assert(link->manager);
         assert(ret);
 
-        ORDERED_HASHMAP_FOREACH(network, link->manager->networks) {
+        r = link_get_network_candidates(link, &networks, &n_networks);
+        if (r < 0)
+                return r;
+
+        for (size_t i = 0; i < n_networks; i++) {
+                Network *network = networks[i];
                 bool warn = false;
 
+                /* A .network file may be found by both the interface name and an alternative name. */
+                if (i > 0 && networks[i - 1] == network)
+                        continue;
+
                 r = net_match_config(
                                 &network->match,
                                 link->dev,
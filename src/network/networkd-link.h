@@ -68,6 +68,7 @@ typedef struct Link {
         char *kind;
         unsigned short iftype;
         char *state_file;
+        char *state_file_contents; /* What we last wrote to the state file */
         struct hw_addr_data hw_addr;
         struct hw_addr_data bcast_addr;
         struct hw_addr_data permanent_hw_addr;
@@ -669,6 +669,7 @@ Manager* manager_free(Manager *m) {
         manager_remove_sysctl_monitor(m);
 
         free(m->state_file);
+        free(m->state_file_contents);
 
         m->request_queue = ordered_set_free(m->request_queue);
         m->remove_request_queue = ordered_set_free(m->remove_request_queue);
@@ -681,6 +682,7 @@ Manager* manager_free(Manager *m) {
         m->links_by_index = hashmap_free_with_destructor(m->links_by_index, link_unref);
 
         m->dhcp_pd_subnet_ids = set_free(m->dhcp_pd_subnet_ids);
+        manager_clear_network_index(m);
         m->networks = ordered_hashmap_free_with_destructor(m->networks, network_unref);
 
         /* The same object may be registered with multiple names, and netdev_detach() may drop multiple
@@ -706,6 +708,7 @@ Manager* manager_free(Manager *m) {
         sd_resolve_unref(m->resolve);
 
         m->routes = set_free(m->routes);
+        m->route_filter_keys = set_free(m->route_filter_keys);
 
         m->nexthops_by_id = hashmap_free(m->nexthops_by_id);
         m->nexthop_ids = set_free(m->nexthop_ids);
@@ -807,6 +810,10 @@ int manager_load_config(Manager *m) {
         if (r < 0)
                 return log_debug_errno(r, "Failed to load .network files: %m");
 
+        r = manager_build_network_index(m);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to build .network file index: %m");
+
         r = manager_build_dhcp_pd_subnet_ids(m);
         if (r < 0)
                 return log_debug_errno(r, "Failed to build DHCP-PD subnet ID map: %m");
@@ -57,6 +57,7 @@ struct Manager {
         Set *new_wlan_ifindices;
 
         char *state_file;
+        char *state_file_contents; /* What we last wrote to the state file */
         LinkOperationalState operational_state;
         LinkCarrierState carrier_state;
         LinkAddressState address_state;
@@ -70,6 +71,12 @@ struct Manager {
         Hashmap *links_by_dhcp_pd_subnet_prefix;
         Hashmap *netdevs;
         OrderedHashmap *networks;
+        /* .network files that can only match links with the interface names listed in their Name=, indexed
+         * by these names, and all others in the order they were loaded. See link_get_network(). */
+        Hashmap *networks_by_ifname;
+        Network **networks_unindexed;
+        size_t n_networks_unindexed;
+        bool networks_indexed;
         OrderedSet *address_pools;
         Set *dhcp_pd_subnet_ids;
 
@@ -96,6 +103,9 @@ struct Manager {
         /* Manager stores routes without RTA_OIF attribute. */
         unsigned route_remove_messages;
         Set *routes;
+        /* Tables (and for IPv4 also protocols) of routes we requested or remembered. Used to drop
+         * notifications about foreign routes early when ManageForeignRoutes=no. */
+        Set *route_filter_keys;
 
         /* IPv6 Address Label */
         Hashmap *address_labels_by_section;
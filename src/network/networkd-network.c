@@ -11,6 +11,7 @@
 #include "conf-parser.h"
 #include "dns-domain.h"
 #include "fd-util.h"
+#include "glob-util.h"
 #include "hostname-util.h"
 #include "in-addr-util.h"
 #include "net-condition.h"
@@ -678,9 +679,14 @@ int network_reload(Manager *manager) {
                 network_unref(n);
         }
 
+        manager_clear_network_index(manager);
         ordered_hashmap_free_with_destructor(manager->networks, network_unref);
         manager->networks = new_networks;
 
+        r = manager_build_network_index(manager);
+        if (r < 0)
+                return r;
+
         r = manager_build_dhcp_pd_subnet_ids(manager);
         if (r < 0)
                 return r;
@@ -697,6 +703,90 @@ failure:
         return r;
 }
 
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                network_index_hash_ops,
+                char,
+                string_hash_func,
+                string_compare_func,
+                OrderedSet,
+                ordered_set_free);
+
+static bool network_match_ifname_only(Network *network) {
+        assert(network);
+
+        /* Returns true if the network can only match links whose name or one of whose alternative names is
+         * listed in Name=, i.e. if the setting consists of plain names only, without globs and negations. */
+
+        if (strv_isempty(network->match.ifname))
+                return false;
+
+        STRV_FOREACH(p, network->match.ifname)
+                if (**p == '!' || strpbrk(*p, GLOB_CHARS "\\"))
+                        return false;
+
+        return true;
+}
+
+void manager_clear_network_index(Manager *manager) {
+        assert(manager);
+
+        manager->networks_by_ifname = hashmap_free(manager->networks_by_ifname);
+        manager->networks_unindexed = mfree(manager->networks_unindexed);
+        manager->n_networks_unindexed = 0;
+        manager->networks_indexed = false;
+}
+
+int manager_build_network_index(Manager *manager) {
+        unsigned order = 0;
+        Network *n;
+        int r;
+
+        assert(manager);
+
+        /* Finding the .network file for a link would otherwise require evaluating the [Match] section of
+         * every .network file for every link. When the files are generated per interface, most of them
+         * match by name only, and these are looked up by name instead. */
+
+        manager_clear_network_index(manager);
+
+        ORDERED_HASHMAP_FOREACH(n, manager->networks) {
+                n->order = order++;
+
+                if (!network_match_ifname_only(n)) {
+                        if (!GREEDY_REALLOC(manager->networks_unindexed, manager->n_networks_unindexed + 1))
+                                return -ENOMEM;
+
+                        manager->networks_unindexed[manager->n_networks_unindexed++] = n;
+                        continue;
+                }
+
+                STRV_FOREACH(p, n->match.ifname) {
+                        OrderedSet *s;
+
+                        s = hashmap_get(manager->networks_by_ifname, *p);
+                        if (!s) {
+                                s = ordered_set_new(NULL);
+                                if (!s)
+                                        return -ENOMEM;
+
+                                r = hashmap_ensure_put(&manager->networks_by_ifname, &network_index_hash_ops, *p, s);
+                                if (r < 0) {
+                                        ordered_set_free(s);
+                                        return r;
+                                }
+                        }
+
+                        /* The same name may be listed multiple times. */
+                        r = ordered_set_put(s, n);
+                        if (r < 0 && r != -EEXIST)
+                                return r;
+                }
+        }
+
+        manager->networks_indexed = true;
+        return 0;
+}
+
 int manager_build_dhcp_pd_subnet_ids(Manager *manager) {
         Network *n;
         int r;
@@ -71,6 +71,7 @@ struct Network {
         char **dropins;
         Hashmap *stats_by_path;
         char *description;
+        unsigned order; /* Position in Manager.networks */
 
         /* [Match] section */
         NetMatch match;
@@ -427,6 +428,8 @@ int network_load_one(Manager *manager, OrderedHashmap **networks, const char *fi
 int network_verify(Network *network);
 
 int manager_build_dhcp_pd_subnet_ids(Manager *manager);
+void manager_clear_network_index(Manager *manager);
+int manager_build_network_index(Manager *manager);
 
 int network_get_by_name(Manager *manager, const char *name, Network **ret);
 void network_apply_anonymize_if_set(Network *network);
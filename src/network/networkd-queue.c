@@ -280,6 +280,9 @@ int manager_process_requests(Manager *manager) {
 
         manager->request_queued = false;
 
+        /* Write the netlink messages of all requests processed below at once. */
+        netlink_begin_batch(manager->rtnl);
+
         ORDERED_SET_FOREACH(req, manager->request_queue) {
                 if (req->waiting_reply)
                         continue; /* Already processed, and waiting for netlink reply. */
@@ -317,6 +320,7 @@ int manager_process_requests(Manager *manager) {
                         break; /* New request is queued. Exit from the loop. */
         }
 
+        netlink_end_batch(manager->rtnl);
         return 0;
 }
 
@@ -471,11 +475,13 @@ int manager_process_remove_requests(Manager *manager) {
 
         assert(manager);
 
+        netlink_begin_batch(manager->rtnl);
+
         while ((req = ordered_set_first(manager->remove_request_queue))) {
 
                 /* Do not make the reply callback queue in sd-netlink full. */
                 if (netlink_get_reply_callback_count(req->netlink) >= REPLY_CALLBACK_COUNT_THRESHOLD)
-                        return 0;
+                        break;
 
                 r = netlink_call_async(
                                 req->netlink, NULL, req->message,
@@ -502,5 +508,6 @@ int manager_process_remove_requests(Manager *manager) {
                 }
         }
 
+        netlink_end_batch(manager->rtnl);
         return 0;
 }
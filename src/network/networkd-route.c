@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <linux/filter.h>
 #include <linux/if.h>
 #include <linux/ipv6_route.h>
 #include <linux/nexthop.h>
@@ -299,6 +300,148 @@ int route_new_static(Network *network, const char *filename, unsigned section_li
         return 0;
 }
 
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
+                route_filter_key_hash_ops,
+                uint64_t,
+                uint64_hash_func,
+                uint64_compare_func,
+                free);
+
+static uint64_t route_filter_key(int family, uint32_t table, uint8_t protocol) {
+        /* The protocol is a part of the key the kernel uses to look up IPv4 routes, but not of IPv6 ones. A
+         * received IPv6 route may replace one of ours with any protocol, hence only the table is used. */
+        return (uint64_t) table << 16 | (family == AF_INET6 ? UINT64_C(0x100) : protocol);
+}
+
+#define ROUTE_FILTER_BPF_KEYS_MAX 100U
+
+static void bpf_stmt(struct sock_filter *ins, unsigned *i, unsigned short code, unsigned data) {
+        ins[(*i)++] = (struct sock_filter) {
+                .code = code,
+                .k = data,
+        };
+}
+
+static void bpf_jmp(struct sock_filter *ins, unsigned *i, unsigned short code, unsigned data, unsigned short jt, unsigned short jf) {
+        ins[(*i)++] = (struct sock_filter) {
+                .code = code,
+                .jt = jt,
+                .jf = jf,
+                .k = data,
+        };
+}
+
+static unsigned route_filter_bpf_family(struct sock_filter *ins, unsigned i, Set *keys, int family) {
+        uint64_t *key;
+
+        assert(ins);
+
+        /* Tables above 255 are only carried in RTA_TABLE, which is too costly to look up here. Accept all
+         * such routes and let manager_rtnl_process_route() decide. */
+        bpf_stmt(ins, &i, BPF_LD|BPF_B|BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_table));
+        bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, RT_TABLE_COMPAT, 0, 1);
+        bpf_stmt(ins, &i, BPF_RET|BPF_K, UINT32_MAX);
+
+        /* For IPv4, load table and protocol at once, they are adjacent single bytes. */
+        if (family == AF_INET)
+                bpf_stmt(ins, &i, BPF_LD|BPF_H|BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_table));
+
+        SET_FOREACH(key, keys) {
+                uint32_t table = *key >> 16;
+
+                if (table > UINT8_MAX || (*key & 0x100) != (family == AF_INET6 ? 0x100 : 0))
+                        continue;
+
+                bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, family == AF_INET ? (*key >> 8 & 0xff00) | (*key & 0xff) : table, 0, 1);
+                bpf_stmt(ins, &i, BPF_RET|BPF_K, UINT32_MAX);
+        }
+
+        /* Not a table (and protocol) we know, drop it */
+        bpf_stmt(ins, &i, BPF_RET|BPF_K, 0);
+        return i;
+}
+
+static int manager_update_route_filter_bpf(Manager *manager) {
+        struct sock_filter ins[16 + 4 * ROUTE_FILTER_BPF_KEYS_MAX + 8];
+        unsigned i = 0, j;
+
+        assert(manager);
+
+        /* Install the same filter as manager_may_know_route() on the socket, so that the kernel drops
+         * notifications about foreign routes, without even waking us up. */
+
+        if (manager->manage_foreign_routes || !manager->rtnl)
+                return 0;
+
+        if (set_size(manager->route_filter_keys) > ROUTE_FILTER_BPF_KEYS_MAX)
+                /* Too many to check here, leave it to manager_rtnl_process_route(). */
+                return netlink_attach_filter(manager->rtnl, NULL, 0);
+
+        /* Only route notifications are filtered. Netlink header fields are in host byte order, while
+         * BPF_ABS loads are in network byte order. */
+        bpf_stmt(ins, &i, BPF_LD|BPF_H|BPF_ABS, offsetof(struct nlmsghdr, nlmsg_type));
+        bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, htobe16(RTM_NEWROUTE), 2, 0);
+        bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, htobe16(RTM_DELROUTE), 1, 0);
+        bpf_stmt(ins, &i, BPF_RET|BPF_K, UINT32_MAX);
+
+        /* Datagrams with parts of dumps carry multiple messages, we can only see the first one. */
+        bpf_stmt(ins, &i, BPF_LD|BPF_H|BPF_ABS, offsetof(struct nlmsghdr, nlmsg_flags));
+        bpf_jmp(ins, &i, BPF_JMP|BPF_JSET|BPF_K, htobe16(NLM_F_MULTI), 0, 1);
+        bpf_stmt(ins, &i, BPF_RET|BPF_K, UINT32_MAX);
+
+        bpf_stmt(ins, &i, BPF_LD|BPF_B|BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_family));
+
+        j = i;
+        bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, AF_INET, 0, 0);
+        i = route_filter_bpf_family(ins, i, manager->route_filter_keys, AF_INET);
+        ins[j].jf = i - j - 1;
+
+        j = i;
+        bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, AF_INET6, 0, 0);
+        i = route_filter_bpf_family(ins, i, manager->route_filter_keys, AF_INET6);
+        ins[j].jf = i - j - 1;
+
+        bpf_stmt(ins, &i, BPF_RET|BPF_K, UINT32_MAX);
+
+        assert(i <= ELEMENTSOF(ins));
+        return netlink_attach_filter(manager->rtnl, ins, i);
+}
+
+static int manager_add_route_filter_key(Manager *manager, const Route *route) {
+        _cleanup_free_ uint64_t *key = NULL;
+        int r;
+
+        assert(manager);
+        assert(route);
+
+        key = new(uint64_t, 1);
+        if (!key)
+                return -ENOMEM;
+
+        *key = route_filter_key(route->family, route->table, route->protocol);
+
+        r = set_ensure_put(&manager->route_filter_keys, &route_filter_key_hash_ops, key);
+        if (r <= 0)
+                return r;
+
+        TAKE_PTR(key);
+
+        r = manager_update_route_filter_bpf(manager);
+        if (r < 0)
+                log_debug_errno(r, "Failed to update socket filter for route notifications, ignoring: %m");
+
+        return 0;
+}
+
+static bool manager_may_know_route(Manager *manager, int family, uint32_t table, uint8_t protocol) {
+        assert(manager);
+
+        /* The set only grows, so that it is always a superset of the tables and protocols of the routes we
+         * requested or remember. Hence, if this returns false, neither route_get() nor route_get_request()
+         * can find a matching route. */
+        return set_contains(manager->route_filter_keys, &(uint64_t) { route_filter_key(family, table, protocol) });
+}
+
 static int route_attach(Manager *manager, Route *route) {
         int r;
 
@@ -307,6 +450,10 @@ static int route_attach(Manager *manager, Route *route) {
         assert(!route->network);
         assert(!route->wireguard);
 
+        r = manager_add_route_filter_key(manager, route);
+        if (r < 0)
+                return r;
+
         r = set_ensure_put(&manager->routes, &route_hash_ops, route);
         if (r < 0)
                 return r;
@@ -967,6 +1114,10 @@ static int link_request_route_one(
                 /* Copy state for logging below. */
                 tmp->state = existing->state;
 
+        r = manager_add_route_filter_key(link->manager, tmp);
+        if (r < 0)
+                return r;
+
         log_route_debug(tmp, "Requesting", link->manager);
         r = link_queue_request_safe(link, REQUEST_TYPE_ROUTE,
                                     tmp,
@@ -1277,6 +1428,24 @@ int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, Ma
         }
 
         /* attributes */
+        r = sd_netlink_message_read_u32(message, RTA_TABLE, &tmp->table);
+        if (r == -ENODATA) {
+                unsigned char table;
+
+                r = sd_rtnl_message_route_get_table(message, &table);
+                if (r >= 0)
+                        tmp->table = table;
+        }
+        if (r < 0) {
+                log_warning_errno(r, "rtnl: received route message with invalid table, ignoring: %m");
+                return 0;
+        }
+
+        /* Hosts running a routing daemon may have millions of routes. If we do not manage foreign routes,
+         * skip parsing and looking up those that cannot be ours as early as possible. */
+        if (!m->manage_foreign_routes && !manager_may_know_route(m, tmp->family, tmp->table, tmp->protocol))
+                return 0;
+
         r = netlink_message_read_in_addr_union(message, RTA_DST, tmp->family, &tmp->dst);
         if (r < 0 && r != -ENODATA) {
                 log_warning_errno(r, "rtnl: received route message without valid destination, ignoring: %m");
@@ -1301,19 +1470,6 @@ int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, Ma
                 return 0;
         }
 
-        r = sd_netlink_message_read_u32(message, RTA_TABLE, &tmp->table);
-        if (r == -ENODATA) {
-                unsigned char table;
-
-                r = sd_rtnl_message_route_get_table(message, &table);
-                if (r >= 0)
-                        tmp->table = table;
-        }
-        if (r < 0) {
-                log_warning_errno(r, "rtnl: received route message with invalid table, ignoring: %m");
-                return 0;
-        }
-
         r = sd_netlink_message_read_u8(message, RTA_PREF, &tmp->pref);
         if (r < 0 && r != -ENODATA) {
                 log_warning_errno(r, "rtnl: received route message with invalid preference, ignoring: %m");
@@ -10,6 +10,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "memstream-util.h"
 #include "network-internal.h"
 #include "networkd-dhcp-common.h"
 #include "networkd-link.h"
@@ -324,6 +325,48 @@ static int link_put_domains(Link *link, bool is_route, OrderedSet **s) {
         return 0;
 }
 
+static int state_file_update(const char *path, char **contents, MemStream *ms) {
+        _cleanup_(unlink_and_freep) char *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *buf = NULL;
+        int r;
+
+        assert(path);
+        assert(contents);
+        assert(ms);
+
+        r = memstream_finalize(ms, &buf, NULL);
+        if (r < 0)
+                return r;
+
+        /* State files are rewritten after every change of the link or the manager, even if the
+         * serialization is the same as before. Skip them in that case: creating and removing the temporary
+         * file would still wake up everybody watching the directory via sd_network_monitor. */
+        if (streq_ptr(buf, *contents))
+                return 0;
+
+        r = fopen_temporary(path, &f, &temp_path);
+        if (r < 0)
+                return r;
+
+        (void) fchmod(fileno(f), 0644);
+
+        fputs(buf, f);
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        r = conservative_rename(temp_path, path);
+        if (r < 0)
+                return r;
+
+        temp_path = mfree(temp_path);
+
+        free_and_replace(*contents, buf);
+        return 1;
+}
+
 int manager_save(Manager *m) {
         _cleanup_ordered_set_free_ OrderedSet *dns = NULL, *ntp = NULL, *sip = NULL, *search_domains = NULL, *route_domains = NULL;
         const char *operstate_str, *carrier_state_str, *address_state_str, *ipv4_address_state_str, *ipv6_address_state_str, *online_state_str;
@@ -395,14 +438,12 @@ int manager_save(Manager *m) {
         ipv4_address_state_str = ASSERT_PTR(link_address_state_to_string(ipv4_address_state));
         ipv6_address_state_str = ASSERT_PTR(link_address_state_to_string(ipv6_address_state));
 
-        _cleanup_(unlink_and_freep) char *temp_path = NULL;
-        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_(memstream_done) MemStream ms = {};
+        FILE *f;
 
-        r = fopen_temporary(m->state_file, &f, &temp_path);
-        if (r < 0)
-                return r;
-
-        (void) fchmod(fileno(f), 0644);
+        f = memstream_init(&ms);
+        if (!f)
+                return -ENOMEM;
 
         fprintf(f,
                 "# This is private data. Do not parse.\n"
@@ -423,16 +464,10 @@ int manager_save(Manager *m) {
         ordered_set_print(f, "DOMAINS=", search_domains);
         ordered_set_print(f, "ROUTE_DOMAINS=", route_domains);
 
-        r = fflush_and_check(f);
-        if (r < 0)
-                return r;
-
-        r = conservative_rename(temp_path, m->state_file);
+        r = state_file_update(m->state_file, &m->state_file_contents, &ms);
         if (r < 0)
                 return r;
 
-        temp_path = mfree(temp_path);
-
         _cleanup_strv_free_ char **p = NULL;
 
         if (m->operational_state != operstate) {
@@ -701,8 +736,8 @@ static int serialize_config_files(FILE *f, const char *prefix, const char *main_
 
 static int link_save(Link *link) {
         const char *admin_state, *oper_state, *carrier_state, *address_state, *ipv4_address_state, *ipv6_address_state;
-        _cleanup_(unlink_and_freep) char *temp_path = NULL;
-        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_(memstream_done) MemStream ms = {};
+        FILE *f;
         int r;
 
         assert(link);
@@ -721,11 +756,9 @@ static int link_save(Link *link) {
         ipv4_address_state = ASSERT_PTR(link_address_state_to_string(link->ipv4_address_state));
         ipv6_address_state = ASSERT_PTR(link_address_state_to_string(link->ipv6_address_state));
 
-        r = fopen_temporary(link->state_file, &f, &temp_path);
-        if (r < 0)
-                return r;
-
-        (void) fchmod(fileno(f), 0644);
+        f = memstream_init(&ms);
+        if (!f)
+                return -ENOMEM;
 
         fprintf(f,
                 "# This is private data. Do not parse.\n"
@@ -933,16 +966,10 @@ static int link_save(Link *link) {
         if (r < 0)
                 return r;
 
-        r = fflush_and_check(f);
-        if (r < 0)
-                return r;
-
-        r = conservative_rename(temp_path, link->state_file);
+        r = state_file_update(link->state_file, &link->state_file_contents, &ms);
         if (r < 0)
                 return r;
 
-        temp_path = mfree(temp_path);
-
         return 0;
 }
 
@@ -2946,6 +2946,30 @@ static int setup_machine_id(const char *directory) {
         return 0;
 }
 
+static int remount_idmap_image(char **dirs, uid_t image_base) {
+        _cleanup_close_ int userns_fd = -EBADF;
+        _cleanup_free_ char *line = NULL;
+
+        if (image_base == 0)
+                return remount_idmap(dirs, arg_uid_shift, arg_uid_range, UID_INVALID, UID_INVALID, REMOUNT_IDMAPPING_HOST_ROOT);
+
+        /* The tree was chown()ed to a different range before, for example because the range was taken by
+         * someone else when we picked one this time. Map that range rather than chown()ing the whole tree
+         * once more. Just like REMOUNT_IDMAPPING_HOST_ROOT, also let the host root user make changes. */
+        if (asprintf(&line,
+                     UID_FMT " " UID_FMT " " UID_FMT "\n"
+                     UID_FMT " " UID_FMT " " UID_FMT "\n",
+                     image_base, arg_uid_shift, arg_uid_range,
+                     UID_MAPPED_ROOT, 0u, 1u) < 0)
+                return -ENOMEM;
+
+        userns_fd = userns_acquire(line, line);
+        if (userns_fd < 0)
+                return userns_fd;
+
+        return remount_idmap_fd(dirs, userns_fd, /* extra_mount_attr_set= */ 0);
+}
+
 static int recursive_chown(const char *directory, uid_t shift, uid_t range) {
         int r;
 
@@ -3255,8 +3279,11 @@ static int chase_and_update(char **p, unsigned flags) {
         return free_and_replace(*p, chased);
 }
 
-static int determine_uid_shift(const char *directory) {
+static int determine_uid_shift(const char *directory, uid_t *ret_image_base) {
         assert(directory);
+        assert(ret_image_base);
+
+        *ret_image_base = 0;
 
         if (arg_userns_mode == USER_NAMESPACE_NO) {
                 arg_uid_shift = 0;
@@ -3280,15 +3307,15 @@ static int determine_uid_shift(const char *directory) {
                 arg_uid_range = UINT32_C(0x10000);
 
                 if (arg_uid_shift != 0) {
-                        /* If the image is shifted already, then we'll fall back to classic chowning, for
-                         * compatibility (and simplicity), or refuse if mapping is explicitly requested.  */
+                        /* If the image is shifted already, then we'll stick to that range if we can, and map
+                         * it to the range we end up with otherwise (see outer_child()), or fall back to
+                         * classic chowning. Refuse if mapping is explicitly requested, for simplicity. */
 
-                        if (arg_userns_ownership == USER_NAMESPACE_OWNERSHIP_AUTO) {
-                                log_debug("UID base of %s is non-zero, not using UID mapping.", directory);
-                                arg_userns_ownership = USER_NAMESPACE_OWNERSHIP_CHOWN;
-                        } else if (arg_userns_ownership == USER_NAMESPACE_OWNERSHIP_MAP)
+                        if (arg_userns_ownership == USER_NAMESPACE_OWNERSHIP_MAP)
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "UID base of %s is not zero, UID mapping not supported.", directory);
+
+                        *ret_image_base = arg_uid_shift;
                 }
         }
 
@@ -3937,6 +3964,7 @@ static int outer_child(
         _cleanup_strv_free_ char **os_release_pairs = NULL;
         _cleanup_close_ int mntns_fd = -EBADF;
         bool idmap = false, enable_fuse;
+        uid_t image_uid_base;
         const char *p;
         pid_t pid;
         ssize_t l;
@@ -3999,7 +4027,7 @@ static int outer_child(
                         return r;
         }
 
-        r = determine_uid_shift(directory);
+        r = determine_uid_shift(directory, &image_uid_base);
         if (r < 0)
                 return r;
 
@@ -4129,6 +4157,17 @@ static int outer_child(
         if (r < 0)
                 return r;
 
+        if (arg_userns_mode != USER_NAMESPACE_NO &&
+            arg_userns_ownership == USER_NAMESPACE_OWNERSHIP_AUTO &&
+            image_uid_base != 0 &&
+            (image_uid_base == arg_uid_shift || dissected_image || arg_volatile_mode != VOLATILE_NO)) {
+                /* The tree is shifted already. Either it is owned by the selected range anyway, in which case
+                 * the chown() logic below has nothing to do, or other file systems need to be mounted on top
+                 * of it, which we'd have to map from a different base. Don't bother with the latter. */
+                log_debug("UID base of %s is non-zero, not using UID mapping.", directory);
+                arg_userns_ownership = USER_NAMESPACE_OWNERSHIP_CHOWN;
+        }
+
         if (arg_userns_mode != USER_NAMESPACE_NO &&
             IN_SET(arg_userns_ownership, USER_NAMESPACE_OWNERSHIP_MAP, USER_NAMESPACE_OWNERSHIP_AUTO) &&
             arg_uid_shift != 0) {
@@ -4151,7 +4190,7 @@ static int outer_child(
                                 return log_oom();
                 }
 
-                r = remount_idmap(dirs, arg_uid_shift, arg_uid_range, UID_INVALID, UID_INVALID, REMOUNT_IDMAPPING_HOST_ROOT);
+                r = remount_idmap_image(dirs, image_uid_base);
                 if (r == -EINVAL || ERRNO_IS_NEG_NOT_SUPPORTED(r)) {
                         /* This might fail because the kernel or file system doesn't support idmapping. We
                          * can't really distinguish this nicely, nor do we have any guarantees about the
@@ -6292,13 +6331,19 @@ static int run(int argc, char *argv[]) {
                 }
 
                 if (arg_privileged) {
-                        r = loop_device_make_by_path(
-                                        arg_image,
-                                        arg_read_only ? O_RDONLY : O_RDWR,
-                                        /* sector_size= */ UINT32_MAX,
-                                        FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_NO_PARTITION_TABLE) ? 0 : LO_FLAGS_PARTSCAN,
-                                        LOCK_SH,
-                                        &loop);
+                        uint32_t loop_flags = FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_NO_PARTITION_TABLE) ? 0 : LO_FLAGS_PARTSCAN;
+
+                        /* If other containers run off the same image read-only already, use the same
+                         * loopback device, so that we share the page cache with them. */
+                        r = arg_read_only ? loop_device_open_shared(arg_image, /* sector_size= */ UINT32_MAX, loop_flags, LOCK_SH, &loop) : -ENOENT;
+                        if (r < 0)
+                                r = loop_device_make_by_path(
+                                                arg_image,
+                                                arg_read_only ? O_RDONLY : O_RDWR,
+                                                /* sector_size= */ UINT32_MAX,
+                                                loop_flags,
+                                                LOCK_SH,
+                                                &loop);
                         if (r < 0) {
                                 log_error_errno(r, "Failed to set up loopback block device: %m");
                                 goto finish;
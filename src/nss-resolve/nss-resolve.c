@@ -17,6 +17,7 @@
 #include "json-util.h"
 #include "macro.h"
 #include "nss-util.h"
+#include "resolve-nss-cache.h"
 #include "resolved-def.h"
 #include "signal-util.h"
 #include "string-util.h"
@@ -209,6 +210,63 @@ static uint64_t query_flags(void) {
                 query_flag("SYSTEMD_NSS_RESOLVE_NETWORK", 0, SD_RESOLVED_NO_NETWORK);
 }
 
+static enum nss_status gaih_addrtuples_from_cache(
+                const ResolveNssCachePayload *c,
+                struct gaih_addrtuple **pat,
+                char *buffer, size_t buflen,
+                int *errnop, int *h_errnop,
+                int32_t *ttlp) {
+
+        size_t l = strlen(c->name);
+        size_t idx, ms = ALIGN(l+1) + ALIGN(sizeof(struct gaih_addrtuple)) * c->n_addresses;
+
+        assert(c->n_addresses > 0);
+
+        /* errno is protected by the caller */
+        if (buflen < ms) {
+                *errnop = ERANGE;
+                *h_errnop = NETDB_INTERNAL;
+                return NSS_STATUS_TRYAGAIN;
+        }
+
+        char *r_name = buffer;
+        memcpy(r_name, c->name, l + 1);
+        idx = ALIGN(l + 1);
+
+        struct gaih_addrtuple *r_tuple = NULL,
+                *r_tuple_first = (struct gaih_addrtuple*) (buffer + idx);
+
+        for (size_t i = 0; i < c->n_addresses; i++) {
+                const ResolveNssCacheAddress *a = c->addresses + i;
+
+                r_tuple = (struct gaih_addrtuple*) (buffer + idx);
+                r_tuple->next = (struct gaih_addrtuple*) ((char*) r_tuple + ALIGN(sizeof(struct gaih_addrtuple)));
+                r_tuple->name = r_name;
+                r_tuple->family = a->family;
+                r_tuple->scopeid = ifindex_to_scopeid(a->family, a->address, a->ifindex);
+                memcpy(r_tuple->addr, a->address, FAMILY_ADDRESS_SIZE(a->family));
+
+                idx += ALIGN(sizeof(struct gaih_addrtuple));
+        }
+
+        r_tuple->next = NULL;  /* Override last next pointer */
+
+        assert(idx == ms);
+
+        if (*pat)
+                **pat = *r_tuple_first;
+        else
+                *pat = r_tuple_first;
+
+        if (ttlp)
+                *ttlp = 0;
+
+        *h_errnop = NETDB_SUCCESS;
+        h_errno = 0;
+
+        return NSS_STATUS_SUCCESS;
+}
+
 enum nss_status _nss_resolve_gethostbyname4_r(
                 const char *name,
                 struct gaih_addrtuple **pat,
@@ -231,6 +289,16 @@ enum nss_status _nss_resolve_gethostbyname4_r(
         assert(errnop);
         assert(h_errnop);
 
+        uint64_t flags = query_flags();
+
+        /* resolved might have published the answer to this very lookup, if so use it right away */
+        if (flags == 0) {
+                ResolveNssCachePayload c;
+
+                if (resolve_nss_cache_lookup(name, &c) >= 0)
+                        return gaih_addrtuples_from_cache(&c, pat, buffer, buflen, errnop, h_errnop, ttlp);
+        }
+
         r = connect_to_resolved(&link);
         if (r < 0)
                 goto fail;
@@ -238,7 +306,7 @@ enum nss_status _nss_resolve_gethostbyname4_r(
         r = sd_json_buildo(
                         &cparams,
                         SD_JSON_BUILD_PAIR("name", SD_JSON_BUILD_STRING(name)),
-                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(query_flags())));
+                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(flags)));
         if (r < 0)
                 goto fail;
 
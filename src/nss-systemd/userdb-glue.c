@@ -1,9 +1,13 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <pthread.h>
+
 #include "env-util.h"
 #include "fd-util.h"
 #include "nss-systemd.h"
+#include "pthread-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "user-record-nss.h"
 #include "user-record.h"
 #include "user-util.h"
@@ -20,30 +24,75 @@ UserDBFlags nss_glue_userdb_flags(void) {
         return flags;
 }
 
-int nss_pack_user_record(
-                UserRecord *hr,
+/* Every userdb lookup is an IPC round trip, and programs such as "ls -l" or "tar" resolve the same few users
+ * and groups over and over again. Hence, remember the fields of the most recently resolved records for a
+ * short while. We keep copies of the strings rather than references to the records, so that the records
+ * themselves (whose reference counters are not atomic) are never shared between threads. */
+#define NSS_CACHE_ENTRIES 16U
+#define NSS_CACHE_USEC (1 * USEC_PER_SEC)
+
+typedef struct NssUserCacheEntry {
+        usec_t until;
+        uid_t uid;
+        gid_t gid;
+        char *name;
+        char *real_name;
+        char *home;
+        char *shell;
+} NssUserCacheEntry;
+
+typedef struct NssGroupCacheEntry {
+        usec_t until;
+        gid_t gid;
+        char *name;
+        char **members;
+} NssGroupCacheEntry;
+
+static pthread_mutex_t nss_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static NssUserCacheEntry nss_user_cache[NSS_CACHE_ENTRIES] = {};
+static NssGroupCacheEntry nss_group_cache[NSS_CACHE_ENTRIES] = {};
+static unsigned nss_user_cache_next = 0, nss_group_cache_next = 0;
+
+static bool nss_cache_enabled(void) {
+        int r;
+
+        /* Both variables are checked on every call rather than once, as the service manager only sets
+         * $SYSTEMD_NSS_DYNAMIC_BYPASS right before allocating dynamic users, possibly after other lookups
+         * already happened in the same process. */
+
+        r = secure_getenv_bool("SYSTEMD_NSS_CACHE");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_NSS_CACHE, ignoring: %m");
+        if (r == 0)
+                return false;
+
+        /* When allocating dynamic users the service manager needs to see the current state, always */
+        return !FLAGS_SET(nss_glue_userdb_flags(), USERDB_EXCLUDE_DYNAMIC_USER);
+}
+
+static int pack_passwd(
+                const char *name,
+                uid_t uid,
+                gid_t gid,
+                const char *rn,
+                const char *hd,
+                const char *shell,
                 struct passwd *pwd,
                 char *buffer,
                 size_t buflen) {
 
-        const char *rn, *hd, *shell;
         size_t required;
 
-        assert(hr);
+        assert(name);
+        assert(rn);
+        assert(hd);
+        assert(shell);
         assert(pwd);
 
-        assert(hr->user_name);
-        required = strlen(hr->user_name) + 1;
-
+        required = strlen(name) + 1;
         required += 2; /* strlen(PASSWORD_SEE_SHADOW) + 1 */
-
-        assert_se(rn = user_record_real_name(hr));
         required += strlen(rn) + 1;
-
-        assert_se(hd = user_record_home_directory(hr));
         required += strlen(hd) + 1;
-
-        assert_se(shell = user_record_shell(hr));
         required += strlen(shell) + 1;
 
         if (buflen < required)
@@ -51,13 +100,13 @@ int nss_pack_user_record(
 
         *pwd = (struct passwd) {
                 .pw_name = buffer,
-                .pw_uid = hr->uid,
-                .pw_gid = user_record_gid(hr),
+                .pw_uid = uid,
+                .pw_gid = gid,
         };
 
         assert(buffer);
 
-        pwd->pw_passwd = stpcpy(pwd->pw_name, hr->user_name) + 1;
+        pwd->pw_passwd = stpcpy(pwd->pw_name, name) + 1;
         pwd->pw_gecos = stpcpy(pwd->pw_passwd, PASSWORD_SEE_SHADOW) + 1;
         pwd->pw_dir = stpcpy(pwd->pw_gecos, rn) + 1;
         pwd->pw_shell = stpcpy(pwd->pw_dir, hd) + 1;
@@ -66,6 +115,108 @@ int nss_pack_user_record(
         return 0;
 }
 
+int nss_pack_user_record(
+                UserRecord *hr,
+                struct passwd *pwd,
+                char *buffer,
+                size_t buflen) {
+
+        const char *rn, *hd, *shell;
+
+        assert(hr);
+        assert(pwd);
+
+        assert(hr->user_name);
+        assert_se(rn = user_record_real_name(hr));
+        assert_se(hd = user_record_home_directory(hr));
+        assert_se(shell = user_record_shell(hr));
+
+        return pack_passwd(hr->user_name, hr->uid, user_record_gid(hr), rn, hd, shell, pwd, buffer, buflen);
+}
+
+static void nss_user_cache_entry_done(NssUserCacheEntry *e) {
+        assert(e);
+
+        e->name = mfree(e->name);
+        e->real_name = mfree(e->real_name);
+        e->home = mfree(e->home);
+        e->shell = mfree(e->shell);
+}
+
+static int nss_user_cache_pack(
+                const char *name,
+                uid_t uid,
+                struct passwd *pwd,
+                char *buffer,
+                size_t buflen) {
+
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = NULL;
+        usec_t n;
+        int r;
+
+        assert(!!name != uid_is_valid(uid));
+        assert(pwd);
+
+        /* Returns > 0 if the record was found in the cache and has been written to the buffer */
+
+        if (!nss_cache_enabled())
+                return 0;
+
+        n = now(CLOCK_MONOTONIC);
+
+        _l = pthread_mutex_lock_assert(&nss_cache_mutex);
+
+        FOREACH_ELEMENT(e, nss_user_cache) {
+                if (!e->name || e->until <= n)
+                        continue;
+
+                if (name ? !streq(e->name, name) : e->uid != uid)
+                        continue;
+
+                r = pack_passwd(e->name, e->uid, e->gid, e->real_name, e->home, e->shell, pwd, buffer, buflen);
+                if (r < 0)
+                        return r;
+
+                return 1;
+        }
+
+        return 0;
+}
+
+static void nss_user_cache_put(UserRecord *hr) {
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = NULL;
+        _cleanup_free_ char *name = NULL, *real_name = NULL, *home = NULL, *shell = NULL;
+        NssUserCacheEntry *e;
+
+        assert(hr);
+
+        if (!nss_cache_enabled())
+                return;
+
+        name = strdup(hr->user_name);
+        real_name = strdup(user_record_real_name(hr));
+        home = strdup(user_record_home_directory(hr));
+        shell = strdup(user_record_shell(hr));
+        if (!name || !real_name || !home || !shell)
+                return;
+
+        _l = pthread_mutex_lock_assert(&nss_cache_mutex);
+
+        e = nss_user_cache + nss_user_cache_next;
+        nss_user_cache_next = (nss_user_cache_next + 1) % NSS_CACHE_ENTRIES;
+
+        nss_user_cache_entry_done(e);
+        *e = (NssUserCacheEntry) {
+                .until = usec_add(now(CLOCK_MONOTONIC), NSS_CACHE_USEC),
+                .uid = hr->uid,
+                .gid = user_record_gid(hr),
+                .name = TAKE_PTR(name),
+                .real_name = TAKE_PTR(real_name),
+                .home = TAKE_PTR(home),
+                .shell = TAKE_PTR(shell),
+        };
+}
+
 enum nss_status userdb_getpwnam(
                 const char *name,
                 struct passwd *pwd,
@@ -81,6 +232,14 @@ enum nss_status userdb_getpwnam(
         if (_nss_systemd_is_blocked())
                 return NSS_STATUS_NOTFOUND;
 
+        r = nss_user_cache_pack(name, UID_INVALID, pwd, buffer, buflen);
+        if (r < 0) {
+                *errnop = -r;
+                return NSS_STATUS_TRYAGAIN;
+        }
+        if (r > 0)
+                return NSS_STATUS_SUCCESS;
+
         r = userdb_by_name(name, nss_glue_userdb_flags()|USERDB_SUPPRESS_SHADOW, &hr);
         if (r == -ESRCH)
                 return NSS_STATUS_NOTFOUND;
@@ -89,6 +248,8 @@ enum nss_status userdb_getpwnam(
                 return NSS_STATUS_UNAVAIL;
         }
 
+        nss_user_cache_put(hr);
+
         r = nss_pack_user_record(hr, pwd, buffer, buflen);
         if (r < 0) {
                 *errnop = -r;
@@ -114,6 +275,14 @@ enum nss_status userdb_getpwuid(
         if (_nss_systemd_is_blocked())
                 return NSS_STATUS_NOTFOUND;
 
+        r = nss_user_cache_pack(NULL, uid, pwd, buffer, buflen);
+        if (r < 0) {
+                *errnop = -r;
+                return NSS_STATUS_TRYAGAIN;
+        }
+        if (r > 0)
+                return NSS_STATUS_SUCCESS;
+
         r = userdb_by_uid(uid, nss_glue_userdb_flags()|USERDB_SUPPRESS_SHADOW, &hr);
         if (r == -ESRCH)
                 return NSS_STATUS_NOTFOUND;
@@ -122,6 +291,8 @@ enum nss_status userdb_getpwuid(
                 return NSS_STATUS_UNAVAIL;
         }
 
+        nss_user_cache_put(hr);
+
         r = nss_pack_user_record(hr, pwd, buffer, buflen);
         if (r < 0) {
                 *errnop = -r;
@@ -210,8 +381,10 @@ enum nss_status userdb_getspnam(
         return NSS_STATUS_SUCCESS;
 }
 
-int nss_pack_group_record(
-                GroupRecord *g,
+static int pack_group(
+                const char *name,
+                gid_t gid,
+                char **members,
                 char **extra_members,
                 struct group *gr,
                 char *buffer,
@@ -220,19 +393,18 @@ int nss_pack_group_record(
         char **array = NULL, *p;
         size_t required, n = 0, i = 0;
 
-        assert(g);
+        assert(name);
         assert(gr);
 
-        assert(g->group_name);
-        required = strlen(g->group_name) + 1;
+        required = strlen(name) + 1;
 
-        STRV_FOREACH(m, g->members) {
+        STRV_FOREACH(m, members) {
                 required += sizeof(char*);  /* space for ptr array entry */
                 required += strlen(*m) + 1;
                 n++;
         }
         STRV_FOREACH(m, extra_members) {
-                if (strv_contains(g->members, *m))
+                if (strv_contains(members, *m))
                         continue;
 
                 required += sizeof(char*);
@@ -248,12 +420,12 @@ int nss_pack_group_record(
         array = (char**) buffer; /* place ptr array at beginning of buffer, under assumption buffer is aligned */
         p = buffer + sizeof(void*) * (n + 1); /* place member strings right after the ptr array */
 
-        STRV_FOREACH(m, g->members) {
+        STRV_FOREACH(m, members) {
                 array[i++] = p;
                 p = stpcpy(p, *m) + 1;
         }
         STRV_FOREACH(m, extra_members) {
-                if (strv_contains(g->members, *m))
+                if (strv_contains(members, *m))
                         continue;
 
                 array[i++] = p;
@@ -264,8 +436,8 @@ int nss_pack_group_record(
         array[n] = NULL;
 
         *gr = (struct group) {
-                .gr_name = strcpy(p, g->group_name),
-                .gr_gid = g->gid,
+                .gr_name = strcpy(p, name),
+                .gr_gid = gid,
                 .gr_passwd = (char*) PASSWORD_SEE_SHADOW,
                 .gr_mem = array,
         };
@@ -273,6 +445,102 @@ int nss_pack_group_record(
         return 0;
 }
 
+int nss_pack_group_record(
+                GroupRecord *g,
+                char **extra_members,
+                struct group *gr,
+                char *buffer,
+                size_t buflen) {
+
+        assert(g);
+        assert(g->group_name);
+
+        return pack_group(g->group_name, g->gid, g->members, extra_members, gr, buffer, buflen);
+}
+
+static void nss_group_cache_entry_done(NssGroupCacheEntry *e) {
+        assert(e);
+
+        e->name = mfree(e->name);
+        e->members = strv_free(e->members);
+}
+
+static int nss_group_cache_pack(
+                const char *name,
+                gid_t gid,
+                struct group *gr,
+                char *buffer,
+                size_t buflen) {
+
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = NULL;
+        usec_t n;
+        int r;
+
+        assert(!!name != gid_is_valid(gid));
+        assert(gr);
+
+        /* Returns > 0 if the record was found in the cache and has been written to the buffer */
+
+        if (!nss_cache_enabled())
+                return 0;
+
+        n = now(CLOCK_MONOTONIC);
+
+        _l = pthread_mutex_lock_assert(&nss_cache_mutex);
+
+        FOREACH_ELEMENT(e, nss_group_cache) {
+                if (!e->name || e->until <= n)
+                        continue;
+
+                if (name ? !streq(e->name, name) : e->gid != gid)
+                        continue;
+
+                r = pack_group(e->name, e->gid, e->members, /* extra_members= */ NULL, gr, buffer, buflen);
+                if (r < 0)
+                        return r;
+
+                return 1;
+        }
+
+        return 0;
+}
+
+static void nss_group_cache_put(GroupRecord *g, char **extra_members) {
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = NULL;
+        _cleanup_strv_free_ char **members = NULL;
+        _cleanup_free_ char *name = NULL;
+        NssGroupCacheEntry *e;
+
+        assert(g);
+
+        if (!nss_cache_enabled())
+                return;
+
+        name = strdup(g->group_name);
+        if (!name)
+                return;
+
+        /* Store the members in the order nss_pack_group_record() would list them */
+        members = strv_copy(g->members);
+        if (!members && g->members)
+                return;
+        if (strv_extend_strv(&members, extra_members, /* filter_duplicates= */ true) < 0)
+                return;
+
+        _l = pthread_mutex_lock_assert(&nss_cache_mutex);
+
+        e = nss_group_cache + nss_group_cache_next;
+        nss_group_cache_next = (nss_group_cache_next + 1) % NSS_CACHE_ENTRIES;
+
+        nss_group_cache_entry_done(e);
+        *e = (NssGroupCacheEntry) {
+                .until = usec_add(now(CLOCK_MONOTONIC), NSS_CACHE_USEC),
+                .gid = g->gid,
+                .name = TAKE_PTR(name),
+                .members = TAKE_PTR(members),
+        };
+}
+
 enum nss_status userdb_getgrnam(
                 const char *name,
                 struct group *gr,
@@ -290,6 +558,14 @@ enum nss_status userdb_getgrnam(
         if (_nss_systemd_is_blocked())
                 return NSS_STATUS_NOTFOUND;
 
+        r = nss_group_cache_pack(name, GID_INVALID, gr, buffer, buflen);
+        if (r < 0) {
+                *errnop = -r;
+                return NSS_STATUS_TRYAGAIN;
+        }
+        if (r > 0)
+                return NSS_STATUS_SUCCESS;
+
         r = groupdb_by_name(name, nss_glue_userdb_flags()|USERDB_SUPPRESS_SHADOW, &g);
         if (r < 0 && r != -ESRCH) {
                 *errnop = -r;
@@ -328,7 +604,8 @@ enum nss_status userdb_getgrnam(
                         *errnop = -r;
                         return NSS_STATUS_UNAVAIL;
                 }
-        }
+        } else
+                nss_group_cache_put(g, members);
 
         r = nss_pack_group_record(g, members, gr, buffer, buflen);
         if (r < 0) {
@@ -357,6 +634,14 @@ enum nss_status userdb_getgrgid(
         if (_nss_systemd_is_blocked())
                 return NSS_STATUS_NOTFOUND;
 
+        r = nss_group_cache_pack(NULL, gid, gr, buffer, buflen);
+        if (r < 0) {
+                *errnop = -r;
+                return NSS_STATUS_TRYAGAIN;
+        }
+        if (r > 0)
+                return NSS_STATUS_SUCCESS;
+
         r = groupdb_by_gid(gid, nss_glue_userdb_flags()|USERDB_SUPPRESS_SHADOW, &g);
         if (r < 0 && r != -ESRCH) {
                 *errnop = -r;
@@ -399,6 +684,9 @@ enum nss_status userdb_getgrgid(
         if (from_nss && strv_isempty(members))
                 return NSS_STATUS_NOTFOUND;
 
+        if (!from_nss)
+                nss_group_cache_put(g, members);
+
         r = nss_pack_group_record(g, members, gr, buffer, buflen);
         if (r < 0) {
                 *errnop = -r;
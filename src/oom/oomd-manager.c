@@ -1,5 +1,9 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
 #include "sd-daemon.h"
 #include "sd-json.h"
 
@@ -20,6 +24,33 @@
 #include "varlink-io.systemd.oom.h"
 #include "varlink-util.h"
 
+typedef struct OomdPressureTrigger {
+        Manager *manager;
+        char *path;
+        loadavg_t limit;
+        /* NULL if the trigger could not be armed or failed, in which case we poll for this cgroup */
+        sd_event_source *event_source;
+} OomdPressureTrigger;
+
+static OomdPressureTrigger* oomd_pressure_trigger_free(OomdPressureTrigger *t) {
+        if (!t)
+                return NULL;
+
+        sd_event_source_disable_unref(t->event_source);
+        free(t->path);
+        return mfree(t);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(OomdPressureTrigger*, oomd_pressure_trigger_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                oomd_pressure_trigger_hash_ops,
+                char,
+                path_hash_func,
+                path_compare,
+                OomdPressureTrigger,
+                oomd_pressure_trigger_free);
+
 typedef struct ManagedOOMMessage {
         ManagedOOMMode mode;
         char *path;
@@ -34,6 +65,30 @@ static void managed_oom_message_destroy(ManagedOOMMessage *message) {
         free(message->property);
 }
 
+static int manager_schedule_mem_pressure_check(Manager *m) {
+        usec_t usec_now, next;
+        int r;
+
+        assert(m);
+
+        if (!m->mem_pressure_context_event_source)
+                return 0;
+
+        r = sd_event_now(m->event, CLOCK_MONOTONIC, &usec_now);
+        if (r < 0)
+                return r;
+
+        r = sd_event_source_get_time(m->mem_pressure_context_event_source, &next);
+        if (r < 0)
+                return r;
+
+        /* Already polling at the regular interval? */
+        if (next <= usec_add(usec_now, MEM_PRESSURE_INTERVAL_USEC))
+                return 0;
+
+        return sd_event_source_set_time(m->mem_pressure_context_event_source, usec_now);
+}
+
 static JSON_DISPATCH_ENUM_DEFINE(dispatch_managed_oom_mode, ManagedOOMMode, managed_oom_mode_from_string);
 
 static int process_managed_oom_message(Manager *m, uid_t uid, sd_json_variant *parameters) {
@@ -130,6 +185,11 @@ static int process_managed_oom_message(Manager *m, uid_t uid, sd_json_variant *p
                 }
         }
 
+        /* Pick up new or changed cgroups right away, rather than at the next idle poll. */
+        r = manager_schedule_mem_pressure_check(m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to reschedule memory pressure timer: %m");
+
         /* Toggle wake-ups for "ManagedOOMSwap" if entries are present. */
         r = sd_event_source_set_enabled(m->swap_context_event_source,
                                         hashmap_isempty(m->monitored_swap_cgroup_contexts) ? SD_EVENT_OFF : SD_EVENT_ON);
@@ -187,13 +247,14 @@ finish:
 }
 
 /* Fill 'new_h' with 'path's descendant OomdCGroupContexts. Only include descendant cgroups that are possible
- * candidates for action. That is, only leaf cgroups or cgroups with memory.oom.group set to "1".
+ * candidates for action. That is, only leaf cgroups or cgroups with memory.oom.group set to "1". Contexts
+ * found in 'old_h' (which may be NULL) are moved over and refreshed in place.
  *
  * This function ignores most errors in order to handle cgroups that may have been cleaned up while
  * populating the hashmap.
  *
- * 'new_h' is of the form { key: cgroup paths -> value: OomdCGroupContext } */
-static int recursively_get_cgroup_context(Hashmap *new_h, const char *path) {
+ * 'old_h' and 'new_h' are of the form { key: cgroup paths -> value: OomdCGroupContext } */
+static int recursively_get_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path) {
         _cleanup_free_ char *subpath = NULL;
         _cleanup_closedir_ DIR *d = NULL;
         int r;
@@ -209,7 +270,7 @@ static int recursively_get_cgroup_context(Hashmap *new_h, const char *path) {
         if (r < 0)
                 return r;
         else if (r == 0) { /* No subgroups? We're a leaf node */
-                r = oomd_insert_cgroup_context(NULL, new_h, path);
+                r = oomd_move_cgroup_context(old_h, new_h, path);
                 if (r == -ENOMEM)
                         return r;
                 if (r < 0)
@@ -237,9 +298,9 @@ static int recursively_get_cgroup_context(Hashmap *new_h, const char *path) {
                 }
 
                 if (oom_group)
-                        r = oomd_insert_cgroup_context(NULL, new_h, cg_path);
+                        r = oomd_move_cgroup_context(old_h, new_h, cg_path);
                 else
-                        r = recursively_get_cgroup_context(new_h, cg_path);
+                        r = recursively_get_cgroup_context(old_h, new_h, cg_path);
                 if (r == -ENOMEM)
                         return r;
                 if (r < 0)
@@ -261,12 +322,11 @@ static int update_monitored_cgroup_contexts(Hashmap **monitored_cgroups) {
                 return -ENOMEM;
 
         HASHMAP_FOREACH(ctx, *monitored_cgroups) {
-                /* Skip most errors since the cgroup we're trying to update might not exist anymore. */
-                r = oomd_insert_cgroup_context(*monitored_cgroups, new_base, ctx->path);
+                /* Skip most errors since the cgroup we're trying to update might not exist anymore. The
+                 * context is freed in that case, and the error was already logged. */
+                r = oomd_move_cgroup_context(*monitored_cgroups, new_base, ctx->path);
                 if (r == -ENOMEM)
                         return r;
-                if (r < 0 && !IN_SET(r, -EEXIST, -ENOENT))
-                        log_debug_errno(r, "Failed to insert context for %s, ignoring: %m", ctx->path);
         }
 
         hashmap_free(*monitored_cgroups);
@@ -275,7 +335,8 @@ static int update_monitored_cgroup_contexts(Hashmap **monitored_cgroups) {
         return 0;
 }
 
-static int get_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups, Hashmap **ret_candidates) {
+/* 'old_candidates' may be NULL. If not, contexts still present in the tree are moved from it to the returned map. */
+static int get_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups, Hashmap *old_candidates, Hashmap **ret_candidates) {
         _cleanup_hashmap_free_ Hashmap *candidates = NULL;
         OomdCGroupContext *ctx;
         int r;
@@ -288,7 +349,7 @@ static int get_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups,
                 return -ENOMEM;
 
         HASHMAP_FOREACH(ctx, monitored_cgroups) {
-                r = recursively_get_cgroup_context(candidates, ctx->path);
+                r = recursively_get_cgroup_context(old_candidates, candidates, ctx->path);
                 if (r == -ENOMEM)
                         return r;
                 if (r < 0)
@@ -308,18 +369,162 @@ static int update_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroup
         assert(candidates);
         assert(*candidates);
 
-        r = get_monitored_cgroup_contexts_candidates(monitored_cgroups, &new_candidates);
+        /* Contexts of cgroups that are still around are refreshed in place, only those of new cgroups are
+         * acquired afresh, and whatever is left in the old map belongs to cgroups that went away. */
+        r = get_monitored_cgroup_contexts_candidates(monitored_cgroups, *candidates, &new_candidates);
         if (r < 0)
                 return log_debug_errno(r, "Failed to get candidate contexts: %m");
 
-        oomd_update_cgroup_contexts_between_hashmaps(*candidates, new_candidates);
-
         hashmap_free(*candidates);
         *candidates = TAKE_PTR(new_candidates);
 
         return 0;
 }
 
+static int on_mem_pressure_trigger(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        OomdPressureTrigger *t = ASSERT_PTR(userdata);
+        Manager *m = ASSERT_PTR(t->manager);
+        int r;
+
+        if (FLAGS_SET(revents, EPOLLERR)) {
+                /* The cgroup is being removed, or the trigger is otherwise unusable. Poll until the cgroup
+                 * drops out of the monitored set. */
+                log_debug("Memory pressure trigger for %s failed, polling instead.", t->path);
+                t->event_source = sd_event_source_disable_unref(t->event_source);
+                return manager_schedule_mem_pressure_check(m);
+        }
+
+        log_debug("Memory pressure trigger for %s fired.", t->path);
+
+        r = sd_event_now(sd_event_source_get_event(s), CLOCK_MONOTONIC, &m->mem_pressure_trigger_fired_usec);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get current time: %m");
+
+        r = manager_schedule_mem_pressure_check(m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to reschedule memory pressure timer: %m");
+
+        return 0;
+}
+
+static int oomd_pressure_trigger_arm(OomdPressureTrigger *t) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
+        _cleanup_free_ char *p = NULL, *trigger = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        int r;
+
+        assert(t);
+        assert(t->manager);
+        assert(!t->event_source);
+
+        r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, t->path, "memory.pressure", &p);
+        if (r < 0)
+                return r;
+
+        fd = open(p, O_RDWR|O_NONBLOCK|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        /* Fire if all tasks of the cgroup were stalled for longer than the limit permits within the window */
+        if (asprintf(&trigger,
+                     "full " USEC_FMT " " USEC_FMT,
+                     oomd_mem_pressure_trigger_threshold_usec(t->limit, MEM_PRESSURE_TRIGGER_WINDOW_USEC),
+                     MEM_PRESSURE_TRIGGER_WINDOW_USEC) < 0)
+                return -ENOMEM;
+
+        /* The kernel wants the trigger in a single write, including the trailing NUL byte */
+        if (write(fd, trigger, strlen(trigger) + 1) < 0)
+                return -errno;
+
+        r = sd_event_add_io(t->manager->event, &s, fd, EPOLLPRI, on_mem_pressure_trigger, t);
+        if (r < 0)
+                return r;
+
+        r = sd_event_source_set_io_fd_own(s, true);
+        if (r < 0)
+                return r;
+        TAKE_FD(fd);
+
+        (void) sd_event_source_set_description(s, "oomd-memory-pressure-trigger");
+
+        t->event_source = TAKE_PTR(s);
+        return 0;
+}
+
+static int manager_update_mem_pressure_triggers(Manager *m) {
+        OomdCGroupContext *ctx;
+        OomdPressureTrigger *t;
+        int r;
+
+        assert(m);
+
+        /* Drop the triggers of cgroups that are not monitored anymore, or whose limit changed */
+        HASHMAP_FOREACH(t, m->mem_pressure_triggers) {
+                ctx = hashmap_get(m->monitored_mem_pressure_cgroup_contexts, t->path);
+                if (!ctx || ctx->mem_pressure_limit != t->limit)
+                        oomd_pressure_trigger_free(hashmap_remove(m->mem_pressure_triggers, t->path));
+        }
+
+        HASHMAP_FOREACH(ctx, m->monitored_mem_pressure_cgroup_contexts) {
+                _cleanup_(oomd_pressure_trigger_freep) OomdPressureTrigger *n = NULL;
+
+                if (hashmap_contains(m->mem_pressure_triggers, ctx->path))
+                        continue;
+
+                n = new(OomdPressureTrigger, 1);
+                if (!n)
+                        return -ENOMEM;
+
+                *n = (OomdPressureTrigger) {
+                        .manager = m,
+                        .path = strdup(ctx->path),
+                        .limit = ctx->mem_pressure_limit,
+                };
+                if (!n->path)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(&m->mem_pressure_triggers, &oomd_pressure_trigger_hash_ops, n->path, n);
+                if (r < 0)
+                        return r;
+                t = TAKE_PTR(n);
+
+                /* Keep the entry even if arming fails, so that we don't retry on every poll. */
+                r = oomd_pressure_trigger_arm(t);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0)
+                        log_debug_errno(r, "Failed to set up memory pressure trigger for %s, polling instead: %m", t->path);
+        }
+
+        return 0;
+}
+
+static usec_t manager_get_mem_pressure_interval(Manager *m, usec_t usec_now) {
+        OomdCGroupContext *ctx;
+
+        assert(m);
+
+        if (m->mem_pressure_post_action_delay_start > 0)
+                return MEM_PRESSURE_INTERVAL_USEC;
+
+        if (m->mem_pressure_trigger_fired_usec > 0 &&
+            usec_add(m->mem_pressure_trigger_fired_usec, MEM_PRESSURE_TRIGGER_HOLD_USEC) > usec_now)
+                return MEM_PRESSURE_INTERVAL_USEC;
+
+        HASHMAP_FOREACH(ctx, m->monitored_mem_pressure_cgroup_contexts) {
+                OomdPressureTrigger *t;
+
+                if (ctx->mem_pressure_limit_hit_start > 0)
+                        return MEM_PRESSURE_INTERVAL_USEC;
+
+                t = hashmap_get(m->mem_pressure_triggers, ctx->path);
+                if (!t || !t->event_source)
+                        return MEM_PRESSURE_INTERVAL_USEC;
+        }
+
+        return MEM_PRESSURE_IDLE_INTERVAL_USEC;
+}
+
 static int acquire_managed_oom_connect(Manager *m) {
         _cleanup_(sd_varlink_close_unrefp) sd_varlink *link = NULL;
         int r;
@@ -394,7 +599,7 @@ static int monitor_swap_contexts_handler(sd_event_source *s, uint64_t usec, void
                           m->system_context.swap_used, m->system_context.swap_total,
                           PERMYRIAD_AS_PERCENT_FORMAT_VAL(m->swap_used_limit_permyriad));
 
-                r = get_monitored_cgroup_contexts_candidates(m->monitored_swap_cgroup_contexts, &candidates);
+                r = get_monitored_cgroup_contexts_candidates(m->monitored_swap_cgroup_contexts, /* old_candidates= */ NULL, &candidates);
                 if (r == -ENOMEM)
                         return log_oom();
                 if (r < 0)
@@ -437,26 +642,15 @@ static void clear_candidate_hashmapp(Manager **m) {
                 hashmap_clear((*m)->monitored_mem_pressure_cgroup_contexts_candidates);
 }
 
-static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+static int process_memory_pressure_contexts(Manager *m, usec_t usec_now) {
         /* Don't want to use stale candidate data. Setting this will clear the candidate hashmap on return unless we
          * update the candidate data (in which case clear_candidates will be NULL). */
-        _unused_ _cleanup_(clear_candidate_hashmapp) Manager *clear_candidates = userdata;
+        _unused_ _cleanup_(clear_candidate_hashmapp) Manager *clear_candidates = m;
         _cleanup_set_free_ Set *targets = NULL;
         bool in_post_action_delay = false;
-        Manager *m = ASSERT_PTR(userdata);
-        usec_t usec_now;
         int r;
 
-        assert(s);
-
-        /* Reset timer */
-        r = sd_event_now(sd_event_source_get_event(s), CLOCK_MONOTONIC, &usec_now);
-        if (r < 0)
-                return log_error_errno(r, "Failed to reset event timer: %m");
-
-        r = sd_event_source_set_time_relative(s, MEM_PRESSURE_INTERVAL_USEC);
-        if (r < 0)
-                return log_error_errno(r, "Failed to set relative time for timer: %m");
+        assert(m);
 
         /* Reconnect if our connection dropped */
         if (!m->varlink_client) {
@@ -466,8 +660,10 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
         }
 
         /* Return early if nothing is requesting memory pressure monitoring */
-        if (hashmap_isempty(m->monitored_mem_pressure_cgroup_contexts))
+        if (hashmap_isempty(m->monitored_mem_pressure_cgroup_contexts)) {
+                m->mem_pressure_triggers = hashmap_free(m->mem_pressure_triggers);
                 return 0;
+        }
 
         /* Update the cgroups used for detection/action */
         r = update_monitored_cgroup_contexts(&m->monitored_mem_pressure_cgroup_contexts);
@@ -476,6 +672,13 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
         if (r < 0)
                 log_debug_errno(r, "Failed to update monitored memory pressure cgroup contexts, ignoring: %m");
 
+        /* Arm PSI triggers for new cgroups, so that we can poll less often while there's no pressure */
+        r = manager_update_mem_pressure_triggers(m);
+        if (r == -ENOMEM)
+                return log_oom();
+        if (r < 0)
+                log_debug_errno(r, "Failed to update memory pressure triggers, ignoring: %m");
+
         /* Since pressure counters are lagging, we need to wait a bit after a kill to ensure we don't read stale
          * values and go on a kill storm. */
         if (m->mem_pressure_post_action_delay_start > 0) {
@@ -580,6 +783,29 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
         return 0;
 }
 
+static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        usec_t usec_now;
+        int r;
+
+        assert(s);
+
+        r = sd_event_now(sd_event_source_get_event(s), CLOCK_MONOTONIC, &usec_now);
+        if (r < 0)
+                return log_error_errno(r, "Failed to reset event timer: %m");
+
+        r = process_memory_pressure_contexts(m, usec_now);
+        if (r < 0)
+                return r;
+
+        /* Reset timer. Only poll rarely if we can rely on the PSI triggers to wake us up. */
+        r = sd_event_source_set_time_relative(s, manager_get_mem_pressure_interval(m, usec_now));
+        if (r < 0)
+                return log_error_errno(r, "Failed to set relative time for timer: %m");
+
+        return 0;
+}
+
 static int monitor_swap_contexts(Manager *m) {
         _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
         int r;
@@ -637,6 +863,7 @@ Manager* manager_free(Manager *m) {
         sd_varlink_close_unref(m->varlink_client);
         sd_event_source_unref(m->swap_context_event_source);
         sd_event_source_unref(m->mem_pressure_context_event_source);
+        hashmap_free(m->mem_pressure_triggers);
         sd_event_unref(m->event);
 
         hashmap_free(m->polkit_registry);
@@ -12,6 +12,13 @@
 #define SWAP_INTERVAL_USEC 150000 /* 0.15 seconds */
 /* Pressure counters are lagging (~2 seconds) compared to swap so polling too frequently just wastes CPU */
 #define MEM_PRESSURE_INTERVAL_USEC (1 * USEC_PER_SEC)
+/* While PSI triggers are armed for all cgroups monitored for memory pressure and none of them is above its
+ * limit, rely on the triggers to wake us up and only poll rarely. 2s is the shortest trigger window the kernel
+ * permits unprivileged. Since avg10 lags behind the stall time the triggers watch, keep polling at the regular
+ * interval for a while after a trigger fired. */
+#define MEM_PRESSURE_IDLE_INTERVAL_USEC (10 * USEC_PER_SEC)
+#define MEM_PRESSURE_TRIGGER_WINDOW_USEC (2 * USEC_PER_SEC)
+#define MEM_PRESSURE_TRIGGER_HOLD_USEC (10 * USEC_PER_SEC)
 
 /* Take action if 10s of memory pressure > 60 for more than 30s. We use the "full" value from PSI so this is the
  * percentage of time all tasks were delayed (i.e. unproductive).
@@ -46,6 +53,11 @@ struct Manager {
         Hashmap *monitored_mem_pressure_cgroup_contexts;
         Hashmap *monitored_mem_pressure_cgroup_contexts_candidates;
 
+        /* k: cgroup paths -> v: OomdPressureTrigger, for the cgroups in
+         * monitored_mem_pressure_cgroup_contexts. */
+        Hashmap *mem_pressure_triggers;
+        usec_t mem_pressure_trigger_fired_usec;
+
         OomdSystemContext system_context;
 
         usec_t mem_pressure_post_action_delay_start;
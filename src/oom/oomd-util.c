@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <fcntl.h>
 #include <sys/xattr.h>
 #include <unistd.h>
 
@@ -108,6 +109,17 @@ int oomd_pressure_above(Hashmap *h, Set **ret) {
         return 0;
 }
 
+usec_t oomd_mem_pressure_trigger_threshold_usec(loadavg_t limit, usec_t window_usec) {
+        usec_t threshold;
+
+        assert(window_usec > 0);
+
+        /* The limit is a percentage in fixed point */
+        threshold = (usec_t) limit * window_usec / (100 * LOADAVG_FIXED_POINT_1_0);
+
+        return CLAMP(threshold, (usec_t) 1, window_usec);
+}
+
 uint64_t oomd_pgscan_rate(const OomdCGroupContext *c) {
         uint64_t last_pgscan;
 
@@ -157,6 +169,10 @@ int oomd_fetch_cgroup_oom_preference(OomdCGroupContext *ctx, const char *prefix)
                 return log_debug_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "%s is not a descendant of %s", ctx->path, prefix);
 
+        /* Contexts are refreshed in place, hence forget what we read last time, in case the xattrs were
+         * removed or the ownership changed since. */
+        ctx->preference = MANAGED_OOM_PREFERENCE_NONE;
+
         r = cg_get_owner(ctx->path, &uid);
         if (r < 0)
                 return log_debug_errno(r, "Failed to get owner/group from %s: %m", ctx->path);
@@ -168,10 +184,8 @@ int oomd_fetch_cgroup_oom_preference(OomdCGroupContext *ctx, const char *prefix)
                 if (r < 0)
                         return log_debug_errno(r, "Failed to get owner/group from %s: %m", prefix);
 
-                if (uid != prefix_uid) {
-                        ctx->preference = MANAGED_OOM_PREFERENCE_NONE;
+                if (uid != prefix_uid)
                         return 0;
-                }
         }
 
         /* Ignore most errors when reading the xattr since it is usually unset and cgroup xattrs are only used
@@ -401,48 +415,49 @@ int oomd_kill_by_swap_usage(Hashmap *h, uint64_t threshold_usage, bool dry_run,
         return ret;
 }
 
-int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
-        _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *ctx = NULL;
+static int cgroup_context_read(const char *path, OomdCGroupContext *ctx) {
         _cleanup_free_ char *p = NULL, *val = NULL;
+        _cleanup_close_ int dfd = -EBADF;
         bool is_root;
         int r;
 
         assert(path);
-        assert(ret);
-
-        ctx = new0(OomdCGroupContext, 1);
-        if (!ctx)
-                return -ENOMEM;
+        assert(ctx);
 
         is_root = empty_or_root(path);
-        ctx->preference = MANAGED_OOM_PREFERENCE_NONE;
 
-        r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, path, "memory.pressure", &p);
+        /* Open the cgroup directory once and read all attributes relative to it, instead of resolving the full
+         * path again for each of them */
+        r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, path, NULL, &p);
         if (r < 0)
-                return log_debug_errno(r, "Error getting cgroup memory pressure path from %s: %m", path);
+                return log_debug_errno(r, "Error getting cgroup path from %s: %m", path);
+
+        dfd = open(p, O_DIRECTORY|O_PATH|O_CLOEXEC);
+        if (dfd < 0)
+                return log_debug_errno(errno, "Error opening cgroup directory %s: %m", p);
 
-        r = read_resource_pressure(p, PRESSURE_TYPE_FULL, &ctx->memory_pressure);
+        r = read_resource_pressure_at(dfd, "memory.pressure", PRESSURE_TYPE_FULL, &ctx->memory_pressure);
         if (r < 0)
-                return log_debug_errno(r, "Error parsing memory pressure from %s: %m", p);
+                return log_debug_errno(r, "Error parsing memory pressure from %s: %m", path);
 
         if (is_root) {
                 r = procfs_memory_get_used(&ctx->current_memory_usage);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory used from procfs: %m");
         } else {
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.current", &ctx->current_memory_usage);
+                r = cg_get_attribute_as_uint64_at(dfd, "memory.current", &ctx->current_memory_usage);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory.current from %s: %m", path);
 
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.min", &ctx->memory_min);
+                r = cg_get_attribute_as_uint64_at(dfd, "memory.min", &ctx->memory_min);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory.min from %s: %m", path);
 
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.low", &ctx->memory_low);
+                r = cg_get_attribute_as_uint64_at(dfd, "memory.low", &ctx->memory_low);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory.low from %s: %m", path);
 
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.swap.current", &ctx->swap_usage);
+                r = cg_get_attribute_as_uint64_at(dfd, "memory.swap.current", &ctx->swap_usage);
                 if (r == -ENODATA)
                         /* The kernel can be compiled without support for memory.swap.* files,
                          * or it can be disabled with boot param 'swapaccount=0' */
@@ -450,7 +465,7 @@ int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
                 else if (r < 0)
                         return log_debug_errno(r, "Error getting memory.swap.current from %s: %m", path);
 
-                r = cg_get_keyed_attribute(SYSTEMD_CGROUP_CONTROLLER, path, "memory.stat", STRV_MAKE("pgscan"), &val);
+                r = cg_get_keyed_attribute_full_at(dfd, "memory.stat", STRV_MAKE("pgscan"), &val, 0);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting pgscan from memory.stat under %s: %m", path);
 
@@ -459,6 +474,26 @@ int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
                         return log_debug_errno(r, "Error converting pgscan value to uint64_t: %m");
         }
 
+        return 0;
+}
+
+int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
+        _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *ctx = NULL;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        ctx = new0(OomdCGroupContext, 1);
+        if (!ctx)
+                return -ENOMEM;
+
+        ctx->preference = MANAGED_OOM_PREFERENCE_NONE;
+
+        r = cgroup_context_read(path, ctx);
+        if (r < 0)
+                return r;
+
         r = strdup_to(&ctx->path, empty_to_root(path));
         if (r < 0)
                 return r;
@@ -543,6 +578,61 @@ int oomd_system_context_acquire(const char *proc_meminfo_path, OomdSystemContext
         return 0;
 }
 
+int oomd_cgroup_context_refresh(OomdCGroupContext *ctx) {
+        OomdCGroupContext n = {};
+        int r;
+
+        assert(ctx);
+        assert(ctx->path);
+
+        /* Read into a scratch copy first, so that ctx is left untouched if the cgroup went away */
+        r = cgroup_context_read(ctx->path, &n);
+        if (r < 0)
+                return r;
+
+        ctx->memory_pressure = n.memory_pressure;
+        ctx->current_memory_usage = n.current_memory_usage;
+        ctx->memory_min = n.memory_min;
+        ctx->memory_low = n.memory_low;
+        ctx->swap_usage = n.swap_usage;
+        ctx->last_pgscan = ctx->pgscan;
+        ctx->pgscan = n.pgscan;
+
+        if (oomd_pgscan_rate(ctx) > 0)
+                ctx->last_had_mem_reclaim = now(CLOCK_MONOTONIC);
+
+        return 0;
+}
+
+int oomd_move_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path) {
+        _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *ctx = NULL;
+        int r;
+
+        assert(new_h);
+        assert(path);
+
+        path = empty_to_root(path);
+
+        /* Found via more than one monitored ancestor? Don't bother reading it twice. */
+        if (hashmap_contains(new_h, path))
+                return -EEXIST;
+
+        ctx = hashmap_remove(old_h, path);
+        if (!ctx)
+                return oomd_insert_cgroup_context(NULL, new_h, path);
+
+        r = oomd_cgroup_context_refresh(ctx);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to refresh OomdCGroupContext for %s: %m", path);
+
+        r = hashmap_put(new_h, ctx->path, ctx);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(ctx);
+        return 0;
+}
+
 int oomd_insert_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path) {
         _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *curr_ctx = NULL;
         OomdCGroupContext *old_ctx;
@@ -579,30 +669,6 @@ int oomd_insert_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path)
         return 0;
 }
 
-void oomd_update_cgroup_contexts_between_hashmaps(Hashmap *old_h, Hashmap *curr_h) {
-        OomdCGroupContext *ctx;
-
-        assert(old_h);
-        assert(curr_h);
-
-        HASHMAP_FOREACH(ctx, curr_h) {
-                OomdCGroupContext *old_ctx;
-
-                old_ctx = hashmap_get(old_h, ctx->path);
-                if (!old_ctx)
-                        continue;
-
-                ctx->last_pgscan = old_ctx->pgscan;
-                ctx->mem_pressure_limit = old_ctx->mem_pressure_limit;
-                ctx->mem_pressure_limit_hit_start = old_ctx->mem_pressure_limit_hit_start;
-                ctx->mem_pressure_duration_usec = old_ctx->mem_pressure_duration_usec;
-                ctx->last_had_mem_reclaim = old_ctx->last_had_mem_reclaim;
-
-                if (oomd_pgscan_rate(ctx) > 0)
-                        ctx->last_had_mem_reclaim = now(CLOCK_MONOTONIC);
-        }
-}
-
 void oomd_dump_swap_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix) {
         assert(ctx);
         assert(f);
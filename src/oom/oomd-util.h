@@ -67,6 +67,10 @@ bool oomd_mem_available_below(const OomdSystemContext *ctx, int threshold_permyr
 /* Returns true if the amount of swap free is below the permyriad of swap specified by `threshold_permyriad`. */
 bool oomd_swap_free_below(const OomdSystemContext *ctx, int threshold_permyriad);
 
+/* Returns the stall time within `window_usec` that corresponds to the memory pressure `limit`, suitable for a
+ * PSI trigger. The result is always at least 1µs and at most `window_usec`, as the kernel requires. */
+usec_t oomd_mem_pressure_trigger_threshold_usec(loadavg_t limit, usec_t window_usec);
+
 /* Returns pgscan - last_pgscan, accounting for corner cases. */
 uint64_t oomd_pgscan_rate(const OomdCGroupContext *c);
 
@@ -139,8 +143,14 @@ int oomd_system_context_acquire(const char *proc_swaps_path, OomdSystemContext *
  * was no prior data to reference. */
 int oomd_insert_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path);
 
-/* Update each OomdCGroupContext in `curr_h` with prior interval information from `old_h`. */
-void oomd_update_cgroup_contexts_between_hashmaps(Hashmap *old_h, Hashmap *curr_h);
+/* Re-read the counters of `ctx` in place, keeping the prior interval information. Leaves `ctx` unchanged on
+ * failure. */
+int oomd_cgroup_context_refresh(OomdCGroupContext *ctx);
+
+/* Like oomd_insert_cgroup_context(), but if `old_h` has a context for `path`, it is removed from `old_h`,
+ * refreshed in place and inserted into `new_h`, instead of acquiring a new one and copying the prior interval
+ * information over. On failure the context is freed. */
+int oomd_move_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path);
 
 void oomd_dump_swap_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix);
 void oomd_dump_memory_pressure_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix);
@@ -91,7 +91,7 @@ static void test_oomd_cgroup_kill(void) {
 }
 
 static void test_oomd_cgroup_context_acquire_and_insert(void) {
-        _cleanup_hashmap_free_ Hashmap *h1 = NULL, *h2 = NULL;
+        _cleanup_hashmap_free_ Hashmap *h1 = NULL, *h2 = NULL, *h3 = NULL;
         _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *ctx = NULL;
         _cleanup_free_ char *cgroup = NULL;
         OomdCGroupContext *c1, *c2;
@@ -152,61 +152,18 @@ static void test_oomd_cgroup_context_acquire_and_insert(void) {
         assert_se(c2->mem_pressure_limit_hit_start == 42);
         assert_se(c2->mem_pressure_duration_usec == 1234);
         assert_se(c2->last_had_mem_reclaim == 888); /* assumes the live pgscan is less than UINT64_MAX */
-}
-
-static void test_oomd_update_cgroup_contexts_between_hashmaps(void) {
-        _cleanup_hashmap_free_ Hashmap *h_old = NULL, *h_new = NULL;
-        OomdCGroupContext *c_old, *c_new;
-        char **paths = STRV_MAKE("/0.slice",
-                                 "/1.slice");
-
-        OomdCGroupContext ctx_old[2] = {
-                { .path = paths[0],
-                  .mem_pressure_limit = 5,
-                  .mem_pressure_limit_hit_start = 777,
-                  .mem_pressure_duration_usec = 111,
-                  .last_had_mem_reclaim = 888,
-                  .pgscan = 57 },
-                { .path = paths[1],
-                  .mem_pressure_limit = 6,
-                  .mem_pressure_limit_hit_start = 888,
-                  .mem_pressure_duration_usec = 222,
-                  .last_had_mem_reclaim = 888,
-                  .pgscan = 42 },
-        };
-
-        OomdCGroupContext ctx_new[2] = {
-                { .path = paths[0],
-                  .pgscan = 57 },
-                { .path = paths[1],
-                  .pgscan = 101 },
-        };
 
-        assert_se(h_old = hashmap_new(&string_hash_ops));
-        assert_se(hashmap_put(h_old, paths[0], &ctx_old[0]) >= 0);
-        assert_se(hashmap_put(h_old, paths[1], &ctx_old[1]) >= 0);
-
-        assert_se(h_new = hashmap_new(&string_hash_ops));
-        assert_se(hashmap_put(h_new, paths[0], &ctx_new[0]) >= 0);
-        assert_se(hashmap_put(h_new, paths[1], &ctx_new[1]) >= 0);
-
-        oomd_update_cgroup_contexts_between_hashmaps(h_old, h_new);
-
-        assert_se(c_old = hashmap_get(h_old, "/0.slice"));
-        assert_se(c_new = hashmap_get(h_new, "/0.slice"));
-        assert_se(c_old->pgscan == c_new->last_pgscan);
-        assert_se(c_old->mem_pressure_limit == c_new->mem_pressure_limit);
-        assert_se(c_old->mem_pressure_limit_hit_start == c_new->mem_pressure_limit_hit_start);
-        assert_se(c_old->mem_pressure_duration_usec == c_new->mem_pressure_duration_usec);
-        assert_se(c_old->last_had_mem_reclaim == c_new->last_had_mem_reclaim);
-
-        assert_se(c_old = hashmap_get(h_old, "/1.slice"));
-        assert_se(c_new = hashmap_get(h_new, "/1.slice"));
-        assert_se(c_old->pgscan == c_new->last_pgscan);
-        assert_se(c_old->mem_pressure_limit == c_new->mem_pressure_limit);
-        assert_se(c_old->mem_pressure_limit_hit_start == c_new->mem_pressure_limit_hit_start);
-        assert_se(c_old->mem_pressure_duration_usec == c_new->mem_pressure_duration_usec);
-        assert_se(c_new->last_had_mem_reclaim > c_old->last_had_mem_reclaim);
+        /* Moving refreshes the very same context in place */
+        c2->pgscan = 0;
+        assert_se(h3 = hashmap_new(&oomd_cgroup_ctx_hash_ops));
+        assert_se(oomd_move_cgroup_context(h2, h3, cgroup) == 0);
+        assert_se(!hashmap_get(h2, cgroup));
+        assert_se(hashmap_get(h3, cgroup) == c2);
+        assert_se(c2->last_pgscan == 0);
+        assert_se(c2->mem_pressure_limit == 6789);
+        assert_se(c2->mem_pressure_limit_hit_start == 42);
+        assert_se(c2->mem_pressure_duration_usec == 1234);
+        assert_se(oomd_move_cgroup_context(h2, h3, cgroup) == -EEXIST);
 }
 
 static void test_oomd_system_context_acquire(void) {
@@ -328,6 +285,23 @@ static void test_oomd_mem_and_swap_free_below(void) {
         assert_se(oomd_swap_free_below(&ctx, 2000) == false);
 }
 
+static void test_oomd_mem_pressure_trigger_threshold(void) {
+        loadavg_t limit;
+
+        assert_se(store_loadavg_fixed_point(60, 0, &limit) == 0);
+        assert_se(oomd_mem_pressure_trigger_threshold_usec(limit, 2 * USEC_PER_SEC) == 1200 * USEC_PER_MSEC);
+
+        assert_se(store_loadavg_fixed_point(50, 50, &limit) == 0);
+        assert_se(oomd_mem_pressure_trigger_threshold_usec(limit, 2 * USEC_PER_SEC) == 1010 * USEC_PER_MSEC);
+
+        assert_se(store_loadavg_fixed_point(100, 0, &limit) == 0);
+        assert_se(oomd_mem_pressure_trigger_threshold_usec(limit, 2 * USEC_PER_SEC) == 2 * USEC_PER_SEC);
+
+        /* The kernel refuses triggers with a zero threshold */
+        assert_se(store_loadavg_fixed_point(0, 0, &limit) == 0);
+        assert_se(oomd_mem_pressure_trigger_threshold_usec(limit, 2 * USEC_PER_SEC) == 1);
+}
+
 static void test_oomd_sort_cgroups(void) {
         _cleanup_hashmap_free_ Hashmap *h = NULL;
         _cleanup_free_ OomdCGroupContext **sorted_cgroups;
@@ -467,6 +441,11 @@ static void test_oomd_fetch_cgroup_oom_preference(void) {
                 assert_se(oomd_cgroup_context_acquire(cgroup, &ctx) == 0);
                 assert_se(oomd_fetch_cgroup_oom_preference(ctx, NULL) == 0);
                 assert_se(ctx->preference == MANAGED_OOM_PREFERENCE_AVOID);
+
+                /* a context that is refreshed in place must not keep a preference that was unset since */
+                assert_se(cg_set_xattr(cgroup, "user.oomd_avoid", "0", 1, 0) >= 0);
+                assert_se(oomd_fetch_cgroup_oom_preference(ctx, NULL) == 0);
+                assert_se(ctx->preference == MANAGED_OOM_PREFERENCE_NONE);
                 ctx = oomd_cgroup_context_free(ctx);
         }
 
@@ -503,10 +482,10 @@ int main(void) {
 
         test_setup_logging(LOG_DEBUG);
 
-        test_oomd_update_cgroup_contexts_between_hashmaps();
         test_oomd_system_context_acquire();
         test_oomd_pressure_above();
         test_oomd_mem_and_swap_free_below();
+        test_oomd_mem_pressure_trigger_threshold();
         test_oomd_sort_cgroups();
 
         /* The following tests operate on live cgroups */
@@ -877,8 +877,8 @@ static int event_log_add_algorithms_from_record(EventLog *el, EventLogRecord *re
 
 static int event_log_load_firmware(EventLog *el) {
         const TCG_EfiSpecIdEventAlgorithmSize *algorithms;
-        size_t bufsize = 0, n_algorithms = 0, left = 0;
-        _cleanup_free_ void *buf = NULL;
+        _cleanup_(file_view_done) FileView view = {};
+        size_t n_algorithms = 0, left = 0;
         const TCG_PCR_EVENT2 *event;
         const char *path;
         int r;
@@ -887,17 +887,17 @@ static int event_log_load_firmware(EventLog *el) {
 
         path = tpm2_firmware_log_path();
 
-        r = read_full_file(path, (char**) &buf, &bufsize);
+        r = read_full_file_view(path, &view);
         if (r < 0)
                 return log_error_errno(r, "Failed to open TPM2 event log '%s': %m", path);
 
-        if (bufsize == 0) {
+        if (view.size == 0) {
                 /* Sometimes it's useful to invoke things with SYSTEMD_MEASURE_LOG_FIRMWARE=/dev/null, let's allow that, and proceed */
                 log_warning("Empty firmware event log file, not loading.");
                 return 0;
         }
 
-        r = validate_firmware_header(buf, bufsize, &algorithms, &n_algorithms, &event, &left);
+        r = validate_firmware_header(view.data, view.size, &algorithms, &n_algorithms, &event, &left);
         if (r < 0)
                 return r;
 
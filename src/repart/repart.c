@@ -5647,14 +5647,14 @@ static int do_copy_files(Context *context, Partition *p, const char *root) {
                                                 sfd, ".",
                                                 pfd, fn,
                                                 UID_INVALID, GID_INVALID,
-                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE|COPY_RESTORE_DIRECTORY_TIMESTAMPS,
+                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE|COPY_RESTORE_DIRECTORY_TIMESTAMPS|COPY_PARALLEL,
                                                 denylist, subvolumes_by_source_inode);
                         } else
                                 r = copy_tree_at(
                                                 sfd, ".",
                                                 tfd, ".",
                                                 UID_INVALID, GID_INVALID,
-                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE|COPY_RESTORE_DIRECTORY_TIMESTAMPS,
+                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE|COPY_RESTORE_DIRECTORY_TIMESTAMPS|COPY_PARALLEL,
                                                 denylist, subvolumes_by_source_inode);
                         if (r < 0)
                                 return log_error_errno(r, "Failed to copy '%s%s' to '%s%s': %m",
@@ -5968,17 +5968,176 @@ static int finalize_extra_mkfs_options(const Partition *p, const char *root, cha
         return 0;
 }
 
+static int partition_mkfs(Context *context, Partition *p, PartitionTarget *t) {
+        _cleanup_(rm_rf_physical_and_freep) char *root = NULL;
+        _cleanup_strv_free_ char **extra_mkfs_options = NULL;
+        int r;
+
+        assert(context);
+        assert(p);
+        assert(t);
+
+        if (p->encrypt != ENCRYPT_OFF && t->loop) {
+                r = partition_target_grow(t, p->new_size);
+                if (r < 0)
+                        return r;
+
+                r = partition_encrypt(context, p, t, /* offline = */ false);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to encrypt device: %m");
+        }
+
+        log_info("Formatting future partition %" PRIu64 ".", p->partno);
+
+        /* If we're not writing to a loop device or if we're populating a read-only filesystem, we
+         * have to populate using the filesystem's mkfs's --root (or equivalent) option. To do that,
+         * we need to set up the final directory tree beforehand. */
+
+        if (partition_needs_populate(p) && (!t->loop || fstype_is_ro(p->format))) {
+                if (!mkfs_supports_root_option(p->format))
+                        return log_error_errno(SYNTHETIC_ERRNO(ENODEV),
+                                                "Loop device access is required to populate %s filesystems.",
+                                                p->format);
+
+                r = partition_populate_directory(context, p, &root);
+                if (r < 0)
+                        return r;
+        }
+
+        r = finalize_extra_mkfs_options(p, root, &extra_mkfs_options);
+        if (r < 0)
+                return r;
+
+        r = make_filesystem(partition_target_path(t), p->format, strempty(p->new_label), root,
+                            p->fs_uuid, arg_discard, /* quiet = */ false,
+                            context->fs_sector_size, p->compression, p->compression_level,
+                            extra_mkfs_options);
+        if (r < 0)
+                return r;
+
+        /* The mkfs binary we invoked might have removed our temporary file when we're not operating
+         * on a loop device, so open the file again to make sure our file descriptor points to actual
+         * new file. */
+
+        if (t->fd >= 0 && t->path && !t->loop) {
+                safe_close(t->fd);
+                t->fd = open(t->path, O_RDWR|O_CLOEXEC);
+                if (t->fd < 0)
+                        return log_error_errno(errno, "Failed to reopen temporary file: %m");
+        }
+
+        log_info("Successfully formatted future partition %" PRIu64 ".", p->partno);
+
+        /* If we're writing to a loop device, we can now mount the empty filesystem and populate it. */
+        if (partition_needs_populate(p) && !root) {
+                assert(t->loop);
+
+                r = partition_populate_filesystem(context, p, partition_target_path(t));
+                if (r < 0)
+                        return r;
+        }
+
+        if (p->encrypt != ENCRYPT_OFF && !t->loop) {
+                r = partition_target_grow(t, p->new_size);
+                if (r < 0)
+                        return r;
+
+                r = partition_encrypt(context, p, t, /* offline = */ true);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to encrypt device: %m");
+        }
+
+        /* Note that we always sync explicitly here, since mkfs.fat doesn't do that on its own, and
+         * if we don't sync before detaching a block device the in-flight sectors possibly won't hit
+         * the disk. */
+
+        r = partition_target_sync(context, p, t);
+        if (r < 0)
+                return r;
+
+        if (p->siblings[VERITY_HASH] && !partition_type_defer(&p->siblings[VERITY_HASH]->type)) {
+                r = partition_format_verity_hash(context, p->siblings[VERITY_HASH],
+                                                 /* node = */ NULL, partition_target_path(t));
+                if (r < 0)
+                        return r;
+        }
+
+        if (p->siblings[VERITY_SIG] && !partition_type_defer(&p->siblings[VERITY_SIG]->type)) {
+                r = partition_format_verity_sig(context, p->siblings[VERITY_SIG]);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+/* At most this many partitions are formatted and populated by worker processes at the same time */
+#define MKFS_JOBS_MAX 4U
+
+typedef struct MkfsJob {
+        Partition *partition;
+        PartitionTarget *target;
+        pid_t pid;
+} MkfsJob;
+
+static void mkfs_job_array_free(MkfsJob *jobs, size_t n) {
+        FOREACH_ARRAY(j, jobs, n) {
+                if (j->pid > 0)
+                        sigkill_wait(TAKE_PID(j->pid));
+
+                partition_target_free(j->target);
+        }
+
+        free(jobs);
+}
+
+static int mkfs_job_wait(MkfsJob *j) {
+        int r;
+
+        assert(j);
+        assert(j->pid > 0);
+
+        r = wait_for_terminate_and_check("(sd-mkfs)", TAKE_PID(j->pid), WAIT_LOG);
+        j->target = partition_target_free(j->target);
+        if (r < 0)
+                return r;
+        if (r != EXIT_SUCCESS)
+                return log_error_errno(SYNTHETIC_ERRNO(EPROTO),
+                                       "Failed to format future partition %" PRIu64 ".", j->partition->partno);
+
+        return 0;
+}
+
+static bool partition_mkfs_in_worker(const Partition *p, const PartitionTarget *t) {
+        assert(p);
+        assert(t);
+
+        /* Formatting and populating a partition doesn't depend on any other partition, hence may happen in a
+         * worker process while we continue with the next one, as long as nothing needs to make it back to
+         * us: encryption and Verity set up state we need later on. Also, the contents of temporary files
+         * are copied into the image through the file offset of the image fd, which we'd share with the
+         * worker, hence only do this for loopback devices. */
+
+        return t->loop &&
+                p->encrypt == ENCRYPT_OFF &&
+                !p->siblings[VERITY_HASH] &&
+                !p->siblings[VERITY_SIG];
+}
+
 static int context_mkfs(Context *context) {
+        MkfsJob *jobs = NULL;
+        size_t n_jobs = 0, n_done = 0;
         int r;
 
         assert(context);
 
+        CLEANUP_ARRAY(jobs, n_jobs, mkfs_job_array_free);
+
         /* Make a file system */
 
         LIST_FOREACH(partitions, p, context->partitions) {
-                _cleanup_(rm_rf_physical_and_freep) char *root = NULL;
                 _cleanup_(partition_target_freep) PartitionTarget *t = NULL;
-                _cleanup_strv_free_ char **extra_mkfs_options = NULL;
+                pid_t pid;
 
                 if (p->dropped)
                         continue;
@@ -6009,96 +6168,43 @@ static int context_mkfs(Context *context) {
                 if (r < 0)
                         return r;
 
-                if (p->encrypt != ENCRYPT_OFF && t->loop) {
-                        r = partition_target_grow(t, p->new_size);
+                if (!partition_mkfs_in_worker(p, t)) {
+                        r = partition_mkfs(context, p, t);
                         if (r < 0)
                                 return r;
 
-                        r = partition_encrypt(context, p, t, /* offline = */ false);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to encrypt device: %m");
+                        continue;
                 }
 
-                log_info("Formatting future partition %" PRIu64 ".", p->partno);
-
-                /* If we're not writing to a loop device or if we're populating a read-only filesystem, we
-                 * have to populate using the filesystem's mkfs's --root (or equivalent) option. To do that,
-                 * we need to set up the final directory tree beforehand. */
-
-                if (partition_needs_populate(p) && (!t->loop || fstype_is_ro(p->format))) {
-                        if (!mkfs_supports_root_option(p->format))
-                                return log_error_errno(SYNTHETIC_ERRNO(ENODEV),
-                                                        "Loop device access is required to populate %s filesystems.",
-                                                        p->format);
-
-                        r = partition_populate_directory(context, p, &root);
+                if (n_jobs - n_done >= MKFS_JOBS_MAX) {
+                        r = mkfs_job_wait(jobs + n_done++);
                         if (r < 0)
                                 return r;
                 }
 
-                r = finalize_extra_mkfs_options(p, root, &extra_mkfs_options);
-                if (r < 0)
-                        return r;
+                if (!GREEDY_REALLOC(jobs, n_jobs + 1))
+                        return log_oom();
 
-                r = make_filesystem(partition_target_path(t), p->format, strempty(p->new_label), root,
-                                    p->fs_uuid, arg_discard, /* quiet = */ false,
-                                    context->fs_sector_size, p->compression, p->compression_level,
-                                    extra_mkfs_options);
+                r = safe_fork("(sd-mkfs)", FORK_DEATHSIG_SIGTERM|FORK_LOG, &pid);
                 if (r < 0)
                         return r;
-
-                /* The mkfs binary we invoked might have removed our temporary file when we're not operating
-                 * on a loop device, so open the file again to make sure our file descriptor points to actual
-                 * new file. */
-
-                if (t->fd >= 0 && t->path && !t->loop) {
-                        safe_close(t->fd);
-                        t->fd = open(t->path, O_RDWR|O_CLOEXEC);
-                        if (t->fd < 0)
-                                return log_error_errno(errno, "Failed to reopen temporary file: %m");
-                }
-
-                log_info("Successfully formatted future partition %" PRIu64 ".", p->partno);
-
-                /* If we're writing to a loop device, we can now mount the empty filesystem and populate it. */
-                if (partition_needs_populate(p) && !root) {
-                        assert(t->loop);
-
-                        r = partition_populate_filesystem(context, p, partition_target_path(t));
-                        if (r < 0)
-                                return r;
-                }
-
-                if (p->encrypt != ENCRYPT_OFF && !t->loop) {
-                        r = partition_target_grow(t, p->new_size);
-                        if (r < 0)
-                                return r;
-
-                        r = partition_encrypt(context, p, t, /* offline = */ true);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to encrypt device: %m");
+                if (r == 0) {
+                        /* Child */
+                        r = partition_mkfs(context, p, t);
+                        _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
                 }
 
-                /* Note that we always sync explicitly here, since mkfs.fat doesn't do that on its own, and
-                 * if we don't sync before detaching a block device the in-flight sectors possibly won't hit
-                 * the disk. */
+                jobs[n_jobs++] = (MkfsJob) {
+                        .partition = p,
+                        .target = TAKE_PTR(t),
+                        .pid = pid,
+                };
+        }
 
-                r = partition_target_sync(context, p, t);
+        for (; n_done < n_jobs; n_done++) {
+                r = mkfs_job_wait(jobs + n_done);
                 if (r < 0)
                         return r;
-
-                if (p->siblings[VERITY_HASH] && !partition_type_defer(&p->siblings[VERITY_HASH]->type)) {
-                        r = partition_format_verity_hash(context, p->siblings[VERITY_HASH],
-                                                         /* node = */ NULL, partition_target_path(t));
-                        if (r < 0)
-                                return r;
-                }
-
-                if (p->siblings[VERITY_SIG] && !partition_type_defer(&p->siblings[VERITY_SIG]->type)) {
-                        r = partition_format_verity_sig(context, p->siblings[VERITY_SIG]);
-                        if (r < 0)
-                                return r;
-                }
         }
 
         return 0;
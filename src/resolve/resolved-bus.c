@@ -1673,6 +1673,7 @@ static int bus_property_get_cache_statistics(
                 hit += s->cache.n_hit;
                 miss += s->cache.n_miss;
         }
+        hit += m->n_stub_reply_hit;
 
         return sd_bus_message_append(reply, "(ttt)", size, hit, miss);
 }
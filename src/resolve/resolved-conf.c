@@ -275,6 +275,36 @@ int config_parse_dns_stub_listener_extra(
         return 0;
 }
 
+int config_parse_cache_max_entries(
+                const char *unit,
+                const char *filename,
+                unsigned line,
+                const char *section,
+                unsigned section_line,
+                const char *lvalue,
+                int ltype,
+                const char *rvalue,
+                void *data,
+                void *userdata) {
+
+        unsigned *entries_max = ASSERT_PTR(data);
+
+        assert(filename);
+        assert(lvalue);
+        assert(rvalue);
+
+        if (isempty(rvalue)) {
+                *entries_max = DNS_CACHE_ENTRIES_MAX_DEFAULT;
+                return 0;
+        }
+
+        /* A cache that may not hold anything is not a cache, use Cache=no for that */
+        return config_parse_unsigned_bounded(
+                        unit, filename, line, section, section_line, lvalue, rvalue,
+                        1, UINT_MAX, /* ignoring= */ true,
+                        entries_max);
+}
+
 static void read_credentials(Manager *m) {
         _cleanup_free_ char *dns = NULL, *domains = NULL;
         int r;
@@ -11,9 +11,12 @@
 #include "resolved-dns-packet.h"
 #include "string-util.h"
 
-/* Never cache more than 4K entries. RFC 1536, Section 5 suggests to
+/* Never cache more than CacheMaxEntries= entries (4K by default). RFC 1536, Section 5 suggests to
  * leave DNS caches unbounded, but that's crazy. */
-#define CACHE_MAX 4096
+
+/* The share of the cache (in percent) that entries which have been hit at least once may take up. The rest
+ * is left to the probation segment, so that a burst of one-off lookups can't flush the popular entries. */
+#define CACHE_PROTECTED_PERCENT 80U
 
 /* We never keep any item longer than 2h in our cache unless StaleRetentionSec is greater than zero. */
 #define CACHE_TTL_MAX_USEC (2 * USEC_PER_HOUR)
@@ -21,6 +24,12 @@
 /* The max TTL for stale data is set to 30 seconds. See RFC 8767, Section 6. */
 #define CACHE_STALE_TTL_MAX_USEC (30 * USEC_PER_SEC)
 
+/* Entries that got hit at least this often are refreshed from upstream during the last tenth of their TTL,
+ * so that popular names never drop out of the cache. Entries with shorter TTLs than the minimum aren't, as
+ * refreshing them would mostly just double the upstream traffic. */
+#define CACHE_PREFETCH_HITS_MIN 2U
+#define CACHE_PREFETCH_TTL_MIN_USEC (10 * USEC_PER_SEC)
+
 /* How long to cache strange rcodes, i.e. rcodes != SUCCESS and != NXDOMAIN (specifically: that's only SERVFAIL for
  * now) */
 #define CACHE_TTL_STRANGE_RCODE_USEC (10 * USEC_PER_SEC)
@@ -57,6 +66,14 @@ struct DnsCacheItem {
         unsigned prioq_idx;
         LIST_FIELDS(DnsCacheItem, by_key);
 
+        unsigned lru_idx;        /* Index in either the probation or the protected prioq */
+        uint64_t last_use;
+        bool protected;
+
+        unsigned n_hit;
+        usec_t prefetch_after;   /* When to refresh the entry from upstream, if it's popular */
+        bool prefetched;
+
         bool shared_owner;
 };
 
@@ -99,6 +116,13 @@ static DnsCacheItem* dns_cache_item_free(DnsCacheItem *i) {
 }
 DEFINE_TRIVIAL_CLEANUP_FUNC(DnsCacheItem*, dns_cache_item_free);
 
+static Prioq* dns_cache_item_lru(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        return i->protected ? c->protected : c->probation;
+}
+
 static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
         DnsCacheItem *first;
 
@@ -116,6 +140,7 @@ static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
                 hashmap_remove(c->by_key, i->key);
 
         prioq_remove(c->by_expiry, i, &i->prioq_idx);
+        prioq_remove(dns_cache_item_lru(c, i), i, &i->lru_idx);
 
         dns_cache_item_free(i);
 }
@@ -150,6 +175,7 @@ static bool dns_cache_remove_by_key(DnsCache *c, DnsResourceKey *key) {
 
         LIST_FOREACH(by_key, i, first) {
                 prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                prioq_remove(dns_cache_item_lru(c, i), i, &i->lru_idx);
                 dns_cache_item_free(i);
         }
 
@@ -166,20 +192,47 @@ void dns_cache_flush(DnsCache *c) {
 
         assert(hashmap_isempty(c->by_key));
         assert(prioq_isempty(c->by_expiry));
+        assert(prioq_isempty(c->probation));
+        assert(prioq_isempty(c->protected));
 
         c->by_key = hashmap_free(c->by_key);
         c->by_expiry = prioq_free(c->by_expiry);
+        c->probation = prioq_free(c->probation);
+        c->protected = prioq_free(c->protected);
+}
+
+static DnsCacheItem* dns_cache_pick_victim(DnsCache *c) {
+        DnsCacheItem *i;
+
+        assert(c);
+
+        /* Entries that are already past their TTL and only kept around for serve-stale go first, then the
+         * least recently used entry that never got hit, and only then the least recently used one that
+         * did. */
+
+        i = prioq_peek(c->by_expiry);
+        if (i && i->until_valid <= now(CLOCK_BOOTTIME))
+                return i;
+
+        i = prioq_peek(c->probation);
+        if (i)
+                return i;
+
+        return prioq_peek(c->protected);
 }
 
-static void dns_cache_make_space(DnsCache *c, unsigned add) {
+static void dns_cache_make_space(DnsCache *c, unsigned add, unsigned entries_max) {
         assert(c);
 
         if (add <= 0)
                 return;
 
+        if (entries_max <= 0)
+                entries_max = DNS_CACHE_ENTRIES_MAX_DEFAULT;
+
         /* Makes space for n new entries. Note that we actually allow
-         * the cache to grow beyond CACHE_MAX, but only when we shall
-         * add more RRs to the cache than CACHE_MAX at once. In that
+         * the cache to grow beyond entries_max, but only when we shall
+         * add more RRs to the cache than entries_max at once. In that
          * case the cache will be emptied completely otherwise. */
 
         for (;;) {
@@ -189,16 +242,82 @@ static void dns_cache_make_space(DnsCache *c, unsigned add) {
                 if (prioq_isempty(c->by_expiry))
                         break;
 
-                if (prioq_size(c->by_expiry) + add < CACHE_MAX)
+                if (prioq_size(c->by_expiry) + add <= entries_max)
                         break;
 
-                i = prioq_peek(c->by_expiry);
+                i = dns_cache_pick_victim(c);
                 assert(i);
 
                 /* Take an extra reference to the key so that it
                  * doesn't go away in the middle of the remove call */
                 key = dns_resource_key_ref(i->key);
                 dns_cache_remove_by_key(c, key);
+                c->n_evicted++;
+        }
+}
+
+static void dns_cache_item_move(DnsCache *c, DnsCacheItem *i, bool protected) {
+        assert(c);
+        assert(i);
+
+        if (i->protected == protected) {
+                prioq_reshuffle(dns_cache_item_lru(c, i), i, &i->lru_idx);
+                return;
+        }
+
+        prioq_remove(dns_cache_item_lru(c, i), i, &i->lru_idx);
+
+        if (prioq_put(protected ? c->protected : c->probation, i, &i->lru_idx) < 0) {
+                /* Out of memory? Then just leave the entry in its segment. Putting it back can't fail, as
+                 * prioqs never shrink their allocation. */
+                assert_se(prioq_put(dns_cache_item_lru(c, i), i, &i->lru_idx) >= 0);
+                return;
+        }
+
+        i->protected = protected;
+}
+
+static void dns_cache_demote(DnsCache *c, DnsCacheItem *first) {
+        assert(c);
+
+        /* Moves all entries of a key back to the probation segment, as most recently used entries there */
+
+        c->use_counter++;
+
+        LIST_FOREACH(by_key, i, first) {
+                i->last_use = c->use_counter;
+                dns_cache_item_move(c, i, /* protected= */ false);
+        }
+}
+
+static void dns_cache_hit(DnsCache *c, DnsCacheItem *first) {
+        unsigned protected_max;
+
+        assert(c);
+        /* Moves all entries of the key into the protected segment, or refreshes them there if they already
+         * are in it. If that makes the protected segment take up too much of the cache, the least recently
+         * used keys in it go back to probation. */
+
+        assert(first);
+
+        c->n_hit++;
+        c->use_counter++;
+
+        LIST_FOREACH(by_key, i, first) {
+                i->last_use = c->use_counter;
+                i->n_hit++;
+                dns_cache_item_move(c, i, /* protected= */ true);
+        }
+
+        protected_max = MAX(prioq_size(c->by_expiry) * CACHE_PROTECTED_PERCENT / 100U, 1U);
+
+        while (prioq_size(c->protected) > protected_max) {
+                DnsCacheItem *i = prioq_peek(c->protected);
+                unsigned n = prioq_size(c->protected);
+
+                dns_cache_demote(c, hashmap_get(c->by_key, i->key));
+                if (prioq_size(c->protected) >= n)
+                        break; /* Couldn't move anything, give up */
         }
 }
 
@@ -265,6 +384,12 @@ static int dns_cache_item_prioq_compare_func(const void *a, const void *b) {
         return CMP(x->until, y->until);
 }
 
+static int dns_cache_item_lru_compare_func(const void *a, const void *b) {
+        const DnsCacheItem *x = a, *y = b;
+
+        return CMP(x->last_use, y->last_use);
+}
+
 static int dns_cache_init(DnsCache *c) {
         int r;
 
@@ -274,6 +399,14 @@ static int dns_cache_init(DnsCache *c) {
         if (r < 0)
                 return r;
 
+        r = prioq_ensure_allocated(&c->probation, dns_cache_item_lru_compare_func);
+        if (r < 0)
+                return r;
+
+        r = prioq_ensure_allocated(&c->protected, dns_cache_item_lru_compare_func);
+        if (r < 0)
+                return r;
+
         r = hashmap_ensure_allocated(&c->by_key, &dns_resource_key_hash_ops);
         if (r < 0)
                 return r;
@@ -288,11 +421,22 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
         assert(c);
         assert(i);
 
+        first = hashmap_get(c->by_key, i->key);
+
         r = prioq_put(c->by_expiry, i, &i->prioq_idx);
         if (r < 0)
                 return r;
 
-        first = hashmap_get(c->by_key, i->key);
+        /* New entries start out in the probation segment, unless they join a key that has been hit before */
+        i->protected = first && first->protected;
+        i->last_use = ++c->use_counter;
+
+        r = prioq_put(dns_cache_item_lru(c, i), i, &i->lru_idx);
+        if (r < 0) {
+                prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                return r;
+        }
+
         if (first) {
                 _unused_ _cleanup_(dns_resource_key_unrefp) DnsResourceKey *k = NULL;
 
@@ -313,6 +457,7 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
                 r = hashmap_put(c->by_key, i->key, i);
                 if (r < 0) {
                         prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                        prioq_remove(dns_cache_item_lru(c, i), i, &i->lru_idx);
                         return r;
                 }
         }
@@ -377,6 +522,18 @@ static usec_t calculate_until(
         return stale_retention_usec > 0 ? usec_add(until_valid, stale_retention_usec) : until_valid;
 }
 
+static usec_t calculate_prefetch_after(
+                usec_t timestamp,
+                usec_t until_valid) {
+
+        usec_t ttl = usec_sub_unsigned(until_valid, timestamp);
+
+        if (ttl < CACHE_PREFETCH_TTL_MIN_USEC)
+                return USEC_INFINITY;
+
+        return until_valid - ttl / 10;
+}
+
 static void dns_cache_item_update_positive(
                 DnsCache *c,
                 DnsCacheItem *i,
@@ -416,6 +573,8 @@ static void dns_cache_item_update_positive(
 
         i->until_valid = calculate_until_valid(rr, min_ttl, UINT32_MAX, timestamp, false);
         i->until = calculate_until(i->until_valid, stale_retention_usec);
+        i->prefetch_after = calculate_prefetch_after(timestamp, i->until_valid);
+        i->prefetched = false;
         i->query_flags = query_flags & CACHEABLE_QUERY_FLAGS;
         i->shared_owner = shared_owner;
         i->dnssec_result = dnssec_result;
@@ -441,7 +600,8 @@ static int dns_cache_put_positive(
                 int ifindex,
                 int owner_family,
                 const union in_addr_union *owner_address,
-                usec_t stale_retention_usec) {
+                usec_t stale_retention_usec,
+                unsigned entries_max) {
 
         char key_str[DNS_RESOURCE_KEY_STRING_MAX];
         DnsCacheItem *existing;
@@ -502,7 +662,7 @@ static int dns_cache_put_positive(
         if (r < 0)
                 return r;
 
-        dns_cache_make_space(c, 1);
+        dns_cache_make_space(c, 1, entries_max);
 
         _cleanup_(dns_cache_item_freep) DnsCacheItem *i = new(DnsCacheItem, 1);
         if (!i)
@@ -521,6 +681,7 @@ static int dns_cache_put_positive(
                 .full_packet = dns_packet_ref(full_packet),
                 .until = calculate_until(until_valid, stale_retention_usec),
                 .until_valid = until_valid,
+                .prefetch_after = calculate_prefetch_after(timestamp, until_valid),
                 .query_flags = query_flags & CACHEABLE_QUERY_FLAGS,
                 .shared_owner = shared_owner,
                 .dnssec_result = dnssec_result,
@@ -528,6 +689,7 @@ static int dns_cache_put_positive(
                 .owner_family = owner_family,
                 .owner_address = *owner_address,
                 .prioq_idx = PRIOQ_IDX_NULL,
+                .lru_idx = PRIOQ_IDX_NULL,
         };
 
         r = dns_cache_link_item(c, i);
@@ -574,7 +736,8 @@ static int dns_cache_put_negative(
                 usec_t timestamp,
                 DnsResourceRecord *soa,
                 int owner_family,
-                const union in_addr_union *owner_address) {
+                const union in_addr_union *owner_address,
+                unsigned entries_max) {
 
         _cleanup_(dns_cache_item_freep) DnsCacheItem *i = NULL;
         char key_str[DNS_RESOURCE_KEY_STRING_MAX];
@@ -611,7 +774,7 @@ static int dns_cache_put_negative(
         if (r < 0)
                 return r;
 
-        dns_cache_make_space(c, 1);
+        dns_cache_make_space(c, 1, entries_max);
 
         i = new(DnsCacheItem, 1);
         if (!i)
@@ -626,9 +789,11 @@ static int dns_cache_put_negative(
                 .owner_family = owner_family,
                 .owner_address = *owner_address,
                 .prioq_idx = PRIOQ_IDX_NULL,
+                .lru_idx = PRIOQ_IDX_NULL,
                 .rcode = rcode,
                 .answer = dns_answer_ref(answer),
                 .full_packet = dns_packet_ref(full_packet),
+                .prefetch_after = USEC_INFINITY,
         };
 
         /* Determine how long to cache this entry. In case we have some RRs in the answer use the lowest TTL
@@ -733,7 +898,8 @@ int dns_cache_put(
                 uint32_t nsec_ttl,
                 int owner_family,
                 const union in_addr_union *owner_address,
-                usec_t stale_retention_usec) {
+                usec_t stale_retention_usec,
+                unsigned entries_max) {
 
         DnsResourceRecord *soa = NULL;
         bool weird_rcode = false;
@@ -779,7 +945,7 @@ int dns_cache_put(
                 cache_keys++;
 
         /* Make some space for our new entries */
-        dns_cache_make_space(c, cache_keys);
+        dns_cache_make_space(c, cache_keys, entries_max);
 
         timestamp = now(CLOCK_BOOTTIME);
 
@@ -830,7 +996,8 @@ int dns_cache_put(
                                 item->ifindex,
                                 owner_family,
                                 owner_address,
-                                stale_retention_usec);
+                                stale_retention_usec,
+                                entries_max);
                 if (r < 0)
                         goto fail;
         }
@@ -887,7 +1054,8 @@ int dns_cache_put(
                         timestamp,
                         soa,
                         owner_family,
-                        owner_address);
+                        owner_address,
+                        entries_max);
         if (r < 0)
                 goto fail;
 
@@ -1189,7 +1357,7 @@ int dns_cache_lookup(
                 if (ret_dnssec_result)
                         *ret_dnssec_result = dnssec_result;
 
-                c->n_hit++;
+                dns_cache_hit(c, first);
                 return 1;
         }
 
@@ -1217,7 +1385,7 @@ int dns_cache_lookup(
                 if (!bitmap_isset(nsec->rr->nsec.types, key->type) &&
                     !bitmap_isset(nsec->rr->nsec.types, DNS_TYPE_CNAME) &&
                     !bitmap_isset(nsec->rr->nsec.types, DNS_TYPE_DNAME)) {
-                        c->n_hit++;
+                        dns_cache_hit(c, first);
                         return 1;
                 }
 
@@ -1231,7 +1399,7 @@ int dns_cache_lookup(
                   dns_resource_key_to_string(key, key_str, sizeof key_str));
 
         if (n <= 0) {
-                c->n_hit++;
+                dns_cache_hit(c, first);
 
                 if (ret_rcode)
                         *ret_rcode = nxdomain ? DNS_RCODE_NXDOMAIN : DNS_RCODE_SUCCESS;
@@ -1249,7 +1417,7 @@ int dns_cache_lookup(
                 return 1;
         }
 
-        c->n_hit++;
+        dns_cache_hit(c, first);
 
         if (ret_rcode)
                 *ret_rcode = DNS_RCODE_SUCCESS;
@@ -1282,6 +1450,30 @@ miss:
         return 0;
 }
 
+bool dns_cache_should_prefetch(DnsCache *c, DnsResourceKey *key, usec_t t) {
+        DnsCacheItem *first;
+
+        assert(c);
+        assert(key);
+
+        /* To be called after a cache hit for the key. Returns true if the entry has been popular and is
+         * about to expire, in which case the caller should refresh it from upstream in the background. Does
+         * so only once per entry, so that an unreachable server doesn't get asked on every further hit. */
+
+        first = dns_cache_get_by_key_follow_cname_dname_nsec(c, key);
+        if (!first)
+                return false;
+
+        if (first->prefetched ||
+            first->n_hit < CACHE_PREFETCH_HITS_MIN ||
+            t < first->prefetch_after ||
+            t >= first->until_valid)
+                return false;
+
+        first->prefetched = true;
+        return true;
+}
+
 int dns_cache_check_conflicts(DnsCache *cache, DnsResourceRecord *rr, int owner_family, const union in_addr_union *owner_address) {
         DnsCacheItem *first;
         bool same_owner = true;
@@ -8,11 +8,22 @@
 #include "resolved-dns-dnssec.h"
 #include "time-util.h"
 
+/* The default maximum number of entries kept per cache */
+#define DNS_CACHE_ENTRIES_MAX_DEFAULT 4096U
+
 typedef struct DnsCache {
         Hashmap *by_key;
         Prioq *by_expiry;
+
+        /* Segmented LRU: new entries start out in the probation segment, and move to the protected segment
+         * once they are hit. Both are ordered by last use. */
+        Prioq *probation;
+        Prioq *protected;
+        uint64_t use_counter;
+
         unsigned n_hit;
         unsigned n_miss;
+        unsigned n_evicted;
 } DnsCache;
 
 #include "resolved-dns-answer.h"
@@ -36,7 +47,8 @@ int dns_cache_put(
                 uint32_t nsec_ttl,
                 int owner_family,
                 const union in_addr_union *owner_address,
-                usec_t stale_retention_usec);
+                usec_t stale_retention_usec,
+                unsigned entries_max);
 
 int dns_cache_lookup(
                 DnsCache *c,
@@ -48,6 +60,8 @@ int dns_cache_lookup(
                 uint64_t *ret_query_flags,
                 DnssecResult *ret_dnssec_result);
 
+bool dns_cache_should_prefetch(DnsCache *c, DnsResourceKey *key, usec_t t);
+
 int dns_cache_check_conflicts(DnsCache *cache, DnsResourceRecord *rr, int owner_family, const union in_addr_union *owner_address);
 
 void dns_cache_dump(DnsCache *cache, FILE *f);
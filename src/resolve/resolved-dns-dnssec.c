@@ -11,6 +11,9 @@
 #include "openssl-util.h"
 #include "resolved-dns-dnssec.h"
 #include "resolved-dns-packet.h"
+#include "set.h"
+#include "sha256.h"
+#include "siphash24.h"
 #include "sort-util.h"
 #include "string-table.h"
 
@@ -28,6 +31,9 @@ DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(EC_KEY*, EC_KEY_free, NULL);
 /* Permit a maximum clock skew of 1h 10min. This should be enough to deal with DST confusion */
 #define SKEW_MAX (1*USEC_PER_HOUR + 10*USEC_PER_MINUTE)
 
+/* Remember this many successful signature verifications */
+#define VERIFIED_SIGNATURES_MAX 1024U
+
 /* Maximum number of NSEC3 iterations we'll do. RFC5155 says 2500 shall be the maximum useful value, but
  * RFC9276 § 3.2 says that we should reduce the acceptable iteration count */
 #define NSEC3_ITERATIONS_MAX 100
@@ -975,6 +981,103 @@ static int dnssec_rrset_verify_sig(
         }
 }
 
+/* The same RRsets (DNSKEYs and DS of popular zones in particular) are verified with the same signatures and
+ * keys again and again, every time the cached data expires, is looked up with a different question, or is
+ * needed to prove another name of the zone. The public key operations are by far the most expensive part of
+ * validation, hence remember which (signed data, signature, key) combinations were found valid. Everything
+ * the verdict depends on goes into a SHA-256 digest, which serves as the lookup key. The data is under the
+ * control of remote parties, hence a non-cryptographic hash won't do. Validity of the signature at the time
+ * of use is still checked on every lookup, the digest only stands in for the crypto. */
+
+typedef struct VerifiedSignature {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        usec_t until; /* CLOCK_REALTIME */
+} VerifiedSignature;
+
+static void verified_signature_hash_func(const VerifiedSignature *v, struct siphash *state) {
+        siphash24_compress(v->digest, sizeof(v->digest), state);
+}
+
+static int verified_signature_compare_func(const VerifiedSignature *a, const VerifiedSignature *b) {
+        return memcmp(a->digest, b->digest, sizeof(a->digest));
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
+                verified_signature_hash_ops,
+                VerifiedSignature,
+                verified_signature_hash_func,
+                verified_signature_compare_func,
+                free);
+
+static Set *verified_signatures = NULL;
+
+void dnssec_flush_verified_signatures(void) {
+        verified_signatures = set_free(verified_signatures);
+}
+
+static void dnssec_signature_digest(
+                DnsResourceRecord *rrsig,
+                DnsResourceRecord *dnskey,
+                const char *sig_data,
+                size_t sig_size,
+                uint8_t ret[static SHA256_DIGEST_SIZE]) {
+
+        struct sha256_ctx ctx;
+
+        assert(rrsig);
+        assert(dnskey);
+        assert(sig_data);
+
+        /* The signed data includes the RRSIG fields but the signature itself, it also determines the
+         * algorithm */
+        sha256_init_ctx(&ctx);
+        sha256_process_bytes_and_size(sig_data, sig_size, &ctx);
+        sha256_process_bytes_and_size(rrsig->rrsig.signature, rrsig->rrsig.signature_size, &ctx);
+        sha256_process_bytes_and_size(dnskey->dnskey.key, dnskey->dnskey.key_size, &ctx);
+        sha256_finish_ctx(&ctx, ret);
+}
+
+static bool dnssec_signature_verified(const uint8_t digest[static SHA256_DIGEST_SIZE]) {
+        VerifiedSignature k;
+
+        memcpy(k.digest, digest, sizeof(k.digest));
+        return set_contains(verified_signatures, &k);
+}
+
+static void dnssec_signature_remember(
+                const uint8_t digest[static SHA256_DIGEST_SIZE],
+                DnsResourceRecord *rrsig,
+                usec_t realtime) {
+
+        _cleanup_free_ VerifiedSignature *v = NULL;
+        VerifiedSignature *i;
+
+        assert(rrsig);
+
+        if (realtime == USEC_INFINITY)
+                realtime = now(CLOCK_REALTIME);
+
+        if (set_size(verified_signatures) >= VERIFIED_SIGNATURES_MAX) {
+                /* Drop what expired first, and if that's not enough something arbitrary */
+                SET_FOREACH(i, verified_signatures)
+                        if (i->until < realtime)
+                                free(set_remove(verified_signatures, i));
+
+                if (set_size(verified_signatures) >= VERIFIED_SIGNATURES_MAX)
+                        free(set_steal_first(verified_signatures));
+        }
+
+        v = new(VerifiedSignature, 1);
+        if (!v)
+                return;
+
+        v->until = rrsig->rrsig.expiration * USEC_PER_SEC;
+        memcpy(v->digest, digest, sizeof(v->digest));
+
+        /* It's just an optimization, ignore failures */
+        (void) set_ensure_consume(&verified_signatures, &verified_signature_hash_ops, TAKE_PTR(v));
+}
+
 int dnssec_verify_rrset(
                 DnsAnswer *a,
                 const DnsResourceKey *key,
@@ -987,6 +1090,7 @@ int dnssec_verify_rrset(
         const char *source, *name;
         _cleanup_free_ char *sig_data = NULL;
         size_t sig_size = 0; /* avoid false maybe-uninitialized warning */
+        uint8_t digest[SHA256_DIGEST_SIZE];
         size_t n = 0;
         bool wildcard;
         int r;
@@ -1096,13 +1200,20 @@ int dnssec_verify_rrset(
         if (r < 0)
                 return r;
 
-        r = dnssec_rrset_verify_sig(rrsig, dnskey, sig_data, sig_size);
-        if (r == -EOPNOTSUPP) {
-                *result = DNSSEC_UNSUPPORTED_ALGORITHM;
-                return 0;
+        dnssec_signature_digest(rrsig, dnskey, sig_data, sig_size, digest);
+        if (dnssec_signature_verified(digest))
+                r = 1;
+        else {
+                r = dnssec_rrset_verify_sig(rrsig, dnskey, sig_data, sig_size);
+                if (r == -EOPNOTSUPP) {
+                        *result = DNSSEC_UNSUPPORTED_ALGORITHM;
+                        return 0;
+                }
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        dnssec_signature_remember(digest, rrsig, realtime);
         }
-        if (r < 0)
-                return r;
 
         /* Now, fix the ttl, expiry, and remember the synthesizing source and the signer */
         if (r > 0)
@@ -2506,6 +2617,9 @@ int dnssec_test_positive_wildcard(
 
 #else
 
+void dnssec_flush_verified_signatures(void) {
+}
+
 int dnssec_verify_rrset(
                 DnsAnswer *a,
                 const DnsResourceKey *key,
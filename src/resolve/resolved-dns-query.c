@@ -480,14 +480,23 @@ DnsQuery *dns_query_free(DnsQuery *q) {
                 sd_varlink_unref(q->varlink_request);
         }
 
-        if (q->request_packet)
+        if (q->request_packet) {
                 hashmap_remove_value(q->stub_listener_extra ?
                                      q->stub_listener_extra->queries_by_packet :
                                      q->manager->stub_queries_by_packet,
                                      q->request_packet,
                                      q);
+                hashmap_remove_value(q->stub_listener_extra ?
+                                     q->stub_listener_extra->queries_by_request :
+                                     q->manager->stub_queries_by_request,
+                                     q->request_packet,
+                                     q);
+        }
 
         dns_packet_unref(q->request_packet);
+        FOREACH_ARRAY(f, q->request_followers, q->n_request_followers)
+                dns_packet_unref(*f);
+        free(q->request_followers);
         dns_answer_unref(q->reply_answer);
         dns_answer_unref(q->reply_authoritative);
         dns_answer_unref(q->reply_additional);
@@ -499,6 +508,7 @@ DnsQuery *dns_query_free(DnsQuery *q) {
         }
 
         free(q->request_address_string);
+        free(q->nss_cache_name);
 
         if (q->manager) {
                 LIST_REMOVE(queries, q->manager->dns_queries, q);
@@ -103,6 +103,7 @@ struct DnsQuery {
         union in_addr_union request_address;
         unsigned block_all_complete;
         char *request_address_string;
+        char *nss_cache_name; /* The name as requested, if the answer may be published for nss-resolve */
 
         /* DNS stub information */
         DnsPacket *request_packet;
@@ -111,6 +112,8 @@ struct DnsQuery {
         DnsAnswer *reply_authoritative;
         DnsAnswer *reply_additional;
         DnsStubListenerExtra *stub_listener_extra;
+        DnsPacket **request_followers; /* Identical requests from other clients, answered along */
+        size_t n_request_followers;
 
         /* Completion callback */
         void (*complete)(DnsQuery* q);
@@ -16,6 +16,7 @@
 #include "resolved-dns-zone.h"
 #include "resolved-llmnr.h"
 #include "resolved-mdns.h"
+#include "resolved-nss-cache.h"
 #include "resolved-timeouts.h"
 #include "socket-util.h"
 #include "strv.h"
@@ -97,6 +98,17 @@ static void dns_scope_abort_transactions(DnsScope *s) {
         }
 }
 
+void dns_scope_flush_cache(DnsScope *s) {
+        assert(s);
+
+        dns_cache_flush(&s->cache);
+
+        /* The stub and nss-resolve might have answers around that were built from the cache, forget them
+         * too */
+        dns_stub_flush_replies(s->manager);
+        manager_nss_cache_flush(s->manager);
+}
+
 DnsScope* dns_scope_free(DnsScope *s) {
         if (!s)
                 return NULL;
@@ -119,7 +131,7 @@ DnsScope* dns_scope_free(DnsScope *s) {
 
         sd_event_source_disable_unref(s->mdns_goodbye_event_source);
 
-        dns_cache_flush(&s->cache);
+        dns_scope_flush_cache(s);
         dns_zone_flush(&s->zone);
 
         LIST_REMOVE(scopes, s->manager->dns_scopes, s);
@@ -1166,6 +1178,11 @@ DnsTransaction *dns_scope_find_transaction(
                     !(t->query_flags & SD_RESOLVED_NO_CACHE))
                         continue;
 
+                /* A prefetch is only running because the cache still has the data, so answer from there
+                 * instead of waiting for upstream */
+                if (t->prefetch && !(query_flags & SD_RESOLVED_NO_CACHE))
+                        continue;
+
                 /* If we are asked to clamp ttls and the existing transaction doesn't do it, we can't
                  * reuse */
                 if ((query_flags & SD_RESOLVED_CLAMP_TTL) &&
@@ -872,7 +872,7 @@ DnsServer *manager_set_dns_server(Manager *m, DnsServer *s) {
         m->current_dns_server = dns_server_ref(s);
 
         if (m->unicast_scope)
-                dns_cache_flush(&m->unicast_scope->cache);
+                dns_scope_flush_cache(m->unicast_scope);
 
         (void) manager_send_changed(m, "CurrentDNSServer");
 
@@ -978,7 +978,7 @@ void dns_server_flush_cache(DnsServer *s) {
         if (!scope)
                 return;
 
-        dns_cache_flush(&scope->cache);
+        dns_scope_flush_cache(scope);
 }
 
 void dns_server_reset_features(DnsServer *s) {
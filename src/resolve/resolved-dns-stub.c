@@ -21,6 +21,34 @@
 /* On the extra stubs, use a more conservative choice */
 #define ADVERTISE_EXTRA_DATAGRAM_SIZE_MAX DNS_PACKET_UNICAST_SIZE_LARGE_MAX
 
+/* How many serialized replies to keep around for answering repeated queries right away, and for how long at
+ * most. The latter bounds how long configuration changes that don't flush the caches (e.g. new routing
+ * domains on some link) take to become visible for names that are queried all the time. */
+#define STUB_REPLIES_MAX 1024U
+#define STUB_REPLY_TTL_MAX_USEC (5 * USEC_PER_SEC)
+
+/* How many identical requests from other clients to attach to a query that is already in flight */
+#define STUB_FOLLOWERS_MAX 64U
+
+typedef struct DnsStubReply {
+        bool extra;              /* Whether the request was received on an extra listener */
+        size_t request_size;
+        uint8_t *request;        /* The request, with the ID zeroed and the question name lowercased */
+        DnsPacket *reply;
+        usec_t until;
+        unsigned prioq_idx;
+
+        /* What to tell monitors when the reply is sent again */
+        DnsTransactionState state;
+        int rcode;
+        int ede_rcode;
+        char *ede_msg;
+        DnsQuestion *question_idna;
+        DnsQuestion *question_utf8;
+        DnsQuestion *collected_questions;
+        DnsAnswer *answer;
+} DnsStubReply;
+
 static int manager_dns_stub_fd_extra(Manager *m, DnsStubListenerExtra *l, int type);
 static int manager_dns_stub_fd(Manager *m, int family, const union in_addr_union *listen_address, int type);
 
@@ -87,6 +115,7 @@ DnsStubListenerExtra *dns_stub_listener_extra_free(DnsStubListenerExtra *p) {
         p->tcp_event_source = sd_event_source_disable_unref(p->tcp_event_source);
 
         hashmap_free(p->queries_by_packet);
+        hashmap_free(p->queries_by_request);
 
         return mfree(p);
 }
@@ -132,6 +161,353 @@ static int stub_packet_compare_func(const DnsPacket *x, const DnsPacket *y) {
 
 DEFINE_HASH_OPS(stub_packet_hash_ops, DnsPacket, stub_packet_hash_func, stub_packet_compare_func);
 
+static size_t dns_stub_request_name_size(const DnsPacket *p) {
+        size_t i = DNS_PACKET_HEADER_SIZE;
+
+        assert(p);
+
+        /* Returns the size of the question name in wire format, or 0 if there's none we can make sense of
+         * without parsing the packet. Compression pointers are legal here, but no client uses them. */
+
+        for (;;) {
+                uint8_t n;
+
+                if (i >= p->size)
+                        return 0;
+
+                n = DNS_PACKET_DATA(p)[i++];
+                if (n == 0)
+                        return i - DNS_PACKET_HEADER_SIZE;
+                if (n > DNS_LABEL_MAX || n > p->size - i)
+                        return 0;
+
+                i += n;
+        }
+}
+
+static void stub_request_hash_func(const DnsPacket *p, struct siphash *state) {
+        const uint8_t *d = DNS_PACKET_DATA(p);
+        size_t name_size;
+
+        assert(p);
+
+        /* Ignores the ID and the case of the question name, like dns_stub_reply_make_key() */
+
+        name_size = dns_stub_request_name_size(p);
+
+        siphash24_compress_typesafe(p->size, state);
+        siphash24_compress(d + offsetof(DnsPacketHeader, flags), DNS_PACKET_HEADER_SIZE - offsetof(DnsPacketHeader, flags), state);
+        for (size_t i = DNS_PACKET_HEADER_SIZE; i < DNS_PACKET_HEADER_SIZE + name_size; i++) {
+                uint8_t c = ascii_tolower(d[i]);
+                siphash24_compress_typesafe(c, state);
+        }
+        siphash24_compress(d + DNS_PACKET_HEADER_SIZE + name_size, p->size - DNS_PACKET_HEADER_SIZE - name_size, state);
+}
+
+static int stub_request_compare_func(const DnsPacket *x, const DnsPacket *y) {
+        const uint8_t *a = DNS_PACKET_DATA(x), *b = DNS_PACKET_DATA(y);
+        size_t name_size;
+        int r;
+
+        r = CMP(x->size, y->size);
+        if (r != 0)
+                return r;
+
+        r = memcmp(a + offsetof(DnsPacketHeader, flags), b + offsetof(DnsPacketHeader, flags),
+                   DNS_PACKET_HEADER_SIZE - offsetof(DnsPacketHeader, flags));
+        if (r != 0)
+                return r;
+
+        name_size = dns_stub_request_name_size(x);
+        r = CMP(name_size, dns_stub_request_name_size(y));
+        if (r != 0)
+                return r;
+
+        r = ascii_strcasecmp_n((const char*) a + DNS_PACKET_HEADER_SIZE, (const char*) b + DNS_PACKET_HEADER_SIZE, name_size);
+        if (r != 0)
+                return r;
+
+        return memcmp(a + DNS_PACKET_HEADER_SIZE + name_size, b + DNS_PACKET_HEADER_SIZE + name_size,
+                      x->size - DNS_PACKET_HEADER_SIZE - name_size);
+}
+
+DEFINE_PRIVATE_HASH_OPS(stub_request_hash_ops, DnsPacket, stub_request_hash_func, stub_request_compare_func);
+
+static DnsStubReply* dns_stub_reply_free(DnsStubReply *r) {
+        if (!r)
+                return NULL;
+
+        dns_packet_unref(r->reply);
+        free(r->request);
+        free(r->ede_msg);
+        dns_question_unref(r->question_idna);
+        dns_question_unref(r->question_utf8);
+        dns_question_unref(r->collected_questions);
+        dns_answer_unref(r->answer);
+        return mfree(r);
+}
+DEFINE_TRIVIAL_CLEANUP_FUNC(DnsStubReply*, dns_stub_reply_free);
+
+static void dns_stub_reply_hash_func(const DnsStubReply *r, struct siphash *state) {
+        assert(r);
+
+        siphash24_compress_boolean(r->extra, state);
+        siphash24_compress_typesafe(r->request_size, state);
+        siphash24_compress(r->request, r->request_size, state);
+}
+
+static int dns_stub_reply_compare_func(const DnsStubReply *x, const DnsStubReply *y) {
+        int r;
+
+        r = CMP(x->extra, y->extra);
+        if (r != 0)
+                return r;
+
+        r = CMP(x->request_size, y->request_size);
+        if (r != 0)
+                return r;
+
+        return memcmp(x->request, y->request, x->request_size);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
+                dns_stub_reply_hash_ops,
+                DnsStubReply,
+                dns_stub_reply_hash_func,
+                dns_stub_reply_compare_func,
+                dns_stub_reply_free);
+
+static int dns_stub_reply_compare_by_expiry(const void *a, const void *b) {
+        const DnsStubReply *x = a, *y = b;
+
+        return CMP(x->until, y->until);
+}
+
+static int dns_stub_reply_make_key(
+                DnsPacket *p,
+                DnsStubListenerExtra *l,
+                uint8_t *buffer,
+                size_t buffer_size,
+                DnsStubReply *ret_key,
+                size_t *ret_name_size) {
+
+        size_t name_size;
+
+        assert(p);
+        assert(buffer);
+        assert(ret_key);
+
+        /* Requests that only differ in the ID and in the case of the question name get the same reply,
+         * modulo the ID and the case of the question name. Hence normalize those two for lookups. */
+
+        if (p->size > buffer_size || DNS_PACKET_QDCOUNT(p) != 1)
+                return -EOPNOTSUPP;
+
+        name_size = dns_stub_request_name_size(p);
+        if (name_size == 0)
+                return -EOPNOTSUPP;
+
+        memcpy(buffer, DNS_PACKET_DATA(p), p->size);
+        ((DnsPacketHeader*) buffer)->id = 0;
+
+        for (size_t i = DNS_PACKET_HEADER_SIZE; i < DNS_PACKET_HEADER_SIZE + name_size; i++)
+                buffer[i] = ascii_tolower(buffer[i]);
+
+        *ret_key = (DnsStubReply) {
+                .extra = !!l,
+                .request_size = p->size,
+                .request = buffer,
+        };
+
+        if (ret_name_size)
+                *ret_name_size = name_size;
+
+        return 0;
+}
+
+static void dns_stub_reply_unlink_and_free(Manager *m, DnsStubReply *r) {
+        assert(m);
+        assert(r);
+
+        set_remove(m->dns_stub_replies, r);
+        prioq_remove(m->dns_stub_replies_by_expiry, r, &r->prioq_idx);
+        dns_stub_reply_free(r);
+}
+
+void dns_stub_flush_replies(Manager *m) {
+        assert(m);
+
+        m->dns_stub_replies = set_free(m->dns_stub_replies);
+        m->dns_stub_replies_by_expiry = prioq_free(m->dns_stub_replies_by_expiry);
+}
+
+static bool dns_stub_reply_is_cacheable(DnsQuery *q, int rcode, bool truncated) {
+        assert(q);
+
+        if (q->request_stream || q->question_bypass || truncated)
+                return false;
+
+        if (!IN_SET(q->state, DNS_TRANSACTION_SUCCESS, DNS_TRANSACTION_RCODE_FAILURE))
+                return false;
+
+        switch (q->manager->enable_cache) {
+
+        case DNS_CACHE_MODE_YES:
+                if (!IN_SET(rcode, DNS_RCODE_SUCCESS, DNS_RCODE_NXDOMAIN))
+                        return false;
+                break;
+
+        case DNS_CACHE_MODE_NO_NEGATIVE:
+                if (rcode != DNS_RCODE_SUCCESS || dns_answer_isempty(q->reply_answer))
+                        return false;
+                break;
+
+        default:
+                return false;
+        }
+
+        /* Only take answers that were in the cache already, as those are known to be fine to cache by all the
+         * rules applied there (CacheFromLocalhost=, don't cache data from local sources, …). */
+        return (q->answer_query_flags & (SD_RESOLVED_FROM_MASK|SD_RESOLVED_SYNTHETIC)) == SD_RESOLVED_FROM_CACHE;
+}
+
+int dns_stub_reply_put(DnsQuery *q, DnsPacket *reply) {
+        _cleanup_(dns_stub_reply_freep) DnsStubReply *e = NULL;
+        uint8_t buffer[DNS_PACKET_UNICAST_SIZE_MAX];
+        DnsStubReply key;
+        uint32_t ttl;
+        usec_t ts;
+        int r;
+
+        assert(q);
+        assert(reply);
+
+        ttl = MIN3(dns_answer_min_ttl(q->reply_answer),
+                   dns_answer_min_ttl(q->reply_authoritative),
+                   dns_answer_min_ttl(q->reply_additional));
+        if (ttl == 0 || ttl == UINT32_MAX) /* Nothing to expire with? Then don't keep this around */
+                return 0;
+
+        r = dns_stub_reply_make_key(q->request_packet, q->stub_listener_extra, buffer, sizeof(buffer), &key, NULL);
+        if (r < 0)
+                return 0;
+
+        if (set_contains(q->manager->dns_stub_replies, &key))
+                return 0;
+
+        r = prioq_ensure_allocated(&q->manager->dns_stub_replies_by_expiry, dns_stub_reply_compare_by_expiry);
+        if (r < 0)
+                return r;
+
+        /* Make room, if needed. Drop the ones that expire first, which includes the outdated ones. */
+        while (set_size(q->manager->dns_stub_replies) >= STUB_REPLIES_MAX)
+                dns_stub_reply_unlink_and_free(q->manager, prioq_peek(q->manager->dns_stub_replies_by_expiry));
+
+        ts = now(CLOCK_BOOTTIME);
+
+        e = new(DnsStubReply, 1);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (DnsStubReply) {
+                .extra = key.extra,
+                .request_size = key.request_size,
+                .request = memdup(key.request, key.request_size),
+                .reply = dns_packet_ref(reply),
+                .until = usec_add(ts, MIN((usec_t) ttl * USEC_PER_SEC, STUB_REPLY_TTL_MAX_USEC)),
+                .prioq_idx = PRIOQ_IDX_NULL,
+                .state = q->state,
+                .rcode = q->answer_rcode,
+                .ede_rcode = q->answer_ede_rcode,
+                .question_idna = dns_question_ref(q->question_idna),
+                .question_utf8 = dns_question_ref(q->question_utf8),
+                .collected_questions = dns_question_ref(q->collected_questions),
+                .answer = dns_answer_ref(q->answer),
+        };
+        if (!e->request)
+                return -ENOMEM;
+
+        r = strdup_to(&e->ede_msg, q->answer_ede_msg);
+        if (r < 0)
+                return r;
+
+        /* Remember when we generated the TTLs in the packet, so that they can be lowered accordingly */
+        reply->timestamp = ts;
+
+        r = set_ensure_put(&q->manager->dns_stub_replies, &dns_stub_reply_hash_ops, e);
+        if (r < 0)
+                return r;
+
+        r = prioq_put(q->manager->dns_stub_replies_by_expiry, e, &e->prioq_idx);
+        if (r < 0) {
+                set_remove(q->manager->dns_stub_replies, e);
+                return r;
+        }
+
+        TAKE_PTR(e);
+        return 0;
+}
+
+int dns_stub_reply_get(Manager *m, DnsStubListenerExtra *l, DnsPacket *p, DnsPacket **ret) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *c = NULL;
+        uint8_t buffer[DNS_PACKET_UNICAST_SIZE_MAX];
+        DnsStubReply key, *e;
+        size_t name_size;
+        int r;
+
+        assert(m);
+        assert(p);
+        assert(ret);
+
+        if (set_isempty(m->dns_stub_replies))
+                return 0;
+
+        r = dns_stub_reply_make_key(p, l, buffer, sizeof(buffer), &key, &name_size);
+        if (r < 0)
+                return 0;
+
+        e = set_get(m->dns_stub_replies, &key);
+        if (!e)
+                return 0;
+
+        if (e->until <= now(CLOCK_BOOTTIME)) {
+                dns_stub_reply_unlink_and_free(m, e);
+                return 0;
+        }
+
+        r = dns_packet_dup(&c, e->reply);
+        if (r < 0)
+                return r;
+
+        /* Echo the ID and question name exactly as the client sent them */
+        DNS_PACKET_HEADER(c)->id = DNS_PACKET_HEADER(p)->id;
+        memcpy(DNS_PACKET_DATA(c) + DNS_PACKET_HEADER_SIZE, DNS_PACKET_DATA(p) + DNS_PACKET_HEADER_SIZE, name_size);
+
+        r = dns_packet_patch_ttls(c, e->reply->timestamp);
+        if (r < 0)
+                return r;
+
+        /* This is answered from the cache as much as the original reply was, hence account for it and show
+         * it to monitors the same way */
+        m->n_stub_reply_hit++;
+        (void) manager_monitor_send_full(
+                        m,
+                        e->state,
+                        _DNSSEC_RESULT_INVALID,
+                        e->rcode,
+                        /* error= */ 0,
+                        e->ede_rcode,
+                        e->ede_msg,
+                        e->question_idna,
+                        e->question_utf8,
+                        /* question_bypass= */ NULL,
+                        e->collected_questions,
+                        e->answer);
+
+        *ret = TAKE_PTR(c);
+        return 1;
+}
+
 static int reply_add_with_rrsig(
                 DnsAnswer **reply,
                 DnsResourceRecord *rr,
@@ -554,6 +930,50 @@ static int dns_stub_send(
         return 0;
 }
 
+static void dns_stub_send_to_followers(DnsQuery *q, DnsPacket *reply) {
+        size_t name_size;
+
+        assert(q);
+        assert(reply);
+
+        if (q->n_request_followers == 0)
+                return;
+
+        name_size = dns_stub_request_name_size(q->request_packet);
+        assert(name_size > 0);
+
+        FOREACH_ARRAY(f, q->request_followers, q->n_request_followers) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *c = NULL;
+
+                if (dns_packet_dup(&c, reply) < 0)
+                        return (void) log_oom_debug();
+
+                /* Echo the ID and question name exactly as this client sent them */
+                DNS_PACKET_HEADER(c)->id = DNS_PACKET_HEADER(*f)->id;
+                memcpy(DNS_PACKET_DATA(c) + DNS_PACKET_HEADER_SIZE, DNS_PACKET_DATA(*f) + DNS_PACKET_HEADER_SIZE, name_size);
+
+                (void) dns_stub_send(q->manager, q->stub_listener_extra, NULL, *f, c);
+        }
+}
+
+static int dns_stub_query_add_follower(DnsQuery *q, DnsPacket *p) {
+        assert(q);
+        assert(p);
+
+        FOREACH_ARRAY(f, q->request_followers, q->n_request_followers)
+                if (stub_packet_compare_func(*f, p) == 0)
+                        return 1; /* A repeat packet from a client we'll answer anyway */
+
+        if (q->n_request_followers >= STUB_FOLLOWERS_MAX)
+                return 0;
+
+        if (!GREEDY_REALLOC(q->request_followers, q->n_request_followers + 1))
+                return -ENOMEM;
+
+        q->request_followers[q->n_request_followers++] = dns_packet_ref(p);
+        return 1;
+}
+
 static int dns_stub_reply_with_edns0_do(DnsQuery *q) {
          assert(q);
 
@@ -633,7 +1053,17 @@ static int dns_stub_send_reply(
         if (r < 0)
                 return log_debug_errno(r, "Failed to build failure packet: %m");
 
-        return dns_stub_send(q->manager, q->stub_listener_extra, q->request_stream, q->request_packet, reply);
+        if (dns_stub_reply_is_cacheable(q, rcode, truncated)) {
+                r = dns_stub_reply_put(q, reply);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to remember reply packet, ignoring: %m");
+        }
+
+        r = dns_stub_send(q->manager, q->stub_listener_extra, q->request_stream, q->request_packet, reply);
+
+        dns_stub_send_to_followers(q, reply);
+
+        return r;
 }
 
 static int dns_stub_send_failure(
@@ -898,9 +1328,9 @@ static int dns_stub_stream_complete(DnsStream *s, int error) {
 static void dns_stub_process_query(Manager *m, DnsStubListenerExtra *l, DnsStream *s, DnsPacket *p) {
         uint64_t protocol_flags = SD_RESOLVED_PROTOCOLS_ALL;
         _cleanup_(dns_query_freep) DnsQuery *q = NULL;
-        Hashmap **queries_by_packet;
+        Hashmap **queries_by_packet, **queries_by_request;
         DnsQuery *existing;
-        bool bypass = false;
+        bool bypass = false, coalesce;
         int r;
 
         assert(m);
@@ -959,6 +1389,45 @@ static void dns_stub_process_query(Manager *m, DnsStubListenerExtra *l, DnsStrea
                 return;
         }
 
+        if (!s && !address_is_proxy(p->family, &p->destination)) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *reply = NULL;
+
+                /* Asked the very same question before, and we answered it from the cache? Then reply right
+                 * away with what we sent then. */
+                r = dns_stub_reply_get(m, l, p, &reply);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to reuse earlier reply, ignoring: %m");
+                else if (r > 0) {
+                        log_debug("Answering DNS stub query for id %u with earlier reply.", DNS_PACKET_ID(p));
+                        (void) dns_stub_send(m, l, NULL, p, reply);
+                        return;
+                }
+        }
+
+        /* Somebody else asked the very same question just before, and we are still waiting for the answer?
+         * Then send them both what we get. This is restricted to the cases where the reply is built from
+         * the request alone, see dns_stub_send_reply(), which the bypass logic doesn't. */
+        queries_by_request = l ? &l->queries_by_request : &m->stub_queries_by_request;
+        coalesce = !s &&
+                !address_is_proxy(p->family, &p->destination) &&
+                !DNS_PACKET_DO(p) &&
+                DNS_PACKET_QDCOUNT(p) == 1 &&
+                dns_stub_request_name_size(p) > 0;
+        if (coalesce) {
+                existing = hashmap_get(*queries_by_request, p);
+                if (existing) {
+                        r = dns_stub_query_add_follower(existing, p);
+                        if (r < 0)
+                                return (void) log_oom();
+                        if (r > 0) {
+                                log_debug("Answering DNS stub query for id %u together with identical query in flight.", DNS_PACKET_ID(p));
+                                return;
+                        }
+
+                        coalesce = false;
+                }
+        }
+
         r = hashmap_ensure_allocated(queries_by_packet, &stub_packet_hash_ops);
         if (r < 0) {
                 log_oom();
@@ -1024,6 +1493,10 @@ static void dns_stub_process_query(Manager *m, DnsStubListenerExtra *l, DnsStrea
          * isn't particularly bad. */
         (void) hashmap_put(*queries_by_packet, q->request_packet, q);
 
+        /* Same for identical requests from other clients. */
+        if (coalesce)
+                (void) hashmap_ensure_put(queries_by_request, &stub_request_hash_ops, q->request_packet, q);
+
         r = dns_query_go(q);
         if (r < 0) {
                 log_error_errno(r, "Failed to start query: %m");
@@ -1036,19 +1509,25 @@ static void dns_stub_process_query(Manager *m, DnsStubListenerExtra *l, DnsStrea
 }
 
 static int on_dns_stub_packet_internal(sd_event_source *s, int fd, uint32_t revents, Manager *m, DnsStubListenerExtra *l) {
-        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
-        int r;
+        DnsPacket *packets[DNS_STUB_DATAGRAM_BATCH_MAX];
+        int n;
 
-        r = manager_recv(m, fd, DNS_PROTOCOL_DNS, &p);
-        if (r <= 0)
-                return r;
+        /* Read a bounded number of queries per wakeup with a single system call, so that a burst of queries
+         * doesn't mean a trip through the event loop for each of them. */
+        n = manager_recv_many(m, fd, DNS_PROTOCOL_DNS, m->dns_stub_datagram_pool, packets, ELEMENTSOF(packets));
+        if (n <= 0)
+                return n;
 
-        if (dns_packet_validate_query(p) > 0) {
-                log_debug("Got DNS stub UDP query packet for id %u", DNS_PACKET_ID(p));
+        for (int i = 0; i < n; i++) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *p = packets[i];
 
-                dns_stub_process_query(m, l, NULL, p);
-        } else
-                log_debug("Invalid DNS stub UDP packet, ignoring.");
+                if (dns_packet_validate_query(p) > 0) {
+                        log_debug("Got DNS stub UDP query packet for id %u", DNS_PACKET_ID(p));
+
+                        dns_stub_process_query(m, l, NULL, p);
+                } else
+                        log_debug("Invalid DNS stub UDP packet, ignoring.");
+        }
 
         return 0;
 }
@@ -1435,6 +1914,8 @@ void manager_dns_stub_stop(Manager *m) {
         m->dns_stub_tcp_event_source = sd_event_source_disable_unref(m->dns_stub_tcp_event_source);
         m->dns_proxy_stub_udp_event_source = sd_event_source_disable_unref(m->dns_proxy_stub_udp_event_source);
         m->dns_proxy_stub_tcp_event_source = sd_event_source_disable_unref(m->dns_proxy_stub_tcp_event_source);
+
+        dns_stub_flush_replies(m);
 }
 
 static const char* const dns_stub_listener_mode_table[_DNS_STUB_LISTENER_MODE_MAX] = {
@@ -14,6 +14,9 @@ typedef enum DnsStubListenerMode {
         _DNS_STUB_LISTENER_MODE_INVALID = -EINVAL,
 } DnsStubListenerMode;
 
+/* How many UDP queries to read from a stub socket per wakeup, before giving other sources a chance again */
+#define DNS_STUB_DATAGRAM_BATCH_MAX 16U
+
 #include "resolved-manager.h"
 
 struct DnsStubListenerExtra {
@@ -29,6 +32,7 @@ struct DnsStubListenerExtra {
         sd_event_source *tcp_event_source;
 
         Hashmap *queries_by_packet;
+        Hashmap *queries_by_request;
 };
 
 extern const struct hash_ops dns_stub_listener_extra_hash_ops;
@@ -42,6 +46,9 @@ static inline uint16_t dns_stub_listener_extra_port(DnsStubListenerExtra *p) {
 }
 
 void manager_dns_stub_stop(Manager *m);
+void dns_stub_flush_replies(Manager *m);
+int dns_stub_reply_put(DnsQuery *q, DnsPacket *reply);
+int dns_stub_reply_get(Manager *m, DnsStubListenerExtra *l, DnsPacket *p, DnsPacket **ret);
 int manager_dns_stub_start(Manager *m);
 
 const char* dns_stub_listener_mode_to_string(DnsStubListenerMode p) _const_;
@@ -844,7 +844,8 @@ static void dns_transaction_cache_answer(DnsTransaction *t) {
                       t->answer_nsec_ttl,
                       t->received->family,
                       &t->received->sender,
-                      t->scope->manager->stale_retention_usec);
+                      t->scope->manager->stale_retention_usec,
+                      t->scope->manager->cache_entries_max);
 }
 
 static bool dns_transaction_dnssec_is_live(DnsTransaction *t) {
@@ -1674,6 +1675,51 @@ static void dns_transaction_randomize_answer(DnsTransaction *t) {
         dns_answer_randomize(t->answer);
 }
 
+static void dns_transaction_prefetch(DnsTransaction *t, usec_t ts) {
+        _cleanup_(dns_transaction_gcp) DnsTransaction *p = NULL;
+        char key_str[DNS_RESOURCE_KEY_STRING_MAX];
+        uint64_t query_flags;
+        int r;
+
+        assert(t);
+
+        /* We just answered from the cache. If the entry is popular and about to expire, refresh it in the
+         * background, so that the next lookup after its TTL doesn't have to wait for upstream. mDNS and
+         * LLMNR maintain their caches differently, hence only do this for classic DNS. */
+
+        if (t->scope->protocol != DNS_PROTOCOL_DNS || t->bypass)
+                return;
+
+        if (!dns_cache_should_prefetch(&t->scope->cache, dns_transaction_key(t), ts))
+                return;
+
+        query_flags = t->query_flags | SD_RESOLVED_NO_CACHE;
+
+        /* Somebody already asked upstream for this? Then the cache will be updated anyway. */
+        if (dns_scope_find_transaction(t->scope, dns_transaction_key(t), query_flags))
+                return;
+
+        r = dns_transaction_new(&p, t->scope, dns_transaction_key(t), NULL, query_flags);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to allocate prefetch transaction, ignoring: %m");
+                return;
+        }
+
+        p->prefetch = true;
+        p->wait_for_answer = true;
+
+        log_debug("Refreshing cache entry for %s before it expires.",
+                  dns_resource_key_to_string(dns_transaction_key(p), key_str, sizeof key_str));
+
+        r = dns_transaction_go(p);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to start prefetch transaction, ignoring: %m");
+                return;
+        }
+        if (r == 0)
+                TAKE_PTR(p); /* Already completed, and hence freed */
+}
+
 static int dns_transaction_prepare(DnsTransaction *t, usec_t ts) {
         int r;
 
@@ -1829,8 +1875,10 @@ static int dns_transaction_prepare(DnsTransaction *t, usec_t ts) {
                                 }
 
                                 t->answer_source = DNS_TRANSACTION_CACHE;
-                                if (t->answer_rcode == DNS_RCODE_SUCCESS)
+                                if (t->answer_rcode == DNS_RCODE_SUCCESS) {
+                                        dns_transaction_prefetch(t, ts);
                                         dns_transaction_complete(t, DNS_TRANSACTION_SUCCESS);
+                                }
                                 else {
                                         if (t->received)
                                                 (void) dns_packet_ede_rcode(t->received, &t->answer_ede_rcode, &t->answer_ede_msg);
@@ -141,6 +141,10 @@ struct DnsTransaction {
          * answer. */
         bool wait_for_answer;
 
+        /* Set for transactions that refresh a popular cache entry shortly before it expires. Nobody waits
+         * for their answer, it only ends up in the cache. */
+        bool prefetch;
+
         LIST_FIELDS(DnsTransaction, transactions_by_scope);
         LIST_FIELDS(DnsTransaction, transactions_by_stream);
         LIST_FIELDS(DnsTransaction, transactions_by_key);
@@ -86,6 +86,7 @@ int dnstls_stream_connect_tls(DnsStream *stream, DnsServer *server) {
                 return -ENOMEM;
 
         SSL_set_connect_state(s);
+        SSL_set_app_data(s, stream);
         r = SSL_set_session(s, server->dnstls_data.session);
         if (r == 0)
                 return -EIO;
@@ -224,22 +225,11 @@ int dnstls_stream_on_io(DnsStream *stream, uint32_t revents) {
 
 int dnstls_stream_shutdown(DnsStream *stream, int error) {
         int ssl_error, r;
-        SSL_SESSION *s;
 
         assert(stream);
         assert(stream->encrypted);
         assert(stream->dnstls_data.ssl);
 
-        if (stream->server) {
-                s = SSL_get1_session(stream->dnstls_data.ssl);
-                if (s) {
-                        if (stream->server->dnstls_data.session)
-                                SSL_SESSION_free(stream->server->dnstls_data.session);
-
-                        stream->server->dnstls_data.session = s;
-                }
-        }
-
         if (error == ETIMEDOUT) {
                 ERR_clear_error();
                 r = SSL_shutdown(stream->dnstls_data.ssl);
@@ -387,6 +377,26 @@ void dnstls_server_free(DnsServer *server) {
                 SSL_SESSION_free(server->dnstls_data.session);
 }
 
+static int dnstls_new_session(SSL *ssl, SSL_SESSION *session) {
+        DnsStream *stream;
+
+        /* Called whenever the server hands out a session: after the handshake for TLS 1.2, and for each
+         * NewSessionTicket message for TLS 1.3, which arrives only after the handshake completed. Remember
+         * the most recent one, so that the next connection to this server can resume it instead of doing
+         * a full handshake. Previously the session was picked up only when the connection was shut down,
+         * which missed it whenever the server closed an idle connection first. */
+
+        stream = SSL_get_app_data(ssl);
+        if (!stream || !stream->server)
+                return 0;
+
+        if (stream->server->dnstls_data.session)
+                SSL_SESSION_free(stream->server->dnstls_data.session);
+
+        stream->server->dnstls_data.session = session;
+        return 1; /* We took over the reference */
+}
+
 int dnstls_manager_init(Manager *manager) {
         int r;
 
@@ -406,6 +416,10 @@ int dnstls_manager_init(Manager *manager) {
 
         (void) SSL_CTX_set_options(manager->dnstls_data.ctx, SSL_OP_NO_COMPRESSION);
 
+        /* We keep one session per server ourselves, see dnstls_new_session() */
+        (void) SSL_CTX_set_session_cache_mode(manager->dnstls_data.ctx, SSL_SESS_CACHE_CLIENT|SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(manager->dnstls_data.ctx, dnstls_new_session);
+
         r = SSL_CTX_set_default_verify_paths(manager->dnstls_data.ctx);
         if (r == 0)
                 return log_warning_errno(SYNTHETIC_ERRNO(EIO),
@@ -1,14 +1,19 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "event-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "hostname-util.h"
+#include "mountpoint-util.h"
+#include "resolved-dns-stub.h"
 #include "resolved-dns-synthesize.h"
 #include "resolved-etc-hosts.h"
+#include "resolved-nss-cache.h"
 #include "socket-netlink.h"
 #include "stat-util.h"
 #include "string-util.h"
@@ -18,6 +23,10 @@
 /* Recheck /etc/hosts at most once every 2s */
 #define ETC_HOSTS_RECHECK_USEC (2*USEC_PER_SEC)
 
+/* When /etc/hosts is watched, re-read it this long after the first change was seen, so that a burst of
+ * writes results in a single re-read */
+#define ETC_HOSTS_RELOAD_DELAY_USEC (100*USEC_PER_MSEC)
+
 static EtcHostsItemByAddress *etc_hosts_item_by_address_free(EtcHostsItemByAddress *item) {
         if (!item)
                 return NULL;
@@ -328,19 +337,22 @@ int etc_hosts_parse(EtcHosts *hosts, FILE *f) {
         return 0;
 }
 
-static int manager_etc_hosts_read(Manager *m) {
+static void manager_etc_hosts_changed(Manager *m) {
+        assert(m);
+
+        /* Answers from /etc/hosts take precedence over everything else, hence the stub and nss-resolve
+         * must not continue to hand out replies that were built from the old contents, or that the new
+         * contents override. */
+        dns_stub_flush_replies(m);
+        manager_nss_cache_flush(m);
+}
+
+static int manager_etc_hosts_reload(Manager *m) {
         _cleanup_fclose_ FILE *f = NULL;
         struct stat st;
-        usec_t ts;
         int r;
 
-        assert_se(sd_event_now(m->event, CLOCK_BOOTTIME, &ts) >= 0);
-
-        /* See if we checked /etc/hosts recently already */
-        if (m->etc_hosts_last != USEC_INFINITY && m->etc_hosts_last + ETC_HOSTS_RECHECK_USEC > ts)
-                return 0;
-
-        m->etc_hosts_last = ts;
+        assert(m);
 
         if (stat_is_set(&m->etc_hosts_stat)) {
                 if (stat("/etc/hosts", &st) < 0) {
@@ -348,6 +360,7 @@ static int manager_etc_hosts_read(Manager *m) {
                                 return log_error_errno(errno, "Failed to stat /etc/hosts: %m");
 
                         manager_etc_hosts_flush(m);
+                        manager_etc_hosts_changed(m);
                         return 0;
                 }
 
@@ -362,6 +375,7 @@ static int manager_etc_hosts_read(Manager *m) {
                         return log_error_errno(errno, "Failed to open /etc/hosts: %m");
 
                 manager_etc_hosts_flush(m);
+                manager_etc_hosts_changed(m);
                 return 0;
         }
 
@@ -376,11 +390,160 @@ static int manager_etc_hosts_read(Manager *m) {
                 return r;
 
         m->etc_hosts_stat = st;
-        m->etc_hosts_last = ts;
+        manager_etc_hosts_changed(m);
+
+        return 1;
+}
+
+static void manager_etc_hosts_unwatch(Manager *m) {
+        assert(m);
+
+        m->etc_hosts_inotify_event_source = sd_event_source_disable_unref(m->etc_hosts_inotify_event_source);
+        m->etc_hosts_reload_event_source = sd_event_source_disable_unref(m->etc_hosts_reload_event_source);
+}
+
+void manager_etc_hosts_stop(Manager *m) {
+        manager_etc_hosts_unwatch(m);
+        manager_etc_hosts_flush(m);
+}
+
+static bool etc_hosts_is_watchable(void) {
+        struct stat st, etc_st;
+
+        /* A watch on /etc/ only sees changes made through /etc/. Changes to the target of a symlink aren't
+         * seen, neither are changes made to a file or directory mounted over /etc/hosts from elsewhere, as
+         * container managers commonly do. */
+
+        if (lstat("/etc/hosts", &st) < 0)
+                return errno == ENOENT; /* We'll see it being created */
+
+        if (S_ISLNK(st.st_mode))
+                return false;
+
+        if (stat("/etc/", &etc_st) < 0 || st.st_dev != etc_st.st_dev)
+                return false;
+
+        return path_is_mount_point("/etc/hosts") == 0;
+}
+
+static int on_etc_hosts_reload(sd_event_source *s, uint64_t usec, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        if (!etc_hosts_is_watchable()) {
+                log_debug("/etc/hosts is now a symlink or mount point, falling back to checking it on lookups.");
+                manager_etc_hosts_unwatch(m);
+                m->etc_hosts_last = USEC_INFINITY;
+                return 0;
+        }
+
+        if (!m->read_etc_hosts) {
+                /* Read it afresh on the next lookup, should it be enabled again */
+                m->etc_hosts_last = USEC_INFINITY;
+                return 0;
+        }
+
+        (void) manager_etc_hosts_reload(m);
+        m->etc_hosts_last = usec;
+
+        return 0;
+}
+
+static int on_etc_hosts_inotify(sd_event_source *s, const struct inotify_event *event, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(event);
+
+        if (FLAGS_SET(event->mask, IN_IGNORED)) {
+                /* The watch is gone, /etc was unmounted or similar */
+                log_debug("Watch on /etc/ was removed, falling back to checking /etc/hosts on lookups.");
+                manager_etc_hosts_unwatch(m);
+                m->etc_hosts_last = USEC_INFINITY;
+                return 0;
+        }
+
+        if (!FLAGS_SET(event->mask, IN_Q_OVERFLOW) &&
+            (event->len == 0 || !streq(event->name, "hosts")))
+                return 0;
+
+        /* Don't move an already scheduled reload, so that continuous writes don't postpone it forever */
+        r = event_reset_time_relative(
+                        m->event,
+                        &m->etc_hosts_reload_event_source,
+                        CLOCK_BOOTTIME,
+                        ETC_HOSTS_RELOAD_DELAY_USEC, 0,
+                        on_etc_hosts_reload, m,
+                        0, "etc-hosts-reload",
+                        /* force_reset= */ false);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to schedule /etc/hosts reload, falling back to checking it on lookups: %m");
+                manager_etc_hosts_unwatch(m);
+                m->etc_hosts_last = USEC_INFINITY;
+        }
+
+        return 0;
+}
+
+static int manager_etc_hosts_watch(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (m->etc_hosts_inotify_event_source)
+                return 0;
+
+        if (!etc_hosts_is_watchable())
+                return 0;
+
+        /* Watch the directory rather than the file, so that we also catch the file being replaced. */
+        r = sd_event_add_inotify(
+                        m->event,
+                        &m->etc_hosts_inotify_event_source,
+                        "/etc/",
+                        IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ONLYDIR,
+                        on_etc_hosts_inotify, m);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to watch /etc/, checking /etc/hosts on lookups instead: %m");
+
+        (void) sd_event_source_set_description(m->etc_hosts_inotify_event_source, "etc-hosts-inotify");
 
         return 1;
 }
 
+static int manager_etc_hosts_read(Manager *m) {
+        usec_t ts;
+        int r;
+
+        assert(m);
+
+        assert_se(sd_event_now(m->event, CLOCK_BOOTTIME, &ts) >= 0);
+
+        /* See if we checked /etc/hosts recently already */
+        if (m->etc_hosts_last != USEC_INFINITY && m->etc_hosts_last + ETC_HOSTS_RECHECK_USEC > ts)
+                return 0;
+
+        /* Once /etc/hosts is watched, changes are picked up by on_etc_hosts_reload() off the lookup path,
+         * and only the initial read happens here. Something might have been mounted over /etc/hosts since
+         * then though, which doesn't generate any inotify event, hence check that now and then. */
+        if (m->etc_hosts_inotify_event_source && m->etc_hosts_last != USEC_INFINITY) {
+                if (etc_hosts_is_watchable()) {
+                        m->etc_hosts_last = ts;
+                        return 0;
+                }
+
+                log_debug("/etc/hosts is now a symlink or mount point, falling back to checking it on lookups.");
+                manager_etc_hosts_unwatch(m);
+        }
+
+        /* Set up the watch before reading the file, so that no change in between is missed */
+        (void) manager_etc_hosts_watch(m);
+
+        r = manager_etc_hosts_reload(m);
+        m->etc_hosts_last = ts;
+
+        return r;
+}
+
 static int answer_add_ptr(DnsAnswer *answer, DnsResourceKey *key, const char *name) {
         _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
 
@@ -123,7 +123,7 @@ void link_allocate_scopes(Link *l) {
                 /* Also, flush the global unicast scope, to deal with split horizon setups, where talking through one
                  * interface reveals different DNS zones than through others. */
                 if (l->manager->unicast_scope)
-                        dns_cache_flush(&l->manager->unicast_scope->cache);
+                        dns_scope_flush_cache(l->manager->unicast_scope);
         }
 
         /* And now, allocate all scopes that makes sense now if we didn't have them yet, and drop those which we don't
@@ -728,7 +728,7 @@ DnsServer* link_set_dns_server(Link *l, DnsServer *s) {
 
         /* Skip flushing the cache if server stale feature is enabled. */
         if (l->unicast_scope && l->manager->stale_retention_usec == 0)
-                dns_cache_flush(&l->unicast_scope->cache);
+                dns_scope_flush_cache(l->unicast_scope);
 
         return s;
 }
@@ -37,6 +37,7 @@
 #include "resolved-llmnr.h"
 #include "resolved-manager.h"
 #include "resolved-mdns.h"
+#include "resolved-nss-cache.h"
 #include "resolved-resolv-conf.h"
 #include "resolved-util.h"
 #include "resolved-varlink.h"
@@ -584,6 +585,8 @@ static void manager_set_defaults(Manager *m) {
         m->resolve_unicast_single_label = false;
         m->cache_from_localhost = false;
         m->stale_retention_usec = 0;
+        m->cache_entries_max = DNS_CACHE_ENTRIES_MAX_DEFAULT;
+        m->nss_cache = false;
 }
 
 static int manager_dispatch_reload_signal(sd_event_source *s, const struct signalfd_siginfo *si, void *userdata) {
@@ -601,6 +604,7 @@ static int manager_dispatch_reload_signal(sd_event_source *s, const struct signa
         m->unicast_scope = dns_scope_free(m->unicast_scope);
 
         dns_trust_anchor_flush(&m->trust_anchor);
+        dnssec_flush_verified_signatures();
 
         r = dns_trust_anchor_load(&m->trust_anchor);
         if (r < 0)
@@ -616,6 +620,8 @@ static int manager_dispatch_reload_signal(sd_event_source *s, const struct signa
         if (r < 0)
                 log_warning_errno(r, "Failed to load DNS-SD configuration files: %m");
 
+        (void) manager_nss_cache_start(m);
+
         /* The default scope configuration is influenced by the manager's configuration (modes, etc.), so
          * recreate it on reload. */
         r = dns_scope_new(m, &m->unicast_scope, NULL, DNS_PROTOCOL_DNS, AF_UNSPEC);
@@ -763,6 +769,8 @@ int manager_start(Manager *m) {
         if (r < 0)
                 return r;
 
+        (void) manager_nss_cache_start(m);
+
         return 0;
 }
 
@@ -784,6 +792,9 @@ Manager *manager_free(Manager *m) {
                 dns_query_free(m->dns_queries);
 
         m->stub_queries_by_packet = hashmap_free(m->stub_queries_by_packet);
+        m->stub_queries_by_request = hashmap_free(m->stub_queries_by_request);
+
+        manager_nss_cache_stop(m);
 
         dns_scope_free(m->unicast_scope);
 
@@ -811,6 +822,9 @@ Manager *manager_free(Manager *m) {
         manager_dns_stub_stop(m);
         manager_varlink_done(m);
 
+        FOREACH_ELEMENT(p, m->dns_stub_datagram_pool)
+                dns_packet_unref(*p);
+
         manager_socket_graveyard_clear(m);
 
         ordered_set_free(m->dns_extra_stub_listeners);
@@ -827,6 +841,8 @@ Manager *manager_free(Manager *m) {
         sd_event_source_unref(m->hostname_event_source);
         safe_close(m->hostname_fd);
 
+        manager_etc_hosts_stop(m);
+
         sd_event_unref(m->event);
 
         free(m->full_hostname);
@@ -838,67 +854,51 @@ Manager *manager_free(Manager *m) {
         hashmap_free(m->dnssd_services);
 
         dns_trust_anchor_flush(&m->trust_anchor);
-        manager_etc_hosts_flush(m);
+
+        /* The cache of verified signatures is global, not per manager. Release it too, so that it doesn't
+         * show up as leaked memory. */
+        dnssec_flush_verified_signatures();
 
         return mfree(m);
 }
 
-int manager_recv(Manager *m, int fd, DnsProtocol protocol, DnsPacket **ret) {
-        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
-        CMSG_BUFFER_TYPE(CMSG_SPACE(MAXSIZE(struct in_pktinfo, struct in6_pktinfo))
+typedef CMSG_BUFFER_TYPE(CMSG_SPACE(MAXSIZE(struct in_pktinfo, struct in6_pktinfo))
                          + CMSG_SPACE(int) /* ttl/hoplimit */
-                         + EXTRA_CMSG_SPACE /* kernel appears to require extra buffer space */) control;
-        union sockaddr_union sa;
-        struct iovec iov;
-        struct msghdr mh = {
-                .msg_name = &sa.sa,
-                .msg_namelen = sizeof(sa),
-                .msg_iov = &iov,
-                .msg_iovlen = 1,
-                .msg_control = &control,
-                .msg_controllen = sizeof(control),
-        };
-        struct cmsghdr *cmsg;
-        ssize_t ms, l;
-        int r;
-
-        assert(m);
-        assert(fd >= 0);
-        assert(ret);
-
-        ms = next_datagram_size_fd(fd);
-        if (ms < 0)
-                return ms;
+                         + EXTRA_CMSG_SPACE /* kernel appears to require extra buffer space */) ManagerRecvControl;
 
-        r = dns_packet_new(&p, protocol, ms, DNS_PACKET_SIZE_MAX);
-        if (r < 0)
-                return r;
+static int manager_recv_finish(
+                Manager *m,
+                DnsProtocol protocol,
+                DnsPacket *p,
+                struct msghdr *mh,
+                const union sockaddr_union *sa,
+                usec_t timestamp) {
 
-        iov = IOVEC_MAKE(DNS_PACKET_DATA(p), p->allocated);
+        struct cmsghdr *cmsg;
 
-        l = recvmsg_safe(fd, &mh, 0);
-        if (ERRNO_IS_NEG_TRANSIENT(l))
-                return 0;
-        if (l <= 0)
-                return l;
+        assert(m);
+        assert(p);
+        assert(mh);
+        assert(sa);
 
-        p->size = (size_t) l;
+        /* Fills in the packet metadata from the source address and the control messages of a datagram we
+         * just received into it */
 
-        p->family = sa.sa.sa_family;
+        p->family = sa->sa.sa_family;
         p->ipproto = IPPROTO_UDP;
         if (p->family == AF_INET) {
-                p->sender.in = sa.in.sin_addr;
-                p->sender_port = be16toh(sa.in.sin_port);
+                p->sender.in = sa->in.sin_addr;
+                p->sender_port = be16toh(sa->in.sin_port);
         } else if (p->family == AF_INET6) {
-                p->sender.in6 = sa.in6.sin6_addr;
-                p->sender_port = be16toh(sa.in6.sin6_port);
-                p->ifindex = sa.in6.sin6_scope_id;
+                p->sender.in6 = sa->in6.sin6_addr;
+                p->sender_port = be16toh(sa->in6.sin6_port);
+                p->ifindex = sa->in6.sin6_scope_id;
         } else
                 return -EAFNOSUPPORT;
 
-        p->timestamp = now(CLOCK_BOOTTIME);
+        p->timestamp = timestamp;
 
-        CMSG_FOREACH(cmsg, &mh) {
+        CMSG_FOREACH(cmsg, mh) {
 
                 if (cmsg->cmsg_level == IPPROTO_IPV6) {
                         assert(p->family == AF_INET6);
@@ -968,10 +968,142 @@ int manager_recv(Manager *m, int fd, DnsProtocol protocol, DnsPacket **ret) {
                   IN_ADDR_TO_STRING(p->family, &p->sender),
                   IN_ADDR_TO_STRING(p->family, &p->destination));
 
+        return 0;
+}
+
+int manager_recv(Manager *m, int fd, DnsProtocol protocol, DnsPacket **ret) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        ManagerRecvControl control;
+        union sockaddr_union sa;
+        struct iovec iov;
+        struct msghdr mh = {
+                .msg_name = &sa.sa,
+                .msg_namelen = sizeof(sa),
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+                .msg_control = &control,
+                .msg_controllen = sizeof(control),
+        };
+        ssize_t ms, l;
+        int r;
+
+        assert(m);
+        assert(fd >= 0);
+        assert(ret);
+
+        ms = next_datagram_size_fd(fd);
+        if (ERRNO_IS_NEG_TRANSIENT(ms))
+                return 0;
+        if (ms < 0)
+                return ms;
+
+        r = dns_packet_new(&p, protocol, ms, DNS_PACKET_SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        iov = IOVEC_MAKE(DNS_PACKET_DATA(p), p->allocated);
+
+        l = recvmsg_safe(fd, &mh, 0);
+        if (ERRNO_IS_NEG_TRANSIENT(l))
+                return 0;
+        if (l <= 0)
+                return l;
+
+        p->size = (size_t) l;
+
+        r = manager_recv_finish(m, protocol, p, &mh, &sa, now(CLOCK_BOOTTIME));
+        if (r < 0)
+                return r;
+
         *ret = TAKE_PTR(p);
         return 1;
 }
 
+int manager_recv_many(Manager *m, int fd, DnsProtocol protocol, DnsPacket **pool, DnsPacket **ret, size_t n) {
+        size_t k = 0;
+        usec_t ts;
+        int r, c;
+
+        assert(m);
+        assert(fd >= 0);
+        assert(pool);
+        assert(ret);
+        assert(n > 0);
+        assert(n <= DNS_STUB_DATAGRAM_BATCH_MAX);
+
+        /* Like manager_recv(), but reads up to n datagrams with a single recvmmsg(). Datagrams are received
+         * into the packets in the pool, which is refilled as needed. Packets that end up unused stay in the
+         * pool for the next call, hence with the default allocation granularity of a page this needs no
+         * more memory or allocations than reading the datagrams one by one, while saving two system calls
+         * per datagram. Datagrams that don't fit into a pool packet (i.e. are larger than a couple of KB,
+         * which no query sent to us ever legitimately is) are dropped. Returns the number of packets placed
+         * in ret, which the caller then owns. */
+
+        ManagerRecvControl control[DNS_STUB_DATAGRAM_BATCH_MAX];
+        union sockaddr_union sa[DNS_STUB_DATAGRAM_BATCH_MAX];
+        struct iovec iov[DNS_STUB_DATAGRAM_BATCH_MAX];
+        struct mmsghdr mmh[DNS_STUB_DATAGRAM_BATCH_MAX];
+
+        for (size_t i = 0; i < n; i++) {
+                if (!pool[i]) {
+                        r = dns_packet_new(pool + i, protocol, 0, DNS_PACKET_SIZE_MAX);
+                        if (r < 0)
+                                return r;
+                }
+
+                iov[i] = IOVEC_MAKE(DNS_PACKET_DATA(pool[i]), pool[i]->allocated);
+                mmh[i] = (struct mmsghdr) {
+                        .msg_hdr = {
+                                .msg_name = &sa[i].sa,
+                                .msg_namelen = sizeof(sa[i]),
+                                .msg_iov = iov + i,
+                                .msg_iovlen = 1,
+                                .msg_control = control + i,
+                                .msg_controllen = sizeof(control[i]),
+                        },
+                };
+        }
+
+        c = recvmmsg(fd, mmh, n, MSG_DONTWAIT|MSG_TRUNC, /* timeout= */ NULL);
+        if (c < 0) {
+                if (ERRNO_IS_TRANSIENT(errno))
+                        return 0;
+
+                return -errno;
+        }
+
+        ts = now(CLOCK_BOOTTIME);
+
+        for (int i = 0; i < c; i++) {
+                struct msghdr *mh = &mmh[i].msg_hdr;
+                DnsPacket *p = pool[i];
+
+                if (FLAGS_SET(mh->msg_flags, MSG_CTRUNC) ||
+                    FLAGS_SET(mh->msg_flags, MSG_TRUNC) ||
+                    mmh[i].msg_len > p->allocated) {
+                        log_debug("Dropping truncated %s UDP datagram of size %u.",
+                                  dns_protocol_to_string(protocol), mmh[i].msg_len);
+                        continue;
+                }
+
+                if (mmh[i].msg_len == 0)
+                        continue;
+
+                p->size = mmh[i].msg_len;
+
+                if (manager_recv_finish(m, protocol, p, mh, &sa[i], ts) < 0) {
+                        /* Reset the packet so that it can be reused from the pool */
+                        dns_packet_unref(p);
+                        pool[i] = NULL;
+                        continue;
+                }
+
+                ret[k++] = TAKE_PTR(pool[i]);
+        }
+
+        return (int) k;
+}
+
 int sendmsg_loop(int fd, struct msghdr *mh, int flags) {
         usec_t end;
         int r;
@@ -1176,7 +1308,20 @@ static int dns_question_to_json(DnsQuestion *q, sd_json_variant **ret) {
         return 0;
 }
 
-int manager_monitor_send(Manager *m, DnsQuery *q) {
+int manager_monitor_send_full(
+                Manager *m,
+                DnsTransactionState state,
+                DnssecResult dnssec_result,
+                int rcode,
+                int error,
+                int ede_rcode,
+                const char *ede_msg,
+                DnsQuestion *question_idna,
+                DnsQuestion *question_utf8,
+                DnsQuestion *question_bypass,
+                DnsQuestion *collected_questions,
+                DnsAnswer *answer) {
+
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *jquestion = NULL, *jcollected_questions = NULL, *janswer = NULL;
         _cleanup_(dns_question_unrefp) DnsQuestion *merged = NULL;
         DnsAnswerItem *rri;
@@ -1188,14 +1333,14 @@ int manager_monitor_send(Manager *m, DnsQuery *q) {
                 return 0;
 
         /* Merge all questions into one */
-        r = dns_question_merge(q->question_idna, q->question_utf8, &merged);
+        r = dns_question_merge(question_idna, question_utf8, &merged);
         if (r < 0)
                 return log_error_errno(r, "Failed to merge UTF8/IDNA questions: %m");
 
-        if (q->question_bypass) {
+        if (question_bypass) {
                 _cleanup_(dns_question_unrefp) DnsQuestion *merged2 = NULL;
 
-                r = dns_question_merge(merged, q->question_bypass->question, &merged2);
+                r = dns_question_merge(merged, question_bypass, &merged2);
                 if (r < 0)
                         return log_error_errno(r, "Failed to merge UTF8/IDNA questions and DNS packet question: %m");
 
@@ -1209,11 +1354,11 @@ int manager_monitor_send(Manager *m, DnsQuery *q) {
                 return log_error_errno(r, "Failed to convert question to JSON: %m");
 
         /* Generate a JSON array of the questions preceding the current one in the CNAME chain */
-        r = dns_question_to_json(q->collected_questions, &jcollected_questions);
+        r = dns_question_to_json(collected_questions, &jcollected_questions);
         if (r < 0)
                 return log_error_errno(r, "Failed to convert question to JSON: %m");
 
-        DNS_ANSWER_FOREACH_ITEM(rri, q->answer) {
+        DNS_ANSWER_FOREACH_ITEM(rri, answer) {
                 _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
 
                 r = dns_resource_record_to_json(rri->rr, &v);
@@ -1235,23 +1380,23 @@ int manager_monitor_send(Manager *m, DnsQuery *q) {
 
         r = varlink_many_notifybo(
                         m->varlink_subscription,
-                        SD_JSON_BUILD_PAIR("state", SD_JSON_BUILD_STRING(dns_transaction_state_to_string(q->state))),
-                        SD_JSON_BUILD_PAIR_CONDITION(q->state == DNS_TRANSACTION_DNSSEC_FAILED,
-                                                     "result", SD_JSON_BUILD_STRING(dnssec_result_to_string(q->answer_dnssec_result))),
-                        SD_JSON_BUILD_PAIR_CONDITION(q->state == DNS_TRANSACTION_RCODE_FAILURE,
-                                                     "rcode", SD_JSON_BUILD_INTEGER(q->answer_rcode)),
-                        SD_JSON_BUILD_PAIR_CONDITION(q->state == DNS_TRANSACTION_ERRNO,
-                                                     "errno", SD_JSON_BUILD_INTEGER(q->answer_errno)),
-                        SD_JSON_BUILD_PAIR_CONDITION(IN_SET(q->state,
+                        SD_JSON_BUILD_PAIR("state", SD_JSON_BUILD_STRING(dns_transaction_state_to_string(state))),
+                        SD_JSON_BUILD_PAIR_CONDITION(state == DNS_TRANSACTION_DNSSEC_FAILED,
+                                                     "result", SD_JSON_BUILD_STRING(dnssec_result_to_string(dnssec_result))),
+                        SD_JSON_BUILD_PAIR_CONDITION(state == DNS_TRANSACTION_RCODE_FAILURE,
+                                                     "rcode", SD_JSON_BUILD_INTEGER(rcode)),
+                        SD_JSON_BUILD_PAIR_CONDITION(state == DNS_TRANSACTION_ERRNO,
+                                                     "errno", SD_JSON_BUILD_INTEGER(error)),
+                        SD_JSON_BUILD_PAIR_CONDITION(IN_SET(state,
                                                             DNS_TRANSACTION_DNSSEC_FAILED,
                                                             DNS_TRANSACTION_RCODE_FAILURE) &&
-                                                     q->answer_ede_rcode >= 0,
-                                                     "extendedDNSErrorCode", SD_JSON_BUILD_INTEGER(q->answer_ede_rcode)),
-                        SD_JSON_BUILD_PAIR_CONDITION(IN_SET(q->state,
+                                                     ede_rcode >= 0,
+                                                     "extendedDNSErrorCode", SD_JSON_BUILD_INTEGER(ede_rcode)),
+                        SD_JSON_BUILD_PAIR_CONDITION(IN_SET(state,
                                                             DNS_TRANSACTION_DNSSEC_FAILED,
                                                             DNS_TRANSACTION_RCODE_FAILURE) &&
-                                                     q->answer_ede_rcode >= 0 && !isempty(q->answer_ede_msg),
-                                                     "extendedDNSErrorMessage", SD_JSON_BUILD_STRING(q->answer_ede_msg)),
+                                                     ede_rcode >= 0 && !isempty(ede_msg),
+                                                     "extendedDNSErrorMessage", SD_JSON_BUILD_STRING(ede_msg)),
                         SD_JSON_BUILD_PAIR("question", SD_JSON_BUILD_VARIANT(jquestion)),
                         SD_JSON_BUILD_PAIR_CONDITION(!!jcollected_questions,
                                                      "collectedQuestions", SD_JSON_BUILD_VARIANT(jcollected_questions)),
@@ -1263,6 +1408,25 @@ int manager_monitor_send(Manager *m, DnsQuery *q) {
         return 0;
 }
 
+int manager_monitor_send(Manager *m, DnsQuery *q) {
+        assert(m);
+        assert(q);
+
+        return manager_monitor_send_full(
+                        m,
+                        q->state,
+                        q->answer_dnssec_result,
+                        q->answer_rcode,
+                        q->answer_errno,
+                        q->answer_ede_rcode,
+                        q->answer_ede_msg,
+                        q->question_idna,
+                        q->question_utf8,
+                        q->question_bypass ? q->question_bypass->question : NULL,
+                        q->collected_questions,
+                        q->answer);
+}
+
 int manager_send(
                 Manager *m,
                 int fd,
@@ -1704,7 +1868,9 @@ void manager_flush_caches(Manager *m, int log_level) {
         assert(m);
 
         LIST_FOREACH(scopes, scope, m->dns_scopes)
-                dns_cache_flush(&scope->cache);
+                dns_scope_flush_cache(scope);
+
+        dnssec_flush_verified_signatures();
 
         log_full(log_level, "Flushed all caches.");
 }
@@ -1885,7 +2051,7 @@ int socket_disable_pmtud(int fd, int af) {
 }
 
 int dns_manager_dump_statistics_json(Manager *m, sd_json_variant **ret) {
-        uint64_t size = 0, hit = 0, miss = 0;
+        uint64_t size = 0, hit = 0, miss = 0, evicted = 0;
 
         assert(m);
         assert(ret);
@@ -1894,8 +2060,12 @@ int dns_manager_dump_statistics_json(Manager *m, sd_json_variant **ret) {
                 size += dns_cache_size(&s->cache);
                 hit += s->cache.n_hit;
                 miss += s->cache.n_miss;
+                evicted += s->cache.n_evicted;
         }
 
+        /* Replies the stub sent again were built from cache entries as well */
+        hit += m->n_stub_reply_hit;
+
         return sd_json_buildo(ret,
                               SD_JSON_BUILD_PAIR("transactions", SD_JSON_BUILD_OBJECT(
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("currentTransactions", hashmap_size(m->dns_transactions)),
@@ -1908,7 +2078,8 @@ int dns_manager_dump_statistics_json(Manager *m, sd_json_variant **ret) {
                               SD_JSON_BUILD_PAIR("cache", SD_JSON_BUILD_OBJECT(
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("size", size),
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("hits", hit),
-                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("misses", miss)
+                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("misses", miss),
+                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("evictions", evicted)
                                                  )),
                               SD_JSON_BUILD_PAIR("dnssec", SD_JSON_BUILD_OBJECT(
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("secure", m->n_dnssec_verdict[DNSSEC_SECURE]),
@@ -1923,8 +2094,9 @@ void dns_manager_reset_statistics(Manager *m) {
         assert(m);
 
         LIST_FOREACH(scopes, s, m->dns_scopes)
-                s->cache.n_hit = s->cache.n_miss = 0;
+                s->cache.n_hit = s->cache.n_miss = s->cache.n_evicted = 0;
 
+        m->n_stub_reply_hit = 0;
         m->n_transactions_total = 0;
         m->n_timeouts_total = 0;
         m->n_timeouts_served_stale_total = 0;
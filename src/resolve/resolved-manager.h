@@ -12,6 +12,7 @@
 #include "hashmap.h"
 #include "list.h"
 #include "ordered-set.h"
+#include "resolve-nss-cache.h"
 #include "resolve-util.h"
 
 typedef struct Manager Manager;
@@ -44,6 +45,7 @@ struct Manager {
         bool cache_from_localhost;
         DnsStubListenerMode dns_stub_listener_mode;
         usec_t stale_retention_usec;
+        unsigned cache_entries_max;
 
 #if ENABLE_DNS_OVER_TLS
         DnsTlsManagerData dnstls_data;
@@ -63,6 +65,7 @@ struct Manager {
         LIST_HEAD(DnsQuery, dns_queries);
         unsigned n_dns_queries;
         Hashmap *stub_queries_by_packet;
+        Hashmap *stub_queries_by_request;
 
         LIST_HEAD(DnsStream, dns_streams);
         unsigned n_dns_streams[_DNS_STREAM_TYPE_MAX];
@@ -135,8 +138,14 @@ struct Manager {
         EtcHosts etc_hosts;
         usec_t etc_hosts_last;
         struct stat etc_hosts_stat;
+        sd_event_source *etc_hosts_inotify_event_source;
+        sd_event_source *etc_hosts_reload_event_source;
         bool read_etc_hosts;
 
+        /* Shared memory snapshot of resolved host names for nss-resolve */
+        bool nss_cache;
+        ResolveNssCacheHeader *nss_cache_header;
+
         OrderedSet *dns_extra_stub_listeners;
 
         /* Local DNS stub on 127.0.0.53:53 */
@@ -147,6 +156,14 @@ struct Manager {
         sd_event_source *dns_proxy_stub_udp_event_source;
         sd_event_source *dns_proxy_stub_tcp_event_source;
 
+        /* Replies sent from the stub, for answering repeated queries */
+        Set *dns_stub_replies;
+        Prioq *dns_stub_replies_by_expiry;
+        unsigned n_stub_reply_hit;
+
+        /* Preallocated packets to receive stub datagrams into */
+        DnsPacket *dns_stub_datagram_pool[DNS_STUB_DATAGRAM_BATCH_MAX];
+
         Hashmap *polkit_registry;
 
         sd_varlink_server *varlink_server;
@@ -172,12 +189,26 @@ int manager_start(Manager *m);
 
 uint32_t manager_find_mtu(Manager *m);
 
+int manager_monitor_send_full(
+                Manager *m,
+                DnsTransactionState state,
+                DnssecResult dnssec_result,
+                int rcode,
+                int error,
+                int ede_rcode,
+                const char *ede_msg,
+                DnsQuestion *question_idna,
+                DnsQuestion *question_utf8,
+                DnsQuestion *question_bypass,
+                DnsQuestion *collected_questions,
+                DnsAnswer *answer);
 int manager_monitor_send(Manager *m, DnsQuery *q);
 
 int sendmsg_loop(int fd, struct msghdr *mh, int flags);
 int manager_write(Manager *m, int fd, DnsPacket *p);
 int manager_send(Manager *m, int fd, int ifindex, int family, const union in_addr_union *destination, uint16_t port, const union in_addr_union *source, DnsPacket *p);
 int manager_recv(Manager *m, int fd, DnsProtocol protocol, DnsPacket **ret);
+int manager_recv_many(Manager *m, int fd, DnsProtocol protocol, DnsPacket **pool, DnsPacket **ret, size_t n);
 
 int manager_find_ifindex(Manager *m, int family, const union in_addr_union *in_addr);
 LinkAddress* manager_find_link_address(Manager *m, int family, const union in_addr_union *in_addr);
@@ -492,7 +492,8 @@ static int on_mdns_packet(sd_event_source *s, int fd, uint32_t revents, void *us
                         UINT32_MAX,
                         p->family,
                         &p->sender,
-                        scope->manager->stale_retention_usec);
+                        scope->manager->stale_retention_usec,
+                        scope->manager->cache_entries_max);
 
         } else if (dns_packet_validate_query(p) > 0)  {
                 log_debug("Got mDNS query packet for id %u", DNS_PACKET_ID(p));
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fs-util.h"
+#include "resolved-nss-cache.h"
+#include "string-util.h"
+#include "tmpfile-util.h"
+
+/* Entries are kept no longer than this, even if the TTL is longer. This bounds how long configuration
+ * changes that don't flush the caches take to become visible to nss-resolve users. */
+#define NSS_CACHE_TTL_MAX_USEC (60 * USEC_PER_SEC)
+
+static void nss_cache_retire(ResolveNssCacheHeader *h) {
+        assert(h);
+
+        __atomic_store_n(&h->retired, 1, __ATOMIC_RELEASE);
+}
+
+static void nss_cache_retire_left_over(void) {
+        _cleanup_close_ int fd = -EBADF;
+        void *p;
+
+        /* If we didn't stop cleanly last time, readers might still have the old file mapped. Tell them it
+         * won't be updated anymore, so that they look for the new one. */
+
+        fd = open(RESOLVE_NSS_CACHE_PATH, O_RDWR|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
+        if (fd < 0)
+                return;
+
+        p = mmap(NULL, sizeof(ResolveNssCacheHeader), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+                return;
+
+        nss_cache_retire(p);
+        (void) munmap(p, sizeof(ResolveNssCacheHeader));
+}
+
+int manager_nss_cache_start(Manager *m) {
+        _cleanup_(unlink_and_freep) char *t = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        size_t size = RESOLVE_NSS_CACHE_SIZE(RESOLVE_NSS_CACHE_SLOTS);
+        ResolveNssCacheHeader *h;
+        void *p;
+        int r;
+
+        assert(m);
+
+        if (!m->nss_cache) {
+                manager_nss_cache_stop(m);
+                return 0;
+        }
+
+        if (m->nss_cache_header)
+                return 0;
+
+        nss_cache_retire_left_over();
+
+        fd = open_tmpfile_linkable(RESOLVE_NSS_CACHE_PATH, O_RDWR|O_CLOEXEC, &t);
+        if (fd < 0)
+                return log_warning_errno(fd, "Failed to create %s: %m", RESOLVE_NSS_CACHE_PATH);
+
+        /* nss-resolve readers run with arbitrary credentials, hence the file must be world-readable. That's
+         * fine, since entries can only be found and decrypted by those knowing the name already, see
+         * resolve-nss-cache.h. Readers refuse files that are writable by anyone but us. */
+        if (fchmod(fd, 0644) < 0)
+                return log_warning_errno(errno, "Failed to adjust access mode of %s: %m", RESOLVE_NSS_CACHE_PATH);
+
+        if (ftruncate(fd, size) < 0)
+                return log_warning_errno(errno, "Failed to allocate %s: %m", RESOLVE_NSS_CACHE_PATH);
+
+        p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+                return log_warning_errno(errno, "Failed to map %s: %m", RESOLVE_NSS_CACHE_PATH);
+
+        h = p;
+        memcpy(h->signature, RESOLVE_NSS_CACHE_SIGNATURE, sizeof(h->signature));
+        h->n_slots = RESOLVE_NSS_CACHE_SLOTS;
+        h->generation = 1; /* Unused slots are from generation 0, hence never valid */
+
+        r = link_tmpfile(fd, t, RESOLVE_NSS_CACHE_PATH, LINK_TMPFILE_REPLACE);
+        if (r < 0) {
+                (void) munmap(p, size);
+                return log_warning_errno(r, "Failed to move %s into place: %m", RESOLVE_NSS_CACHE_PATH);
+        }
+
+        t = mfree(t);
+        m->nss_cache_header = h;
+
+        log_debug("Publishing resolved host names in %s.", RESOLVE_NSS_CACHE_PATH);
+        return 1;
+}
+
+void manager_nss_cache_stop(Manager *m) {
+        assert(m);
+
+        if (m->nss_cache_header) {
+                nss_cache_retire(m->nss_cache_header);
+                (void) munmap(m->nss_cache_header, RESOLVE_NSS_CACHE_SIZE(RESOLVE_NSS_CACHE_SLOTS));
+                m->nss_cache_header = NULL;
+        } else
+                nss_cache_retire_left_over();
+
+        if (unlink(RESOLVE_NSS_CACHE_PATH) < 0 && errno != ENOENT)
+                log_debug_errno(errno, "Failed to remove %s, ignoring: %m", RESOLVE_NSS_CACHE_PATH);
+}
+
+void manager_nss_cache_flush(Manager *m) {
+        assert(m);
+
+        if (!m->nss_cache_header)
+                return;
+
+        /* Invalidates all slots at once */
+        __atomic_add_fetch(&m->nss_cache_header->generation, 1, __ATOMIC_RELEASE);
+}
+
+void manager_nss_cache_put(
+                Manager *m,
+                const char *name,
+                const char *canonical,
+                const ResolveNssCacheAddress *addresses,
+                size_t n_addresses,
+                usec_t ttl) {
+
+        _cleanup_free_ char *n = NULL;
+        uint8_t key[SHA256_DIGEST_SIZE];
+        ResolveNssCachePayload payload = {};
+        ResolveNssCacheSlot *slot;
+        uint64_t sequence;
+
+        assert(m);
+        assert(name);
+        assert(canonical);
+        assert(addresses || n_addresses == 0);
+
+        if (!m->nss_cache_header)
+                return;
+
+        if (n_addresses == 0 || n_addresses > RESOLVE_NSS_CACHE_ADDRESSES_MAX || ttl == 0)
+                return;
+
+        if (strlen(canonical) > RESOLVE_NSS_CACHE_NAME_MAX)
+                return;
+
+        if (resolve_nss_cache_normalize_name(name, &n) < 0)
+                return;
+
+        strcpy(payload.name, canonical);
+        payload.n_addresses = n_addresses;
+        memcpy(payload.addresses, addresses, n_addresses * sizeof(ResolveNssCacheAddress));
+
+        resolve_nss_cache_key(n, key);
+        slot = resolve_nss_cache_slot(m->nss_cache_header, key);
+
+        /* We are the only writer, readers make sure they don't use what they copied while the sequence
+         * number was odd, or when it changed in between. Round up to the next even number, so that a slot
+         * that was left odd by an interrupted update doesn't stay unusable forever. */
+        sequence = (slot->sequence | 1) + 1;
+        resolve_nss_cache_crypt(n, sequence, &payload);
+
+        __atomic_store_n(&slot->sequence, sequence - 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        slot->generation = m->nss_cache_header->generation;
+        slot->until = usec_add(now(CLOCK_BOOTTIME), MIN(ttl, NSS_CACHE_TTL_MAX_USEC));
+        memcpy(slot->key, key, sizeof(key));
+        slot->payload = payload;
+
+        __atomic_store_n(&slot->sequence, sequence, __ATOMIC_RELEASE);
+}
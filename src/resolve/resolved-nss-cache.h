@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "resolve-nss-cache.h"
+#include "resolved-manager.h"
+
+int manager_nss_cache_start(Manager *m);
+void manager_nss_cache_stop(Manager *m);
+void manager_nss_cache_flush(Manager *m);
+
+void manager_nss_cache_put(
+                Manager *m,
+                const char *name,
+                const char *canonical,
+                const ResolveNssCacheAddress *addresses,
+                size_t n_addresses,
+                usec_t ttl);
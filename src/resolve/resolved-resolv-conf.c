@@ -184,7 +184,7 @@ int manager_read_resolv_conf(Manager *m) {
          * the network configuration changes, and that should be
          * enough to flush the global unicast DNS cache. */
         if (m->unicast_scope)
-                dns_cache_flush(&m->unicast_scope->cache);
+                dns_scope_flush_cache(m->unicast_scope);
 
         /* If /etc/resolv.conf changed, make sure to forget everything we learned about the DNS servers. After all we
          * might now talk to a very different DNS server that just happens to have the same IP address as an old one
@@ -5,6 +5,7 @@
 #include "in-addr-util.h"
 #include "json-util.h"
 #include "resolved-dns-synthesize.h"
+#include "resolved-nss-cache.h"
 #include "resolved-varlink.h"
 #include "socket-netlink.h"
 #include "varlink-io.systemd.Resolve.h"
@@ -232,6 +233,52 @@ static int find_addr_records(
         return 0;
 }
 
+static void publish_to_nss_cache(DnsQuery *q, DnsQuestion *question, const char *canonical) {
+        ResolveNssCacheAddress addresses[RESOLVE_NSS_CACHE_ADDRESSES_MAX];
+        DnsResourceRecord *rr;
+        size_t n = 0;
+        int ifindex;
+
+        assert(q);
+        assert(q->nss_cache_name);
+        assert(canonical);
+
+        /* Only publish what we'd answer from the cache later on anyway, i.e. positive replies from unicast
+         * DNS, but nothing synthesized, or from local zones or /etc/hosts. */
+        if (q->manager->enable_cache == DNS_CACHE_MODE_NO ||
+            q->answer_protocol != DNS_PROTOCOL_DNS ||
+            FLAGS_SET(q->answer_query_flags, SD_RESOLVED_SYNTHETIC) ||
+            (q->answer_query_flags & SD_RESOLVED_FROM_MASK & ~(SD_RESOLVED_FROM_CACHE|SD_RESOLVED_FROM_NETWORK)) != 0)
+                return;
+
+        DNS_ANSWER_FOREACH_IFINDEX(rr, ifindex, q->answer) {
+                ResolveNssCacheAddress *a;
+
+                if (dns_question_matches_rr(question, rr, DNS_SEARCH_DOMAIN_NAME(q->answer_search_domain)) <= 0)
+                        continue;
+
+                if (n >= ELEMENTSOF(addresses))
+                        return; /* Never publish a partial answer */
+
+                a = addresses + n++;
+                *a = (ResolveNssCacheAddress) {
+                        .ifindex = ifindex,
+                };
+
+                if (rr->key->type == DNS_TYPE_A) {
+                        a->family = AF_INET;
+                        memcpy(a->address, &rr->a.in_addr, sizeof(rr->a.in_addr));
+                } else if (rr->key->type == DNS_TYPE_AAAA) {
+                        a->family = AF_INET6;
+                        memcpy(a->address, &rr->aaaa.in6_addr, sizeof(rr->aaaa.in6_addr));
+                } else
+                        return;
+        }
+
+        manager_nss_cache_put(q->manager, q->nss_cache_name, canonical, addresses, n,
+                              (usec_t) dns_answer_min_ttl(q->answer) * USEC_PER_SEC);
+}
+
 static void vl_method_resolve_hostname_complete(DnsQuery *query) {
         _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *canonical = NULL;
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
@@ -275,6 +322,8 @@ static void vl_method_resolve_hostname_complete(DnsQuery *query) {
                         SD_JSON_BUILD_PAIR("addresses", SD_JSON_BUILD_VARIANT(array)),
                         SD_JSON_BUILD_PAIR("name", SD_JSON_BUILD_STRING(normalized)),
                         SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_INTEGER(dns_query_reply_flags_make(q))));
+        if (r >= 0 && q->nss_cache_name)
+                publish_to_nss_cache(q, question, normalized);
 finish:
         if (r < 0) {
                 log_full_errno(ERRNO_IS_DISCONNECT(r) ? LOG_DEBUG : LOG_ERR, r, "Failed to send hostname reply: %m");
@@ -334,6 +383,7 @@ static int vl_method_resolve_hostname(sd_varlink *link, sd_json_variant *paramet
                 .family = AF_UNSPEC,
         };
         _cleanup_(dns_query_freep) DnsQuery *q = NULL;
+        bool nss_cacheable;
         Manager *m;
         int r;
 
@@ -349,6 +399,10 @@ static int vl_method_resolve_hostname(sd_varlink *link, sd_json_variant *paramet
         if (r != 0)
                 return r;
 
+        /* Plain lookups, as nss-resolve does them for getaddrinfo(), may be answered by nss-resolve itself
+         * next time. */
+        nss_cacheable = m->nss_cache_header && p.ifindex == 0 && p.family == AF_UNSPEC && p.flags == 0;
+
         r = dns_name_is_valid(p.name);
         if (r < 0)
                 return r;
@@ -382,6 +436,12 @@ static int vl_method_resolve_hostname(sd_varlink *link, sd_json_variant *paramet
         q->request_family = p.family;
         q->complete = vl_method_resolve_hostname_complete;
 
+        if (nss_cacheable) {
+                q->nss_cache_name = strdup(p.name);
+                if (!q->nss_cache_name)
+                        return -ENOMEM;
+        }
+
         r = dns_query_go(q);
         if (r < 0)
                 return r;
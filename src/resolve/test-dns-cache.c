@@ -34,6 +34,7 @@ typedef struct PutArgs {
         int owner_family;
         const union in_addr_union owner_address;
         usec_t stale_retention_usec;
+        unsigned cache_entries_max;
 } PutArgs;
 
 static PutArgs mk_put_args(void) {
@@ -49,7 +50,8 @@ static PutArgs mk_put_args(void) {
                 .nsec_ttl = 3600,
                 .owner_family = AF_INET,
                 .owner_address = { .in.s_addr = htobe32(0x01020304) },
-                .stale_retention_usec = 0
+                .stale_retention_usec = 0,
+                .cache_entries_max = DNS_CACHE_ENTRIES_MAX_DEFAULT,
         };
 
         ASSERT_NOT_NULL(put_args.answer);
@@ -72,7 +74,8 @@ static int cache_put(DnsCache *cache, PutArgs *args) {
                 args->nsec_ttl,
                 args->owner_family,
                 &args->owner_address,
-                args->stale_retention_usec);
+                args->stale_retention_usec,
+                args->cache_entries_max);
 }
 
 static void dns_cache_unrefp(DnsCache *cache) {
@@ -927,6 +930,77 @@ TEST(dns_cache_prune) {
         ASSERT_FALSE(dns_cache_expiry_in_one_second(&cache, now(CLOCK_BOOTTIME)));
 }
 
+static void cache_put_a(DnsCache *cache, const char *name, unsigned entries_max) {
+        _cleanup_(put_args_unrefp) PutArgs put_args = mk_put_args();
+
+        put_args.key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, name);
+        ASSERT_NOT_NULL(put_args.key);
+        put_args.cache_entries_max = entries_max;
+        answer_add_a(&put_args, put_args.key, 0xc0a8017f, 3600, DNS_ANSWER_CACHEABLE);
+        ASSERT_OK(cache_put(cache, &put_args));
+}
+
+static int cache_lookup_a(DnsCache *cache, const char *name) {
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+
+        key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, name);
+        ASSERT_NOT_NULL(key);
+        return dns_cache_lookup(cache, key, 0, NULL, NULL, NULL, NULL, NULL);
+}
+
+TEST(dns_cache_evicts_entries_never_hit_first) {
+        _cleanup_(dns_cache_unrefp) DnsCache cache = new_cache();
+
+        cache_put_a(&cache, "a.example.com", 2);
+        cache_put_a(&cache, "b.example.com", 2);
+        ASSERT_EQ(dns_cache_size(&cache), 2u);
+
+        /* "a" is older than "b", but got hit, hence "b" has to go when making space for "c" */
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "a.example.com"));
+
+        cache_put_a(&cache, "c.example.com", 2);
+        ASSERT_EQ(dns_cache_size(&cache), 2u); /* Exactly as many as allowed */
+        ASSERT_EQ(cache.n_evicted, 1u);
+
+        ASSERT_OK_ZERO(cache_lookup_a(&cache, "b.example.com"));
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "a.example.com"));
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "c.example.com"));
+
+        /* The protected segment may only take up part of the cache, hence hitting "c" demoted "a" again,
+         * as the less recently used one */
+        cache_put_a(&cache, "d.example.com", 2);
+        ASSERT_EQ(cache.n_evicted, 2u);
+
+        ASSERT_OK_ZERO(cache_lookup_a(&cache, "a.example.com"));
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "c.example.com"));
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "d.example.com"));
+}
+
+TEST(dns_cache_should_prefetch) {
+        _cleanup_(dns_cache_unrefp) DnsCache cache = new_cache();
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        usec_t t = now(CLOCK_BOOTTIME);
+
+        key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, "www.example.com");
+        ASSERT_NOT_NULL(key);
+
+        cache_put_a(&cache, "www.example.com", DNS_CACHE_ENTRIES_MAX_DEFAULT);
+
+        /* Not popular enough yet */
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "www.example.com"));
+        ASSERT_FALSE(dns_cache_should_prefetch(&cache, key, t + 3590 * USEC_PER_SEC));
+
+        ASSERT_OK_POSITIVE(cache_lookup_a(&cache, "www.example.com"));
+
+        /* Not about to expire yet, or expired already */
+        ASSERT_FALSE(dns_cache_should_prefetch(&cache, key, t));
+        ASSERT_FALSE(dns_cache_should_prefetch(&cache, key, t + 3601 * USEC_PER_SEC));
+
+        /* In the last tenth of the TTL, but only once */
+        ASSERT_TRUE(dns_cache_should_prefetch(&cache, key, t + 3590 * USEC_PER_SEC));
+        ASSERT_FALSE(dns_cache_should_prefetch(&cache, key, t + 3590 * USEC_PER_SEC));
+}
+
 /* ================================================================
  * dns_cache_check_conflicts()
  * ================================================================ */
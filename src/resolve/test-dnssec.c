@@ -529,6 +529,20 @@ TEST(dnssec_verify_rrset) {
         /* Validate the RR as it if was 2015-12-2 today */
         assert_se(dnssec_verify_rrset(answer, a->key, rrsig, dnskey, 1449092754*USEC_PER_SEC, &result) >= 0);
         assert_se(result == DNSSEC_VALIDATED);
+
+        /* The second time around the remembered verification is used */
+        assert_se(dnssec_verify_rrset(answer, a->key, rrsig, dnskey, 1449092754*USEC_PER_SEC, &result) >= 0);
+        assert_se(result == DNSSEC_VALIDATED);
+
+        /* … but only for exactly the same signature, and only while it is valid */
+        assert_se(dnssec_verify_rrset(answer, a->key, rrsig, dnskey, 1459092754*USEC_PER_SEC, &result) >= 0);
+        assert_se(result == DNSSEC_SIGNATURE_EXPIRED);
+
+        ((uint8_t*) rrsig->rrsig.signature)[0] ^= 0x01;
+        assert_se(dnssec_verify_rrset(answer, a->key, rrsig, dnskey, 1449092754*USEC_PER_SEC, &result) >= 0);
+        assert_se(result == DNSSEC_INVALID);
+
+        dnssec_flush_verified_signatures();
 }
 
 TEST(dnssec_verify_rrset2) {
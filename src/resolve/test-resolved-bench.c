@@ -0,0 +1,895 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <getopt.h>
+#include <math.h>
+
+#include "sd-event.h"
+#include "sd-json.h"
+#include "sd-varlink.h"
+
+#include "alloc-util.h"
+#include "dns-domain.h"
+#include "errno-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "format-util.h"
+#include "log.h"
+#include "main-func.h"
+#include "parse-util.h"
+#include "percent-util.h"
+#include "random-util.h"
+#include "resolved-dns-packet.h"
+#include "resolved-dns-rr.h"
+#include "siphash24.h"
+#include "socket-netlink.h"
+#include "socket-util.h"
+#include "sort-util.h"
+#include "string-util.h"
+#include "time-util.h"
+
+/* A load generator for systemd-resolved. It answers queries for names below --domain= as a DNS server itself
+ * (with a configurable latency), and drives resolved at a fixed rate with names drawn from a Zipf
+ * distribution, either via the stub listener or via io.systemd.Resolve. Point resolved at the upstream address
+ * first, e.g. with "resolvectl dns lo 127.0.0.153:5353 && resolvectl domain lo '~bench.test'". */
+
+#define SLOTS_MAX (UINT16_MAX + 1U)
+
+static const char *arg_upstream = "127.0.0.153:5353";
+static const char *arg_stub = "127.0.0.53:53";
+static bool arg_varlink = false;
+static uint64_t arg_qps = 1000;
+static usec_t arg_duration = 10 * USEC_PER_SEC;
+static usec_t arg_timeout = 2 * USEC_PER_SEC;
+static usec_t arg_latency = 0;
+static uint32_t arg_ttl = 300;
+static unsigned arg_names = 10000;
+static double arg_zipf = 1.0;
+static int arg_miss_ratio = 0; /* permyriad */
+static unsigned arg_concurrency = 64;
+static const char *arg_domain = "bench.test";
+
+typedef struct Slot {
+        usec_t sent;
+        bool busy;
+} Slot;
+
+typedef struct Bench {
+        sd_event *event;
+
+        int upstream_fd;
+        int client_fd;
+
+        sd_varlink **links;
+        Slot *link_slots;
+
+        Slot *slots;
+        uint16_t next_id;
+
+        double *cdf;
+        uint64_t n_unique;
+
+        usec_t start;
+        uint64_t n_sent, n_answered, n_failed, n_timeouts, n_dropped;
+        uint64_t n_upstream;
+
+        usec_t *latencies;
+        size_t n_latencies;
+} Bench;
+
+static void bench_done(Bench *b) {
+        assert(b);
+
+        if (b->links)
+                for (unsigned i = 0; i < arg_concurrency; i++)
+                        sd_varlink_close_unref(b->links[i]);
+        free(b->links);
+        free(b->link_slots);
+
+        free(b->slots);
+        free(b->cdf);
+        free(b->latencies);
+
+        safe_close(b->upstream_fd);
+        safe_close(b->client_fd);
+
+        sd_event_unref(b->event);
+}
+
+static int bench_make_cdf(Bench *b) {
+        double sum = 0;
+
+        assert(b);
+
+        b->cdf = new(double, arg_names);
+        if (!b->cdf)
+                return log_oom();
+
+        for (unsigned i = 0; i < arg_names; i++)
+                b->cdf[i] = (sum += 1.0 / pow(i + 1, arg_zipf));
+
+        for (unsigned i = 0; i < arg_names; i++)
+                b->cdf[i] /= sum;
+
+        return 0;
+}
+
+static int bench_pick_name(Bench *b, char **ret) {
+        assert(b);
+        assert(ret);
+
+        /* A share of the queries asks for names never asked before, which no cache can answer */
+        if (arg_miss_ratio > 0 && random_u64_range(10000) < (uint64_t) arg_miss_ratio) {
+                if (asprintf(ret, "miss-%" PRIu64 "-%" PRIx64 ".%s", b->n_unique++, random_u64(), arg_domain) < 0)
+                        return -ENOMEM;
+                return 0;
+        }
+
+        double u = (double) random_u64() / (double) UINT64_MAX;
+        size_t lo = 0, hi = arg_names - 1;
+
+        while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+
+                if (b->cdf[mid] < u)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        if (asprintf(ret, "name-%zu.%s", lo, arg_domain) < 0)
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int bench_record_latency(Bench *b, usec_t sent) {
+        assert(b);
+
+        if (!GREEDY_REALLOC(b->latencies, b->n_latencies + 1))
+                return log_oom();
+
+        b->latencies[b->n_latencies++] = usec_sub_unsigned(now(CLOCK_MONOTONIC), sent);
+        return 0;
+}
+
+typedef struct DelayedReply {
+        sd_event_source *event_source;
+        int fd;
+        union sockaddr_union sa;
+        socklen_t salen;
+        DnsPacket *reply;
+} DelayedReply;
+
+static DelayedReply* delayed_reply_free(DelayedReply *d) {
+        if (!d)
+                return NULL;
+
+        sd_event_source_disable_unref(d->event_source);
+        dns_packet_unref(d->reply);
+        return mfree(d);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(DelayedReply*, delayed_reply_free);
+
+static void delayed_reply_send(DelayedReply *d) {
+        assert(d);
+
+        if (sendto(d->fd, DNS_PACKET_DATA(d->reply), d->reply->size, MSG_DONTWAIT, &d->sa.sa, d->salen) < 0)
+                log_debug_errno(errno, "Failed to send upstream reply, ignoring: %m");
+}
+
+static int on_delayed_reply(sd_event_source *s, uint64_t usec, void *userdata) {
+        DelayedReply *d = ASSERT_PTR(userdata);
+
+        delayed_reply_send(d);
+        delayed_reply_free(d);
+        return 0;
+}
+
+static int upstream_make_reply(DnsPacket *packet, DnsPacket **ret) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *reply = NULL;
+        DnsResourceKey *key;
+        unsigned n_answer = 0;
+        int r;
+
+        assert(packet);
+        assert(ret);
+
+        r = dns_packet_new(&reply, DNS_PROTOCOL_DNS, 0, DNS_PACKET_PAYLOAD_SIZE_MAX(packet));
+        if (r < 0)
+                return r;
+
+        r = dns_packet_append_question(reply, packet->question);
+        if (r < 0)
+                return r;
+
+        /* Every name below our domain exists, with addresses derived from the name */
+        DNS_QUESTION_FOREACH(key, packet->question) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+                const char *name = dns_resource_key_name(key);
+                union in_addr_union a = {};
+                uint64_t h;
+
+                if (dns_name_endswith(name, arg_domain) <= 0)
+                        continue;
+
+                h = siphash24_string(name, (const uint8_t[16]) { 'b', 'e', 'n', 'c', 'h' });
+
+                if (key->type == DNS_TYPE_A) {
+                        a.in.s_addr = htobe32(UINT32_C(0x0a000000) | (h & UINT32_C(0xffffff)));
+                        r = dns_resource_record_new_address(&rr, AF_INET, &a, name);
+                } else if (key->type == DNS_TYPE_AAAA) {
+                        a.in6.s6_addr[0] = 0xfd;
+                        memcpy(a.in6.s6_addr + 8, &h, sizeof(h));
+                        r = dns_resource_record_new_address(&rr, AF_INET6, &a, name);
+                } else
+                        continue;
+                if (r < 0)
+                        return r;
+
+                rr->ttl = arg_ttl;
+
+                r = dns_packet_append_rr(reply, rr, 0, NULL, NULL);
+                if (r < 0)
+                        return r;
+
+                n_answer++;
+        }
+
+        DNS_PACKET_HEADER(reply)->id = DNS_PACKET_ID(packet);
+        DNS_PACKET_HEADER(reply)->qdcount = htobe16(dns_question_size(packet->question));
+        DNS_PACKET_HEADER(reply)->ancount = htobe16(n_answer);
+
+        /* Order: qr, opcode, aa, tc, rd, ra, ad, cd, rcode */
+        DNS_PACKET_HEADER(reply)->flags = htobe16(DNS_PACKET_MAKE_FLAGS(
+                                                1, 0, 1, 0, DNS_PACKET_RD(packet), 1, 0, 0, DNS_RCODE_SUCCESS));
+
+        *ret = TAKE_PTR(reply);
+        return 0;
+}
+
+static int on_upstream_packet(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *packet = NULL;
+        _cleanup_(delayed_reply_freep) DelayedReply *d = NULL;
+        Bench *b = ASSERT_PTR(userdata);
+        ssize_t l;
+        int r;
+
+        r = dns_packet_new(&packet, DNS_PROTOCOL_DNS, DNS_PACKET_SIZE_MAX, DNS_PACKET_SIZE_MAX);
+        if (r < 0)
+                return log_oom();
+
+        d = new0(DelayedReply, 1);
+        if (!d)
+                return log_oom();
+
+        d->fd = fd;
+        d->salen = sizeof(d->sa);
+
+        l = recvfrom(fd, DNS_PACKET_DATA(packet), packet->allocated, MSG_DONTWAIT, &d->sa.sa, &d->salen);
+        if (l < 0) {
+                if (!ERRNO_IS_TRANSIENT(errno))
+                        log_debug_errno(errno, "Failed to receive upstream query, ignoring: %m");
+                return 0;
+        }
+
+        packet->size = (size_t) l;
+
+        if (dns_packet_validate_query(packet) <= 0 || dns_packet_extract(packet) < 0) {
+                log_debug("Received invalid upstream query, ignoring.");
+                return 0;
+        }
+
+        b->n_upstream++;
+
+        r = upstream_make_reply(packet, &d->reply);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to make upstream reply, ignoring: %m");
+                return 0;
+        }
+
+        if (arg_latency == 0) {
+                delayed_reply_send(d);
+                return 0;
+        }
+
+        r = sd_event_add_time_relative(b->event, &d->event_source, CLOCK_MONOTONIC, arg_latency, 1, on_delayed_reply, d);
+        if (r < 0)
+                return log_error_errno(r, "Failed to schedule upstream reply: %m");
+
+        TAKE_PTR(d);
+        return 0;
+}
+
+static int on_stub_packet(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *packet = NULL;
+        Bench *b = ASSERT_PTR(userdata);
+        Slot *slot;
+        ssize_t l;
+        int r;
+
+        r = dns_packet_new(&packet, DNS_PROTOCOL_DNS, DNS_PACKET_SIZE_MAX, DNS_PACKET_SIZE_MAX);
+        if (r < 0)
+                return log_oom();
+
+        l = recv(fd, DNS_PACKET_DATA(packet), packet->allocated, MSG_DONTWAIT);
+        if (l < 0) {
+                if (!ERRNO_IS_TRANSIENT(errno))
+                        log_debug_errno(errno, "Failed to receive stub reply, ignoring: %m");
+                return 0;
+        }
+
+        packet->size = (size_t) l;
+
+        if (dns_packet_validate_reply(packet) <= 0)
+                return 0;
+
+        slot = b->slots + DNS_PACKET_ID(packet);
+        if (!slot->busy)
+                return 0;
+
+        slot->busy = false;
+
+        if (DNS_PACKET_RCODE(packet) == DNS_RCODE_SUCCESS && DNS_PACKET_ANCOUNT(packet) > 0)
+                b->n_answered++;
+        else
+                b->n_failed++;
+
+        return bench_record_latency(b, slot->sent);
+}
+
+static int bench_send_stub(Bench *b, const char *name) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *packet = NULL;
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        usec_t n = now(CLOCK_MONOTONIC);
+        Slot *slot;
+        int r;
+
+        assert(b);
+        assert(name);
+
+        slot = b->slots + b->next_id;
+        if (slot->busy) {
+                if (usec_sub_unsigned(n, slot->sent) < arg_timeout) {
+                        b->n_dropped++;
+                        return 0;
+                }
+
+                b->n_timeouts++;
+        }
+
+        key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, name);
+        if (!key)
+                return log_oom();
+
+        r = dns_packet_new_query(&packet, DNS_PROTOCOL_DNS, 0, /* dnssec_checking_disabled= */ false);
+        if (r < 0)
+                return r;
+
+        r = dns_packet_append_key(packet, key, 0, NULL);
+        if (r < 0)
+                return r;
+
+        DNS_PACKET_HEADER(packet)->id = htobe16(b->next_id);
+        DNS_PACKET_HEADER(packet)->qdcount = htobe16(1);
+
+        if (send(b->client_fd, DNS_PACKET_DATA(packet), packet->size, MSG_DONTWAIT) < 0) {
+                b->n_dropped++;
+                return 0;
+        }
+
+        *slot = (Slot) {
+                .sent = n,
+                .busy = true,
+        };
+
+        b->next_id++;
+        b->n_sent++;
+        return 0;
+}
+
+static int on_varlink_reply(
+                sd_varlink *link,
+                sd_json_variant *parameters,
+                const char *error_id,
+                sd_varlink_reply_flags_t flags,
+                void *userdata) {
+
+        Bench *b = ASSERT_PTR(userdata);
+        Slot *slot = b->link_slots + PTR_TO_UINT(sd_varlink_get_userdata(link));
+
+        if (!slot->busy)
+                return 0;
+
+        slot->busy = false;
+
+        if (error_id)
+                b->n_failed++;
+        else
+                b->n_answered++;
+
+        return bench_record_latency(b, slot->sent);
+}
+
+static int bench_send_varlink(Bench *b, const char *name) {
+        usec_t n = now(CLOCK_MONOTONIC);
+        int r;
+
+        assert(b);
+        assert(name);
+
+        /* Every connection carries one call at a time, hence pick an idle one */
+        for (unsigned i = 0; i < arg_concurrency; i++) {
+                Slot *slot = b->link_slots + i;
+
+                if (slot->busy)
+                        continue;
+
+                r = sd_varlink_invokebo(
+                                b->links[i],
+                                "io.systemd.Resolve.ResolveHostname",
+                                SD_JSON_BUILD_PAIR_STRING("name", name));
+                if (r < 0) {
+                        b->n_dropped++;
+                        return 0;
+                }
+
+                *slot = (Slot) {
+                        .sent = n,
+                        .busy = true,
+                };
+
+                b->n_sent++;
+                return 0;
+        }
+
+        b->n_dropped++;
+        return 0;
+}
+
+static int on_tick(sd_event_source *s, uint64_t usec, void *userdata) {
+        Bench *b = ASSERT_PTR(userdata);
+        usec_t elapsed = usec_sub_unsigned(now(CLOCK_MONOTONIC), b->start);
+        uint64_t due;
+        int r;
+
+        if (elapsed >= arg_duration) {
+                /* Give the last queries a chance to finish, then stop */
+                r = sd_event_source_set_enabled(s, SD_EVENT_OFF);
+                if (r < 0)
+                        return r;
+
+                /* A time event source without callback makes the event loop exit */
+                return sd_event_add_time_relative(b->event, NULL, CLOCK_MONOTONIC, arg_timeout, 0, NULL, INT_TO_PTR(0));
+        }
+
+        due = (uint64_t) ((double) elapsed * arg_qps / USEC_PER_SEC);
+
+        while (b->n_sent + b->n_dropped < due) {
+                _cleanup_free_ char *name = NULL;
+
+                r = bench_pick_name(b, &name);
+                if (r < 0)
+                        return log_oom();
+
+                r = arg_varlink ? bench_send_varlink(b, name) : bench_send_stub(b, name);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_event_source_set_time_relative(s, USEC_PER_MSEC);
+        if (r < 0)
+                return r;
+
+        return sd_event_source_set_enabled(s, SD_EVENT_ONESHOT);
+}
+
+typedef struct Statistics {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t transactions;
+        nsec_t cpu;
+} Statistics;
+
+static int resolved_get_cpu(pid_t pid, nsec_t *ret) {
+        _cleanup_free_ char *line = NULL, *path = NULL;
+        unsigned long utime, stime;
+        const char *p;
+        int r;
+
+        assert(ret);
+
+        if (asprintf(&path, "/proc/" PID_FMT "/stat", pid) < 0)
+                return -ENOMEM;
+
+        r = read_one_line_file(path, &line);
+        if (r < 0)
+                return r;
+
+        p = strrchr(line, ')');
+        if (!p)
+                return -EIO;
+
+        if (sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+                return -EIO;
+
+        *ret = jiffies_to_usec(utime + stime) * NSEC_PER_USEC;
+        return 0;
+}
+
+static int resolved_get_statistics(Statistics *ret) {
+        _cleanup_(sd_varlink_unrefp) sd_varlink *vl = NULL;
+        sd_json_variant *reply = NULL, *cache, *transactions;
+        const char *error_id = NULL;
+        pid_t pid;
+        int r;
+
+        assert(ret);
+
+        r = sd_varlink_connect_address(&vl, "/run/systemd/resolve/io.systemd.Resolve.Monitor");
+        if (r < 0)
+                return log_error_errno(r, "Failed to connect to io.systemd.Resolve.Monitor: %m");
+
+        r = sd_varlink_call(vl, "io.systemd.Resolve.Monitor.DumpStatistics", NULL, &reply, &error_id);
+        if (r < 0)
+                return log_error_errno(r, "Failed to query statistics: %m");
+        if (error_id)
+                return log_error_errno(sd_varlink_error_to_errno(error_id, reply), "Failed to query statistics: %s", error_id);
+
+        cache = sd_json_variant_by_key(reply, "cache");
+        transactions = sd_json_variant_by_key(reply, "transactions");
+
+        *ret = (Statistics) {
+                .hits = sd_json_variant_unsigned(sd_json_variant_by_key(cache, "hits")),
+                .misses = sd_json_variant_unsigned(sd_json_variant_by_key(cache, "misses")),
+                .transactions = sd_json_variant_unsigned(sd_json_variant_by_key(transactions, "totalTransactions")),
+                .cpu = NSEC_INFINITY,
+        };
+
+        r = sd_varlink_get_peer_pid(vl, &pid);
+        if (r < 0)
+                log_warning_errno(r, "Failed to get PID of systemd-resolved, not reporting CPU usage: %m");
+        else {
+                r = resolved_get_cpu(pid, &ret->cpu);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to get CPU usage of systemd-resolved, not reporting it: %m");
+        }
+
+        return 0;
+}
+
+static int usec_compare(const usec_t *a, const usec_t *b) {
+        return CMP(*a, *b);
+}
+
+static usec_t percentile(const usec_t *sorted, size_t n, unsigned permille) {
+        if (n == 0)
+                return USEC_INFINITY;
+
+        return sorted[MIN((size_t) ((uint64_t) n * permille / 1000), n - 1)];
+}
+
+static void bench_report(Bench *b, const Statistics *before, const Statistics *after, usec_t elapsed) {
+        uint64_t hits = after->hits - before->hits, misses = after->misses - before->misses;
+
+        assert(b);
+
+        typesafe_qsort(b->latencies, b->n_latencies, usec_compare);
+
+        /* Queries still in flight when we stopped never got an answer */
+        for (size_t i = 0; i < SLOTS_MAX && b->slots; i++)
+                if (b->slots[i].busy)
+                        b->n_timeouts++;
+        for (size_t i = 0; i < arg_concurrency && b->link_slots; i++)
+                if (b->link_slots[i].busy)
+                        b->n_timeouts++;
+
+        printf("queries:       %" PRIu64 " sent, %" PRIu64 " answered, %" PRIu64 " failed, %" PRIu64 " timed out, %" PRIu64 " dropped\n",
+               b->n_sent, b->n_answered, b->n_failed, b->n_timeouts, b->n_dropped);
+        printf("throughput:    %.1f queries/s\n",
+               (double) (b->n_answered + b->n_failed) * USEC_PER_SEC / MAX(elapsed, 1U));
+        printf("latency:       p50 %s, p99 %s, p999 %s, max %s\n",
+               FORMAT_TIMESPAN(percentile(b->latencies, b->n_latencies, 500), 1),
+               FORMAT_TIMESPAN(percentile(b->latencies, b->n_latencies, 990), 1),
+               FORMAT_TIMESPAN(percentile(b->latencies, b->n_latencies, 999), 1),
+               FORMAT_TIMESPAN(b->n_latencies > 0 ? b->latencies[b->n_latencies - 1] : USEC_INFINITY, 1));
+        printf("upstream:      %" PRIu64 " queries, %" PRIu64 " transactions\n",
+               b->n_upstream, after->transactions - before->transactions);
+
+        if (hits + misses > 0)
+                printf("cache:         %" PRIu64 " hits, %" PRIu64 " misses, %.1f%% hit rate\n",
+                       hits, misses, 100.0 * hits / (hits + misses));
+
+        if (before->cpu != NSEC_INFINITY && after->cpu != NSEC_INFINITY && b->n_sent > 0)
+                printf("resolved CPU:  %s total, %.1fµs per query\n",
+                       FORMAT_TIMESPAN((after->cpu - before->cpu) / NSEC_PER_USEC, 1),
+                       (double) (after->cpu - before->cpu) / NSEC_PER_USEC / b->n_sent);
+}
+
+static int bench_setup_client(Bench *b) {
+        _cleanup_close_ int fd = -EBADF;
+        SocketAddress sa;
+        int r;
+
+        assert(b);
+
+        if (arg_varlink) {
+                b->links = new0(sd_varlink*, arg_concurrency);
+                b->link_slots = new0(Slot, arg_concurrency);
+                if (!b->links || !b->link_slots)
+                        return log_oom();
+
+                for (unsigned i = 0; i < arg_concurrency; i++) {
+                        r = sd_varlink_connect_address(&b->links[i], "/run/systemd/resolve/io.systemd.Resolve");
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to connect to io.systemd.Resolve: %m");
+
+                        (void) sd_varlink_set_userdata(b->links[i], UINT_TO_PTR(i));
+
+                        r = sd_varlink_bind_reply(b->links[i], on_varlink_reply);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to bind reply callback: %m");
+
+                        r = sd_varlink_attach_event(b->links[i], b->event, SD_EVENT_PRIORITY_NORMAL);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to attach varlink connection to event loop: %m");
+                }
+
+                return 0;
+        }
+
+        b->slots = new0(Slot, SLOTS_MAX);
+        if (!b->slots)
+                return log_oom();
+
+        r = socket_address_parse(&sa, arg_stub);
+        if (r < 0)
+                return log_error_errno(r, "Failed to parse stub address '%s': %m", arg_stub);
+
+        fd = socket(socket_address_family(&sa), SOCK_DGRAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0);
+        if (fd < 0)
+                return log_error_errno(errno, "Failed to create client socket: %m");
+
+        (void) fd_increase_rxbuf(fd, 8 * U64_MB);
+
+        if (connect(fd, &sa.sockaddr.sa, sa.size) < 0)
+                return log_error_errno(errno, "Failed to connect to stub listener: %m");
+
+        r = sd_event_add_io(b->event, NULL, fd, EPOLLIN, on_stub_packet, b);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add IO event source: %m");
+
+        b->client_fd = TAKE_FD(fd);
+        b->next_id = random_u64_range(SLOTS_MAX);
+        return 0;
+}
+
+static int bench_setup_upstream(Bench *b) {
+        int r;
+
+        assert(b);
+
+        b->upstream_fd = make_socket_fd(LOG_DEBUG, arg_upstream, SOCK_DGRAM, SOCK_CLOEXEC|SOCK_NONBLOCK);
+        if (b->upstream_fd < 0)
+                return log_error_errno(b->upstream_fd, "Failed to listen on upstream address '%s': %m", arg_upstream);
+
+        (void) fd_increase_rxbuf(b->upstream_fd, 8 * U64_MB);
+
+        r = sd_event_add_io(b->event, NULL, b->upstream_fd, EPOLLIN, on_upstream_packet, b);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add IO event source: %m");
+
+        return 0;
+}
+
+static int help(void) {
+        printf("%s [OPTIONS...]\n\n"
+               "Drive systemd-resolved with synthetic load and report latency and cost.\n\n"
+               "  -h --help               Show this help\n"
+               "     --upstream=ADDR:PORT Address to answer upstream queries on (127.0.0.153:5353)\n"
+               "     --stub=ADDR:PORT     Stub listener to query (127.0.0.53:53)\n"
+               "     --varlink            Query via io.systemd.Resolve instead of the stub listener\n"
+               "     --concurrency=N      Number of Varlink connections (64)\n"
+               "     --qps=N              Queries per second (1000)\n"
+               "     --duration=SEC       How long to generate load (10s)\n"
+               "     --timeout=SEC        How long to wait for replies (2s)\n"
+               "     --names=N            Number of distinct names (10000)\n"
+               "     --zipf=S             Zipf exponent of the name distribution (1.0)\n"
+               "     --miss-ratio=PERCENT Share of queries for names never asked before (0%%)\n"
+               "     --latency=SEC        Delay of upstream replies (0)\n"
+               "     --ttl=SEC            TTL of upstream records (300)\n"
+               "     --domain=DOMAIN      Domain to answer queries below (bench.test)\n",
+               program_invocation_short_name);
+
+        return 0;
+}
+
+static int parse_argv(int argc, char *argv[]) {
+        enum {
+                ARG_UPSTREAM = 0x100,
+                ARG_STUB,
+                ARG_VARLINK,
+                ARG_CONCURRENCY,
+                ARG_QPS,
+                ARG_DURATION,
+                ARG_TIMEOUT,
+                ARG_NAMES,
+                ARG_ZIPF,
+                ARG_MISS_RATIO,
+                ARG_LATENCY,
+                ARG_TTL,
+                ARG_DOMAIN,
+        };
+
+        static const struct option options[] = {
+                { "help",        no_argument,       NULL, 'h'             },
+                { "upstream",    required_argument, NULL, ARG_UPSTREAM    },
+                { "stub",        required_argument, NULL, ARG_STUB        },
+                { "varlink",     no_argument,       NULL, ARG_VARLINK     },
+                { "concurrency", required_argument, NULL, ARG_CONCURRENCY },
+                { "qps",         required_argument, NULL, ARG_QPS         },
+                { "duration",    required_argument, NULL, ARG_DURATION    },
+                { "timeout",     required_argument, NULL, ARG_TIMEOUT     },
+                { "names",       required_argument, NULL, ARG_NAMES       },
+                { "zipf",        required_argument, NULL, ARG_ZIPF        },
+                { "miss-ratio",  required_argument, NULL, ARG_MISS_RATIO  },
+                { "latency",     required_argument, NULL, ARG_LATENCY     },
+                { "ttl",         required_argument, NULL, ARG_TTL         },
+                { "domain",      required_argument, NULL, ARG_DOMAIN      },
+                {}
+        };
+
+        int c, r;
+
+        assert(argc >= 0);
+        assert(argv);
+
+        while ((c = getopt_long(argc, argv, "h", options, NULL)) >= 0)
+                switch (c) {
+
+                case 'h':
+                        return help();
+
+                case ARG_UPSTREAM:
+                        arg_upstream = optarg;
+                        break;
+
+                case ARG_STUB:
+                        arg_stub = optarg;
+                        break;
+
+                case ARG_VARLINK:
+                        arg_varlink = true;
+                        break;
+
+                case ARG_CONCURRENCY:
+                        r = safe_atou(optarg, &arg_concurrency);
+                        if (r < 0 || arg_concurrency == 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(ERANGE), "Invalid concurrency: %s", optarg);
+                        break;
+
+                case ARG_QPS:
+                        r = safe_atou64(optarg, &arg_qps);
+                        if (r < 0 || arg_qps == 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(ERANGE), "Invalid rate: %s", optarg);
+                        break;
+
+                case ARG_DURATION:
+                        r = parse_sec(optarg, &arg_duration);
+                        if (r < 0)
+                                return log_error_errno(r, "Invalid duration: %s", optarg);
+                        break;
+
+                case ARG_TIMEOUT:
+                        r = parse_sec(optarg, &arg_timeout);
+                        if (r < 0)
+                                return log_error_errno(r, "Invalid timeout: %s", optarg);
+                        break;
+
+                case ARG_NAMES:
+                        r = safe_atou(optarg, &arg_names);
+                        if (r < 0 || arg_names == 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(ERANGE), "Invalid number of names: %s", optarg);
+                        break;
+
+                case ARG_ZIPF:
+                        r = safe_atod(optarg, &arg_zipf);
+                        if (r < 0 || arg_zipf < 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(ERANGE), "Invalid Zipf exponent: %s", optarg);
+                        break;
+
+                case ARG_MISS_RATIO:
+                        arg_miss_ratio = parse_permyriad(optarg);
+                        if (arg_miss_ratio < 0)
+                                return log_error_errno(arg_miss_ratio, "Invalid miss ratio: %s", optarg);
+                        break;
+
+                case ARG_LATENCY:
+                        r = parse_sec(optarg, &arg_latency);
+                        if (r < 0)
+                                return log_error_errno(r, "Invalid latency: %s", optarg);
+                        break;
+
+                case ARG_TTL:
+                        r = safe_atou32(optarg, &arg_ttl);
+                        if (r < 0)
+                                return log_error_errno(r, "Invalid TTL: %s", optarg);
+                        break;
+
+                case ARG_DOMAIN:
+                        arg_domain = optarg;
+                        break;
+
+                case '?':
+                        return -EINVAL;
+
+                default:
+                        assert_not_reached();
+                }
+
+        if (optind < argc)
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "This program takes no arguments.");
+
+        return 1;
+}
+
+static int run(int argc, char *argv[]) {
+        _cleanup_(bench_done) Bench b = {
+                .upstream_fd = -EBADF,
+                .client_fd = -EBADF,
+        };
+        Statistics before, after;
+        usec_t elapsed;
+        int r;
+
+        log_setup();
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                return r;
+
+        r = sd_event_default(&b.event);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate event: %m");
+
+        r = sd_event_set_signal_exit(b.event, true);
+        if (r < 0)
+                return log_error_errno(r, "Failed to install SIGINT/SIGTERM handlers: %m");
+
+        r = bench_make_cdf(&b);
+        if (r < 0)
+                return r;
+
+        r = bench_setup_upstream(&b);
+        if (r < 0)
+                return r;
+
+        r = bench_setup_client(&b);
+        if (r < 0)
+                return r;
+
+        r = resolved_get_statistics(&before);
+        if (r < 0)
+                return r;
+
+        b.start = now(CLOCK_MONOTONIC);
+
+        r = sd_event_add_time_relative(b.event, NULL, CLOCK_MONOTONIC, 0, 0, on_tick, &b);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add timer event source: %m");
+
+        r = sd_event_loop(b.event);
+        if (r < 0)
+                return log_error_errno(r, "Failed to run event loop: %m");
+
+        elapsed = usec_sub_unsigned(now(CLOCK_MONOTONIC), b.start);
+
+        r = resolved_get_statistics(&after);
+        if (r < 0)
+                return r;
+
+        bench_report(&b, &before, &after, MIN(elapsed, arg_duration));
+        return 0;
+}
+
+DEFINE_MAIN_FUNCTION(run);
@@ -0,0 +1,268 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "alloc-util.h"
+#include "resolved-manager.h"
+#include "resolved-nss-cache.h"
+#include "tests.h"
+#include "time-util.h"
+
+#define CACHE_SIZE RESOLVE_NSS_CACHE_SIZE(RESOLVE_NSS_CACHE_SLOTS)
+
+static ResolveNssCacheHeader* header_new(void) {
+        ResolveNssCacheHeader *h;
+
+        /* Set up the same way as manager_nss_cache_start() does it, just in anonymous memory */
+        h = malloc0(CACHE_SIZE);
+        if (!h)
+                return NULL;
+
+        memcpy(h->signature, RESOLVE_NSS_CACHE_SIGNATURE, sizeof(h->signature));
+        h->n_slots = RESOLVE_NSS_CACHE_SLOTS;
+        h->generation = 1;
+
+        return h;
+}
+
+static ResolveNssCacheSlot* slot_of(ResolveNssCacheHeader *h, const char *name) {
+        _cleanup_free_ char *n = NULL;
+        uint8_t key[SHA256_DIGEST_SIZE];
+
+        ASSERT_OK(resolve_nss_cache_normalize_name(name, &n));
+        resolve_nss_cache_key(n, key);
+
+        return resolve_nss_cache_slot(h, key);
+}
+
+static ResolveNssCacheAddress address_ipv4(uint8_t last) {
+        return (ResolveNssCacheAddress) {
+                .ifindex = 1,
+                .family = AF_INET,
+                .address = { 192, 0, 2, last },
+        };
+}
+
+TEST(header_verify) {
+        _cleanup_free_ ResolveNssCacheHeader *h = NULL;
+
+        ASSERT_NOT_NULL(h = header_new());
+        ASSERT_OK_ZERO(resolve_nss_cache_header_verify(h, CACHE_SIZE));
+
+        /* Truncated or extended files are refused */
+        ASSERT_ERROR(resolve_nss_cache_header_verify(h, CACHE_SIZE - 1), EBADMSG);
+        ASSERT_ERROR(resolve_nss_cache_header_verify(h, CACHE_SIZE + sizeof(ResolveNssCacheSlot)), EBADMSG);
+        ASSERT_ERROR(resolve_nss_cache_header_verify(NULL, 0), EBADMSG);
+
+        h->n_slots = RESOLVE_NSS_CACHE_SLOTS / 2;
+        ASSERT_ERROR(resolve_nss_cache_header_verify(h, CACHE_SIZE), EBADMSG);
+        h->n_slots = 0;
+        ASSERT_ERROR(resolve_nss_cache_header_verify(h, CACHE_SIZE), EBADMSG);
+        h->n_slots = RESOLVE_NSS_CACHE_SLOTS;
+
+        h->signature[7] = '0';
+        ASSERT_ERROR(resolve_nss_cache_header_verify(h, CACHE_SIZE), EBADMSG);
+        memcpy(h->signature, RESOLVE_NSS_CACHE_SIGNATURE, sizeof(h->signature));
+
+        /* A file the writer gave up on is well-formed, but shouldn't be used anymore */
+        h->retired = 1;
+        ASSERT_ERROR(resolve_nss_cache_header_verify(h, CACHE_SIZE), ESTALE);
+        h->retired = 0;
+
+        ASSERT_OK_ZERO(resolve_nss_cache_header_verify(h, CACHE_SIZE));
+}
+
+TEST(put_lookup) {
+        _cleanup_free_ ResolveNssCacheHeader *h = NULL;
+        ResolveNssCacheAddress addresses[] = { address_ipv4(1), address_ipv4(2) };
+        ResolveNssCachePayload payload;
+        Manager m = {};
+
+        ASSERT_NOT_NULL(h = header_new());
+        m.nss_cache_header = h;
+
+        /* Nothing in there yet: unused slots are from generation 0 */
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), ENOENT);
+
+        manager_nss_cache_put(&m, "Example.COM.", "example.com", addresses, ELEMENTSOF(addresses), 10 * USEC_PER_SEC);
+
+        /* Names are matched case-insensitively, and with or without the trailing dot */
+        ASSERT_OK(resolve_nss_cache_lookup_in(h, "example.com", &payload));
+        ASSERT_STREQ(payload.name, "example.com");
+        ASSERT_EQ(payload.n_addresses, 2u);
+        ASSERT_EQ(memcmp(payload.addresses, addresses, sizeof(addresses)), 0);
+        ASSERT_OK(resolve_nss_cache_lookup_in(h, "EXAMPLE.com.", &payload));
+
+        /* The payload is not stored in the clear */
+        ASSERT_NULL(memmem(slot_of(h, "example.com"), sizeof(ResolveNssCacheSlot), "example.com", STRLEN("example.com")));
+
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.org", &payload), ENOENT);
+
+        /* Entries that can't be represented are not stored at all */
+        manager_nss_cache_put(&m, "empty.example.com", "empty.example.com", addresses, 0, 10 * USEC_PER_SEC);
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "empty.example.com", &payload), ENOENT);
+        manager_nss_cache_put(&m, "nottl.example.com", "nottl.example.com", addresses, 1, 0);
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "nottl.example.com", &payload), ENOENT);
+}
+
+TEST(stale_entries) {
+        _cleanup_free_ ResolveNssCacheHeader *h = NULL;
+        ResolveNssCacheAddress address = address_ipv4(1);
+        ResolveNssCachePayload payload;
+        Manager m = {};
+
+        ASSERT_NOT_NULL(h = header_new());
+        m.nss_cache_header = h;
+
+        /* Flushing bumps the generation, which invalidates everything written before */
+        manager_nss_cache_put(&m, "example.com", "example.com", &address, 1, 10 * USEC_PER_SEC);
+        ASSERT_OK(resolve_nss_cache_lookup_in(h, "example.com", &payload));
+        manager_nss_cache_flush(&m);
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), ENOENT);
+
+        /* Writing the entry again makes it valid for the new generation */
+        manager_nss_cache_put(&m, "example.com", "example.com", &address, 1, 10 * USEC_PER_SEC);
+        ASSERT_OK(resolve_nss_cache_lookup_in(h, "example.com", &payload));
+
+        /* Expired entries are not used */
+        slot_of(h, "example.com")->until = now(CLOCK_BOOTTIME) - 1;
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), ESTALE);
+}
+
+TEST(writer_interrupted) {
+        _cleanup_free_ ResolveNssCacheHeader *h = NULL;
+        ResolveNssCacheAddress address = address_ipv4(1);
+        ResolveNssCachePayload payload;
+        ResolveNssCacheSlot *slot;
+        Manager m = {};
+
+        ASSERT_NOT_NULL(h = header_new());
+        m.nss_cache_header = h;
+
+        manager_nss_cache_put(&m, "example.com", "example.com", &address, 1, 10 * USEC_PER_SEC);
+        slot = slot_of(h, "example.com");
+        ASSERT_EQ(slot->sequence & 1, 0u);
+
+        /* A writer that died in the middle of an update leaves the sequence number odd. Readers must not
+         * use the slot then, whatever it contains otherwise. */
+        slot->sequence++;
+        slot->payload.addresses[0].address[3] ^= 0xff;
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), EBUSY);
+
+        /* The next update of the slot makes it usable again */
+        manager_nss_cache_put(&m, "example.com", "example.com", &address, 1, 10 * USEC_PER_SEC);
+        ASSERT_EQ(slot->sequence & 1, 0u);
+        ASSERT_OK(resolve_nss_cache_lookup_in(h, "example.com", &payload));
+        ASSERT_EQ(memcmp(&payload.addresses[0], &address, sizeof(address)), 0);
+}
+
+TEST(corrupted_slots) {
+        _cleanup_free_ ResolveNssCacheHeader *h = NULL;
+        ResolveNssCacheAddress address = address_ipv4(1);
+        ResolveNssCachePayload payload;
+        ResolveNssCacheSlot *slot;
+        Manager m = {};
+
+        ASSERT_NOT_NULL(h = header_new());
+        m.nss_cache_header = h;
+
+        manager_nss_cache_put(&m, "example.com", "example.com", &address, 1, 10 * USEC_PER_SEC);
+        slot = slot_of(h, "example.com");
+
+        /* A payload that doesn't decrypt to something sensible is refused */
+        ((uint8_t*) &slot->payload.n_addresses)[sizeof(slot->payload.n_addresses) - 1] ^= 0x80;
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), EBADMSG);
+        ((uint8_t*) &slot->payload.n_addresses)[sizeof(slot->payload.n_addresses) - 1] ^= 0x80;
+        ASSERT_OK(resolve_nss_cache_lookup_in(h, "example.com", &payload));
+
+        slot->payload.addresses[0].family ^= AF_INET ^ AF_UNIX;
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), EBADMSG);
+        slot->payload.addresses[0].family ^= AF_INET ^ AF_UNIX;
+
+        /* The key stream depends on the sequence number, a payload from another version doesn't decrypt */
+        slot->sequence += 2;
+        ASSERT_ERROR(resolve_nss_cache_lookup_in(h, "example.com", &payload), EBADMSG);
+}
+
+typedef struct TornReadContext {
+        ResolveNssCacheHeader *header;
+        ResolveNssCacheAddress a[2][RESOLVE_NSS_CACHE_ADDRESSES_MAX];
+        bool done;
+        unsigned n_hits;
+} TornReadContext;
+
+static void* torn_read_writer(void *userdata) {
+        TornReadContext *c = ASSERT_PTR(userdata);
+        Manager m = {
+                .nss_cache_header = c->header,
+        };
+
+        for (unsigned i = 0; i < 20000; i++) {
+                if (i % 2 == 0)
+                        manager_nss_cache_put(&m, "example.com", "example.com",
+                                              c->a[0], 1, 10 * USEC_PER_SEC);
+                else
+                        manager_nss_cache_put(&m, "example.com", "canonical.example.com",
+                                              c->a[1], RESOLVE_NSS_CACHE_ADDRESSES_MAX, 10 * USEC_PER_SEC);
+        }
+
+        __atomic_store_n(&c->done, true, __ATOMIC_RELEASE);
+        return NULL;
+}
+
+static void* torn_read_reader(void *userdata) {
+        TornReadContext *c = ASSERT_PTR(userdata);
+        unsigned n_hits = 0;
+
+        while (!__atomic_load_n(&c->done, __ATOMIC_ACQUIRE)) {
+                ResolveNssCachePayload payload;
+                int r;
+
+                r = resolve_nss_cache_lookup_in(c->header, "example.com", &payload);
+                if (IN_SET(r, -EBUSY, -ENOENT))
+                        continue;
+                ASSERT_OK(r);
+
+                /* Whatever we got must be exactly one of the two versions the writer alternates between */
+                if (streq(payload.name, "example.com")) {
+                        ASSERT_EQ(payload.n_addresses, 1u);
+                        ASSERT_EQ(memcmp(payload.addresses, c->a[0], sizeof(ResolveNssCacheAddress)), 0);
+                } else {
+                        ASSERT_STREQ(payload.name, "canonical.example.com");
+                        ASSERT_EQ(payload.n_addresses, (uint64_t) RESOLVE_NSS_CACHE_ADDRESSES_MAX);
+                        ASSERT_EQ(memcmp(payload.addresses, c->a[1], sizeof(c->a[1])), 0);
+                }
+
+                n_hits++;
+        }
+
+        __atomic_add_fetch(&c->n_hits, n_hits, __ATOMIC_RELAXED);
+        return NULL;
+}
+
+TEST(torn_reads) {
+        _cleanup_free_ ResolveNssCacheHeader *h = NULL;
+        TornReadContext c = {};
+        pthread_t writer, readers[2];
+
+        ASSERT_NOT_NULL(h = header_new());
+        c.header = h;
+
+        for (unsigned i = 0; i < RESOLVE_NSS_CACHE_ADDRESSES_MAX; i++) {
+                c.a[0][i] = address_ipv4(1);
+                c.a[1][i] = address_ipv4(100 + i);
+        }
+
+        FOREACH_ELEMENT(t, readers)
+                ASSERT_OK_ZERO(pthread_create(t, NULL, torn_read_reader, &c));
+        ASSERT_OK_ZERO(pthread_create(&writer, NULL, torn_read_writer, &c));
+
+        ASSERT_OK_ZERO(pthread_join(writer, NULL));
+        FOREACH_ELEMENT(t, readers)
+                ASSERT_OK_ZERO(pthread_join(*t, NULL));
+
+        log_info("Readers got %u consistent entries while the writer was updating the slot.", c.n_hits);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "resolved-dns-answer.h"
+#include "resolved-dns-packet.h"
+#include "resolved-dns-query.h"
+#include "resolved-dns-rr.h"
+#include "resolved-dns-stub.h"
+#include "resolved-manager.h"
+#include "tests.h"
+#include "time-util.h"
+
+static DnsPacket* make_request(uint16_t id, const char *name) {
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        DnsPacket *p;
+
+        key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, name);
+        ASSERT_NOT_NULL(key);
+
+        ASSERT_OK(dns_packet_new_query(&p, DNS_PROTOCOL_DNS, 0, /* dnssec_checking_disabled= */ false));
+        DNS_PACKET_HEADER(p)->id = htobe16(id);
+        ASSERT_OK(dns_packet_append_key(p, key, 0, NULL));
+        DNS_PACKET_HEADER(p)->qdcount = htobe16(1);
+
+        return p;
+}
+
+static DnsPacket* make_reply(DnsPacket *request, DnsResourceRecord *rr) {
+        DnsPacket *p;
+
+        ASSERT_OK(dns_packet_new(&p, DNS_PROTOCOL_DNS, 0, DNS_PACKET_SIZE_MAX));
+        DNS_PACKET_HEADER(p)->id = DNS_PACKET_HEADER(request)->id;
+        DNS_PACKET_HEADER(p)->flags = htobe16(DNS_PACKET_MAKE_FLAGS(1, 0, 0, 0, 1, 1, 0, 0, DNS_RCODE_SUCCESS));
+        ASSERT_OK(dns_packet_append_key(p, rr->key, 0, NULL));
+        ASSERT_OK(dns_packet_append_rr(p, rr, 0, NULL, NULL));
+        DNS_PACKET_HEADER(p)->qdcount = htobe16(1);
+        DNS_PACKET_HEADER(p)->ancount = htobe16(1);
+
+        return p;
+}
+
+static void put_reply(Manager *m, const char *name, uint32_t ttl, uint16_t id) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+        _cleanup_(dns_question_unrefp) DnsQuestion *question = NULL;
+        _cleanup_(dns_packet_unrefp) DnsPacket *reply = NULL;
+        _cleanup_(dns_query_freep) DnsQuery *q = NULL;
+        union in_addr_union a = { .in.s_addr = htobe32(0x7f000002) };
+
+        ASSERT_OK(dns_resource_record_new_address(&rr, AF_INET, &a, name));
+        rr->ttl = ttl;
+
+        ASSERT_OK(dns_question_new_address(&question, AF_INET, name, /* convert_idna= */ false));
+        ASSERT_OK(dns_query_new(m, &q, question, question, NULL, AF_INET, 0));
+
+        q->request_packet = make_request(id, name);
+        q->state = DNS_TRANSACTION_SUCCESS;
+        ASSERT_OK(dns_answer_add_extend(&q->reply_answer, rr, 0, 0, NULL));
+        q->answer = dns_answer_ref(q->reply_answer);
+
+        reply = make_reply(q->request_packet, rr);
+        ASSERT_OK(dns_stub_reply_put(q, reply));
+}
+
+TEST(stub_reply_hit) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *request = NULL, *reply = NULL;
+        Manager m = {};
+
+        put_reply(&m, "www.example.com", 60, 4711);
+        ASSERT_EQ(set_size(m.dns_stub_replies), 1u);
+
+        /* Same question, different ID and case: a hit, with ID and question name echoed back */
+        request = make_request(815, "WWW.Example.COM");
+        ASSERT_OK_POSITIVE(dns_stub_reply_get(&m, NULL, request, &reply));
+        ASSERT_EQ(DNS_PACKET_ID(reply), 815u);
+        ASSERT_EQ(DNS_PACKET_ANCOUNT(reply), 1u);
+        ASSERT_EQ(memcmp(DNS_PACKET_DATA(reply) + DNS_PACKET_HEADER_SIZE,
+                         DNS_PACKET_DATA(request) + DNS_PACKET_HEADER_SIZE,
+                         request->size - DNS_PACKET_HEADER_SIZE), 0);
+        ASSERT_EQ(m.n_stub_reply_hit, 1u);
+
+        /* Requests received on an extra listener don't get replies meant for the main one */
+        DnsStubListenerExtra extra = { .manager = &m };
+        reply = dns_packet_unref(reply);
+        ASSERT_OK_ZERO(dns_stub_reply_get(&m, &extra, request, &reply));
+        ASSERT_NULL(reply);
+
+        /* Neither do other questions */
+        request = dns_packet_unref(request);
+        request = make_request(815, "www.example.net");
+        ASSERT_OK_ZERO(dns_stub_reply_get(&m, NULL, request, &reply));
+        ASSERT_EQ(m.n_stub_reply_hit, 1u);
+
+        dns_stub_flush_replies(&m);
+}
+
+TEST(stub_reply_expiry) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *request = NULL, *reply = NULL;
+        Manager m = {};
+
+        put_reply(&m, "www.example.com", 1, 1);
+        request = make_request(2, "www.example.com");
+
+        ASSERT_OK_POSITIVE(dns_stub_reply_get(&m, NULL, request, &reply));
+        reply = dns_packet_unref(reply);
+
+        /* Once the TTL passed, the entry is dropped on the next lookup */
+        usleep_safe(USEC_PER_SEC + 100 * USEC_PER_MSEC);
+        ASSERT_OK_ZERO(dns_stub_reply_get(&m, NULL, request, &reply));
+        ASSERT_NULL(reply);
+        ASSERT_TRUE(set_isempty(m.dns_stub_replies));
+        ASSERT_EQ(m.n_stub_reply_hit, 1u);
+
+        dns_stub_flush_replies(&m);
+}
+
+TEST(stub_reply_flush) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *request = NULL, *reply = NULL;
+        Manager m = {};
+
+        put_reply(&m, "www.example.com", 60, 1);
+        put_reply(&m, "www.example.org", 60, 2);
+        ASSERT_EQ(set_size(m.dns_stub_replies), 2u);
+
+        dns_stub_flush_replies(&m);
+        ASSERT_TRUE(set_isempty(m.dns_stub_replies));
+
+        request = make_request(3, "www.example.com");
+        ASSERT_OK_ZERO(dns_stub_reply_get(&m, NULL, request, &reply));
+        ASSERT_NULL(reply);
+
+        /* And it's usable again afterwards */
+        put_reply(&m, "www.example.com", 60, 1);
+        ASSERT_OK_POSITIVE(dns_stub_reply_get(&m, NULL, request, &reply));
+        ASSERT_EQ(DNS_PACKET_ID(reply), 3u);
+
+        dns_stub_flush_replies(&m);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
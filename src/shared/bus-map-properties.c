@@ -246,3 +246,127 @@ int bus_map_all_properties(
 
         return r;
 }
+
+typedef struct PipelinedCall {
+        sd_bus_slot *slot;
+        sd_bus_message *reply;
+} PipelinedCall;
+
+static int pipelined_call_reply(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        PipelinedCall *c = ASSERT_PTR(userdata);
+
+        assert(m);
+
+        c->reply = sd_bus_message_ref(m);
+        return 1;
+}
+
+static void pipelined_call_done_many(PipelinedCall *calls, size_t n) {
+        FOREACH_ARRAY(c, calls, n) {
+                sd_bus_slot_unref(c->slot);
+                sd_bus_message_unref(c->reply);
+        }
+
+        free(calls);
+}
+
+int bus_get_all_properties_pipelined(
+                sd_bus *bus,
+                const char *destination,
+                char * const *paths,
+                size_t n_paths,
+                size_t max_outstanding,
+                bus_get_all_properties_handler_t handler,
+                void *userdata) {
+
+        PipelinedCall *calls = NULL;
+        size_t n_calls = 0, n_issued = 0;
+        uint64_t timeout;
+        int r;
+
+        CLEANUP_ARRAY(calls, n_calls, pipelined_call_done_many);
+
+        assert(bus);
+        assert(destination);
+        assert(paths || n_paths == 0);
+        assert(max_outstanding > 0);
+        assert(handler);
+
+        /* Retrieves all properties of many objects, keeping up to max_outstanding GetAll() calls in flight
+         * instead of waiting for each reply before sending the next call. The handler is invoked for each
+         * object in the order of the paths array, with either the reply or the error the call failed
+         * with.
+         *
+         * The handler may take arbitrarily long, e.g. when it writes to a pager nobody reads from. Hence
+         * the calls themselves don't time out, as they would do while queued behind the one being handled.
+         * Instead, the usual method call timeout applies to each wait for the reply we need next. */
+
+        r = sd_bus_get_method_call_timeout(bus, &timeout);
+        if (r < 0)
+                return r;
+
+        calls = new0(PipelinedCall, n_paths);
+        if (!calls)
+                return -ENOMEM;
+        n_calls = n_paths;
+
+        for (size_t i = 0; i < n_paths; i++) {
+                PipelinedCall *c = calls + i;
+
+                usec_t deadline;
+
+                for (; n_issued < n_paths && n_issued < i + max_outstanding; n_issued++) {
+                        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                        r = sd_bus_message_new_method_call(
+                                        bus,
+                                        &m,
+                                        destination,
+                                        paths[n_issued],
+                                        "org.freedesktop.DBus.Properties",
+                                        "GetAll");
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_append(m, "s", "");
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_call_async(bus, &calls[n_issued].slot, m, pipelined_call_reply, calls + n_issued, USEC_INFINITY);
+                        if (r < 0)
+                                return r;
+                }
+
+                deadline = usec_add(now(CLOCK_MONOTONIC), timeout);
+
+                while (!c->reply) {
+                        usec_t n;
+
+                        r = sd_bus_process(bus, NULL);
+                        if (r < 0)
+                                return r;
+                        if (r > 0)
+                                continue;
+
+                        n = now(CLOCK_MONOTONIC);
+                        if (n >= deadline)
+                                return -ETIMEDOUT;
+
+                        r = sd_bus_wait(bus, deadline - n);
+                        if (r < 0)
+                                return r;
+                }
+
+                if (sd_bus_message_is_method_error(c->reply, NULL))
+                        r = handler(NULL, -sd_bus_message_get_errno(c->reply), sd_bus_message_get_error(c->reply), i, userdata);
+                else
+                        r = handler(c->reply, 0, NULL, i, userdata);
+                if (r < 0)
+                        return r;
+
+                c->slot = sd_bus_slot_unref(c->slot);
+                c->reply = sd_bus_message_unref(c->reply);
+        }
+
+        return 0;
+}
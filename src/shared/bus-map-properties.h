@@ -24,3 +24,8 @@ int bus_map_job_id(sd_bus *bus, const char *member, sd_bus_message *m, sd_bus_er
 int bus_message_map_all_properties(sd_bus_message *m, const struct bus_properties_map *map, unsigned flags, sd_bus_error *error, void *userdata);
 int bus_map_all_properties(sd_bus *bus, const char *destination, const char *path, const struct bus_properties_map *map,
                            unsigned flags, sd_bus_error *error, sd_bus_message **reply, void *userdata);
+
+typedef int (*bus_get_all_properties_handler_t)(sd_bus_message *reply, int error, const sd_bus_error *bus_error, size_t idx, void *userdata);
+
+int bus_get_all_properties_pipelined(sd_bus *bus, const char *destination, char * const *paths, size_t n_paths,
+                                     size_t max_outstanding, bus_get_all_properties_handler_t handler, void *userdata);
@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/btrfs.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,12 +17,15 @@
 #include "btrfs-util.h"
 #include "chattr-util.h"
 #include "copy.h"
+#include "cpu-set-util.h"
 #include "dirent-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
 #include "io-util.h"
+#include "list.h"
 #include "macro.h"
+#include "memory-util.h"
 #include "missing_fs.h"
 #include "missing_syscall.h"
 #include "mkdir-label.h"
@@ -44,6 +48,9 @@
 /* If we copy via a userspace buffer, size it to 64K */
 #define COPY_BUFFER_SIZE (64U*U64_KB)
 
+/* With COPY_SPARSE, look for all-zero runs at this granularity, which matches the common file system block size */
+#define SPARSE_BLOCK_SIZE (4U*U64_KB)
+
 /* If a byte progress function is specified during copying, never try to copy more than 1M, so that we can
  * reasonably call the progress function still */
 #define PROGRESS_STEP_SIZE (1U*U64_MB)
@@ -53,6 +60,12 @@
  * case of bind mount cycles and suchlike. */
 #define COPY_DEPTH_MAX 2048U
 
+/* With COPY_PARALLEL, copy the contents of regular files with up to this many threads */
+#define COPY_THREADS_MAX 8U
+
+/* Don't queue more than this many regular files for the copy threads, as each one keeps three fds open */
+#define COPY_QUEUE_MAX 64U
+
 static ssize_t try_copy_file_range(
                 int fd_in, loff_t *off_in,
                 int fd_out, loff_t *off_out,
@@ -157,6 +170,33 @@ static int create_hole(int fd, off_t size) {
         return 0;
 }
 
+static size_t sparse_run(const uint8_t *p, size_t n, bool *ret_zero) {
+        size_t l;
+        bool zero;
+
+        assert(p);
+        assert(n > 0);
+        assert(ret_zero);
+
+        /* Returns the length of the leading run of SPARSE_BLOCK_SIZE blocks in the buffer that are either
+         * all zero or all not zero, and which of the two it is. */
+
+        l = MIN(n, SPARSE_BLOCK_SIZE);
+        zero = memeqzero(p, l);
+
+        while (l < n) {
+                size_t b = MIN(n - l, SPARSE_BLOCK_SIZE);
+
+                if (memeqzero(p + l, b) != zero)
+                        break;
+
+                l += b;
+        }
+
+        *ret_zero = zero;
+        return l;
+}
+
 int copy_bytes_full(
                 int fdf, int fdt,
                 uint64_t max_bytes,
@@ -189,6 +229,10 @@ int copy_bytes_full(
         if (ret_remains_size)
                 *ret_remains_size = 0;
 
+        /* Zero detection needs to look at the data, hence skip the in-kernel copy paths. */
+        if (FLAGS_SET(copy_flags, COPY_SPARSE))
+                try_cfr = try_sendfile = try_splice = false;
+
         fdf = fd_reopen_condition(fdf, O_CLOEXEC | O_NOCTTY | O_RDONLY, O_PATH, &fdf_opened);
         if (fdf < 0)
                 return fdf;
@@ -475,7 +519,24 @@ int copy_bytes_full(
                         do {
                                 ssize_t k;
 
-                                k = write(fdt, p, z);
+                                if (FLAGS_SET(copy_flags, COPY_SPARSE)) {
+                                        bool zero;
+                                        size_t l;
+
+                                        l = sparse_run(p, z, &zero);
+                                        if (zero) {
+                                                r = create_hole(fdt, l);
+                                                if (r < 0)
+                                                        return r;
+
+                                                z -= l;
+                                                p += l;
+                                                continue;
+                                        }
+
+                                        k = write(fdt, p, l);
+                                } else
+                                        k = write(fdt, p, z);
                                 if (k < 0) {
                                         r = -errno;
 
@@ -796,6 +857,8 @@ static int prepare_nocow(int fdf, const char *from, int fdt, unsigned *chattr_ma
         return 0;
 }
 
+typedef struct CopyPool CopyPool;
+
 static int fd_copy_tree_generic(
                 int df,
                 const char *from,
@@ -810,55 +873,32 @@ static int fd_copy_tree_generic(
                 Hashmap *denylist,
                 Set *subvolumes,
                 HardlinkContext *hardlink_context,
+                CopyPool *pool,
                 const char *display_path,
                 copy_progress_path_t progress_path,
                 copy_progress_bytes_t progress_bytes,
                 void *userdata);
 
-static int fd_copy_regular(
-                int df,
-                const char *from,
+static int fd_copy_regular_contents(
+                int fdf,
+                int fdt_consumed,
                 const struct stat *st,
                 int dt,
                 const char *to,
                 uid_t override_uid,
                 gid_t override_gid,
                 CopyFlags copy_flags,
-                HardlinkContext *hardlink_context,
                 copy_progress_bytes_t progress,
                 void *userdata) {
 
-        _cleanup_close_ int fdf = -EBADF, fdt = -EBADF;
+        _cleanup_close_ int fdt = fdt_consumed;
         int r, q;
 
+        assert(fdf >= 0);
+        assert(fdt >= 0);
         assert(st);
         assert(to);
 
-        r = try_hardlink(hardlink_context, st, dt, to);
-        if (r < 0)
-                return r;
-        if (r > 0) /* worked! */
-                return 0;
-
-        fdf = xopenat(df, from, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
-        if (fdf < 0)
-                return fdf;
-
-        if (copy_flags & COPY_MAC_CREATE) {
-                r = mac_selinux_create_file_prepare_at(dt, to, S_IFREG);
-                if (r < 0)
-                        return r;
-        }
-        fdt = openat(dt, to, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, st->st_mode & 07777);
-        if (copy_flags & COPY_MAC_CREATE)
-                mac_selinux_create_file_clear();
-        if (fdt < 0)
-                return -errno;
-
-        r = prepare_nocow(fdf, /*from=*/ NULL, fdt, /*chattr_mask=*/ NULL, /*chattr_flags=*/ NULL);
-        if (r < 0)
-                return r;
-
         r = copy_bytes_full(fdf, fdt, UINT64_MAX, copy_flags, NULL, NULL, progress, userdata);
         if (r < 0)
                 goto fail;
@@ -893,7 +933,6 @@ static int fd_copy_regular(
                 goto fail;
         }
 
-        (void) memorize_hardlink(hardlink_context, st, dt, to);
         return r;
 
 fail:
@@ -901,6 +940,374 @@ fail:
         return r;
 }
 
+/* A regular file whose contents are still to be copied by one of the worker threads of a CopyPool */
+typedef struct CopyJob {
+        int fdf;
+        int fdt;
+        int dt;     /* Our own copy of the fd of the target directory, so that we can remove the file on failure */
+        char *to;
+        struct stat st;
+        uid_t override_uid;
+        gid_t override_gid;
+
+        LIST_FIELDS(struct CopyJob, jobs);
+} CopyJob;
+
+/* With COPY_PARALLEL the calling thread still walks the source tree and creates all inodes in the target
+ * tree, in order, but the contents of regular files (along with their ownership, access mode, timestamps and
+ * xattrs, all of which have to be applied after the data is written) are copied by a number of worker
+ * threads. None of that changes the timestamps of the containing directories, hence those can be restored
+ * by the calling thread as soon as it is done with a directory. */
+struct CopyPool {
+        pthread_mutex_t mutex;
+        pthread_cond_t queued;   /* Signalled when a job is added to the queue, or when we shut down */
+        pthread_cond_t finished; /* Signalled when a job is done */
+
+        LIST_HEAD(CopyJob, queue);
+        size_t n_jobs;           /* Both queued and currently running jobs */
+        bool shutdown;
+        bool cancelled;          /* Don't copy anything anymore, just remove the files still queued */
+        int error;
+
+        CopyFlags copy_flags;
+
+        pthread_mutex_t progress_mutex;
+        copy_progress_bytes_t progress;
+        void *userdata;
+
+        pthread_t threads[COPY_THREADS_MAX];
+        size_t n_threads;
+};
+
+static CopyJob* copy_job_free(CopyJob *j) {
+        if (!j)
+                return NULL;
+
+        safe_close(j->fdf);
+        safe_close(j->fdt);
+        safe_close(j->dt);
+        free(j->to);
+        return mfree(j);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(CopyJob*, copy_job_free);
+
+static int copy_pool_progress(uint64_t n_bytes, void *userdata) {
+        CopyPool *pool = ASSERT_PTR(userdata);
+        int r;
+
+        /* The progress callbacks have no idea about threads, hence make sure they are never called
+         * concurrently */
+
+        assert_se(pthread_mutex_lock(&pool->progress_mutex) == 0);
+        r = pool->progress(n_bytes, pool->userdata);
+        assert_se(pthread_mutex_unlock(&pool->progress_mutex) == 0);
+
+        return r;
+}
+
+static int copy_job_run(CopyPool *pool, CopyJob *j) {
+        assert(pool);
+        assert(j);
+
+        return fd_copy_regular_contents(
+                        j->fdf, TAKE_FD(j->fdt),
+                        &j->st,
+                        j->dt, j->to,
+                        j->override_uid, j->override_gid,
+                        pool->copy_flags,
+                        pool->progress ? copy_pool_progress : NULL,
+                        pool);
+}
+
+static void* copy_pool_thread(void *userdata) {
+        CopyPool *pool = ASSERT_PTR(userdata);
+
+        (void) pthread_setname_np(pthread_self(), "copy-worker");
+
+        assert_se(pthread_mutex_lock(&pool->mutex) == 0);
+
+        for (;;) {
+                _cleanup_(copy_job_freep) CopyJob *j = NULL;
+                int r;
+
+                while (!pool->queue && !pool->shutdown)
+                        assert_se(pthread_cond_wait(&pool->queued, &pool->mutex) == 0);
+
+                j = LIST_POP(jobs, pool->queue);
+                if (!j) /* Shutting down, and nothing left to do */
+                        break;
+
+                if (pool->cancelled) {
+                        (void) unlinkat(j->dt, j->to, 0);
+                        r = 0;
+                } else {
+                        assert_se(pthread_mutex_unlock(&pool->mutex) == 0);
+                        r = copy_job_run(pool, j);
+                        assert_se(pthread_mutex_lock(&pool->mutex) == 0);
+                }
+
+                if (r == -EINTR) {
+                        /* Propagate SIGINT/SIGTERM instantly, and stop copying */
+                        pool->error = r;
+                        pool->cancelled = true;
+                } else if (r < 0 && pool->error >= 0)
+                        pool->error = r;
+
+                j = copy_job_free(j);
+
+                assert(pool->n_jobs > 0);
+                pool->n_jobs--;
+                assert_se(pthread_cond_signal(&pool->finished) == 0);
+        }
+
+        assert_se(pthread_mutex_unlock(&pool->mutex) == 0);
+        return NULL;
+}
+
+static int copy_pool_finish(CopyPool *pool) {
+        int r;
+
+        if (!pool)
+                return 0;
+
+        assert_se(pthread_mutex_lock(&pool->mutex) == 0);
+        pool->shutdown = true;
+        assert_se(pthread_cond_broadcast(&pool->queued) == 0);
+        assert_se(pthread_mutex_unlock(&pool->mutex) == 0);
+
+        FOREACH_ARRAY(t, pool->threads, pool->n_threads)
+                assert_se(pthread_join(*t, NULL) == 0);
+        pool->n_threads = 0;
+
+        assert(!pool->queue);
+        assert(pool->n_jobs == 0);
+
+        r = pool->error;
+        pool->error = 0;
+        return r;
+}
+
+static CopyPool* copy_pool_free(CopyPool *pool) {
+        if (!pool)
+                return NULL;
+
+        /* If we get here without copy_pool_finish() having been called, we failed half-way, hence don't
+         * bother copying the rest. */
+        if (pool->n_threads > 0) {
+                assert_se(pthread_mutex_lock(&pool->mutex) == 0);
+                pool->cancelled = true;
+                assert_se(pthread_mutex_unlock(&pool->mutex) == 0);
+
+                (void) copy_pool_finish(pool);
+        }
+
+        assert_se(pthread_cond_destroy(&pool->queued) == 0);
+        assert_se(pthread_cond_destroy(&pool->finished) == 0);
+        assert_se(pthread_mutex_destroy(&pool->mutex) == 0);
+        assert_se(pthread_mutex_destroy(&pool->progress_mutex) == 0);
+
+        return mfree(pool);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(CopyPool*, copy_pool_free);
+
+static int copy_pool_new(CopyFlags copy_flags, copy_progress_bytes_t progress, void *userdata, CopyPool **ret) {
+        _cleanup_(copy_pool_freep) CopyPool *pool = NULL;
+        sigset_t ss, saved_ss;
+        size_t n;
+        int r, k;
+
+        assert(ret);
+
+        if (!FLAGS_SET(copy_flags, COPY_PARALLEL)) {
+                *ret = NULL;
+                return 0;
+        }
+
+        r = cpus_in_affinity_mask();
+        if (r < 0)
+                log_debug_errno(r, "Failed to determine number of CPUs, copying with a single thread: %m");
+        n = r > 0 ? MIN((size_t) r, COPY_THREADS_MAX) : 1;
+        if (n <= 1) {
+                *ret = NULL;
+                return 0;
+        }
+
+        pool = new(CopyPool, 1);
+        if (!pool)
+                return -ENOMEM;
+
+        *pool = (CopyPool) {
+                .mutex = PTHREAD_MUTEX_INITIALIZER,
+                .queued = PTHREAD_COND_INITIALIZER,
+                .finished = PTHREAD_COND_INITIALIZER,
+                .progress_mutex = PTHREAD_MUTEX_INITIALIZER,
+                .copy_flags = copy_flags & ~(COPY_PARALLEL|COPY_LOCK_BSD),
+                .progress = progress,
+                .userdata = userdata,
+        };
+
+        /* Block all signals in the worker threads, so that they are handled by the calling thread, or
+         * picked up by look_for_signals() */
+        assert_se(sigfillset(&ss) >= 0);
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        for (; pool->n_threads < n; pool->n_threads++) {
+                r = pthread_create(pool->threads + pool->n_threads, NULL, copy_pool_thread, pool);
+                if (r > 0)
+                        break;
+        }
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0)
+                return -r;
+        if (k > 0)
+                return -k;
+
+        log_debug("Copying file contents with %zu threads.", pool->n_threads);
+
+        *ret = TAKE_PTR(pool);
+        return 1;
+}
+
+static int copy_pool_submit(
+                CopyPool *pool,
+                int fdf_consumed,
+                int fdt_consumed,
+                const struct stat *st,
+                int dt,
+                const char *to,
+                uid_t override_uid,
+                gid_t override_gid) {
+
+        _cleanup_close_ int fdf = fdf_consumed, fdt = fdt_consumed, dt_copy = -EBADF;
+        _cleanup_(copy_job_freep) CopyJob *j = NULL;
+        _cleanup_free_ char *t = NULL;
+        int r;
+
+        assert(pool);
+        assert(fdf >= 0);
+        assert(fdt >= 0);
+        assert(st);
+        assert(dt >= 0 || dt == AT_FDCWD);
+        assert(to);
+
+        if (dt == AT_FDCWD)
+                dt_copy = AT_FDCWD;
+        else {
+                dt_copy = fcntl(dt, F_DUPFD_CLOEXEC, 3);
+                if (dt_copy < 0)
+                        return -errno;
+        }
+
+        t = strdup(to);
+        if (!t)
+                return -ENOMEM;
+
+        j = new(CopyJob, 1);
+        if (!j)
+                return -ENOMEM;
+
+        *j = (CopyJob) {
+                .fdf = TAKE_FD(fdf),
+                .fdt = TAKE_FD(fdt),
+                .dt = TAKE_FD(dt_copy),
+                .to = TAKE_PTR(t),
+                .st = *st,
+                .override_uid = override_uid,
+                .override_gid = override_gid,
+        };
+
+        assert_se(pthread_mutex_lock(&pool->mutex) == 0);
+
+        /* Every queued file pins three fds, hence don't let the queue grow without bounds */
+        while (pool->n_jobs >= COPY_QUEUE_MAX && !pool->cancelled)
+                assert_se(pthread_cond_wait(&pool->finished, &pool->mutex) == 0);
+
+        if (pool->cancelled)
+                r = pool->error < 0 ? pool->error : -ECANCELED;
+        else {
+                LIST_PREPEND(jobs, pool->queue, TAKE_PTR(j));
+                pool->n_jobs++;
+                assert_se(pthread_cond_signal(&pool->queued) == 0);
+                r = 0;
+        }
+
+        assert_se(pthread_mutex_unlock(&pool->mutex) == 0);
+
+        if (r < 0 && j)
+                (void) unlinkat(j->dt, j->to, 0);
+
+        return r;
+}
+
+static int fd_copy_regular(
+                int df,
+                const char *from,
+                const struct stat *st,
+                int dt,
+                const char *to,
+                uid_t override_uid,
+                gid_t override_gid,
+                CopyFlags copy_flags,
+                HardlinkContext *hardlink_context,
+                CopyPool *pool,
+                copy_progress_bytes_t progress,
+                void *userdata) {
+
+        _cleanup_close_ int fdf = -EBADF, fdt = -EBADF;
+        int r;
+
+        assert(st);
+        assert(to);
+
+        r = try_hardlink(hardlink_context, st, dt, to);
+        if (r < 0)
+                return r;
+        if (r > 0) /* worked! */
+                return 0;
+
+        fdf = xopenat(df, from, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
+        if (fdf < 0)
+                return fdf;
+
+        if (copy_flags & COPY_MAC_CREATE) {
+                r = mac_selinux_create_file_prepare_at(dt, to, S_IFREG);
+                if (r < 0)
+                        return r;
+        }
+        fdt = openat(dt, to, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, st->st_mode & 07777);
+        if (copy_flags & COPY_MAC_CREATE)
+                mac_selinux_create_file_clear();
+        if (fdt < 0)
+                return -errno;
+
+        r = prepare_nocow(fdf, /*from=*/ NULL, fdt, /*chattr_mask=*/ NULL, /*chattr_flags=*/ NULL);
+        if (r < 0)
+                return r;
+
+        if (pool) {
+                r = copy_pool_submit(pool, TAKE_FD(fdf), TAKE_FD(fdt), st, dt, to, override_uid, override_gid);
+                if (r < 0)
+                        return r;
+        } else {
+                r = fd_copy_regular_contents(fdf, TAKE_FD(fdt), st, dt, to, override_uid, override_gid,
+                                             copy_flags, progress, userdata);
+                if (r < 0)
+                        return r;
+        }
+
+        /* The contents might not have been copied yet, but the inode exists, which is all we need for
+         * linking to it */
+        (void) memorize_hardlink(hardlink_context, st, dt, to);
+        return 0;
+}
+
 static int fd_copy_fifo(
                 int df,
                 const char *from,
@@ -1021,6 +1428,7 @@ static int fd_copy_directory(
                 Hashmap *denylist,
                 Set *subvolumes,
                 HardlinkContext *hardlink_context,
+                CopyPool *pool,
                 const char *display_path,
                 copy_progress_path_t progress_path,
                 copy_progress_bytes_t progress_bytes,
@@ -1157,7 +1565,7 @@ static int fd_copy_directory(
 
                 q = fd_copy_tree_generic(dirfd(d), de->d_name, &buf, fdt, de->d_name, original_device,
                                          depth_left-1, override_uid, override_gid, copy_flags & ~COPY_LOCK_BSD,
-                                         denylist, subvolumes, hardlink_context, child_display_path, progress_path,
+                                         denylist, subvolumes, hardlink_context, pool, child_display_path, progress_path,
                                          progress_bytes, userdata);
 
                 if (q == -EINTR) /* Propagate SIGINT/SIGTERM up instantly */
@@ -1205,13 +1613,14 @@ static int fd_copy_leaf(
                 gid_t override_gid,
                 CopyFlags copy_flags,
                 HardlinkContext *hardlink_context,
+                CopyPool *pool,
                 const char *display_path,
                 copy_progress_bytes_t progress_bytes,
                 void *userdata) {
         int r;
 
         if (S_ISREG(st->st_mode))
-                r = fd_copy_regular(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, progress_bytes, userdata);
+                r = fd_copy_regular(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, pool, progress_bytes, userdata);
         else if (S_ISLNK(st->st_mode))
                 r = fd_copy_symlink(df, from, st, dt, to, override_uid, override_gid, copy_flags);
         else if (S_ISFIFO(st->st_mode))
@@ -1238,6 +1647,7 @@ static int fd_copy_tree_generic(
                 Hashmap *denylist,
                 Set *subvolumes,
                 HardlinkContext *hardlink_context,
+                CopyPool *pool,
                 const char *display_path,
                 copy_progress_path_t progress_path,
                 copy_progress_bytes_t progress_bytes,
@@ -1250,7 +1660,7 @@ static int fd_copy_tree_generic(
         if (S_ISDIR(st->st_mode))
                 return fd_copy_directory(df, from, st, dt, to, original_device, depth_left-1, override_uid,
                                          override_gid, copy_flags, denylist, subvolumes, hardlink_context,
-                                         display_path, progress_path, progress_bytes, userdata);
+                                         pool, display_path, progress_path, progress_bytes, userdata);
 
         DenyType t = PTR_TO_INT(hashmap_get(denylist, st));
         if (t == DENY_INODE) {
@@ -1259,14 +1669,14 @@ static int fd_copy_tree_generic(
         } else if (t == DENY_CONTENTS)
                 log_debug("%s is configured to have its contents excluded, but is not a directory", from ?: "file to copy");
 
-        r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, display_path, progress_bytes, userdata);
+        r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, pool, display_path, progress_bytes, userdata);
         /* We just tried to copy a leaf node of the tree. If it failed because the node already exists *and* the COPY_REPLACE flag has been provided, we should unlink the node and re-copy. */
         if (r == -EEXIST && (copy_flags & COPY_REPLACE)) {
                 /* This codepath is us trying to address an error to copy, if the unlink fails, lets just return the original error. */
                 if (unlinkat(dt, to, 0) < 0)
                         return r;
 
-                r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, display_path, progress_bytes, userdata);
+                r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, pool, display_path, progress_bytes, userdata);
         }
 
         return r;
@@ -1286,6 +1696,7 @@ int copy_tree_at_full(
                 copy_progress_bytes_t progress_bytes,
                 void *userdata) {
 
+        _cleanup_(copy_pool_freep) CopyPool *pool = NULL;
         struct stat st;
         int r;
 
@@ -1295,12 +1706,22 @@ int copy_tree_at_full(
         if (fstatat(fdf, strempty(from), &st, AT_SYMLINK_NOFOLLOW | (isempty(from) ? AT_EMPTY_PATH : 0)) < 0)
                 return -errno;
 
+        if (S_ISDIR(st.st_mode)) {
+                r = copy_pool_new(copy_flags, progress_bytes, userdata, &pool);
+                if (r < 0)
+                        return r;
+        }
+
         r = fd_copy_tree_generic(fdf, from, &st, fdt, to, st.st_dev, COPY_DEPTH_MAX, override_uid,
-                                 override_gid, copy_flags, denylist, subvolumes, NULL, NULL, progress_path,
+                                 override_gid, copy_flags, denylist, subvolumes, NULL, pool, NULL, progress_path,
                                  progress_bytes, userdata);
         if (r < 0)
                 return r;
 
+        r = copy_pool_finish(pool);
+        if (r < 0)
+                return r;
+
         if (S_ISDIR(st.st_mode) && (copy_flags & COPY_SYNCFS)) {
                 /* If the top-level inode is a directory run syncfs() now. */
                 r = syncfs_path(fdt, to);
@@ -1342,6 +1763,7 @@ int copy_directory_at_full(
                 copy_progress_bytes_t progress_bytes,
                 void *userdata) {
 
+        _cleanup_(copy_pool_freep) CopyPool *pool = NULL;
         _cleanup_close_ int fdt = -EBADF;
         struct stat st;
         int r;
@@ -1357,6 +1779,10 @@ int copy_directory_at_full(
         if (r < 0)
                 return r;
 
+        r = copy_pool_new(copy_flags, progress_bytes, userdata, &pool);
+        if (r < 0)
+                return r;
+
         r = fd_copy_directory(
                         dir_fdf, from,
                         &st,
@@ -1365,7 +1791,7 @@ int copy_directory_at_full(
                         COPY_DEPTH_MAX,
                         UID_INVALID, GID_INVALID,
                         copy_flags,
-                        NULL, NULL, NULL, NULL,
+                        NULL, NULL, NULL, pool, NULL,
                         progress_path,
                         progress_bytes,
                         userdata);
@@ -1375,6 +1801,10 @@ int copy_directory_at_full(
         if (FLAGS_SET(copy_flags, COPY_LOCK_BSD))
                 fdt = r;
 
+        r = copy_pool_finish(pool);
+        if (r < 0)
+                return r;
+
         r = sync_dir_by_flags(dir_fdt, to, copy_flags);
         if (r < 0)
                 return r;
@@ -40,6 +40,8 @@ typedef enum CopyFlags {
          * copy because reflinking from COW to NOCOW files is not supported.
          */
         COPY_NOCOW_AFTER                  = 1 << 20,
+        COPY_SPARSE                       = 1 << 21, /* Turn all-zero blocks read from the source into holes in the target */
+        COPY_PARALLEL                     = 1 << 22, /* Copy the contents of regular files in a tree with multiple threads */
 } CopyFlags;
 
 typedef enum DenyType {
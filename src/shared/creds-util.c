@@ -1179,11 +1179,12 @@ int encrypt_credential_and_warn(
         return 0;
 }
 
-int decrypt_credential_and_warn(
+int decrypt_credential_and_warn_full(
                 const char *validate_name,
                 usec_t validate_timestamp,
                 const char *tpm2_device,
                 const char *tpm2_signature_path,
+                Tpm2Context **tpm2_context,
                 uid_t uid,
                 const struct iovec *input,
                 CredentialFlags flags,
@@ -1333,14 +1334,23 @@ int decrypt_credential_and_warn(
                                     le32toh(z->size));
                 }
 
-                _cleanup_(tpm2_context_unrefp) Tpm2Context *tpm2_context = NULL;
-                r = tpm2_context_new(tpm2_device, &tpm2_context);
-                if (r < 0)
-                        return r;
+                /* Reuse the caller's TPM2 context if there is one, so that decrypting a series of
+                 * credentials doesn't open the TPM and query its capabilities again for each of them. */
+                _cleanup_(tpm2_context_unrefp) Tpm2Context *c = NULL;
+                if (tpm2_context && *tpm2_context)
+                        c = tpm2_context_ref(*tpm2_context);
+                else {
+                        r = tpm2_context_new(tpm2_device, &c);
+                        if (r < 0)
+                                return r;
+
+                        if (tpm2_context)
+                                *tpm2_context = tpm2_context_ref(c);
+                }
 
                  // TODO: Add the SRK data to the credential structure so it can be plumbed
                  // through and used to verify the TPM session.
-                r = tpm2_unseal(tpm2_context,
+                r = tpm2_unseal(c,
                                 le64toh(t->pcr_mask),
                                 le16toh(t->pcr_bank),
                                 z ? &IOVEC_MAKE(z->data, le32toh(z->size)) : NULL,
@@ -1530,7 +1540,7 @@ int encrypt_credential_and_warn(sd_id128_t with_key, const char *name, usec_t ti
         return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP), "Support for encrypted credentials not available.");
 }
 
-int decrypt_credential_and_warn(const char *validate_name, usec_t validate_timestamp, const char *tpm2_device, const char *tpm2_signature_path, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret) {
+int decrypt_credential_and_warn_full(const char *validate_name, usec_t validate_timestamp, const char *tpm2_device, const char *tpm2_signature_path, Tpm2Context **tpm2_context, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret) {
         return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP), "Support for encrypted credentials not available.");
 }
 
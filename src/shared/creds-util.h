@@ -9,6 +9,7 @@
 
 #include "fd-util.h"
 #include "time-util.h"
+#include "tpm2-util.h"
 
 #define CREDENTIAL_NAME_MAX FDNAME_MAX
 
@@ -89,7 +90,10 @@ typedef enum CredentialFlags {
 #define _CRED_AUTO_SCOPED                     SD_ID128_MAKE(23,88,96,85,6f,74,48,8a,9c,78,6f,6a,b0,e7,3b,6a)
 
 int encrypt_credential_and_warn(sd_id128_t with_key, const char *name, usec_t timestamp, usec_t not_after, const char *tpm2_device, uint32_t tpm2_hash_pcr_mask, const char *tpm2_pubkey_path, uint32_t tpm2_pubkey_pcr_mask, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret);
-int decrypt_credential_and_warn(const char *validate_name, usec_t validate_timestamp, const char *tpm2_device, const char *tpm2_signature_path, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret);
+int decrypt_credential_and_warn_full(const char *validate_name, usec_t validate_timestamp, const char *tpm2_device, const char *tpm2_signature_path, Tpm2Context **tpm2_context, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret);
+static inline int decrypt_credential_and_warn(const char *validate_name, usec_t validate_timestamp, const char *tpm2_device, const char *tpm2_signature_path, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret) {
+        return decrypt_credential_and_warn_full(validate_name, validate_timestamp, tpm2_device, tpm2_signature_path, /* tpm2_context= */ NULL, uid, input, flags, ret);
+}
 
 int ipc_encrypt_credential(const char *name, usec_t timestamp, usec_t not_after, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret);
 int ipc_decrypt_credential(const char *validate_name, usec_t validate_timestamp, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret);
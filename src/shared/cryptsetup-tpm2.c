@@ -60,6 +60,7 @@ static int get_pin(
 int acquire_tpm2_key(
                 const char *volume_name,
                 const char *device,
+                Tpm2Context **tpm2_context,
                 uint32_t hash_pcr_mask,
                 uint16_t pcr_bank,
                 const struct iovec *pubkey,
@@ -143,13 +144,23 @@ int acquire_tpm2_key(
                 }
         }
 
-        _cleanup_(tpm2_context_unrefp) Tpm2Context *tpm2_context = NULL;
-        r = tpm2_context_new_or_warn(device, &tpm2_context);
-        if (r < 0)
-                return r;
+        /* If the caller passes in a context from an earlier call, reuse it: opening the TPM and querying
+         * its capabilities takes a number of round trips, which adds up on slow firmware TPMs when we
+         * iterate through multiple tokens. */
+        _cleanup_(tpm2_context_unrefp) Tpm2Context *c = NULL;
+        if (tpm2_context && *tpm2_context)
+                c = tpm2_context_ref(*tpm2_context);
+        else {
+                r = tpm2_context_new_or_warn(device, &c);
+                if (r < 0)
+                        return r;
+
+                if (tpm2_context)
+                        *tpm2_context = tpm2_context_ref(c);
+        }
 
         if (!(flags & TPM2_FLAGS_USE_PIN)) {
-                r = tpm2_unseal(tpm2_context,
+                r = tpm2_unseal(c,
                                 hash_pcr_mask,
                                 pcr_bank,
                                 pubkey,
@@ -197,7 +208,7 @@ int acquire_tpm2_key(
                         /* no salting needed, backwards compat with non-salted pins */
                         b64_salted_pin = TAKE_PTR(pin_str);
 
-                r = tpm2_unseal(tpm2_context,
+                r = tpm2_unseal(c,
                                 hash_pcr_mask,
                                 pcr_bank,
                                 pubkey,
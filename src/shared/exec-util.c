@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <sys/prctl.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <stdio.h>
 
@@ -34,6 +35,63 @@
 
 #define EXIT_SKIP_REMAINING 77
 
+/* Executables taking longer than this are logged at warning level, so that they can be found easily */
+#define EXEC_RUNTIME_WARN_USEC (5 * USEC_PER_SEC)
+
+typedef struct ExecChild {
+        char *path;
+        usec_t start_usec;
+} ExecChild;
+
+static ExecChild* exec_child_free(ExecChild *c) {
+        if (!c)
+                return NULL;
+
+        free(c->path);
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ExecChild*, exec_child_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(exec_child_hash_ops, void, trivial_hash_func, trivial_compare_func, ExecChild, exec_child_free);
+
+static void log_exec_runtime(const char *path, usec_t start_usec) {
+        usec_t t;
+
+        assert(path);
+
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
+        log_full(t >= EXEC_RUNTIME_WARN_USEC ? LOG_WARNING : LOG_DEBUG,
+                 "%s finished after %s.", path, FORMAT_TIMESPAN(t, USEC_PER_MSEC));
+}
+
+static int wait_for_any_child(Hashmap *pids, ExecChild **ret) {
+        siginfo_t si = {};
+
+        assert(pids);
+        assert(ret);
+
+        /* We are running in our own helper process, hence all our children are the executables we spawned.
+         * Wait for whichever finishes first without reaping it, so that wait_for_terminate_and_check() can
+         * do that and evaluate the exit status as usual. */
+
+        for (;;) {
+                if (waitid(P_ALL, 0, &si, WEXITED|WNOWAIT) < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        return -errno;
+                }
+
+                ExecChild *c = hashmap_remove(pids, PID_TO_PTR(si.si_pid));
+                if (!c)
+                        return -ECHILD;
+
+                *ret = c;
+                return si.si_pid;
+        }
+}
+
 /* Put this test here for a lack of better place */
 assert_cc(EAGAIN == EWOULDBLOCK);
 
@@ -99,7 +157,7 @@ static int do_execute(
                 char *envp[],
                 ExecDirFlags flags) {
 
-        _cleanup_hashmap_free_free_ Hashmap *pids = NULL;
+        _cleanup_hashmap_free_ Hashmap *pids = NULL;
         bool parallel_execution;
         int r;
 
@@ -115,7 +173,7 @@ static int do_execute(
         parallel_execution = FLAGS_SET(flags, EXEC_DIR_PARALLEL) && !callbacks;
 
         if (parallel_execution) {
-                pids = hashmap_new(NULL);
+                pids = hashmap_new(&exec_child_hash_ops);
                 if (!pids)
                         return log_oom();
         }
@@ -133,6 +191,7 @@ static int do_execute(
         STRV_FOREACH(path, paths) {
                 _cleanup_free_ char *t = NULL;
                 _cleanup_close_ int fd = -EBADF;
+                usec_t start_usec;
                 pid_t pid;
 
                 t = path_join(root, *path);
@@ -171,21 +230,36 @@ static int do_execute(
                                             "permission bits. Proceeding anyway.", t);
                 }
 
+                start_usec = now(CLOCK_MONOTONIC);
+
                 r = do_spawn(t, argv, fd, FLAGS_SET(flags, EXEC_DIR_SET_SYSTEMD_EXEC_PID), &pid);
                 if (r <= 0)
                         continue;
 
                 if (parallel_execution) {
-                        r = hashmap_put(pids, PID_TO_PTR(pid), t);
+                        _cleanup_(exec_child_freep) ExecChild *c = NULL;
+
+                        c = new(ExecChild, 1);
+                        if (!c)
+                                return log_oom();
+
+                        *c = (ExecChild) {
+                                .path = TAKE_PTR(t),
+                                .start_usec = start_usec,
+                        };
+
+                        r = hashmap_put(pids, PID_TO_PTR(pid), c);
                         if (r < 0)
                                 return log_oom();
-                        t = NULL;
+                        TAKE_PTR(c);
                 } else {
                         bool skip_remaining = false;
 
                         r = wait_for_terminate_and_check(t, pid, WAIT_LOG_ABNORMAL);
                         if (r < 0)
                                 return r;
+
+                        log_exec_runtime(t, start_usec);
                         if (r > 0) {
                                 if (FLAGS_SET(flags, EXEC_DIR_SKIP_REMAINING) && r == EXIT_SKIP_REMAINING) {
                                         log_info("%s succeeded with exit status %i, not executing remaining executables.", *path, r);
@@ -219,18 +293,21 @@ static int do_execute(
                         return log_error_errno(r, "Callback two failed: %m");
         }
 
+        /* Collect the children in the order they finish, so that we know how long each of them took */
         while (!hashmap_isempty(pids)) {
-                _cleanup_free_ char *t = NULL;
+                _cleanup_(exec_child_freep) ExecChild *c = NULL;
                 pid_t pid;
-                void *p;
 
-                t = ASSERT_PTR(hashmap_steal_first_key_and_value(pids, &p));
-                pid = PTR_TO_PID(p);
-                assert(pid > 0);
+                r = wait_for_any_child(pids, &c);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to wait for child processes: %m");
+                pid = r;
 
-                r = wait_for_terminate_and_check(t, pid, WAIT_LOG);
+                r = wait_for_terminate_and_check(c->path, pid, WAIT_LOG);
                 if (r < 0)
                         return r;
+
+                log_exec_runtime(c->path, c->start_usec);
                 if (!FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS) && r > 0)
                         return r;
         }
@@ -76,16 +76,31 @@ static int trie_children_cmp(const struct trie_child_entry *a, const struct trie
 }
 
 static int node_add_child(struct trie *trie, struct trie_node *node, struct trie_node *node_child, uint8_t c) {
-        /* extend array, add new entry, sort for bisection */
+        size_t left = 0, right;
+
+        /* extend array, add new entry at its place, keeping the array sorted for bisection */
         if (!GREEDY_REALLOC(node->children, node->children_count + 1))
                 return -ENOMEM;
 
-        trie->children_count++;
-        node->children[node->children_count++] = (struct trie_child_entry) {
+        right = node->children_count;
+        while (left < right) {
+                size_t middle = (left + right) / 2;
+
+                if (node->children[middle].c <= c)
+                        left = middle + 1;
+                else
+                        right = middle;
+        }
+
+        memmove(node->children + left + 1, node->children + left,
+                sizeof(struct trie_child_entry) * (node->children_count - left));
+        node->children[left] = (struct trie_child_entry) {
                 .c = c,
                 .child = node_child,
         };
-        typesafe_qsort(node->children, node->children_count, trie_children_cmp);
+
+        node->children_count++;
+        trie->children_count++;
         trie->nodes_count++;
 
         return 0;
@@ -165,19 +180,32 @@ static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                 }
         }
 
-        /* extend array, add new entry, sort for bisection */
+        /* extend array, add new entry at its place, keeping the array sorted for bisection */
         if (!GREEDY_REALLOC(node->values, node->values_count + 1))
                 return -ENOMEM;
 
-        trie->values_count++;
-        node->values[node->values_count++] = (struct trie_value_entry) {
+        size_t left = 0, right = node->values_count;
+        while (left < right) {
+                size_t middle = (left + right) / 2;
+
+                if (strcmp(trie->strings->buf + node->values[middle].key_off, trie->strings->buf + k) < 0)
+                        left = middle + 1;
+                else
+                        right = middle;
+        }
+
+        memmove(node->values + left + 1, node->values + left,
+                sizeof(struct trie_value_entry) * (node->values_count - left));
+        node->values[left] = (struct trie_value_entry) {
                 .key_off = k,
                 .value_off = v,
                 .filename_off = fn,
                 .file_priority = file_priority,
                 .line_number = line_number,
         };
-        typesafe_qsort_r(node->values, node->values_count, trie_values_cmp, trie);
+
+        node->values_count++;
+        trie->values_count++;
         return 0;
 }
 
@@ -463,9 +491,9 @@ static int import_file(struct trie *trie, const char *filename, uint16_t file_pr
         uint32_t line_number = 0;
         int r, err;
 
-        f = fopen(filename, "re");
-        if (!f)
-                return -errno;
+        r = fopen_unlocked(filename, "re", &f);
+        if (r < 0)
+                return r;
 
         for (;;) {
                 _cleanup_free_ char *line = NULL;
@@ -852,10 +852,166 @@ static int is_symlink_with_known_name(const InstallInfo *i, const char *name) {
         return false;
 }
 
+typedef struct SymlinkEntry {
+        char *name;
+        char *destination;
+        int destination_error;
+} SymlinkEntry;
+
+typedef struct SymlinkDirectory {
+        char *path;
+        SymlinkEntry *entries;
+        size_t n_entries;
+        int read_error;
+} SymlinkDirectory;
+
+/* The symlinks found in one search path directory: those in its .wants/, .requires/ and .upholds/
+ * subdirectories, and those directly in it. When computing the state of many units at once, we load each
+ * search path directory only once, instead of rescanning it for every unit. */
+typedef struct SymlinkTree {
+        SymlinkDirectory *subdirs;
+        size_t n_subdirs;
+        SymlinkDirectory top;
+} SymlinkTree;
+
+static void symlink_directory_done(SymlinkDirectory *d) {
+        assert(d);
+
+        FOREACH_ARRAY(e, d->entries, d->n_entries) {
+                free(e->name);
+                free(e->destination);
+        }
+
+        d->entries = mfree(d->entries);
+        d->n_entries = 0;
+        d->path = mfree(d->path);
+}
+
+static SymlinkTree* symlink_tree_free(SymlinkTree *t) {
+        if (!t)
+                return NULL;
+
+        FOREACH_ARRAY(d, t->subdirs, t->n_subdirs)
+                symlink_directory_done(d);
+        free(t->subdirs);
+
+        symlink_directory_done(&t->top);
+        return mfree(t);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(SymlinkTree*, symlink_tree_free);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(symlink_tree_hash_ops,
+                             char, string_hash_func, string_compare_func, free,
+                             SymlinkTree, symlink_tree_free);
+
+static int symlink_directory_load(DIR *dir, const char *dir_path, bool read_destinations, SymlinkDirectory *ret) {
+        _cleanup_(symlink_directory_done) SymlinkDirectory d = {};
+
+        assert(dir);
+        assert(dir_path);
+        assert(ret);
+
+        d.path = strdup(dir_path);
+        if (!d.path)
+                return -ENOMEM;
+
+        FOREACH_DIRENT(de, dir, d.read_error = -errno) {
+                _cleanup_free_ char *name = NULL, *dest = NULL;
+                int dest_error = 0;
+
+                if (de->d_type != DT_LNK)
+                        continue;
+
+                if (read_destinations) {
+                        /* Acquire symlink destination */
+                        dest_error = readlinkat_malloc(dirfd(dir), de->d_name, &dest);
+                        if (dest_error > 0)
+                                dest_error = 0;
+                }
+
+                name = strdup(de->d_name);
+                if (!name)
+                        return -ENOMEM;
+
+                if (!GREEDY_REALLOC(d.entries, d.n_entries + 1))
+                        return -ENOMEM;
+
+                d.entries[d.n_entries++] = (SymlinkEntry) {
+                        .name = TAKE_PTR(name),
+                        .destination = TAKE_PTR(dest),
+                        .destination_error = dest_error,
+                };
+        }
+
+        *ret = TAKE_STRUCT(d);
+        return 0;
+}
+
+static int symlink_tree_load(const char *config_path, SymlinkTree **ret) {
+        _cleanup_(symlink_tree_freep) SymlinkTree *t = NULL;
+        _cleanup_closedir_ DIR *config_dir = NULL;
+        int r;
+
+        assert(config_path);
+        assert(ret);
+
+        config_dir = opendir(config_path);
+        if (!config_dir) {
+                if (IN_SET(errno, ENOENT, ENOTDIR, EACCES)) {
+                        *ret = NULL;
+                        return 0;
+                }
+                return -errno;
+        }
+
+        t = new0(SymlinkTree, 1);
+        if (!t)
+                return -ENOMEM;
+
+        FOREACH_DIRENT(de, config_dir, return -errno) {
+                const char *suffix;
+                _cleanup_free_ const char *path = NULL;
+                _cleanup_closedir_ DIR *d = NULL;
+
+                if (de->d_type != DT_DIR)
+                        continue;
+
+                suffix = strrchr(de->d_name, '.');
+                if (!STRPTR_IN_SET(suffix, ".wants", ".requires", ".upholds"))
+                        continue;
+
+                path = path_join(config_path, de->d_name);
+                if (!path)
+                        return -ENOMEM;
+
+                d = opendir(path);
+                if (!d) {
+                        log_error_errno(errno, "Failed to open directory \"%s\" while scanning for symlinks, ignoring: %m", path);
+                        continue;
+                }
+
+                if (!GREEDY_REALLOC(t->subdirs, t->n_subdirs + 1))
+                        return -ENOMEM;
+
+                r = symlink_directory_load(d, path, /* read_destinations= */ false, t->subdirs + t->n_subdirs);
+                if (r < 0)
+                        return r;
+
+                t->n_subdirs++;
+        }
+
+        rewinddir(config_dir);
+        r = symlink_directory_load(config_dir, config_path, /* read_destinations= */ true, &t->top);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(t);
+        return 1;
+}
+
 static int find_symlinks_in_directory(
-                DIR *dir,
-                const char *dir_path,
-                const char *root_dir,
+                const SymlinkDirectory *dir,
                 const InstallInfo *info,
                 bool ignore_destination,
                 bool match_name,
@@ -866,31 +1022,23 @@ static int find_symlinks_in_directory(
         int r, ret = 0;
 
         assert(dir);
-        assert(dir_path);
         assert(info);
         assert(unit_name_is_valid(info->name, UNIT_NAME_ANY));
         assert(config_path);
         assert(same_name_link);
 
-        FOREACH_DIRENT(de, dir, return -errno) {
+        FOREACH_ARRAY(de, dir->entries, dir->n_entries) {
                 bool found_path = false, found_dest = false, b = false;
 
-                if (de->d_type != DT_LNK)
-                        continue;
-
                 if (!ignore_destination) {
-                        _cleanup_free_ char *dest = NULL;
-
-                        /* Acquire symlink destination */
-                        r = readlinkat_malloc(dirfd(dir), de->d_name, &dest);
-                        if (r < 0) {
-                                if (r != -ENOENT)
-                                        RET_GATHER(ret, r);
+                        if (de->destination_error < 0) {
+                                if (de->destination_error != -ENOENT)
+                                        RET_GATHER(ret, de->destination_error);
                                 continue;
                         }
 
                         /* Check if what the symlink points to matches what we are looking for */
-                        found_dest = path_equal_filename(dest, info->name);
+                        found_dest = path_equal_filename(de->destination, info->name);
                 }
 
                 /* Check if the symlink itself matches what we are looking for.
@@ -902,12 +1050,12 @@ static int find_symlinks_in_directory(
                  * this name was found, we should ignore it. */
 
                 if (ignore_destination || !ignore_same_name)
-                        found_path = streq(de->d_name, info->name);
+                        found_path = streq(de->name, info->name);
 
                 if (!found_path && ignore_destination) {
                         _cleanup_free_ char *template = NULL;
 
-                        r = unit_name_template(de->d_name, &template);
+                        r = unit_name_template(de->name, &template);
                         if (r < 0 && r != -EINVAL)
                                 return r;
                         if (r >= 0)
@@ -918,7 +1066,7 @@ static int find_symlinks_in_directory(
                         _cleanup_free_ char *p = NULL, *t = NULL;
 
                         /* Filter out same name links in the main config path */
-                        p = path_make_absolute(de->d_name, dir_path);
+                        p = path_make_absolute(de->name, dir->path);
                         t = path_make_absolute(info->name, config_path);
                         if (!p || !t)
                                 return -ENOMEM;
@@ -933,60 +1081,65 @@ static int find_symlinks_in_directory(
                                 return 1;
 
                         /* Check if symlink name is in the set of names used by [Install] */
-                        r = is_symlink_with_known_name(info, de->d_name);
+                        r = is_symlink_with_known_name(info, de->name);
                         if (r != 0)
                                 return r;
                 }
         }
 
+        if (dir->read_error < 0)
+                return dir->read_error;
+
         return ret;
 }
 
 static int find_symlinks(
-                const char *root_dir,
+                Hashmap **symlink_cache,
                 const InstallInfo *i,
                 bool match_name,
                 bool ignore_same_name,
                 const char *config_path,
                 bool *same_name_link) {
 
-        _cleanup_closedir_ DIR *config_dir = NULL;
+        _cleanup_(symlink_tree_freep) SymlinkTree *loaded = NULL;
+        SymlinkTree *t;
         int r;
 
         assert(i);
         assert(config_path);
         assert(same_name_link);
 
-        config_dir = opendir(config_path);
-        if (!config_dir) {
-                if (IN_SET(errno, ENOENT, ENOTDIR, EACCES))
-                        return 0;
-                return -errno;
-        }
+        /* If the caller passes a cache, we remember the symlinks of each search path directory in it, so
+         * that looking up the state of many units at once (e.g. for list-unit-files) scans the .wants/
+         * etc. directories only once, instead of once per unit. Absent directories are remembered too. */
 
-        FOREACH_DIRENT(de, config_dir, return -errno) {
-                const char *suffix;
-                _cleanup_free_ const char *path = NULL;
-                _cleanup_closedir_ DIR *d = NULL;
+        if (symlink_cache && hashmap_contains(*symlink_cache, config_path))
+                t = hashmap_get(*symlink_cache, config_path);
+        else {
+                r = symlink_tree_load(config_path, &loaded);
+                if (r < 0)
+                        return r;
 
-                if (de->d_type != DT_DIR)
-                        continue;
+                t = loaded;
 
-                suffix = strrchr(de->d_name, '.');
-                if (!STRPTR_IN_SET(suffix, ".wants", ".requires", ".upholds"))
-                        continue;
+                if (symlink_cache) {
+                        _cleanup_free_ char *key = strdup(config_path);
+                        if (!key)
+                                return -ENOMEM;
 
-                path = path_join(config_path, de->d_name);
-                if (!path)
-                        return -ENOMEM;
+                        r = hashmap_ensure_put(symlink_cache, &symlink_tree_hash_ops, key, t);
+                        if (r < 0)
+                                return r;
 
-                d = opendir(path);
-                if (!d) {
-                        log_error_errno(errno, "Failed to open directory \"%s\" while scanning for symlinks, ignoring: %m", path);
-                        continue;
+                        TAKE_PTR(key);
+                        TAKE_PTR(loaded);
                 }
+        }
+        if (!t)
+                return 0;
 
-                r = find_symlinks_in_directory(d, path, root_dir, i,
+        FOREACH_ARRAY(d, t->subdirs, t->n_subdirs) {
+                r = find_symlinks_in_directory(d, i,
                                                /* ignore_destination= */ true,
                                                /* match_name= */ match_name,
                                                /* ignore_same_name= */ ignore_same_name,
@@ -995,13 +1148,12 @@ static int find_symlinks(
                 if (r > 0)
                         return 1;
                 if (r < 0)
-                        log_debug_errno(r, "Failed to look up symlinks in \"%s\": %m", path);
+                        log_debug_errno(r, "Failed to look up symlinks in \"%s\": %m", d->path);
         }
 
         /* We didn't find any suitable symlinks in .wants, .requires or .upholds directories,
          * let's look for linked unit files in this directory. */
-        rewinddir(config_dir);
-        return find_symlinks_in_directory(config_dir, config_path, root_dir, i,
+        return find_symlinks_in_directory(&t->top, i,
                                           /* ignore_destination= */ false,
                                           /* match_name= */ match_name,
                                           /* ignore_same_name= */ ignore_same_name,
@@ -1012,6 +1164,7 @@ static int find_symlinks(
 static int find_symlinks_in_scope(
                 RuntimeScope scope,
                 const LookupPaths *lp,
+                Hashmap **symlink_cache,
                 const InstallInfo *info,
                 bool match_name,
                 UnitFileState *state) {
@@ -1031,7 +1184,7 @@ static int find_symlinks_in_scope(
         STRV_FOREACH(p, lp->search_path)  {
                 bool same_name_link = false;
 
-                r = find_symlinks(lp->root_dir, info, match_name, ignore_same_name, *p, &same_name_link);
+                r = find_symlinks(symlink_cache, info, match_name, ignore_same_name, *p, &same_name_link);
                 if (r < 0)
                         return r;
                 if (r > 0) {
@@ -3091,9 +3244,10 @@ int unit_file_get_default(
         return strdup_to(ret, info->name);
 }
 
-int unit_file_lookup_state(
+static int unit_file_lookup_state_internal(
                 RuntimeScope scope,
                 const LookupPaths *lp,
+                Hashmap **symlink_cache,
                 const char *name,
                 UnitFileState *ret) {
 
@@ -3157,7 +3311,7 @@ int unit_file_lookup_state(
                 /* Check if any of the Alias= symlinks have been created.
                  * We ignore other aliases, and only check those that would
                  * be created by systemctl enable for this unit. */
-                r = find_symlinks_in_scope(scope, lp, info, true, &state);
+                r = find_symlinks_in_scope(scope, lp, symlink_cache, info, true, &state);
                 if (r < 0)
                         return r;
                 if (r > 0)
@@ -3165,7 +3319,7 @@ int unit_file_lookup_state(
 
                 /* Check if the file is known under other names. If it is,
                  * it might be in use. Report that as UNIT_FILE_INDIRECT. */
-                r = find_symlinks_in_scope(scope, lp, info, false, &state);
+                r = find_symlinks_in_scope(scope, lp, symlink_cache, info, false, &state);
                 if (r < 0)
                         return r;
                 if (r > 0)
@@ -3189,6 +3343,15 @@ int unit_file_lookup_state(
         return 0;
 }
 
+int unit_file_lookup_state(
+                RuntimeScope scope,
+                const LookupPaths *lp,
+                const char *name,
+                UnitFileState *ret) {
+
+        return unit_file_lookup_state_internal(scope, lp, /* symlink_cache= */ NULL, name, ret);
+}
+
 int unit_file_get_state(
                 RuntimeScope scope,
                 const char *root_dir,
@@ -3755,7 +3918,7 @@ int unit_file_get_list(
                 Hashmap **ret) {
 
         _cleanup_(lookup_paths_done) LookupPaths lp = {};
-        _cleanup_hashmap_free_ Hashmap *h = NULL;
+        _cleanup_hashmap_free_ Hashmap *h = NULL, *symlink_cache = NULL;
         int r;
 
         assert(scope >= 0);
@@ -3796,7 +3959,7 @@ int unit_file_get_list(
 
                         UnitFileState state;
 
-                        r = unit_file_lookup_state(scope, &lp, de->d_name, &state);
+                        r = unit_file_lookup_state_internal(scope, &lp, &symlink_cache, de->d_name, &state);
                         if (r < 0)
                                 state = UNIT_FILE_BAD;
 
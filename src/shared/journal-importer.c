@@ -228,6 +228,25 @@ static int process_special_field(JournalImporter *imp, char *line) {
 
         assert(line);
 
+        /* This is called for every field, and most of them are neither dunder fields nor _BOOT_ID=, hence
+         * let's get those out of the way with a two character check. */
+        if (line[0] != '_')
+                return 0;
+
+        if (line[1] != '_') {
+                /* Just a single underline, but it needs special treatment too. */
+                value = startswith(line, "_BOOT_ID=");
+                if (value) {
+                        r = sd_id128_from_string(value, &imp->boot_id);
+                        if (r < 0)
+                                return log_warning_errno(r, "Failed to parse _BOOT_ID '%s': %m",
+                                                         cellescape(buf, sizeof buf, value));
+                }
+
+                /* store the field in the usual fashion too */
+                return 0;
+        }
+
         if (STARTSWITH_SET(line, "__CURSOR=", "__SEQNUM=", "__SEQNUM_ID="))
                 /* ignore __CURSOR=, __SEQNUM=, __SEQNUM_ID= which we cannot replicate */
                 return 1;
@@ -266,26 +285,8 @@ static int process_special_field(JournalImporter *imp, char *line) {
                 return 1;
         }
 
-        /* Just a single underline, but it needs special treatment too. */
-        value = startswith(line, "_BOOT_ID=");
-        if (value) {
-                r = sd_id128_from_string(value, &imp->boot_id);
-                if (r < 0)
-                        return log_warning_errno(r, "Failed to parse _BOOT_ID '%s': %m",
-                                                 cellescape(buf, sizeof buf, value));
-
-                /* store the field in the usual fashion too */
-                return 0;
-        }
-
-        value = startswith(line, "__");
-        if (value) {
-                log_notice("Unknown dunder line __%s, ignoring.", cellescape(buf, sizeof buf, value));
-                return 1;
-        }
-
-        /* no dunder */
-        return 0;
+        log_notice("Unknown dunder line __%s, ignoring.", cellescape(buf, sizeof buf, line + 2));
+        return 1;
 }
 
 int journal_importer_process_data(JournalImporter *imp) {
@@ -450,9 +451,10 @@ int journal_importer_push_data(JournalImporter *imp, const char *data, size_t si
 void journal_importer_drop_iovw(JournalImporter *imp) {
         size_t remain, target;
 
-        /* This function drops processed data that along with the iovw that points at it */
+        /* This function drops processed data that along with the iovw that points at it. The iovec array
+         * itself is kept around, so that we don't have to grow it again field by field for the next entry. */
 
-        iovw_done(&imp->iovw);
+        imp->iovw.count = 0;
 
         /* possibly reset buffer position */
         remain = imp->filled - imp->offset;
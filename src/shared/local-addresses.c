@@ -397,6 +397,14 @@ int local_gateways(
         if (r < 0)
                 return r;
 
+        /* With strict checking, the kernel only dumps routes via the interface. Older kernels ignore this,
+         * hence the interface is still checked below. */
+        if (ifindex > 0) {
+                r = sd_netlink_message_append_u32(req, RTA_OIF, ifindex);
+                if (r < 0)
+                        return r;
+        }
+
         r = sd_netlink_message_set_request_dump(req, true);
         if (r < 0)
                 return r;
@@ -834,7 +834,7 @@ static int output_verbose(
                 cursor,
                 (flags & OUTPUT_COLOR) ? ansi_grey() : "");
 
-        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
+        JOURNAL_FOREACH_DATA_IN_SET_RETVAL(j, output_fields, data, length, r) {
                 _cleanup_free_ char *urlified = NULL;
                 const char *on = "", *off = "";
                 const char *c, *p = NULL;
@@ -916,11 +916,9 @@ static int output_export(
                 dual_timestamp *previous_display_ts, /* unused */
                 sd_id128_t *previous_boot_id) {      /* unused */
 
-        sd_id128_t journal_boot_id, seqnum_id;
         _cleanup_free_ char *cursor = NULL;
-        usec_t monotonic, realtime;
+        JournalEntryMetadata m;
         const void *data;
-        uint64_t seqnum;
         size_t length;
         int r;
 
@@ -928,21 +926,9 @@ static int output_export(
 
         (void) sd_journal_set_data_threshold(j, 0);
 
-        r = sd_journal_get_cursor(j, &cursor);
-        if (r < 0)
-                return log_error_errno(r, "Failed to get cursor: %m");
-
-        r = sd_journal_get_realtime_usec(j, &realtime);
-        if (r < 0)
-                return log_error_errno(r, "Failed to get realtime timestamp: %m");
-
-        r = sd_journal_get_monotonic_usec(j, &monotonic, &journal_boot_id);
+        r = journal_get_entry_metadata(j, &cursor, &m);
         if (r < 0)
-                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
-
-        r = sd_journal_get_seqnum(j, &seqnum, &seqnum_id);
-        if (r < 0)
-                return log_error_errno(r, "Failed to get seqnum: %m");
+                return log_error_errno(r, "Failed to get cursor, timestamps or seqnum: %m");
 
         fprintf(f,
                 "__CURSOR=%s\n"
@@ -952,13 +938,13 @@ static int output_export(
                 "__SEQNUM_ID=%s\n"
                 "_BOOT_ID=%s\n",
                 cursor,
-                realtime,
-                monotonic,
-                seqnum,
-                SD_ID128_TO_STRING(seqnum_id),
-                SD_ID128_TO_STRING(journal_boot_id));
+                m.realtime,
+                m.monotonic,
+                m.seqnum,
+                SD_ID128_TO_STRING(m.seqnum_id),
+                SD_ID128_TO_STRING(m.boot_id));
 
-        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
+        JOURNAL_FOREACH_DATA_IN_SET_RETVAL(j, output_fields, data, length, r) {
                 size_t fieldlen;
                 const char *c;
 
@@ -1061,7 +1047,8 @@ void json_escape(
 
 typedef struct JsonData {
         sd_json_variant* name;
-        sd_json_variant* values;
+        sd_json_variant* values; /* The value itself if n_values is 1, an array of them otherwise */
+        size_t n_values;
 } JsonData;
 
 static JsonData* json_data_free(JsonData *d) {
@@ -1108,9 +1095,24 @@ static int update_json_data(
 
         d = hashmap_get(h, name);
         if (d) {
-                r = sd_json_variant_append_array(&d->values, v);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to append JSON value into array: %m");
+                /* Most fields appear only once per entry, hence we only turn the value into an array once
+                 * we see a second one, instead of allocating an array for every single field. */
+                if (d->n_values == 1) {
+                        sd_json_variant *a;
+
+                        r = sd_json_variant_new_array(&a, (sd_json_variant*[]) { d->values, v }, 2);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to create JSON value array: %m");
+
+                        sd_json_variant_unref(d->values);
+                        d->values = a;
+                } else {
+                        r = sd_json_variant_append_array(&d->values, v);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to append JSON value into array: %m");
+                }
+
+                d->n_values++;
         } else {
                 _cleanup_(json_data_freep) JsonData *e = NULL;
 
@@ -1122,9 +1124,8 @@ static int update_json_data(
                 if (r < 0)
                         return log_error_errno(r, "Failed to allocate JSON name variant: %m");
 
-                r = sd_json_variant_append_array(&e->values, v);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to create JSON value array: %m");
+                e->values = TAKE_PTR(v);
+                e->n_values = 1;
 
                 r = hashmap_put(h, sd_json_variant_string(e->name), e);
                 if (r < 0)
@@ -1182,12 +1183,10 @@ static int output_json(
         char usecbuf[CONST_MAX(DECIMAL_STR_MAX(usec_t), DECIMAL_STR_MAX(uint64_t))];
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *object = NULL;
         _cleanup_hashmap_free_ Hashmap *h = NULL;
-        sd_id128_t journal_boot_id, seqnum_id;
         _cleanup_free_ char *cursor = NULL;
-        usec_t realtime, monotonic;
         sd_json_variant **array = NULL;
+        JournalEntryMetadata m;
         JsonData *d;
-        uint64_t seqnum;
         size_t n = 0;
         int r;
 
@@ -1195,21 +1194,9 @@ static int output_json(
 
         (void) sd_journal_set_data_threshold(j, flags & OUTPUT_SHOW_ALL ? 0 : JSON_THRESHOLD);
 
-        r = sd_journal_get_cursor(j, &cursor);
-        if (r < 0)
-                return log_error_errno(r, "Failed to get cursor: %m");
-
-        r = sd_journal_get_realtime_usec(j, &realtime);
-        if (r < 0)
-                return log_error_errno(r, "Failed to get realtime timestamp: %m");
-
-        r = sd_journal_get_monotonic_usec(j, &monotonic, &journal_boot_id);
+        r = journal_get_entry_metadata(j, &cursor, &m);
         if (r < 0)
-                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
-
-        r = sd_journal_get_seqnum(j, &seqnum, &seqnum_id);
-        if (r < 0)
-                return log_error_errno(r, "Failed to get seqnum: %m");
+                return log_error_errno(r, "Failed to get cursor, timestamps or seqnum: %m");
 
         h = hashmap_new(&json_data_hash_ops_free);
         if (!h)
@@ -1219,26 +1206,26 @@ static int output_json(
         if (r < 0)
                 return r;
 
-        xsprintf(usecbuf, USEC_FMT, realtime);
+        xsprintf(usecbuf, USEC_FMT, m.realtime);
         r = update_json_data(h, flags, "__REALTIME_TIMESTAMP", usecbuf, SIZE_MAX);
         if (r < 0)
                 return r;
 
-        xsprintf(usecbuf, USEC_FMT, monotonic);
+        xsprintf(usecbuf, USEC_FMT, m.monotonic);
         r = update_json_data(h, flags, "__MONOTONIC_TIMESTAMP", usecbuf, SIZE_MAX);
         if (r < 0)
                 return r;
 
-        r = update_json_data(h, flags, "_BOOT_ID", SD_ID128_TO_STRING(journal_boot_id), SIZE_MAX);
+        r = update_json_data(h, flags, "_BOOT_ID", SD_ID128_TO_STRING(m.boot_id), SIZE_MAX);
         if (r < 0)
                 return r;
 
-        xsprintf(usecbuf, USEC_FMT, seqnum);
+        xsprintf(usecbuf, USEC_FMT, m.seqnum);
         r = update_json_data(h, flags, "__SEQNUM", usecbuf, SIZE_MAX);
         if (r < 0)
                 return r;
 
-        r = update_json_data(h, flags, "__SEQNUM_ID", SD_ID128_TO_STRING(seqnum_id), SIZE_MAX);
+        r = update_json_data(h, flags, "__SEQNUM_ID", SD_ID128_TO_STRING(m.seqnum_id), SIZE_MAX);
         if (r < 0)
                 return r;
 
@@ -1246,7 +1233,7 @@ static int output_json(
                 const void *data;
                 size_t size;
 
-                r = sd_journal_enumerate_data(j, &data, &size);
+                r = journal_enumerate_data_in_set(j, output_fields, &data, &size);
                 if (IN_SET(r, -EBADMSG, -EADDRNOTAVAIL)) {
                         log_debug_errno(r, "Skipping message we can't read: %m");
                         return 0;
@@ -1268,14 +1255,10 @@ static int output_json(
         CLEANUP_ARRAY(array, n, sd_json_variant_unref_many);
 
         HASHMAP_FOREACH(d, h) {
-                assert(sd_json_variant_elements(d->values) > 0);
+                assert(d->n_values > 0);
 
                 array[n++] = sd_json_variant_ref(d->name);
-
-                if (sd_json_variant_elements(d->values) == 1)
-                        array[n++] = sd_json_variant_ref(sd_json_variant_by_index(d->values, 0));
-                else
-                        array[n++] = sd_json_variant_ref(d->values);
+                array[n++] = sd_json_variant_ref(d->values);
         }
 
         r = sd_json_variant_new_object(&object, array, n);
@@ -992,6 +992,114 @@ int loop_device_open_from_path(
         return loop_device_open(dev, open_flags, lock_op, ret);
 }
 
+int loop_device_open_shared(
+                const char *path,
+                uint32_t sector_size,
+                uint32_t loop_flags,
+                int lock_op,
+                LoopDevice **ret) {
+
+        _cleanup_(sd_device_enumerator_unrefp) sd_device_enumerator *e = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        struct stat st;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        /* Looks for a read-only loopback device somebody else already set up for the whole of the specified
+         * file, and opens it. Many instances running off the same image may share a single block device this
+         * way, and hence a single page cache and a single superblock per file system (and a single verity
+         * device on top, see DISSECT_IMAGE_VERITY_SHARE), instead of one per instance. The sector size is
+         * interpreted as in loop_device_make(), and a device is only shared if it uses the same one, as the
+         * partition table and file systems would be read differently otherwise. Returns -ENOENT if there's no
+         * suitable device. */
+
+        r = getenv_bool("SYSTEMD_LOOP_SHARING");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_LOOP_SHARING, ignoring: %m");
+        if (r == 0)
+                return -ENOENT;
+
+        fd = open(path, O_RDONLY|O_CLOEXEC|O_NONBLOCK|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+        if (!S_ISREG(st.st_mode))
+                return -ENOENT;
+
+        if (sector_size == 0)
+                sector_size = 512;
+        else if (sector_size == UINT32_MAX) {
+                r = probe_sector_size(fd, &sector_size);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_device_enumerator_new(&e);
+        if (r < 0)
+                return r;
+
+        r = sd_device_enumerator_add_match_subsystem(e, "block", /* match= */ true);
+        if (r < 0)
+                return r;
+
+        r = sd_device_enumerator_add_match_sysname(e, "loop*");
+        if (r < 0)
+                return r;
+
+        r = sd_device_enumerator_add_match_sysattr(e, "loop/backing_file", /* value= */ NULL, /* match= */ true);
+        if (r < 0)
+                return r;
+
+        FOREACH_DEVICE(e, dev) {
+                _cleanup_(loop_device_unrefp) LoopDevice *d = NULL;
+                struct loop_info64 info;
+
+                /* Don't wait for devices somebody currently holds an exclusive lock on, they are being set
+                 * up or torn down. */
+                r = loop_device_open(dev, O_RDONLY, lock_op|LOCK_NB, &d);
+                if (r < 0) {
+                        log_device_debug_errno(dev, r, "Failed to open loopback device, ignoring: %m");
+                        continue;
+                }
+
+                /* Check again now that we hold a reference, the device might have been detached or reused
+                 * for something else in the meantime. */
+                if (ioctl(d->fd, LOOP_GET_STATUS64, &info) < 0)
+                        continue;
+
+#if HAVE_VALGRIND_MEMCHECK_H
+                VALGRIND_MAKE_MEM_DEFINED(&info, sizeof(info));
+#endif
+
+                if (info.lo_device != st.st_dev || info.lo_inode != st.st_ino ||
+                    info.lo_offset != 0 || info.lo_sizelimit != 0)
+                        continue;
+
+                /* Only share devices that go away on their own once the last user is done with them, and
+                 * that look exactly like the ones we'd set up ourselves. */
+                if (!FLAGS_SET(info.lo_flags, LO_FLAGS_READ_ONLY|LO_FLAGS_AUTOCLEAR) ||
+                    FLAGS_SET(info.lo_flags, LO_FLAGS_PARTSCAN) != FLAGS_SET(loop_flags, LO_FLAGS_PARTSCAN))
+                        continue;
+
+                if (d->sector_size != sector_size) {
+                        log_device_debug(dev, "Loopback device uses sector size %" PRIu32 " instead of %" PRIu32 ", not sharing it.",
+                                         d->sector_size, sector_size);
+                        continue;
+                }
+
+                log_device_debug(dev, "Sharing existing loopback device %s for %s.", d->node, path);
+
+                *ret = TAKE_PTR(d);
+                return 0;
+        }
+
+        return -ENOENT;
+}
+
 static int resize_partition(int partition_fd, uint64_t offset, uint64_t size) {
         char sysfs[STRLEN("/sys/dev/block/:/partition") + 2*DECIMAL_STR_MAX(dev_t) + 1];
         _cleanup_free_ char *buffer = NULL;
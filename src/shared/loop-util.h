@@ -42,6 +42,7 @@ int loop_device_make_by_path_memory(const char *path, int open_flags, uint32_t s
 int loop_device_open(sd_device *dev, int open_flags, int lock_op, LoopDevice **ret);
 int loop_device_open_from_fd(int fd, int open_flags, int lock_op, LoopDevice **ret);
 int loop_device_open_from_path(const char *path, int open_flags, int lock_op, LoopDevice **ret);
+int loop_device_open_shared(const char *path, uint32_t sector_size, uint32_t loop_flags, int lock_op, LoopDevice **ret);
 
 LoopDevice* loop_device_ref(LoopDevice *d);
 LoopDevice* loop_device_unref(LoopDevice *d);
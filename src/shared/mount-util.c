@@ -144,6 +144,20 @@ static uint64_t ms_flags_to_mount_attr(unsigned long a) {
 
 static bool skip_mount_set_attr = false;
 
+static bool deny_list_covers_submounts(char **deny_list, const char *prefix) {
+        assert(prefix);
+
+        /* Returns true if any deny list entry refers to a subtree strictly below the prefix, i.e. whether the
+         * deny list has any effect on remounting the prefix. Entries for the prefix itself or outside of it
+         * never exclude anything, see below. */
+
+        STRV_FOREACH(i, deny_list)
+                if (!path_equal(*i, prefix) && path_startswith(*i, prefix))
+                        return true;
+
+        return false;
+}
+
 /* Use this function only if you do not have direct access to /proc/self/mountinfo but the caller can open it
  * for you. This is the case when /proc is masked or not mounted. Otherwise, use bind_remount_recursive. */
 int bind_remount_recursive_with_mountinfo(
@@ -160,8 +174,11 @@ int bind_remount_recursive_with_mountinfo(
 
         assert(prefix);
 
-        if ((flags_mask & ~MS_CONVERTIBLE_FLAGS) == 0 && strv_isempty(deny_list) && !skip_mount_set_attr) {
-                /* Let's take a shortcut for all the flags we know how to convert into mount_setattr() flags */
+        if ((flags_mask & ~MS_CONVERTIBLE_FLAGS) == 0 && !deny_list_covers_submounts(deny_list, prefix) && !skip_mount_set_attr) {
+                /* Let's take a shortcut for all the flags we know how to convert into mount_setattr() flags.
+                 * The sandbox code passes the paths of all its mounts as deny list for every single entry,
+                 * hence only give up on the shortcut if one of them is actually below the prefix, which is
+                 * rarely the case. Otherwise we'd reparse /proc/self/mountinfo once per entry. */
 
                 if (mount_setattr(AT_FDCWD, prefix, AT_SYMLINK_NOFOLLOW|AT_RECURSIVE,
                                   &(struct mount_attr) {
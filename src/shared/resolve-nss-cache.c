@@ -0,0 +1,243 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "alloc-util.h"
+#include "dns-domain.h"
+#include "fd-util.h"
+#include "resolve-nss-cache.h"
+#include "string-util.h"
+#include "time-util.h"
+
+/* How often to map the file afresh when the writer replaced it, before giving up on it. Old mappings are
+ * never unmapped, since other threads might still read from them. */
+#define RESOLVE_NSS_CACHE_MAPS_MAX 16U
+
+static ResolveNssCacheHeader *cache_header = NULL;
+static unsigned cache_n_maps = 0;
+
+static int resolve_nss_cache_open(void) {
+        _cleanup_close_ int dir_fd = -EBADF, parent_fd = -EBADF, fd = -EBADF;
+        struct stat st, dir_st;
+
+        /* resolved usually runs as its own user, which owns its runtime directory, hence the file can't be
+         * required to be owned by root. Instead, only trust a file owned by root or by the owner of the
+         * directory it is in, if neither the file nor the directory nor the directory's parent (which is
+         * where the directory was created, by root) are writable by anyone else. */
+
+        dir_fd = open(RESOLVE_NSS_CACHE_DIR, O_PATH|O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW);
+        if (dir_fd < 0)
+                return -errno;
+
+        parent_fd = openat(dir_fd, "..", O_PATH|O_DIRECTORY|O_CLOEXEC);
+        if (parent_fd < 0)
+                return -errno;
+
+        if (fstat(parent_fd, &st) < 0)
+                return -errno;
+        if (st.st_uid != 0 || (st.st_mode & 0022) != 0)
+                return -EPERM;
+
+        if (fstat(dir_fd, &dir_st) < 0)
+                return -errno;
+        if ((dir_st.st_mode & 0022) != 0)
+                return -EPERM;
+
+        fd = openat(dir_fd, "nss-cache", O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+        if (!S_ISREG(st.st_mode) || (st.st_mode & 0022) != 0 ||
+            (st.st_uid != 0 && st.st_uid != dir_st.st_uid))
+                return -EPERM;
+
+        return TAKE_FD(fd);
+}
+
+int resolve_nss_cache_normalize_name(const char *name, char **ret) {
+        _cleanup_free_ char *n = NULL;
+        int r;
+
+        assert(name);
+        assert(ret);
+
+        r = dns_name_normalize(name, 0, &n);
+        if (r < 0)
+                return r;
+
+        if (strlen(n) > RESOLVE_NSS_CACHE_NAME_MAX)
+                return -E2BIG;
+
+        *ret = ascii_strlower(TAKE_PTR(n));
+        return 0;
+}
+
+void resolve_nss_cache_key(const char *name, uint8_t ret[static SHA256_DIGEST_SIZE]) {
+        static const char prefix[] = "resolve-nss-cache-key";
+        struct sha256_ctx ctx;
+
+        assert(name);
+
+        sha256_init_ctx(&ctx);
+        sha256_process_bytes(prefix, sizeof(prefix), &ctx);
+        sha256_process_bytes(name, strlen(name) + 1, &ctx);
+        sha256_finish_ctx(&ctx, ret);
+}
+
+void resolve_nss_cache_crypt(const char *name, uint64_t sequence, ResolveNssCachePayload *payload) {
+        static const char prefix[] = "resolve-nss-cache-payload";
+        uint8_t *p = (uint8_t*) payload;
+
+        assert(name);
+        assert(payload);
+
+        /* XORs the payload with a key stream derived from the name and the sequence number of the slot, the
+         * latter so that no two versions of the payload are ever encrypted with the same key stream. */
+
+        for (uint32_t block = 0; block * SHA256_DIGEST_SIZE < sizeof(*payload); block++) {
+                uint8_t stream[SHA256_DIGEST_SIZE];
+                struct sha256_ctx ctx;
+
+                sha256_init_ctx(&ctx);
+                sha256_process_bytes(prefix, sizeof(prefix), &ctx);
+                sha256_process_bytes(name, strlen(name) + 1, &ctx);
+                sha256_process_bytes(&sequence, sizeof(sequence), &ctx);
+                sha256_process_bytes(&block, sizeof(block), &ctx);
+                sha256_finish_ctx(&ctx, stream);
+
+                for (size_t i = 0; i < SHA256_DIGEST_SIZE && block * SHA256_DIGEST_SIZE + i < sizeof(*payload); i++)
+                        p[block * SHA256_DIGEST_SIZE + i] ^= stream[i];
+        }
+}
+
+int resolve_nss_cache_header_verify(const ResolveNssCacheHeader *h, size_t size) {
+        assert(h || size == 0);
+
+        if (size != RESOLVE_NSS_CACHE_SIZE(RESOLVE_NSS_CACHE_SLOTS))
+                return -EBADMSG;
+
+        if (memcmp(h->signature, RESOLVE_NSS_CACHE_SIGNATURE, sizeof(h->signature)) != 0 ||
+            h->n_slots != RESOLVE_NSS_CACHE_SLOTS)
+                return -EBADMSG;
+
+        if (__atomic_load_n(&h->retired, __ATOMIC_ACQUIRE))
+                return -ESTALE;
+
+        return 0;
+}
+
+static ResolveNssCacheHeader* resolve_nss_cache_map(void) {
+        ResolveNssCacheHeader *h, *old;
+        _cleanup_close_ int fd = -EBADF;
+        size_t size = RESOLVE_NSS_CACHE_SIZE(RESOLVE_NSS_CACHE_SLOTS);
+        struct stat st;
+        void *p;
+
+        old = __atomic_load_n(&cache_header, __ATOMIC_ACQUIRE);
+        if (old && !__atomic_load_n(&old->retired, __ATOMIC_ACQUIRE))
+                return old;
+
+        /* Not mapped yet, or resolved stopped updating the file we have mapped, because it was restarted or
+         * was told to stop publishing. Either way, look for the current file. */
+
+        if (__atomic_load_n(&cache_n_maps, __ATOMIC_RELAXED) >= RESOLVE_NSS_CACHE_MAPS_MAX)
+                return NULL;
+
+        fd = resolve_nss_cache_open();
+        if (fd < 0)
+                return NULL;
+
+        if (fstat(fd, &st) < 0)
+                return NULL;
+
+        if ((uint64_t) st.st_size != size)
+                return NULL;
+
+        p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+                return NULL;
+
+        h = p;
+        if (resolve_nss_cache_header_verify(h, size) < 0) {
+                (void) munmap(p, size);
+                return NULL;
+        }
+
+        if (!__atomic_compare_exchange_n(&cache_header, &old, h, /* weak= */ false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                /* Some other thread was quicker */
+                (void) munmap(p, size);
+                return old;
+        }
+
+        __atomic_add_fetch(&cache_n_maps, 1, __ATOMIC_RELAXED);
+        return h;
+}
+
+int resolve_nss_cache_lookup_in(ResolveNssCacheHeader *h, const char *name, ResolveNssCachePayload *ret) {
+        _cleanup_free_ char *n = NULL;
+        uint8_t key[SHA256_DIGEST_SIZE];
+        ResolveNssCacheSlot *slot, copy;
+        uint64_t sequence;
+        int r;
+
+        assert(h);
+        assert(name);
+        assert(ret);
+
+        r = resolve_nss_cache_normalize_name(name, &n);
+        if (r < 0)
+                return r;
+
+        resolve_nss_cache_key(n, key);
+        slot = resolve_nss_cache_slot(h, key);
+
+        /* Never wait for the writer, if the slot is being updated right now, just ask via IPC */
+        sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1)
+                return -EBUSY;
+
+        memcpy(&copy, slot, sizeof(copy));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence)
+                return -EBUSY;
+
+        if (copy.generation != __atomic_load_n(&h->generation, __ATOMIC_ACQUIRE) ||
+            memcmp(copy.key, key, sizeof(key)) != 0)
+                return -ENOENT;
+
+        if (copy.until <= now(CLOCK_BOOTTIME))
+                return -ESTALE;
+
+        resolve_nss_cache_crypt(n, sequence, &copy.payload);
+
+        if (copy.payload.n_addresses == 0 ||
+            copy.payload.n_addresses > RESOLVE_NSS_CACHE_ADDRESSES_MAX ||
+            !memchr(copy.payload.name, 0, sizeof(copy.payload.name)))
+                return -EBADMSG;
+
+        for (size_t i = 0; i < copy.payload.n_addresses; i++)
+                if (!IN_SET(copy.payload.addresses[i].family, AF_INET, AF_INET6))
+                        return -EBADMSG;
+
+        *ret = copy.payload;
+        return 0;
+}
+
+int resolve_nss_cache_lookup(const char *name, ResolveNssCachePayload *ret) {
+        ResolveNssCacheHeader *h;
+
+        assert(name);
+        assert(ret);
+
+        h = resolve_nss_cache_map();
+        if (!h)
+                return -ENXIO;
+
+        return resolve_nss_cache_lookup_in(h, name, ret);
+}
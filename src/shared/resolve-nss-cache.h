@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+
+#include "sha256.h"
+
+/* systemd-resolved may publish the addresses of recently resolved host names in a shared memory file, so that
+ * nss-resolve can answer lookups for them in-process, without any IPC. The file has a fixed size and is made
+ * of directly mapped slots. Each slot is protected by its own sequence counter (a seqlock): the single writer
+ * makes it odd while it updates the slot, and readers retry via IPC if it was odd or changed while they
+ * copied the slot.
+ *
+ * The file has to be world-readable, since nss-resolve runs in every process resolving host names, with
+ * whatever credentials those have. To not reveal which names were looked up, slots are found via a SHA-256
+ * digest of the name, and the payload is encrypted with a key stream derived from the name as well. Hence,
+ * only those who already know a name can find and read its entry—the same thing they'd learn from a lookup
+ * answered quickly. Only the writer may modify the file: readers ignore it unless it is owned by root or by
+ * the owner of its directory (i.e. the systemd-resolve user), and unless nobody else could have written the
+ * file or created it there. */
+
+#define RESOLVE_NSS_CACHE_DIR "/run/systemd/resolve"
+#define RESOLVE_NSS_CACHE_PATH RESOLVE_NSS_CACHE_DIR "/nss-cache"
+
+#define RESOLVE_NSS_CACHE_SLOTS 2048U
+#define RESOLVE_NSS_CACHE_ADDRESSES_MAX 8U
+#define RESOLVE_NSS_CACHE_NAME_MAX 255U
+
+#define RESOLVE_NSS_CACHE_SIGNATURE ((const uint8_t[]) { 'R', 'N', 'S', 'S', 'C', 'A', 'C', '1' })
+
+typedef struct ResolveNssCacheHeader {
+        uint8_t signature[8];
+        uint64_t n_slots;
+        uint64_t generation;         /* Slots from other generations are invalid */
+        uint64_t retired;            /* Non-zero once the writer stopped updating this file */
+} ResolveNssCacheHeader;
+
+typedef struct ResolveNssCacheAddress {
+        int32_t ifindex;
+        uint8_t family;
+        uint8_t _pad[3];
+        uint8_t address[16];
+} ResolveNssCacheAddress;
+
+typedef struct ResolveNssCachePayload {
+        char name[RESOLVE_NSS_CACHE_NAME_MAX + 1]; /* The canonical name, NUL terminated */
+        uint64_t n_addresses;
+        ResolveNssCacheAddress addresses[RESOLVE_NSS_CACHE_ADDRESSES_MAX];
+} ResolveNssCachePayload;
+
+typedef struct ResolveNssCacheSlot {
+        uint64_t sequence;
+        uint64_t generation;
+        uint64_t until;              /* CLOCK_BOOTTIME */
+        uint8_t key[SHA256_DIGEST_SIZE];
+        ResolveNssCachePayload payload;
+} ResolveNssCacheSlot;
+
+#define RESOLVE_NSS_CACHE_SIZE(n_slots) \
+        (sizeof(ResolveNssCacheHeader) + (size_t) (n_slots) * sizeof(ResolveNssCacheSlot))
+
+static inline ResolveNssCacheSlot* resolve_nss_cache_slot(ResolveNssCacheHeader *h, const uint8_t key[static SHA256_DIGEST_SIZE]) {
+        uint32_t i;
+
+        memcpy(&i, key, sizeof(i));
+        return (ResolveNssCacheSlot*) ((uint8_t*) h + sizeof(ResolveNssCacheHeader)) + (i % h->n_slots);
+}
+
+int resolve_nss_cache_normalize_name(const char *name, char **ret);
+void resolve_nss_cache_key(const char *name, uint8_t ret[static SHA256_DIGEST_SIZE]);
+void resolve_nss_cache_crypt(const char *name, uint64_t sequence, ResolveNssCachePayload *payload);
+
+int resolve_nss_cache_header_verify(const ResolveNssCacheHeader *h, size_t size);
+int resolve_nss_cache_lookup_in(ResolveNssCacheHeader *h, const char *name, ResolveNssCachePayload *ret);
+int resolve_nss_cache_lookup(const char *name, ResolveNssCachePayload *ret);
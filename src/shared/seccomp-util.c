@@ -1171,7 +1171,9 @@ int seccomp_load_syscall_filter_set(uint32_t default_action, const SyscallFilter
 }
 
 int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter, uint32_t action, bool log_missing) {
+        _cleanup_free_ int *known = NULL;
         uint32_t arch, default_action_override;
+        size_t n_known = 0;
         int r;
 
         /* Similar to seccomp_load_syscall_filter_set(), but takes a raw Hashmap* of syscalls, instead
@@ -1182,6 +1184,26 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter
 
         default_action_override = override_default_action(default_action);
 
+        if (default_action != default_action_override)
+                /* The (native) syscall numbers don't depend on the architecture we operate on below, hence
+                 * resolve the names of the @known set once, rather than once for each architecture. */
+                NULSTR_FOREACH(name, syscall_filter_sets[SYSCALL_FILTER_SET_KNOWN].value) {
+                        int id;
+
+                        id = seccomp_syscall_resolve_name(name);
+                        if (id < 0)
+                                continue;
+
+                        /* Skip the syscall if it is handled by the filter itself */
+                        if (hashmap_contains(filter, INT_TO_PTR(id + 1)))
+                                continue;
+
+                        if (!GREEDY_REALLOC(known, n_known + 1))
+                                return -ENOMEM;
+
+                        known[n_known++] = id;
+                }
+
         SECCOMP_FOREACH_LOCAL_ARCH(arch) {
                 _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
                 void *syscall_id, *val;
@@ -1223,23 +1245,16 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter
                         }
                 }
 
-                if (default_action != default_action_override)
-                        NULSTR_FOREACH(name, syscall_filter_sets[SYSCALL_FILTER_SET_KNOWN].value) {
-                                int id;
-
-                                id = seccomp_syscall_resolve_name(name);
-                                if (id < 0)
-                                        continue;
-
-                                /* Ignore the syscall if it was already handled above */
-                                if (hashmap_contains(filter, INT_TO_PTR(id + 1)))
-                                        continue;
+                FOREACH_ARRAY(id, known, n_known) {
+                        r = seccomp_rule_add_exact(seccomp, default_action, *id, 0);
+                        if (r < 0 && r != -EDOM) { /* EDOM means that the syscall is not available for arch */
+                                _cleanup_free_ char *n = NULL;
 
-                                r = seccomp_rule_add_exact(seccomp, default_action, id, 0);
-                                if (r < 0 && r != -EDOM)  /* EDOM means that the syscall is not available for arch */
-                                        return log_debug_errno(r, "Failed to add rule for system call %s() / %d: %m",
-                                                               name, id);
+                                n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, *id);
+                                return log_debug_errno(r, "Failed to add rule for system call %s() / %d: %m",
+                                                       strna(n), *id);
                         }
+                }
 
 #if (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 5) || SCMP_VER_MAJOR > 2
                 /* We have a large filter here, so let's turn on the binary tree mode if possible. */
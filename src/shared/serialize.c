@@ -316,7 +316,8 @@ int deserialize_read_line(FILE *f, char **ret) {
         assert(f);
         assert(ret);
 
-        r = read_stripped_line(f, LONG_LINE_MAX, &line);
+        /* Serialization is never read from a TTY, tell read_line() so that it doesn't check for each line */
+        r = read_stripped_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, &line);
         if (r < 0)
                 return log_error_errno(r, "Failed to read serialization line: %m");
         if (r == 0) { /* eof */
@@ -560,6 +561,7 @@ int open_serialization_fd(const char *ident) {
 int open_serialization_file(const char *ident, FILE **ret) {
         _cleanup_fclose_ FILE *f = NULL;
         _cleanup_close_ int fd;
+        int r;
 
         assert(ret);
 
@@ -567,9 +569,10 @@ int open_serialization_file(const char *ident, FILE **ret) {
         if (fd < 0)
                 return fd;
 
-        f = take_fdopen(&fd, "w+");
-        if (!f)
-                return -errno;
+        /* Only ever accessed from a single thread, no need to lock the stream for each call */
+        r = take_fdopen_unlocked(&fd, "w+", &f);
+        if (r < 0)
+                return r;
 
         *ret = TAKE_PTR(f);
         return 0;
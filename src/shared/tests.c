@@ -114,6 +114,58 @@ bool slow_tests_enabled(void) {
         return SYSTEMD_SLOW_TESTS_DEFAULT;
 }
 
+bool benchmark_json_enabled(void) {
+        int r;
+
+        r = getenv_bool("SYSTEMD_BENCHMARK_JSON");
+        if (r >= 0)
+                return r;
+
+        if (r != -ENXIO)
+                log_warning_errno(r, "Cannot parse $SYSTEMD_BENCHMARK_JSON, ignoring.");
+        return false;
+}
+
+int benchmark_report_json(
+                const char *benchmark,
+                const char *parameter,
+                uint64_t n_ops,
+                usec_t duration,
+                const usec_t *latencies,
+                size_t n_latencies,
+                sd_json_variant *extra) {
+
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(benchmark);
+        assert(parameter);
+        assert(latencies || n_latencies == 0);
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_STRING("suite", program_invocation_short_name),
+                        SD_JSON_BUILD_PAIR_STRING("benchmark", benchmark),
+                        SD_JSON_BUILD_PAIR_STRING("parameter", parameter),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("operations", n_ops),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("durationUSec", duration),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("operationsPerSecond", n_ops * USEC_PER_SEC / MAX(duration, 1u)),
+                        SD_JSON_BUILD_PAIR_CONDITION(n_latencies > 0, "latencyP50USec",
+                                                     SD_JSON_BUILD_UNSIGNED(n_latencies > 0 ? latencies[n_latencies / 2] : 0)),
+                        SD_JSON_BUILD_PAIR_CONDITION(n_latencies > 0, "latencyP99USec",
+                                                     SD_JSON_BUILD_UNSIGNED(n_latencies > 0 ? latencies[n_latencies * 99 / 100] : 0)));
+        if (r < 0)
+                return r;
+
+        if (extra) {
+                r = sd_json_variant_merge_object(&v, extra);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_json_variant_dump(v, SD_JSON_FORMAT_NEWLINE|SD_JSON_FORMAT_FLUSH, stdout, /* prefix = */ NULL);
+}
+
 void test_setup_logging(int level) {
         log_set_assert_return_is_critical(true);
         log_set_max_level(level);
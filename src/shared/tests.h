@@ -6,6 +6,7 @@
 #include <unistd.h>
 
 #include "sd-daemon.h"
+#include "sd-json.h"
 
 #include "argv-util.h"
 #include "errno-util.h"
@@ -56,6 +57,20 @@ const char* get_catalog_dir(void);
 bool slow_tests_enabled(void);
 void test_setup_logging(int level);
 
+/* Benchmarks print one tab separated line per result by default, with columns specific to each of them. If
+ * $SYSTEMD_BENCHMARK_JSON=1 is set, as done by "meson test --benchmark", they print one JSON object per line
+ * instead, in the same format for all of them, so that results can be collected and compared between
+ * builds. The latencies must be sorted, extra fields may be passed in an object. */
+bool benchmark_json_enabled(void);
+int benchmark_report_json(
+                const char *benchmark,
+                const char *parameter,
+                uint64_t n_ops,
+                usec_t duration,
+                const usec_t *latencies,
+                size_t n_latencies,
+                sd_json_variant *extra);
+
 #define log_tests_skipped(fmt, ...)                                     \
         ({                                                              \
                 log_notice("%s: " fmt ", skipping tests.",              \
@@ -5,15 +5,19 @@
 #include "chase.h"
 #include "dirent-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "initrd-util.h"
 #include "macro.h"
 #include "path-lookup.h"
+#include "path-util.h"
 #include "set.h"
+#include "sparse-endian.h"
 #include "special.h"
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 int unit_symlink_name_compatible(const char *symlink, const char *target, bool instance_propagation) {
@@ -358,6 +362,322 @@ int unit_file_resolve_symlink(
         return !tail;  /* true if linked unit file */
 }
 
+/* The name maps are also stored in a cache file in the runtime directory, so that other processes (most
+ * importantly systemctl) and later daemon-reloads don't have to scan all unit directories again. The file is
+ * keyed by a hash over the search path and the inode numbers and modification times of all its directories,
+ * including the ones excluded from the timestamp hash above, and is only used if that key matches. Changes
+ * that leave the directories alone, e.g. a unit file truncated to mask it, are caught by a stamp stored with
+ * each entry of the id map, see name_map_cache_stamp(), which is checked again when loading. The file
+ * consists of a header followed by NUL-terminated strings: the id map as tuples of name, path, the file in
+ * the unit directory the entry was derived from, and its stamp, the name map as a name followed by its
+ * aliases and an empty string, and the path cache. */
+
+#define NAME_MAP_CACHE_MAGIC "SDUNMAP2"
+
+typedef struct NameMapCacheHeader {
+        uint8_t magic[8];
+        le64_t key;
+        le64_t n_ids;
+        le64_t n_names;
+        le64_t n_paths;
+} NameMapCacheHeader;
+
+static int name_map_cache_path(const LookupPaths *lp, char **ret) {
+        _cleanup_free_ char *d = NULL;
+        int r;
+
+        assert(lp);
+        assert(ret);
+
+        /* Don't leave a cache behind in other roots, and the runtime directory of the scope's manager is
+         * where it belongs, i.e. /run/systemd/ or $XDG_RUNTIME_DIR/systemd/ */
+        if (lp->root_dir || !lp->runtime_config)
+                return -EOPNOTSUPP;
+
+        r = path_extract_directory(lp->runtime_config, &d);
+        if (r < 0)
+                return r;
+
+        char *p = path_join(d, "unit-name-map.cache");
+        if (!p)
+                return -ENOMEM;
+
+        *ret = p;
+        return 0;
+}
+
+static uint64_t name_map_cache_key(const LookupPaths *lp) {
+        struct siphash state;
+
+        assert(lp);
+
+        siphash24_init(&state, HASH_KEY.bytes);
+
+        STRV_FOREACH(dir, lp->search_path) {
+                struct stat st;
+
+                siphash24_compress(*dir, strlen(*dir) + 1, &state);
+
+                if (stat(*dir, &st) < 0) {
+                        siphash24_compress_boolean(false, &state);
+                        continue;
+                }
+
+                nsec_t mtime = timespec_load_nsec(&st.st_mtim);
+
+                siphash24_compress_boolean(true, &state);
+                siphash24_compress_typesafe(st.st_dev, &state);
+                siphash24_compress_typesafe(st.st_ino, &state);
+                siphash24_compress_typesafe(mtime, &state);
+        }
+
+        return siphash24_finalize(&state);
+}
+
+static int name_map_cache_stamp(const char *path, char **ret) {
+        struct stat lst, st;
+
+        assert(path);
+        assert(ret);
+
+        /* Identifies the file or symlink an id map entry was derived from, what it eventually points to, and
+         * whether that masks the unit. Replacing the symlink, or truncating the unit file or its target to
+         * mask it, changes the stamp even if the mtimes of the unit directories stay the same. */
+
+        if (lstat(path, &lst) < 0)
+                return -errno;
+
+        if (stat(path, &st) < 0) {
+                if (errno != ENOENT)
+                        return -errno;
+
+                /* A dangling symlink */
+                return asprintf(ret, "%" PRIx64 ":%" PRIx64, (uint64_t) lst.st_dev, (uint64_t) lst.st_ino) < 0 ? -ENOMEM : 0;
+        }
+
+        return asprintf(ret, "%" PRIx64 ":%" PRIx64 ":%" PRIx64 ":%" PRIx64 ":%i",
+                        (uint64_t) lst.st_dev, (uint64_t) lst.st_ino,
+                        (uint64_t) st.st_dev, (uint64_t) st.st_ino,
+                        null_or_empty(&st)) < 0 ? -ENOMEM : 0;
+}
+
+static const char* name_map_cache_next(const char **p, const char *end) {
+        const char *s = *p, *e;
+
+        /* Returns the next string of the cache, or NULL if the file is truncated */
+        if (s >= end)
+                return NULL;
+
+        e = memchr(s, 0, end - s);
+        if (!e)
+                return NULL;
+
+        *p = e + 1;
+        return s;
+}
+
+static int name_map_cache_load(
+                const LookupPaths *lp,
+                uint64_t key,
+                Hashmap **ret_ids,
+                Hashmap **ret_names,
+                Set **ret_paths) {
+
+        _cleanup_(file_view_done) FileView v = {};
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_set_free_ Set *paths = NULL;
+        _cleanup_free_ char *fn = NULL;
+        const NameMapCacheHeader *h;
+        const char *p, *end;
+        int r;
+
+        assert(ret_ids);
+        assert(ret_names);
+
+        r = name_map_cache_path(lp, &fn);
+        if (r < 0)
+                return r;
+
+        r = read_full_file_view(fn, &v);
+        if (r < 0)
+                return r;
+
+        if (v.size < sizeof(NameMapCacheHeader))
+                return -EBADMSG;
+
+        h = (const NameMapCacheHeader*) v.data;
+        if (memcmp(h->magic, NAME_MAP_CACHE_MAGIC, sizeof(h->magic)) != 0)
+                return -EBADMSG;
+        if (le64toh(h->key) != key)
+                return -ESTALE;
+
+        p = v.data + sizeof(NameMapCacheHeader);
+        end = v.data + v.size;
+
+        for (uint64_t i = 0; i < le64toh(h->n_ids); i++) {
+                _cleanup_free_ char *k = NULL, *d = NULL, *stamp = NULL;
+                const char *a, *b, *src, *expected;
+
+                a = name_map_cache_next(&p, end);
+                b = name_map_cache_next(&p, end);
+                src = name_map_cache_next(&p, end);
+                expected = name_map_cache_next(&p, end);
+                if (!a || !b || !src || !expected)
+                        return -EBADMSG;
+
+                r = name_map_cache_stamp(src, &stamp);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0 || !streq(stamp, expected)) {
+                        log_debug("%s changed since the unit name map cache was written, not using it.", src);
+                        return -ESTALE;
+                }
+
+                k = strdup(a);
+                d = strdup(b);
+                if (!k || !d)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(&ids, &trusted_string_hash_ops_free_free, k, d);
+                if (r < 0)
+                        return r;
+                TAKE_PTR(k);
+                TAKE_PTR(d);
+        }
+
+        for (uint64_t i = 0; i < le64toh(h->n_names); i++) {
+                const char *a, *b;
+
+                a = name_map_cache_next(&p, end);
+                if (!a)
+                        return -EBADMSG;
+
+                for (;;) {
+                        b = name_map_cache_next(&p, end);
+                        if (!b)
+                                return -EBADMSG;
+                        if (isempty(b))
+                                break;
+
+                        r = string_strv_hashmap_put(&names, a, b);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        if (ret_paths) {
+                paths = set_new(&path_hash_ops_free);
+                if (!paths)
+                        return -ENOMEM;
+
+                for (uint64_t i = 0; i < le64toh(h->n_paths); i++) {
+                        const char *a;
+
+                        a = name_map_cache_next(&p, end);
+                        if (!a)
+                                return -EBADMSG;
+
+                        r = set_put_strdup(&paths, a);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        log_debug("Loaded unit name map from %s.", fn);
+
+        *ret_ids = TAKE_PTR(ids);
+        *ret_names = TAKE_PTR(names);
+        if (ret_paths)
+                *ret_paths = TAKE_PTR(paths);
+        return 0;
+}
+
+static int name_map_cache_save(
+                const LookupPaths *lp,
+                uint64_t key,
+                Hashmap *ids,
+                Hashmap *sources,
+                Hashmap *names,
+                Set *paths) {
+
+        _cleanup_(unlink_and_freep) char *t = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *fn = NULL;
+        const char *k, *d;
+        char **l;
+        int r;
+
+        r = name_map_cache_path(lp, &fn);
+        if (r < 0)
+                return r;
+
+        r = fopen_temporary(fn, &f, &t);
+        if (r < 0)
+                return r;
+
+        if (fchmod(fileno(f), 0644) < 0)
+                return -errno;
+
+        NameMapCacheHeader h = {
+                .key = htole64(key),
+                .n_ids = htole64(hashmap_size(ids)),
+                .n_names = htole64(hashmap_size(names)),
+                .n_paths = htole64(set_size(paths)),
+        };
+        memcpy(h.magic, NAME_MAP_CACHE_MAGIC, sizeof(h.magic));
+
+        fwrite(&h, sizeof(h), 1, f);
+
+        HASHMAP_FOREACH_KEY(d, k, ids) {
+                _cleanup_free_ char *stamp = NULL;
+                const char *src;
+
+                src = hashmap_get(sources, k);
+                if (!src)
+                        return -EINVAL;
+
+                r = name_map_cache_stamp(src, &stamp);
+                if (r < 0)
+                        return r;
+
+                fputs(k, f);
+                fputc(0, f);
+                fputs(d, f);
+                fputc(0, f);
+                fputs(src, f);
+                fputc(0, f);
+                fputs(stamp, f);
+                fputc(0, f);
+        }
+
+        HASHMAP_FOREACH_KEY(l, k, names) {
+                fputs(k, f);
+                fputc(0, f);
+                STRV_FOREACH(i, l) {
+                        fputs(*i, f);
+                        fputc(0, f);
+                }
+                fputc(0, f);
+        }
+
+        SET_FOREACH(k, paths) {
+                fputs(k, f);
+                fputc(0, f);
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (rename(t, fn) < 0)
+                return -errno;
+
+        t = mfree(t);
+
+        log_debug("Stored unit name map in %s.", fn);
+        return 0;
+}
+
 int unit_file_build_name_map(
                 const LookupPaths *lp,
                 uint64_t *cache_timestamp_hash,
@@ -375,10 +695,10 @@ int unit_file_build_name_map(
          * and output. Existing contents will be freed before the new contents are stored.
          */
 
-        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL, *sources = NULL;
         _cleanup_set_free_free_ Set *paths = NULL;
         _cleanup_strv_free_ char **expanded_search_path = NULL;
-        uint64_t timestamp_hash;
+        uint64_t timestamp_hash, cache_key;
         int r;
 
         /* Before doing anything, check if the timestamp hash that was passed is still valid.
@@ -388,7 +708,19 @@ int unit_file_build_name_map(
                 return 0;
 
         /* The timestamp hash is now set based on the mtimes from before when we start reading files.
-         * If anything is modified concurrently, we'll consider the cache outdated. */
+         * If anything is modified concurrently, we'll consider the cache outdated. The same applies to the
+         * key of the cache file. */
+        cache_key = name_map_cache_key(lp);
+
+        /* A zero timestamp hash means the caller explicitly asked for a rescan, as the service manager
+         * does on daemon-reload. Don't use the cache file then, the result of the scan replaces it below. */
+        if (!cache_timestamp_hash || *cache_timestamp_hash != 0) {
+                r = name_map_cache_load(lp, cache_key, &ids, &names, path_cache ? &paths : NULL);
+                if (r >= 0)
+                        goto finish;
+                if (!IN_SET(r, -ENOENT, -ESTALE, -EOPNOTSUPP))
+                        log_debug_errno(r, "Failed to load unit name map cache, ignoring: %m");
+        }
 
         if (path_cache) {
                 paths = set_new(&path_hash_ops_free);
@@ -556,11 +888,21 @@ int unit_file_build_name_map(
                         if (!key)
                                 return log_oom();
 
-                        r = hashmap_ensure_put(&ids, &string_hash_ops_free_free, key, dst);
+                        /* The unit search path is only writable by privileged users (or by the user
+                         * themselves, for the user manager), hence the names are not hash flooding
+                         * material. */
+                        r = hashmap_ensure_put(&ids, &trusted_string_hash_ops_free_free, key, dst);
                         if (r < 0)
                                 return log_warning_errno(r, "Failed to add entry to hashmap (%s%s%s): %m",
                                                          de->d_name, special_glyph(SPECIAL_GLYPH_ARROW_RIGHT), dst);
                         key = dst = NULL;
+
+                        /* Remember where the entry came from, for the cache file */
+                        if (paths) {
+                                r = hashmap_put_strdup(&sources, de->d_name, filename);
+                                if (r < 0)
+                                        return log_oom();
+                        }
                 }
         }
 
@@ -605,6 +947,14 @@ int unit_file_build_name_map(
                                                  dst, special_glyph(SPECIAL_GLYPH_ARROW_RIGHT), src);
         }
 
+        /* Only store complete maps, i.e. only if the path cache was requested, too */
+        if (paths) {
+                r = name_map_cache_save(lp, cache_key, ids, sources, names, paths);
+                if (r < 0 && r != -EOPNOTSUPP)
+                        log_debug_errno(r, "Failed to store unit name map cache, ignoring: %m");
+        }
+
+finish:
         if (cache_timestamp_hash)
                 *cache_timestamp_hash = timestamp_hash;
 
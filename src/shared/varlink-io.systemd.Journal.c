@@ -7,6 +7,23 @@ static SD_VARLINK_DEFINE_METHOD(Rotate);
 static SD_VARLINK_DEFINE_METHOD(FlushToVar);
 static SD_VARLINK_DEFINE_METHOD(RelinquishVar);
 
+static SD_VARLINK_DEFINE_STRUCT_TYPE(
+                SourceStatistics,
+                SD_VARLINK_DEFINE_FIELD(source, SD_VARLINK_STRING, 0),
+                SD_VARLINK_DEFINE_FIELD(messages, SD_VARLINK_INT, 0),
+                SD_VARLINK_DEFINE_FIELD(bytes, SD_VARLINK_INT, 0));
+
+static SD_VARLINK_DEFINE_METHOD(
+                GetStatistics,
+                SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(sources, SourceStatistics, SD_VARLINK_ARRAY),
+                SD_VARLINK_DEFINE_OUTPUT(suppressed, SD_VARLINK_INT, 0),
+                SD_VARLINK_DEFINE_OUTPUT(writeFailed, SD_VARLINK_INT, 0),
+                SD_VARLINK_DEFINE_OUTPUT(appendLatencyHistogramUSec, SD_VARLINK_INT, SD_VARLINK_ARRAY),
+                SD_VARLINK_DEFINE_OUTPUT(clientContextCacheHits, SD_VARLINK_INT, 0),
+                SD_VARLINK_DEFINE_OUTPUT(clientContextCacheMisses, SD_VARLINK_INT, 0),
+                SD_VARLINK_DEFINE_OUTPUT(mmapCacheHits, SD_VARLINK_INT, 0),
+                SD_VARLINK_DEFINE_OUTPUT(mmapCacheMisses, SD_VARLINK_INT, 0));
+
 static SD_VARLINK_DEFINE_ERROR(NotSupportedByNamespaces);
 
 SD_VARLINK_DEFINE_INTERFACE(
@@ -16,4 +33,6 @@ SD_VARLINK_DEFINE_INTERFACE(
                 &vl_method_Rotate,
                 &vl_method_FlushToVar,
                 &vl_method_RelinquishVar,
+                &vl_method_GetStatistics,
+                &vl_type_SourceStatistics,
                 &vl_error_NotSupportedByNamespaces);
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "varlink-io.systemd.Manager.h"
+
+static SD_VARLINK_DEFINE_METHOD_FULL(
+                ListUnitStatistics,
+                SD_VARLINK_SUPPORTS_MORE,
+                SD_VARLINK_FIELD_COMMENT("If non-null the name of the unit to report on, otherwise all loaded units are reported on"),
+                SD_VARLINK_DEFINE_INPUT(name, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The name of the unit"),
+                SD_VARLINK_DEFINE_OUTPUT(name, SD_VARLINK_STRING, 0),
+                SD_VARLINK_FIELD_COMMENT("Number of notification messages received from the unit's processes"),
+                SD_VARLINK_DEFINE_OUTPUT(notifyMessages, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("Number of D-Bus object lookups for the unit, caused by method calls and property reads"),
+                SD_VARLINK_DEFINE_OUTPUT(busLookups, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("Number of D-Bus change signals emitted for the unit"),
+                SD_VARLINK_DEFINE_OUTPUT(changeSignals, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("Number of times the unit's control group was realized"),
+                SD_VARLINK_DEFINE_OUTPUT(cgroupRealizations, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("Number of times the unit was loaded"),
+                SD_VARLINK_DEFINE_OUTPUT(loads, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("Number of times the unit was checked by the garbage collector"),
+                SD_VARLINK_DEFINE_OUTPUT(gcChecks, SD_VARLINK_INT, 0));
+
+static SD_VARLINK_DEFINE_ERROR(NoSuchUnit);
+static SD_VARLINK_DEFINE_ERROR(StatisticsDisabled);
+
+SD_VARLINK_DEFINE_INTERFACE(
+                io_systemd_Manager,
+                "io.systemd.Manager",
+                SD_VARLINK_INTERFACE_COMMENT("Introspection of the service manager"),
+                SD_VARLINK_SYMBOL_COMMENT("Returns counters of the work the service manager did on behalf of units since it was last reloaded"),
+                &vl_method_ListUnitStatistics,
+                SD_VARLINK_SYMBOL_COMMENT("No unit by the specified name is loaded"),
+                &vl_error_NoSuchUnit,
+                SD_VARLINK_SYMBOL_COMMENT("The service manager doesn't collect unit statistics, because $SYSTEMD_UNIT_STATISTICS=1 is not set for it"),
+                &vl_error_StatisticsDisabled);
@@ -26,6 +26,7 @@
 #include "process-util.h"
 #include "random-util.h"
 #include "signal-util.h"
+#include "string-util.h"
 #include "umount.h"
 #include "virt.h"
 
@@ -47,6 +48,29 @@ void mount_points_list_free(MountPoint **head) {
                 mount_point_free(head, *head);
 }
 
+static bool mount_point_below_remote_fs(struct libmnt_table *table, struct libmnt_fs *fs) {
+        assert(table);
+        assert(fs);
+
+        /* Returns true if any of the mounts above this one is a network or FUSE file system. Resolving the
+         * path of the mount point means looking up each of the path components on them, and that can hang
+         * if the server or the FUSE daemon went away. */
+
+        for (;;) {
+                struct libmnt_fs *parent = NULL;
+                const char *fstype;
+
+                if (mnt_table_get_parent_fs(table, fs, &parent) < 0 || !parent || parent == fs)
+                        return false;
+
+                fstype = mnt_fs_get_fstype(parent);
+                if (fstype && (fstype_is_network(fstype) || startswith(fstype, "fuse")))
+                        return true;
+
+                fs = parent;
+        }
+}
+
 int mount_points_list_get(const char *mountinfo, MountPoint **head) {
         _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
         _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
@@ -152,6 +176,7 @@ int mount_points_list_get(const char *mountinfo, MountPoint **head) {
                         /* Unmount sysfs/procfs/… lazily, since syncing doesn't matter there, and it's OK if
                          * something keeps an fd open to it. */
                         .umount_lazily = is_api_vfs,
+                        .below_remote_fs = is_api_vfs && mount_point_below_remote_fs(table, fs),
                         .leaf = leaf,
                 };
 
@@ -295,15 +320,48 @@ static int remount_with_timeout(MountPoint *m, bool last_try) {
         return r;
 }
 
+static int umount_one(MountPoint *m, bool last_try) {
+        int r;
+
+        assert(m);
+
+        log_info("Unmounting '%s'.", m->path);
+
+        /* Using MNT_FORCE causes some filesystems (e.g. FUSE and NFS and other network filesystems) to abort
+         * any pending requests and return -EIO rather than blocking indefinitely. If the filesysten is
+         * "busy", this may allow processes to die, thus making the filesystem less busy so the unmount
+         * might succeed (rather than return EBUSY). */
+        r = RET_NERRNO(umount2(m->path,
+                               UMOUNT_NOFOLLOW | /* Don't follow symlinks: this should never happen unless our mount list was wrong */
+                               (m->umount_lazily ? MNT_DETACH : MNT_FORCE)));
+        if (r < 0) {
+                log_full_errno(last_try ? LOG_ERR : LOG_INFO, r, "Failed to unmount %s: %m", m->path);
+
+                if (r == -EBUSY && last_try)
+                        log_umount_blockers(m->path);
+        }
+
+        return r;
+}
+
 static int umount_with_timeout(MountPoint *m, bool last_try) {
         _cleanup_close_pair_ int pfd[2] = EBADF_PAIR;
         _cleanup_(sigkill_nowaitp) pid_t pid = 0;
         int r;
 
-        BLOCK_SIGNALS(SIGCHLD);
-
         assert(m);
 
+        /* API file systems are detached lazily, which only removes them from the mount tree and neither
+         * waits for them to become unused nor does any I/O on them. There are typically many of them (think
+         * of the /proc, /sys, /dev and /tmp mounts of every container), so don't pay for a fork and a
+         * timeout for each one. Resolving the mount point path still walks the file systems above it
+         * though, which can hang if one of them is a network or FUSE file system, hence keep the timeout
+         * in that case. */
+        if (m->umount_lazily && !m->below_remote_fs)
+                return umount_one(m, last_try);
+
+        BLOCK_SIGNALS(SIGCHLD);
+
         r = pipe2(pfd, O_CLOEXEC|O_NONBLOCK);
         if (r < 0)
                 return r;
@@ -319,23 +377,8 @@ static int umount_with_timeout(MountPoint *m, bool last_try) {
         if (r == 0) {
                 pfd[0] = safe_close(pfd[0]);
 
-                log_info("Unmounting '%s'.", m->path);
-
-                /* Start the mount operation here in the child Using MNT_FORCE causes some filesystems
-                 * (e.g. FUSE and NFS and other network filesystems) to abort any pending requests and return
-                 * -EIO rather than blocking indefinitely. If the filesysten is "busy", this may allow
-                 * processes to die, thus making the filesystem less busy so the unmount might succeed
-                 * (rather than return EBUSY). */
-                r = RET_NERRNO(umount2(m->path,
-                                       UMOUNT_NOFOLLOW | /* Don't follow symlinks: this should never happen unless our mount list was wrong */
-                                       (m->umount_lazily ? MNT_DETACH : MNT_FORCE)));
-                if (r < 0) {
-                        log_full_errno(last_try ? LOG_ERR : LOG_INFO, r, "Failed to unmount %s: %m", m->path);
-
-                        if (r == -EBUSY && last_try)
-                                log_umount_blockers(m->path);
-                }
-
+                /* Start the umount operation here in the child */
+                r = umount_one(m, last_try);
                 report_errno_and_exit(pfd[1], r);
         }
 
@@ -18,6 +18,7 @@ typedef struct MountPoint {
         unsigned long remount_flags;
         bool try_remount_ro;
         bool umount_lazily;
+        bool below_remote_fs;
         bool leaf;
         LIST_FIELDS(struct MountPoint, mount_point);
 } MountPoint;
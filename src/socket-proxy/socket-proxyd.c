@@ -30,10 +30,22 @@
 
 #define BUFFER_SIZE (256 * 1024)
 
+/* Empty pipe buffers of closed connections we keep around for reuse by the next connections, so that
+ * we don't have to allocate and size two new pipes for every connection. */
+#define SPARE_PIPES_MAX 16U
+
+/* How many connections to accept() in one go, before returning to the event loop */
+#define ACCEPT_BATCH_MAX 16U
+
 static unsigned arg_connections_max = 256;
 static const char *arg_remote_host = NULL;
 static usec_t arg_exit_idle_time = USEC_INFINITY;
 
+typedef struct SparePipe {
+        int fds[2];
+        size_t size;
+} SparePipe;
+
 typedef struct Context {
         sd_event *event;
         sd_resolve *resolve;
@@ -41,6 +53,9 @@ typedef struct Context {
 
         Set *listen;
         Set *connections;
+
+        SparePipe spare_pipes[SPARE_PIPES_MAX];
+        size_t n_spare_pipes;
 } Context;
 
 typedef struct Connection {
@@ -58,6 +73,23 @@ typedef struct Connection {
         sd_resolve_query *resolve_query;
 } Connection;
 
+static void context_release_pipe(Context *context, int buffer[static 2], size_t full, size_t size) {
+        assert(buffer);
+
+        /* Only pipes that have been fully drained can be handed to another connection */
+        if (context && buffer[0] >= 0 && full == 0 && context->n_spare_pipes < SPARE_PIPES_MAX) {
+                context->spare_pipes[context->n_spare_pipes++] = (SparePipe) {
+                        .fds = { buffer[0], buffer[1] },
+                        .size = size,
+                };
+
+                buffer[0] = buffer[1] = -EBADF;
+                return;
+        }
+
+        safe_close_pair(buffer);
+}
+
 static void connection_free(Connection *c) {
         assert(c);
 
@@ -70,8 +102,8 @@ static void connection_free(Connection *c) {
         safe_close(c->server_fd);
         safe_close(c->client_fd);
 
-        safe_close_pair(c->server_to_client_buffer);
-        safe_close_pair(c->client_to_server_buffer);
+        context_release_pipe(c->context, c->server_to_client_buffer, c->server_to_client_buffer_full, c->server_to_client_buffer_size);
+        context_release_pipe(c->context, c->client_to_server_buffer, c->client_to_server_buffer_full, c->client_to_server_buffer_size);
 
         sd_resolve_query_unref(c->resolve_query);
 
@@ -128,6 +160,10 @@ static void context_clear(Context *context) {
         set_free_with_destructor(context->listen, sd_event_source_unref);
         set_free_with_destructor(context->connections, connection_free);
 
+        FOREACH_ARRAY(p, context->spare_pipes, context->n_spare_pipes)
+                safe_close_pair(p->fds);
+        context->n_spare_pipes = 0;
+
         sd_event_unref(context->event);
         sd_resolve_unref(context->resolve);
         sd_event_source_unref(context->idle_time);
@@ -143,6 +179,15 @@ static int connection_create_pipes(Connection *c, int buffer[static 2], size_t *
         if (buffer[0] >= 0)
                 return 0;
 
+        if (c->context->n_spare_pipes > 0) {
+                SparePipe *p = c->context->spare_pipes + --c->context->n_spare_pipes;
+
+                buffer[0] = TAKE_FD(p->fds[0]);
+                buffer[1] = TAKE_FD(p->fds[1]);
+                *sz = p->size;
+                return 0;
+        }
+
         r = pipe2(buffer, O_CLOEXEC|O_NONBLOCK);
         if (r < 0)
                 return log_error_errno(errno, "Failed to allocate pipe buffer: %m");
@@ -501,21 +546,32 @@ static int add_connection_socket(Context *context, int fd) {
 }
 
 static int accept_cb(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
-        _cleanup_free_ char *peer = NULL;
         Context *context = ASSERT_PTR(userdata);
-        int nfd = -EBADF, r;
+        int r;
 
         assert(s);
         assert(fd >= 0);
         assert(revents & EPOLLIN);
 
-        nfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
-        if (nfd < 0) {
-                if (!ERRNO_IS_ACCEPT_AGAIN(errno))
-                        log_warning_errno(errno, "Failed to accept() socket: %m");
-        } else {
-                (void) getpeername_pretty(nfd, true, &peer);
-                log_debug("New connection from %s", strna(peer));
+        /* Under load, take a few connections off the queue per wakeup, instead of going through
+         * epoll_wait() and re-arming the listener for each one, but not so many that we'd starve other
+         * processes accept()ing on the same socket. */
+        for (unsigned i = 0; i < ACCEPT_BATCH_MAX; i++) {
+                int nfd;
+
+                nfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
+                if (nfd < 0) {
+                        if (!ERRNO_IS_ACCEPT_AGAIN(errno))
+                                log_warning_errno(errno, "Failed to accept() socket: %m");
+                        break;
+                }
+
+                if (DEBUG_LOGGING) {
+                        _cleanup_free_ char *peer = NULL;
+
+                        (void) getpeername_pretty(nfd, true, &peer);
+                        log_debug("New connection from %s", strna(peer));
+                }
 
                 r = add_connection_socket(context, nfd);
                 if (r < 0) {
@@ -30,6 +30,7 @@
 #include "format-table.h"
 #include "fs-util.h"
 #include "hashmap.h"
+#include "hexdecoct.h"
 #include "initrd-util.h"
 #include "log.h"
 #include "main-func.h"
@@ -46,9 +47,11 @@
 #include "process-util.h"
 #include "rm-rf.h"
 #include "selinux-util.h"
+#include "sha256.h"
 #include "sort-util.h"
 #include "string-table.h"
 #include "string-util.h"
+#include "strv.h"
 #include "terminal-util.h"
 #include "user-util.h"
 #include "varlink-io.systemd.sysext.h"
@@ -466,6 +469,33 @@ static int unmerge_subprocess(
         return ret;
 }
 
+static int refresh_state_path(ImageClass image_class, char **ret) {
+        char *p;
+
+        assert(ret);
+
+        /* The state "refresh" leaves behind, so that the next invocation can tell that nothing changed */
+        p = strjoin("/run/systemd/", image_class_info[image_class].short_identifier, ".refresh");
+        if (!p)
+                return log_oom();
+
+        *ret = p;
+        return 0;
+}
+
+static void refresh_state_remove(ImageClass image_class) {
+        _cleanup_free_ char *p = NULL;
+
+        if (!empty_or_root(arg_root))
+                return;
+
+        if (refresh_state_path(image_class, &p) < 0)
+                return;
+
+        if (unlink(p) < 0 && errno != ENOENT)
+                log_debug_errno(errno, "Failed to remove '%s', ignoring: %m", p);
+}
+
 static int unmerge(
                 ImageClass image_class,
                 char **hierarchies,
@@ -474,6 +504,8 @@ static int unmerge(
         bool need_to_reload;
         int r;
 
+        refresh_state_remove(image_class);
+
         r = need_reload(image_class, hierarchies, no_reload);
         if (r < 0)
                 return r;
@@ -2180,6 +2212,232 @@ static int vl_method_merge(sd_varlink *link, sd_json_variant *parameters, sd_var
         return sd_varlink_reply(link, NULL);
 }
 
+static void sha256_process_string(const char *s, struct sha256_ctx *ctx) {
+        s = strempty(s);
+        sha256_process_bytes(s, strlen(s) + 1, ctx);
+}
+
+static int image_compare_by_name(Image * const *a, Image * const *b) {
+        return strcmp((*a)->name, (*b)->name);
+}
+
+static int refresh_fingerprint(
+                ImageClass image_class,
+                char **hierarchies,
+                bool force,
+                int noexec,
+                Hashmap *images,
+                char **ret) {
+
+        _cleanup_free_ char *id = NULL, *version_id = NULL, *level = NULL;
+        _cleanup_free_ Image **sorted = NULL;
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        struct sha256_ctx ctx;
+        size_t n = 0;
+        Image *img;
+        char *h;
+        int r;
+
+        assert(ret);
+
+        /* Calculates a digest of everything that goes into merging the extensions: the images themselves,
+         * the policy they are dissected with, the host OS release data they are matched against, and our
+         * own settings. Returns 0 and NULL if we can't tell reliably whether anything changed, i.e. if
+         * there are directory trees or block devices among the images, whose contents might change without
+         * us noticing. */
+
+        if (!empty_or_root(arg_root) || arg_mutable != MUTABLE_NO)
+                goto unknown;
+
+        sorted = new(Image*, MAX(hashmap_size(images), 1U));
+        if (!sorted)
+                return log_oom();
+
+        HASHMAP_FOREACH(img, images) {
+                if (img->type != IMAGE_RAW)
+                        goto unknown;
+
+                sorted[n++] = img;
+        }
+
+        typesafe_qsort(sorted, n, image_compare_by_name);
+
+        r = parse_os_release(
+                        /* root= */ NULL,
+                        "ID", &id,
+                        "VERSION_ID", &version_id,
+                        image_class_info[image_class].level_env, &level);
+        if (r < 0)
+                return log_error_errno(r, "Failed to acquire 'os-release' data of host: %m");
+
+        sha256_init_ctx(&ctx);
+        sha256_process_string(image_class_to_string(image_class), &ctx);
+        STRV_FOREACH(p, hierarchies)
+                sha256_process_string(*p, &ctx);
+        sha256_process_bytes(&(const int[]) { force, noexec }, 2 * sizeof(int), &ctx);
+        sha256_process_string(id, &ctx);
+        sha256_process_string(version_id, &ctx);
+        sha256_process_string(level, &ctx);
+
+        FOREACH_ARRAY(i, sorted, n) {
+                _cleanup_free_ char *policy = NULL;
+                struct stat st;
+
+                if (stat((*i)->path, &st) < 0)
+                        return log_error_errno(errno, "Failed to stat '%s': %m", (*i)->path);
+
+                r = image_policy_to_string(pick_image_policy(*i), /* simplify= */ true, &policy);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to format image policy: %m");
+
+                sha256_process_string((*i)->name, &ctx);
+                sha256_process_string((*i)->path, &ctx);
+                sha256_process_string(policy, &ctx);
+                sha256_process_bytes(&(const uint64_t[]) {
+                                (uint64_t) st.st_dev,
+                                (uint64_t) st.st_ino,
+                                (uint64_t) st.st_size,
+                                timespec_load_nsec(&st.st_mtim),
+                                timespec_load_nsec(&st.st_ctim),
+                        }, 5 * sizeof(uint64_t), &ctx);
+        }
+
+        sha256_finish_ctx(&ctx, digest);
+
+        h = hexmem(digest, sizeof(digest));
+        if (!h)
+                return log_oom();
+
+        *ret = h;
+        return 1;
+
+unknown:
+        *ret = NULL;
+        return 0;
+}
+
+static int refresh_state_write(ImageClass image_class, char **hierarchies, const char *fingerprint) {
+        _cleanup_free_ char *p = NULL, *buf = NULL;
+        int r;
+
+        assert(fingerprint);
+
+        /* Records the fingerprint of the extensions we just merged, along with the device of each overlayfs
+         * we mounted: if any of them got unmounted or replaced behind our back, we'll notice. */
+
+        buf = strjoin(fingerprint, "\n");
+        if (!buf)
+                return log_oom();
+
+        STRV_FOREACH(h, hierarchies) {
+                _cleanup_free_ char *resolved = NULL;
+                struct stat st;
+
+                r = chase(*h, /* root= */ NULL, 0, &resolved, NULL);
+                if (r == -ENOENT)
+                        continue;
+                if (r < 0)
+                        return log_error_errno(r, "Failed to resolve hierarchy '%s': %m", *h);
+
+                r = is_our_mount_point(image_class, resolved);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        continue;
+
+                if (lstat(resolved, &st) < 0)
+                        return log_error_errno(errno, "Failed to stat '%s': %m", resolved);
+
+                if (strextendf(&buf, DEVNUM_FORMAT_STR " %s\n", DEVNUM_FORMAT_VAL(st.st_dev), *h) < 0)
+                        return log_oom();
+        }
+
+        r = refresh_state_path(image_class, &p);
+        if (r < 0)
+                return r;
+
+        r = write_string_file(p, buf, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC|WRITE_STRING_FILE_AVOID_NEWLINE);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to write '%s': %m", p);
+
+        return 0;
+}
+
+static int refresh_state_matches(ImageClass image_class, char **hierarchies, const char *fingerprint) {
+        _cleanup_free_ char *p = NULL, *buf = NULL;
+        _cleanup_strv_free_ char **lines = NULL;
+        int r;
+
+        assert(fingerprint);
+
+        r = refresh_state_path(image_class, &p);
+        if (r < 0)
+                return r;
+
+        r = read_full_file(p, &buf, NULL);
+        if (r < 0) {
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Failed to read '%s', ignoring: %m", p);
+                return false;
+        }
+
+        lines = strv_split_newlines(buf);
+        if (!lines)
+                return log_oom();
+
+        if (strv_isempty(lines) || !streq(lines[0], fingerprint))
+                return false;
+
+        /* The same extensions are installed as last time, but make sure the very same overlayfs mounts are
+         * still in place, too */
+        STRV_FOREACH(h, hierarchies) {
+                _cleanup_free_ char *resolved = NULL;
+                const char *recorded = NULL;
+                struct stat st;
+                dev_t dev;
+
+                STRV_FOREACH(l, lines + 1) {
+                        const char *e = strchr(*l, ' ');
+                        if (e && streq(e + 1, *h)) {
+                                recorded = *l;
+                                break;
+                        }
+                }
+
+                r = chase(*h, /* root= */ NULL, 0, &resolved, NULL);
+                if (r == -ENOENT) {
+                        if (recorded)
+                                return false;
+                        continue;
+                }
+                if (r < 0)
+                        return log_error_errno(r, "Failed to resolve hierarchy '%s': %m", *h);
+
+                r = is_our_mount_point(image_class, resolved);
+                if (r < 0)
+                        return r;
+                if (!r != !recorded)
+                        return false;
+                if (r == 0)
+                        continue;
+
+                _cleanup_free_ char *d = strndup(recorded, strchr(recorded, ' ') - recorded);
+                if (!d)
+                        return log_oom();
+
+                if (parse_devnum(d, &dev) < 0)
+                        return false;
+
+                if (lstat(resolved, &st) < 0)
+                        return log_error_errno(errno, "Failed to stat '%s': %m", resolved);
+
+                if (st.st_dev != dev)
+                        return false;
+        }
+
+        return true;
+}
+
 static int refresh(
                 ImageClass image_class,
                 char **hierarchies,
@@ -2188,18 +2446,39 @@ static int refresh(
                 int noexec) {
 
         _cleanup_hashmap_free_ Hashmap *images = NULL;
+        _cleanup_free_ char *fingerprint = NULL;
         int r;
 
         r = image_discover_and_read_metadata(image_class, &images);
         if (r < 0)
                 return r;
 
+        r = refresh_fingerprint(image_class, hierarchies, force, noexec, images, &fingerprint);
+        if (r < 0)
+                return r;
+        if (fingerprint && !hashmap_isempty(images)) {
+                r = refresh_state_matches(image_class, hierarchies, fingerprint);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        /* Nothing changed since the last refresh, hence don't tear down and set up the very
+                         * same overlayfs mounts again, which would only invalidate all caches. */
+                        log_info("Installed %s did not change, not refreshing.",
+                                 image_class_info[image_class].short_identifier_plural);
+                        return 0;
+                }
+        }
+
+        refresh_state_remove(image_class);
+
         /* Returns > 0 if it did something, i.e. a new overlayfs is mounted now. When it does so it
          * implicitly unmounts any overlayfs placed there before. Returns == 0 if it did nothing, i.e. no
          * extension images found. In this case the old overlayfs remains in place if there was one. */
         r = merge(image_class, hierarchies, force, no_reload, noexec, images);
         if (r < 0)
                 return r;
+        if (r > 0 && fingerprint)
+                (void) refresh_state_write(image_class, hierarchies, fingerprint);
         if (r == 0) /* No images found? Then unmerge. The goal of --refresh is after all that after having
                      * called there's a guarantee that the merge status matches the installed extensions. */
                 r = unmerge(image_class, hierarchies, no_reload);
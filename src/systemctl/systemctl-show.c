@@ -2057,9 +2057,9 @@ static const char* const systemctl_show_mode_table[_SYSTEMCTL_SHOW_MODE_MAX] = {
 
 DEFINE_PRIVATE_STRING_TABLE_LOOKUP_FROM_STRING(systemctl_show_mode, SystemctlShowMode);
 
-static int show_one(
+static int show_one_message(
                 sd_bus *bus,
-                const char *path,
+                sd_bus_message *reply,
                 const char *unit,
                 SystemctlShowMode show_mode,
                 bool *new_line,
@@ -2178,7 +2178,6 @@ static int show_one(
                 {}
         };
 
-        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
         _cleanup_set_free_ Set *found_properties = NULL;
         _cleanup_(unit_status_info_done) UnitStatusInfo info = {
@@ -2208,19 +2207,14 @@ static int show_one(
         };
         int r;
 
-        assert(path);
+        assert(reply);
         assert(new_line);
 
-        log_debug("Showing one %s", path);
-
-        r = bus_map_all_properties(
-                        bus,
-                        "org.freedesktop.systemd1",
-                        path,
+        r = bus_message_map_all_properties(
+                        reply,
                         show_mode == SYSTEMCTL_SHOW_STATUS ? status_map : property_map,
                         BUS_MAP_BOOLEAN_AS_BOOL,
                         &error,
-                        &reply,
                         &info);
         if (r < 0)
                 return log_error_errno(r, "Failed to get properties: %s", bus_error_message(&error, r));
@@ -2268,6 +2262,108 @@ static int show_one(
         return 0;
 }
 
+static int show_one(
+                sd_bus *bus,
+                const char *path,
+                const char *unit,
+                SystemctlShowMode show_mode,
+                bool *new_line,
+                bool *ellipsized) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        int r;
+
+        assert(path);
+        assert(new_line);
+
+        log_debug("Showing one %s", path);
+
+        r = sd_bus_call_method(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        path,
+                        "org.freedesktop.DBus.Properties",
+                        "GetAll",
+                        &error,
+                        &reply,
+                        "s", "");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get properties: %s", bus_error_message(&error, r));
+
+        return show_one_message(bus, reply, unit, show_mode, new_line, ellipsized);
+}
+
+/* The number of GetAll() calls kept in flight when showing many units */
+#define SHOW_MANY_PIPELINE_MAX 64U
+
+typedef struct ShowManyContext {
+        sd_bus *bus;
+        char **units;
+        SystemctlShowMode show_mode;
+        bool *new_line;
+        bool *ellipsized;
+        int ret;
+} ShowManyContext;
+
+static int show_many_one(sd_bus_message *reply, int error, const sd_bus_error *bus_error, size_t idx, void *userdata) {
+        ShowManyContext *c = ASSERT_PTR(userdata);
+        int r;
+
+        if (error < 0)
+                return log_error_errno(error, "Failed to get properties: %s", bus_error_message(bus_error, error));
+
+        r = show_one_message(c->bus, reply, c->units[idx], c->show_mode, c->new_line, c->ellipsized);
+        if (r < 0)
+                return r;
+        if (r > 0 && c->ret == 0)
+                c->ret = r;
+
+        return 0;
+}
+
+static int show_many(
+                sd_bus *bus,
+                char **units,
+                SystemctlShowMode show_mode,
+                bool *new_line,
+                bool *ellipsized) {
+
+        _cleanup_strv_free_ char **paths = NULL;
+        ShowManyContext c = {
+                .bus = bus,
+                .units = units,
+                .show_mode = show_mode,
+                .new_line = new_line,
+                .ellipsized = ellipsized,
+        };
+        int r;
+
+        assert(bus);
+
+        /* Like show_one() for each of the specified units, but doesn't wait for the properties of one unit
+         * to arrive before asking for those of the next one. */
+
+        STRV_FOREACH(u, units) {
+                r = strv_consume(&paths, unit_dbus_path_from_name(*u));
+                if (r < 0)
+                        return log_oom();
+        }
+
+        r = bus_get_all_properties_pipelined(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        paths,
+                        strv_length(paths),
+                        SHOW_MANY_PIPELINE_MAX,
+                        show_many_one,
+                        &c);
+        if (r < 0)
+                return r;
+
+        return c.ret;
+}
+
 static int show_all(
                 sd_bus *bus,
                 SystemctlShowMode show_mode,
@@ -2276,8 +2372,9 @@ static int show_all(
 
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_free_ UnitInfo *unit_infos = NULL;
+        _cleanup_free_ char **units = NULL;
         unsigned c;
-        int r, ret = 0;
+        int r;
 
         r = get_unit_list(bus, NULL, NULL, &unit_infos, 0, &reply);
         if (r < 0)
@@ -2289,21 +2386,15 @@ static int show_all(
 
         typesafe_qsort(unit_infos, c, unit_info_compare);
 
-        for (const UnitInfo *u = unit_infos; u < unit_infos + c; u++) {
-                _cleanup_free_ char *p = NULL;
-
-                p = unit_dbus_path_from_name(u->id);
-                if (!p)
-                        return log_oom();
+        units = new(char*, c + 1);
+        if (!units)
+                return log_oom();
 
-                r = show_one(bus, p, u->id, show_mode, new_line, ellipsized);
-                if (r < 0)
-                        return r;
-                if (r > 0 && ret == 0)
-                        ret = r;
-        }
+        for (unsigned i = 0; i < c; i++)
+                units[i] = (char*) unit_infos[i].id;
+        units[c] = NULL;
 
-        return ret;
+        return show_many(bus, units, show_mode, new_line, ellipsized);
 }
 
 static int show_system_status(sd_bus *bus) {
@@ -2464,19 +2555,11 @@ int verb_show(int argc, char *argv[], void *userdata) {
                         if (r < 0)
                                 return r;
 
-                        STRV_FOREACH(name, names) {
-                                _cleanup_free_ char *path = NULL;
-
-                                path = unit_dbus_path_from_name(*name);
-                                if (!path)
-                                        return log_oom();
-
-                                r = show_one(bus, path, *name, show_mode, &new_line, &ellipsized);
-                                if (r < 0)
-                                        return r;
-                                if (r > 0 && ret == 0)
-                                        ret = r;
-                        }
+                        r = show_many(bus, names, show_mode, &new_line, &ellipsized);
+                        if (r < 0)
+                                return r;
+                        if (r > 0 && ret == 0)
+                                ret = r;
                 }
         }
 
@@ -116,6 +116,9 @@ typedef struct Context {
         /* A helper set to hold names that are used by database_by_{uid,gid,username,groupname} above. */
         Set *names;
 
+        /* Names of UIDs and GIDs as looked up via NSS, or empty strings if NSS doesn't know them */
+        Hashmap *nss_by_uid, *nss_by_gid;
+
         uid_t search_uid;
         UIDRange *uid_range;
 
@@ -139,6 +142,9 @@ static void context_done(Context *c) {
 
         set_free_free(c->names);
         uid_range_free(c->uid_range);
+
+        hashmap_free(c->nss_by_uid);
+        hashmap_free(c->nss_by_gid);
 }
 
 static void maybe_emit_login_defs_warning(Context *c) {
@@ -1000,6 +1006,76 @@ static int write_files(Context *c) {
         return 0;
 }
 
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(nss_name_hash_ops, void, trivial_hash_func, trivial_compare_func, char, free);
+
+static int nss_cache_put(Hashmap **cache, const void *key, const char *name, const char **ret_name) {
+        _cleanup_free_ char *copy = NULL;
+        int r;
+
+        assert(cache);
+        assert(ret_name);
+
+        copy = strdup(strempty(name));
+        if (!copy)
+                return -ENOMEM;
+
+        r = hashmap_ensure_put(cache, &nss_name_hash_ops, key, copy);
+        if (r < 0)
+                return r;
+
+        *ret_name = TAKE_PTR(copy);
+        return !isempty(*ret_name);
+}
+
+static int nss_uid_lookup(Context *c, uid_t uid, const char **ret_name) {
+        _cleanup_free_ struct passwd *p = NULL;
+        const char *name;
+        int r;
+
+        assert(c);
+
+        /* Looks up a UID via NSS and remembers the result. The same IDs are checked repeatedly, e.g. first
+         * as a candidate for a group and then for the user of the same name, and NSS lookups might involve
+         * IPC or the network. Nothing we do changes their result until the files are written at the end.
+         * Returns > 0 if the UID is known to NSS, 0 if not. */
+
+        name = hashmap_get(c->nss_by_uid, UID_TO_PTR(uid));
+        if (!name) {
+                r = getpwuid_malloc(uid, &p);
+                if (r < 0 && r != -ESRCH)
+                        log_warning_errno(r, "Unexpected failure while looking up UID '" UID_FMT "' via NSS, assuming it doesn't exist: %m", uid);
+
+                return nss_cache_put(&c->nss_by_uid, UID_TO_PTR(uid), r >= 0 ? p->pw_name : NULL, ret_name ?: &name);
+        }
+
+        if (ret_name)
+                *ret_name = name;
+        return !isempty(name);
+}
+
+static int nss_gid_lookup(Context *c, gid_t gid, const char **ret_name) {
+        _cleanup_free_ struct group *g = NULL;
+        const char *name;
+        int r;
+
+        assert(c);
+
+        /* Same as nss_uid_lookup(), but for GIDs */
+
+        name = hashmap_get(c->nss_by_gid, GID_TO_PTR(gid));
+        if (!name) {
+                r = getgrgid_malloc(gid, &g);
+                if (r < 0 && r != -ESRCH)
+                        log_warning_errno(r, "Unexpected failure while looking up GID '" GID_FMT "' via NSS, assuming it doesn't exist: %m", gid);
+
+                return nss_cache_put(&c->nss_by_gid, GID_TO_PTR(gid), r >= 0 ? g->gr_name : NULL, ret_name ?: &name);
+        }
+
+        if (ret_name)
+                *ret_name = name;
+        return !isempty(name);
+}
+
 static int uid_is_ok(
                 Context *c,
                 uid_t uid,
@@ -1037,21 +1113,18 @@ static int uid_is_ok(
 
         /* Let's also check via NSS, to avoid UID clashes over LDAP and such, just in case */
         if (!arg_root) {
-                _cleanup_free_ struct group *g = NULL;
+                const char *n;
 
-                r = getpwuid_malloc(uid, /* ret= */ NULL);
-                if (r >= 0)
-                        return 0;
-                if (r != -ESRCH)
-                        log_warning_errno(r, "Unexpected failure while looking up UID '" UID_FMT "' via NSS, assuming it doesn't exist: %m", uid);
+                r = nss_uid_lookup(c, uid, /* ret_name= */ NULL);
+                if (r != 0)
+                        return r < 0 ? r : 0;
 
                 if (check_with_gid) {
-                        r = getgrgid_malloc((gid_t) uid, &g);
-                        if (r >= 0) {
-                                if (!streq(g->gr_name, name))
-                                        return 0;
-                        } else if (r != -ESRCH)
-                                log_warning_errno(r, "Unexpected failure while looking up GID '" GID_FMT "' via NSS, assuming it doesn't exist: %m", uid);
+                        r = nss_gid_lookup(c, (gid_t) uid, &n);
+                        if (r < 0)
+                                return r;
+                        if (r > 0 && !streq(n, name))
+                                return 0;
                 }
         }
 
@@ -1272,18 +1345,14 @@ static int gid_is_ok(
         }
 
         if (!arg_root) {
-                r = getgrgid_malloc(gid, /* ret= */ NULL);
-                if (r >= 0)
-                        return 0;
-                if (r != -ESRCH)
-                        log_warning_errno(r, "Unexpected failure while looking up GID '" GID_FMT "' via NSS, assuming it doesn't exist: %m", gid);
+                r = nss_gid_lookup(c, gid, /* ret_name= */ NULL);
+                if (r != 0)
+                        return r < 0 ? r : 0;
 
                 if (check_with_uid) {
-                        r = getpwuid_malloc(gid, /* ret= */ NULL);
-                        if (r >= 0)
-                                return 0;
-                        if (r != -ESRCH)
-                                log_warning_errno(r, "Unexpected failure while looking up GID '" GID_FMT "' via NSS, assuming it doesn't exist: %m", gid);
+                        r = nss_uid_lookup(c, (uid_t) gid, /* ret_name= */ NULL);
+                        if (r != 0)
+                                return r < 0 ? r : 0;
                 }
         }
 
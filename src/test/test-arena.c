@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdalign.h>
+
+#include "arena.h"
+#include "strv.h"
+#include "tests.h"
+
+TEST(arena_alloc) {
+        _cleanup_(arena_done) Arena a = {};
+        uint64_t *v[1000];
+
+        ASSERT_EQ(a.n_blocks, 0u);
+
+        /* Small objects are all carved out of a few blocks, and are suitably aligned */
+        for (size_t i = 0; i < ELEMENTSOF(v); i++) {
+                uint8_t *c;
+
+                ASSERT_NOT_NULL(c = arena_alloc(&a, 1));
+                *c = (uint8_t) i;
+                ASSERT_EQ((uintptr_t) c % alignof(max_align_t), 0u);
+
+                ASSERT_NOT_NULL(v[i] = arena_new(&a, uint64_t, 1));
+                *v[i] = i;
+                ASSERT_EQ((uintptr_t) v[i] % alignof(max_align_t), 0u);
+        }
+
+        for (size_t i = 0; i < ELEMENTSOF(v); i++)
+                ASSERT_EQ(*v[i], (uint64_t) i);
+
+        ASSERT_LE(a.n_blocks, 3u);
+
+        /* A large object gets its own block, but allocation continues from the current one after that */
+        uint8_t *large, *p, *q;
+        size_t n;
+
+        ASSERT_NOT_NULL(p = arena_alloc(&a, 8));
+        n = a.n_blocks;
+        ASSERT_NOT_NULL(large = arena_alloc0(&a, 1024 * 1024));
+        ASSERT_EQ(a.n_blocks, n + 1);
+        for (size_t i = 0; i < 1024 * 1024; i++)
+                ASSERT_EQ(large[i], 0);
+
+        ASSERT_NOT_NULL(q = arena_alloc(&a, 8));
+        ASSERT_TRUE(q == p + alignof(max_align_t));
+
+        ASSERT_NULL(arena_new(&a, uint64_t, SIZE_MAX / 4));
+        ASSERT_NULL(arena_alloc(&a, SIZE_MAX));
+
+        arena_done(&a);
+        ASSERT_NULL(a.blocks);
+        ASSERT_EQ(a.n_blocks, 0u);
+
+        /* The arena can be reused after arena_done() */
+        ASSERT_NOT_NULL(arena_alloc(&a, 8));
+        ASSERT_EQ(a.n_blocks, 1u);
+}
+
+TEST(arena_strdup) {
+        _cleanup_(arena_done) Arena a = {};
+        char *s, **l;
+
+        ASSERT_NOT_NULL(s = arena_strdup(&a, "foobar"));
+        ASSERT_STREQ(s, "foobar");
+
+        ASSERT_NOT_NULL(s = arena_strndup(&a, "foobar", 3));
+        ASSERT_STREQ(s, "foo");
+
+        ASSERT_NOT_NULL(s = arena_strndup(&a, "foo", 10));
+        ASSERT_STREQ(s, "foo");
+
+        ASSERT_NOT_NULL(s = arena_strdup(&a, ""));
+        ASSERT_STREQ(s, "");
+
+        ASSERT_NOT_NULL(s = arena_memdup(&a, "a\0b", 3));
+        ASSERT_EQ(memcmp(s, "a\0b", 3), 0);
+
+        ASSERT_NOT_NULL(l = arena_strv_copy(&a, STRV_MAKE("a", "bb", "ccc")));
+        ASSERT_TRUE(strv_equal(l, STRV_MAKE("a", "bb", "ccc")));
+
+        ASSERT_NOT_NULL(l = arena_strv_copy(&a, NULL));
+        ASSERT_TRUE(strv_isempty(l));
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -192,6 +192,28 @@ int main(int argc, char *argv[]) {
         assert_se(SERVICE(u)->exec_command[SERVICE_EXEC_START]->command_next->exec_status.code != CLD_EXITED ||
                   SERVICE(u)->exec_command[SERVICE_EXEC_START]->command_next->exec_status.status != EXIT_SUCCESS);
 
+        /* Units without accounting and with equivalent access rules share their programs, even if the
+         * rules are written differently */
+        Unit *shared[2];
+        FOREACH_ELEMENT(v, shared) {
+                assert_se(*v = unit_new(m, sizeof(Service)));
+                ASSERT_OK(unit_add_name(*v, v == shared ? "shared-a.service" : "shared-b.service"));
+                assert_se(cc = unit_get_cgroup_context(*v));
+                (*v)->perpetual = true;
+                (*v)->load_state = UNIT_LOADED;
+
+                ASSERT_OK(config_parse_in_addr_prefixes((*v)->id, "filename", 1, "Service", 1, "IPAddressDeny", 0, "127.0.0.1/25", &cc->ip_address_deny, NULL));
+                if (v != shared)
+                        ASSERT_OK(config_parse_in_addr_prefixes((*v)->id, "filename", 1, "Service", 1, "IPAddressDeny", 0, "127.0.0.4", &cc->ip_address_deny, NULL));
+
+                ASSERT_OK(bpf_firewall_compile(*v));
+        }
+
+        CGroupRuntime *crt_a = ASSERT_PTR(unit_get_cgroup_runtime(shared[0])),
+                      *crt_b = ASSERT_PTR(unit_get_cgroup_runtime(shared[1]));
+        ASSERT_NOT_NULL(crt_a->ip_bpf_policy);
+        assert_se(crt_a->ip_bpf_policy == crt_b->ip_bpf_policy);
+
         if (test_custom_filter) {
                 assert_se(u = unit_new(m, sizeof(Service)));
                 assert_se(unit_add_name(u, "custom-filter.service") == 0);
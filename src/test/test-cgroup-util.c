@@ -455,6 +455,31 @@ TEST(cg_get_keyed_attribute) {
         }
 }
 
+TEST(cg_get_attribute_at) {
+        _cleanup_free_ char *val = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        uint64_t u;
+
+        fd = open("/sys/fs/cgroup/init.scope", O_DIRECTORY|O_PATH|O_CLOEXEC);
+        if (fd < 0 || faccessat(fd, "cpu.stat", R_OK, 0) < 0)
+                return (void) log_tests_skipped_errno(errno, "/init.scope/cpu.stat not accessible");
+
+        assert_se(cg_get_keyed_attribute_full_at(fd, "no_such_file", STRV_MAKE("usage_usec"), &val, 0) == -ENOENT);
+        assert_se(cg_get_keyed_attribute_full_at(fd, "cpu.stat", STRV_MAKE("no_such_attr"), &val, 0) == -ENXIO);
+        ASSERT_NULL(val);
+
+        assert_se(cg_get_keyed_attribute_full_at(fd, "cpu.stat", STRV_MAKE("usage_usec"), &val, 0) == 0);
+        assert_se(safe_atou64(val, &u) >= 0);
+        log_info("/init.scope cpu.stat [usage_usec] → %" PRIu64, u);
+
+        assert_se(cg_get_attribute_as_uint64_at(fd, "no_such_file", &u) == -ENODATA);
+
+        if (faccessat(fd, "pids.current", R_OK, 0) >= 0) {
+                assert_se(cg_get_attribute_as_uint64_at(fd, "pids.current", &u) == 0);
+                assert_se(u > 0);
+        }
+}
+
 TEST(bfq_weight_conversion) {
         assert_se(BFQ_WEIGHT(1) == 1);
         assert_se(BFQ_WEIGHT(50) == 50);
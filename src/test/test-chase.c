@@ -533,6 +533,33 @@ TEST(chaseat) {
          * host's root. */
         assert_se(chaseat(tfd, "/qed", 0, NULL, NULL) == -ENOENT);
 
+        /* Test the corner cases where the kernel's path resolution differs from ours, and which hence must
+         * not be resolved with openat2(). Trailing slashes are ignored when looking up the last component,
+         * even if it is not a directory, or a symlink and CHASE_NOFOLLOW is specified. */
+
+        ASSERT_OK(chaseat(tfd, "qed", CHASE_AT_RESOLVE_IN_ROOT, NULL, &fd));
+        ASSERT_OK(fd_verify_regular(fd));
+        fd = safe_close(fd);
+
+        ASSERT_OK(chaseat(tfd, "def/", CHASE_AT_RESOLVE_IN_ROOT, &result, &fd));
+        ASSERT_STREQ(result, "def");
+        ASSERT_OK(fd_verify_regular(fd));
+        fd = safe_close(fd);
+        result = mfree(result);
+
+        ASSERT_OK(chaseat(tfd, "/def/.", CHASE_AT_RESOLVE_IN_ROOT|CHASE_TRAIL_SLASH, &result, NULL));
+        ASSERT_STREQ(result, "def/");
+        result = mfree(result);
+
+        ASSERT_OK(chaseat(tfd, "qed/", CHASE_AT_RESOLVE_IN_ROOT|CHASE_NOFOLLOW, NULL, &fd));
+        ASSERT_OK(fstat(fd, &st));
+        assert_se(S_ISLNK(st.st_mode));
+        fd = safe_close(fd);
+
+        assert_se(chaseat(tfd, "qed", CHASE_AT_RESOLVE_IN_ROOT|CHASE_PROHIBIT_SYMLINKS, NULL, &fd) == -EREMCHG);
+        ASSERT_OK(chaseat(tfd, "qed", CHASE_AT_RESOLVE_IN_ROOT|CHASE_PROHIBIT_SYMLINKS|CHASE_NOFOLLOW, NULL, &fd));
+        fd = safe_close(fd);
+
         /* Test CHASE_PARENT */
 
         ASSERT_OK((fd = open_mkdir_at(tfd, "chase", O_CLOEXEC, 0755)));
@@ -269,6 +269,12 @@ static void test_lz4_decompress_partial(void) {
 }
 #endif
 
+#if HAVE_ZSTD
+static int compress_stream_zstd_threaded(int fdf, int fdt, uint64_t max_bytes, uint64_t *uncompressed_size) {
+        return compress_stream_zstd_full(fdf, fdt, max_bytes, 2, uncompressed_size);
+}
+#endif
+
 int main(int argc, char *argv[]) {
 #if HAVE_COMPRESSION
         _unused_ const char text[] =
@@ -363,6 +369,8 @@ int main(int argc, char *argv[]) {
 
         test_compress_stream("ZSTD", "zstdcat",
                              compress_stream_zstd, decompress_stream_zstd, srcfile);
+        test_compress_stream("ZSTD", "zstdcat",
+                             compress_stream_zstd_threaded, decompress_stream_zstd, srcfile);
 
         test_decompress_startswith_short("ZSTD", compress_blob_zstd, decompress_startswith_zstd);
 #else
@@ -155,6 +155,86 @@ TEST(conf_files_list) {
         assert_se(strv_equal(result, STRV_MAKE("a.conf", "aa.conf", "b.conf")));
 }
 
+static void check_cached(const char *root, unsigned flags, char **dirs, char **expected) {
+        _cleanup_strv_free_ char **result = NULL;
+
+        ASSERT_OK(conf_files_list_strv(&result, ".conf", root, flags, (const char* const*) dirs));
+        strv_print(result);
+        ASSERT_TRUE(strv_equal(result, expected));
+}
+
+TEST(conf_files_cache) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_close_ int tfd = -EBADF;
+
+        tfd = mkdtemp_open("/tmp/test-conf-files-XXXXXX", O_PATH, &t);
+        ASSERT_OK(tfd);
+
+        ASSERT_OK_ERRNO(mkdirat(tfd, "dir1", 0755));
+        ASSERT_OK(write_string_file_at(tfd, "dir1/a.conf", "foo", WRITE_STRING_FILE_CREATE));
+
+        ASSERT_OK_POSITIVE(conf_files_cache_set_enabled(true));
+        ASSERT_OK_ZERO(conf_files_cache_set_enabled(true));
+
+        char **dirs = STRV_MAKE("/dir1", "/dir2");
+        _cleanup_free_ char
+                *a1 = path_join(t, "/dir1/a.conf"),
+                *b1 = path_join(t, "/dir1/b.conf"),
+                *a2 = path_join(t, "/dir2/a.conf"),
+                *c2 = path_join(t, "/dir2/c.conf"),
+                *l1 = path_join(t, "/dir1/l.conf");
+
+        /* Twice, the second time from the cache */
+        check_cached(t, 0, dirs, STRV_MAKE(a1));
+        check_cached(t, 0, dirs, STRV_MAKE(a1));
+
+        /* A new file in a cached directory */
+        ASSERT_OK(write_string_file_at(tfd, "dir1/b.conf", "foo", WRITE_STRING_FILE_CREATE));
+        check_cached(t, 0, dirs, STRV_MAKE(a1, b1));
+
+        /* A directory that didn't exist before */
+        ASSERT_OK_ERRNO(mkdirat(tfd, "dir2", 0755));
+        ASSERT_OK(write_string_file_at(tfd, "dir2/a.conf", "foo", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(write_string_file_at(tfd, "dir2/c.conf", "foo", WRITE_STRING_FILE_CREATE));
+        check_cached(t, 0, dirs, STRV_MAKE(a1, b1, c2));
+
+        /* Masking through truncation, and unmasking */
+        ASSERT_OK(write_string_file_at(tfd, "dir1/a.conf", "", WRITE_STRING_FILE_TRUNCATE|WRITE_STRING_FILE_AVOID_NEWLINE));
+        check_cached(t, CONF_FILES_FILTER_MASKED, dirs, STRV_MAKE(b1, c2));
+        check_cached(t, 0, dirs, STRV_MAKE(a1, b1, c2));
+        ASSERT_OK(write_string_file_at(tfd, "dir1/a.conf", "foo", WRITE_STRING_FILE_TRUNCATE));
+        check_cached(t, CONF_FILES_FILTER_MASKED, dirs, STRV_MAKE(a1, b1, c2));
+
+        /* Removing a file uncovers the one with lower priority */
+        ASSERT_OK_ERRNO(unlinkat(tfd, "dir1/a.conf", 0));
+        check_cached(t, 0, dirs, STRV_MAKE(a2, b1, c2));
+
+        /* Symlinks are followed on every lookup */
+        ASSERT_OK(write_string_file_at(tfd, "target", "foo", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK_ERRNO(symlinkat("../target", tfd, "dir1/l.conf"));
+        check_cached(t, CONF_FILES_REGULAR, dirs, STRV_MAKE(a2, b1, c2, l1));
+        ASSERT_OK_ERRNO(unlinkat(tfd, "target", 0));
+        ASSERT_OK_ERRNO(mkdirat(tfd, "target", 0755));
+        check_cached(t, CONF_FILES_REGULAR, dirs, STRV_MAKE(a2, b1, c2));
+        check_cached(t, CONF_FILES_DIRECTORY, dirs, STRV_MAKE(l1));
+
+        /* Renaming a directory away and back */
+        ASSERT_OK_ERRNO(renameat(tfd, "dir2", tfd, "dir3"));
+        check_cached(t, 0, dirs, STRV_MAKE(b1, l1));
+        ASSERT_OK_ERRNO(renameat(tfd, "dir3", tfd, "dir2"));
+        check_cached(t, 0, dirs, STRV_MAKE(a2, b1, c2, l1));
+
+        /* Removing a directory */
+        ASSERT_OK(rm_rf_child(tfd, "dir2", REMOVE_PHYSICAL));
+        check_cached(t, 0, dirs, STRV_MAKE(b1, l1));
+
+        conf_files_cache_flush();
+        check_cached(t, 0, dirs, STRV_MAKE(b1, l1));
+
+        ASSERT_OK(conf_files_cache_set_enabled(false));
+        check_cached(t, 0, dirs, STRV_MAKE(b1, l1));
+}
+
 static void test_conf_files_insert_one(const char *root) {
         _cleanup_strv_free_ char **s = NULL;
 
@@ -18,6 +18,7 @@
 #include "path-util.h"
 #include "random-util.h"
 #include "rm-rf.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -549,6 +550,105 @@ TEST_RET(copy_holes_with_gaps) {
         return 0;
 }
 
+TEST(copy_sparse) {
+        _cleanup_(unlink_tempfilep) char fn[] = "/var/tmp/test-copy-sparse-XXXXXX";
+        _cleanup_close_pair_ int pipe_fds[2] = EBADF_PAIR;
+        _cleanup_close_ int fd = -EBADF;
+        uint8_t buf[4 * 4096], check[sizeof buf];
+        struct stat st;
+        off_t data;
+
+        /* Layout: data, two zero blocks, data, one trailing zero block */
+        zero(buf);
+        memset(buf, 'x', 4096);
+        memset(buf + 3 * 4096, 'y', 2048);
+
+        ASSERT_OK_ERRNO(pipe2(pipe_fds, O_CLOEXEC));
+        ASSERT_OK(loop_write(pipe_fds[1], buf, sizeof buf));
+        ASSERT_OK(loop_write(pipe_fds[1], (const uint8_t[4096]) {}, 4096));
+        pipe_fds[1] = safe_close(pipe_fds[1]);
+
+        fd = mkostemp_safe(fn);
+        ASSERT_OK(fd);
+
+        ASSERT_OK(copy_bytes(pipe_fds[0], fd, UINT64_MAX, COPY_SPARSE));
+
+        ASSERT_OK_ERRNO(fstat(fd, &st));
+        ASSERT_EQ(st.st_size, (off_t) (sizeof buf + 4096));
+
+        ASSERT_OK_ERRNO(pread(fd, check, sizeof check, 0));
+        ASSERT_EQ(memcmp(buf, check, sizeof buf), 0);
+        ASSERT_OK_ERRNO(pread(fd, check, 4096, sizeof buf));
+        ASSERT_TRUE(memeqzero(check, 4096));
+
+        /* Whether the zero blocks actually became holes depends on the file system block size, hence only
+         * check that if it matches ours. */
+        if (st.st_blksize == 4096) {
+                ASSERT_EQ(lseek(fd, 0, SEEK_HOLE), (off_t) 4096);
+                data = lseek(fd, 4096, SEEK_DATA);
+                ASSERT_EQ(data, (off_t) (3 * 4096));
+        }
+}
+
+TEST(copy_tree_parallel) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_close_ int tfd = -EBADF;
+        struct timespec ts = { .tv_sec = 1234567 };
+        struct stat a, b;
+
+        ASSERT_OK(tfd = mkdtemp_open(NULL, 0, &t));
+        ASSERT_OK_ERRNO(mkdirat(tfd, "src", 0755));
+
+        for (unsigned i = 0; i < 32; i++) {
+                char dn[DECIMAL_STR_MAX(unsigned) + STRLEN("src/")];
+                _cleanup_close_ int dfd = -EBADF;
+
+                xsprintf(dn, "src/%u", i);
+                ASSERT_OK(dfd = open_mkdir_at(tfd, dn, O_CLOEXEC, 0755));
+
+                for (unsigned j = 0; j < 32; j++) {
+                        char fn[DECIMAL_STR_MAX(unsigned)], c[DECIMAL_STR_MAX(unsigned) * 2 + 1];
+
+                        xsprintf(fn, "%u", j);
+                        xsprintf(c, "%u-%u", i, j);
+                        ASSERT_OK(write_string_file_at(dfd, fn, c, WRITE_STRING_FILE_CREATE));
+                        ASSERT_OK_ERRNO(utimensat(dfd, fn, (struct timespec[]) { ts, ts }, 0));
+                }
+
+                ASSERT_OK_ERRNO(linkat(dfd, "0", dfd, "hardlink", 0));
+                ASSERT_OK_ERRNO(futimens(dfd, (struct timespec[]) { ts, ts }));
+        }
+
+        ASSERT_OK(copy_directory_at(tfd, "src", tfd, "dst", COPY_PARALLEL|COPY_HARDLINKS));
+
+        for (unsigned i = 0; i < 32; i++) {
+                char dn[DECIMAL_STR_MAX(unsigned) + STRLEN("dst/")];
+                _cleanup_close_ int dfd = -EBADF;
+
+                xsprintf(dn, "dst/%u", i);
+                ASSERT_OK(dfd = openat(tfd, dn, O_RDONLY|O_DIRECTORY|O_CLOEXEC));
+
+                /* Copying the file contents must not have touched the directory again */
+                ASSERT_OK_ERRNO(fstat(dfd, &a));
+                ASSERT_EQ(a.st_mtim.tv_sec, ts.tv_sec);
+
+                for (unsigned j = 0; j < 32; j++) {
+                        char fn[DECIMAL_STR_MAX(unsigned)], c[DECIMAL_STR_MAX(unsigned) * 2 + 2];
+
+                        xsprintf(fn, "%u", j);
+                        xsprintf(c, "%u-%u\n", i, j);
+                        ASSERT_TRUE(read_file_at_and_streq(dfd, fn, c));
+
+                        ASSERT_OK_ERRNO(fstatat(dfd, fn, &a, AT_SYMLINK_NOFOLLOW));
+                        ASSERT_EQ(a.st_mtim.tv_sec, ts.tv_sec);
+                }
+
+                ASSERT_OK_ERRNO(fstatat(dfd, "0", &a, AT_SYMLINK_NOFOLLOW));
+                ASSERT_OK_ERRNO(fstatat(dfd, "hardlink", &b, AT_SYMLINK_NOFOLLOW));
+                ASSERT_EQ(a.st_ino, b.st_ino);
+        }
+}
+
 TEST(copy_lock) {
         _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
         _cleanup_close_ int tfd = -EBADF, fd = -EBADF;
@@ -115,6 +115,20 @@ TEST(cunescape) {
         ASSERT_STREQ(unescaped, "A=A\\x0aB");
         unescaped = mfree(unescaped);
 
+        /* literal runs around escapes, and a length that cuts off the string */
+        assert_se(cunescape("plain text without escapes", 0, &unescaped) == 26);
+        ASSERT_STREQ(unescaped, "plain text without escapes");
+        unescaped = mfree(unescaped);
+
+        assert_se(cunescape_length("first\\tsecond\\nthird", 13, 0, &unescaped) == 12);
+        ASSERT_STREQ(unescaped, "first\tsecond");
+        unescaped = mfree(unescaped);
+
+        assert_se(cunescape_length("trailing\\", 9, 0, &unescaped) < 0);
+        assert_se(cunescape_length("trailing\\", 9, UNESCAPE_RELAX, &unescaped) == 9);
+        ASSERT_STREQ(unescaped, "trailing\\");
+        unescaped = mfree(unescaped);
+
         assert_se(cunescape("\\x00\\x00\\x00", UNESCAPE_ACCEPT_NUL, &unescaped) == 3);
         assert_se(memcmp(unescaped, "\0\0\0", 3) == 0);
         unescaped = mfree(unescaped);
@@ -547,6 +547,17 @@ TEST(extract_first_word) {
         ASSERT_STREQ(t, "가너도루");
         free(t);
         assert_se(isempty(p));
+
+        p = "  --operational-state=\"routable degraded\"'x'\\ y  \t tail";
+        assert_se(extract_first_word(&p, &t, NULL, EXTRACT_UNQUOTE) > 0);
+        ASSERT_STREQ(t, "--operational-state=routable degradedx y");
+        free(t);
+        ASSERT_STREQ(p, "tail");
+
+        assert_se(extract_first_word(&p, &t, NULL, EXTRACT_UNQUOTE) > 0);
+        ASSERT_STREQ(t, "tail");
+        free(t);
+        assert_se(!p);
 }
 
 TEST(extract_first_word_and_warn) {
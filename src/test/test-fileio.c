@@ -13,6 +13,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "io-util.h"
 #include "iovec-util.h"
 #include "memfd-util.h"
 #include "parse-util.h"
@@ -1043,6 +1044,48 @@ TEST(read_full_file_offset_size) {
         rbuf = mfree(rbuf);
 }
 
+TEST(read_full_file_view) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_close_ int tfd = -EBADF;
+
+        ASSERT_OK(tfd = mkdtemp_open(NULL, 0, &t));
+
+        /* Empty, small, mapped, and page aligned (hence not mapped) files */
+        FOREACH_ARRAY(size, ((const size_t[]) { 0, 4711, 64 * 1024 + 17, 128 * 1024 }), 4) {
+                _cleanup_(file_view_done) FileView v = {};
+                _cleanup_free_ char *buf = NULL, *fn = NULL;
+                _cleanup_close_ int fd = -EBADF;
+
+                ASSERT_NOT_NULL(buf = malloc(*size));
+                random_bytes(buf, *size);
+
+                ASSERT_OK(asprintf(&fn, "file-%zu", *size));
+                ASSERT_OK_ERRNO(fd = openat(tfd, fn, O_CREAT|O_EXCL|O_WRONLY|O_CLOEXEC, 0644));
+                ASSERT_OK(loop_write(fd, buf, *size));
+
+                ASSERT_OK(read_full_file_view_at(tfd, fn, &v));
+                ASSERT_EQ(v.size, *size);
+                assert_se(memcmp_safe(v.data, buf, *size) == 0);
+                ASSERT_EQ(v.data[v.size], 0);
+                ASSERT_EQ(v.mapped > 0, *size == 64 * 1024 + 17);
+        }
+
+        /* Virtual files report a zero size, the second read is sized after the first one */
+        for (unsigned i = 0; i < 2; i++) {
+                _cleanup_(file_view_done) FileView v = {};
+                _cleanup_free_ char *buf = NULL;
+                size_t size;
+
+                ASSERT_OK(read_full_file_view("/proc/self/mountinfo", &v));
+                ASSERT_OK(read_full_virtual_file("/proc/self/mountinfo", &buf, &size));
+                ASSERT_EQ(v.mapped, 0u);
+                ASSERT_EQ(v.size, size);
+                ASSERT_STREQ(v.data, buf);
+        }
+
+        ASSERT_ERROR(read_full_file_view_at(tfd, "nonexistent", &(FileView) {}), ENOENT);
+}
+
 static void test_read_virtual_file_one(size_t max_size) {
         int r;
 
@@ -2,6 +2,7 @@
 
 #include "tests.h"
 #include "hash-funcs.h"
+#include "hashmap.h"
 #include "set.h"
 
 TEST(path_hash_set) {
@@ -74,4 +75,25 @@ TEST(path_hash_set) {
         assert_se(!set_contains(set, "/////../bar/./"));
 }
 
+TEST(trusted_string_hash_ops) {
+        _cleanup_hashmap_free_ Hashmap *h = NULL;
+
+        /* Enough entries to go through a couple of resizes with their rehashing */
+        for (unsigned i = 0; i < 1000; i++) {
+                _cleanup_free_ char *k = NULL, *v = NULL;
+
+                ASSERT_OK(asprintf(&k, "unit-%u.service", i));
+                ASSERT_NOT_NULL(v = strdup(k));
+                ASSERT_OK_EQ(hashmap_ensure_put(&h, &trusted_string_hash_ops_free_free, k, v), 1);
+                TAKE_PTR(k);
+                TAKE_PTR(v);
+        }
+
+        ASSERT_EQ(hashmap_size(h), 1000u);
+        ASSERT_STREQ(hashmap_get(h, "unit-0.service"), "unit-0.service");
+        ASSERT_STREQ(hashmap_get(h, "unit-999.service"), "unit-999.service");
+        ASSERT_NULL(hashmap_get(h, "unit-1000.service"));
+        ASSERT_NULL(hashmap_get(h, ""));
+}
+
 DEFINE_TEST_MAIN(LOG_INFO);
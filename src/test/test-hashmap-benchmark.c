@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdlib.h>
+
+#include "alloc-util.h"
+#include "hashmap.h"
+#include "parse-util.h"
+#include "prioq.h"
+#include "stdio-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* Measures the basic operations of the hashmap and priority queue implementations the manager and the
+ * event loop are built on, for a number of entries. Hashmap keys are strings resembling unit names. Output
+ * is one tab-separated line per benchmark and entry count:
+ *
+ *     <benchmark> <entries> <operations per second>
+ *
+ * With $SYSTEMD_BENCHMARK_JSON=1 the results are printed as JSON instead, see benchmark_report_json().
+ *
+ * Usage: test-hashmap-benchmark [DURATION]
+ */
+
+static usec_t arg_loop_usec = 100 * USEC_PER_MSEC;
+static bool arg_json = false;
+
+static void bench_report(const char *name, unsigned n, uint64_t n_ops, usec_t duration) {
+        if (arg_json) {
+                char parameter[DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(parameter, "%u", n);
+                assert_se(benchmark_report_json(name, parameter, n_ops, duration,
+                                                /* latencies = */ NULL, /* n_latencies = */ 0,
+                                                /* extra = */ NULL) >= 0);
+                return;
+        }
+
+        printf("%s\t%u\t%" PRIu64 "\n", name, n, n_ops * USEC_PER_SEC / MAX(duration, 1u));
+}
+
+static void bench_hashmap(unsigned n) {
+        _cleanup_strv_free_ char **keys = NULL;
+        usec_t start, t, d_put = 0, d_get = 0, d_remove = 0;
+        uint64_t n_rounds = 0;
+
+        assert_se(keys = new0(char*, n + 1));
+        for (unsigned i = 0; i < n; i++)
+                assert_se(asprintf(&keys[i], "benchmark-%u.service", i) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                _cleanup_hashmap_free_ Hashmap *h = NULL;
+
+                t = now(CLOCK_MONOTONIC);
+                assert_se(h = hashmap_new(&string_hash_ops));
+                STRV_FOREACH(k, keys)
+                        assert_se(hashmap_put(h, *k, *k) > 0);
+                d_put += now(CLOCK_MONOTONIC) - t;
+
+                t = now(CLOCK_MONOTONIC);
+                STRV_FOREACH(k, keys)
+                        assert_se(hashmap_get(h, *k) == *k);
+                d_get += now(CLOCK_MONOTONIC) - t;
+
+                t = now(CLOCK_MONOTONIC);
+                STRV_FOREACH(k, keys)
+                        assert_se(hashmap_remove(h, *k) == *k);
+                d_remove += now(CLOCK_MONOTONIC) - t;
+
+                n_rounds++;
+                t = now(CLOCK_MONOTONIC);
+        } while (t < start + arg_loop_usec);
+
+        bench_report("hashmap-put", n, n_rounds * n, d_put);
+        bench_report("hashmap-get", n, n_rounds * n, d_get);
+        bench_report("hashmap-remove", n, n_rounds * n, d_remove);
+}
+
+static void bench_prioq(unsigned n) {
+        _cleanup_free_ unsigned *values = NULL;
+        usec_t start, t, d_put = 0, d_pop = 0;
+        uint64_t n_rounds = 0;
+
+        assert_se(values = new(unsigned, n));
+
+        srand(0);
+        for (unsigned i = 0; i < n; i++)
+                values[i] = (unsigned) rand();
+
+        start = now(CLOCK_MONOTONIC);
+        do {
+                _cleanup_(prioq_freep) Prioq *q = NULL;
+
+                t = now(CLOCK_MONOTONIC);
+                assert_se(q = prioq_new(trivial_compare_func));
+                for (unsigned i = 0; i < n; i++)
+                        assert_se(prioq_put(q, UINT_TO_PTR(values[i]), NULL) >= 0);
+                d_put += now(CLOCK_MONOTONIC) - t;
+
+                t = now(CLOCK_MONOTONIC);
+                for (unsigned i = 0; i < n; i++)
+                        (void) prioq_pop(q);
+                d_pop += now(CLOCK_MONOTONIC) - t;
+                assert_se(prioq_isempty(q));
+
+                n_rounds++;
+                t = now(CLOCK_MONOTONIC);
+        } while (t < start + arg_loop_usec);
+
+        bench_report("prioq-put", n, n_rounds * n, d_put);
+        bench_report("prioq-pop", n, n_rounds * n, d_pop);
+}
+
+int main(int argc, char *argv[]) {
+        unsigned n;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                assert_se(parse_sec(argv[1], &arg_loop_usec) >= 0);
+        assert_se(arg_loop_usec > 0);
+
+        arg_json = benchmark_json_enabled();
+        if (!arg_json)
+                printf("benchmark\tentries\tops/s\n");
+
+        FOREACH_ARGUMENT(n, 100, 10000, 100000) {
+                bench_hashmap(n);
+                bench_prioq(n);
+        }
+
+        return 0;
+}
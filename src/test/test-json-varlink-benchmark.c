@@ -0,0 +1,453 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "sd-event.h"
+#include "sd-json.h"
+#include "sd-varlink.h"
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "hash-funcs.h"
+#include "json-util.h"
+#include "parse-util.h"
+#include "sort-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* A set of sd-json and sd-varlink micro-benchmarks meant to be compared between builds, run on payloads
+ * resembling what our daemons actually exchange. Output is one tab-separated line per benchmark and
+ * payload:
+ *
+ *     <benchmark> <payload> <operations per second> <bytes per second> <allocations per op> <p99 latency µs>
+ *
+ * "bytes" refers to the size of the payload's compact JSON text, for the round trip benchmark in one
+ * direction. Allocations are counted by interposing malloc() and friends, and include the ones made by the
+ * server thread for the round trip benchmark. They are printed as "-" where interposing is not possible
+ * (i.e. with sanitizers or a libc other than glibc).
+ *
+ * With $SYSTEMD_BENCHMARK_JSON=1 the results are printed as JSON instead, see benchmark_report_json().
+ *
+ * Usage: test-json-varlink-benchmark [DURATION]
+ */
+
+#define IFACE "io.systemd.test.Benchmark"
+
+static usec_t arg_loop_usec = 100 * USEC_PER_MSEC;
+static bool arg_json = false;
+
+#if defined(__GLIBC__) && !HAS_FEATURE_ADDRESS_SANITIZER && !HAS_FEATURE_MEMORY_SANITIZER
+#  define COUNT_ALLOCATIONS 1
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void *p, size_t size);
+
+static uint64_t n_allocations = 0;
+
+void* malloc(size_t size) {
+        __atomic_fetch_add(&n_allocations, 1, __ATOMIC_RELAXED);
+        return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+        __atomic_fetch_add(&n_allocations, 1, __ATOMIC_RELAXED);
+        return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void *p, size_t size) {
+        __atomic_fetch_add(&n_allocations, 1, __ATOMIC_RELAXED);
+        return __libc_realloc(p, size);
+}
+
+static uint64_t allocations_get(void) {
+        return __atomic_load_n(&n_allocations, __ATOMIC_RELAXED);
+}
+#else
+#  define COUNT_ALLOCATIONS 0
+
+static uint64_t allocations_get(void) {
+        return 0;
+}
+#endif
+
+typedef struct Bench {
+        uint64_t n_ops;
+        uint64_t n_allocations;
+        usec_t *latencies;
+        size_t n_latencies;
+} Bench;
+
+static void bench_done(Bench *b) {
+        b->latencies = mfree(b->latencies);
+}
+
+static void bench_report(const char *name, const char *payload, size_t size, Bench *b, usec_t duration) {
+        char allocs[DECIMAL_STR_MAX(uint64_t) + 3] = "-", p99[DECIMAL_STR_MAX(usec_t)] = "-";
+
+        if (COUNT_ALLOCATIONS && b->n_ops > 0)
+                xsprintf(allocs, "%" PRIu64 ".%02" PRIu64,
+                         b->n_allocations / b->n_ops,
+                         b->n_allocations * 100 / b->n_ops % 100);
+
+        typesafe_qsort(b->latencies, b->n_latencies, uint64_compare_func);
+
+        if (arg_json) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *extra = NULL;
+
+                assert_se(sd_json_buildo(
+                                &extra,
+                                SD_JSON_BUILD_PAIR_UNSIGNED("bytesPerOperation", size),
+                                SD_JSON_BUILD_PAIR_CONDITION(COUNT_ALLOCATIONS, "allocations",
+                                                             SD_JSON_BUILD_UNSIGNED(b->n_allocations))) >= 0);
+
+                assert_se(benchmark_report_json(name, payload, b->n_ops, duration,
+                                                b->latencies, b->n_latencies, extra) >= 0);
+                return;
+        }
+
+        if (b->n_latencies > 0)
+                xsprintf(p99, USEC_FMT, b->latencies[b->n_latencies * 99 / 100]);
+
+        duration = MAX(duration, 1u);
+        printf("%s\t%s\t%" PRIu64 "\t%" PRIu64 "\t%s\t%s\n",
+               name, payload,
+               b->n_ops * USEC_PER_SEC / duration,
+               b->n_ops * size * USEC_PER_SEC / duration,
+               allocs, p99);
+}
+
+/* Runs the step function until the configured duration passed, recording the latency and the allocations of
+ * each call */
+static usec_t bench_run(Bench *b, void (*step)(void *userdata), void *userdata) {
+        usec_t start, n;
+
+        start = n = now(CLOCK_MONOTONIC);
+        do {
+                uint64_t a = allocations_get();
+                usec_t c = n;
+
+                step(userdata);
+                b->n_allocations += allocations_get() - a;
+                n = now(CLOCK_MONOTONIC);
+
+                b->n_ops++;
+                if (GREEDY_REALLOC(b->latencies, b->n_latencies + 1))
+                        b->latencies[b->n_latencies++] = n - c;
+        } while (n < start + arg_loop_usec);
+
+        return n - start;
+}
+
+typedef struct UserRecord {
+        const char *user_name;
+        const char *real_name;
+        const char *home_directory;
+        const char *shell;
+        uid_t uid;
+        gid_t gid;
+        sd_json_variant *member_of;
+        uint64_t disk_size;
+        int locked;
+} UserRecord;
+
+static void dispatch_user(sd_json_variant *v) {
+        static const sd_json_dispatch_field table[] = {
+                { "userName",      SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(UserRecord, user_name),      SD_JSON_MANDATORY },
+                { "realName",      SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(UserRecord, real_name),      0                 },
+                { "homeDirectory", SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(UserRecord, home_directory), 0                 },
+                { "shell",         SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(UserRecord, shell),          0                 },
+                { "uid",           _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uid_gid,       offsetof(UserRecord, uid),            SD_JSON_MANDATORY },
+                { "gid",           _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uid_gid,       offsetof(UserRecord, gid),            0                 },
+                { "memberOf",      SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref, offsetof(UserRecord, member_of),      0                 },
+                { "diskSize",      _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,        offsetof(UserRecord, disk_size),      0                 },
+                { "locked",        SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_tristate,      offsetof(UserRecord, locked),         0                 },
+                {}
+        };
+        UserRecord u = { .locked = -1 };
+
+        assert_se(sd_json_dispatch_full(v, table, NULL, SD_JSON_ALLOW_EXTENSIONS, &u, NULL) >= 0);
+}
+
+typedef struct ResourceRecord {
+        int ifindex;
+        sd_json_variant *rr;
+        const char *raw;
+} ResourceRecord;
+
+static void dispatch_answer(sd_json_variant *v) {
+        static const sd_json_dispatch_field table[] = {
+                { "ifindex", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int32,         offsetof(ResourceRecord, ifindex), 0                 },
+                { "rr",      SD_JSON_VARIANT_OBJECT,        sd_json_dispatch_variant_noref, offsetof(ResourceRecord, rr),      0                 },
+                { "raw",     SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(ResourceRecord, raw),     SD_JSON_MANDATORY },
+                {}
+        };
+        sd_json_variant *i;
+
+        JSON_VARIANT_ARRAY_FOREACH(i, sd_json_variant_by_key(v, "rrs")) {
+                ResourceRecord rr = {};
+
+                assert_se(sd_json_dispatch_full(i, table, NULL, 0, &rr, NULL) >= 0);
+        }
+}
+
+typedef struct UnitInfo {
+        const char *name;
+        const char *description;
+        const char *load_state;
+        const char *active_state;
+        const char *sub_state;
+        uint32_t job_id;
+} UnitInfo;
+
+static void dispatch_units(sd_json_variant *v) {
+        static const sd_json_dispatch_field table[] = {
+                { "name",        SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string, offsetof(UnitInfo, name),         SD_JSON_MANDATORY },
+                { "description", SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string, offsetof(UnitInfo, description),  0                 },
+                { "loadState",   SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string, offsetof(UnitInfo, load_state),   0                 },
+                { "activeState", SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string, offsetof(UnitInfo, active_state), 0                 },
+                { "subState",    SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string, offsetof(UnitInfo, sub_state),    0                 },
+                { "jobId",       _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint32,       offsetof(UnitInfo, job_id),       0                 },
+                {}
+        };
+        sd_json_variant *i;
+
+        JSON_VARIANT_ARRAY_FOREACH(i, sd_json_variant_by_key(v, "units")) {
+                UnitInfo u = {};
+
+                assert_se(sd_json_dispatch_full(i, table, NULL, SD_JSON_ALLOW_EXTENSIONS, &u, NULL) >= 0);
+        }
+}
+
+typedef struct JournalEntry {
+        const char *cursor;
+        const char *realtime;
+        const char *message;
+        const char *priority;
+        const char *unit;
+} JournalEntry;
+
+static void dispatch_journal(sd_json_variant *v) {
+        static const sd_json_dispatch_field table[] = {
+                { "__CURSOR",             SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, offsetof(JournalEntry, cursor),   SD_JSON_MANDATORY },
+                { "__REALTIME_TIMESTAMP", SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, offsetof(JournalEntry, realtime), 0                 },
+                { "MESSAGE",              SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, offsetof(JournalEntry, message),  0                 },
+                { "PRIORITY",             SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, offsetof(JournalEntry, priority), 0                 },
+                { "_SYSTEMD_UNIT",        SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, offsetof(JournalEntry, unit),     0                 },
+                {}
+        };
+        JournalEntry j = {};
+
+        assert_se(sd_json_dispatch_full(v, table, NULL, SD_JSON_ALLOW_EXTENSIONS, &j, NULL) >= 0);
+}
+
+static char* make_user(void) {
+        return strdup(
+                "{\"userName\":\"lennart\",\"realName\":\"Lennart Poettering\",\"uid\":1000,\"gid\":1000,"
+                "\"homeDirectory\":\"/home/lennart\",\"shell\":\"/bin/bash\",\"disposition\":\"regular\","
+                "\"memberOf\":[\"wheel\",\"users\",\"audio\",\"video\",\"dialout\"],"
+                "\"service\":\"io.systemd.Home\",\"diskSize\":107374182400,\"locked\":false,"
+                "\"lastChangeUSec\":1714470000000000,\"lastPasswordChangeUSec\":1714470000000000,"
+                "\"storage\":\"luks\",\"imagePath\":\"/home/lennart.home\",\"fileSystemType\":\"btrfs\","
+                "\"luksCipher\":\"aes\",\"luksCipherMode\":\"xts-plain64\",\"luksVolumeKeySize\":32,"
+                "\"perMachine\":[{\"matchMachineId\":\"0123456789abcdef0123456789abcdef\",\"diskSize\":53687091200}],"
+                "\"binding\":{\"0123456789abcdef0123456789abcdef\":{\"blobDirectory\":\"/var/cache/systemd/home/lennart\","
+                "\"imagePath\":\"/home/lennart.home\",\"homeDirectory\":\"/home/lennart\",\"storage\":\"luks\","
+                "\"uid\":1000,\"gid\":1000}},"
+                "\"status\":{\"0123456789abcdef0123456789abcdef\":{\"state\":\"active\",\"service\":\"io.systemd.Home\","
+                "\"diskUsage\":12345678901,\"diskFree\":45678901234,\"diskSize\":107374182400}},"
+                "\"signature\":[{\"data\":\"MEUCIQDn3Xh1ce9yY8Fh0hbd6HTbJbKhr0O0k7b8WIK3dMYg5QIgeS3qyQnVXKVRNtVbdgcOGaR9fFN2yJdDoS7APnA09dI=\","
+                "\"key\":\"-----BEGIN PUBLIC KEY-----\\nMCowBQYDK2VwAyEAd3SfG7D2JZj8rQ3Ltt+zRmzW2uyJYmQ+F5WLs+8d3yM=\\n-----END PUBLIC KEY-----\\n\"}]}");
+}
+
+static char* make_answer(void) {
+        _cleanup_free_ char *s = NULL;
+
+        /* Resembles what io.systemd.Resolve.ResolveRecord returns for a name with several addresses */
+        assert_se(s = strdup("{\"rrs\":["));
+        for (unsigned i = 0; i < 8; i++)
+                assert_se(strextendf_with_separator(&s, ",",
+                          "{\"ifindex\":2,\"rr\":{\"key\":{\"class\":1,\"type\":28,\"name\":\"www.example.com\"},"
+                          "\"address\":[32,1,13,184,0,0,0,0,0,0,0,0,0,0,0,%u]},"
+                          "\"raw\":\"A3d3dwdleGFtcGxlA2NvbQAAHAABAAAOEAAQIAENuAAAAAAAAAAAAAAAA%c==\"}",
+                          i + 1, 'A' + i) >= 0);
+        assert_se(strextend(&s, "],\"flags\":1048577}"));
+
+        return TAKE_PTR(s);
+}
+
+static char* make_units(void) {
+        _cleanup_free_ char *s = NULL;
+
+        /* Resembles a unit listing of a typical system */
+        assert_se(s = strdup("{\"units\":["));
+        for (unsigned i = 0; i < 200; i++)
+                assert_se(strextendf_with_separator(&s, ",",
+                          "{\"name\":\"unit-%u.service\",\"description\":\"Some Service Number %u\","
+                          "\"loadState\":\"loaded\",\"activeState\":\"%s\",\"subState\":\"%s\","
+                          "\"following\":\"\",\"objectPath\":\"/org/freedesktop/systemd1/unit/unit_2d%u_2eservice\","
+                          "\"jobId\":%u,\"jobType\":\"\",\"jobObjectPath\":\"/\"}",
+                          i, i, i % 4 == 0 ? "inactive" : "active", i % 4 == 0 ? "dead" : "running", i, i % 7 == 0 ? i : 0) >= 0);
+        assert_se(strextend(&s, "]}"));
+
+        return TAKE_PTR(s);
+}
+
+static char* make_journal(void) {
+        /* Resembles the output of "journalctl -o json" */
+        return strdup(
+                "{\"__CURSOR\":\"s=0123456789abcdef0123456789abcdef;i=1a2b3c;b=fedcba9876543210fedcba9876543210;"
+                "m=1f2e3d4c;t=6176f5d6e4b3a;x=9a8b7c6d5e4f3a2b\",\"__REALTIME_TIMESTAMP\":\"1714470000123456\","
+                "\"__MONOTONIC_TIMESTAMP\":\"123456789\",\"__SEQNUM\":\"1715004\",\"__SEQNUM_ID\":\"0123456789abcdef0123456789abcdef\","
+                "\"_BOOT_ID\":\"fedcba9876543210fedcba9876543210\",\"_MACHINE_ID\":\"0123456789abcdef0123456789abcdef\","
+                "\"_HOSTNAME\":\"laptop\",\"_TRANSPORT\":\"journal\",\"PRIORITY\":\"6\",\"SYSLOG_FACILITY\":\"3\","
+                "\"SYSLOG_IDENTIFIER\":\"systemd\",\"CODE_FILE\":\"src/core/job.c\",\"CODE_LINE\":\"768\","
+                "\"CODE_FUNC\":\"job_emit_done_message\",\"MESSAGE_ID\":\"39f53479d3a045ac8e11786248231fbf\","
+                "\"_PID\":\"1\",\"_UID\":\"0\",\"_GID\":\"0\",\"_COMM\":\"systemd\",\"_EXE\":\"/usr/lib/systemd/systemd\","
+                "\"_CMDLINE\":\"/sbin/init splash\",\"_CAP_EFFECTIVE\":\"1ffffffffff\",\"_SELINUX_CONTEXT\":\"kernel\","
+                "\"_SYSTEMD_CGROUP\":\"/init.scope\",\"_SYSTEMD_UNIT\":\"init.scope\",\"_SYSTEMD_SLICE\":\"-.slice\","
+                "\"UNIT\":\"systemd-tmpfiles-clean.service\",\"JOB_ID\":\"4321\",\"JOB_TYPE\":\"start\",\"JOB_RESULT\":\"done\","
+                "\"INVOCATION_ID\":\"00112233445566778899aabbccddeeff\","
+                "\"MESSAGE\":\"Finished systemd-tmpfiles-clean.service - Cleanup of Temporary Directories.\","
+                "\"_SOURCE_REALTIME_TIMESTAMP\":\"1714470000123400\"}");
+}
+
+typedef struct Payload {
+        const char *name;
+        char* (*make)(void);
+        void (*dispatch)(sd_json_variant *v);
+} Payload;
+
+static const Payload payloads[] = {
+        { "user-record",     make_user,    dispatch_user    },
+        { "resolved-answer", make_answer,  dispatch_answer  },
+        { "unit-list",       make_units,   dispatch_units   },
+        { "journal-entry",   make_journal, dispatch_journal },
+};
+
+typedef struct Context {
+        const Payload *payload;
+        const char *text;
+        sd_json_variant *variant;
+        sd_varlink *link;
+} Context;
+
+static void step_parse(void *userdata) {
+        Context *c = ASSERT_PTR(userdata);
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+
+        assert_se(sd_json_parse(c->text, 0, &v, NULL, NULL) >= 0);
+}
+
+static void step_format(void *userdata) {
+        Context *c = ASSERT_PTR(userdata);
+        _cleanup_free_ char *s = NULL;
+
+        assert_se(sd_json_variant_format(c->variant, 0, &s) >= 0);
+}
+
+static void step_dispatch(void *userdata) {
+        Context *c = ASSERT_PTR(userdata);
+
+        c->payload->dispatch(c->variant);
+}
+
+static void step_call(void *userdata) {
+        Context *c = ASSERT_PTR(userdata);
+        sd_json_variant *reply;
+        const char *error_id;
+
+        assert_se(sd_varlink_call(c->link, IFACE ".Echo", c->variant, &reply, &error_id) >= 0);
+        assert_se(!error_id);
+}
+
+static void bench_one(const char *name, const Payload *p, Context *c, size_t size, void (*step)(void *userdata)) {
+        _cleanup_(bench_done) Bench b = {};
+        usec_t d;
+
+        d = bench_run(&b, step, c);
+        bench_report(name, p->name, size, &b, d);
+}
+
+static int method_echo(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata) {
+        return sd_varlink_reply(link, parameters);
+}
+
+static int method_quit(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata) {
+        int r;
+
+        r = sd_varlink_reply(link, NULL);
+        if (r < 0)
+                return r;
+
+        return sd_event_exit(sd_varlink_get_event(link), 0);
+}
+
+static void* server_thread(void *userdata) {
+        _cleanup_(sd_varlink_server_unrefp) sd_varlink_server *s = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        int fd = PTR_TO_FD(userdata);
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_varlink_server_new(&s, 0) >= 0);
+        assert_se(sd_varlink_server_bind_method_many(
+                                  s,
+                                  IFACE ".Echo", method_echo,
+                                  IFACE ".Quit", method_quit) >= 0);
+        assert_se(sd_varlink_server_attach_event(s, e, 0) >= 0);
+        assert_se(sd_varlink_server_add_connection(s, fd, /* ret= */ NULL) >= 0);
+
+        assert_se(sd_event_loop(e) >= 0);
+        return NULL;
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(sd_varlink_flush_close_unrefp) sd_varlink *link = NULL;
+        pthread_t t;
+        int pair[2];
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                assert_se(parse_sec(argv[1], &arg_loop_usec) >= 0);
+        assert_se(arg_loop_usec > 0);
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0, pair) >= 0);
+        assert_se(pthread_create(&t, NULL, server_thread, FD_TO_PTR(pair[0])) == 0);
+        assert_se(sd_varlink_connect_fd(&link, pair[1]) >= 0);
+
+        arg_json = benchmark_json_enabled();
+        if (!arg_json)
+                printf("benchmark\tpayload\tops/s\tbytes/s\tallocs/op\tp99_usec\n");
+
+        FOREACH_ELEMENT(p, payloads) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+                _cleanup_free_ char *text = NULL, *compact = NULL;
+                Context c;
+                size_t size;
+
+                assert_se(text = p->make());
+                assert_se(sd_json_parse(text, 0, &v, NULL, NULL) >= 0);
+                assert_se(sd_json_variant_format(v, 0, &compact) >= 0);
+                size = strlen(compact);
+
+                c = (Context) {
+                        .payload = p,
+                        .text = text,
+                        .variant = v,
+                        .link = link,
+                };
+
+                bench_one("parse", p, &c, size, step_parse);
+                bench_one("format", p, &c, size, step_format);
+                bench_one("dispatch", p, &c, size, step_dispatch);
+                bench_one("varlink-call", p, &c, size, step_call);
+        }
+
+        assert_se(sd_varlink_call(link, IFACE ".Quit", NULL, NULL, NULL) >= 0);
+        assert_se(pthread_join(t, NULL) == 0);
+
+        return 0;
+}
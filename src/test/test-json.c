@@ -9,6 +9,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "iovec-util.h"
+#include "json-cbor.h"
 #include "json-internal.h"
 #include "json-util.h"
 #include "math-util.h"
@@ -458,6 +459,140 @@ TEST(json_buildo) {
         assert_se(sd_json_variant_equal(a, b));
 }
 
+TEST(json_variant_format_append) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_free_ char *buf = NULL, *t = NULL;
+        size_t size = 0;
+
+        ASSERT_OK(sd_json_buildo(&v,
+                                 SD_JSON_BUILD_PAIR("foo", SD_JSON_BUILD_INTEGER(4711)),
+                                 SD_JSON_BUILD_PAIR("bar", SD_JSON_BUILD_STRING("xxxx"))));
+        ASSERT_OK(sd_json_variant_format(v, /* flags= */ 0, &t));
+
+        ASSERT_EQ(json_variant_format_append(v, /* flags= */ 0, &buf, &size, SIZE_MAX), (int) strlen(t));
+        ASSERT_EQ(size, strlen(t) + 1);
+        ASSERT_STREQ(buf, t);
+
+        ASSERT_EQ(json_variant_format_append(v, /* flags= */ 0, &buf, &size, SIZE_MAX), (int) strlen(t));
+        ASSERT_EQ(size, 2 * (strlen(t) + 1));
+        ASSERT_STREQ(buf + strlen(t) + 1, t);
+
+        /* Exceeding the limit leaves the buffer untouched */
+        ASSERT_ERROR(json_variant_format_append(v, /* flags= */ 0, &buf, &size, size + strlen(t)), ENOBUFS);
+        ASSERT_EQ(size, 2 * (strlen(t) + 1));
+        ASSERT_STREQ(buf, t);
+}
+
+static void test_cbor_roundtrip_one(const char *json) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL, *w = NULL;
+        _cleanup_free_ uint8_t *buf = NULL;
+        size_t n;
+
+        log_debug("/* %s(%s) */", __func__, json);
+
+        ASSERT_OK(sd_json_parse(json, 0, &v, NULL, NULL));
+
+        n = json_variant_cbor_size(v);
+        ASSERT_NOT_NULL(buf = malloc(n));
+        ASSERT_TRUE(json_variant_write_cbor(v, buf) == buf + n);
+
+        ASSERT_OK(json_variant_from_cbor(buf, n, &w));
+        ASSERT_TRUE(sd_json_variant_equal(v, w));
+
+        /* Truncated or padded data must be refused */
+        ASSERT_ERROR(json_variant_from_cbor(buf, n - 1, &w), EBADMSG);
+        ASSERT_NOT_NULL(buf = realloc(buf, n + 1));
+        buf[n] = 0;
+        ASSERT_ERROR(json_variant_from_cbor(buf, n + 1, &w), EBADMSG);
+}
+
+TEST(cbor) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        uint8_t buf[16];
+
+        test_cbor_roundtrip_one("null");
+        test_cbor_roundtrip_one("true");
+        test_cbor_roundtrip_one("\"\"");
+        test_cbor_roundtrip_one("\"Hello, \\u00fcnicode \\ud83d\\udc27!\"");
+        test_cbor_roundtrip_one("[0, 23, 24, 255, 256, 65535, 65536, 4294967295, 4294967296, 18446744073709551615]");
+        test_cbor_roundtrip_one("[-1, -24, -25, -256, -257, -9223372036854775808]");
+        test_cbor_roundtrip_one("[0.5, -1.25e300, 3.141592653589793]");
+        test_cbor_roundtrip_one("{\"method\":\"io.test.Foo\",\"parameters\":{\"a\":[],\"b\":{},\"c\":[{\"d\":null}]}}");
+
+        /* Check the wire format against RFC 8949 for {"a":[1000,-1,true,null]} */
+        ASSERT_OK(sd_json_parse("{\"a\":[1000,-1,true,null]}", 0, &v, NULL, NULL));
+        ASSERT_EQ(json_variant_cbor_size(v), 10U);
+        ASSERT_TRUE(json_variant_write_cbor(v, buf) == buf + 10);
+        ASSERT_EQ(memcmp(buf, (const uint8_t[]) { 0xa1, 0x61, 'a', 0x84, 0x19, 0x03, 0xe8, 0x20, 0xf5, 0xf6 }, 10), 0);
+
+        /* Things that have no JSON equivalent */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0x9f, 0xff }, 2, &v), EBADMSG);       /* indefinite length */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0x41, 0x00 }, 2, &v), EBADMSG);       /* byte string */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0xc1, 0x00 }, 2, &v), EBADMSG);       /* tag */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0xa1, 0x01, 0x02 }, 3, &v), EBADMSG); /* non-string key */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0x3b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, 9, &v), ERANGE);
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0x61, 0x00 }, 2, &v), EINVAL);        /* embedded NUL */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0x61, 0xff }, 2, &v), EUCLEAN);       /* invalid UTF-8 */
+        ASSERT_ERROR(json_variant_from_cbor((const uint8_t[]) { 0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, 9, &v), EBADMSG);
+}
+
+TEST(json_parse_intern_keys) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        const char *a, *b;
+
+        ASSERT_OK(sd_json_parse("[{\"userName\":\"foo\",\"uid\":1},{\"uid\":2,\"userName\":\"bar\"}]", 0, &v, NULL, NULL));
+
+        /* Long keys are shared between objects of the same document, short ones are stored inline */
+        ASSERT_NOT_NULL(a = sd_json_variant_string(sd_json_variant_by_index(sd_json_variant_by_index(v, 0), 0)));
+        ASSERT_NOT_NULL(b = sd_json_variant_string(sd_json_variant_by_index(sd_json_variant_by_index(v, 1), 2)));
+        ASSERT_STREQ(a, "userName");
+        ASSERT_TRUE(a == b);
+
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(sd_json_variant_by_index(v, 0), "userName")), "foo");
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(sd_json_variant_by_index(v, 1), "userName")), "bar");
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(sd_json_variant_by_index(v, 1), "uid")), 2u);
+
+        /* Marking one object sensitive must not taint the shared key, and thus the other object */
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *k = sd_json_variant_ref(sd_json_variant_by_index(sd_json_variant_by_index(v, 1), 2));
+        sd_json_variant_sensitive(sd_json_variant_by_index(v, 0));
+        v = sd_json_variant_unref(v);
+
+        ASSERT_STREQ(sd_json_variant_string(k), "userName");
+        ASSERT_FALSE(sd_json_variant_is_sensitive(k));
+}
+
+TEST(json_variant_by_key_index) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL, *w = NULL;
+        _cleanup_free_ char *fields = NULL, *text = NULL;
+
+        /* Large enough and unsorted, so that the hash index is used */
+        for (unsigned i = 40; i > 0; i--) {
+                char k[DECIMAL_STR_MAX(unsigned) + 6];
+
+                xsprintf(k, "field%u", i);
+                ASSERT_OK(sd_json_variant_set_field_unsigned(&v, k, i));
+        }
+
+        for (unsigned i = 1; i <= 40; i++) {
+                char k[DECIMAL_STR_MAX(unsigned) + 6];
+
+                xsprintf(k, "field%u", i);
+                ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(v, k)), (uint64_t) i);
+        }
+
+        ASSERT_NULL(sd_json_variant_by_key(v, "field0"));
+        ASSERT_NULL(sd_json_variant_by_key(v, "field41"));
+        ASSERT_NULL(sd_json_variant_by_key(v, ""));
+
+        /* With duplicate keys, the first one wins, as with the linear search */
+        for (unsigned i = 40; i > 0; i--)
+                ASSERT_OK(strextendf_with_separator(&fields, ",", "\"field%u\":%u", i, i));
+        ASSERT_NOT_NULL(text = strjoin("{", fields, ",\"field7\":4711}"));
+        ASSERT_OK(sd_json_parse(text, 0, &w, NULL, NULL));
+        ASSERT_EQ(sd_json_variant_elements(w), 82U);
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(w, "field7")), 7U);
+}
+
 TEST(json_parse_file_empty) {
         _cleanup_fclose_ FILE *f = NULL;
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
@@ -751,6 +886,10 @@ TEST(tokenizer) {
         test_tokenizer_one("\"\\ud800a\"", -EINVAL);
         test_tokenizer_one("\"\\udc00\\udc00\"", -EINVAL);
         test_tokenizer_one("\"\\ud801\\udc37\"", JSON_TOKEN_STRING, "\xf0\x90\x90\xb7", JSON_TOKEN_END);
+        test_tokenizer_one("\"plain ascii \\\"quoted\\\" \xef\xbf\xbd and \\u00e4 end\"", JSON_TOKEN_STRING, "plain ascii \"quoted\" \xef\xbf\xbd and \xc3\xa4 end", JSON_TOKEN_END);
+        test_tokenizer_one("\"plain ascii\x7f\"", -EINVAL);
+        test_tokenizer_one("\"plain ascii\x01\"", -EINVAL);
+        test_tokenizer_one("\"plain ascii", -EINVAL);
 
         test_tokenizer_one("[1, 2, -3]", JSON_TOKEN_ARRAY_OPEN, JSON_TOKEN_UNSIGNED, (uint64_t) 1, JSON_TOKEN_COMMA, JSON_TOKEN_UNSIGNED, (uint64_t) 2, JSON_TOKEN_COMMA, JSON_TOKEN_INTEGER, (int64_t) -3, JSON_TOKEN_ARRAY_CLOSE, JSON_TOKEN_END);
 }
@@ -1160,6 +1299,56 @@ TEST(json_iovec) {
         assert_se(iovec_memcmp(&iov1, &b) > 0);
 }
 
+static int dispatch_catch_all(const char *name, sd_json_variant *variant, sd_json_dispatch_flags_t flags, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        (*n)++;
+        return 0;
+}
+
+TEST(json_dispatch_order) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        struct {
+                uint64_t a, b, c, d;
+                unsigned n_other;
+        } data = {};
+
+        /* Keys in a different order than the table, plus one unknown key */
+        assert_se(sd_json_parse("{\"c\":3,\"a\":1,\"x\":0,\"d\":4,\"b\":2}", 0, &v, NULL, NULL) >= 0);
+
+        ASSERT_OK(sd_json_dispatch(v,
+                                   (const sd_json_dispatch_field[]) {
+                                           { "a", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, voffsetof(data, a), SD_JSON_MANDATORY },
+                                           { "b", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, voffsetof(data, b), SD_JSON_MANDATORY },
+                                           { "c", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, voffsetof(data, c), SD_JSON_MANDATORY },
+                                           { "d", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, voffsetof(data, d), SD_JSON_MANDATORY },
+                                           {},
+                                   },
+                                   SD_JSON_ALLOW_EXTENSIONS,
+                                   &data));
+
+        ASSERT_EQ(data.a, 1u);
+        ASSERT_EQ(data.b, 2u);
+        ASSERT_EQ(data.c, 3u);
+        ASSERT_EQ(data.d, 4u);
+
+        /* A catch-all entry only takes the keys that aren't matched by the entries before it */
+        data = (typeof(data)) {};
+        ASSERT_OK(sd_json_dispatch_full(v,
+                                        (const sd_json_dispatch_field[]) {
+                                                { "b",          _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, voffsetof(data, b),       0 },
+                                                { POINTER_MAX,  _SD_JSON_VARIANT_TYPE_INVALID, dispatch_catch_all,      voffsetof(data, n_other), 0 },
+                                                {},
+                                        },
+                                        /* bad= */ NULL,
+                                        /* flags= */ 0,
+                                        &data,
+                                        /* reterr_bad_field= */ NULL));
+
+        ASSERT_EQ(data.b, 2u);
+        ASSERT_EQ(data.n_other, 4u);
+}
+
 TEST(json_dispatch_nullable) {
 
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *j = NULL;
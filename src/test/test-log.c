@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <pthread.h>
 #include <stddef.h>
 #include <unistd.h>
 
@@ -219,6 +220,40 @@ static void test_log_prefix(void) {
         test_log_syntax();
 }
 
+static void* log_async_thread(void *p) {
+        for (unsigned i = 0; i < 1000; i++)
+                log_debug("Asynchronous message %u from thread %u", i, PTR_TO_UINT(p));
+
+        test_log_struct();
+        test_long_lines();
+        test_log_context();
+
+        return NULL;
+}
+
+static void test_log_async(void) {
+        pthread_t threads[4];
+
+        ASSERT_OK_POSITIVE(log_set_async(true));
+        ASSERT_OK_ZERO(log_set_async(true));
+
+        FOREACH_ELEMENT(t, threads)
+                ASSERT_EQ(pthread_create(t, NULL, log_async_thread, UINT_TO_PTR(t - threads)), 0);
+
+        /* Messages from the main thread, including ones written synchronously */
+        test_log_struct();
+        log_full(LOG_CRIT, "Critical message, written synchronously");
+
+        /* Reopening while the other threads are logging */
+        ASSERT_OK(log_open());
+
+        FOREACH_ELEMENT(t, threads)
+                ASSERT_EQ(pthread_join(*t, NULL), 0);
+
+        ASSERT_OK_ZERO(log_set_async(false));
+        ASSERT_OK_ZERO(log_set_async(false));
+}
+
 int main(int argc, char* argv[]) {
         test_setup_logging(LOG_DEBUG);
 
@@ -245,6 +280,7 @@ int main(int argc, char* argv[]) {
                 test_log_syntax();
                 test_log_context();
                 test_log_prefix();
+                test_log_async();
         }
 
         return 0;
@@ -8,6 +8,7 @@
 #include "alloc-util.h"
 #include "dlfcn-util.h"
 #include "errno-list.h"
+#include "fileio.h"
 #include "format-util.h"
 #include "log.h"
 #include "main-func.h"
@@ -19,6 +20,7 @@
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
+#include "time-util.h"
 #include "user-util.h"
 
 static size_t arg_bufsize = 1024;
@@ -160,6 +162,70 @@ static void test_byuid(void *handle, const char *module, uid_t uid) {
         puts("");
 }
 
+static enum nss_status getpwnam_status(_nss_getpwnam_r_t f, const char *name) {
+        char buffer[arg_bufsize];
+        struct passwd pwd;
+        int errno1 = 0;
+
+        return f(name, &pwd, buffer, sizeof buffer, &errno1);
+}
+
+static void add_dropin_user(const char *name, uid_t uid) {
+        _cleanup_free_ char *path = NULL, *json = NULL;
+
+        ASSERT_NOT_NULL(path = strjoin("/run/userdb/", name, ".user"));
+        ASSERT_OK(asprintf(&json, "{\"userName\":\"%s\",\"uid\":" UID_FMT ",\"disposition\":\"regular\"}", name, uid));
+        ASSERT_OK(write_string_file(path, json, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_TRUNCATE|WRITE_STRING_FILE_MKDIR_0755));
+}
+
+static void remove_dropin_user(const char *name) {
+        const char *path = strjoina("/run/userdb/", name, ".user");
+
+        ASSERT_OK_ERRNO(unlink(path));
+}
+
+static void test_systemd_cache_one(_nss_getpwnam_r_t f, const char *name, uid_t uid, bool cached) {
+        add_dropin_user(name, uid);
+        ASSERT_EQ(getpwnam_status(f, name), NSS_STATUS_SUCCESS);
+
+        /* Gone from the database, but possibly still remembered by nss-systemd */
+        remove_dropin_user(name);
+        ASSERT_EQ(getpwnam_status(f, name), cached ? NSS_STATUS_SUCCESS : NSS_STATUS_NOTFOUND);
+}
+
+static void test_systemd_cache(void *handle) {
+        _nss_getpwnam_r_t f;
+
+        /* Checks that nss-systemd briefly remembers resolved users, which we observe by removing a
+         * drop-in user record right after looking it up. */
+
+        if (geteuid() != 0) {
+                log_info("Not running as root, skipping nss-systemd cache tests.");
+                return;
+        }
+
+        ASSERT_NOT_NULL(f = dlsym(handle, "_nss_systemd_getpwnam_r"));
+
+        ASSERT_OK_ERRNO(unsetenv("SYSTEMD_NSS_CACHE"));
+        ASSERT_OK_ERRNO(unsetenv("SYSTEMD_NSS_DYNAMIC_BYPASS"));
+
+        test_systemd_cache_one(f, "test-nss-cache-hit", 4711, /* cached= */ true);
+
+        /* Entries expire after a second */
+        usleep_safe(USEC_PER_SEC + 100 * USEC_PER_MSEC);
+        ASSERT_EQ(getpwnam_status(f, "test-nss-cache-hit"), NSS_STATUS_NOTFOUND);
+
+        /* The cache can be turned off, and is bypassed when allocating dynamic users. Both are honoured
+         * even if set only after the first lookups in the process. */
+        ASSERT_OK_ERRNO(setenv("SYSTEMD_NSS_CACHE", "0", /* overwrite= */ true));
+        test_systemd_cache_one(f, "test-nss-cache-off", 4712, /* cached= */ false);
+        ASSERT_OK_ERRNO(unsetenv("SYSTEMD_NSS_CACHE"));
+
+        ASSERT_OK_ERRNO(setenv("SYSTEMD_NSS_DYNAMIC_BYPASS", "1", /* overwrite= */ true));
+        test_systemd_cache_one(f, "test-nss-cache-bypass", 4713, /* cached= */ false);
+        ASSERT_OK_ERRNO(unsetenv("SYSTEMD_NSS_DYNAMIC_BYPASS"));
+}
+
 static int test_one_module(const char *dir,
                            const char *module,
                            char **names) {
@@ -184,6 +250,9 @@ static int test_one_module(const char *dir,
                 test_byuid(handle, module, uid);
         }
 
+        if (streq(module, "systemd"))
+                test_systemd_cache(handle);
+
         log_info(" ");
         return 0;
 }
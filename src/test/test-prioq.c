@@ -8,6 +8,7 @@
 #include "siphash24.h"
 #include "sort-util.h"
 #include "tests.h"
+#include "time-util.h"
 
 #define SET_SIZE 1024*4
 
@@ -120,4 +121,150 @@ TEST(struct) {
         assert_se(set_isempty(s));
 }
 
+static void check_heap(Prioq *q, struct test *items, size_t n) {
+        unsigned previous = 0;
+        struct test *t;
+
+        ASSERT_EQ(prioq_size(q), (unsigned) n);
+
+        for (size_t i = 0; i < n; i++)
+                ASSERT_TRUE(prioq_peek_by_index(q, items[i].idx) == &items[i]);
+
+        for (size_t i = 0; i < n; i++) {
+                ASSERT_NOT_NULL(t = prioq_pop(q));
+                ASSERT_LE(previous, t->value);
+                previous = t->value;
+        }
+
+        ASSERT_TRUE(prioq_isempty(q));
+}
+
+static void test_put_many_one(size_t n_before, size_t n) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        _cleanup_free_ struct test *items = NULL;
+        _cleanup_free_ void **data = NULL;
+        _cleanup_free_ unsigned **idx = NULL;
+
+        ASSERT_NOT_NULL(q = prioq_new((compare_func_t) test_compare));
+        ASSERT_NOT_NULL(items = new(struct test, n_before + n));
+        ASSERT_NOT_NULL(data = new(void*, n));
+        ASSERT_NOT_NULL(idx = new(unsigned*, n));
+
+        for (size_t i = 0; i < n_before + n; i++)
+                items[i].value = (unsigned) rand() % 1000;
+
+        for (size_t i = 0; i < n_before; i++)
+                ASSERT_OK(prioq_put(q, &items[i], &items[i].idx));
+
+        for (size_t i = 0; i < n; i++) {
+                data[i] = &items[n_before + i];
+                idx[i] = &items[n_before + i].idx;
+        }
+
+        ASSERT_OK(prioq_put_many(q, data, idx, n));
+        check_heap(q, items, n_before + n);
+}
+
+TEST(put_many) {
+        srand(0);
+
+        /* Covers both the one-by-one and the heapify paths */
+        test_put_many_one(0, 0);
+        test_put_many_one(0, 1);
+        test_put_many_one(0, SET_SIZE);
+        test_put_many_one(SET_SIZE, 3);
+        test_put_many_one(SET_SIZE, SET_SIZE);
+        test_put_many_one(7, 5);
+}
+
+TEST(reshuffle_batch) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        struct test items[SET_SIZE];
+        void *data[SET_SIZE];
+        unsigned *idx[SET_SIZE];
+
+        srand(0);
+
+        ASSERT_NOT_NULL(q = prioq_new((compare_func_t) test_compare));
+
+        FOREACH_ARRAY(t, items, ELEMENTSOF(items)) {
+                t->value = (unsigned) rand();
+                ASSERT_OK(prioq_put(q, t, &t->idx));
+        }
+
+        /* Change a few priorities, that's fixed up item by item… */
+        for (size_t i = 0; i < 5; i++) {
+                items[i * 3].value = (unsigned) rand();
+                data[i] = &items[i * 3];
+                idx[i] = &items[i * 3].idx;
+        }
+        prioq_reshuffle_batch(q, data, idx, 5);
+
+        /* …and then most of them, for which the heap is rebuilt */
+        for (size_t i = 0; i < SET_SIZE / 2; i++) {
+                items[i * 2].value = (unsigned) rand();
+                data[i] = &items[i * 2];
+                idx[i] = &items[i * 2].idx;
+        }
+        prioq_reshuffle_batch(q, data, idx, SET_SIZE / 2);
+
+        check_heap(q, items, ELEMENTSOF(items));
+}
+
+static void benchmark_one(unsigned n) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        _cleanup_free_ struct test *items = NULL;
+        _cleanup_free_ void **data = NULL;
+        usec_t ts, put, put_many, reshuffle, pop;
+
+        ASSERT_NOT_NULL(q = prioq_new((compare_func_t) test_compare));
+        ASSERT_NOT_NULL(items = new(struct test, n));
+        ASSERT_NOT_NULL(data = new(void*, n));
+
+        for (unsigned i = 0; i < n; i++) {
+                items[i].value = (unsigned) rand();
+                data[i] = &items[i];
+        }
+
+        ts = now(CLOCK_MONOTONIC);
+        for (unsigned i = 0; i < n; i++)
+                ASSERT_OK(prioq_put(q, &items[i], &items[i].idx));
+        put = now(CLOCK_MONOTONIC) - ts;
+
+        /* This resembles what sd-event does with its time queues: the earliest item is rescheduled */
+        ts = now(CLOCK_MONOTONIC);
+        for (unsigned i = 0; i < n; i++) {
+                struct test *t = prioq_peek(q);
+
+                t->value += (unsigned) rand() % 1000000;
+                prioq_reshuffle(q, t, &t->idx);
+        }
+        reshuffle = now(CLOCK_MONOTONIC) - ts;
+
+        ts = now(CLOCK_MONOTONIC);
+        while (prioq_pop(q))
+                ;
+        pop = now(CLOCK_MONOTONIC) - ts;
+
+        ts = now(CLOCK_MONOTONIC);
+        ASSERT_OK(prioq_put_many(q, data, NULL, n));
+        put_many = now(CLOCK_MONOTONIC) - ts;
+
+        log_info("%9u items: put %s, put_many %s, reshuffle %s, pop %s",
+                 n,
+                 FORMAT_TIMESPAN(put, 1),
+                 FORMAT_TIMESPAN(put_many, 1),
+                 FORMAT_TIMESPAN(reshuffle, 1),
+                 FORMAT_TIMESPAN(pop, 1));
+}
+
+TEST(benchmark) {
+        unsigned max = slow_tests_enabled() ? 1U << 20 : 1U << 14;
+
+        srand(0);
+
+        for (unsigned n = 1U << 10; n <= max; n <<= 2)
+                benchmark_one(n);
+}
+
 DEFINE_TEST_MAIN(LOG_INFO);
@@ -1125,6 +1125,35 @@ TEST(strv_copy_n) {
         assert_se(strv_equal(l, STRV_MAKE("a", "b", "c", "d", "e")));
 }
 
+TEST(strv_copy_packed) {
+        _cleanup_strv_free_ char **l = NULL, **p = NULL;
+        _cleanup_strv_free_erase_ char **e = NULL;
+
+        l = strv_copy_packed(STRV_MAKE("foo", "", "bar", "a somewhat longer string"));
+        ASSERT_NOT_NULL(l);
+        ASSERT_TRUE(strv_equal(l, STRV_MAKE("foo", "", "bar", "a somewhat longer string")));
+        ASSERT_EQ(strv_length(l), 4u);
+        ASSERT_TRUE((char*) (l + 5) == l[0]);
+        l = strv_free(l);
+
+        l = strv_copy_packed(NULL);
+        ASSERT_NOT_NULL(l);
+        ASSERT_TRUE(strv_isempty(l));
+        l = strv_free(l);
+
+        ASSERT_NOT_NULL(p = strv_new("one", "two", "three"));
+        ASSERT_OK_POSITIVE(strv_pack(&p));
+        ASSERT_TRUE(strv_equal(p, STRV_MAKE("one", "two", "three")));
+        ASSERT_OK_ZERO(strv_pack(&p));
+        ASSERT_TRUE(strv_equal(p, STRV_MAKE("one", "two", "three")));
+
+        l = strv_copy(p);
+        ASSERT_TRUE(strv_equal(l, p));
+
+        ASSERT_NOT_NULL(e = strv_new("secret"));
+        ASSERT_OK_POSITIVE(strv_pack(&e));
+}
+
 TEST(strv_find_first_field) {
         char **haystack = STRV_MAKE("a", "b", "c", "d", "e", "f", "g", "h", "i", "j");
 
@@ -1,11 +1,17 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "fileio.h"
+#include "fs-util.h"
 #include "initrd-util.h"
+#include "mkdir.h"
 #include "path-lookup.h"
+#include "path-util.h"
+#include "rm-rf.h"
 #include "set.h"
 #include "special.h"
 #include "strv.h"
 #include "tests.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 TEST(unit_validate_alias_symlink_and_warn) {
@@ -86,6 +92,103 @@ TEST(unit_file_build_name_map) {
         }
 }
 
+static void assert_name_maps_equal(Hashmap *ids_a, Hashmap *names_a, Set *paths_a, Hashmap *ids_b, Hashmap *names_b, Set *paths_b) {
+        const char *k, *d;
+        char **l;
+
+        ASSERT_EQ(hashmap_size(ids_a), hashmap_size(ids_b));
+        HASHMAP_FOREACH_KEY(d, k, ids_a)
+                ASSERT_STREQ(hashmap_get(ids_b, k), d);
+
+        ASSERT_EQ(hashmap_size(names_a), hashmap_size(names_b));
+        HASHMAP_FOREACH_KEY(l, k, names_a)
+                ASSERT_TRUE(strv_equal(hashmap_get(names_b, k), l));
+
+        ASSERT_TRUE(set_equal(paths_a, paths_b));
+}
+
+TEST(unit_file_build_name_map_cache) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL, *cached_ids = NULL, *cached_names = NULL;
+        _cleanup_set_free_ Set *paths = NULL, *cached_paths = NULL;
+        _cleanup_free_ char *etc = NULL, *lib = NULL, *cache = NULL;
+        LookupPaths lp = {};
+        uint64_t hash = 0;
+        struct stat st;
+
+        ASSERT_OK(mkdtemp_malloc(NULL, &t));
+        ASSERT_NOT_NULL(etc = path_join(t, "etc"));
+        ASSERT_NOT_NULL(lib = path_join(t, "lib"));
+        ASSERT_NOT_NULL(cache = path_join(t, "run/unit-name-map.cache"));
+        ASSERT_OK(mkdir_p(etc, 0755));
+        ASSERT_OK(mkdir_p(lib, 0755));
+
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(lib, "/a.service"), "[Service]\n", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(lib, "/b@.service"), "[Service]\n", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK_ERRNO(symlink("a.service", strjoina(lib, "/alias.service")));
+        ASSERT_OK_ERRNO(symlink("/dev/null", strjoina(etc, "/masked.service")));
+        ASSERT_OK(mkdir_p(strjoina(etc, "/a.service.d"), 0755));
+
+        lp.search_path = STRV_MAKE(etc, lib);
+        lp.runtime_config = strjoina(t, "/run/system");
+        ASSERT_OK(mkdir_p(strjoina(t, "/run"), 0755));
+
+        /* The first build scans the directories and stores the cache, the second one loads it */
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &ids, &names, &paths));
+        ASSERT_OK_ERRNO(access(cache, F_OK));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &cached_ids, &cached_names, &cached_paths));
+        assert_name_maps_equal(ids, names, paths, cached_ids, cached_names, cached_paths);
+        ASSERT_STREQ(hashmap_get(cached_ids, "alias.service"), "a.service");
+        ASSERT_TRUE(set_contains(cached_paths, strjoina(etc, "/a.service.d")));
+
+        /* Without path cache the maps are loaded just the same */
+        cached_ids = hashmap_free(cached_ids);
+        cached_names = hashmap_free(cached_names);
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &cached_ids, &cached_names, NULL));
+        assert_name_maps_equal(ids, names, NULL, cached_ids, cached_names, NULL);
+
+        /* A change of a directory invalidates the cache */
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(etc, "/c.service"), "[Service]\n", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(touch_file(etc, /* parents= */ false, now(CLOCK_REALTIME) + USEC_PER_SEC, UID_INVALID, GID_INVALID, MODE_INVALID));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &cached_ids, &cached_names, NULL));
+        ASSERT_STREQ(hashmap_get(cached_ids, "c.service"), strjoina(etc, "/c.service"));
+
+        /* A corrupted cache is ignored */
+        ASSERT_OK(write_string_file(cache, "SDUNMAP2garbage", WRITE_STRING_FILE_TRUNCATE));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &cached_ids, &cached_names, NULL));
+        ASSERT_STREQ(hashmap_get(cached_ids, "a.service"), strjoina(lib, "/a.service"));
+
+        /* A forced rescan doesn't use the cache, as that doesn't notice changes that leave the mtimes of the
+         * directories alone, such as an alias retargeted in place */
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(lib, "/d.service"), "[Service]\n", WRITE_STRING_FILE_CREATE));
+        paths = set_free(paths);
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &ids, &names, &paths));
+        ASSERT_OK_ERRNO(stat(lib, &st));
+        ASSERT_OK_ERRNO(unlink(strjoina(lib, "/alias.service")));
+        ASSERT_OK_ERRNO(symlink("d.service", strjoina(lib, "/alias.service")));
+        ASSERT_OK(touch_file(lib, /* parents= */ false, timespec_load(&st.st_mtim), UID_INVALID, GID_INVALID, MODE_INVALID));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, &hash, &cached_ids, &cached_names, NULL));
+        ASSERT_STREQ(hashmap_get(cached_ids, "alias.service"), "d.service");
+
+        /* Loading the cache notices such changes too, as well as a unit file truncated to mask it */
+        paths = set_free(paths);
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &ids, &names, &paths));
+        ASSERT_TRUE(strv_contains(hashmap_get(names, "d.service"), "alias.service"));
+        ASSERT_OK_ERRNO(stat(lib, &st));
+        ASSERT_OK_ERRNO(unlink(strjoina(lib, "/alias.service")));
+        ASSERT_OK_ERRNO(symlink("a.service", strjoina(lib, "/alias.service")));
+        ASSERT_OK(touch_file(lib, /* parents= */ false, timespec_load(&st.st_mtim), UID_INVALID, GID_INVALID, MODE_INVALID));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &cached_ids, &cached_names, NULL));
+        ASSERT_STREQ(hashmap_get(cached_ids, "alias.service"), "a.service");
+
+        paths = set_free(paths);
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &ids, &names, &paths));
+        ASSERT_NOT_NULL(hashmap_get(names, "a.service"));
+        ASSERT_OK_ERRNO(truncate(strjoina(lib, "/a.service"), 0));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, &cached_ids, &cached_names, NULL));
+        ASSERT_NULL(hashmap_get(cached_names, "a.service"));
+}
+
 TEST(runlevel_to_target) {
         in_initrd_force(false);
         ASSERT_STREQ(runlevel_to_target(NULL), NULL);
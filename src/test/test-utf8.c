@@ -37,6 +37,16 @@ TEST(utf8_is_valid) {
         assert_se(utf8_is_valid("ascii is valid unicode"));
         assert_se(utf8_is_valid("\342\204\242"));
         assert_se(!utf8_is_valid("\341\204"));
+
+        /* Multi-byte sequences and invalid bytes after, and straddling, runs of eight ASCII characters */
+        assert_se( utf8_is_valid("0123456789abcdef\342\204\242"));
+        assert_se( utf8_is_valid("0123456\342\204\2429abcdef"));
+        assert_se(!utf8_is_valid("0123456789abcde\342\204"));
+        assert_se(!utf8_is_valid("0123456789abcdef\377"));
+        assert_se(!utf8_is_valid("01234567\20089abcdef"));
+        assert_se(!utf8_is_valid_n("0123456789abcdef", 17));
+        assert_se( utf8_is_valid_n("0123456789abcdef\377", 16));
+        assert_se(!utf8_is_valid_n("01234567\00089abcdef", 16));
 }
 
 TEST(ascii_is_valid) {
@@ -11,11 +11,14 @@
 #include "fd-util.h"
 #include "json-util.h"
 #include "memfd-util.h"
+#include "path-util.h"
 #include "rm-rf.h"
+#include "socket-util.h"
 #include "strv.h"
 #include "tests.h"
 #include "tmpfile-util.h"
 #include "user-util.h"
+#include "varlink-internal.h"
 #include "varlink-util.h"
 
 /* Let's pick some high value, that is higher than the largest listen() backlog, but leaves enough room below
@@ -315,6 +318,27 @@ static void *thread(void *arg) {
         ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(o, "method")), "io.test.IDontExist");
         ASSERT_STREQ(e, SD_VARLINK_ERROR_METHOD_NOT_FOUND);
 
+        /* Switch to CBOR, and check that everything continues to work */
+        ASSERT_EQ(varlink_negotiate_binary_encoding(c), 1);
+        ASSERT_EQ(varlink_negotiate_binary_encoding(c), 1);
+
+        assert_se(sd_varlink_call(c, "io.test.DoSomething", i, &o, &e) >= 0);
+        assert_se(sd_json_variant_integer(sd_json_variant_by_key(o, "sum")) == 88 + 99);
+        assert_se(!e);
+
+        x = 0;
+        assert_se(sd_varlink_collect(c, "io.test.DoSomethingMore", i, &j, &error_id) >= 0);
+        assert_se(!error_id);
+        JSON_VARIANT_ARRAY_FOREACH(k, j) {
+                assert_se(sd_json_variant_integer(sd_json_variant_by_key(k, "sum")) == 88 + (99 * x));
+                x++;
+        }
+        assert_se(x == 6);
+
+        assert_se(sd_varlink_callb(c, "io.test.IDontExist", &o, &e, SD_JSON_BUILD_OBJECT(SD_JSON_BUILD_PAIR("x", SD_JSON_BUILD_REAL(5.5)))) >= 0);
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(o, "method")), "io.test.IDontExist");
+        ASSERT_STREQ(e, SD_VARLINK_ERROR_METHOD_NOT_FOUND);
+
         flood_test(arg);
 
         assert_se(sd_varlink_send(c, "io.test.Done", NULL) >= 0);
@@ -445,4 +469,103 @@ TEST(invalid_parameter) {
         assert_se(sd_event_loop(e) >= 0);
 }
 
+static size_t count_messages(const char *buf, size_t n) {
+        size_t c = 0;
+
+        for (const char *p = buf; (p = memchr(p, 0, buf + n - p)); p++)
+                c++;
+
+        return c;
+}
+
+TEST(pipelining) {
+        static const char calls[] =
+                "{\"method\":\"io.test.DoSomething\",\"parameters\":{\"a\":1,\"b\":2}}\0"
+                "{\"method\":\"io.test.DoSomething\",\"parameters\":{\"a\":3,\"b\":4}}\0"
+                "{\"method\":\"io.test.DoSomething\",\"parameters\":{\"a\":5,\"b\":6}}";
+        _cleanup_(sd_varlink_server_unrefp) sd_varlink_server *s = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        char buf[4096];
+        size_t n = 0;
+        int connfd[2], sum;
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(sd_varlink_server_new(&s, 0));
+        ASSERT_OK(sd_varlink_server_attach_event(s, e, 0));
+        ASSERT_OK(sd_varlink_server_bind_method(s, "io.test.DoSomething", method_something));
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0, connfd));
+        ASSERT_OK(sd_varlink_server_add_connection(s, connfd[0], /* ret= */ NULL));
+        fd = connfd[1];
+
+        /* Send three calls in one go, without waiting for the replies in between */
+        ASSERT_EQ(write(fd, calls, sizeof(calls)), (ssize_t) sizeof(calls));
+
+        while (count_messages(buf, n) < 3) {
+                ssize_t l;
+
+                ASSERT_OK(sd_event_run(e, USEC_INFINITY));
+
+                l = read(fd, buf + n, sizeof(buf) - n);
+                if (l < 0)
+                        ASSERT_EQ(errno, EAGAIN);
+                else
+                        n += l;
+        }
+
+        /* The replies must arrive in order */
+        const char *p = buf;
+        FOREACH_ARGUMENT(sum, 3, 7, 11) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+
+                ASSERT_OK(sd_json_parse(p, 0, &v, NULL, NULL));
+                ASSERT_EQ(sd_json_variant_integer(sd_json_variant_by_key(sd_json_variant_by_key(v, "parameters"), "sum")), sum);
+                p += strlen(p) + 1;
+        }
+}
+
+static int thread_pool_setup(sd_varlink_server *server, void *userdata) {
+        return sd_varlink_server_bind_method(server, "io.test.DoSomething", method_something);
+}
+
+TEST(thread_pool) {
+        _cleanup_(varlink_thread_pool_stopp) VarlinkThreadPool *p = NULL;
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        _cleanup_close_ int listen_fd = -EBADF;
+        _cleanup_free_ char *sp = NULL;
+        union sockaddr_union sa;
+        sd_varlink *clients[16] = {};
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/varlink-test-XXXXXX", &tmpdir));
+        ASSERT_NOT_NULL(sp = path_join(tmpdir, "socket"));
+
+        ASSERT_OK_ERRNO(listen_fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0));
+        ASSERT_OK(sockaddr_un_set_path(&sa.un, sp));
+        ASSERT_OK_ERRNO(bind(listen_fd, &sa.sa, SOCKADDR_UN_LEN(sa.un)));
+        ASSERT_OK_ERRNO(listen(listen_fd, SOMAXCONN_DELUXE));
+
+        ASSERT_OK(varlink_thread_pool_start(&p, listen_fd, 4, /* flags= */ 0, thread_pool_setup, NULL));
+
+        /* Keep all connections open at the same time, so that they are spread over the threads */
+        FOREACH_ELEMENT(c, clients)
+                ASSERT_OK(sd_varlink_connect_address(c, sp));
+
+        for (size_t i = 0; i < ELEMENTSOF(clients); i++) {
+                sd_json_variant *o = NULL;
+                const char *e = NULL;
+
+                ASSERT_OK(sd_varlink_callbo(clients[i], "io.test.DoSomething", &o, &e,
+                                            SD_JSON_BUILD_PAIR_INTEGER("a", i),
+                                            SD_JSON_BUILD_PAIR_INTEGER("b", 1)));
+                ASSERT_NULL(e);
+                ASSERT_EQ(sd_json_variant_integer(sd_json_variant_by_key(o, "sum")), (int64_t) i + 1);
+        }
+
+        FOREACH_ELEMENT(c, clients)
+                *c = sd_varlink_flush_close_unref(*c);
+
+        p = varlink_thread_pool_stop(p);
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "hash-funcs.h"
+#include "sort-util.h"
+#include "tests.h"
+#include "wyhash.h"
+
+TEST(wyhash_reference) {
+        /* The test vectors published with the reference implementation, with the index as seed */
+        ASSERT_EQ(wyhash_string("", 0), UINT64_C(0x0409638ee2bde459));
+        ASSERT_EQ(wyhash_string("a", 1), UINT64_C(0xa8412d091b5fe0a9));
+        ASSERT_EQ(wyhash_string("abc", 2), UINT64_C(0x32dd92e4b2915153));
+        ASSERT_EQ(wyhash_string("message digest", 3), UINT64_C(0x8619124089a3a16b));
+        ASSERT_EQ(wyhash_string("abcdefghijklmnopqrstuvwxyz", 4), UINT64_C(0x7a43afb61d7f5f40));
+        ASSERT_EQ(wyhash_string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 5),
+                  UINT64_C(0xff42329b90e50d58));
+        ASSERT_EQ(wyhash_string("12345678901234567890123456789012345678901234567890123456789012345678901234567890", 6),
+                  UINT64_C(0xc39cab13b115aad3));
+}
+
+TEST(wyhash) {
+        uint64_t hashes[257];
+        uint8_t buf[256];
+
+        for (size_t i = 0; i < sizeof(buf); i++)
+                buf[i] = (uint8_t) (i * 7 + 3);
+
+        ASSERT_EQ(wyhash(NULL, 0, 0), wyhash("", 0, 0));
+        ASSERT_EQ(wyhash_string("foobar", 1), wyhash("foobar", 6, 1));
+        ASSERT_TRUE(wyhash_string("foobar", 1) != wyhash_string("foobar", 2));
+
+        /* Every prefix length goes through a different combination of head and tail reads, and all of them
+         * must hash differently. Also flip each bit of the last byte, which only some of the reads cover. */
+        for (size_t n = 0; n <= sizeof(buf); n++) {
+                hashes[n] = wyhash(buf, n, 42);
+                ASSERT_EQ(hashes[n], wyhash(buf, n, 42));
+
+                if (n == 0)
+                        continue;
+
+                for (unsigned bit = 0; bit < 8; bit++) {
+                        buf[n - 1] ^= 1U << bit;
+                        ASSERT_TRUE(wyhash(buf, n, 42) != hashes[n]);
+                        buf[n - 1] ^= 1U << bit;
+                }
+        }
+
+        typesafe_qsort(hashes, ELEMENTSOF(hashes), uint64_compare_func);
+        for (size_t i = 1; i < ELEMENTSOF(hashes); i++)
+                ASSERT_TRUE(hashes[i - 1] != hashes[i]);
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
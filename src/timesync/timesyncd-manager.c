@@ -9,6 +9,8 @@
 #include <sys/timerfd.h>
 #include <sys/timex.h>
 #include <sys/types.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
 #include "sd-daemon.h"
 #include "sd-messages.h"
@@ -62,6 +64,11 @@
 
 #define TIMEOUT_USEC (10*USEC_PER_SEC)
 
+/* Like CMSG_SPACE_TIMESPEC, leave room for glibc converting the timestamps on 32-bit arches. */
+#define CMSG_SPACE_SCM_TIMESTAMPING                                     \
+        (CMSG_SPACE(sizeof(struct scm_timestamping)) +                  \
+         CMSG_SPACE(3 * sizeof(struct timespec_large)))
+
 static int manager_arm_timer(Manager *m, usec_t next);
 static int manager_clock_watch_setup(Manager *m);
 static int manager_listen_setup(Manager *m);
@@ -93,6 +100,60 @@ static int manager_timeout(sd_event_source *source, usec_t usec, void *userdata)
         return manager_connect(m);
 }
 
+static size_t manager_read_tx_timestamps(Manager *m) {
+        size_t n = 0;
+
+        assert(m);
+
+        /* With SO_TIMESTAMPING, the kernel queues the time at which each request was handed to the network
+         * device to the error queue of the socket. This is more accurate than taking the time right before
+         * sendto(), as it excludes the time spent in the network stack, just like the receive timestamp.
+         * Returns the number of messages read from the error queue. */
+
+        if (!m->tx_timestamping || m->server_socket < 0)
+                return 0;
+
+        for (;;) {
+                /* This needs to be initialized with zero. See #20741. */
+                CMSG_BUFFER_TYPE(CMSG_SPACE_SCM_TIMESTAMPING +
+                                 CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))) control = {};
+                struct msghdr msghdr = {
+                        .msg_control = &control,
+                        .msg_controllen = sizeof(control),
+                };
+                struct scm_timestamping *tss;
+                struct sock_extended_err *ee;
+                ssize_t len;
+
+                len = recvmsg_safe(m->server_socket, &msghdr, MSG_ERRQUEUE|MSG_DONTWAIT);
+                if (ERRNO_IS_NEG_TRANSIENT(len))
+                        return n;
+                if (len < 0) {
+                        log_debug_errno(len, "Failed to read transmit timestamp, ignoring: %m");
+                        return n;
+                }
+
+                n++;
+
+                tss = CMSG_FIND_DATA(&msghdr, SOL_SOCKET, SCM_TIMESTAMPING, struct scm_timestamping);
+                if (!tss || timespec_load_nsec(&tss->ts[0]) == 0)
+                        continue;
+
+                ee = CMSG_FIND_DATA(&msghdr, SOL_IP, IP_RECVERR, struct sock_extended_err) ?:
+                        CMSG_FIND_DATA(&msghdr, SOL_IPV6, IPV6_RECVERR, struct sock_extended_err);
+                if (ee && (ee->ee_origin != SO_EE_ORIGIN_TIMESTAMPING || ee->ee_info != SCM_TSTAMP_SND))
+                        continue;
+
+                /* Timestamps queued before the last request was sent are dropped there. The kernel cannot
+                 * have sent the request before we started sending it, unless the clock was changed. */
+                if (!m->tx_timestamp_pending || timespec_load_nsec(&tss->ts[0]) < timespec_load_nsec(&m->trans_time))
+                        continue;
+
+                m->trans_time = tss->ts[0];
+                m->tx_timestamp_pending = false;
+        }
+}
+
 static int manager_send_request(Manager *m) {
         _cleanup_free_ char *pretty = NULL;
         struct ntp_msg ntpmsg = {
@@ -130,9 +191,14 @@ static int manager_send_request(Manager *m) {
 
         server_address_pretty(m->current_server_address, &pretty);
 
+        /* Drop the transmit timestamps of earlier requests, in case they were not read yet. */
+        m->tx_timestamp_pending = false;
+        (void) manager_read_tx_timestamps(m);
+
         /*
          * Record the transmit timestamp. This should be as close as possible to
-         * the send-to to ensure the timestamp is reasonably accurate
+         * the send-to to ensure the timestamp is reasonably accurate. If the
+         * kernel reports when the packet was actually sent, that replaces it.
          */
         assert_se(clock_gettime(CLOCK_BOOTTIME, &m->trans_time_mon) >= 0);
         assert_se(clock_gettime(CLOCK_REALTIME, &m->trans_time) >= 0);
@@ -140,6 +206,7 @@ static int manager_send_request(Manager *m) {
         len = sendto(m->server_socket, &ntpmsg, sizeof(ntpmsg), MSG_DONTWAIT, &m->current_server_address->sockaddr.sa, m->current_server_address->socklen);
         if (len == sizeof(ntpmsg)) {
                 m->pending = true;
+                m->tx_timestamp_pending = m->tx_timestamping;
                 log_debug("Sent NTP request to %s (%s).", strna(pretty), m->current_server_name->string);
         } else {
                 log_debug_errno(errno, "Sending NTP request to %s (%s) failed: %m", strna(pretty), m->current_server_name->string);
@@ -398,7 +465,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 .iov_len = sizeof(ntpmsg),
         };
         /* This needs to be initialized with zero. See #20741. */
-        CMSG_BUFFER_TYPE(CMSG_SPACE_TIMESPEC) control = {};
+        CMSG_BUFFER_TYPE(CMSG_SPACE_TIMESPEC + CMSG_SPACE_SCM_TIMESTAMPING) control = {};
         union sockaddr_union server_addr;
         struct msghdr msghdr = {
                 .msg_iov = &iov,
@@ -408,6 +475,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 .msg_name = &server_addr,
                 .msg_namelen = sizeof(server_addr),
         };
+        struct scm_timestamping *tss;
         struct timespec *recv_time;
         triple_timestamp dts;
         ssize_t len;
@@ -417,6 +485,16 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
 
         assert(source);
 
+        /* A non-empty error queue is signalled as EPOLLERR too, which is expected when transmit timestamps
+         * are enabled. If there was nothing to read, there is an actual error. If there is an error in
+         * addition to the timestamps, we will get here again. */
+        if ((revents & EPOLLERR) && !(revents & EPOLLHUP) && manager_read_tx_timestamps(m) > 0) {
+                if (!(revents & EPOLLIN))
+                        return 0;
+
+                revents &= ~EPOLLERR;
+        }
+
         if (revents & (EPOLLHUP|EPOLLERR)) {
                 log_warning("Server connection returned error.");
                 return manager_connect(m);
@@ -446,7 +524,11 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 return 0;
         }
 
-        recv_time = CMSG_FIND_AND_COPY_DATA(&msghdr, SOL_SOCKET, SCM_TIMESTAMPNS, struct timespec);
+        tss = CMSG_FIND_AND_COPY_DATA(&msghdr, SOL_SOCKET, SCM_TIMESTAMPING, struct scm_timestamping);
+        if (tss && timespec_load_nsec(&tss->ts[0]) > 0)
+                recv_time = &tss->ts[0];
+        else
+                recv_time = CMSG_FIND_AND_COPY_DATA(&msghdr, SOL_SOCKET, SCM_TIMESTAMPNS, struct timespec);
         if (!recv_time)
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Packet timestamp missing.");
 
@@ -497,6 +579,12 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
         m->pending = false;
         m->retry_interval = 0;
 
+        /* Pick up the transmit timestamp, in case the reply was processed before it */
+        (void) manager_read_tx_timestamps(m);
+        if (m->tx_timestamp_pending)
+                log_debug("Kernel did not report transmit timestamp of the request, using the time it was sent.");
+        m->tx_timestamp_pending = false;
+
         /* Stop listening */
         manager_listen_stop(m);
 
@@ -653,9 +741,20 @@ static int manager_listen_setup(Manager *m) {
         if (r < 0)
                 return -errno;
 
-        r = setsockopt_int(m->server_socket, SOL_SOCKET, SO_TIMESTAMPNS, true);
-        if (r < 0)
-                return r;
+        /* Prefer SO_TIMESTAMPING, which also reports when requests left the host. */
+        r = setsockopt_int(m->server_socket, SOL_SOCKET, SO_TIMESTAMPING,
+                           SOF_TIMESTAMPING_RX_SOFTWARE |
+                           SOF_TIMESTAMPING_TX_SOFTWARE |
+                           SOF_TIMESTAMPING_SOFTWARE |
+                           SOF_TIMESTAMPING_OPT_TSONLY);
+        m->tx_timestamping = r >= 0;
+        if (r < 0) {
+                log_debug_errno(r, "Failed to enable SO_TIMESTAMPING, falling back to SO_TIMESTAMPNS: %m");
+
+                r = setsockopt_int(m->server_socket, SOL_SOCKET, SO_TIMESTAMPNS, true);
+                if (r < 0)
+                        return r;
+        }
 
         (void) socket_set_option(m->server_socket, addr.sa.sa_family, IP_TOS, IPV6_TCLASS, IPTOS_DSCP_EF);
 
@@ -68,6 +68,8 @@ struct Manager {
         struct timespec trans_time_mon;
         struct timespec trans_time;
         struct ntp_ts request_nonce;
+        bool tx_timestamping;         /* Whether the kernel reports when the request left */
+        bool tx_timestamp_pending;    /* Whether trans_time still needs to be replaced by that */
         usec_t retry_interval;
         usec_t connection_retry_usec;
         bool pending;
@@ -682,12 +682,21 @@ static int dir_cleanup(
                 AgeBy age_by_dir) {
 
         bool deleted = false;
+        unsigned mask;
         int r = 0;
 
         assert(c);
         assert(i);
         assert(d);
 
+        /* Only ask for the timestamps we'll actually look at. Access and modification times are always
+         * needed though, since we restore them on directories we removed entries from. */
+        mask = STATX_TYPE|STATX_MODE|STATX_UID|STATX_ATIME|STATX_MTIME;
+        if ((age_by_file | age_by_dir) & AGE_BY_CTIME)
+                mask |= STATX_CTIME;
+        if ((age_by_file | age_by_dir) & AGE_BY_BTIME)
+                mask |= STATX_BTIME;
+
         FOREACH_DIRENT_ALL(de, d, break) {
                 _cleanup_free_ char *sub_path = NULL;
                 nsec_t atime_nsec, mtime_nsec, ctime_nsec, btime_nsec;
@@ -695,6 +704,31 @@ static int dir_cleanup(
                 if (dot_or_dot_dot(de->d_name))
                         continue;
 
+                /* Nothing but directories is ever removed from a level we keep, and those only matter because
+                 * we need to descend into them. If readdir() already told us the inode type, don't bother
+                 * with statx() for anything else. */
+                if (keep_this_level && !IN_SET(de->d_type, DT_DIR, DT_UNKNOWN)) {
+                        log_debug("Keeping \"%s/%s\".", p, de->d_name);
+                        continue;
+                }
+
+                sub_path = path_join(p, de->d_name);
+                if (!sub_path) {
+                        r = log_oom();
+                        goto finish;
+                }
+
+                /* Is there an item configured for this path? */
+                if (ordered_hashmap_get(c->items, sub_path)) {
+                        log_debug("Ignoring \"%s\": a separate entry exists.", sub_path);
+                        continue;
+                }
+
+                if (find_glob(c->globs, sub_path)) {
+                        log_debug("Ignoring \"%s\": a separate glob exists.", sub_path);
+                        continue;
+                }
+
                 /* If statx() is supported, use it. It's preferable over fstatat() since it tells us
                  * explicitly where we are looking at a mount point, for free as side information. Determining
                  * the same information without statx() is hard, see the complexity of path_is_mount_point(),
@@ -711,7 +745,7 @@ static int dir_cleanup(
                 r = statx_fallback(
                                 dirfd(d), de->d_name,
                                 AT_SYMLINK_NOFOLLOW|AT_NO_AUTOMOUNT,
-                                STATX_TYPE|STATX_MODE|STATX_UID|STATX_ATIME|STATX_MTIME|STATX_CTIME|STATX_BTIME,
+                                mask,
                                 &sx);
                 if (r == -ENOENT)
                         continue;
@@ -758,23 +792,6 @@ static int dir_cleanup(
                 ctime_nsec = FLAGS_SET(sx.stx_mask, STATX_CTIME) ? statx_timestamp_load_nsec(&sx.stx_ctime) : 0;
                 btime_nsec = FLAGS_SET(sx.stx_mask, STATX_BTIME) ? statx_timestamp_load_nsec(&sx.stx_btime) : 0;
 
-                sub_path = path_join(p, de->d_name);
-                if (!sub_path) {
-                        r = log_oom();
-                        goto finish;
-                }
-
-                /* Is there an item configured for this path? */
-                if (ordered_hashmap_get(c->items, sub_path)) {
-                        log_debug("Ignoring \"%s\": a separate entry exists.", sub_path);
-                        continue;
-                }
-
-                if (find_glob(c->globs, sub_path)) {
-                        log_debug("Ignoring \"%s\": a separate glob exists.", sub_path);
-                        continue;
-                }
-
                 if (S_ISDIR(sx.stx_mode)) {
                         _cleanup_closedir_ DIR *sub_dir = NULL;
 
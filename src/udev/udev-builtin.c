@@ -120,9 +120,15 @@ int udev_builtin_run(UdevEvent *event, UdevBuiltinCommand cmd, const char *comma
         if (r < 0)
                 return r;
 
+        usec_t start_usec = now(CLOCK_MONOTONIC);
+
         /* we need '0' here to reset the internal state */
         optind = 0;
-        return builtins[cmd]->cmd(event, strv_length(argv), argv);
+        r = builtins[cmd]->cmd(event, strv_length(argv), argv);
+
+        event->timing.builtin_usec[cmd] += usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
+        event->timing.n_builtin_runs[cmd]++;
+        return r;
 }
 
 int udev_builtin_add_property(UdevEvent *event, const char *key, const char *val) {
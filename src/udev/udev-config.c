@@ -35,6 +35,7 @@ static void manager_parse_udev_config(UdevConfig *config) {
                 { NULL, "event_timeout",  config_parse_sec,                 0, &config->timeout_usec        },
                 { NULL, "resolve_names",  config_parse_resolve_name_timing, 0, &config->resolve_name_timing },
                 { NULL, "timeout_signal", config_parse_signal,              0, &config->timeout_signal      },
+                { NULL, "coalesce_change_events", config_parse_bool,        0, &config->coalesce_change_events },
                 {}
         };
 
@@ -269,6 +270,7 @@ static void manager_merge_config(Manager *manager) {
         MERGE_NON_ZERO(timeout_usec, DEFAULT_WORKER_TIMEOUT_USEC);
         MERGE_NON_ZERO(timeout_signal, SIGKILL);
         MERGE_BOOL(blockdev_read_only);
+        MERGE_BOOL(coalesce_change_events);
 }
 
 void udev_config_set_default_children_max(UdevConfig *config) {
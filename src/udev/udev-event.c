@@ -10,6 +10,7 @@
 #include "path-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "udev-builtin.h"
 #include "udev-event.h"
 #include "udev-node.h"
 #include "udev-rules.h"
@@ -57,6 +58,7 @@ static UdevEvent* udev_event_free(UdevEvent *event) {
         free(event->program_result);
         free(event->name);
         strv_free(event->altnames);
+        hashmap_free(event->timing.lines);
 
         return mfree(event);
 }
@@ -316,7 +318,9 @@ static int event_execute_rules_on_remove(UdevEvent *event, UdevRules *rules) {
                         log_device_debug_errno(dev, r, "Failed to delete database under /run/udev/data/, ignoring: %m");
         }
 
+        usec_t start_usec = now(CLOCK_MONOTONIC);
         r = udev_rules_apply_to_event(rules, event);
+        event->timing.rules_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
 
         if (EVENT_MODE_DESTRUCTIVE(event)) {
                 if (sd_device_get_devnum(dev, NULL) >= 0)
@@ -405,7 +409,9 @@ int udev_event_execute_rules(UdevEvent *event, UdevRules *rules) {
 
         DEVICE_TRACE_POINT(rules_start, dev);
 
+        usec_t start_usec = now(CLOCK_MONOTONIC);
         r = udev_rules_apply_to_event(rules, event);
+        event->timing.rules_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
         if (r < 0)
                 return log_device_debug_errno(dev, r, "Failed to apply udev rules: %m");
 
@@ -454,3 +460,30 @@ int udev_event_execute_rules(UdevEvent *event, UdevRules *rules) {
 
         return 0;
 }
+
+void udev_event_log_timing(UdevEvent *event) {
+        _cleanup_free_ char *builtins = NULL;
+
+        assert(event);
+
+        if (!DEBUG_LOGGING)
+                return;
+
+        for (UdevBuiltinCommand i = 0; i < _UDEV_BUILTIN_MAX; i++) {
+                if (event->timing.n_builtin_runs[i] == 0)
+                        continue;
+
+                if (strextendf_with_separator(&builtins, ", ", "%s %s",
+                                              udev_builtin_name(i),
+                                              FORMAT_TIMESPAN(event->timing.builtin_usec[i], USEC_PER_MSEC)) < 0)
+                        return (void) log_oom_debug();
+        }
+
+        log_device_debug(event->dev,
+                         "Processed in %s: rules %s, %u program(s) %s%s%s.",
+                         FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), event->birth_usec), USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(event->timing.rules_usec, USEC_PER_MSEC),
+                         event->timing.n_program_runs,
+                         FORMAT_TIMESPAN(event->timing.program_usec, USEC_PER_MSEC),
+                         builtins ? ", builtins: " : "", strempty(builtins));
+}
@@ -20,6 +20,16 @@
 typedef struct UdevRules UdevRules;
 typedef struct UdevWorker UdevWorker;
 
+typedef struct UdevEventTiming {
+        usec_t rules_usec;                         /* applying the rules, including builtins and programs run from there */
+        usec_t builtin_usec[_UDEV_BUILTIN_MAX];    /* per builtin, both IMPORT{builtin}= and RUN{builtin}= */
+        unsigned n_builtin_runs[_UDEV_BUILTIN_MAX];
+        usec_t program_usec;                       /* PROGRAM=, IMPORT{program}= and RUN{program}= */
+        unsigned n_program_runs;
+        bool profile_lines;
+        Hashmap *lines;                            /* UdevRuleLine* → UdevRuleLineTiming*, if profile_lines is set */
+} UdevEventTiming;
+
 typedef struct UdevEvent {
         unsigned n_ref;
 
@@ -51,6 +61,7 @@ typedef struct UdevEvent {
         bool log_level_was_debug;
         int default_log_level;
         EventMode event_mode;
+        UdevEventTiming timing;
 } UdevEvent;
 
 UdevEvent* udev_event_new(sd_device *dev, UdevWorker *worker, EventMode mode);
@@ -59,6 +70,7 @@ UdevEvent* udev_event_unref(UdevEvent *event);
 DEFINE_TRIVIAL_CLEANUP_FUNC(UdevEvent*, udev_event_unref);
 
 int udev_event_execute_rules(UdevEvent *event, UdevRules *rules);
+void udev_event_log_timing(UdevEvent *event);
 
 static inline bool EVENT_MODE_DESTRUCTIVE(UdevEvent *event) {
         assert(event);
@@ -16,11 +16,13 @@
 #include "iovec-util.h"
 #include "list.h"
 #include "mkdir.h"
+#include "ordered-set.h"
 #include "process-util.h"
 #include "selinux-util.h"
 #include "signal-util.h"
 #include "socket-util.h"
 #include "string-util.h"
+#include "strv.h"
 #include "syslog-util.h"
 #include "udev-builtin.h"
 #include "udev-config.h"
@@ -38,6 +40,9 @@
 #define EVENT_RETRY_INTERVAL_USEC (200 * USEC_PER_MSEC)
 #define EVENT_RETRY_TIMEOUT_USEC  (3 * USEC_PER_MINUTE)
 
+/* How many uevents to read from the monitor socket in one go */
+#define UEVENT_BATCH_MAX          64U
+
 typedef enum EventState {
         EVENT_UNDEF,
         EVENT_QUEUED,
@@ -58,6 +63,8 @@ typedef struct Event {
         const char *devpath;
         const char *devpath_old;
         const char *devnode;
+        char **index_keys; /* the keys under which this event is found in manager->events_by_key */
+        usec_t queued_usec;
 
         /* Used when the device is locked by another program. */
         usec_t retry_again_next_usec;
@@ -87,6 +94,31 @@ typedef struct Worker {
         Event *event;
 } Worker;
 
+static void event_index_remove(Event *event) {
+        assert(event);
+        assert(event->manager);
+
+        STRV_FOREACH(key, event->index_keys) {
+                _cleanup_free_ char *k = NULL;
+                OrderedSet *s;
+
+                s = hashmap_get2(event->manager->events_by_key, *key, (void**) &k);
+                if (!s)
+                        continue;
+
+                (void) ordered_set_remove(s, event);
+                if (!ordered_set_isempty(s)) {
+                        TAKE_PTR(k);
+                        continue;
+                }
+
+                assert_se(hashmap_remove(event->manager->events_by_key, *key) == s);
+                ordered_set_free(s);
+        }
+
+        event->index_keys = strv_free(event->index_keys);
+}
+
 static Event *event_free(Event *event) {
         if (!event)
                 return NULL;
@@ -94,6 +126,7 @@ static Event *event_free(Event *event) {
         assert(event->manager);
 
         LIST_REMOVE(event, event->manager->events, event);
+        event_index_remove(event);
         sd_device_unref(event->dev);
 
         sd_event_source_unref(event->retry_event_source);
@@ -142,6 +175,8 @@ Manager* manager_free(Manager *manager) {
 
         hashmap_free(manager->workers);
         event_queue_cleanup(manager, EVENT_UNDEF);
+        assert(hashmap_isempty(manager->events_by_key));
+        hashmap_free(manager->events_by_key);
 
         safe_close(manager->inotify_fd);
         safe_close_pair(manager->worker_watch);
@@ -365,6 +400,10 @@ static void worker_attach_event(Worker *worker, Event *event) {
         event->state = EVENT_RUNNING;
         event->worker = worker;
 
+        log_device_debug(event->dev, "SEQNUM=%"PRIu64" was queued for %s.",
+                         event->seqnum,
+                         FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), event->queued_usec), USEC_PER_MSEC));
+
         (void) sd_event_add_time_relative(e, &event->timeout_warning_event, CLOCK_MONOTONIC,
                                           udev_warn_timeout(manager->config.timeout_usec), USEC_PER_SEC,
                                           on_event_timeout_warning, event);
@@ -396,6 +435,13 @@ static int worker_spawn(Manager *manager, Event *event) {
         if (r < 0)
                 return log_error_errno(r, "Worker: Failed to set unicast sender: %m");
 
+        /* Let the worker inherit the rules index for the event it starts with */
+        if (manager->rules) {
+                r = udev_rules_prepare_for_device(manager->rules, event->dev);
+                if (r < 0)
+                        log_device_debug_errno(event->dev, r, "Failed to index rules for the event, ignoring: %m");
+        }
+
         r = safe_fork("(udev-worker)", FORK_DEATHSIG_SIGTERM, &pid);
         if (r < 0) {
                 event->state = EVENT_QUEUED;
@@ -491,15 +537,194 @@ bool devpath_conflict(const char *a, const char *b) {
         return *a == '/' || *b == '/' || *a == *b;
 }
 
+/* Queued events are indexed under the following keys, so that we can find the events that block another
+ * one without going through the whole queue:
+ *
+ *     "D:<path>"    events whose devpath is <path>
+ *     "d:<path>"    events whose devpath is below <path>
+ *     "O:<path>"    events whose DEVPATH_OLD is <path>
+ *     "o:<path>"    events whose DEVPATH_OLD is below <path>
+ *     "I:<id>"      events for the device ID <id>
+ *     "N:<node>"    events for the device node <node>
+ *
+ * Each key maps to an OrderedSet of the events in the order they were queued, i.e. by seqnum, hence the
+ * first entry is always the earliest event. */
+
+static int event_index_add(Event *event, const char *key) {
+        _cleanup_free_ char *k = NULL;
+        OrderedSet *s;
+        int r;
+
+        assert(event);
+        assert(event->manager);
+        assert(key);
+
+        s = hashmap_get(event->manager->events_by_key, key);
+        if (!s) {
+                k = strdup(key);
+                if (!k)
+                        return -ENOMEM;
+
+                s = ordered_set_new(NULL);
+                if (!s)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(&event->manager->events_by_key, &string_hash_ops_free, k, s);
+                if (r < 0) {
+                        ordered_set_free(s);
+                        return r;
+                }
+
+                TAKE_PTR(k);
+        }
+
+        r = ordered_set_put(s, event);
+        if (r == 0)
+                return 0; /* Already indexed under this key */
+        if (r > 0) {
+                r = strv_extend(&event->index_keys, key);
+                if (r >= 0)
+                        return 0;
+
+                /* event_index_remove() only finds the event via index_keys, hence don't leave it behind */
+                assert_se(ordered_set_remove(s, event) == event);
+        }
+
+        /* Don't leave an empty set behind either, if we just created it */
+        if (ordered_set_isempty(s)) {
+                _cleanup_free_ char *old = NULL;
+
+                assert_se(hashmap_remove2(event->manager->events_by_key, key, (void**) &old) == s);
+                ordered_set_free(s);
+        }
+
+        return r;
+}
+
+static int event_index_add_path(Event *event, char exact, char below, const char *path) {
+        _cleanup_free_ char *key = NULL;
+        int r;
+
+        assert(event);
+
+        if (!path)
+                return 0;
+
+        key = strjoin("?:", path);
+        if (!key)
+                return -ENOMEM;
+
+        key[0] = exact;
+        r = event_index_add(event, key);
+        if (r < 0)
+                return r;
+
+        /* Register the event as being below each of its parent paths */
+        key[0] = below;
+        for (char *p = key + 3; *p; p++) {
+                if (*p != '/')
+                        continue;
+
+                *p = 0;
+                r = event_index_add(event, key);
+                *p = '/';
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int event_index_add_all(Event *event) {
+        int r;
+
+        assert(event);
+
+        r = event_index_add_path(event, 'D', 'd', event->devpath);
+        if (r < 0)
+                return r;
+
+        r = event_index_add_path(event, 'O', 'o', event->devpath_old);
+        if (r < 0)
+                return r;
+
+        if (event->id) {
+                r = event_index_add(event, strjoina("I:", event->id));
+                if (r < 0)
+                        return r;
+        }
+
+        if (event->devnode) {
+                r = event_index_add(event, strjoina("N:", event->devnode));
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static Event* event_index_find_earlier(Event *event, const char *key, Event *found) {
+        Event *e;
+
+        assert(event);
+        assert(event->manager);
+        assert(key);
+
+        /* Returns the earliest event under the key, if it was queued before the specified event and before
+         * the one found so far. */
+
+        e = ordered_set_first(hashmap_get(event->manager->events_by_key, key));
+        if (!e || e->seqnum >= event->seqnum)
+                return found;
+
+        if (found && found->seqnum <= e->seqnum)
+                return found;
+
+        return e;
+}
+
+static int event_index_find_earlier_path(Event *event, char exact, char below, const char *path, Event **found) {
+        _cleanup_free_ char *key = NULL;
+
+        assert(event);
+        assert(found);
+
+        if (!path)
+                return 0;
+
+        /* Finds earlier events for the same path, for paths below it, and for each of its parents, i.e. all
+         * events for which devpath_conflict() is true. */
+
+        key = strjoin("?:", path);
+        if (!key)
+                return -ENOMEM;
+
+        key[0] = below;
+        *found = event_index_find_earlier(event, key, *found);
+
+        key[0] = exact;
+        *found = event_index_find_earlier(event, key, *found);
+
+        for (char *p = key + 3; *p; p++) {
+                if (*p != '/')
+                        continue;
+
+                *p = 0;
+                *found = event_index_find_earlier(event, key, *found);
+                *p = '/';
+        }
+
+        return 0;
+}
+
 static int event_is_blocked(Event *event) {
-        Event *loop_event = NULL;
+        Event *blocker = NULL;
         int r;
 
         /* lookup event for identical, parent, child device */
 
         assert(event);
         assert(event->manager);
-        assert(event->blocker_seqnum <= event->seqnum);
 
         if (event->retry_again_next_usec > 0) {
                 usec_t now_usec;
@@ -516,60 +741,38 @@ static int event_is_blocked(Event *event) {
                 /* we have checked previously and no blocker found */
                 return false;
 
-        LIST_FOREACH(event, e, event->manager->events) {
-                loop_event = e;
+        if (event->id)
+                blocker = event_index_find_earlier(event, strjoina("I:", event->id), blocker);
 
-                /* we already found a later event, earlier cannot block us, no need to check again */
-                if (loop_event->seqnum < event->blocker_seqnum)
-                        continue;
-
-                /* event we checked earlier still exists, no need to check again */
-                if (loop_event->seqnum == event->blocker_seqnum)
-                        return true;
-
-                /* found ourself, no later event can block us */
-                if (loop_event->seqnum >= event->seqnum)
-                        goto no_blocker;
-
-                /* found event we have not checked */
-                break;
-        }
-
-        assert(loop_event);
-        assert(loop_event->seqnum > event->blocker_seqnum &&
-               loop_event->seqnum < event->seqnum);
-
-        /* check if queue contains events we depend on */
-        LIST_FOREACH(event, e, loop_event) {
-                loop_event = e;
+        r = event_index_find_earlier_path(event, 'D', 'd', event->devpath, &blocker);
+        if (r < 0)
+                return r;
 
-                /* found ourself, no later event can block us */
-                if (loop_event->seqnum >= event->seqnum)
-                        goto no_blocker;
+        r = event_index_find_earlier_path(event, 'O', 'o', event->devpath, &blocker);
+        if (r < 0)
+                return r;
 
-                if (streq_ptr(loop_event->id, event->id))
-                        break;
+        r = event_index_find_earlier_path(event, 'D', 'd', event->devpath_old, &blocker);
+        if (r < 0)
+                return r;
 
-                if (devpath_conflict(event->devpath, loop_event->devpath) ||
-                    devpath_conflict(event->devpath, loop_event->devpath_old) ||
-                    devpath_conflict(event->devpath_old, loop_event->devpath))
-                        break;
+        if (event->devnode)
+                blocker = event_index_find_earlier(event, strjoina("N:", event->devnode), blocker);
 
-                if (event->devnode && streq_ptr(event->devnode, loop_event->devnode))
-                        break;
+        if (!blocker) {
+                /* No earlier event can block us, and later ones never do, hence don't check again */
+                event->blocker_seqnum = event->seqnum;
+                return false;
         }
 
-        assert(loop_event);
+        assert(blocker->seqnum < event->seqnum);
 
-        log_device_debug(event->dev, "SEQNUM=%" PRIu64 " blocked by SEQNUM=%" PRIu64,
-                         event->seqnum, loop_event->seqnum);
+        if (blocker->seqnum != event->blocker_seqnum)
+                log_device_debug(event->dev, "SEQNUM=%" PRIu64 " blocked by SEQNUM=%" PRIu64,
+                                 event->seqnum, blocker->seqnum);
 
-        event->blocker_seqnum = loop_event->seqnum;
+        event->blocker_seqnum = blocker->seqnum;
         return true;
-
-no_blocker:
-        event->blocker_seqnum = event->seqnum;
-        return false;
 }
 
 static int event_queue_start(Manager *manager) {
@@ -694,6 +897,61 @@ static int event_queue_assume_block_device_unlocked(Manager *manager, sd_device
         return 0;
 }
 
+static bool device_properties_equal_except_seqnum(sd_device *a, sd_device *b) {
+        size_t n_a = 0, n_b = 0;
+
+        assert(a);
+        assert(b);
+
+        FOREACH_DEVICE_PROPERTY(a, key, value) {
+                const char *v;
+
+                if (streq(key, "SEQNUM"))
+                        continue;
+
+                if (sd_device_get_property_value(b, key, &v) < 0 || !streq(value, v))
+                        return false;
+
+                n_a++;
+        }
+
+        FOREACH_DEVICE_PROPERTY(b, key, value)
+                if (!streq(key, "SEQNUM"))
+                        n_b++;
+
+        return n_a == n_b;
+}
+
+static void event_queue_drop_superseded(Manager *manager, sd_device *dev, const char *devpath) {
+        Event *e, *last = NULL;
+
+        assert(manager);
+        assert(dev);
+        assert(devpath);
+
+        /* A "change" event that has not been started yet, and whose properties are identical to those of a
+         * newer "change" event for the same device, carries nothing the newer one does not. Hence when they
+         * pile up, only the newest one needs to be processed. Events with per-event properties, like
+         * DISK_MEDIA_CHANGE=1 or RESIZE=1, thus are kept. Events triggered with a UUID are kept too, as
+         * somebody may wait for them, and so are device-mapper events with a cookie: libdevmapper waits
+         * for each cookie to be completed by the rules processing that very event. */
+
+        ORDERED_SET_FOREACH(e, hashmap_get(manager->events_by_key, strjoina("D:", devpath)))
+                last = e;
+
+        if (!last ||
+            last->state != EVENT_QUEUED ||
+            last->action != SD_DEVICE_CHANGE ||
+            last->devpath_old ||
+            sd_device_get_trigger_uuid(last->dev, NULL) != -ENOENT ||
+            sd_device_get_property_value(last->dev, "DM_COOKIE", NULL) >= 0 ||
+            !device_properties_equal_except_seqnum(last->dev, dev))
+                return;
+
+        log_device_debug(dev, "Dropping queued SEQNUM=%"PRIu64", superseded by this event.", last->seqnum);
+        event_free(last);
+}
+
 static int event_queue_insert(Manager *manager, sd_device *dev) {
         const char *devpath, *devpath_old = NULL, *id = NULL, *devnode = NULL;
         sd_device_action_t action;
@@ -729,6 +987,9 @@ static int event_queue_insert(Manager *manager, sd_device *dev) {
         if (r < 0 && r != -ENOENT)
                 return r;
 
+        if (manager->config.coalesce_change_events && action == SD_DEVICE_CHANGE && !devpath_old)
+                event_queue_drop_superseded(manager, dev, devpath);
+
         event = new(Event, 1);
         if (!event)
                 return -ENOMEM;
@@ -743,6 +1004,7 @@ static int event_queue_insert(Manager *manager, sd_device *dev) {
                 .devpath_old = devpath_old,
                 .devnode = devnode,
                 .state = EVENT_QUEUED,
+                .queued_usec = now(CLOCK_MONOTONIC),
         };
 
         if (!manager->events) {
@@ -753,15 +1015,23 @@ static int event_queue_insert(Manager *manager, sd_device *dev) {
 
         LIST_APPEND(event, manager->events, event);
 
+        r = event_index_add_all(event);
+        if (r < 0) {
+                event_free(event);
+                return r;
+        }
+
         log_device_uevent(dev, "Device is queued");
 
         return 0;
 }
 
-static int on_uevent(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
-        Manager *manager = ASSERT_PTR(userdata);
+static void manager_queue_uevent(Manager *manager, sd_device *dev) {
         int r;
 
+        assert(manager);
+        assert(dev);
+
         DEVICE_TRACE_POINT(kernel_uevent_received, dev);
 
         device_ensure_usec_initialized(dev, NULL);
@@ -769,10 +1039,36 @@ static int on_uevent(sd_device_monitor *monitor, sd_device *dev, void *userdata)
         r = event_queue_insert(manager, dev);
         if (r < 0) {
                 log_device_error_errno(dev, r, "Failed to insert device into event queue: %m");
-                return 1;
+                return;
         }
 
         (void) event_queue_assume_block_device_unlocked(manager, dev);
+}
+
+static int on_uevent(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
+        Manager *manager = ASSERT_PTR(userdata);
+
+        manager_queue_uevent(manager, dev);
+
+        /* The monitor hands us one uevent per wakeup, and on_post() would try to start events after each of
+         * them. During storms, drain what is already in the socket first, so that the queue sees the whole
+         * batch, and events can be coalesced and scheduled together. */
+        for (unsigned i = 1; i < UEVENT_BATCH_MAX; i++) {
+                _cleanup_(sd_device_unrefp) sd_device *d = NULL;
+                _unused_ _cleanup_(log_context_unrefp) LogContext *c = NULL;
+                int r;
+
+                r = sd_device_monitor_receive(monitor, &d);
+                if (r == -EAGAIN)
+                        break;
+                if (r <= 0)
+                        continue; /* filtered out or broken message, try the next one */
+
+                if (log_context_enabled())
+                        c = log_context_new_strv_consume(device_make_log_fields(d));
+
+                manager_queue_uevent(manager, d);
+        }
 
         return 1;
 }
@@ -21,6 +21,7 @@ typedef struct Manager {
         sd_event *event;
         Hashmap *workers;
         LIST_HEAD(Event, events);
+        Hashmap *events_by_key; /* see event_index_add() */
         char *cgroup;
 
         UdevRules *rules;
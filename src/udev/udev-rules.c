@@ -4,6 +4,7 @@
 
 #include "alloc-util.h"
 #include "architecture.h"
+#include "arena.h"
 #include "conf-files.h"
 #include "conf-parser.h"
 #include "confidential-virt.h"
@@ -25,6 +26,7 @@
 #include "path-util.h"
 #include "proc-cmdline.h"
 #include "socket-util.h"
+#include "sort-util.h"
 #include "stat-util.h"
 #include "string-table.h"
 #include "strv.h"
@@ -173,6 +175,7 @@ struct UdevRuleToken {
 struct UdevRuleLine {
         char *line;
         unsigned line_number;
+        unsigned index; /* position among all lines of all files, assigned when the rules are indexed */
         UdevRuleLineType type;
 
         const char *label;
@@ -193,12 +196,30 @@ struct UdevRuleFile {
         LIST_FIELDS(UdevRuleFile, rule_files);
 };
 
+/* The lines that may match events with a specific action and subsystem, in rules order */
+typedef struct UdevRuleLineIndex {
+        UdevRuleLine **lines;
+        size_t n_lines;
+} UdevRuleLineIndex;
+
+typedef struct UdevRuleLineTiming {
+        UdevRuleLine *line;
+        usec_t usec;
+        unsigned n_evaluations;
+} UdevRuleLineTiming;
+
 struct UdevRules {
         ResolveNameTiming resolve_name_timing;
         Hashmap *known_users;
         Hashmap *known_groups;
         Hashmap *stats_by_path;
         LIST_HEAD(UdevRuleFile, rule_files);
+
+        Arena arena; /* rule lines and tokens */
+
+        unsigned n_lines;
+        bool lines_numbered;
+        Hashmap *line_index_by_key; /* "action:subsystem" → UdevRuleLineIndex, built on first use */
 };
 
 #define LINE_GET_RULES(line)                                            \
@@ -346,6 +367,9 @@ static void log_event_truncated(
 
 /*** Other functions ***/
 
+/* Tokens and lines are allocated from the arena of the rules, hence the functions below only unlink
+ * them, and the memory is released with the rules. */
+
 static UdevRuleToken *udev_rule_token_free(UdevRuleToken *token) {
         if (!token)
                 return NULL;
@@ -353,10 +377,84 @@ static UdevRuleToken *udev_rule_token_free(UdevRuleToken *token) {
         if (token->rule_line)
                 LIST_REMOVE(tokens, token->rule_line->tokens, token);
 
-        return mfree(token);
+        return NULL;
 }
 
-DEFINE_TRIVIAL_CLEANUP_FUNC(UdevRuleToken*, udev_rule_token_free);
+static UdevRuleLineIndex* udev_rule_line_index_free(UdevRuleLineIndex *index) {
+        if (!index)
+                return NULL;
+
+        free(index->lines);
+        return mfree(index);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(UdevRuleLineIndex*, udev_rule_line_index_free);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(
+                udev_rule_line_index_hash_ops,
+                char, string_hash_func, string_compare_func, free,
+                UdevRuleLineIndex, udev_rule_line_index_free);
+
+static size_t udev_rule_line_index_find(UdevRuleLineIndex *index, size_t start, UdevRuleLine *line) {
+        size_t left, right;
+
+        assert(index);
+        assert(line);
+
+        /* Returns the position of the first line at or after the specified line in rules order, searching
+         * from 'start' on. */
+
+        left = start;
+        right = index->n_lines;
+        while (left < right) {
+                size_t middle = left + (right - left) / 2;
+
+                if (index->lines[middle]->index < line->index)
+                        left = middle + 1;
+                else
+                        right = middle;
+        }
+
+        return left;
+}
+
+static void udev_rules_unindex_line(UdevRules *rules, UdevRuleLine *line) {
+        UdevRuleLineIndex *index;
+        const char *key;
+
+        assert(line);
+
+        /* Drops a line that is going away from all indexes that contain it, and the indexes that end up
+         * empty with it. Lines keep their relative order, hence the remaining indexes stay sorted. */
+
+        if (!rules)
+                return;
+
+        HASHMAP_FOREACH_KEY(index, key, rules->line_index_by_key) {
+                size_t i;
+
+                i = udev_rule_line_index_find(index, 0, line);
+                if (i >= index->n_lines || index->lines[i] != line)
+                        continue;
+
+                memmove(index->lines + i, index->lines + i + 1, (index->n_lines - i - 1) * sizeof(UdevRuleLine*));
+                index->n_lines--;
+
+                if (index->n_lines == 0) {
+                        _cleanup_free_ char *k = NULL;
+
+                        udev_rule_line_index_free(hashmap_remove2(rules->line_index_by_key, key, (void**) &k));
+                }
+        }
+}
+
+static void udev_rules_flush_line_index(UdevRules *rules) {
+        assert(rules);
+
+        /* Called when lines are added, which the indexes built so far don't know about */
+        rules->line_index_by_key = hashmap_free(rules->line_index_by_key);
+        rules->lines_numbered = false;
+}
 
 static void udev_rule_line_clear_tokens(UdevRuleLine *rule_line) {
         assert(rule_line);
@@ -371,11 +469,12 @@ static UdevRuleLine *udev_rule_line_free(UdevRuleLine *rule_line) {
 
         udev_rule_line_clear_tokens(rule_line);
 
-        if (rule_line->rule_file)
+        if (rule_line->rule_file) {
+                udev_rules_unindex_line(rule_line->rule_file->rules, rule_line);
                 LIST_REMOVE(rule_lines, rule_line->rule_file->rule_lines, rule_line);
+        }
 
-        free(rule_line->line);
-        return mfree(rule_line);
+        return NULL;
 }
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(UdevRuleLine*, udev_rule_line_free);
@@ -396,16 +495,25 @@ static UdevRuleFile *udev_rule_file_free(UdevRuleFile *rule_file) {
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(UdevRuleFile*, udev_rule_file_free);
 
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                udev_rule_line_timing_hash_ops,
+                void, trivial_hash_func, trivial_compare_func,
+                UdevRuleLineTiming, free);
+
 UdevRules* udev_rules_free(UdevRules *rules) {
         if (!rules)
                 return NULL;
 
+        /* Drop the indexes first, so that they are not pruned line by line below */
+        rules->line_index_by_key = hashmap_free(rules->line_index_by_key);
+
         LIST_FOREACH(rule_files, i, rules->rule_files)
                 udev_rule_file_free(i);
 
         hashmap_free_free_key(rules->known_users);
         hashmap_free_free_key(rules->known_groups);
         hashmap_free(rules->stats_by_path);
+        arena_done(&rules->arena);
         return mfree(rules);
 }
 
@@ -496,7 +604,6 @@ static bool type_has_nulstr_value(UdevRuleTokenType type) {
 }
 
 static int rule_line_add_token(UdevRuleLine *rule_line, UdevRuleTokenType type, UdevRuleOperatorType op, char *value, void *data, bool is_case_insensitive) {
-        _cleanup_(udev_rule_token_freep) UdevRuleToken *token = NULL;
         UdevRuleMatchType match_type = _MATCH_TYPE_INVALID;
         UdevRuleSubstituteType subst_type = _SUBST_TYPE_INVALID;
 
@@ -572,7 +679,7 @@ static int rule_line_add_token(UdevRuleLine *rule_line, UdevRuleTokenType type,
 
         SET_FLAG(match_type, MATCH_CASE_INSENSITIVE, is_case_insensitive);
 
-        token = new(UdevRuleToken, 1);
+        UdevRuleToken *token = arena_new(&LINE_GET_RULES(rule_line)->arena, UdevRuleToken, 1);
         if (!token)
                 return -ENOMEM;
 
@@ -605,7 +712,6 @@ static int rule_line_add_token(UdevRuleLine *rule_line, UdevRuleTokenType type,
                         TK_M_IMPORT_DB, TK_M_IMPORT_CMDLINE, TK_M_IMPORT_PARENT))
                 SET_FLAG(rule_line->type, LINE_UPDATE_SOMETHING, true);
 
-        TAKE_PTR(token);
         return 0;
 }
 
@@ -1300,26 +1406,29 @@ static void sort_tokens(UdevRuleLine *rule_line) {
 
 static int rule_add_line(UdevRuleFile *rule_file, const char *line_str, unsigned line_nr, bool extra_checks) {
         _cleanup_(udev_rule_line_freep) UdevRuleLine *rule_line = NULL;
-        _cleanup_free_ char *line = NULL;
-        char *p;
+        Arena *arena;
+        char *line, *p;
         int r;
 
         assert(rule_file);
+        assert(rule_file->rules);
         assert(line_str);
 
         if (isempty(line_str))
                 return 0;
 
-        line = strdup(line_str);
+        arena = &rule_file->rules->arena;
+
+        line = arena_strdup(arena, line_str);
         if (!line)
                 return log_oom();
 
-        rule_line = new(UdevRuleLine, 1);
+        rule_line = arena_new(arena, UdevRuleLine, 1);
         if (!rule_line)
                 return log_oom();
 
         *rule_line = (UdevRuleLine) {
-                .line = TAKE_PTR(line),
+                .line = line,
                 .line_number = line_nr,
                 .rule_file = rule_file,
         };
@@ -1593,6 +1702,7 @@ int udev_rules_parse_file(UdevRules *rules, const char *filename, bool extra_che
         };
 
         LIST_APPEND(rule_files, rules->rule_files, rule_file);
+        udev_rules_flush_line_index(rules);
 
         for (;;) {
                 _cleanup_free_ char *buf = NULL;
@@ -2872,29 +2982,16 @@ static int udev_rule_apply_parent_token_to_event(UdevRuleToken *head_token, Udev
 static int udev_rule_apply_line_to_event(
                 UdevRuleLine *line,
                 UdevEvent *event,
+                UdevRuleLineType mask,
                 UdevRuleLine **next_line) {
 
-        UdevRuleLineType mask = LINE_HAS_GOTO | LINE_UPDATE_SOMETHING;
         bool parents_done = false;
-        sd_device_action_t action;
         int r;
 
         assert(line);
         assert(event);
         assert(next_line);
 
-        r = sd_device_get_action(event->dev, &action);
-        if (r < 0)
-                return r;
-
-        if (action != SD_DEVICE_REMOVE) {
-                if (sd_device_get_devnum(event->dev, NULL) >= 0)
-                        mask |= LINE_HAS_DEVLINK;
-
-                if (sd_device_get_ifindex(event->dev, NULL) >= 0)
-                        mask |= LINE_HAS_NAME;
-        }
-
         if ((line->type & mask) == 0)
                 return 0;
 
@@ -2926,18 +3023,248 @@ static int udev_rule_apply_line_to_event(
         return 0;
 }
 
+static int udev_rule_apply_line_to_event_profiled(
+                UdevRuleLine *line,
+                UdevEvent *event,
+                UdevRuleLineType mask,
+                UdevRuleLine **next_line) {
+
+        UdevRuleLineTiming *t;
+        usec_t start_usec;
+        int r;
+
+        assert(line);
+        assert(event);
+
+        if (!event->timing.profile_lines || (line->type & mask) == 0)
+                return udev_rule_apply_line_to_event(line, event, mask, next_line);
+
+        start_usec = now(CLOCK_MONOTONIC);
+        r = udev_rule_apply_line_to_event(line, event, mask, next_line);
+
+        t = hashmap_get(event->timing.lines, line);
+        if (!t) {
+                t = new0(UdevRuleLineTiming, 1);
+                if (!t)
+                        return r;
+
+                t->line = line;
+
+                if (hashmap_ensure_put(&event->timing.lines, &udev_rule_line_timing_hash_ops, line, t) < 0) {
+                        free(t);
+                        return r;
+                }
+        }
+
+        t->usec += usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
+        t->n_evaluations++;
+
+        return r;
+}
+
+static int udev_rule_line_timing_compare(UdevRuleLineTiming * const *a, UdevRuleLineTiming * const *b) {
+        int r;
+
+        r = CMP((*b)->usec, (*a)->usec);
+        if (r != 0)
+                return r;
+
+        return CMP((*a)->line->index, (*b)->line->index);
+}
+
+void udev_rules_print_line_timing(UdevEvent *event, size_t n_max) {
+        _cleanup_free_ UdevRuleLineTiming **timings = NULL;
+        UdevRuleLineTiming *t;
+        size_t n = 0;
+
+        assert(event);
+
+        timings = new(UdevRuleLineTiming*, hashmap_size(event->timing.lines));
+        if (!timings)
+                return (void) log_oom();
+
+        HASHMAP_FOREACH(t, event->timing.lines)
+                timings[n++] = t;
+
+        typesafe_qsort(timings, n, udev_rule_line_timing_compare);
+
+        FOREACH_ARRAY(i, timings, MIN(n, n_max))
+                printf("  %10s %6u  %s:%u\n",
+                       FORMAT_TIMESPAN((*i)->usec, 1),
+                       (*i)->n_evaluations,
+                       (*i)->line->rule_file->filename,
+                       (*i)->line->line_number);
+}
+
+static bool token_may_match_plain(UdevRuleToken *token, const char *str) {
+        assert(token);
+
+        /* Returns false only if the token is a plain "==" match which does not match the string. Such
+         * matches have no side effects, hence a line with such a token can be skipped without evaluating
+         * it. */
+
+        if (token->op != OP_MATCH || token->match_type != MATCH_TYPE_PLAIN)
+                return true;
+
+        return nulstr_contains(token->value, strempty(str));
+}
+
+static bool udev_rule_line_may_match(UdevRuleLine *line, const char *action, const char *subsystem) {
+        assert(line);
+
+        /* Tokens are sorted by type, and all match tokens up to TK_M_SUBSYSTEM are free of side effects,
+         * hence we only have to look at the first few tokens. */
+        LIST_FOREACH(tokens, token, line->tokens) {
+                if (token->type > TK_M_SUBSYSTEM)
+                        break;
+
+                if (token->type == TK_M_ACTION && !token_may_match_plain(token, action))
+                        return false;
+                if (token->type == TK_M_SUBSYSTEM && !token_may_match_plain(token, subsystem))
+                        return false;
+        }
+
+        return true;
+}
+
+static void udev_rules_number_lines(UdevRules *rules) {
+        assert(rules);
+
+        if (rules->lines_numbered)
+                return;
+
+        rules->n_lines = 0;
+        LIST_FOREACH(rule_files, file, rules->rule_files)
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        line->index = rules->n_lines++;
+
+        rules->lines_numbered = true;
+}
+
+static int udev_rules_get_line_index(UdevRules *rules, const char *action, const char *subsystem, UdevRuleLineIndex **ret) {
+        _cleanup_(udev_rule_line_index_freep) UdevRuleLineIndex *index = NULL;
+        _cleanup_free_ char *key = NULL;
+        int r;
+
+        assert(rules);
+        assert(ret);
+
+        /* Most rule lines start with ACTION== and SUBSYSTEM== checks, and those can never match events of
+         * other actions and subsystems. Hence, for each combination of them that we encounter, collect the
+         * lines that may match once, and then only go through those for every event. */
+
+        key = strjoin(strempty(action), ":", strempty(subsystem));
+        if (!key)
+                return -ENOMEM;
+
+        index = hashmap_get(rules->line_index_by_key, key);
+        if (index) {
+                *ret = TAKE_PTR(index);
+                return 0;
+        }
+
+        udev_rules_number_lines(rules);
+
+        index = new0(UdevRuleLineIndex, 1);
+        if (!index)
+                return -ENOMEM;
+
+        index->lines = new(UdevRuleLine*, MAX(rules->n_lines, 1U));
+        if (!index->lines)
+                return -ENOMEM;
+
+        LIST_FOREACH(rule_files, file, rules->rule_files)
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        if (udev_rule_line_may_match(line, action, subsystem))
+                                index->lines[index->n_lines++] = line;
+
+        r = hashmap_ensure_put(&rules->line_index_by_key, &udev_rule_line_index_hash_ops, key, index);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(key);
+        *ret = TAKE_PTR(index);
+        return 0;
+}
+
+static int udev_rules_get_line_index_for_device(UdevRules *rules, sd_device *dev, UdevRuleLineIndex **ret) {
+        const char *subsystem = NULL;
+        sd_device_action_t action;
+        int r;
+
+        assert(rules);
+        assert(dev);
+        assert(ret);
+
+        r = sd_device_get_action(dev, &action);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_subsystem(dev, &subsystem);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        return udev_rules_get_line_index(rules, device_action_to_string(action), subsystem, ret);
+}
+
+int udev_rules_prepare_for_device(UdevRules *rules, sd_device *dev) {
+        UdevRuleLineIndex *index;
+
+        assert(rules);
+        assert(dev);
+
+        /* Builds the index of lines for events like this one, if it doesn't exist yet. Called by the manager
+         * before forking off a worker, so that all workers share the index with it, rather than each of them
+         * building its own copy. */
+
+        return udev_rules_get_line_index_for_device(rules, dev, &index);
+}
+
 int udev_rules_apply_to_event(UdevRules *rules, UdevEvent *event) {
+        UdevRuleLineType mask = LINE_HAS_GOTO | LINE_UPDATE_SOMETHING;
+        UdevRuleLineIndex *index;
+        sd_device_action_t action;
         int r;
 
         assert(rules);
         assert(event);
 
-        LIST_FOREACH(rule_files, file, rules->rule_files)
-                LIST_FOREACH_WITH_NEXT(rule_lines, line, next_line, file->rule_lines) {
-                        r = udev_rule_apply_line_to_event(line, event, &next_line);
-                        if (r < 0)
-                                return r;
-                }
+        r = sd_device_get_action(event->dev, &action);
+        if (r < 0)
+                return r;
+
+        if (action != SD_DEVICE_REMOVE) {
+                if (sd_device_get_devnum(event->dev, NULL) >= 0)
+                        mask |= LINE_HAS_DEVLINK;
+
+                if (sd_device_get_ifindex(event->dev, NULL) >= 0)
+                        mask |= LINE_HAS_NAME;
+        }
+
+        r = udev_rules_get_line_index_for_device(rules, event->dev, &index);
+        if (r < 0) {
+                log_device_debug_errno(event->dev, r, "Failed to index rules, checking all lines: %m");
+
+                LIST_FOREACH(rule_files, file, rules->rule_files)
+                        LIST_FOREACH_WITH_NEXT(rule_lines, line, next_line, file->rule_lines) {
+                                r = udev_rule_apply_line_to_event_profiled(line, event, mask, &next_line);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                return 0;
+        }
+
+        for (size_t i = 0; i < index->n_lines; ) {
+                UdevRuleLine *line = index->lines[i], *next_line = NULL;
+
+                r = udev_rule_apply_line_to_event_profiled(line, event, mask, &next_line);
+                if (r < 0)
+                        return r;
+
+                /* On GOTO continue with the label, or whatever comes next of the lines which may match */
+                i = next_line ? udev_rule_line_index_find(index, i + 1, next_line) : i + 1;
+        }
 
         return 0;
 }
@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later */
 #pragma once
 
+#include "sd-device.h"
+
 #include "alloc-util.h"
 #include "hashmap.h"
 #include "time-util.h"
@@ -20,7 +22,9 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(UdevRules*, udev_rules_free);
 #define udev_rules_free_and_replace(a, b) free_and_replace_full(a, b, udev_rules_free)
 
 bool udev_rules_should_reload(UdevRules *rules);
+int udev_rules_prepare_for_device(UdevRules *rules, sd_device *dev);
 int udev_rules_apply_to_event(UdevRules *rules, UdevEvent *event);
+void udev_rules_print_line_timing(UdevEvent *event, size_t n_max);
 int udev_rules_apply_static_dev_perms(UdevRules *rules);
 
 ResolveNameTiming resolve_name_timing_from_string(const char *s) _pure_;
@@ -320,10 +320,17 @@ int udev_event_spawn(
                 .result_size = result_size,
         };
         r = spawn_wait(&spawn);
+
+        usec_t runtime_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), now_usec);
+        event->timing.program_usec += runtime_usec;
+        event->timing.n_program_runs++;
+
         if (r < 0)
                 return log_device_error_errno(event->dev, r,
                                               "Failed to wait for spawned command '%s': %m", cmd);
 
+        log_device_debug(event->dev, "Command '%s' finished in %s.", cmd, FORMAT_TIMESPAN(runtime_usec, USEC_PER_MSEC));
+
         if (result)
                 result[spawn.result_len] = '\0';
 
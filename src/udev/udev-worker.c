@@ -233,6 +233,7 @@ static int worker_process_device(UdevWorker *worker, sd_device *dev) {
                         return log_device_warning_errno(dev, r, "Failed to update database under /run/udev/data/: %m");
         }
 
+        udev_event_log_timing(udev_event);
         log_device_uevent(dev, "Device processed");
         return 0;
 }
@@ -23,6 +23,7 @@
 #include "strv.h"
 #include "strxcpyx.h"
 #include "terminal-util.h"
+#include "time-util.h"
 #include "udev-builtin.h"
 #include "udev-event.h"
 #include "udev-format.h"
@@ -34,6 +35,7 @@
 static sd_device_action_t arg_action = SD_DEVICE_ADD;
 static ResolveNameTiming arg_resolve_name_timing = RESOLVE_NAME_EARLY;
 static const char *arg_syspath = NULL;
+static bool arg_timing = false;
 
 static int help(void) {
 
@@ -42,16 +44,23 @@ static int help(void) {
                "  -h --help                            Show this help\n"
                "  -V --version                         Show package version\n"
                "  -a --action=ACTION|help              Set action string\n"
-               "  -N --resolve-names=early|late|never  When to resolve names\n",
+               "  -N --resolve-names=early|late|never  When to resolve names\n"
+               "     --timing                          Show how long rules, builtins and\n"
+               "                                       programs took\n",
                program_invocation_short_name);
 
         return 0;
 }
 
 static int parse_argv(int argc, char *argv[]) {
+        enum {
+                ARG_TIMING = 0x100,
+        };
+
         static const struct option options[] = {
                 { "action",        required_argument, NULL, 'a' },
                 { "resolve-names", required_argument, NULL, 'N' },
+                { "timing",        no_argument,       NULL, ARG_TIMING },
                 { "version",       no_argument,       NULL, 'V' },
                 { "help",          no_argument,       NULL, 'h' },
                 {}
@@ -74,6 +83,9 @@ static int parse_argv(int argc, char *argv[]) {
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "--resolve-names= must be early, late or never");
                         break;
+                case ARG_TIMING:
+                        arg_timing = true;
+                        break;
                 case 'V':
                         return print_version();
                 case 'h':
@@ -130,6 +142,12 @@ int test_main(int argc, char *argv[], void *userdata) {
         device_seal(dev);
 
         event = udev_event_new(dev, NULL, EVENT_UDEVADM_TEST);
+        if (!event) {
+                r = log_oom();
+                goto out;
+        }
+
+        event->timing.profile_lines = arg_timing;
 
         assert_se(sigfillset(&mask) >= 0);
         assert_se(sigprocmask(SIG_SETMASK, &mask, &sigmask_orig) >= 0);
@@ -214,6 +232,26 @@ int test_main(int argc, char *argv[], void *userdata) {
                 }
         }
 
+        if (arg_timing) {
+                printf("%sTiming:%s\n", ansi_highlight(), ansi_normal());
+                printf("  rules : %s\n", FORMAT_TIMESPAN(event->timing.rules_usec, 1));
+
+                for (UdevBuiltinCommand i = 0; i < _UDEV_BUILTIN_MAX; i++)
+                        if (event->timing.n_builtin_runs[i] > 0)
+                                printf("  builtin %s : %s (%u run(s))\n",
+                                       udev_builtin_name(i),
+                                       FORMAT_TIMESPAN(event->timing.builtin_usec[i], 1),
+                                       event->timing.n_builtin_runs[i]);
+
+                if (event->timing.n_program_runs > 0)
+                        printf("  programs : %s (%u run(s))\n",
+                               FORMAT_TIMESPAN(event->timing.program_usec, 1),
+                               event->timing.n_program_runs);
+
+                printf("%sSlowest rule lines:%s\n", ansi_highlight(), ansi_normal());
+                udev_rules_print_line_timing(event, 20);
+        }
+
         r = 0;
 out:
         udev_builtin_exit();
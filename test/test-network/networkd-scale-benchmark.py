@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: LGPL-2.1-or-later
+# systemd-networkd scaling benchmark
+
+# This creates a large number of dummy or veth interfaces, each with its own .network file carrying a few
+# addresses and routes, and measures how systemd-networkd copes with them:
+#
+#  - the time until all links are configured, when networkd is started with the links already present,
+#    and when links are added while networkd is running (like containers being started),
+#  - the CPU time consumed and the memory used by networkd,
+#  - the number of netlink messages exchanged (all of them, as seen by an nlmon interface),
+#  - the cost of 'networkctl reload'.
+#
+# It reconfigures the networking of the system it runs on and restarts systemd-networkd, hence only run it
+# in a throwaway VM or container, e.g. in the systemd mkosi image booted in QEMU:
+#
+#    sudo ./networkd-scale-benchmark.py --links 5000 --addresses 2 --routes 4
+#
+# Use --json to get the results in a machine readable form, e.g. to compare them between builds.
+
+import argparse
+import ipaddress
+import json
+import os
+import pathlib
+import subprocess
+import sys
+import time
+
+network_unit_dir = pathlib.Path('/run/systemd/network')
+unit_prefix = '10-networkd-bench-'
+ifname_prefix = 'bench'
+nlmon_ifname = 'nlmon-bench'
+
+clock_ticks = os.sysconf('SC_CLK_TCK')
+
+def check_output(*command, **kwargs):
+    return subprocess.run(command, check=True, universal_newlines=True, stdout=subprocess.PIPE, **kwargs).stdout.rstrip()
+
+def call_quiet(*command):
+    return subprocess.run(command, check=False, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL).returncode
+
+def ip_batch(commands):
+    subprocess.run(['ip', '-force', '-batch', '-'], input='\n'.join(commands) + '\n', check=False,
+                   universal_newlines=True, stderr=subprocess.DEVNULL)
+
+def link_name(i):
+    return f'{ifname_prefix}{i}'
+
+def write_network_file(args, i):
+    # Every link gets a /30 from 10.0.0.0/9, a /64 from fd00::/16, and host routes from 10.128.0.0/9.
+    lines = [
+        '[Match]',
+        f'Name={link_name(i)}',
+        '',
+        '[Network]',
+        'IPv6AcceptRA=no',
+        'LinkLocalAddressing=no',
+    ]
+    for a in range(args.addresses):
+        if a % 2 == 0:
+            lines += [f'Address={ipaddress.IPv4Address(0x0a000000 + ((i * args.addresses + a) << 2) + 1)}/30']
+        else:
+            lines += [f'Address=fd00:{i >> 16:x}:{i & 0xffff:x}:{a:x}::1/64']
+    for r in range(args.routes):
+        lines += [
+            '',
+            '[Route]',
+            f'Destination={ipaddress.IPv4Address(0x0a800000 + i * args.routes + r)}/32',
+        ]
+    (network_unit_dir / f'{unit_prefix}{i:05}.network').write_text('\n'.join(lines) + '\n')
+
+def create_links(args, indices):
+    commands = []
+    for i in indices:
+        if args.kind == 'veth':
+            commands += [f'link add {link_name(i)} type veth peer name {link_name(i)}p']
+        else:
+            commands += [f'link add {link_name(i)} type dummy']
+    ip_batch(commands)
+
+def remove_links(args):
+    commands = [f'link del {link_name(i)}' for i in range(args.links + args.hotplug)]
+    ip_batch(commands)
+
+def remove_network_files():
+    for p in network_unit_dir.glob(f'{unit_prefix}*.network'):
+        p.unlink()
+
+def link_ifindex(i):
+    try:
+        return int(pathlib.Path(f'/sys/class/net/{link_name(i)}/ifindex').read_text())
+    except FileNotFoundError:
+        return None
+
+def link_admin_state(ifindex):
+    try:
+        for line in pathlib.Path(f'/run/systemd/netif/links/{ifindex}').read_text().splitlines():
+            if line.startswith('ADMIN_STATE='):
+                return line.removeprefix('ADMIN_STATE=')
+    except FileNotFoundError:
+        pass
+    return None
+
+def wait_configured(args, indices, start):
+    pending = set(indices)
+    ifindices = {}
+    failed = set()
+
+    while pending:
+        if time.monotonic() - start > args.timeout:
+            sys.exit(f'Timed out waiting for {len(pending)} link(s) to be configured, e.g. {link_name(min(pending))}.')
+
+        for i in list(pending):
+            if i not in ifindices:
+                ifindex = link_ifindex(i)
+                if ifindex is None:
+                    continue
+                ifindices[i] = ifindex
+
+            state = link_admin_state(ifindices[i])
+            if state == 'configured':
+                pending.remove(i)
+            elif state in ('failed', 'unmanaged'):
+                pending.remove(i)
+                failed.add(i)
+
+        if pending:
+            time.sleep(args.poll_interval)
+
+    return time.monotonic() - start, len(failed)
+
+def networkd_pid():
+    return int(check_output('systemctl', 'show', '--property=MainPID', '--value', 'systemd-networkd.service'))
+
+def process_cpu_usec(pid):
+    # utime and stime are the 14th and 15th fields. The process name might contain spaces, hence split
+    # only after it.
+    fields = pathlib.Path(f'/proc/{pid}/stat').read_text().rpartition(')')[2].split()
+    return (int(fields[11]) + int(fields[12])) * 1000000 // clock_ticks
+
+def process_memory_kib(pid):
+    ret = {}
+    for line in pathlib.Path(f'/proc/{pid}/status').read_text().splitlines():
+        key, _, value = line.partition(':')
+        if key in ('VmRSS', 'VmHWM'):
+            ret[key] = int(value.split()[0])
+    return ret
+
+def setup_nlmon():
+    if call_quiet('ip', 'link', 'add', nlmon_ifname, 'type', 'nlmon') != 0:
+        print('Failed to create nlmon interface, not counting netlink messages.', file=sys.stderr)
+        return False
+    call_quiet('ip', 'link', 'set', nlmon_ifname, 'up')
+    return True
+
+def netlink_messages(have_nlmon):
+    if not have_nlmon:
+        return None
+    return int(pathlib.Path(f'/sys/class/net/{nlmon_ifname}/statistics/rx_packets').read_text())
+
+class Sample:
+    def __init__(self, have_nlmon, pid=None):
+        self.time = time.monotonic()
+        self.netlink = netlink_messages(have_nlmon)
+        self.cpu = process_cpu_usec(pid) if pid else 0
+
+    def delta(self, have_nlmon, pid, elapsed=None, **kwargs):
+        now = Sample(have_nlmon, pid)
+        ret = {
+            'seconds': round(elapsed if elapsed is not None else now.time - self.time, 3),
+            'cpu_seconds': round((now.cpu - self.cpu) / 1000000, 3),
+            'netlink_messages': now.netlink - self.netlink if have_nlmon else None,
+        }
+        ret.update(process_memory_kib(pid))
+        ret.update(kwargs)
+        return ret
+
+def print_results(results):
+    for phase, r in results.items():
+        print(f'{phase}:')
+        print(f'    Time:              {r["seconds"]:.3f}s')
+        if 'failed' in r:
+            print(f'    Failed links:      {r["failed"]}')
+        print(f'    networkd CPU time: {r["cpu_seconds"]:.3f}s')
+        if r['netlink_messages'] is not None:
+            print(f'    Netlink messages:  {r["netlink_messages"]}')
+        print(f'    networkd RSS:      {r["VmRSS"]} KiB (peak {r["VmHWM"]} KiB)')
+
+def run_benchmark(args, have_nlmon):
+    results = {}
+    indices = range(args.links)
+    hotplug_indices = range(args.links, args.links + args.hotplug)
+
+    print(f'Creating {args.links} {args.kind} link(s) with {args.addresses} address(es) and {args.routes} route(s) each...')
+    for i in range(args.links + args.hotplug):
+        write_network_file(args, i)
+    create_links(args, indices)
+
+    # Links exist before networkd starts, as on boot.
+    sample = Sample(have_nlmon)
+    subprocess.run(['systemctl', 'start', 'systemd-networkd.service'], check=True)
+    pid = networkd_pid()
+    elapsed, failed = wait_configured(args, indices, sample.time)
+    results['startup'] = sample.delta(have_nlmon, pid, elapsed, failed=failed)
+
+    # Reloading .network files that did not change.
+    sample = Sample(have_nlmon, pid)
+    subprocess.run([args.networkctl, 'reload'], check=True)
+    elapsed, failed = wait_configured(args, indices, sample.time)
+    results['reload'] = sample.delta(have_nlmon, pid, elapsed, failed=failed)
+
+    # Links appearing while networkd is running, as when containers are started.
+    if args.hotplug > 0:
+        sample = Sample(have_nlmon, pid)
+        create_links(args, hotplug_indices)
+        elapsed, failed = wait_configured(args, hotplug_indices, sample.time)
+        results['hotplug'] = sample.delta(have_nlmon, pid, elapsed, failed=failed)
+
+    return results
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Benchmark systemd-networkd with many links.')
+    parser.add_argument('--links', type=int, default=1000, help='Number of links present when networkd starts')
+    parser.add_argument('--hotplug', type=int, default=100, help='Number of links added while networkd is running')
+    parser.add_argument('--kind', choices=['dummy', 'veth'], default='dummy', help='Kind of links to create')
+    parser.add_argument('--addresses', type=int, default=2, help='Number of addresses per link, alternating IPv4 and IPv6')
+    parser.add_argument('--routes', type=int, default=2, help='Number of routes per link')
+    parser.add_argument('--timeout', type=float, default=600, help='Give up after that many seconds per phase')
+    parser.add_argument('--poll-interval', type=float, default=0.1, help='Interval to check link states in seconds')
+    parser.add_argument('--networkctl', default='networkctl', help='Path to networkctl')
+    parser.add_argument('--keep', action='store_true', help='Do not remove links and .network files afterwards')
+    parser.add_argument('--json', action='store_true', help='Show results in JSON format')
+    args = parser.parse_args()
+
+    if args.links < 1 or args.hotplug < 0 or args.addresses < 0 or args.routes < 0:
+        parser.error('Invalid number of links, addresses, or routes.')
+    n = args.links + args.hotplug
+    if n > 0x20000 or n * args.addresses * 4 > 0x800000 or n * args.routes > 0x800000:
+        parser.error('Too many links, addresses, or routes.')
+
+    return args
+
+def main():
+    args = parse_args()
+
+    if os.geteuid() != 0:
+        sys.exit('This benchmark needs to be run as root.')
+
+    subprocess.run(['systemctl', 'stop', 'systemd-networkd.socket', 'systemd-networkd.service'], check=True)
+    remove_links(args)
+    remove_network_files()
+    call_quiet('ip', 'link', 'del', nlmon_ifname)
+    network_unit_dir.mkdir(parents=True, exist_ok=True)
+
+    have_nlmon = setup_nlmon()
+
+    try:
+        results = run_benchmark(args, have_nlmon)
+    finally:
+        if not args.keep:
+            subprocess.run(['systemctl', 'stop', 'systemd-networkd.socket', 'systemd-networkd.service'], check=False)
+            remove_links(args)
+            remove_network_files()
+            subprocess.run(['systemctl', 'start', 'systemd-networkd.service'], check=False)
+        if have_nlmon:
+            call_quiet('ip', 'link', 'del', nlmon_ifname)
+
+    if args.json:
+        print(json.dumps(results, indent=4))
+    else:
+        print_results(results)
+
+if __name__ == '__main__':
+    main()
@@ -6634,6 +6634,11 @@ class NetworkdDHCPServerTests(unittest.TestCase, Utilities):
         self.assertRegex(output, "Offered DHCP leases: 192.168.5.[0-9]*")
 
         if persist_leases:
+            # The lease file is written shortly after the lease changed.
+            for _ in range(20):
+                if os.path.exists('/var/lib/systemd/network/dhcp-server-lease/veth-peer'):
+                    break
+                time.sleep(0.5)
             with open('/var/lib/systemd/network/dhcp-server-lease/veth-peer', encoding='utf-8') as f:
                 check_json(f.read())
         else:
@@ -16,6 +16,8 @@ journalctl --flush
 varlinkctl call /run/systemd/journal/io.systemd.journal io.systemd.Journal.FlushToVar '{}'
 journalctl --sync
 varlinkctl call /run/systemd/journal/io.systemd.journal io.systemd.Journal.Synchronize '{}'
+varlinkctl call /run/systemd/journal/io.systemd.journal io.systemd.Journal.GetStatistics '{}' |
+    jq -e '.sources[] | select(.source == "stdout") | .messages > 0'
 journalctl --rotate --vacuum-size=8M
 
 # Reset the ratelimit buckets for the subsequent tests below.
@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: LGPL-2.1-or-later
+set -eux
+set -o pipefail
+
+# Test StartTransientUnits(), which creates and starts a batch of transient units, reporting errors per unit
+
+at_exit() {
+    set +e
+    systemctl stop transient-batch-one.service transient-batch-two.service transient-batch-refused.service
+    systemctl reset-failed transient-batch-one.service transient-batch-two.service transient-batch-refused.service
+}
+
+trap at_exit EXIT
+
+systemd-analyze log-level debug
+
+OUT="$(busctl call \
+    org.freedesktop.systemd1 /org/freedesktop/systemd1 \
+    org.freedesktop.systemd1.Manager StartTransientUnits \
+    "sa(sa(sv))" replace 4 \
+      transient-batch-one.service 1 \
+        ExecStart "a(sasb)" 1 /bin/sleep 2 /bin/sleep infinity false \
+      transient-batch-two.service 1 \
+        ExecStart "a(sasb)" 1 /bin/sleep 2 /bin/sleep infinity false \
+      transient-batch-one.service 1 \
+        ExecStart "a(sasb)" 1 /bin/sleep 2 /bin/sleep infinity false \
+      transient-batch-refused.service 2 \
+        ExecStart "a(sasb)" 1 /bin/sleep 2 /bin/sleep infinity false \
+        RefuseManualStart b true)"
+echo "$OUT"
+
+# One entry per requested unit, in order
+[[ "$OUT" =~ ^"a(soss) 4 " ]]
+
+# The first two got a job, the duplicate name and the unit refusing manual start got an error each,
+# without failing the others
+[[ "$OUT" =~ \"transient-batch-one.service\"\ \"/org/freedesktop/systemd1/job/[0-9]+\"\ \"\"\ \"\"\ \"transient-batch-two.service\"\ \"/org/freedesktop/systemd1/job/[0-9]+\"\ \"\"\ \"\" ]]
+[[ "$OUT" =~ \"transient-batch-one.service\"\ \"/\"\ \"org.freedesktop.systemd1.UnitExists\" ]]
+[[ "$OUT" =~ \"transient-batch-refused.service\"\ \"/\"\ \"org.freedesktop.systemd1.OnlyByDependency\" ]]
+
+# The call only queues the jobs, hence wait for them to finish
+timeout 30 bash -c 'until systemctl is-active transient-batch-one.service; do sleep .5; done'
+timeout 30 bash -c 'until systemctl is-active transient-batch-two.service; do sleep .5; done'
+(! systemctl is-active transient-batch-refused.service)
+
+# An invalid job mode fails the whole call
+(! busctl call \
+    org.freedesktop.systemd1 /org/freedesktop/systemd1 \
+    org.freedesktop.systemd1.Manager StartTransientUnits \
+    "sa(sa(sv))" foobar 1 \
+      transient-batch-three.service 1 \
+        ExecStart "a(sasb)" 1 /bin/sleep 2 /bin/sleep infinity false)
+(! systemctl is-active transient-batch-three.service)
+
+systemd-analyze log-level info
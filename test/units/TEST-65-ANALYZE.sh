@@ -11,7 +11,7 @@ export SYSTEMD_LOG_LEVEL=debug
 
 # Sanity checks
 #
-# We can't really test time, critical-chain and plot verbs here, as
+# We can't really test time, critical-chain, plot and trace verbs here, as
 # the testsuite service is a part of the boot transaction, so let's assume
 # they fail
 systemd-analyze || :
@@ -34,6 +34,11 @@ systemd-analyze plot --table --no-legend >/dev/null || :
 systemd-analyze plot --scale-svg=1.0 >/dev/null || :
 systemd-analyze plot --scale-svg=1.0 --detailed >/dev/null || :
 (! systemd-analyze plot --global)
+# trace
+systemd-analyze trace >/dev/null || :
+systemd-analyze trace --json=pretty >/dev/null || :
+systemd-analyze trace --json=short >/dev/null || :
+(! systemd-analyze trace --global)
 # legacy/deprecated options (moved to systemctl, but still usable from analyze)
 systemd-analyze log-level
 systemd-analyze log-level "$(systemctl log-level)"